@@ -82,8 +82,19 @@ do {				\
 	md5_result((x), (y));	\
 } while (0)
 
+/* HMAC-MD5 of a fixed key: the inner and outer MD5 states after the key
+ * XORed pads, so digests with the key do not derive the pads again */
+typedef struct {
+	md5_ctxt	hmac_ictx;	/* MD5 of K XOR ipad */
+	md5_ctxt	hmac_octx;	/* MD5 of K XOR opad */
+} hmac_md5_ctxt;
+
 /* From RFC 2104 */
 void hmac_md5(unsigned char* text, int text_len, unsigned char* key,
               int key_len, uint8_t *digest);
+void hmac_md5_init(hmac_md5_ctxt *hctx, const unsigned char *key,
+                   int key_len);
+void hmac_md5_keyed(const hmac_md5_ctxt *hctx, const unsigned char *text,
+                    int text_len, uint8_t *digest);
 
 #endif /* ! _LIBZEBRA_MD5_H_*/
@@ -20,6 +20,7 @@
 #include <unixctl.h>
 #include <sys/types.h>
 #include <dynamic-string.h>
+#include "mstp_trace.h"
 
 void mstpd_ovsdb_init(const char *db_path);
 void mstpd_ovsdb_exit(void);
@@ -56,9 +57,47 @@ void mstpd_daemon_debug_sm_data_dump(struct ds *ds, int argc, const char *argv[]
 void mstpd_daemon_digest_unixctl_list(struct unixctl_conn *conn, int argc,
                    const char *argv[], void *aux OVS_UNUSED);
 void mstpd_daemon_digest_data_dump(struct ds *ds, int argc, const char *argv[]);
+void mstpd_daemon_digest_bench_run(void);
+void mstpd_daemon_digest_bench_wait(void);
+void mstpd_daemon_stats_interval_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED);
+void mstpd_daemon_bpdu_fastpath_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED);
+void mstpd_daemon_rx_batch_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED);
+void mstpd_daemon_ovsdb_lock_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED);
+void mstpd_lock_stats_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED);
+void mstpd_trace_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED);
+void mstpd_sm_history_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED);
+void mstpd_daemon_bpdu_policer_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED);
+void mstpd_daemon_rx_socket_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED);
+void mstpd_daemon_msti_workers_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED);
+void mstpd_daemon_memory_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED);
+void mstpd_daemon_warm_restart_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED);
+void mstpd_daemon_region_plan_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED);
 void mstpd_daemon_intf_to_mstp_map_unixctl_list(struct unixctl_conn *conn, int argc,
                    const char *argv[], void *aux OVS_UNUSED);
 void mstpd_daemon_intf_to_mstp_map_data_dump(struct ds *ds, int argc, const char *argv[]);
+void mstpd_daemon_status_unixctl_list(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED);
+void mstpd_daemon_status_data_dump(struct ds *ds, int argc, const char *argv[]);
+void mstp_statusInit(void);
+void mstp_statusPublish(uint32_t msg_type);
+void mstp_statusShutdown(void);
+void mstp_traceInit(void);
+void mstp_ckptInit(void);
+MSTP_TRACE_SHM_t *mstp_traceShmGet(void);
+bool mstp_traceSetEnabled(bool enable);
 
 void *mstpd_rx_pdu_thread(void *data);
 int register_stp_mcast_addr(int ifindex);
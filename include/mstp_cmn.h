@@ -34,7 +34,10 @@ typedef enum mstpd_message_type_enum {
     e_mstpd_cist_port_config,
     e_mstpd_msti_config,
     e_mstpd_msti_port_config,
-    e_mstpd_msti_config_delete
+    e_mstpd_msti_config_delete,
+    e_mstpd_lport_info,         /* mstp_lport_info */
+    e_mstpd_config_reload,      /* config re-send follows, no payload */
+    e_mstpd_config_batch        /* mstp_config_batch */
 } mstpd_message_type;
 
 typedef struct mstp_lport_state_change {
@@ -53,13 +56,11 @@ typedef struct mstp_lport_delete {
 } mstp_lport_delete;
 
 typedef struct mstp_vlan_add {
-    char *name;
-    int vid;
+    VID_MAP vids;               /* VLANs created since the last update */
 } mstp_vlan_add;
 
 typedef struct mstp_vlan_delete {
-    char *name;
-    int vid;
+    VID_MAP vids;               /* VLANs deleted since the last update */
 } mstp_vlan_delete;
 
 typedef struct mstp_admin_status {
@@ -79,6 +80,11 @@ typedef struct mstp_msti_config_delete {
     int mstid;
 } mstp_msti_config_delete;
 
+/* Config updates are waiting in the config mailbox, up to batch 'seq' */
+typedef struct mstp_config_batch {
+    uint64_t seq;
+} mstp_config_batch;
+
 typedef struct mstpd_message_struct
 {
     mstpd_message_type msg_type;
@@ -38,6 +38,14 @@
 #define PACKED
 #endif
 
+/* cache line size the per-port structures are laid out for */
+#define MSTP_CACHE_LINE_SIZE 64
+#if defined (__GNUC__)
+#define MSTP_CACHE_ALIGNED  __attribute__((aligned(MSTP_CACHE_LINE_SIZE)))
+#else
+#define MSTP_CACHE_ALIGNED
+#endif
+
 #define MSTP_MAX_CONFIG_NAME_LEN    32
 #define DEF_ADMIN_STATUS            false
 #define DEF_HELLO_TIME              2
@@ -83,6 +91,101 @@
 #define MSTP_INSTANCE_CONFIG        "mstp_instances_configured"
 #define MSTP_TX_BPDU                "mstp_tx_bpdu"
 #define MSTP_RX_BPDU                "mstp_rx_bpdu"
+#define MSTP_TX_BPDU_RATE           "mstp_tx_bpdu_rate"
+#define MSTP_RX_BPDU_RATE           "mstp_rx_bpdu_rate"
+
+/* BPDU statistics export to DB, seconds */
+#define MSTP_STATS_EXPORT_INTERVAL_DEF  5
+#define MSTP_STATS_EXPORT_INTERVAL_MIN  1
+#define MSTP_STATS_EXPORT_INTERVAL_MAX  300
+
+/* BPDU batch drain limits: max BPDUs per batch (1 disables batching) and
+ * max time in microseconds DB and TX updates may be deferred by a batch */
+#define MSTP_RX_BATCH_MAX_DEF           64
+#define MSTP_RX_BATCH_MAX_MIN           1
+#define MSTP_RX_BATCH_MAX_MAX           1024
+#define MSTP_RX_BATCH_USEC_DEF          2000
+#define MSTP_RX_BATCH_USEC_MIN          100
+#define MSTP_RX_BATCH_USEC_MAX          100000
+
+/* BPDU ingress policer, per port. Rate in BPDUs per second (0 disables
+ * policing) and bucket depth in BPDUs, set by the Port other_config keys
+ * below */
+#define MSTP_BPDU_RATE_LIMIT            "mstp_bpdu_rate_limit"
+#define MSTP_BPDU_BURST                 "mstp_bpdu_burst"
+#define MSTP_BPDU_RATE_LIMIT_DEF        100
+#define MSTP_BPDU_RATE_LIMIT_MAX        100000
+#define MSTP_BPDU_BURST_DEF             100
+#define MSTP_BPDU_BURST_MIN             1
+#define MSTP_BPDU_BURST_MAX             100000
+#define MSTP_RX_BPDU_POLICED            "mstp_rx_bpdu_policed"
+
+/* MSTI worker pool: threads running the MSTI root elections in parallel
+ * with the protocol thread, 0 disables the pool */
+#define MSTP_MSTI_WORKERS_DEF           0
+#define MSTP_MSTI_WORKERS_MAX           16
+
+/* Warm restart checkpoint: seconds between two checkpoints of the port
+ * state (0 disables checkpointing), and the window in seconds after a
+ * checkpoint within which a restarted daemon restores it */
+#define MSTP_CKPT_INTERVAL_DEF          1
+#define MSTP_CKPT_INTERVAL_MAX          60
+#define MSTP_CKPT_GRACE_DEF             30
+#define MSTP_CKPT_GRACE_MIN             1
+#define MSTP_CKPT_GRACE_MAX             300
+
+/* Default rows inserted at start up before the bootstrap commits and opens
+ * a new transaction, see 'util_mstp_bootstrap' */
+#define MSTP_BOOTSTRAP_TXN_ROWS         4096
+
+/* A speed change of a LAG, which comes and goes as its members flap, is
+ * applied to the port's path cost once no other change came for the hold
+ * time, or once it has been held for the max time, see 'mstp_lportCostTick' */
+#define MSTP_LAG_COST_HOLD_SEC          2
+#define MSTP_LAG_COST_HOLD_MAX_SEC      10
+
+/* A neighbour's MST Configuration Identifier not heard for this long is
+ * left out of region plans, see 'mstp_rgnPlanEval' */
+#define MSTP_RGN_PEER_AGE_MAX_SEC       30
+
+/* Most Configuration Digests timed by one digest dump, on a thread of its
+ * own, see 'mstpd_daemon_digest_unixctl_list' */
+#define MSTP_DIGEST_BENCH_MAX           10000
+
+/* Cached path cost of a logical port, see 'mstp_lportCostGet' */
+typedef struct mstp_lport_cost
+{
+   uint32_t operCost;                    /* from the current speed/duplex */
+   uint32_t appliedCost;                 /* last one set on the trees    */
+   uint32_t speedChgCnt;                 /* speed/duplex changes seen    */
+   uint32_t dampedCnt;                   /* LAG changes folded into a
+                                          * pending one                  */
+   bool     held;                        /* a LAG change is pending      */
+   bool     valid;                       /* speed/duplex known           */
+
+} MSTP_LPORT_COST_t;
+
+/* BPDU ingress policer state of a port, see 'mstp_rxPolicerStatsGet' */
+typedef struct mstp_rx_policer_stats
+{
+   uint32_t rate;                        /* BPDUs per second, 0 if the
+                                          * port is not policed          */
+   uint32_t burst;
+   uint64_t dropCnt;                     /* BPDUs dropped                */
+   uint64_t exceedCnt;                   /* times the port went over its
+                                          * rate                         */
+   bool     exceeding;                   /* dropping right now           */
+
+} MSTP_RX_POLICER_STATS_t;
+
+/* Kernel counters of the BPDU socket of a port, see 'mstp_rxSockStatsGet' */
+typedef struct mstp_rx_sock_stats
+{
+   uint64_t packets;                     /* frames that passed the filter */
+   uint64_t drops;                       /* of them, lost to a full
+                                          * socket buffer                */
+
+} MSTP_RX_SOCK_STATS_t;
 
 /************ MSTP_CONFIG OF PORT TABLE **************************/
 
@@ -540,6 +643,8 @@ void mstpInitialInit();
  *   */
 void mstp_adminStatusUpdate(int status);
 void mstp_addLport(LPORT_t lport);
+void mstp_dynReconfigRestartScoped(void);
+void mstp_dynReconfigClearScope(void);
 void mstp_removeLport(LPORT_t lport);
 bool mstp_isp2pEnable(LPORT_t lport);
 /*
@@ -611,6 +716,9 @@ VID_t    mstp_vidMapToVidStr(VID_MAP *srcVidMap, char *buf,
         uint16_t bufLen);
 void     mstp_convertVlanMstiMappingCfg(bool pending);
 void     mstp_setDynReconfigChangeFlag(void);
+void     mstp_setDynReconfigTreeFlag(uint16_t mstid);
+void     mstp_setDynReconfigPortFlag(uint16_t mstid, LPORT_t lport);
+void     mstp_statusPortChg(uint16_t mstid, LPORT_t lport);
 bool isMstp64Instance(void);
 
 
@@ -952,12 +1060,19 @@ bool isMstp64Instance(void);
 #define MSTP_BLK_LPORTS                (mstp_CB.blkLports)
 #define MSTP_MSGS                      (mstp_CB.msgs)
 #define MSTP_TREE_MSGS_QUEUE           (mstp_CB.msgs.treeMsgQueue)
+#define MSTP_TREE_MSG_SLOT_IS_DIRTY(slot) \
+   ((mstp_CB.msgs.dirtyMap[(slot)/32] & (1U << ((slot)%32))) != 0)
+#define MSTP_TREE_MSG_SLOT_SET_DIRTY(slot) \
+   (mstp_CB.msgs.dirtyMap[(slot)/32] |= (1U << ((slot)%32)))
+#define MSTP_TREE_MSG_SLOT_CLR_DIRTY(slot) \
+   (mstp_CB.msgs.dirtyMap[(slot)/32] &= ~(1U << ((slot)%32)))
 #define STP_PROTOCOL_VERSION_MSTP      3
 #define MSTP_ENABLED \
 ((Spanning == true) && (Stp_version == STP_PROTOCOL_VERSION_MSTP))
 
 #define MSTP_BEGIN                     (mstp_Bridge.BEGIN)
 #define MSTP_DYN_RECONFIG_CHANGE       (mstp_Bridge.dynReconfig)
+#define MSTP_DYN_RECONFIG_SCOPED       (mstp_Bridge.dynReconfigScoped)
 #define MSTP_NUM_OF_VALID_TREES        (mstp_Bridge.numOfValidTrees)
 
 #define MSTP_CIST_INFO                 (mstp_Bridge.CistInfo)
@@ -999,7 +1114,7 @@ bool isMstp64Instance(void);
    (isBitSet((m),(b),MSTP_PORT_BIT_MAP_MAX) ? true : false)
 
 #define MSTP_COMM_ERRANT_BPDU_COUNT(p) \
-                                 (MSTP_CIST_PORT_PTR(p)->dbgCnts.errantBpduCnt)
+                                 (MSTP_CIST_PORT_PTR(p)->cold->dbgCnts.errantBpduCnt)
 
 #define MSTP_ENABLED ((Spanning == true) && \
                       (Stp_version == STP_PROTOCOL_VERSION_MSTP))
@@ -1086,6 +1201,14 @@ bool isMstp64Instance(void);
    clear_vid(vidmap, MAX_VLAN_ID);          \
 }
 
+/*---------------------------------------------------------------------------
+ * State machine flight recorder. Takes the arguments of the state
+ * transition debug macros: label, old state name, new state name, ...
+ *---------------------------------------------------------------------------*/
+#define MSTP_SM_REC_NO_MSTID  0xFF   /* per-port state machine */
+#define MSTP_SM_REC(m, i, p, label, oldSt, newSt, ...) \
+        mstp_smRecord((m), (i), (p), (oldSt), (newSt))
+
 /*---------------------------------------------------------------------------
  * Macros used in debugging code
  *---------------------------------------------------------------------------*/
@@ -1171,32 +1294,55 @@ if(mstp_debugFlush &&                                        \
 { MSTP_PRINTF(format, __VA_ARGS__) }
 #endif
 
+/*---------------------------------------------------------------------------
+ * State transitions are always recorded in the flight recorder (binary, no
+ * formatting, see mstpd_sm_rec.c); the text trace is printed on top of it
+ * when debugging of the state machine is enabled.
+ *---------------------------------------------------------------------------*/
 #if (__GNUC__ < 3)
-#define MSTP_SM_ST_PRINTF(m, format, args...)            \
-if(((mstid == MSTP_CISTID) && mstp_debugCist) ||         \
-   isBitSet(mstp_debugMstis.map, mstid, MSTP_MSTID_MAX)) \
-{ MSTP_SM_PORT_PRINTF(m, lport, format, args) }
+#define MSTP_SM_ST_PRINTF(m, format, args...)               \
+{                                                           \
+   MSTP_SM_REC(m, mstid, lport, args);                      \
+   if(((mstid == MSTP_CISTID) && mstp_debugCist) ||         \
+      isBitSet(mstp_debugMstis.map, mstid, MSTP_MSTID_MAX)) \
+   { MSTP_SM_PORT_PRINTF(m, lport, format, args) }          \
+}
 #else
-#define MSTP_SM_ST_PRINTF(m, format, ...)                \
-if(((mstid == MSTP_CISTID) && mstp_debugCist) ||         \
-   isBitSet(mstp_debugMstis.map, mstid, MSTP_MSTID_MAX)) \
-{ MSTP_SM_PORT_PRINTF(m, lport, format, __VA_ARGS__) }
+#define MSTP_SM_ST_PRINTF(m, format, ...)                   \
+{                                                           \
+   MSTP_SM_REC(m, mstid, lport, __VA_ARGS__);               \
+   if(((mstid == MSTP_CISTID) && mstp_debugCist) ||         \
+      isBitSet(mstp_debugMstis.map, mstid, MSTP_MSTID_MAX)) \
+   { MSTP_SM_PORT_PRINTF(m, lport, format, __VA_ARGS__) }   \
+}
 #endif
 
 #if (__GNUC__ < 3)
-#define MSTP_SM_ST_PRINTF1(m, format, args...) \
-        MSTP_SM_PORT_PRINTF(m, lport, format,args)
+#define MSTP_SM_ST_PRINTF1(m, format, args...)             \
+{                                                          \
+   MSTP_SM_REC(m, MSTP_SM_REC_NO_MSTID, lport, args);      \
+   MSTP_SM_PORT_PRINTF(m, lport, format,args)              \
+}
 #else
-#define MSTP_SM_ST_PRINTF1(m, format, ...)     \
-        MSTP_SM_PORT_PRINTF(m, lport, format, __VA_ARGS__)
+#define MSTP_SM_ST_PRINTF1(m, format, ...)                 \
+{                                                          \
+   MSTP_SM_REC(m, MSTP_SM_REC_NO_MSTID, lport, __VA_ARGS__); \
+   MSTP_SM_PORT_PRINTF(m, lport, format, __VA_ARGS__)      \
+}
 #endif
 
 #if (__GNUC__ < 3)
 #define MSTP_SM_ST_PRINTF2(m, format, args...) \
-        MSTP_SM_PRINTF(m, format, args)
+{                                              \
+   MSTP_SM_REC(m, mstid, 0, args);             \
+   MSTP_SM_PRINTF(m, format, args)             \
+}
 #else
 #define MSTP_SM_ST_PRINTF2(m, format, ...)     \
-        MSTP_SM_PRINTF(m, format, __VA_ARGS__)
+{                                              \
+   MSTP_SM_REC(m, mstid, 0, __VA_ARGS__);      \
+   MSTP_SM_PRINTF(m, format, __VA_ARGS__)      \
+}
 #endif
 
 #if (__GNUC__ < 3)
@@ -1517,9 +1663,12 @@ if(mstp_debugMisc &&                                        \
 #define MSTP_PORT_STATUS_PRINTF(p, format, args...)
 #define MSTP_MSTI_PORT_STATUS_PRINTF(i, p, format, ...)
 #define MSTP_MSTI_PORT_FLUSH_PRINTF(i, p, format, args...)
-#define MSTP_SM_ST_PRINTF(m, format, ...)
-#define MSTP_SM_ST_PRINTF1(m, format, ...)
-#define MSTP_SM_ST_PRINTF2(m, format, ...)
+#define MSTP_SM_ST_PRINTF(m, format, ...) \
+        MSTP_SM_REC(m, mstid, lport, __VA_ARGS__)
+#define MSTP_SM_ST_PRINTF1(m, format, ...) \
+        MSTP_SM_REC(m, MSTP_SM_REC_NO_MSTID, lport, __VA_ARGS__)
+#define MSTP_SM_ST_PRINTF2(m, format, ...) \
+        MSTP_SM_REC(m, mstid, 0, __VA_ARGS__)
 #define MSTP_SM_CALL_SM_PRINTF(m, format, ...)
 #define MSTP_SM_CALL_SM_PRINTF1(m, format, ...)
 #define MSTP_SM_PRINTF(m, format, args...)
@@ -1613,11 +1762,24 @@ typedef struct MSTP_TREE_MSG_t
    PORT_MAP     portsMacAddrFlush;
    PORT_MAP     portsSetEdge;
    PORT_MAP     portsClearEdge;
+   uint64_t     decisionTime; /* monotonic usec of the first port state
+                               * change not yet written to DB, 0 if none */
 } MSTP_TREE_MSG_t;
 
+/*---------------------------------------------------------------------------
+ * Tree messages are not allocated per event. Every tree owns one
+ * preallocated slot (CIST + MSTIs indexed by MSTID, plus one slot for the
+ * MSTP_NON_STP_BRIDGE pseudo tree) that is linked onto the queue while it
+ * carries pending information. The dirty map tells which slots are queued.
+ *---------------------------------------------------------------------------*/
+#define MSTP_TREE_MSG_NON_STP_SLOT  (MSTP_INSTANCES_MAX + 1)
+#define MSTP_TREE_MSG_SLOTS         (MSTP_INSTANCES_MAX + 2)
+
 typedef struct MSTP_MESSAGES_t
 {
    QUEUE_HEAD treeMsgQueue; /* per tree msgs to inform other subsystems */
+   MSTP_TREE_MSG_t treeMsgSlot[MSTP_TREE_MSG_SLOTS];
+   uint32_t   dirtyMap[((MSTP_TREE_MSG_SLOTS + 31)/32)]; /* queued slots */
 
 } MSTP_TREE_MSGS_t;
 
@@ -2470,35 +2632,12 @@ typedef struct MSTP_PORT_HISTORY
  *---------------------------------------------------------------------------*/
 typedef struct MSTP_MSTI_PORT_INFO_t
 {
-   /* Statistics MIB support (RFC1493 MIB) */
-   uint32_t                          forwardTransitions;
-   time_t                            forwardTransitionsLastUpdated;
-
-   /* State Machine Performance Parameters (802.1Q-REV/D5.0) */
-   uint32_t                          InternalPortPathCost;/* 13.37.1         */
-   bool                             useCfgPathCost;/* indicates whether to use
-                                                    * user configured path cost
-                                                    * value or 'autodetect' it
-                                                    * from the link speed */
-   uint32_t                           mstiPort_uptime;
+   /* The fields are ordered by how often they are used: the ones the
+    * state machines test on every timer tick come first and must fit in
+    * one cache line (see the asserts in 'mstpd_port_arena.c'), the
+    * priority vectors used on BPDU receipt and role selection follow,
+    * then the configuration. */
 
-   bool                             loopInconsistent;   /* TRUE if port
-                                                          * state is
-                                                          * inconsistent */
-
-   bool                             rootInconsistent;
-   /* Per-Port Variables (802.1Q-REV/D5.0 13.24) */
-   MSTP_INFO_IS_t                    infoIs;             /*  x)              */
-   MSTP_RCVD_INFO_t                  rcvdInfo;           /* ac)              */
-   MSTP_MSTI_DESIGNATED_PRI_VECTOR_t designatedPriority; /* al)              */
-   MSTP_MSTI_DESIGNATED_TIMES_t      designatedTimes;    /* am)              */
-   MSTP_MSTI_MSG_PRI_VECTOR_t        msgPriority;        /* an)              */
-   MSTP_MSTI_MSG_TIMES_t             msgTimes;           /* ao)              */
-   MSTP_PORT_ID_t                    portId;             /* ap)              */
-   MSTP_MSTI_PORT_PRI_VECTOR_t       portPriority;       /* aq)              */
-   MSTP_MSTI_PORT_TIMES_t            portTimes;          /* ar)              */
-   MSTP_PORT_ROLE_t                  role;               /* as)              */
-   MSTP_PORT_ROLE_t                  selectedRole;       /* at)              */
    uint32_t                          bitMap[((MSTP_MSTI_PORT_BIT_MAP_MAX+31)/32)];
    /* NOTE: variables of bool type are combined into above bit map,
     * namely:
@@ -2531,18 +2670,56 @@ typedef struct MSTP_MSTI_PORT_INFO_t
    uint8_t                            tcWhile;            /*  g)              */
    uint8_t                            rcvdInfoWhile;      /*  h)              */
 
+   bool                             loopInconsistent;   /* TRUE if port
+                                                          * state is
+                                                          * inconsistent */
+   bool                             rootInconsistent;
+
    /* Per-Port State Machines states (802.1Q-REV/D5.0) */
    MSTP_PIM_STATE_t                  pimState;           /* 13.32            */
    MSTP_PRT_STATE_t                  prtState;           /* 13.34            */
    MSTP_PST_STATE_t                  pstState;           /* 13.35            */
    MSTP_TCM_STATE_t                  tcmState;           /* 13.36            */
 
-   /* Counters used for debugging and troubleshooting purposes */
-   MSTP_MSTI_PORT_DBG_CNTS_t         dbgCnts;
+   /* Per-Port Variables (802.1Q-REV/D5.0 13.24) */
+   MSTP_INFO_IS_t                    infoIs;             /*  x)              */
+   MSTP_RCVD_INFO_t                  rcvdInfo;           /* ac)              */
+   MSTP_PORT_ROLE_t                  role;               /* as)              */
+   MSTP_PORT_ROLE_t                  selectedRole;       /* at)              */
+   MSTP_PORT_ID_t                    portId;             /* ap)              */
+   MSTP_MSTI_DESIGNATED_TIMES_t      designatedTimes;    /* am)              */
+   MSTP_MSTI_MSG_TIMES_t             msgTimes;           /* ao)              */
+   MSTP_MSTI_PORT_TIMES_t            portTimes;          /* ar)              */
+   MSTP_MSTI_DESIGNATED_PRI_VECTOR_t designatedPriority; /* al)              */
+   MSTP_MSTI_MSG_PRI_VECTOR_t        msgPriority;        /* an)              */
+   MSTP_MSTI_PORT_PRI_VECTOR_t       portPriority;       /* aq)              */
 
-   MSTP_PORT_HISTORY_t               portHistory[MSTP_PORT_HISTORY_MAX];
+   /* State Machine Performance Parameters (802.1Q-REV/D5.0) */
+   uint32_t                          InternalPortPathCost;/* 13.37.1         */
+   bool                             useCfgPathCost;/* indicates whether to use
+                                                    * user configured path cost
+                                                    * value or 'autodetect' it
+                                                    * from the link speed */
+
+   /* Statistics, counters used for debugging and troubleshooting purposes
+    * and the port role history, kept apart in the cold port arena */
+   struct MSTP_MSTI_PORT_COLD_t     *cold;
 } MSTP_MSTI_PORT_INFO_t;
 
+/*---------------------------------------------------------------------------
+ * MSTI Per-Port data not used by the state machines.
+ *---------------------------------------------------------------------------*/
+typedef struct MSTP_MSTI_PORT_COLD_t
+{
+   /* Statistics MIB support (RFC1493 MIB) */
+   uint32_t                          forwardTransitions;
+   time_t                            forwardTransitionsLastUpdated;
+   uint32_t                          mstiPort_uptime;
+
+   MSTP_MSTI_PORT_DBG_CNTS_t         dbgCnts;
+   MSTP_PORT_HISTORY_t               portHistory[MSTP_PORT_HISTORY_MAX];
+} MSTP_MSTI_PORT_COLD_t;
+
 /*---------------------------------------------------------------------------
  * CIST Port Debug Counters used for debugging and troubleshooting purposes
  *---------------------------------------------------------------------------*/
@@ -2607,35 +2784,9 @@ typedef struct MSTP_CIST_PORT_DBG_CNTS_t
  *---------------------------------------------------------------------------*/
 typedef struct MSTP_CIST_PORT_INFO_t
 {
-   /* Statistics MIB support (RFC1493 MIB) */
-   uint32_t                          forwardTransitions;
-   time_t                            forwardTransitionsLastUpdated;
-
-   /* State Machine Performance Parameters (802.1Q-REV/D5.0)  */
-   uint32_t                          InternalPortPathCost;/* 13.37.1 */
-   bool                             useCfgPathCost;/* indicates whether to use
-                                                    * user configured path cost
-                                                    * value or 'autodetect' it
-                                                    * from the link speed */
-  uint32_t                           cistPort_uptime;
-
-   bool                             loopInconsistent;  /* TREU if port
-                                                         * state is
-                                                         * inconsistent */
+   /* Ordered as 'MSTP_MSTI_PORT_INFO_t': timer tick fields first, then the
+    * priority vectors, then the configuration */
 
-   bool                             rootInconsistent;
-   /* Per-Port Variables (802.1Q-REV/D5.0 13.24) */
-   MSTP_INFO_IS_t                    infoIs;             /*  x)               */
-   MSTP_RCVD_INFO_t                  rcvdInfo;           /* ac)               */
-   MSTP_CIST_DESIGNATED_PRI_VECTOR_t designatedPriority; /* al)               */
-   MSTP_CIST_DESIGNATED_TIMES_t      designatedTimes;    /* am)               */
-   MSTP_CIST_MSG_PRI_VECTOR_t        msgPriority;        /* an)               */
-   MSTP_CIST_MSG_TIMES_t             msgTimes;           /* ao)               */
-   MSTP_PORT_ID_t                    portId;             /* ap)               */
-   MSTP_CIST_PORT_PRI_VECTOR_t       portPriority;       /* aq)               */
-   MSTP_CIST_PORT_TIMES_t            portTimes;          /* ar)               */
-   MSTP_PORT_ROLE_t                  role;               /* as)               */
-   MSTP_PORT_ROLE_t                  selectedRole;       /* at)               */
    uint32_t                        bitMap[((MSTP_CIST_PORT_BIT_MAP_MAX+31)/32)];
    /* NOTE: variables of bool type are combined into above bit map,
     * namely:
@@ -2666,43 +2817,67 @@ typedef struct MSTP_CIST_PORT_INFO_t
    uint8_t                            tcWhile;            /*  g)              */
    uint8_t                            rcvdInfoWhile;      /*  h)              */
 
+   bool                             loopInconsistent;  /* TRUE if port
+                                                         * state is
+                                                         * inconsistent */
+   bool                             rootInconsistent;
+
    /* Per-Port State Machines states (802.1Q-REV/D5.0) */
    MSTP_PIM_STATE_t                  pimState;           /* 13.32            */
    MSTP_PRT_STATE_t                  prtState;           /* 13.34            */
    MSTP_PST_STATE_t                  pstState;           /* 13.35            */
    MSTP_TCM_STATE_t                  tcmState;           /* 13.36            */
 
-   /* Counters used for debugging and troubleshooting purposes */
+   /* Per-Port Variables (802.1Q-REV/D5.0 13.24) */
+   MSTP_INFO_IS_t                    infoIs;             /*  x)               */
+   MSTP_RCVD_INFO_t                  rcvdInfo;           /* ac)               */
+   MSTP_PORT_ROLE_t                  role;               /* as)               */
+   MSTP_PORT_ROLE_t                  selectedRole;       /* at)               */
+   MSTP_PORT_ID_t                    portId;             /* ap)               */
+   MSTP_CIST_DESIGNATED_TIMES_t      designatedTimes;    /* am)               */
+   MSTP_CIST_MSG_TIMES_t             msgTimes;           /* ao)               */
+   MSTP_CIST_PORT_TIMES_t            portTimes;          /* ar)               */
+   MSTP_CIST_DESIGNATED_PRI_VECTOR_t designatedPriority; /* al)               */
+   MSTP_CIST_MSG_PRI_VECTOR_t        msgPriority;        /* an)               */
+   MSTP_CIST_PORT_PRI_VECTOR_t       portPriority;       /* aq)               */
+
+   /* State Machine Performance Parameters (802.1Q-REV/D5.0)  */
+   uint32_t                          InternalPortPathCost;/* 13.37.1 */
+   bool                             useCfgPathCost;/* indicates whether to use
+                                                    * user configured path cost
+                                                    * value or 'autodetect' it
+                                                    * from the link speed */
+
+   /* Statistics, counters used for debugging and troubleshooting purposes
+    * and the port role history, kept apart in the cold port arena */
+   struct MSTP_CIST_PORT_COLD_t     *cold;
+} MSTP_CIST_PORT_INFO_t;
+
+/*---------------------------------------------------------------------------
+ * CIST Per-Port data not used by the state machines.
+ *---------------------------------------------------------------------------*/
+typedef struct MSTP_CIST_PORT_COLD_t
+{
+   /* Statistics MIB support (RFC1493 MIB) */
+   uint32_t                          forwardTransitions;
+   time_t                            forwardTransitionsLastUpdated;
+   uint32_t                          cistPort_uptime;
+
    MSTP_CIST_PORT_DBG_CNTS_t         dbgCnts;
    MSTP_PORT_HISTORY_t               portHistory[MSTP_PORT_HISTORY_MAX];
-} MSTP_CIST_PORT_INFO_t;
+} MSTP_CIST_PORT_COLD_t;
 
 /*---------------------------------------------------------------------------
  * CIST and MSTIs common Per-Port information.
  *---------------------------------------------------------------------------*/
 typedef struct MSTP_COMM_PORT_INFO_t
 {
-   /* State Machine Timers (802.1Q-REV/D5.0 13.21) */
-   uint8_t                          mdelayWhile;    /* a)                     */
-   uint8_t                          helloWhen;      /* b)                     */
-   uint8_t                          edgeDelayWhile; /* c)                     */
-
-   /* State Machine Performance Parameters (802.1Q-REV/D5.0 13.37) */
-   bool                           useGlobalHelloTime;/* TRUE means use per
-                                                       * box Hello Time value*/
-   uint16_t                        HelloTime;           /* g)                */
-   uint32_t                         ExternalPortPathCost;/* f)                */
-   bool                           useCfgPathCost;/* indicates whether to use
-                                                   * user configured path cost
-                                                   * value or 'autodetect' it
-                                                   * from the link speed     */
-   bool                           rcvdSelfSentPkt;/* TRUE if this port RX-ed
-                                                    * self-sent (externally
-                                                    * looped-back) BPDU      */
-
-   /* Per-Port Variables (802.1Q-REV/D5.0 13.24) */
-   uint8_t                          txCount;        /* e)                     */
-   uint32_t                         ageingTime;     /* a) */
+   /*------------------------------------------------------------------------
+    * Hot part: the fields used on every timer tick come first, then the
+    * ones used on every BPDU. Allocated cache line aligned (see
+    * 'mstp_portArenaCommAlloc'), so the hot part spans
+    * 'MSTP_COMM_PORT_HOT_LINES' lines.
+    *------------------------------------------------------------------------*/
    uint32_t                        bitMap[((MSTP_PORT_BIT_MAP_MAX + 31)/32)];
    /* NOTE: variables of bool type are combined into above bit map,
     * namely:
@@ -2729,46 +2904,122 @@ typedef struct MSTP_COMM_PORT_INFO_t
                                    operPointToPointMAC 802.1D-2004 6.4.3
    */
 
-   /* Per-Port Variables (802.1D-2004 6.4.3) */
-   MSTP_ADMIN_POINT_TO_POINT_MAC_t   adminPointToPointMAC;
+   /* State Machine Timers (802.1Q-REV/D5.0 13.21) */
+   uint8_t                          mdelayWhile;    /* a)                     */
+   uint8_t                          helloWhen;      /* b)                     */
+   uint8_t                          edgeDelayWhile; /* c)                     */
 
-   /* Per-Port State Machines states (802.1Q-REV/D5.0) */
-   MSTP_PTI_STATE_t                ptiState; /* 13.27 (802.1D-2004 17.22)    */
-   MSTP_PPM_STATE_t                ppmState; /* 13.29 (802.1D-2004 17.24)    */
-   MSTP_PRX_STATE_t                prxState; /* 13.28 (802.1D-2004 17.23)    */
-   MSTP_PTX_STATE_t                ptxState; /* 13.31 (802.1D-2004 17.26)    */
-   MSTP_BDM_STATE_t                bdmState; /* 13.30 (802.1D-2004 17.25)    */
+   /* Per-Port Variables (802.1Q-REV/D5.0 13.24) */
+   uint8_t                          txCount;        /* e)                     */
 
    /* Per-port BPDU Controls: BPDU-Filter; BPDU-Protection */
    uint8_t                          trapThrottleTimer;/* trap countdown timer */
    bool                           trapPending;  /* trap pending indication  */
    bool                           inBpduError;  /* TRUE if port received an
                                                   * unauthorized BPDU        */
+   bool                           rcvdSelfSentPkt;/* TRUE if this port RX-ed
+                                                    * self-sent (externally
+                                                    * looped-back) BPDU      */
    uint16_t                        reEnableTimer;/* seconds remaining until
                                                   * port in "inBpduError"
                                                   * state is reenabled       */
-   TRAP_SOURCE_TYPE_e              trapSource;   /* Indicates last trigger
-                                                  * of traps                 */
-   MAC_ADDRESS                     bpduSrcMac;   /* Src Mac of RXed Bpdu     */
-   uint32_t                         trapPortState;/* Stored port state at
-                                                  * time of trap trigger     */
+
+   /* State Machine Performance Parameters (802.1Q-REV/D5.0 13.37) */
+   uint16_t                        HelloTime;           /* g)                */
+
+   /* Per-Port State Machines states (802.1Q-REV/D5.0) */
+   MSTP_PTI_STATE_t                ptiState; /* 13.27 (802.1D-2004 17.22)    */
+   MSTP_PPM_STATE_t                ppmState; /* 13.29 (802.1D-2004 17.24)    */
+   MSTP_PRX_STATE_t                prxState; /* 13.28 (802.1D-2004 17.23)    */
+   MSTP_PTX_STATE_t                ptxState; /* 13.31 (802.1D-2004 17.26)    */
+   MSTP_BDM_STATE_t                bdmState; /* 13.30 (802.1D-2004 17.25)    */
+
+   /* Per-Port Variables (802.1D-2004 6.4.3) */
+   MSTP_ADMIN_POINT_TO_POINT_MAC_t   adminPointToPointMAC;
+
+   /* State Machine Performance Parameters (802.1Q-REV/D5.0 13.37) */
+   uint32_t                         ExternalPortPathCost;/* f)                */
+   bool                           useGlobalHelloTime;/* TRUE means use per
+                                                       * box Hello Time value*/
+   bool                           useCfgPathCost;/* indicates whether to use
+                                                   * user configured path cost
+                                                   * value or 'autodetect' it
+                                                   * from the link speed     */
 #ifdef MSTP_DEBUG
    bool                           dropBpdu;     /* When set to TRUE we drop
                                                   * BPDU on this port        */
 #endif /* MSTP_DEBUG */
 
-   /* Debug rate monitors: */
-   uint32_t                        dbxTxCnt;
+   /* Last accepted BPDU, used by the unchanged-BPDU receive fast path
+    * (see 'mstp_protocolData') */
+   bool                            rxCacheValid;
+   uint32_t                        rxCacheLen;
+   uint32_t                        rxCacheGen;   /* 'mstp_CB.rxCacheGen'
+                                                  * when cached           */
+   uint64_t                        rxCacheDigest;/* of the BPDU octets     */
+   uint64_t                        rxCacheSig;   /* of the port's state
+                                                  * after processing it   */
+   uint8_t                        *rxCacheBytes; /* the BPDU octets, a
+                                                  * repeat must match them
+                                                  * and not just the digest */
+   uint32_t                        rxCacheCap;   /* bytes allocated there  */
+
+   /*------------------------------------------------------------------------
+    * Cold part, starting on a cache line of its own: counters, trap and
+    * debugging data. A received BPDU writes only the first line of it, a
+    * transmitted one only the second, a timer tick none.
+    *------------------------------------------------------------------------*/
+
+   /* BPDU counters, indexed by 'MSTP_BPDU_TYPE_e'. Kept in memory and
+    * exported to the DB 'mstp_statistics' column every
+    * 'mstp_statsExportInterval' seconds (see 'mstp_util_export_bpdu_stats') */
+   uint64_t                        bpduRxCnt[MSTP_BPDU_TYPE_MAX]
+                                   MSTP_CACHE_ALIGNED;
+   /* Debug rate monitors (totals of all BPDU types, rates are BPDUs per
+    * second over the last export interval): */
+   uint64_t                        dbxRxCnt;
+   MAC_ADDRESS                     bpduSrcMac;   /* Src Mac of RXed Bpdu     */
+
+   uint64_t                        bpduTxCnt[MSTP_BPDU_TYPE_MAX]
+                                   MSTP_CACHE_ALIGNED;
+   uint64_t                        dbxTxCnt;
+
    uint32_t                        dbxTxRate;
-   uint32_t                        dbxRxCnt;
    uint32_t                        dbxRxRate;
+   uint64_t                        dbxTxCntPrev; /* at previous export    */
+   uint64_t                        dbxRxCntPrev;
+   bool                            statsExported;/* DB holds the values
+                                                  * below                  */
+   uint64_t                        statsTxExported;
+   uint64_t                        statsRxExported;
+   uint32_t                        statsTxRateExported;
+   uint32_t                        statsRxRateExported;
+   uint64_t                        statsPolicedExported;
+
+   /* Per-Port Variables (802.1Q-REV/D5.0 13.24) */
+   uint32_t                         ageingTime;     /* a) */
 
+   TRAP_SOURCE_TYPE_e              trapSource;   /* Indicates last trigger
+                                                  * of traps                 */
+   uint32_t                         trapPortState;/* Stored port state at
+                                                  * time of trap trigger     */
 
 } MSTP_COMM_PORT_INFO_t;
 
 /*---------------------------------------------------------------------------
  * MSTI specific information.
  *---------------------------------------------------------------------------*/
+/*---------------------------------------------------------------------------
+ * Result of the MSTI Root Priority Vector election, the first step of
+ * 'mstp_updtRolesMsti'
+ *---------------------------------------------------------------------------*/
+typedef struct MSTP_MSTI_ELECT_t
+{
+   MSTP_MSTI_ROOT_PRI_VECTOR_t       rootPriority;
+   MSTP_PORT_ID_t                    rootPortID;    /* 0 if this Bridge is
+                                                     * the Regional Root    */
+} MSTP_MSTI_ELECT_t;
+
 typedef struct MSTP_MSTI_INFO_t
 {
    /* Per-Port Parameters */
@@ -2809,6 +3060,11 @@ typedef struct MSTP_MSTI_INFO_t
    bool                              portStateChangeLog;/* Enable/disable port
                                                       bloc/unblock per VLAN */
    bool                              tcTrapControl;
+
+   /* Election done ahead by the MSTI worker pool, taken by the next
+    * 'mstp_updtRolesMsti' (see 'mstp_mstiPoolElect') */
+   bool                              electValid;
+   MSTP_MSTI_ELECT_t                 elect;
 } MSTP_MSTI_INFO_t;
 
 /*---------------------------------------------------------------------------
@@ -2899,6 +3155,15 @@ typedef struct MSTP_BRIDGE_INFO_t
                                                   * change occured that
                                                   * require re-initialization
                                                   * of MSTP                  */
+   bool                        dynReconfigScoped;/* indicates whether dynamic
+                                                  * change occured that
+                                                  * require restart of some
+                                                  * trees or ports only      */
+   bool                        dynReconfigTree[MSTP_INSTANCES_MAX + 1];
+                                                 /* trees to be restarted    */
+   PORT_MAP                     dynReconfigPorts[MSTP_INSTANCES_MAX + 1];
+                                                 /* ports to be restarted on
+                                                  * each tree                */
    PATH_COST_TYPE_e             defaultPathCosts;/* indicates whether default
                                                   * path costs from 802.1d or
                                                   * 802.1t are used          */
@@ -2923,6 +3188,22 @@ typedef struct MSTP_BRIDGE_INFO_t
 /*---------------------------------------------------------------------------
  * Multiple Spanning Tree Protocol (MSTP) Control block
  *---------------------------------------------------------------------------*/
+/* Decision to commit latency histogram of port state changes:
+ * bucket 0 is < 1 ms, bucket N (N > 0) is [2^(N-1), 2^N) ms and the last
+ * bucket collects everything above. */
+#define MSTP_DB_LATENCY_BUCKETS   12
+
+/* Unchanged-BPDU receive fast path modes */
+typedef enum
+{
+   MSTP_RX_FAST_PATH_OFF = 0,
+   MSTP_RX_FAST_PATH_ON,
+   MSTP_RX_FAST_PATH_STRICT,  /* take the full path and verify that the
+                               * fast one would have had the same result */
+   MSTP_RX_FAST_PATH_MAX
+
+} MSTP_RX_FAST_PATH_MODE_e;
+
 typedef struct MSTP_CB /* MSTP Control Block */
 {
    PORT_MAP         fwdLports;/* lports that we have told IDL are
@@ -2941,6 +3222,43 @@ typedef struct MSTP_CB /* MSTP Control Block */
    /* to collect max number of transmitted BPDUs (per second) */
    uint32_t         txBpduCnt;
    uint32_t         txBpduWm;
+   /* MAC address flush aggregation. The flushes written and the port
+    * state cells committed to DB are counted by the OVSDB thread in the
+    * DB outbox stats (MSTP_DB_OUTBOX_STATS_t). */
+   uint64_t         flushReqCnt;  /* (tree, lport) flush requests queued by
+                                   * 'mstp_flush'                          */
+   /* tree message slots */
+   uint64_t         treeMsgSlotUseCnt; /* slot activations, each one used
+                                        * to be a 'calloc'                */
+   uint32_t         treeMsgSlotUseCur; /* activations since last drain    */
+   uint32_t         treeMsgSlotUseLast;/* activations of the last drained
+                                        * convergence burst               */
+   uint32_t         treeMsgSlotUseWm;  /* high water mark of the above    */
+   uint32_t         treeMsgDrainCnt;   /* bursts drained to DB            */
+   /* unchanged-BPDU receive fast path */
+   uint32_t         rxCacheGen;        /* bumped to drop all cached BPDUs */
+   uint64_t         rxFastHitCnt;      /* BPDUs handled by the fast path  */
+   uint64_t         rxFastMissCnt;     /* BPDUs that took the full path   */
+   uint64_t         rxFastStrictCnt;   /* fast path hits verified against
+                                        * the full path (strict mode)     */
+   uint64_t         rxFastMismatchCnt; /* verifications that failed       */
+   /* BPDU batch drain */
+   bool             rxBatchOpen;       /* BPDUs being processed with TX
+                                        * prevented and DB update deferred */
+   uint32_t         rxBatchSize;       /* BPDUs in the open batch         */
+   uint64_t         rxBatchStartUsec;  /* when the open batch started     */
+   uint64_t         rxBatchCnt;        /* batches closed                  */
+   uint64_t         rxBatchBpduCnt;    /* BPDUs processed in batches      */
+   uint32_t         rxBatchWm;         /* largest batch                   */
+   uint32_t         rxBatchCapCnt;     /* batches closed at the size cap  */
+   uint32_t         rxBatchTimeCnt;    /* batches closed at the time bound*/
+   /* dynamic reconfiguration, by scope of the re-initialization */
+   uint64_t         dynReconfigFullCnt;  /* protocol re-initializations   */
+   uint64_t         dynReconfigTreeCnt;  /* trees restarted               */
+   uint64_t         dynReconfigPortCnt;  /* (tree, lport) restarts        */
+   uint64_t         dynReconfigLastUsec; /* time taken by the last tree or
+                                          * port restart                  */
+   uint64_t         dynReconfigMaxUsec;  /* worst of the above            */
 
 } MSTP_CB_t;
 
@@ -3068,8 +3386,6 @@ typedef struct MSTP_MSTI_CONFIG_MSG_t
 /*****************************************************************************
  *        MSTP Debug support
  *****************************************************************************/
-#ifdef MSTP_DEBUG
-
 typedef enum
 {
    MSTP_PIM = 1,
@@ -3086,6 +3402,8 @@ typedef enum
 
 } MSTP_SM_TYPE_e;
 
+#ifdef MSTP_DEBUG
+
 typedef struct MSTP_SM_MAP
 {
    uint32_t sm_map[((MSTP_SM_MAX_BIT + 31)/32)];
@@ -3194,6 +3512,7 @@ MSTP_MSTI_PORT_INFO_t *
             mstp_initMstiPortData(MSTID_t mstid, LPORT_t lport, bool init);
 MSTP_CIST_PORT_INFO_t *
             mstp_initCistPortData(LPORT_t lport, bool init);
+void mstp_reinitTreeData(MSTID_t mstid);
 void mstp_clearProtocolData(void);
 void mstp_clearBridgeMstiData(MSTID_t mstid);
 void mstp_clearMstiPortData(MSTID_t mstid, LPORT_t lport);
@@ -3221,8 +3540,13 @@ bool mstp_isTopologyChange(MSTID_t mstid);
 int  mstp_getCistUptime(LPORT_t lport);
 int  mstp_getMstiUptime(MSTID_t mstid, LPORT_t lport);
 void mstp_portAutoDetectParamsSet(LPORT_t lport, SPEED_DPLX *pSpeed);
+void mstp_lportCostUpdate(LPORT_t lport, SPEED_DPLX *speedDplx, bool isLag,
+                          bool linkUp);
+void mstp_lportCostTick(void);
+void mstp_lportCostGet(LPORT_t lport, MSTP_LPORT_COST_t *cost);
 MSTP_BPDU_TYPE_t
             mstp_getBpduType(MSTP_RX_PDU *pkt);
+void mstp_rxPduClassify(MSTP_RX_PDU *pkt);
 VLAN_GROUP_t
             mstp_mapMstIdToVlanGroupNum(MSTID_t mstid);
 void mstp_unmapMstIdFromVlanGroupNum(MSTID_t mstid);
@@ -3237,6 +3561,14 @@ bool mstp_rcvdAnyMsgCondition(LPORT_t lport);
 void mstp_preventTxOnBridge(void);
 void mstp_doPendingTxOnBridge(void);
 void mstp_buildMstConfigurationDigest(uint8_t  *cfgDigest);
+void mstp_buildMstConfigurationTable(MSTID_t *mstCfgTable);
+void mstp_mstConfigurationTableDigest(const MSTID_t *mstCfgTable,
+                                      uint8_t *digest);
+void mstp_mstiVidTableChg(void);
+void mstp_digestCacheStatsGet(uint64_t *calcCnt, uint64_t *reuseCnt);
+bool mstp_mstConfigurationDigestBench(uint32_t count, uint64_t *keyedUsec,
+                                      uint64_t *plainUsec,
+                                      uint64_t *cachedUsec, uint8_t *digest);
 MSTID_t
             mstp_getMstIdForVlan(VID_t vlan);
 MSTP_MSTI_CONFIG_MSG_t *
@@ -3244,6 +3576,9 @@ MSTP_MSTI_CONFIG_MSG_t *
                                           MSTP_MSTI_CONFIG_MSG_t *current);
 MSTP_TREE_MSG_t *
             mstp_findMstiPortStateChgMsg(MSTID_t mstid);
+MSTP_TREE_MSG_t *
+            mstp_getMstiPortStateChgMsg(MSTID_t mstid);
+void mstp_releaseMstiPortStateChgMsg(MSTP_TREE_MSG_t *m);
 void mstp_disableForwarding(MSTID_t mstid, LPORT_t lport);
 void mstp_disableLearning(MSTID_t mstid, LPORT_t lport);
 void mstp_enableForwarding(MSTID_t msti, LPORT_t lport);
@@ -3277,6 +3612,10 @@ void mstp_recordProposal(MSTP_RX_PDU *pkt, MSTID_t mstid, LPORT_t lport);
 void mstp_recordPriority(MSTID_t mstid,  LPORT_t lport);
 void mstp_recordTimes(MSTID_t mstid,  LPORT_t lport);
 void mstp_setRcvdMsgs(MSTP_RX_PDU *pkt, LPORT_t lport);
+uint32_t mstp_rxBpduCount(MSTP_RX_PDU *pkt, LPORT_t lport, bool apply);
+uint64_t mstp_rxPortCntSum(LPORT_t lport);
+void mstp_mstRgnCfgConsistencyCheck(MSTP_MST_BPDU_t *bpdu, LPORT_t lport);
+bool mstp_rcvdMsgIsInferior(MSTID_t mstid, LPORT_t lport);
 void mstp_setReRootTree(MSTID_t mstid);
 void mstp_setSelectedTree(MSTID_t mstid);
 void mstp_setSyncTree(MSTID_t mstid);
@@ -3298,6 +3637,136 @@ bool mstp_isPortRoleSetOnAnyTree(LPORT_t lport, MSTP_PORT_ROLE_t role);
 void mstp_informOtherSubsystems(uint32_t operation);
 void
 mstp_informDBOnPortStateChange(uint32_t operation);
+void mstp_invalidateDBPortState(MSTID_t mstid, LPORT_t lport);
+void mstp_updtMstiPortStateChgMsg(MSTID_t mstid, LPORT_t lport,
+                                  MSTP_ACT_TYPE_t state);
+bool mstp_setRxBatchLimits(uint32_t maxBpdus, uint32_t maxUsec);
+void mstp_getRxBatchLimits(uint32_t *maxBpdus, uint32_t *maxUsec);
+void mstp_rxPolicerConfig(LPORT_t lport, uint32_t rate, uint32_t burst);
+void mstp_rxPolicerStatsGet(LPORT_t lport, MSTP_RX_POLICER_STATS_t *stats);
+void mstp_rxPolicerStatsClear(LPORT_t lport);
+uint64_t mstp_rxPolicerDropCnt(LPORT_t lport);
+void mstp_rxSockStatsGet(LPORT_t lport, MSTP_RX_SOCK_STATS_t *stats);
+void mstp_rxSockStatsClear(LPORT_t lport);
+uint64_t mstp_utilMonoUsec(void);
+void mstp_mstiRootElect(MSTID_t mstid, MSTP_MSTI_ELECT_t *elect);
+/*
+ * mstpd_ckpt.c
+ */
+typedef struct mstp_ckpt_stats
+{
+   uint32_t interval;                    /* seconds, 0 if off            */
+   uint32_t grace;                       /* seconds                      */
+   bool     warm;                        /* started from a checkpoint    */
+   uint64_t ckptAgeUsec;                 /* its age at start             */
+   uint32_t heldPorts;                   /* ports it covered             */
+   uint32_t restoredPorts;
+   uint32_t restoredCells;               /* (tree, port) pairs restored  */
+   uint32_t skippedPorts;                /* no longer matching the config */
+   uint32_t releasedPorts;               /* not enabled within the grace */
+   uint64_t stableUsec;                  /* start to last port restored
+                                          * or released, 0 while pending */
+   uint64_t writeCnt;                    /* checkpoints written          */
+   uint32_t lastEntries;                 /* cells in the last one        */
+   uint64_t lastWriteUsec;               /* time taken to write it       */
+   uint64_t maxWriteUsec;
+
+} MSTP_CKPT_STATS_t;
+
+bool mstp_ckptWarmStart(void);
+void mstp_ckptRestorePort(LPORT_t lport);
+void mstp_ckptHoldMask(MSTP_TREE_MSG_t *m);
+void mstp_ckptTick(void);
+bool mstp_ckptSetInterval(uint32_t interval);
+bool mstp_ckptSetGrace(uint32_t grace);
+void mstp_ckptStatsGet(MSTP_CKPT_STATS_t *stats);
+/*
+ * mstpd_msti_pool.c
+ */
+typedef struct mstp_msti_pool_stats
+{
+   uint32_t workers;                     /* threads wanted               */
+   uint32_t running;                     /* threads started              */
+   uint64_t runCnt;                      /* parallel elections run       */
+   uint64_t electCnt;                    /* MSTIs elected by them        */
+   uint64_t workerElectCnt;              /* of those, by the workers     */
+   uint64_t lastUsec;                    /* duration of the last run     */
+   uint64_t maxUsec;
+   uint64_t totalUsec;
+   uint64_t syncCnt;                     /* boundary port syncs, pool on
+                                          * or off                       */
+   uint64_t syncLastUsec;                /* election and role selection  */
+   uint64_t syncMaxUsec;
+   uint64_t syncTotalUsec;
+
+} MSTP_MSTI_POOL_STATS_t;
+
+bool mstp_mstiPoolSetWorkers(uint32_t workers);
+void mstp_mstiPoolStatsGet(MSTP_MSTI_POOL_STATS_t *stats, bool reset);
+void mstp_mstiPoolElect(const MSTID_t *mstids, int count);
+void mstp_mstiPoolElectDone(const MSTID_t *mstids, int count);
+void mstp_mstiPoolSyncRecord(uint64_t usec);
+/*
+ * mstpd_port_arena.c
+ */
+typedef struct mstp_port_arena_stats
+{
+   uint32_t ports;                       /* ports allocated              */
+   uint32_t chunks;                      /* chunks backing them          */
+   uint64_t hotBytes;                    /* state machine data           */
+   uint64_t coldBytes;                   /* debug counters and history   */
+
+} MSTP_PORT_ARENA_STATS_t;
+
+MSTP_CIST_PORT_INFO_t *mstp_portArenaCistAlloc(LPORT_t lport);
+MSTP_MSTI_PORT_INFO_t *mstp_portArenaMstiAlloc(MSTID_t mstid, LPORT_t lport);
+void mstp_portArenaFree(MSTID_t mstid, LPORT_t lport);
+void mstp_portArenaStatsGet(MSTID_t mstid, MSTP_PORT_ARENA_STATS_t *stats);
+MSTP_COMM_PORT_INFO_t *mstp_portArenaCommAlloc(void);
+void mstp_portArenaCommFree(MSTP_COMM_PORT_INFO_t *commPortPtr);
+/*
+ * mstpd_rgn_plan.c
+ */
+typedef struct mstp_rgn_plan
+{
+   MSTP_MST_CONFIGURATION_ID_t cur;      /* revision in host order, the   */
+   MSTP_MST_CONFIGURATION_ID_t plan;     /* digests are filled in         */
+   MSTID_t  curTable[MSTP_MST_CFG_TBL_SIZE];  /* MSTIDs in network order */
+   MSTID_t  planTable[MSTP_MST_CFG_TBL_SIZE];
+
+} MSTP_RGN_PLAN_t;
+
+typedef struct mstp_rgn_plan_result
+{
+   uint32_t movedVids;                   /* VIDs mapped to another tree  */
+   uint32_t vidsIn[MSTP_INSTANCES_MAX + 1];   /* gained per tree         */
+   uint32_t vidsOut[MSTP_INSTANCES_MAX + 1];  /* lost per tree           */
+   PORT_MAP peerPorts;                   /* a neighbour's MST BPDU heard */
+   PORT_MAP boundaryCur;                 /* of those, boundary now       */
+   PORT_MAP boundaryPlan;                /* and with the plan            */
+   uint64_t evalUsec;
+
+} MSTP_RGN_PLAN_RESULT_t;
+
+void mstp_rgnPeerSave(LPORT_t lport, const MSTP_MST_CONFIGURATION_ID_t *cfgId);
+bool mstp_rgnPeerGet(LPORT_t lport, MSTP_MST_CONFIGURATION_ID_t *cfgId,
+                     uint32_t *ageSec);
+void mstp_rgnPlanEval(MSTP_RGN_PLAN_t *plan, MSTP_RGN_PLAN_RESULT_t *res);
+/*
+ * mstpd_sm_rec.c
+ */
+void mstp_smRecord(int sm, int mstid, int lport, const char *oldState,
+                   const char *newState);
+void mstp_smRecSetCause(uint32_t msgType);
+void mstp_smRecDump(struct ds *ds, uint32_t count);
+/*
+ * mstpd_trace.c
+ */
+bool mstp_traceIsEnabled(void);
+void mstp_traceRx(MSTP_RX_PDU *pkt);
+void mstp_traceDequeue(uint32_t msgType, const MSTP_RX_PDU *pkt);
+void mstp_traceRoleChange(MSTID_t mstid, LPORT_t lport, MSTP_PORT_ROLE_t role);
+void mstp_traceForwarding(MSTID_t mstid, LPORT_t lport, bool enable);
 void mstp_updateCstRootHistory (MSTP_BRIDGE_IDENTIFIER_t rootID);
 void mstp_updateIstRootHistory (MSTP_BRIDGE_IDENTIFIER_t rgnRootID);
 void mstp_updateMstiRootHistory(MSTID_t mstid,
@@ -3418,9 +3887,14 @@ bool mstpValidTcHistory(bool originated, MSTID_t mstid,
                         uint8_t  idx);
 void intf_get_port_name(LPORT_t lport, char *port_name);
 bool intf_get_lport_speed_duplex(LPORT_t lport, SPEED_DPLX *sd);
+bool intf_get_lport_mac(LPORT_t lport, MAC_ADDRESS mac);
 int mstp_util_get_valid_l2_ports(const struct ovsrec_bridge *bridge_row);
 
 void mstp_protocolData(MSTP_RX_PDU *msg);
+void mstp_rxBpduCacheInvalidate(void);
+bool mstp_setRxFastPathMode(MSTP_RX_FAST_PATH_MODE_e mode);
+MSTP_RX_FAST_PATH_MODE_e mstp_getRxFastPathMode(void);
+const char *mstp_rxFastPathModeStr(MSTP_RX_FAST_PATH_MODE_e mode);
 void mstp_errantProtocolData(MSTP_RX_PDU *msg, TRAP_SOURCE_TYPE_e source);
 void mstp_processUnauthorizedBpdu(MSTP_RX_PDU *msg, TRAP_SOURCE_TYPE_e source);
 void mstp_convertPortRoleEnumToString(MSTP_PORT_ROLE_t role,char *string);
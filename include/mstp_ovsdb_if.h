@@ -22,19 +22,80 @@
 
 struct ovsdb_idl *idl;
 bool exiting;
-void util_mstp_status_statistics_clean();
+void util_mstp_bootstrap(void);
 pthread_mutex_t ovsdb_mutex;
-/* Macros to lock and unlock mutexes in a verbose manner. */
+/* Zero if the port or interface name 's' is the one of a LAG */
+#define VERIFY_LAG_IFNAME(s) strncasecmp(s, "lag", 3)
+/* Macros to lock and unlock mutexes in a verbose manner. Each
+ * MSTP_OVSDB_LOCK is a call site of its own for the lock profiler. */
 #define MSTP_OVSDB_LOCK { \
+                static MSTP_LOCK_SITE_t mstp_lock_site_ = \
+                    MSTP_LOCK_SITE_INITIALIZER(__FUNCTION__, __LINE__); \
                 VLOG_DBG("%s(%d): MSTP_OVSDB_LOCK: taking lock...", __FUNCTION__, __LINE__); \
-                pthread_mutex_lock(&ovsdb_mutex); \
+                mstp_ovsdbLock(&mstp_lock_site_); \
 }
 
 #define MSTP_OVSDB_UNLOCK { \
                 VLOG_DBG("%s(%d): MSTP_OVSDB_UNLOCK: releasing lock...", __FUNCTION__, __LINE__); \
-                pthread_mutex_unlock(&ovsdb_mutex); \
+                mstp_ovsdbUnlock(); \
 }
 
+/* Threads of the daemon, as seen by the ovsdb_mutex accounting */
+typedef enum mstp_thread_role {
+    MSTP_THREAD_OTHER = 0,
+    MSTP_THREAD_OVSDB,
+    MSTP_THREAD_PROTOCOL,
+    MSTP_THREAD_RX,
+    MSTP_THREAD_MAX
+} MSTP_THREAD_ROLE_t;
+
+/* ovsdb_mutex use by one thread role */
+typedef struct mstp_ovsdb_lock_stats {
+    uint64_t acquireCnt;
+    uint64_t timedCnt;              /* taken while the profiler was enabled */
+    uint64_t waitNsTotal;
+    uint64_t waitNsMax;
+    uint64_t holdNsTotal;
+    uint64_t holdNsMax;
+} MSTP_OVSDB_LOCK_STATS_t;
+
+/*---------------------------------------------------------------------------
+ * Lock profiler: per MSTP_OVSDB_LOCK call site acquisition count and wait
+ * and hold time histograms. Bucket 0 counts 0 ns, bucket i (i > 0) counts
+ * [2^(i-1), 2^i) ns, the last bucket everything above. Disabled by
+ * default, the sites are only timed and linked in while it is enabled.
+ * The counters are updated with ovsdb_mutex held.
+ *---------------------------------------------------------------------------*/
+#define MSTP_LOCK_HIST_BUCKETS  32
+
+typedef struct mstp_lock_site {
+    const char *func;
+    int line;
+    bool registered;
+    struct mstp_lock_site *next;
+    uint64_t acquireCnt;
+    uint64_t waitNsTotal;
+    uint64_t waitNsMax;
+    uint64_t holdNsTotal;
+    uint64_t holdNsMax;
+    uint32_t waitHist[MSTP_LOCK_HIST_BUCKETS];
+    uint32_t holdHist[MSTP_LOCK_HIST_BUCKETS];
+} MSTP_LOCK_SITE_t;
+
+#define MSTP_LOCK_SITE_INITIALIZER(FUNC, LINE) \
+    { .func = (FUNC), .line = (LINE) }
+
+void mstp_ovsdbLock(MSTP_LOCK_SITE_t *site);
+void mstp_lockProfSetEnabled(bool enable);
+bool mstp_lockProfIsEnabled(void);
+int mstp_lockProfGet(MSTP_LOCK_SITE_t **sites, bool reset);
+void mstp_ovsdbUnlock(void);
+void mstp_setThreadRole(MSTP_THREAD_ROLE_t role);
+MSTP_THREAD_ROLE_t mstp_getThreadRole(void);
+const char *mstp_threadRoleName(MSTP_THREAD_ROLE_t role);
+void mstp_ovsdbLockStatsGet(MSTP_OVSDB_LOCK_STATS_t stats[MSTP_THREAD_MAX],
+                            bool reset);
+
 /**************************************************************************//**
  * mstpd daemon's main OVS interface function.
  *
@@ -42,6 +103,22 @@ pthread_mutex_t ovsdb_mutex;
  *
  *****************************************************************************/
 
+/*************************************************************************//**
+ * @ingroup mstpd_ovsdb_if
+ * @brief Interface attributes the protocol thread needs, sent to it in an
+ * e_mstpd_lport_info message whenever they change. The protocol thread
+ * keeps its own copy and never looks at the IDL for them.
+ * ****************************************************************************/
+typedef struct mstp_lport_info {
+    int                 lportindex;
+    char                lportname[PORTNAME_LEN];
+    MAC_ADDRESS         mac;                /*!< MSTPDU source MAC address */
+    bool                mac_valid;
+    bool                link_up;
+    uint32_t            link_speed;         /*!< Mbps */
+    PORT_DUPLEX         duplex;
+} mstp_lport_info;
+
 /*************************************************************************//**
  * @ingroup mstpd_ovsdb_if
  * @brief mstpd's internal data strucuture to store per interface data.
@@ -58,6 +135,8 @@ struct iface_data {
     bool                pdu_registered;     /*!< Indicates if port is registered to receive MSTPDU */
     enum ovsrec_interface_link_state_e link_state; /*!< operational link state */
     PORT_DUPLEX duplex;  /*!< operational link duplex */
+    bool                info_sent_valid;    /*!< info_sent below has been sent */
+    mstp_lport_info     info_sent;          /*!< Last attributes sent to the protocol thread */
 };
 
 struct mstp_cist_data {
@@ -107,6 +186,7 @@ typedef struct mstp_global_config {
     char config_name[MSTP_MAX_CONFIG_NAME_LEN];
     uint32_t config_revision;
     char config_digest[100];
+    char system_mac[MSTP_MAC_STR_LEN];
 } mstp_global_config;
 
 typedef struct mstp_msti_config {
@@ -257,6 +337,146 @@ typedef struct msti_port_table_string{
     void (* ovsrec_func)(const struct ovsrec_mstp_instance_port *, const char *);
 } msti_port_table_string;
 
+/* Port state value of a (tree, port) cell propagated to DB */
+typedef enum mstp_db_port_state {
+    MSTP_DB_PORT_STATE_NONE = 0,     /* unknown / not written yet */
+    MSTP_DB_PORT_STATE_BLOCKING,
+    MSTP_DB_PORT_STATE_LEARNING,
+    MSTP_DB_PORT_STATE_FORWARDING
+} MSTP_DB_PORT_STATE_t;
+
+/* Value of the 'block_all_mstp' port hw_config key */
+typedef enum mstp_db_block_all {
+    MSTP_DB_BLOCK_ALL_NONE = 0,      /* unknown / not written yet */
+    MSTP_DB_BLOCK_ALL_OFF,
+    MSTP_DB_BLOCK_ALL_ON
+} MSTP_DB_BLOCK_ALL_t;
+
+typedef struct mstp_db_port_state_vec {
+    uint8_t state[MSTP_INSTANCES_MAX+1][MAX_LPORTS+1]; /* MSTP_DB_PORT_STATE_t */
+    uint8_t blockAll[MAX_LPORTS+1];                    /* MSTP_DB_BLOCK_ALL_t */
+} MSTP_DB_PORT_STATE_VEC_t;
+
+/* BPDU counters and rates of a port for the 'mstp_statistics' column */
+typedef struct mstp_db_port_stats {
+    uint64_t txCnt;
+    uint64_t rxCnt;
+    uint32_t txRate;
+    uint32_t rxRate;
+    uint64_t policedCnt;    /* BPDUs dropped by the ingress policer */
+} MSTP_DB_PORT_STATS_t;
+
+/*---------------------------------------------------------------------------
+ * DB outbox (mstpd_db_outbox.c).
+ *
+ * The protocol thread never touches the IDL. What it has to write is
+ * staged privately (the 'mstp_util_set_*' setters, port state vector,
+ * MAC flush, BPDU statistics) and handed to the OVSDB thread at the end of
+ * each event as one batch; batches that carry no job are merged into the
+ * last queued one, last value of a cell wins. Operations that need to look
+ * at or create rows are posted as jobs and run by the OVSDB thread, in
+ * posting order and before the cells staged after them.
+ *---------------------------------------------------------------------------*/
+typedef enum mstp_db_job {
+    MSTP_DB_JOB_PORT_ADD = 0,       /* create the port's instance rows */
+    MSTP_DB_JOB_PORT_DELETE,        /* remove the port's instance rows */
+    MSTP_DB_JOB_VLAN_ADD,           /* VLANs to CIST mapping */
+    MSTP_DB_JOB_PORT_ENABLE,        /* port hw_config 'enable' */
+    MSTP_DB_JOB_PORT_DISABLE,
+    MSTP_DB_JOB_ALL_FORWARD,        /* all instance ports to forwarding */
+    MSTP_DB_JOB_CONFIG_RELOAD,      /* re-read and re-send the config */
+    MSTP_DB_JOB_VLAN_DELETE,        /* VLANs out of the instances */
+    MSTP_DB_JOB_MAX
+} MSTP_DB_JOB_t;
+
+typedef struct mstp_db_outbox_stats {
+    uint64_t handoffCnt;            /* protocol thread hand-offs */
+    uint64_t mergeCnt;              /* hand-offs merged into a queued batch */
+    uint64_t cellCnt;               /* cells staged */
+    uint64_t cellCoalescedCnt;      /* cells overwritten before written */
+    uint64_t jobCnt[MSTP_DB_JOB_MAX];
+    uint64_t vlanCnt;               /* VLANs carried by the VLAN jobs */
+    uint64_t applyCnt;              /* batches applied by the OVSDB thread */
+    uint64_t txnCnt;
+    uint64_t txnFailedCnt;          /* transactions not committed */
+    uint64_t missedCnt;             /* cells dropped for a missing row */
+    uint32_t backlogWm;             /* most batches queued at a time */
+    uint64_t applyMaxUsec;
+    uint64_t flushPortCnt;          /* port flushes written after the
+                                     * requests have been coalesced */
+    uint64_t flushTxnCnt;           /* transactions that carried flushes */
+    uint64_t stateCellCnt;          /* port state cells committed */
+    uint64_t stateTxnCnt;           /* transactions that committed them */
+    uint64_t latencyMaxUsec;        /* worst decision to commit time */
+    uint32_t latencyHist[MSTP_DB_LATENCY_BUCKETS];
+} MSTP_DB_OUTBOX_STATS_t;
+
+/*---------------------------------------------------------------------------
+ * What became of the port state and 'block_all_mstp' cells handed to the
+ * OVSDB thread since the protocol thread last asked. 'vec' holds the value
+ * last written (or tried) for every cell set in the maps below.
+ *---------------------------------------------------------------------------*/
+typedef struct mstp_db_port_state_result {
+    MSTP_DB_PORT_STATE_VEC_t vec;
+    PORT_MAP stateCommitted[MSTP_INSTANCES_MAX+1]; /* in DB now */
+    PORT_MAP blockCommitted;
+    PORT_MAP stateFailed[MSTP_INSTANCES_MAX+1];    /* commit failed, the
+                                                    * cell must be written
+                                                    * again */
+    PORT_MAP blockFailed;
+    PORT_MAP stateMissed[MSTP_INSTANCES_MAX+1];    /* no row to write to */
+    PORT_MAP blockMissed;
+} MSTP_DB_PORT_STATE_RESULT_t;
+
+void mstp_dbOutboxInit(void);
+void mstp_dbOutboxPostJob(MSTP_DB_JOB_t job, int arg, const char *name);
+void mstp_dbOutboxPostVlanJob(MSTP_DB_JOB_t job, const VID_MAP *vids);
+void mstp_dbOutboxStagePortStates(const MSTP_DB_PORT_STATE_VEC_t *vec,
+                                  const PORT_MAP *stateChg,
+                                  const PORT_MAP *blockChg,
+                                  const PORT_MAP *flushPorts,
+                                  const uint64_t *decisionTime,
+                                  int numDecisions);
+void mstp_dbOutboxStageStats(LPORT_t lport, const MSTP_DB_PORT_STATS_t *stats);
+bool mstp_dbOutboxTakeResult(MSTP_DB_PORT_STATE_RESULT_t *result);
+void mstp_dbOutboxCommit(void);
+void mstp_dbOutboxRun(void);
+void mstp_dbOutboxWait(void);
+void mstp_dbOutboxStatsGet(MSTP_DB_OUTBOX_STATS_t *stats, uint32_t *backlog);
+
+/*---------------------------------------------------------------------------
+ * Config mailbox (mstpd_cfg_mailbox.c).
+ *
+ * The other way round: the config updates of the OVSDB thread wait in a
+ * batch keyed by (table, MSTI, port), where a newer update of a key
+ * overwrites the pending one, and the protocol thread applies the batch
+ * in one pass on a single e_mstpd_config_batch event.
+ *---------------------------------------------------------------------------*/
+typedef struct mstp_cfg_mbox_stats {
+    uint64_t putCnt;                /* updates put by the OVSDB thread */
+    uint64_t coalescedCnt;          /* ... overwritten or dropped while
+                                     * pending */
+    uint64_t batchCnt;              /* batches opened */
+    uint64_t deliverCnt;            /* e_mstpd_config_batch events applied */
+    uint64_t appliedCnt;            /* updates applied */
+    uint64_t droppedCnt;            /* events dropped by a config reload */
+    uint32_t maxBatch;              /* most updates applied in one pass */
+    uint64_t lastUsec;
+    uint64_t maxUsec;
+} MSTP_CFG_MBOX_STATS_t;
+
+void mstp_cfgMboxPut(uint32_t type, const void *data, size_t len);
+void mstp_cfgMboxSeal(void);
+void mstp_cfgMboxDeliver(uint64_t seq, bool apply);
+void mstp_cfgMboxReset(void);
+void mstp_cfgMboxStatsGet(MSTP_CFG_MBOX_STATS_t *stats, uint32_t *pending,
+                          bool reset);
+bool mstp_traceCommitPublish(const PORT_MAP written[],
+                             const MSTP_DB_PORT_STATE_VEC_t *vec,
+                             PORT_MAP stamped[]);
+void mstp_traceCommitDone(const PORT_MAP stamped[],
+                          const MSTP_DB_PORT_STATE_VEC_t *vec);
+
 
 struct mstp_global_config mstp_global_conf;
 struct mstp_cist_config mstp_cist_conf;
@@ -270,9 +490,10 @@ void *mstpd_ovs_main_thread(void *arg);
 // Utility functions
 struct iface_data *find_iface_data_by_index(int index);
 struct iface_data *find_iface_data_by_name(char *name);
-const char * intf_get_mac_addr(uint16_t lport);
 void system_get_mac_addr(const char *mac_buffer);
-void update_mstp_counters(LPORT_t lport, const char *key);
+bool mstp_util_set_stats_interval(uint32_t seconds);
+uint32_t mstp_util_get_stats_interval(void);
+void mstp_util_export_bpdu_stats(void);
 int mstp_cist_config_update();
 int mstp_cist_port_config_update();
 int mstp_msti_update_config();
@@ -284,24 +505,45 @@ void clear_mstp_cist_port_config();
 void clear_mstp_msti_config();
 void clear_mstp_msti_port_config();
 void mstp_config_reinit();
+void mstp_config_reload(void);
+/* Protocol thread: staged in the DB outbox */
 void mstp_util_set_cist_port_table_bool (const char *if_name, const char *key,const bool value);
 void mstp_util_set_cist_table_value (const char *key, int64_t value);
 void mstp_util_set_cist_table_string (const char *key, const char *string);
 void mstp_util_set_cist_port_table_value (const char *if_name, const char *key, int64_t value);
 void mstp_util_set_cist_port_table_string (const char *if_name, const char *key, char *string);
-void mstp_util_cist_flush_mac_address(const char * port_name);
 void mstp_util_set_msti_table_string (const char *key, const char *string, int mstid);
 void mstp_util_set_msti_table_value (const char *key, int64_t value, int mstid);
 void mstp_util_set_msti_port_table_value (const char *key, int64_t value, int mstid, int lport);
 void mstp_util_set_msti_port_table_string (const char *key, char *string, int mstid, int lport);
-void mstp_util_msti_flush_mac_address(int mstid,int lport);
-void handle_vlan_add_in_mstp_config(int vlan);
-void handle_vlan_delete_in_mstp_config(int vlan);
+void mstp_util_set_bridge_status (const char *key, const char *string);
+/* OVSDB thread: caller holds MSTP_OVSDB_LOCK and owns the transaction */
+bool mstp_util_write_cist_port_table_bool (const char *if_name, const char *key,const bool value);
+bool mstp_util_write_cist_table_value (const char *key, int64_t value);
+bool mstp_util_write_cist_table_string (const char *key, const char *string);
+bool mstp_util_write_cist_port_table_value (const char *if_name, const char *key, int64_t value);
+bool mstp_util_write_cist_port_table_string (const char *if_name, const char *key, const char *string);
+bool mstp_util_write_msti_table_string (const char *key, const char *string, int mstid);
+bool mstp_util_write_msti_table_value (const char *key, int64_t value, int mstid);
+bool mstp_util_write_msti_port_table_value (const char *key, int64_t value, int mstid, int lport);
+bool mstp_util_write_msti_port_table_string (const char *key, const char *string, int mstid, int lport);
+bool mstp_util_write_bridge_status (const char *key, const char *string);
+uint32_t mstp_util_write_bpdu_stats(const PORT_MAP *ports,
+                                    const MSTP_DB_PORT_STATS_t *stats);
+uint32_t mstp_util_flush_mac_address_ports(const PORT_MAP *flushPorts);
+uint32_t mstp_util_set_port_state_vector(const MSTP_DB_PORT_STATE_VEC_t *vec,
+                                         PORT_MAP *stateChg,
+                                         PORT_MAP *blockChg);
+void mstp_updatePortStateToForward(void);
+void handle_vlan_add_in_mstp_config(const VID_MAP *vids);
+void handle_vlan_delete_in_mstp_config(const VID_MAP *vids);
 void update_port_entry_in_cist_mstp_instances(char *name, int operation);
 void update_port_entry_in_msti_mstp_instances(char *name, int operation);
 void update_mstp_on_lport_add(int lport);
 bool is_lport_down(int lport);
 bool is_lport_up(int lport);
+void mstp_lportInfoUpdate(const mstp_lport_info *info);
+void mstp_systemMacUpdate(const char *mac);
 void disable_logical_port(int lport);
 void enable_logical_port(int lport);
 void enable_or_disable_port(int lport,bool enable);
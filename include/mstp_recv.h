@@ -26,9 +26,26 @@
 */
 #define MAX_MSTP_BPDU_PKT_SIZE 1147
 
+/* MSTIDs 1..64 as carried in MSTI Configuration Messages, index 0 unused */
+#define MSTP_RX_PDU_MSTI_IDX_MAX 65
+
+/* Pre-parsed view of a received BPDU. Filled in by the RX thread
+ * ('mstp_rxPduClassify') before the PDU is queued to the protocol thread,
+ * which then skips re-parsing the packet. Ignored unless 'valid' is set. */
+typedef struct mstp__rxPduDesc {
+    uint8_t   valid;
+    uint8_t   bpduType;     /* MSTP_BPDU_TYPE_e, UNKNOWN if BPDU is invalid */
+    uint8_t   mstiMsgCnt;   /* number of MSTI Configuration Messages        */
+    uint8_t   mstiMsgIdx[MSTP_RX_PDU_MSTI_IDX_MAX]; /* position + 1 of the
+                                                     * message for MSTID,
+                                                     * 0 if not carried     */
+}MSTP_RX_PDU_DESC;
+
 typedef struct mstp__rxPdu {
     uint32_t  pktLen;
     uint32_t  lport;
+    uint64_t  traceId;      /* convergence trace event, 0 if not traced */
+    MSTP_RX_PDU_DESC desc;
     unsigned char data[MAX_MSTP_BPDU_PKT_SIZE];
 }MSTP_RX_PDU;
 
@@ -0,0 +1,180 @@
+/*
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+/**********************************************************************************
+ *    File               : mstp_status.h
+ *    Description        : MSTP operational status snapshot shared between
+ *                         mstpd and its show clients (CLI, unixctl).
+ *
+ *    mstpd publishes a compact copy of the per-tree and per-port operational
+ *    state into a POSIX shared memory segment. The segment is protected by a
+ *    sequence lock: the protocol thread is the only writer, readers never
+ *    block it and simply retry when they observe a concurrent update.
+ *    This header must not depend on 'mstp_fsm.h' since it is also built
+ *    into the vtysh plugin.
+ **********************************************************************************/
+
+#ifndef __MSTP_STATUS_H__
+#define __MSTP_STATUS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MSTP_STATUS_SHM_NAME       "/ops-stpd-status"
+#define MSTP_STATUS_MAGIC          0x4D535450 /* 'MSTP' */
+#define MSTP_STATUS_VERSION        1
+
+/* CIST + 64 MSTIs, indexed by MSTID */
+#define MSTP_STATUS_MAX_TREES      65
+/* lports 1..512, index 0 is unused (same as MAX_LPORTS + 1) */
+#define MSTP_STATUS_MAX_PORTS      513
+#define MSTP_STATUS_PORT_NAME_LEN  16
+
+/* Number of times a reader retries before giving up on the snapshot */
+#define MSTP_STATUS_READ_RETRIES   16
+
+/* mstpd publishes at least once per timer tick (1 second); a snapshot
+ * older than this was left behind by a daemon that is not running */
+#define MSTP_STATUS_MAX_AGE_SEC    5
+
+/*---------------------------------------------------------------------------
+ * Port role values, identical to the ones of 'MSTP_PORT_ROLE_e'.
+ *---------------------------------------------------------------------------*/
+typedef enum
+{
+   MSTP_STATUS_ROLE_UNKNOWN = 0,
+   MSTP_STATUS_ROLE_ROOT,
+   MSTP_STATUS_ROLE_ALTERNATE,
+   MSTP_STATUS_ROLE_DESIGNATED,
+   MSTP_STATUS_ROLE_BACKUP,
+   MSTP_STATUS_ROLE_DISABLED,
+   MSTP_STATUS_ROLE_MASTER,
+   MSTP_STATUS_ROLE_MAX
+
+} MSTP_STATUS_ROLE_e;
+
+typedef enum
+{
+   MSTP_STATUS_STATE_UNKNOWN = 0,
+   MSTP_STATUS_STATE_BLOCKING,
+   MSTP_STATUS_STATE_LEARNING,
+   MSTP_STATUS_STATE_FORWARDING,
+   MSTP_STATUS_STATE_MAX
+
+} MSTP_STATUS_STATE_e;
+
+typedef struct mstp_status_bid
+{
+   uint16_t priority;
+   uint8_t  mac[6];
+
+} MSTP_STATUS_BID_t;
+
+/*---------------------------------------------------------------------------
+ * Per-tree (CIST or MSTI) bridge status.
+ *---------------------------------------------------------------------------*/
+typedef struct mstp_status_tree
+{
+   uint8_t            valid;
+   uint8_t            isRoot;            /* this bridge is the (regional)
+                                          * root of the tree             */
+   uint16_t           rootPortId;
+   uint16_t           remainingHops;
+   uint16_t           pad;
+   MSTP_STATUS_BID_t  bridgeId;
+   MSTP_STATUS_BID_t  rootId;            /* CIST root (CIST only)        */
+   MSTP_STATUS_BID_t  rgnRootId;         /* regional root                */
+   uint32_t           extRootPathCost;   /* CIST only                    */
+   uint32_t           intRootPathCost;
+   uint32_t           topologyChangeCnt;
+   uint32_t           timeSinceTopologyChange;
+
+} MSTP_STATUS_TREE_t;
+
+/*---------------------------------------------------------------------------
+ * Per-tree per-port status.
+ *---------------------------------------------------------------------------*/
+typedef struct mstp_status_port
+{
+   uint8_t            valid;
+   uint8_t            role;              /* MSTP_STATUS_ROLE_e           */
+   uint8_t            state;             /* MSTP_STATUS_STATE_e          */
+   uint8_t            priority;          /* 0-240, steps of 16           */
+   uint32_t           pathCost;
+   uint32_t           forwardTransitions;
+   uint16_t           dsnPortId;
+   MSTP_STATUS_BID_t  dsnBridgeId;
+
+} MSTP_STATUS_PORT_t;
+
+/*---------------------------------------------------------------------------
+ * Tree independent per-port status and counters.
+ *---------------------------------------------------------------------------*/
+typedef struct mstp_status_lport
+{
+   char               name[MSTP_STATUS_PORT_NAME_LEN];
+   uint8_t            valid;
+   uint8_t            portEnabled;
+   uint8_t            operEdge;
+   uint8_t            pad;
+   uint32_t           bpduRxCnt;          /* MST BPDUs only */
+   uint32_t           bpduTxCnt;
+
+} MSTP_STATUS_LPORT_t;
+
+typedef struct mstp_status_shm
+{
+   uint32_t            magic;
+   uint32_t            version;
+   uint32_t            seq;              /* odd while an update is in
+                                          * progress                     */
+   uint32_t            pad;
+   uint64_t            generation;       /* number of publishes          */
+   int64_t             publishTime;      /* time() of the last publish   */
+   uint8_t             mstpEnabled;
+   uint8_t             numOfValidTrees;
+   uint16_t            pad2;
+   uint32_t            pad3;
+   MSTP_STATUS_TREE_t  trees[MSTP_STATUS_MAX_TREES];
+   MSTP_STATUS_LPORT_t lports[MSTP_STATUS_MAX_PORTS];
+   MSTP_STATUS_PORT_t  ports[MSTP_STATUS_MAX_TREES][MSTP_STATUS_MAX_PORTS];
+
+} MSTP_STATUS_SHM_t;
+
+/*---------------------------------------------------------------------------
+ * Seqlock primitives. Single writer (mstpd protocol thread).
+ *---------------------------------------------------------------------------*/
+static inline void
+mstp_status_write_begin(MSTP_STATUS_SHM_t *shm)
+{
+   __atomic_store_n(&shm->seq, shm->seq + 1, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void
+mstp_status_write_end(MSTP_STATUS_SHM_t *shm)
+{
+   __atomic_store_n(&shm->seq, shm->seq + 1, __ATOMIC_RELEASE);
+}
+
+/* Prototypes (mstpd_status_shm.c, shared by mstpd and the CLI) */
+const MSTP_STATUS_SHM_t *mstp_status_attach(void);
+bool mstp_status_read(const MSTP_STATUS_SHM_t *shm, MSTP_STATUS_SHM_t *copy);
+bool mstp_status_is_current(const MSTP_STATUS_SHM_t *snap);
+const char *mstp_status_role_str(uint8_t role);
+const char *mstp_status_state_str(uint8_t state);
+int mstp_status_find_lport(const MSTP_STATUS_SHM_t *snap, const char *name);
+
+#endif  /* __MSTP_STATUS_H__ */
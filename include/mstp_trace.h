@@ -0,0 +1,190 @@
+/*
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+/**********************************************************************************
+ *    File               : mstp_trace.h
+ *    Description        : Convergence latency trace shared between mstpd and
+ *                         the switchd STP plugin.
+ *
+ *    An event (a received BPDU, or any other event the protocol thread
+ *    processes) gets an id and an origin time. Every stage the event goes
+ *    through on its way to the ASIC records the id, the tree and the port
+ *    in the ring of the thread that reached the stage and adds the time
+ *    elapsed since the origin to the stage histogram. Each ring and each
+ *    stage histogram has exactly one writer, so the segment is written
+ *    without locks. Time is CLOCK_MONOTONIC, common to both processes.
+ *    This header must not depend on 'mstp_fsm.h' since it is also built
+ *    into the switchd plugin.
+ **********************************************************************************/
+
+#ifndef __MSTP_TRACE_H__
+#define __MSTP_TRACE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MSTP_TRACE_SHM_NAME        "/ops-stpd-trace"
+#define MSTP_TRACE_MAGIC           0x4D535454 /* 'MSTT' */
+#define MSTP_TRACE_VERSION         2
+
+/* CIST + 64 MSTIs, indexed by MSTID */
+#define MSTP_TRACE_MAX_TREES       65
+/* lports 1..512, index 0 is unused (same as MAX_LPORTS + 1) */
+#define MSTP_TRACE_MAX_PORTS       513
+#define MSTP_TRACE_PORT_NAME_LEN   16
+
+/* Origins kept for the latency computation, indexed by id; power of 2 */
+#define MSTP_TRACE_EVENTS          4096
+/* Records kept per writer; power of 2 */
+#define MSTP_TRACE_RING_SIZE       8192
+/* Bucket 'i' counts latencies in [2^(i-1), 2^i) usec, bucket 0 is < 1 usec */
+#define MSTP_TRACE_HIST_BUCKETS    32
+
+typedef enum
+{
+   MSTP_TRACE_STAGE_RX = 0,    /* BPDU read off the socket         */
+   MSTP_TRACE_STAGE_DEQUEUE,   /* protocol thread took the event   */
+   MSTP_TRACE_STAGE_ROLE,      /* port role selection changed      */
+   MSTP_TRACE_STAGE_FWD,       /* forwarding enabled or disabled   */
+   MSTP_TRACE_STAGE_COMMIT,    /* port state committed to OVSDB    */
+   MSTP_TRACE_STAGE_HW,        /* port state handed to the ASIC    */
+   MSTP_TRACE_STAGE_MAX
+
+} MSTP_TRACE_STAGE_e;
+
+typedef enum
+{
+   MSTP_TRACE_WRITER_RX = 0,
+   MSTP_TRACE_WRITER_PROTOCOL,
+   MSTP_TRACE_WRITER_OVSDB,
+   MSTP_TRACE_WRITER_PLUGIN,
+   MSTP_TRACE_WRITER_MAX
+
+} MSTP_TRACE_WRITER_e;
+
+typedef struct mstp_trace_event
+{
+   uint64_t  id;                         /* 0 while the slot is unused   */
+   uint64_t  t0Ns;
+
+} MSTP_TRACE_EVENT_t;
+
+typedef struct mstp_trace_rec
+{
+   uint64_t  tsNs;
+   uint64_t  eventId;
+   uint16_t  lport;                      /* 0 if not port specific       */
+   uint8_t   mstid;
+   uint8_t   stage;                      /* MSTP_TRACE_STAGE_e           */
+   uint32_t  arg;                        /* stage specific: packet length,
+                                          * message type, role, state    */
+
+} MSTP_TRACE_REC_t;
+
+typedef struct mstp_trace_ring
+{
+   uint64_t          head;               /* records ever written         */
+   MSTP_TRACE_REC_t  recs[MSTP_TRACE_RING_SIZE];
+
+} MSTP_TRACE_RING_t;
+
+/* Latency from the event origin to the stage */
+typedef struct mstp_trace_hist
+{
+   uint64_t  cnt;
+   uint64_t  sumNs;
+   uint64_t  maxNs;
+   uint64_t  lost;                       /* origin already overwritten   */
+   uint64_t  buckets[MSTP_TRACE_HIST_BUCKETS];
+
+} MSTP_TRACE_HIST_t;
+
+typedef struct mstp_trace_shm
+{
+   uint32_t            magic;
+   uint32_t            version;
+   uint32_t            enabled;          /* atomic                       */
+   uint32_t            pad;
+   uint64_t            nextEventId;      /* atomic                       */
+   MSTP_TRACE_EVENT_t  events[MSTP_TRACE_EVENTS];
+   MSTP_TRACE_HIST_t   stages[MSTP_TRACE_STAGE_MAX];
+   MSTP_TRACE_RING_t   rings[MSTP_TRACE_WRITER_MAX];
+   /* event that last changed the forwarding of a (tree, port): set by the
+    * protocol thread, taken by the OVSDB thread when it writes the port
+    * state and published to the plugin in 'hwCommitted' before the commit,
+    * packed with the state written (see 'mstp_trace_hw_pack') */
+   uint64_t            hwPending[MSTP_TRACE_MAX_TREES][MSTP_TRACE_MAX_PORTS];
+   uint64_t            hwCommitted[MSTP_TRACE_MAX_TREES][MSTP_TRACE_MAX_PORTS];
+   /* plugin only: last event recorded at the HW stage */
+   uint64_t            hwDone[MSTP_TRACE_MAX_TREES][MSTP_TRACE_MAX_PORTS];
+   /* lport to port name, for the plugin which only knows names */
+   char                portNames[MSTP_TRACE_MAX_PORTS][MSTP_TRACE_PORT_NAME_LEN];
+
+} MSTP_TRACE_SHM_t;
+
+/*---------------------------------------------------------------------------
+ * Port state carried in 'hwCommitted', so the plugin credits the event only
+ * to the hardware update of the state the event's commit wrote. Same values
+ * as 'MSTP_DB_PORT_STATE_t'.
+ *---------------------------------------------------------------------------*/
+typedef enum
+{
+   MSTP_TRACE_HW_STATE_NONE = 0,
+   MSTP_TRACE_HW_STATE_BLOCKING,
+   MSTP_TRACE_HW_STATE_LEARNING,
+   MSTP_TRACE_HW_STATE_FORWARDING
+
+} MSTP_TRACE_HW_STATE_e;
+
+#define MSTP_TRACE_HW_STATE_SHIFT  56
+#define MSTP_TRACE_HW_ID_MASK      ((1ULL << MSTP_TRACE_HW_STATE_SHIFT) - 1)
+
+static inline uint64_t
+mstp_trace_hw_pack(uint64_t eventId, uint8_t state)
+{
+   return (eventId & MSTP_TRACE_HW_ID_MASK) |
+          ((uint64_t)state << MSTP_TRACE_HW_STATE_SHIFT);
+}
+
+static inline uint64_t
+mstp_trace_hw_id(uint64_t committed)
+{
+   return committed & MSTP_TRACE_HW_ID_MASK;
+}
+
+static inline uint8_t
+mstp_trace_hw_state(uint64_t committed)
+{
+   return (uint8_t)(committed >> MSTP_TRACE_HW_STATE_SHIFT);
+}
+
+static inline bool
+mstp_trace_enabled(const MSTP_TRACE_SHM_t *shm)
+{
+   return shm && __atomic_load_n(&shm->enabled, __ATOMIC_RELAXED);
+}
+
+/* Prototypes (mstpd_trace_shm.c, shared by mstpd and the switchd plugin) */
+MSTP_TRACE_SHM_t *mstp_trace_attach(bool create);
+uint64_t mstp_trace_now(void);
+uint64_t mstp_trace_new_event(MSTP_TRACE_SHM_t *shm, uint64_t t0Ns);
+void mstp_trace_record(MSTP_TRACE_SHM_t *shm, MSTP_TRACE_WRITER_e writer,
+                       MSTP_TRACE_STAGE_e stage, uint64_t eventId,
+                       int mstid, int lport, uint32_t arg);
+void mstp_trace_reset(MSTP_TRACE_SHM_t *shm);
+int mstp_trace_find_lport(const MSTP_TRACE_SHM_t *shm, const char *name);
+const char *mstp_trace_stage_str(int stage);
+
+#endif  /* __MSTP_TRACE_H__ */
@@ -0,0 +1,155 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+"""
+Helpers shared by the ops-stpd component tests.
+"""
+
+from __future__ import unicode_literals, absolute_import
+from __future__ import print_function, division
+
+import re
+import time
+from time import sleep
+
+STABLE_TIMEOUT = 90
+STABLE_POLLS = 4
+
+# RST BPDU from bridge 0xF000 00:00:00:00:aa:01, worse than any switch
+# of the topologies, padded to the minimum frame size
+FLOOD_SCRIPT = r"""
+import socket, time
+s = socket.socket(socket.AF_PACKET, socket.SOCK_RAW)
+s.bind(('{intf}', 0))
+bpdu = bytearray(b'\x00\x00\x02\x02\x3c' +
+                 b'\xf0\x00\x00\x00\x00\x00\xaa\x01' + b'\x00' * 4 +
+                 b'\xf0\x00\x00\x00\x00\x00\xaa\x01' + b'\x80\x01' +
+                 b'\x00\x00\x14\x00\x02\x00\x0f\x00\x00')
+frame = bytearray(b'\x01\x80\xc2\x00\x00\x00\x00\x00\x00\x00\xaa\x01' +
+                  bytearray([0, 3 + len(bpdu)]) + b'\x42\x42\x03') + bpdu
+frame += b'\x00' * (60 - len(frame))
+end = time.time() + {sec}
+n = 0
+while time.time() < end:
+    s.send(bytes(frame))
+    n += 1
+print('sent %d' % n)
+"""
+FLOOD_LOG = '/tmp/bpdu_flood.log'
+
+
+def config_mstp_region(ops, region_name, version):
+    with ops.libs.vtysh.Configure() as ctx:
+        ctx.spanning_tree_config_name(region_name)
+        ctx.spanning_tree_config_revision(version)
+
+
+def config_l2_interface(sw, interface):
+    with sw.libs.vtysh.ConfigInterface(interface) as ctx:
+        ctx.no_routing()
+        ctx.no_shutdown()
+
+
+def appctl(sw, command):
+    """
+    Output of the ops-stpd unixctl 'command'.
+    """
+    return sw.send_command('ovs-appctl -t ops-stpd ' + command,
+                           shell='bash')
+
+
+def bpdu_counts(sw, interface):
+    """
+    BPDUs sent and received on 'interface' by type, {'MST': (tx, rx), ...},
+    empty if ops-stpd does not know the port.
+    """
+    output = appctl(sw, 'mstpd/daemon/comm_port ' + interface)
+    result = re.search(r'BPDUs Tx/Rx\s*:(?P<counts>.*)$', output, re.M)
+    if result is None:
+        return {}
+    return dict((kind, (int(tx), int(rx))) for kind, tx, rx in
+                re.findall(r'(\w+)=(\d+)/(\d+)', result.group('counts')))
+
+
+def start_flood(hs, sec):
+    """
+    Have 'hs' send BPDUs out of its port 1 as fast as it can for 'sec'
+    seconds, in the background. 'flood_sent' reads how many it sent.
+    """
+    script = FLOOD_SCRIPT.format(intf=hs.ports['1'], sec=sec)
+    hs.send_command("cat > /tmp/bpdu_flood.py << 'EOF'\n" + script +
+                    "EOF", shell='bash')
+    hs.send_command('python /tmp/bpdu_flood.py > %s 2>&1 &' % FLOOD_LOG,
+                    shell='bash')
+
+
+def flood_sent(hs):
+    output = hs.send_command('cat ' + FLOOD_LOG, shell='bash')
+    result = re.search(r'sent (?P<sent>\d+)', output)
+    assert result is not None, "Flood did not finish: %s" % output.strip()
+    return int(result.group('sent'))
+
+
+def dyn_reconfig(sw):
+    """
+    Dynamic reconfiguration counters of ops-stpd: full re-inits, tree and
+    port restarts, and the duration of the last and longest one.
+    """
+    output = appctl(sw, 'mstpd/daemon/cist')
+    result = re.search(r'Dyn reconfig\s*:\s*full=(?P<full>\d+) '
+                       r'trees=(?P<trees>\d+) ports=(?P<ports>\d+) '
+                       r'last=(?P<last>\d+)us max=(?P<max>\d+)us', output)
+    assert result is not None, "No dynamic reconfiguration counters"
+    return dict((k, int(v)) for k, v in result.groupdict().items())
+
+
+def cist_port_states(sw):
+    """
+    CIST role and state of ports 1 and 2 of 'sw'.
+    """
+    show = sw.libs.vtysh.show_spanning_tree()
+    return dict((port, (show[port]['role'], show[port]['State']))
+                for port in [sw.ports['1'], sw.ports['2']])
+
+
+def wait_stable(sws, start, port_states=cist_port_states,
+                timeout=STABLE_TIMEOUT, polls=STABLE_POLLS):
+    """
+    Return the seconds from 'start' until the ports of all the switches
+    are forwarding or blocking and have not changed for 'polls' polls,
+    and the states they settled in. 'port_states' gives the (role, state)
+    of the ports of one switch.
+    """
+    last = None
+    same = 0
+    settled = start
+    while time.time() - start < timeout:
+        now = time.time()
+        states = dict((sw.identifier, port_states(sw)) for sw in sws)
+        final = all(state in ['Forwarding', 'Blocking']
+                    for sw_states in states.values()
+                    for role, state in sw_states.values())
+        if states != last or not final:
+            last = states
+            settled = now
+            same = 0
+        else:
+            same += 1
+            if same >= polls:
+                return settled - start, states
+        sleep(0.5)
+    assert False, "Ports not stable after %ds" % timeout
@@ -0,0 +1,158 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+"""
+OpenSwitch Test for the mstpd cold start bootstrap: time the default row
+creation of 64 MSTIs and the first BPDU after ops-stpd starts.
+"""
+
+from __future__ import unicode_literals, absolute_import
+from __future__ import print_function, division
+
+import re
+import time
+from time import sleep
+
+from mstp_ct_helpers import (bpdu_counts, config_l2_interface,
+                             config_mstp_region)
+
+TOPOLOGY = """
+#
+# +-------+     +-------+
+# |       |     |       |
+# | Sw1   +-----+   Sw2 |
+# |       |     |       |
+# +-------+     +-------+
+#
+# Nodes
+[type=openswitch name="OpenSwitch 1"] sw1
+[type=openswitch name="OpenSwitch 2"] sw2
+
+# Links
+sw1:1 -- sw2:1
+"""
+
+REGION_1 = "Region-One"
+VERSION = "8"
+# MSTP_INSTANCES_MAX in mstp_fsm.h
+MSTI_COUNT = 64
+# MSTP_BOOTSTRAP_TXN_ROWS in mstp_fsm.h
+TXN_ROWS = 4096
+# MSTP_CKPT_SHM_NAME in mstpd_ckpt.c
+CKPT_FILE = "/dev/shm/ops-stpd-ckpt"
+START_TIMEOUT = 60
+# Longest the bootstrap of the rows of 64 MSTIs and the first BPDU after
+# the start may take
+BOOTSTRAP_MAX_MS = 5000
+FIRST_BPDU_MAX_SEC = 10
+
+# The port rows of every tree are dropped with the daemon stopped, so its
+# next start has to create all of them
+CLEAR_SCRIPT = ('for u in $(ovs-vsctl --bare --columns=_uuid list '
+                'MSTP_Instance); do ovs-vsctl clear MSTP_Instance $u '
+                'mstp_instance_ports; done; for u in $(ovs-vsctl --bare '
+                '--columns=_uuid list MSTP_Common_Instance); do ovs-vsctl '
+                'clear MSTP_Common_Instance $u mstp_common_instance_ports; '
+                'done')
+
+LOG_SCRIPT = ('(journalctl 2>/dev/null; cat /var/log/messages '
+              '/var/log/syslog 2>/dev/null) | grep "MSTP bootstrap" | '
+              'tail -1')
+
+
+def tx_bpdus(sw, interface):
+    return sum(tx for tx, rx in bpdu_counts(sw, interface).values())
+
+
+def bootstrap_log(sw):
+    output = sw.send_command(LOG_SCRIPT, shell='bash')
+    result = re.search(r'MSTP bootstrap: (?P<ports>\d+) ports, '
+                       r'(?P<mstis>\d+) MSTIs, (?P<rows>\d+) rows inserted '
+                       r'in (?P<txns>\d+) transaction\(s\); '
+                       r'clean (?P<clean>[\d.]+) ms, cist (?P<cist>[\d.]+) '
+                       r'ms, msti (?P<msti>[\d.]+) ms, commit '
+                       r'(?P<commit>[\d.]+) ms, total (?P<total>[\d.]+) ms',
+                       output)
+    assert result is not None, "No bootstrap line in the log"
+    return result.groupdict()
+
+
+def test_mstp_bootstrap(topology):
+    """
+    Give sw1 64 MSTIs, stop ops-stpd, drop the port rows of every tree
+    and the warm restart checkpoint, and start it again. Print the phase
+    times of the bootstrap from the log and the time from the start to
+    the first BPDU sent, and check every row was created in a bounded
+    number of transactions and time, and the first BPDU went out soon
+    after.
+    """
+    sw1 = topology.get('sw1')
+    sw2 = topology.get('sw2')
+
+    assert sw1 is not None
+    assert sw2 is not None
+
+    config_l2_interface(sw1, sw1.ports['1'])
+    config_l2_interface(sw2, sw2.ports['1'])
+    for sw in [sw1, sw2]:
+        config_mstp_region(sw, REGION_1, VERSION)
+
+    print("Configure %d MSTIs on sw1" % MSTI_COUNT)
+    for mstid in range(1, MSTI_COUNT + 1):
+        with sw1.libs.vtysh.ConfigVlan(str(mstid + 1)) as ctx:
+            ctx.no_shutdown()
+        with sw1.libs.vtysh.Configure() as ctx:
+            ctx.spanning_tree_instance_vlan(mstid, mstid + 1)
+
+    for sw in [sw1, sw2]:
+        with sw.libs.vtysh.Configure() as ctx:
+            ctx.spanning_tree()
+    sleep(5)
+
+    print("Cold start of ops-stpd")
+    sw1.send_command('systemctl stop ops-stpd', shell='bash')
+    sw1.send_command(CLEAR_SCRIPT, shell='bash')
+    sw1.send_command('rm -f ' + CKPT_FILE, shell='bash')
+    start = time.time()
+    sw1.send_command('systemctl start ops-stpd', shell='bash')
+    while tx_bpdus(sw1, sw1.ports['1']) == 0:
+        assert time.time() - start < START_TIMEOUT, "No BPDU sent"
+        sleep(0.1)
+    first_bpdu = time.time() - start
+    sleep(2)
+
+    boot = bootstrap_log(sw1)
+    ports = int(boot['ports'])
+    rows = int(boot['rows'])
+    txns = int(boot['txns'])
+    print("%d ports, %d MSTIs: %d rows in %d transactions; clean %s ms, "
+          "cist %s ms, msti %s ms, commit %s ms, total %s ms" %
+          (ports, int(boot['mstis']), rows, txns, boot['clean'],
+           boot['cist'], boot['msti'], boot['commit'], boot['total']))
+    print("First BPDU sent %.1fs after the start" % first_bpdu)
+
+    assert int(boot['mstis']) == MSTI_COUNT, "Not every MSTI bootstrapped"
+    assert rows == ports * (MSTI_COUNT + 1), \
+        "Port rows of some tree not created"
+    assert txns <= rows // TXN_ROWS + 2, \
+        "Bootstrap used more transactions than its row bound needs"
+    assert float(boot['total']) <= BOOTSTRAP_MAX_MS, \
+        "Bootstrap of %d rows took %s ms, over %d ms" % \
+        (rows, boot['total'], BOOTSTRAP_MAX_MS)
+    assert first_bpdu <= FIRST_BPDU_MAX_SEC, \
+        "First BPDU sent %.1fs after the start, over %ds" % \
+        (first_bpdu, FIRST_BPDU_MAX_SEC)
@@ -0,0 +1,192 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+"""
+OpenSwitch Test for the mstpd BPDU ingress policer: flood one port with
+BPDUs and time the hellos received on another.
+"""
+
+from __future__ import unicode_literals, absolute_import
+from __future__ import print_function, division
+
+import re
+import time
+from time import sleep
+
+from mstp_ct_helpers import (appctl, bpdu_counts, config_l2_interface,
+                             config_mstp_region, flood_sent, start_flood)
+
+TOPOLOGY = """
+#
+# +-------+     +-------+     +-------+
+# |       |     |       |     |       |
+# |  hs1  +-----+  Sw1  +-----+  Sw2  |
+# |       |     |       |     |       |
+# +-------+     +-------+     +-------+
+#
+# Nodes
+[type=host name="Host 1"] hs1
+[type=openswitch name="OpenSwitch 1"] sw1
+[type=openswitch name="OpenSwitch 2"] sw2
+
+# Links
+hs1:1 -- sw1:2
+sw1:1 -- sw2:1
+"""
+
+HELLO_TIME = 2
+REGION_1 = "Region-One"
+VERSION = "8"
+FLOOD_SEC = 20
+POLICER_RATE = 20
+POLICER_BURST = 20
+# Seconds of tokens the policer may hand out on top of FLOOD_SEC: the
+# polls of the counters around the flood
+POLICER_SLACK_SEC = 2
+
+
+def set_policer(sw, interface, rate, burst):
+    sw.send_command('ovs-vsctl set port %s '
+                    'other_config:mstp_bpdu_rate_limit=%d '
+                    'other_config:mstp_bpdu_burst=%d'
+                    % (interface, rate, burst), shell='bash')
+
+
+def policer_port(sw, interface):
+    output = appctl(sw, 'mstpd/daemon/bpdu_policer')
+    result = re.search(r'^' + re.escape(interface) +
+                       r'\s+(?P<rate>\S+)\s+(?P<burst>\S+)\s+'
+                       r'(?P<dropped>\d+)\s+(?P<exceeded>\d+)\s+'
+                       r'(?P<state>\w+)\s*$', output, re.M)
+    assert result is not None, "Port %s not in policer output" % interface
+    return result.groupdict()
+
+
+def rx_bpdus(sw, interface, kind=None):
+    counts = bpdu_counts(sw, interface)
+    assert counts, "No BPDU counters for %s" % interface
+    return sum(rx for k, (tx, rx) in counts.items()
+               if kind is None or k == kind)
+
+
+def time_hellos(sw, interface, sec):
+    """
+    Poll the MST BPDUs received on 'interface' for 'sec' seconds, return
+    the number received and the longest gap seen between two of them.
+    """
+    last_cnt = rx_bpdus(sw, interface, 'MST')
+    first_cnt = last_cnt
+    last_time = time.time()
+    end = last_time + sec
+    max_gap = 0.0
+    while time.time() < end:
+        sleep(0.5)
+        cnt = rx_bpdus(sw, interface, 'MST')
+        now = time.time()
+        if cnt != last_cnt:
+            max_gap = max(max_gap, now - last_time)
+            last_cnt = cnt
+            last_time = now
+    max_gap = max(max_gap, time.time() - last_time)
+    return last_cnt - first_cnt, max_gap
+
+
+def flood(hs, sw, sw_intf, sec):
+    """
+    Flood 'sw_intf' from 'hs' for 'sec' seconds while timing the hellos
+    'sw' receives on port 1. Return the hellos, their longest gap, the
+    BPDUs sent and how many of them the protocol got.
+    """
+    rx = rx_bpdus(sw, sw_intf)
+    start_flood(hs, sec)
+    hellos, max_gap = time_hellos(sw, sw.ports['1'], sec)
+    sleep(2)
+    sent = flood_sent(hs)
+    accepted = rx_bpdus(sw, sw_intf) - rx
+    print("Sent %d, %d reached the protocol, %d hellos on %s, longest gap "
+          "%.1fs" % (sent, accepted, hellos, sw.ports['1'], max_gap))
+    return hellos, max_gap, sent, accepted
+
+
+def test_mstp_bpdu_policer(topology):
+    """
+    Flood port 2 of sw1 with BPDUs from a host, once with the policer off
+    and once with it on, and time the hellos sw1 gets from sw2 on port 1
+    meanwhile. With the policer on, sw2's hellos must keep arriving every
+    hello time, no more of the flood than the rate and burst allow may
+    reach the protocol, and the rest must be counted as dropped.
+    """
+    hs1 = topology.get('hs1')
+    sw1 = topology.get('sw1')
+    sw2 = topology.get('sw2')
+
+    assert hs1 is not None
+    assert sw1 is not None
+    assert sw2 is not None
+
+    hs1.libs.ip.interface('1', up=True)
+    config_l2_interface(sw1, sw1.ports['1'])
+    config_l2_interface(sw1, sw1.ports['2'])
+    config_l2_interface(sw2, sw2.ports['1'])
+
+    for sw in [sw1, sw2]:
+        config_mstp_region(sw, REGION_1, VERSION)
+        with sw.libs.vtysh.Configure() as ctx:
+            ctx.spanning_tree()
+
+    # Covergence should happen with HELLO_TIME * 2
+    sleep(HELLO_TIME * 2)
+
+    print("Flood with the policer off")
+    set_policer(sw1, sw1.ports['2'], 0, 0)
+    sleep(1)
+    hellos_off, gap_off, sent_off, accepted_off = \
+        flood(hs1, sw1, sw1.ports['2'], FLOOD_SEC)
+    assert policer_port(sw1, sw1.ports['2'])['state'] == 'off', \
+        "Policer not turned off"
+
+    print("Flood with the policer on")
+    set_policer(sw1, sw1.ports['2'], POLICER_RATE, POLICER_BURST)
+    sleep(1)
+    appctl(sw1, 'mstpd/daemon/bpdu_policer reset')
+    hellos_on, gap_on, sent_on, accepted_on = \
+        flood(hs1, sw1, sw1.ports['2'], FLOOD_SEC)
+
+    print("Hellos on the other port: off %d (gap %.1fs), on %d (gap %.1fs)"
+          % (hellos_off, gap_off, hellos_on, gap_on))
+    print("Flood reaching the protocol: off %d of %d, on %d of %d" %
+          (accepted_off, sent_off, accepted_on, sent_on))
+
+    port = policer_port(sw1, sw1.ports['2'])
+    admitted_max = POLICER_BURST + \
+        POLICER_RATE * (FLOOD_SEC + POLICER_SLACK_SEC)
+    assert accepted_off > admitted_max, \
+        "Flood of %d BPDUs too slow to exceed the policer" % sent_off
+    assert accepted_on <= admitted_max, \
+        "Policer let %d BPDUs through, at most %d allowed" % \
+        (accepted_on, admitted_max)
+    assert int(port['dropped']) > POLICER_RATE * FLOOD_SEC, \
+        "Flood not dropped by the policer"
+    assert int(port['exceeded']) == 1, \
+        "One continuous flood not counted as one rate exceeded event"
+    assert hellos_on >= FLOOD_SEC // HELLO_TIME - 1, \
+        "Hellos lost on the other port while the flood is policed"
+    # one hello either way is the edge of the polling window
+    assert hellos_on + 1 >= hellos_off, \
+        "Fewer hellos with the policer on than with it off"
+    assert gap_on <= HELLO_TIME * 2, \
+        "Hellos delayed on the other port while the flood is policed"
@@ -0,0 +1,170 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+"""
+OpenSwitch Test for the mstpd per-port struct layout: count the cache
+misses of ops-stpd per timer tick and per received BPDU with perf.
+"""
+
+from __future__ import unicode_literals, absolute_import
+from __future__ import print_function, division
+
+import re
+from time import sleep
+
+from mstp_ct_helpers import (bpdu_counts, config_l2_interface,
+                             config_mstp_region, start_flood)
+
+TOPOLOGY = """
+#
+# +-------+     +-------+     +-------+
+# |       |     |       |     |       |
+# |  hs1  +-----+  Sw1  +-----+  Sw2  |
+# |       |     |       |     |       |
+# +-------+     +-------+     +-------+
+#
+# Nodes
+[type=host name="Host 1"] hs1
+[type=openswitch name="OpenSwitch 1"] sw1
+[type=openswitch name="OpenSwitch 2"] sw2
+
+# Links
+hs1:1 -- sw1:2
+sw1:1 -- sw2:1
+"""
+
+HELLO_TIME = 2
+REGION_1 = "Region-One"
+VERSION = "8"
+MSTI_COUNT = 16
+MEASURE_SEC = 20
+
+# Cache lines of hot port data a BPDU walks: the common port, the CIST
+# port and the port on every MSTI, as laid out in mstpd_port_arena.c
+HOT_LINES_PER_BPDU = 2 + 4 + 3 * MSTI_COUNT
+# Misses per hot line allowed for the socket, the receive path and the
+# lines the protocol writes back
+MISSES_PER_HOT_LINE = 4
+
+
+def rx_bpdus(sw, interface):
+    counts = bpdu_counts(sw, interface)
+    assert counts, "No BPDU counters for %s" % interface
+    return sum(rx for tx, rx in counts.values())
+
+
+def perf_stat(sw, sec):
+    """
+    Cache misses and references of ops-stpd over 'sec' seconds.
+    """
+    output = sw.send_command('perf stat -x, -e cache-misses,'
+                             'cache-references -p $(pidof ops-stpd) -- '
+                             'sleep %d 2>&1' % sec, shell='bash',
+                             timeout=sec + 30)
+    counts = {}
+    for event in ['cache-misses', 'cache-references']:
+        result = re.search(r'^(?P<count>\d+),[^,]*,' + event, output, re.M)
+        assert result is not None, "perf did not count %s" % event
+        counts[event] = int(result.group('count'))
+    return counts
+
+
+def measure(sw, hs, flood):
+    """
+    Count the cache misses of ops-stpd on sw for MEASURE_SEC seconds,
+    with hs flooding port 2 with BPDUs or not, and the BPDUs it received
+    meanwhile.
+    """
+    ports = [sw.ports['1'], sw.ports['2']]
+    rx = sum(rx_bpdus(sw, port) for port in ports)
+    if flood:
+        start_flood(hs, MEASURE_SEC)
+    counts = perf_stat(sw, MEASURE_SEC)
+    sleep(1)
+    counts['bpdus'] = sum(rx_bpdus(sw, port) for port in ports) - rx
+    return counts
+
+
+def test_mstp_cache_misses(topology):
+    """
+    With 16 MSTIs on sw1, count the cache misses of ops-stpd over 20
+    seconds of steady state, then over 20 seconds of a BPDU flood from a
+    host. Print the misses per timer tick (one per second) from the first
+    run and the extra misses per received BPDU from the second, which
+    must stay within a few misses per hot cache line the BPDU walks.
+    Nothing is measured if the image has no perf.
+    """
+    hs1 = topology.get('hs1')
+    sw1 = topology.get('sw1')
+    sw2 = topology.get('sw2')
+
+    assert hs1 is not None
+    assert sw1 is not None
+    assert sw2 is not None
+
+    output = sw1.send_command('which perf', shell='bash')
+    if 'perf' not in output:
+        print("No perf on the switch, cache misses not measured")
+        return
+
+    hs1.libs.ip.interface('1', up=True)
+    config_l2_interface(sw1, sw1.ports['1'])
+    config_l2_interface(sw1, sw1.ports['2'])
+    config_l2_interface(sw2, sw2.ports['1'])
+
+    for sw in [sw1, sw2]:
+        config_mstp_region(sw, REGION_1, VERSION)
+        for mstid in range(1, MSTI_COUNT + 1):
+            with sw.libs.vtysh.ConfigVlan(str(mstid + 1)) as ctx:
+                ctx.no_shutdown()
+            with sw.libs.vtysh.Configure() as ctx:
+                ctx.spanning_tree_instance_vlan(mstid, mstid + 1)
+        with sw.libs.vtysh.Configure() as ctx:
+            ctx.spanning_tree()
+
+    # Turn the BPDU policer off so the whole flood reaches the protocol
+    sw1.send_command('ovs-vsctl set port %s '
+                     'other_config:mstp_bpdu_rate_limit=0 '
+                     'other_config:mstp_bpdu_burst=0' % sw1.ports['2'],
+                     shell='bash')
+
+    # Covergence should happen with HELLO_TIME * 2
+    sleep(HELLO_TIME * 2)
+
+    print("Steady state for %ds" % MEASURE_SEC)
+    idle = measure(sw1, hs1, False)
+    print("Flood for %ds" % MEASURE_SEC)
+    busy = measure(sw1, hs1, True)
+
+    per_tick = idle['cache-misses'] / MEASURE_SEC
+    extra_bpdus = busy['bpdus'] - idle['bpdus']
+    per_bpdu = (busy['cache-misses'] - idle['cache-misses']) / \
+        max(extra_bpdus, 1)
+    print("Steady state: %d misses of %d references, %d BPDUs received, "
+          "%.0f misses per tick" % (idle['cache-misses'],
+                                    idle['cache-references'],
+                                    idle['bpdus'], per_tick))
+    print("Flood       : %d misses of %d references, %d BPDUs received, "
+          "%.1f extra misses per BPDU" % (busy['cache-misses'],
+                                          busy['cache-references'],
+                                          busy['bpdus'], per_bpdu))
+
+    assert extra_bpdus > 0, "Flood did not reach the protocol"
+    assert per_bpdu <= HOT_LINES_PER_BPDU * MISSES_PER_HOT_LINE, \
+        "%.1f cache misses per BPDU, over %d for %d hot lines" % \
+        (per_bpdu, HOT_LINES_PER_BPDU * MISSES_PER_HOT_LINE,
+         HOT_LINES_PER_BPDU)
@@ -0,0 +1,152 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+"""
+OpenSwitch Test for the mstpd config mailbox: time a bulk port config
+push over every port of 64 MSTIs and count the passes applying it.
+"""
+
+from __future__ import unicode_literals, absolute_import
+from __future__ import print_function, division
+
+import re
+import time
+from time import sleep
+
+from mstp_ct_helpers import appctl, config_mstp_region
+
+TOPOLOGY = """
+#
+# +-------+
+# |       |
+# |  Sw1  |
+# |       |
+# +-------+
+#
+# Nodes
+[type=openswitch name="OpenSwitch 1"] sw1
+"""
+
+REGION_1 = "Region-One"
+VERSION = "8"
+# MSTP_INSTANCES_MAX in mstp_fsm.h
+MSTI_COUNT = 64
+COSTS = [2000, 3000, 4000]
+SETTLE_TIMEOUT = 120
+# Longest a pass may hold the protocol thread, so BPDUs and timer ticks
+# keep being served during the push
+PASS_MAX_USEC = 100000
+
+# One ovs-vsctl transaction setting the admin path cost of every CIST and
+# MSTI port row
+PUSH_SCRIPT = ('args=""; for u in $(ovs-vsctl --bare --columns=_uuid list '
+               'MSTP_Instance_Port); do args="$args -- set '
+               'MSTP_Instance_Port $u admin_path_cost={cost}"; done; '
+               'for u in $(ovs-vsctl --bare --columns=_uuid list '
+               'MSTP_Common_Instance_Port); do args="$args -- set '
+               'MSTP_Common_Instance_Port $u admin_path_cost={cost}"; done; '
+               'ovs-vsctl $args > /dev/null')
+
+
+def row_count(sw, table):
+    output = sw.send_command('ovs-vsctl --bare --columns=_uuid list ' +
+                             table, shell='bash')
+    return len(re.findall(r'[0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-'
+                          r'[0-9a-f]{4}-[0-9a-f]{12}', output))
+
+
+def cfg_mailbox(sw):
+    output = appctl(sw, 'mstpd/daemon/ovsdb_lock')
+    result = re.search(r'Config mailbox.*'
+                       r'Updates\s*:\s*(?P<puts>\d+) \((?P<coalesced>\d+) '
+                       r'coalesced\), (?P<pending>\d+) pending.*'
+                       r'Batches\s*:\s*(?P<batches>\d+) .*'
+                       r'Applied\s*:\s*(?P<applied>\d+) updates in '
+                       r'(?P<passes>\d+) passes, max (?P<max_batch>\d+) per '
+                       r'pass.*'
+                       r'Pass time usec\s*:\s*last (?P<last>\d+), '
+                       r'max (?P<max>\d+)', output, re.S)
+    assert result is not None, "No config mailbox counters"
+    return dict((k, int(v)) for k, v in result.groupdict().items())
+
+
+def cist_port_cost(sw, interface):
+    output = appctl(sw, 'mstpd/daemon/cist_port ' + interface)
+    result = re.search(r'InternalPortPathCost=(?P<cost>\d+)', output)
+    assert result is not None, "No path cost for %s" % interface
+    return int(result.group('cost'))
+
+
+def test_mstp_cfg_mailbox(topology):
+    """
+    Give sw1 64 MSTIs, then push a new admin path cost to every CIST and
+    MSTI port row three times in a row, one transaction each. Time until
+    the protocol thread applied the last one and print the updates put,
+    coalesced and applied and the passes taken: superseded updates must
+    be coalesced and the push applied in a handful of passes, not one per
+    row, none of them holding the protocol thread for long.
+    """
+    sw1 = topology.get('sw1')
+
+    assert sw1 is not None
+
+    config_mstp_region(sw1, REGION_1, VERSION)
+    print("Configure %d MSTIs on sw1" % MSTI_COUNT)
+    for mstid in range(1, MSTI_COUNT + 1):
+        with sw1.libs.vtysh.ConfigVlan(str(mstid + 1)) as ctx:
+            ctx.no_shutdown()
+        with sw1.libs.vtysh.Configure() as ctx:
+            ctx.spanning_tree_instance_vlan(mstid, mstid + 1)
+    with sw1.libs.vtysh.Configure() as ctx:
+        ctx.spanning_tree()
+    sleep(5)
+
+    rows = row_count(sw1, 'MSTP_Instance_Port') + \
+        row_count(sw1, 'MSTP_Common_Instance_Port')
+    before = cfg_mailbox(sw1)
+
+    print("Push %d costs to %d port rows" % (len(COSTS), rows))
+    start = time.time()
+    sw1.send_command('; '.join(PUSH_SCRIPT.format(cost=cost)
+                               for cost in COSTS),
+                     shell='bash', timeout=SETTLE_TIMEOUT)
+    while True:
+        after = cfg_mailbox(sw1)
+        if after['pending'] == 0 and \
+                cist_port_cost(sw1, sw1.ports['1']) == COSTS[-1]:
+            break
+        assert time.time() - start < SETTLE_TIMEOUT, \
+            "Bulk config not applied after %ds" % SETTLE_TIMEOUT
+        sleep(0.2)
+    elapsed = time.time() - start
+
+    puts = after['puts'] - before['puts']
+    coalesced = after['coalesced'] - before['coalesced']
+    applied = after['applied'] - before['applied']
+    passes = after['passes'] - before['passes']
+    print("%d rows x %d pushes applied in %.1fs: %d updates put, %d "
+          "coalesced, %d applied in %d passes (max %d per pass, longest "
+          "%dus)" % (rows, len(COSTS), elapsed, puts, coalesced, applied,
+                     passes, after['max_batch'], after['max']))
+
+    assert puts >= rows, "Updates of some rows not put in the mailbox"
+    assert rows <= applied <= puts - coalesced, \
+        "Applied updates do not match the put and coalesced ones"
+    assert 0 < passes <= len(COSTS) * 4, "Bulk config not applied in batches"
+    assert after['max'] <= PASS_MAX_USEC, \
+        "A pass held the protocol thread for %dus, over %dus" % \
+        (after['max'], PASS_MAX_USEC)
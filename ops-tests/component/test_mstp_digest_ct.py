@@ -0,0 +1,143 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+"""
+OpenSwitch Test for the mstpd MST Configuration Digest: time the digest
+with the HMAC key pads derived once against deriving them every time and
+against a digest cache lookup, and check the digest cache.
+"""
+
+from __future__ import unicode_literals, absolute_import
+from __future__ import print_function, division
+
+import re
+from time import sleep
+
+from mstp_ct_helpers import appctl, config_mstp_region
+
+TOPOLOGY = """
+#
+# +-------+
+# |       |
+# |  Sw1  |
+# |       |
+# +-------+
+#
+# Nodes
+[type=openswitch name="OpenSwitch 1"] sw1
+"""
+
+REGION_1 = "Region-One"
+VERSION = "8"
+# 802.1Q-2011 13.7, all VLANs mapped to the CIST
+DIGEST_ALL_CIST = "AC36177F50283CD4B83821D8AB26DE62"
+# VLAN 10 mapped to MSTI 1, every other VLAN to the CIST
+DIGEST_VLAN10_MSTI1 = "870555C957F1B44530B7D56FD4716ADF"
+# MSTP_DIGEST_BENCH_MAX in mstp_fsm.h
+BENCH_COUNT = 10000
+# A cache lookup must cost at most this fraction of a calculated digest
+CACHE_COST_MAX = 0.1
+# The pads derived once save two of ~130 MD5 blocks; allow for noise
+KEYED_SLACK = 1.1
+
+
+def mstp_digest(sw, count=''):
+    output = appctl(sw, 'mstpd/daemon/mstp_digest ' + str(count))
+    result = re.search(r'Digest Value: 0x(?P<digest>[0-9A-F]+)\s*'
+                       r'Digest cache: (?P<calc>\d+) calculated, '
+                       r'(?P<reuse>\d+) reused', output)
+    assert result is not None, "Unexpected mstp_digest output"
+    digest = result.groupdict()
+    digest['calc'] = int(digest['calc'])
+    digest['reuse'] = int(digest['reuse'])
+    result = re.search(r'Digest time : (?P<count>\d+) digests, '
+                       r'(?P<keyed>\d+) nsec each with the key pads derived '
+                       r'once, (?P<plain>\d+) nsec deriving them, '
+                       r'(?P<cached>\d+) nsec from the cache, '
+                       r'(?P<same>.*)$', output, re.M)
+    if result is not None:
+        timing = result.groupdict()
+        for key in ['count', 'keyed', 'plain', 'cached']:
+            timing[key] = int(timing[key])
+        digest['bench'] = timing
+    return digest
+
+
+def bench(sw, expected):
+    digest = mstp_digest(sw, BENCH_COUNT)
+    assert digest['digest'] == expected, "Wrong digest %s" % digest['digest']
+    assert 'bench' in digest, "Digests not timed"
+    timing = digest['bench']
+    print("%s: %d digests, %d nsec each with the pads derived once, %d "
+          "nsec deriving them, %d nsec from the cache" %
+          (digest['digest'], timing['count'], timing['keyed'],
+           timing['plain'], timing['cached']))
+    assert timing['same'] == 'same digest', \
+        "Digest with the derived pads or from the cache differs from " \
+        "plain HMAC-MD5"
+    assert timing['keyed'] > 0, "Digest took no time"
+    assert timing['cached'] <= timing['keyed'] * CACHE_COST_MAX, \
+        "Cache lookup %dns not %dx faster than a %dns digest" % \
+        (timing['cached'], 1 / CACHE_COST_MAX, timing['keyed'])
+    assert timing['keyed'] <= timing['plain'] * KEYED_SLACK, \
+        "Digest with the pads derived once slower than deriving them"
+    return digest
+
+
+def test_mstp_digest(topology):
+    """
+    Time 10000 Configuration Digests of the all-CIST mapping and of VLAN 10
+    on MSTI 1, with the HMAC key pads derived once, derived for every
+    digest and looked up in the digest cache. All ways must give the
+    802.1Q digests, and the lookup must cost a tenth of a digest at most.
+    Check the digest is calculated again when the mapping changes and
+    comes back the same after a restart of the protocol, printing the
+    digest cache counts.
+    """
+    sw1 = topology.get('sw1')
+
+    assert sw1 is not None
+
+    config_mstp_region(sw1, REGION_1, VERSION)
+    with sw1.libs.vtysh.Configure() as ctx:
+        ctx.spanning_tree()
+    sleep(2)
+
+    print("All VLANs on the CIST")
+    before = bench(sw1, DIGEST_ALL_CIST)
+
+    print("VLAN 10 on MSTI 1")
+    with sw1.libs.vtysh.ConfigVlan('10') as ctx:
+        ctx.no_shutdown()
+    with sw1.libs.vtysh.Configure() as ctx:
+        ctx.spanning_tree_instance_vlan(1, 10)
+    sleep(2)
+    mapped = bench(sw1, DIGEST_VLAN10_MSTI1)
+    assert mapped['calc'] > before['calc'], \
+        "Digest not calculated again for a new mapping"
+
+    print("Restart the protocol with the same mapping")
+    with sw1.libs.vtysh.Configure() as ctx:
+        ctx.no_spanning_tree()
+    with sw1.libs.vtysh.Configure() as ctx:
+        ctx.spanning_tree()
+    sleep(2)
+    restarted = mstp_digest(sw1)
+    print("Digest cache: %d calculated, %d reused" %
+          (restarted['calc'], restarted['reuse']))
+    assert restarted['digest'] == DIGEST_VLAN10_MSTI1, \
+        "Digest changed with the same mapping"
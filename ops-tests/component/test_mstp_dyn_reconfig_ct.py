@@ -0,0 +1,145 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+"""
+OpenSwitch Test for scoped dynamic reconfiguration: time to stable after
+a port cost change on one MSTI against a region change.
+"""
+
+from __future__ import unicode_literals, absolute_import
+from __future__ import print_function, division
+
+import time
+
+from mstp_ct_helpers import (config_l2_interface, config_mstp_region,
+                             dyn_reconfig, wait_stable)
+
+TOPOLOGY = """
+#
+# +-------+     +-------+
+# |       |     |       |
+# |       +-----+       |
+# | Sw1   +-----+   Sw2 |
+# |       |     |       |
+# +-------+     +-------+
+#
+# Nodes
+[type=openswitch name="OpenSwitch 1"] sw1
+[type=openswitch name="OpenSwitch 2"] sw2
+
+# Links
+sw1:1 -- sw2:1
+sw1:2 -- sw2:2
+"""
+
+HELLO_TIME = 2
+REGION_1 = "Region-One"
+VERSION = "8"
+NEW_VERSION = "9"
+MSTI = 1
+MSTI_VLAN = 10
+
+
+def port_states(sw):
+    """
+    Role and state of ports 1 and 2 on the CIST and on the MSTI.
+    """
+    cist = sw.libs.vtysh.show_spanning_tree()
+    msti = sw.libs.vtysh.show_spanning_tree_mst()['MST' + str(MSTI)]
+    states = {}
+    for port in [sw.ports['1'], sw.ports['2']]:
+        states[('cist', port)] = (cist[port]['role'], cist[port]['State'])
+        states[('msti', port)] = (msti[port]['role'], msti[port]['State'])
+    return states
+
+
+def test_mstp_dyn_reconfig(topology):
+    """
+    Converge two switches of one region with one MSTI, then change the
+    MSTI cost of a port and the region revision in turn. Print the time
+    to stable of each change and check the port cost change restarted
+    only that port on that MSTI, leaving the CIST as it was, while the
+    revision change re-initialized the protocol. The port restart must
+    take less time than the re-init, in ops-stpd and network wide.
+    """
+    sw1 = topology.get('sw1')
+    sw2 = topology.get('sw2')
+
+    assert sw1 is not None
+    assert sw2 is not None
+
+    for sw in [sw1, sw2]:
+        config_l2_interface(sw, sw.ports['1'])
+        config_l2_interface(sw, sw.ports['2'])
+        with sw.libs.vtysh.ConfigVlan(str(MSTI_VLAN)) as ctx:
+            ctx.no_shutdown()
+        config_mstp_region(sw, REGION_1, VERSION)
+        with sw.libs.vtysh.Configure() as ctx:
+            ctx.spanning_tree_instance_vlan(MSTI, MSTI_VLAN)
+            ctx.spanning_tree()
+
+    stable, states = wait_stable([sw1, sw2], time.time(), port_states)
+    print("Converged in %.1fs" % stable)
+
+    print("Change the MSTI %d cost of %s" % (MSTI, sw1.ports['2']))
+    before = dyn_reconfig(sw1)
+    start = time.time()
+    with sw1.libs.vtysh.ConfigInterface(sw1.ports['2']) as ctx:
+        ctx.spanning_tree_instance_cost(str(MSTI), '2000')
+    port_stable, port_states_after = wait_stable([sw1, sw2], start,
+                                                 port_states)
+    after_port = dyn_reconfig(sw1)
+
+    print("Change the region revision")
+    start = time.time()
+    for sw in [sw1, sw2]:
+        with sw.libs.vtysh.Configure() as ctx:
+            ctx.spanning_tree_config_revision(NEW_VERSION)
+    full_stable, full_states = wait_stable([sw1, sw2], start, port_states)
+    after_full = dyn_reconfig(sw1)
+
+    print("Port cost change: stable in %.1fs, %d port restarts, %d tree "
+          "restarts, %d full, restart took %dus" %
+          (port_stable, after_port['ports'] - before['ports'],
+           after_port['trees'] - before['trees'],
+           after_port['full'] - before['full'], after_port['last']))
+    print("Revision change : stable in %.1fs, %d full, re-init took %dus" %
+          (full_stable, after_full['full'] - after_port['full'],
+           after_full['last']))
+    print("Scoped restart %.1fx faster to stable, %.1fx cheaper in ops-stpd"
+          % (full_stable / max(port_stable, 0.5),
+             after_full['last'] / max(after_port['last'], 1)))
+
+    assert after_port['full'] == before['full'], \
+        "Port cost change re-initialized the protocol"
+    assert after_port['trees'] == before['trees'], \
+        "Port cost change restarted a whole tree"
+    assert after_port['ports'] > before['ports'], \
+        "Port cost change did not restart the port"
+    for sw in [sw1, sw2]:
+        for port in [sw.ports['1'], sw.ports['2']]:
+            assert port_states_after[sw.identifier][('cist', port)] == \
+                states[sw.identifier][('cist', port)], \
+                "CIST port %s changed on a MSTI cost change" % port
+    assert after_full['full'] > after_port['full'], \
+        "Region revision change did not re-initialize the protocol"
+    assert after_port['last'] < after_full['last'], \
+        "Port restart took %dus, the full re-init %dus" % \
+        (after_port['last'], after_full['last'])
+    assert port_stable <= full_stable, \
+        "Stable %.1fs after the port cost change, %.1fs after the " \
+        "re-init" % (port_stable, full_stable)
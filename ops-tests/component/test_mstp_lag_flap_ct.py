@@ -0,0 +1,207 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+"""
+OpenSwitch Test for the mstpd LAG speed flap damping: flap a LAG member
+and count the speed changes damped and the reconfigurations they cost.
+"""
+
+from __future__ import unicode_literals, absolute_import
+from __future__ import print_function, division
+
+import re
+import time
+from time import sleep
+
+from mstp_ct_helpers import (appctl, config_l2_interface, config_mstp_region,
+                             dyn_reconfig)
+
+TOPOLOGY = """
+#
+# +-------+     +-------+
+# |       +-----+       |
+# |       +-----+       |
+# | Sw1   +-----+   Sw2 |
+# |       +-----+       |
+# +-------+     +-------+
+#
+# Nodes
+[type=openswitch name="OpenSwitch 1"] sw1
+[type=openswitch name="OpenSwitch 2"] sw2
+
+# Links
+sw1:1 -- sw2:1
+sw1:2 -- sw2:2
+sw1:3 -- sw2:3
+sw1:4 -- sw2:4
+"""
+
+HELLO_TIME = 2
+REGION_1 = "Region-One"
+VERSION = "8"
+LAG_ID = '10'
+LAG_NAME = 'lag' + LAG_ID
+FLAPS = 5
+# MSTP_LAG_COST_HOLD_MAX_SEC in mstp_fsm.h
+HOLD_MAX_SEC = 10
+# The hold is released on the one second timer tick after it expires
+RELEASE_SLACK_SEC = 2
+RESTARTS = ['full', 'trees', 'ports']
+
+
+def create_lag(sw, members):
+    with sw.libs.vtysh.ConfigInterfaceLag(LAG_ID) as ctx:
+        ctx.no_routing()
+        ctx.lacp_mode_active()
+    for port in members:
+        with sw.libs.vtysh.ConfigInterface(port) as ctx:
+            ctx.no_shutdown()
+            ctx.lag(LAG_ID)
+    with sw.libs.vtysh.ConfigInterfaceLag(LAG_ID) as ctx:
+        ctx.no_shutdown()
+
+
+def set_member(sw, interface, up):
+    with sw.libs.vtysh.ConfigInterface(interface) as ctx:
+        if up:
+            ctx.no_shutdown()
+        else:
+            ctx.shutdown()
+
+
+def lag_cost(sw):
+    output = appctl(sw, 'mstpd/daemon/comm_port ' + LAG_NAME)
+    result = re.search(r'Auto PathCost\s*:\s*oper=(?P<oper>\d+) '
+                       r'applied=(?P<applied>\d+) held=(?P<held>[TF])\s*'
+                       r'speedChanges=(?P<changes>\d+) '
+                       r'lagDamped=(?P<damped>\d+)', output)
+    assert result is not None, "No path cost cache for %s" % LAG_NAME
+    cost = result.groupdict()
+    for key in ['oper', 'applied', 'changes', 'damped']:
+        cost[key] = int(cost[key])
+    return cost
+
+
+def wait_released(sw, start):
+    """
+    Return the seconds from 'start' until the LAG cost is no longer held,
+    and its cost counters then.
+    """
+    while True:
+        cost = lag_cost(sw)
+        if cost['held'] == 'F':
+            return time.time() - start, cost
+        assert time.time() - start < HOLD_MAX_SEC * 3, \
+            "LAG cost still held after %ds" % (HOLD_MAX_SEC * 3)
+        sleep(0.2)
+
+
+def flap_burst(sw1, sw2, member, up_at_end):
+    """
+    Flap 'member' of the LAG on sw2 FLAPS times, leave it up or down, and
+    return the time until sw1 releases the LAG cost, the cost counters
+    and the reconfigurations sw1 made meanwhile.
+    """
+    cost_before = lag_cost(sw1)
+    reconfig_before = dyn_reconfig(sw1)
+    for flap in range(FLAPS):
+        set_member(sw2, member, False)
+        set_member(sw2, member, True)
+    if not up_at_end:
+        set_member(sw2, member, False)
+    released, cost = wait_released(sw1, time.time())
+    sleep(HELLO_TIME)
+    reconfig = dyn_reconfig(sw1)
+    for key in ['changes', 'damped']:
+        cost[key] -= cost_before[key]
+    return released, cost_before, cost, \
+        dict((key, reconfig[key] - reconfig_before[key]) for key in RESTARTS)
+
+
+def test_mstp_lag_flap(topology):
+    """
+    Bundle three links between sw1 and sw2 in a LAG next to a fourth
+    plain link. Flap one LAG member five times in a burst, once leaving it
+    up and once leaving it down. Print the speed changes sw1 saw, how many
+    were damped, the time until the cost was released and the tree and
+    port restarts it caused: most changes of a burst must be damped and
+    the cost released within the longest hold, a burst that ends at the
+    old speed must restart nothing, one that ends at a new speed must
+    restart once, and neither may re-initialize the protocol.
+    """
+    sw1 = topology.get('sw1')
+    sw2 = topology.get('sw2')
+
+    assert sw1 is not None
+    assert sw2 is not None
+
+    for sw in [sw1, sw2]:
+        create_lag(sw, [sw.ports['1'], sw.ports['2'], sw.ports['3']])
+        config_l2_interface(sw, sw.ports['4'])
+        config_mstp_region(sw, REGION_1, VERSION)
+    print("Waiting for LAG negotiations between switches")
+    sleep(60)
+
+    for sw in [sw1, sw2]:
+        with sw.libs.vtysh.Configure() as ctx:
+            ctx.spanning_tree()
+
+    # Covergence should happen with HELLO_TIME * 2
+    sleep(HELLO_TIME * 2)
+
+    print("Flap a member %d times, leave it up" % FLAPS)
+    released_back, before, back, reconfig_back = \
+        flap_burst(sw1, sw2, sw2.ports['3'], True)
+    print("Back to cost %d: %d speed changes, %d damped, released after "
+          "%.1fs, %d full, %d tree and %d port restarts" %
+          (back['applied'], back['changes'], back['damped'], released_back,
+           reconfig_back['full'], reconfig_back['trees'],
+           reconfig_back['ports']))
+
+    print("Flap a member %d times, leave it down" % FLAPS)
+    released_down, before_down, down, reconfig_down = \
+        flap_burst(sw1, sw2, sw2.ports['3'], False)
+    print("Down to cost %d: %d speed changes, %d damped, released after "
+          "%.1fs, %d full, %d tree and %d port restarts" %
+          (down['applied'], down['changes'], down['damped'], released_down,
+           reconfig_down['full'], reconfig_down['trees'],
+           reconfig_down['ports']))
+
+    assert back['changes'] > 1, "Member flaps not seen as speed changes"
+    assert back['damped'] > 0, "Speed flaps not damped"
+    for burst in [back, down]:
+        assert burst['damped'] * 2 >= burst['changes'], \
+            "Only %d of %d speed changes damped" % \
+            (burst['damped'], burst['changes'])
+    for released in [released_back, released_down]:
+        assert released <= HOLD_MAX_SEC + RELEASE_SLACK_SEC, \
+            "LAG cost held %.1fs after the burst, longest hold is %ds" % \
+            (released, HOLD_MAX_SEC)
+    assert back['applied'] == before['applied'], \
+        "LAG cost changed after settling back at its speed"
+    assert reconfig_back['trees'] + reconfig_back['ports'] == 0, \
+        "A burst ending at the old speed restarted the protocol"
+    assert down['applied'] == down['oper'] != before_down['applied'], \
+        "New LAG speed not applied to its cost"
+    assert reconfig_down['trees'] + reconfig_down['ports'] > 0, \
+        "New LAG cost did not restart the trees using it"
+    assert reconfig_down['trees'] <= 1, \
+        "A burst ending at a new speed restarted the trees more than once"
+    assert reconfig_back['full'] + reconfig_down['full'] == 0, \
+        "LAG speed flaps re-initialized the protocol"
+
+    set_member(sw2, sw2.ports['3'], True)
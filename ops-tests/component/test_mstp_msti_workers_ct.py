@@ -0,0 +1,204 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+"""
+OpenSwitch Test for the mstpd MSTI worker pool: time the MSTI root
+elections of a boundary port change against the number of workers.
+"""
+
+from __future__ import unicode_literals, absolute_import
+from __future__ import print_function, division
+
+import re
+import time
+from time import sleep
+
+from mstp_ct_helpers import appctl, config_l2_interface, config_mstp_region
+
+TOPOLOGY = """
+#
+# +-------+     +-------+
+# |       |     |       |
+# |       +-----+       |
+# | Sw1   +-----+   Sw2 |
+# |       |     |       |
+# +-------+     +-------+
+#
+# Nodes
+[type=openswitch name="OpenSwitch 1"] sw1
+[type=openswitch name="OpenSwitch 2"] sw2
+
+# Links
+sw1:1 -- sw2:1
+sw1:2 -- sw2:2
+"""
+
+HELLO_TIME = 2
+REGION_1 = "Region-One"
+REGION_2 = "Region-Two"
+VERSION = "8"
+# MSTP_INSTANCES_MAX in mstp_fsm.h
+MSTI_COUNT = 64
+WORKER_COUNTS = [0, 1, 2, 4, 8]
+FLAPS = 5
+LOW_PRIORITY = 1
+HIGH_PRIORITY = 15
+# The boundary syncs with the workers on may take this much longer than
+# with them off, at most: the handoff to the workers must not eat the
+# elections they take over
+SYNC_SLACK = 1.2
+
+
+def msti_workers(sw, arg=''):
+    output = appctl(sw, 'mstpd/daemon/msti_workers ' + arg)
+    result = re.search(r'MSTI workers\s*:\s*(?P<workers>\d+)\s*'
+                       r'\((?P<running>\d+) running\).*'
+                       r'Root elections\s*:\s*(?P<runs>\d+)\s*'
+                       r'\((?P<mstis>\d+) MSTIs, (?P<by_workers>\d+) by the '
+                       r'workers\).*'
+                       r'Election usec\s*:\s*last (?P<last>\d+), '
+                       r'max (?P<max>\d+), avg (?P<avg>\d+).*'
+                       r'Boundary syncs\s*:\s*(?P<syncs>\d+).*'
+                       r'Sync time usec\s*:\s*last (?P<sync_last>\d+), '
+                       r'max (?P<sync_max>\d+), avg (?P<sync_avg>\d+)',
+                       output, re.S)
+    assert result is not None, "Unexpected msti_workers output"
+    return dict((k, int(v)) for k, v in result.groupdict().items())
+
+
+def msti_port_roles(sw):
+    """
+    Role and state of ports 1 and 2 on every MSTI of 'sw'.
+    """
+    show = sw.libs.vtysh.show_spanning_tree_mst()
+    roles = {}
+    for mstid in range(1, MSTI_COUNT + 1):
+        mst = 'MST' + str(mstid)
+        for port in [sw.ports['1'], sw.ports['2']]:
+            roles[(mst, port)] = (show[mst][port]['role'],
+                                  show[mst][port]['State'])
+    return roles
+
+
+def flap_root(sw1, sw2):
+    """
+    Make sw2, outside sw1's region, the root and then give it up again.
+    Every time sw2 becomes the root sw1 gets superior information on its
+    boundary ports and re-elects the root of each MSTI.
+    """
+    with sw2.libs.vtysh.Configure() as ctx:
+        ctx.spanning_tree_priority(LOW_PRIORITY)
+    sleep(HELLO_TIME * 2)
+    with sw2.libs.vtysh.Configure() as ctx:
+        ctx.spanning_tree_priority(HIGH_PRIORITY)
+    sleep(HELLO_TIME * 2)
+
+
+def test_mstp_msti_workers(topology):
+    """
+    Put sw1 and sw2 in different regions, give sw1 64 MSTIs and move the
+    CIST root back and forth across the region boundary with 0, 1, 2, 4
+    and 8 MSTI workers. Print the time sw1 takes to sync its MSTIs with
+    the boundary port (election and role selection) and the parallel
+    election time for each worker count. The MSTI port roles must come
+    out the same with and without the pool, and the best sync time with
+    workers must be within SYNC_SLACK of the one without.
+    """
+    sw1 = topology.get('sw1')
+    sw2 = topology.get('sw2')
+
+    assert sw1 is not None
+    assert sw2 is not None
+
+    for sw in [sw1, sw2]:
+        config_l2_interface(sw, sw.ports['1'])
+        config_l2_interface(sw, sw.ports['2'])
+
+    config_mstp_region(sw1, REGION_1, VERSION)
+    config_mstp_region(sw2, REGION_2, VERSION)
+
+    print("Configure %d MSTIs on sw1" % MSTI_COUNT)
+    for mstid in range(1, MSTI_COUNT + 1):
+        with sw1.libs.vtysh.ConfigVlan(str(mstid + 1)) as ctx:
+            ctx.no_shutdown()
+        with sw1.libs.vtysh.Configure() as ctx:
+            ctx.spanning_tree_instance_vlan(mstid, mstid + 1)
+
+    for sw in [sw1, sw2]:
+        with sw.libs.vtysh.Configure() as ctx:
+            ctx.spanning_tree_priority(HIGH_PRIORITY)
+            ctx.spanning_tree()
+
+    # Covergence should happen with HELLO_TIME * 2
+    sleep(HELLO_TIME * 2)
+
+    results = []
+    roles_base = None
+    for workers in WORKER_COUNTS:
+        msti_workers(sw1, str(workers))
+        msti_workers(sw1, 'reset')
+        start = time.time()
+        for flap in range(FLAPS):
+            flap_root(sw1, sw2)
+        elapsed = time.time() - start
+        stats = msti_workers(sw1)
+        assert stats['workers'] == workers, "Worker count not applied"
+
+        with sw2.libs.vtysh.Configure() as ctx:
+            ctx.spanning_tree_priority(LOW_PRIORITY)
+        sleep(HELLO_TIME * 2)
+        roles = msti_port_roles(sw1)
+        with sw2.libs.vtysh.Configure() as ctx:
+            ctx.spanning_tree_priority(HIGH_PRIORITY)
+        sleep(HELLO_TIME * 2)
+
+        results.append((workers, stats))
+        print("%d workers: %d syncs avg %dus max %dus, %d root elections "
+              "(%d MSTIs, %d by workers) avg %dus max %dus, %.1fs for %d "
+              "flaps" % (workers, stats['syncs'], stats['sync_avg'],
+                         stats['sync_max'], stats['runs'], stats['mstis'],
+                         stats['by_workers'], stats['avg'], stats['max'],
+                         elapsed, FLAPS))
+
+        assert stats['syncs'] > 0, "No boundary port sync timed"
+        if workers:
+            assert stats['runs'] > 0, "No parallel election with workers"
+            assert stats['mstis'] >= stats['runs'] * MSTI_COUNT, \
+                "Parallel election did not cover every MSTI"
+        else:
+            assert stats['runs'] == 0, "Parallel election with no workers"
+        if roles_base is None:
+            roles_base = roles
+        else:
+            assert roles == roles_base, \
+                "MSTI port roles differ with %d workers" % workers
+
+    print("\n%8s %8s %10s %10s %10s" % ("Workers", "Syncs", "Sync avg",
+                                        "Sync max", "Elect avg"))
+    for workers, stats in results:
+        print("%8d %8d %8dus %8dus %8dus" %
+              (workers, stats['syncs'], stats['sync_avg'], stats['sync_max'],
+               stats['avg']))
+
+    serial = results[0][1]['sync_avg']
+    best = min(stats['sync_avg'] for workers, stats in results if workers)
+    print("Best sync with workers %dus against %dus without, speedup %.2f"
+          % (best, serial, serial / max(best, 1)))
+    assert best <= serial * SYNC_SLACK, \
+        "Boundary syncs %dus with the workers, %dus without" % (best, serial)
+
+    msti_workers(sw1, '0')
@@ -0,0 +1,181 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+"""
+OpenSwitch Test for the mstpd per-tree port arenas: measure the memory
+the port data of 64 MSTIs takes and check it is given back.
+"""
+
+from __future__ import unicode_literals, absolute_import
+from __future__ import print_function, division
+
+import re
+from time import sleep
+
+from mstp_ct_helpers import appctl, config_mstp_region
+
+TOPOLOGY = """
+#
+# +-------+
+# |       |
+# |  Sw1  |
+# |       |
+# +-------+
+#
+# Nodes
+[type=openswitch name="OpenSwitch 1"] sw1
+"""
+
+REGION_1 = "Region-One"
+VERSION = "8"
+# MSTP_INSTANCES_MAX in mstp_fsm.h
+MSTI_COUNT = 64
+# MSTP_PORT_ARENA_CHUNK and MSTP_CACHE_LINE_SIZE in mstpd_port_arena.c
+CHUNK_PORTS = 32
+CACHE_LINE = 64
+# MSTP_CIST_PORT_HOT_LINES and MSTP_MSTI_PORT_HOT_LINES in
+# mstpd_port_arena.c
+CIST_HOT_LINES = 4
+MSTI_HOT_LINES = 3
+# Resident growth allowed per MSTI on top of its port arena: the tree
+# data, its port pointer array and its OVSDB rows
+MSTI_OVERHEAD_KB = 64
+
+
+def port_memory(sw):
+    """
+    Struct sizes and the per-tree rows of the memory command, keyed by
+    'CIST', the MSTID or 'Total'.
+    """
+    output = appctl(sw, 'mstpd/daemon/memory')
+    result = re.search(r'CIST (?P<cist_hot>\d+) hot \+ (?P<cist_cold>\d+) '
+                       r'cold, MSTI (?P<msti_hot>\d+) hot \+ '
+                       r'(?P<msti_cold>\d+) cold bytes', output)
+    assert result is not None, "No port data sizes in memory output"
+    sizes = dict((k, int(v)) for k, v in result.groupdict().items())
+    trees = {}
+    for row in re.finditer(r'^(?P<tree>CIST|Total|\d+)\s+(?P<ports>\d+)\s+'
+                           r'(?P<chunks>\d+)\s+(?P<hot>\d+)\s+'
+                           r'(?P<cold>\d+)\s+(?P<per_port>\d+)\s*$',
+                           output, re.M):
+        trees[row.group('tree')] = dict(
+            (k, int(v)) for k, v in row.groupdict().items() if k != 'tree')
+    return sizes, trees
+
+
+def rss_kb(sw):
+    output = sw.send_command('grep VmRSS /proc/$(pidof ops-stpd)/status',
+                             shell='bash')
+    result = re.search(r'VmRSS:\s*(?P<rss>\d+) kB', output)
+    assert result is not None, "No resident size for ops-stpd"
+    return int(result.group('rss'))
+
+
+def slot_size(size):
+    return (size + CACHE_LINE - 1) // CACHE_LINE * CACHE_LINE
+
+
+def test_mstp_port_memory(topology):
+    """
+    Create 64 MSTIs, print the arena memory of each tree and the resident
+    size of the daemon before and after, and check every MSTI holds the
+    ports of the CIST in whole chunks, with the hot part of a port within
+    its cache lines, and the daemon grew by little more than the arenas.
+    Then remove the MSTIs and check their chunks are freed.
+    """
+    sw1 = topology.get('sw1')
+
+    assert sw1 is not None
+
+    config_mstp_region(sw1, REGION_1, VERSION)
+    with sw1.libs.vtysh.Configure() as ctx:
+        ctx.spanning_tree()
+    sleep(2)
+
+    sizes, trees = port_memory(sw1)
+    cist = trees['CIST']
+    rss_before = rss_kb(sw1)
+    print("Port data: CIST %d hot + %d cold, MSTI %d hot + %d cold bytes" %
+          (sizes['cist_hot'], sizes['cist_cold'], sizes['msti_hot'],
+           sizes['msti_cold']))
+    print("CIST: %d ports in %d chunks, %d hot + %d cold bytes" %
+          (cist['ports'], cist['chunks'], cist['hot'], cist['cold']))
+    assert cist['ports'] > 0, "No port in the CIST arena"
+    assert cist['hot'] == \
+        cist['chunks'] * CHUNK_PORTS * slot_size(sizes['cist_hot']), \
+        "CIST hot arena not made of cache line slots"
+    assert slot_size(sizes['cist_hot']) <= CIST_HOT_LINES * CACHE_LINE, \
+        "CIST hot port data is %d bytes, over %d cache lines" % \
+        (sizes['cist_hot'], CIST_HOT_LINES)
+    assert slot_size(sizes['msti_hot']) <= MSTI_HOT_LINES * CACHE_LINE, \
+        "MSTI hot port data is %d bytes, over %d cache lines" % \
+        (sizes['msti_hot'], MSTI_HOT_LINES)
+
+    print("Create %d MSTIs" % MSTI_COUNT)
+    for mstid in range(1, MSTI_COUNT + 1):
+        with sw1.libs.vtysh.ConfigVlan(str(mstid + 1)) as ctx:
+            ctx.no_shutdown()
+        with sw1.libs.vtysh.Configure() as ctx:
+            ctx.spanning_tree_instance_vlan(mstid, mstid + 1)
+    sleep(5)
+
+    sizes, trees = port_memory(sw1)
+    rss_after = rss_kb(sw1)
+    total = trees['Total']
+    msti_bytes = total['hot'] + total['cold'] - cist['hot'] - cist['cold']
+    print("%d MSTIs: %d ports in %d chunks, %d hot + %d cold bytes, "
+          "%d bytes per port" % (MSTI_COUNT, total['ports'] - cist['ports'],
+                                 total['chunks'] - cist['chunks'],
+                                 total['hot'] - cist['hot'],
+                                 total['cold'] - cist['cold'],
+                                 msti_bytes // max(total['ports'] -
+                                                   cist['ports'], 1)))
+    print("ops-stpd resident size: %d kB before, %d kB after (+%d kB), "
+          "%d kB of it port arenas" % (rss_before, rss_after,
+                                       rss_after - rss_before,
+                                       msti_bytes // 1024))
+
+    for mstid in range(1, MSTI_COUNT + 1):
+        tree = trees.get(str(mstid))
+        assert tree is not None, "MSTI %d has no port arena" % mstid
+        assert tree['ports'] == cist['ports'], \
+            "MSTI %d does not hold the ports of the CIST" % mstid
+        assert tree['chunks'] == cist['chunks'], \
+            "MSTI %d spans more chunks than the CIST" % mstid
+        assert tree['hot'] == \
+            tree['chunks'] * CHUNK_PORTS * slot_size(sizes['msti_hot']), \
+            "MSTI %d hot arena not made of cache line slots" % mstid
+        assert tree['cold'] == \
+            tree['chunks'] * CHUNK_PORTS * sizes['msti_cold'], \
+            "MSTI %d cold arena has the wrong size" % mstid
+    rss_max = msti_bytes // 1024 + MSTI_COUNT * MSTI_OVERHEAD_KB
+    assert rss_after - rss_before <= rss_max, \
+        "ops-stpd grew by %d kB for %d MSTIs, over %d kB" % \
+        (rss_after - rss_before, MSTI_COUNT, rss_max)
+
+    print("Remove the MSTIs")
+    for mstid in range(1, MSTI_COUNT + 1):
+        with sw1.libs.vtysh.Configure() as ctx:
+            ctx.no_spanning_tree_instance(mstid)
+    sleep(5)
+
+    sizes, trees = port_memory(sw1)
+    for mstid in range(1, MSTI_COUNT + 1):
+        assert str(mstid) not in trees, \
+            "MSTI %d port arena not freed" % mstid
+    assert trees['Total']['chunks'] == cist['chunks'], \
+        "Chunks left behind by the removed MSTIs"
@@ -0,0 +1,173 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+"""
+OpenSwitch Test for the mstpd region plan command.
+"""
+
+from __future__ import unicode_literals, absolute_import
+from __future__ import print_function, division
+
+import re
+from time import sleep
+
+from mstp_ct_helpers import appctl, config_l2_interface, config_mstp_region
+
+TOPOLOGY = """
+#
+# +-------+     +-------+
+# |       |     |       |
+# | Sw1   +-----+   Sw2 |
+# |       |     |       |
+# +-------+     +-------+
+#
+# Nodes
+[type=openswitch name="OpenSwitch 1"] sw1
+[type=openswitch name="OpenSwitch 2"] sw2
+
+# Links
+sw1:1 -- sw2:1
+"""
+
+HELLO_TIME = 2
+REGION_1 = "Region-One"
+VERSION = "8"
+# MSTP_RGN_PEER_AGE_MAX_SEC in mstp_fsm.h
+PEER_AGE_MAX_SEC = 30
+# 802.1Q-2011 13.7, all VLANs mapped to the CIST
+DIGEST_ALL_CIST = "0xAC36177F50283CD4B83821D8AB26DE62"
+# VLAN 10 mapped to MSTI 1, every other VLAN to the CIST
+DIGEST_VLAN10_MSTI1 = "0x870555C957F1B44530B7D56FD4716ADF"
+# MSTP_INSTANCES_MAX in mstp_fsm.h
+MSTI_COUNT = 64
+VLAN_MAX = 4094
+# A plan remapping the whole VLAN table must be evaluated within this
+PLAN_MAX_USEC = 10000
+
+
+def region_plan(sw, args=''):
+    return appctl(sw, 'mstpd/daemon/region_plan ' + args)
+
+
+def plan_digests(output):
+    result = re.search(r'Digest\s*:\s*(?P<cur>0x[0-9A-F]+)'
+                       r'(\s*->\s*(?P<plan>0x[0-9A-F]+))?', output)
+    assert result is not None, "No digest in region plan output"
+    return result.group('cur'), result.group('plan')
+
+
+def plan_neighbour(output, name):
+    result = re.search(r'^\s+\S+\s+' + re.escape(name) +
+                       r'\s+(?P<rev>\d+)\s+(?P<digest>0x[0-9A-F]+)\s+'
+                       r'(?P<now>\w+)\s+(?P<plan>\w+)\s*$', output, re.M)
+    assert result is not None, "Neighbour %s not in region plan" % name
+    return result.groupdict()
+
+
+def plan_usec(output):
+    result = re.search(r'Evaluated in (?P<usec>\d+) usec', output)
+    assert result is not None, "No evaluation time in region plan output"
+    return int(result.group('usec'))
+
+
+def test_mstp_region_plan(topology):
+    """
+    Put two switches in the same MST region and check the region plan of
+    sw1 against known VLAN maps: the digests must be the 802.1Q ones and
+    sw2 must be reported internal now and a boundary under a plan that
+    changes the VLAN map or the region name. A plan spreading all 4094
+    VLANs over 64 MSTIs must be evaluated within 10 msec.
+    """
+    sw1 = topology.get('sw1')
+    sw2 = topology.get('sw2')
+
+    assert sw1 is not None
+    assert sw2 is not None
+
+    config_l2_interface(sw1, sw1.ports['1'])
+    config_l2_interface(sw2, sw2.ports['1'])
+
+    for sw in [sw1, sw2]:
+        config_mstp_region(sw, REGION_1, VERSION)
+        with sw.libs.vtysh.Configure() as ctx:
+            ctx.spanning_tree()
+
+    # Covergence should happen with HELLO_TIME * 2
+    sleep(HELLO_TIME * 2)
+
+    print("Current mapping, no change planned")
+    output = region_plan(sw1)
+    cur, plan = plan_digests(output)
+    assert cur == DIGEST_ALL_CIST, "Digest of the CIST only map is wrong"
+    assert plan is None, "Digest changed without a planned change"
+    assert 'VLANs moved: 0' in output, "VLANs moved without a change"
+    peer = plan_neighbour(output, REGION_1)
+    assert peer['rev'] == VERSION, "Neighbour revision is wrong"
+    assert peer['digest'] == DIGEST_ALL_CIST, "Neighbour digest is wrong"
+    assert peer['now'] == 'internal' and peer['plan'] == 'internal', \
+        "Neighbour in the same region is not internal"
+
+    print("Plan VLAN 10 on MSTI 1")
+    output = region_plan(sw1, '1:10')
+    cur, plan = plan_digests(output)
+    assert cur == DIGEST_ALL_CIST and plan == DIGEST_VLAN10_MSTI1, \
+        "Digest of the planned map is wrong"
+    assert 'VLANs moved: 1' in output, "VLAN 10 not counted as moved"
+    assert re.search(r'^\s+0\s+0\s+1\s*$', output, re.M), \
+        "CIST does not lose VLAN 10"
+    assert re.search(r'^\s+1\s+1\s+0\s*$', output, re.M), \
+        "MSTI 1 does not gain VLAN 10"
+    peer = plan_neighbour(output, REGION_1)
+    assert peer['now'] == 'internal' and peer['plan'] == 'boundary', \
+        "Neighbour does not become a boundary with a new VLAN map"
+
+    print("Plan a new region name")
+    output = region_plan(sw1, 'name=Region-Two')
+    assert 'Name       : ' + REGION_1 + ' -> Region-Two' in output, \
+        "Planned name not shown"
+    cur, plan = plan_digests(output)
+    assert plan is None, "Digest changed with the VLAN map unchanged"
+    peer = plan_neighbour(output, REGION_1)
+    assert peer['plan'] == 'boundary', \
+        "Neighbour does not become a boundary with a new region name"
+
+    print("Plan all VLANs spread over %d MSTIs" % MSTI_COUNT)
+    step = VLAN_MAX // MSTI_COUNT
+    spread = ' '.join('%d:%d-%d' % (mstid, (mstid - 1) * step + 1,
+                                    VLAN_MAX if mstid == MSTI_COUNT
+                                    else mstid * step)
+                      for mstid in range(1, MSTI_COUNT + 1))
+    output = region_plan(sw1, spread)
+    usec = plan_usec(output)
+    print("Whole VLAN table evaluated in %d usec" % usec)
+    assert 'VLANs moved: %d' % VLAN_MAX in output, \
+        "Not every VLAN counted as moved"
+    assert usec <= PLAN_MAX_USEC, \
+        "Whole table plan evaluated in %d usec, over %d" % \
+        (usec, PLAN_MAX_USEC)
+
+    print("Steady state BPDUs keep the neighbour known")
+    sleep(PEER_AGE_MAX_SEC + HELLO_TIME * 2)
+    output = region_plan(sw1)
+    peer = plan_neighbour(output, REGION_1)
+    assert peer['now'] == 'internal', "Neighbour aged out in steady state"
+
+    print("Invalid plans are rejected")
+    output = region_plan(sw1, '65:10')
+    assert 'Invalid MSTID' in output, "MSTID out of range accepted"
+    output = region_plan(sw1, '1:4095')
+    assert 'Invalid VLAN list' in output, "VLAN out of range accepted"
@@ -0,0 +1,146 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+"""
+OpenSwitch Test for bulk VLAN creation and deletion: time how long mstpd
+takes to map every VLAN to the CIST and to unmap them again.
+"""
+
+from __future__ import unicode_literals, absolute_import
+from __future__ import print_function, division
+
+import re
+import time
+from time import sleep
+
+from mstp_ct_helpers import appctl, config_mstp_region
+
+TOPOLOGY = """
+#
+# +-------+
+# |       |
+# |  Sw1  |
+# |       |
+# +-------+
+#
+# Nodes
+[type=openswitch name="OpenSwitch 1"] sw1
+"""
+
+REGION_1 = "Region-One"
+VERSION = "8"
+VLAN_FIRST = 2
+VLAN_LAST = 4094
+SETTLE_TIMEOUT = 120
+# A bulk change has to settle this fast. One job and one CIST write per
+# VLAN took minutes for 4093 VLANs.
+SETTLE_MAX_SEC = 30
+
+# One ovs-vsctl transaction creating VLANs FIRST..LAST on the bridge
+CREATE_SCRIPT = ('args=""; for v in $(seq {first} {last}); do '
+                 'args="$args -- --id=@v$v create VLAN id=$v name=VLAN$v '
+                 'admin=up -- add Bridge bridge_normal vlans @v$v"; done; '
+                 'ovs-vsctl $args > /dev/null')
+
+# One ovs-vsctl transaction deleting them again
+DELETE_SCRIPT = ('args=""; for u in $(ovs-vsctl --bare --columns=_uuid '
+                 'find VLAN id\\>={first}); do '
+                 'args="$args -- remove Bridge bridge_normal vlans $u"; '
+                 'done; ovs-vsctl $args > /dev/null')
+
+
+def cist_vlan_count(sw):
+    output = sw.send_command('ovs-vsctl --bare --columns=vlans list '
+                             'MSTP_Common_Instance', shell='bash')
+    return len(re.findall(r'[0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-'
+                          r'[0-9a-f]{4}-[0-9a-f]{12}', output))
+
+
+def vlan_jobs(sw):
+    output = appctl(sw, 'mstpd/daemon/ovsdb_lock')
+    result = re.search(r'vlan add (?P<add>\d+), vlan delete (?P<delete>\d+)'
+                       r' \((?P<vlans>\d+) VLANs\)', output)
+    assert result is not None, "No VLAN job counters"
+    return dict((k, int(v)) for k, v in result.groupdict().items())
+
+
+def wait_cist_vlans(sw, count, start):
+    """
+    Return the seconds from 'start' until the CIST maps 'count' VLANs.
+    """
+    while time.time() - start < SETTLE_TIMEOUT:
+        if cist_vlan_count(sw) == count:
+            return time.time() - start
+        sleep(0.2)
+    assert False, "CIST does not map %d VLANs after %ds" % \
+        (count, SETTLE_TIMEOUT)
+
+
+def test_mstp_vlan_bulk(topology):
+    """
+    Create VLANs 2-4094 in one transaction, time until the CIST maps all
+    of them, then delete them in one transaction and time until the CIST
+    is back to VLAN 1. Print the VLAN jobs mstpd used for each step; the
+    VLANs of a step must be carried by a handful of jobs, not one each,
+    and each step must settle within SETTLE_MAX_SEC.
+    """
+    sw1 = topology.get('sw1')
+
+    assert sw1 is not None
+
+    config_mstp_region(sw1, REGION_1, VERSION)
+    with sw1.libs.vtysh.Configure() as ctx:
+        ctx.spanning_tree()
+    sleep(2)
+
+    base = cist_vlan_count(sw1)
+    count = VLAN_LAST - VLAN_FIRST + 1
+    jobs_before = vlan_jobs(sw1)
+
+    print("Create %d VLANs" % count)
+    start = time.time()
+    sw1.send_command(CREATE_SCRIPT.format(first=VLAN_FIRST, last=VLAN_LAST),
+                     shell='bash', timeout=SETTLE_TIMEOUT)
+    settle_add = wait_cist_vlans(sw1, base + count, start)
+    jobs_add = vlan_jobs(sw1)
+
+    print("Delete %d VLANs" % count)
+    start = time.time()
+    sw1.send_command(DELETE_SCRIPT.format(first=VLAN_FIRST),
+                     shell='bash', timeout=SETTLE_TIMEOUT)
+    settle_delete = wait_cist_vlans(sw1, base, start)
+    jobs_delete = vlan_jobs(sw1)
+
+    add_jobs = jobs_add['add'] - jobs_before['add']
+    delete_jobs = jobs_delete['delete'] - jobs_add['delete']
+    print("%d VLANs created: mapped in %.1fs by %d jobs" %
+          (count, settle_add, add_jobs))
+    print("%d VLANs deleted: unmapped in %.1fs by %d jobs" %
+          (count, settle_delete, delete_jobs))
+    print("%.0f VLANs/s created, %.0f VLANs/s deleted" %
+          (count / max(settle_add, 0.001), count / max(settle_delete, 0.001)))
+
+    assert jobs_add['vlans'] - jobs_before['vlans'] == count, \
+        "VLAN jobs did not carry every created VLAN"
+    assert jobs_delete['vlans'] - jobs_add['vlans'] == count, \
+        "VLAN jobs did not carry every deleted VLAN"
+    assert 0 < add_jobs < 10, "VLAN creations not batched"
+    assert 0 < delete_jobs < 10, "VLAN deletions not batched"
+    assert settle_add <= SETTLE_MAX_SEC, \
+        "%d VLAN creations took %.1fs" % (count, settle_add)
+    assert settle_delete <= SETTLE_MAX_SEC, \
+        "%d VLAN deletions took %.1fs" % (count, settle_delete)
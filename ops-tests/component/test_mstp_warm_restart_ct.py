@@ -0,0 +1,148 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+"""
+OpenSwitch Test for the mstpd warm restart checkpoint: time a restart of
+ops-stpd from a checkpoint against a cold one.
+"""
+
+from __future__ import unicode_literals, absolute_import
+from __future__ import print_function, division
+
+import re
+import time
+from time import sleep
+
+from mstp_ct_helpers import (STABLE_TIMEOUT, appctl, config_l2_interface,
+                             config_mstp_region, wait_stable)
+
+TOPOLOGY = """
+#
+# +-------+     +-------+
+# |       |     |       |
+# |       +-----+       |
+# | Sw1   +-----+   Sw2 |
+# |       |     |       |
+# +-------+     +-------+
+#
+# Nodes
+[type=openswitch name="OpenSwitch 1"] sw1
+[type=openswitch name="OpenSwitch 2"] sw2
+
+# Links
+sw1:1 -- sw2:1
+sw1:2 -- sw2:2
+"""
+
+HELLO_TIME = 2
+REGION_1 = "Region-One"
+VERSION = "8"
+# MSTP_CKPT_SHM_NAME in mstpd_ckpt.c
+CKPT_FILE = "/dev/shm/ops-stpd-ckpt"
+CKPT_INTERVAL = 1
+
+
+def warm_restart(sw, args=''):
+    return appctl(sw, 'mstpd/daemon/warm_restart ' + args)
+
+
+def topology_changes(sw):
+    output = sw.send_command('ovs-vsctl --bare '
+                             '--columns=topology_change_count list '
+                             'MSTP_Common_Instance', shell='bash')
+    result = re.search(r'(?P<count>\d+)', output)
+    return int(result.group('count')) if result else 0
+
+
+def restart(sw1, sw2):
+    """
+    Restart ops-stpd on sw1 and return the time both switches take to be
+    stable again, the states they settle in and the topology changes sw2
+    saw meanwhile.
+    """
+    tc = topology_changes(sw2)
+    start = time.time()
+    sw1.send_command('systemctl restart ops-stpd', shell='bash')
+    while 'Checkpoint' not in warm_restart(sw1):
+        assert time.time() - start < STABLE_TIMEOUT, "ops-stpd not back"
+        sleep(0.2)
+    stable, states = wait_stable([sw1, sw2], start)
+    return stable, states, topology_changes(sw2) - tc
+
+
+def test_mstp_warm_restart(topology):
+    """
+    Converge two switches, restart ops-stpd on sw1 from a checkpoint, then
+    again with the checkpoint removed. Print the time to stable and the
+    topology changes sw2 saw for each restart, and check the warm one
+    restored the ports to their roles and states without sw2 seeing a
+    topology change, and was stable sooner than the cold one.
+    """
+    sw1 = topology.get('sw1')
+    sw2 = topology.get('sw2')
+
+    assert sw1 is not None
+    assert sw2 is not None
+
+    for sw in [sw1, sw2]:
+        config_l2_interface(sw, sw.ports['1'])
+        config_l2_interface(sw, sw.ports['2'])
+        config_mstp_region(sw, REGION_1, VERSION)
+        with sw.libs.vtysh.Configure() as ctx:
+            ctx.spanning_tree()
+
+    warm_restart(sw1, 'interval %d' % CKPT_INTERVAL)
+    stable, states = wait_stable([sw1, sw2], time.time())
+    sleep(CKPT_INTERVAL * 2)
+    assert not re.search(r'Written\s*:\s*0 times', warm_restart(sw1)), \
+        "No checkpoint written"
+
+    print("Warm restart")
+    warm_stable, warm_states, warm_tc = restart(sw1, sw2)
+    output = warm_restart(sw1)
+    print(output)
+    assert 'Last start        : warm' in output, \
+        "Restart within the grace window was not warm"
+    restored = re.search(r'Restored\s*:\s*(?P<ports>\d+) ports', output)
+    assert restored is not None and int(restored.group('ports')) >= 2, \
+        "Checkpointed ports not restored"
+    daemon_stable = re.search(r'Restart to stable\s*:\s*(?P<msec>\d+) msec',
+                              output)
+
+    print("Cold restart")
+    warm_restart(sw1, 'interval 0')
+    sw1.send_command('rm -f ' + CKPT_FILE, shell='bash')
+    cold_stable, cold_states, cold_tc = restart(sw1, sw2)
+    output = warm_restart(sw1)
+    assert 'Last start        : cold' in output, \
+        "Restart without a checkpoint was not cold"
+    warm_restart(sw1, 'interval %d' % CKPT_INTERVAL)
+
+    print("Warm restart: stable in %.1fs (daemon %s msec), %d topology "
+          "changes on sw2" % (warm_stable, daemon_stable.group('msec')
+                              if daemon_stable else 'pending', warm_tc))
+    print("Cold restart: stable in %.1fs, %d topology changes on sw2" %
+          (cold_stable, cold_tc))
+    print("Warm restart %.1fx faster to stable" %
+          (cold_stable / max(warm_stable, 0.5)))
+
+    assert warm_states == states, \
+        "Port roles and states changed across the warm restart"
+    assert warm_tc == 0, "Warm restart caused a topology change on sw2"
+    assert warm_stable < cold_stable, \
+        "Warm restart stable in %.1fs, cold in %.1fs" % \
+        (warm_stable, cold_stable)
@@ -31,6 +31,7 @@
 #include "plugin-extensions.h"
 #include "asic-plugin.h"
 #include "switchd_stp.h"
+#include "mstp_trace.h"
 
 VLOG_DEFINE_THIS_MODULE(switchd_stp);
 
@@ -582,6 +583,76 @@ mstp_instance_add_del_vlans(const struct stp_blk_params *br,
 
 }
 
+/*------------------------------------------------------------------------------
+| Function:  mstp_trace_hw_state_of
+| Description: port state value used in the mstpd convergence trace
+| Parameters[in]: stp_state - MSTP_INST_PORT_STATE_xxx
+| Return: MSTP_TRACE_HW_STATE_xxx, MSTP_TRACE_HW_STATE_NONE if none matches
+-----------------------------------------------------------------------------*/
+static uint8_t
+mstp_trace_hw_state_of(int stp_state)
+{
+    switch (stp_state) {
+    case MSTP_INST_PORT_STATE_BLOCKED:
+        return MSTP_TRACE_HW_STATE_BLOCKING;
+    case MSTP_INST_PORT_STATE_LEARNING:
+        return MSTP_TRACE_HW_STATE_LEARNING;
+    case MSTP_INST_PORT_STATE_FORWARDING:
+        return MSTP_TRACE_HW_STATE_FORWARDING;
+    default:
+        return MSTP_TRACE_HW_STATE_NONE;
+    }
+}
+
+/*------------------------------------------------------------------------------
+| Function:  mstp_trace_hw_port_state
+| Description: record the hardware update of a port state in the mstpd
+|              convergence trace, once per event that changed it and only
+|              if the state programmed is the one the event's commit wrote
+| Parameters[in]: mstp_instance object
+| Parameters[in]: mstp_instance_port object
+| Parameters[out]: None
+| Return: None
+-----------------------------------------------------------------------------*/
+static void
+mstp_trace_hw_port_state(const struct mstp_instance *msti,
+                         const struct mstp_instance_port *mstp_port)
+{
+    MSTP_TRACE_SHM_t *shm = NULL;
+    uint64_t committed;
+    uint64_t event_id;
+    int lport;
+
+    if (!MSTP_CIST_INST_VALID(msti->instance_id)) {
+        return;
+    }
+
+    shm = mstp_trace_attach(false);
+    if (!mstp_trace_enabled(shm)) {
+        return;
+    }
+
+    lport = mstp_trace_find_lport(shm, mstp_port->name);
+    if (!lport) {
+        return;
+    }
+
+    committed = __atomic_load_n(&shm->hwCommitted[msti->instance_id][lport],
+                                __ATOMIC_ACQUIRE);
+    event_id = mstp_trace_hw_id(committed);
+    if (!event_id || (event_id == shm->hwDone[msti->instance_id][lport])) {
+        return;
+    }
+    if (mstp_trace_hw_state(committed) !=
+        mstp_trace_hw_state_of(mstp_port->stp_state)) {
+        return;
+    }
+    shm->hwDone[msti->instance_id][lport] = event_id;
+    mstp_trace_record(shm, MSTP_TRACE_WRITER_PLUGIN, MSTP_TRACE_STAGE_HW,
+                      event_id, msti->instance_id, lport,
+                      mstp_port->stp_state);
+}
+
 /*------------------------------------------------------------------------------
 | Function:  mstp_cist_and_instance_set_port_state
 | Description:  set port state in cist/msti
@@ -598,6 +669,7 @@ mstp_cist_and_instance_set_port_state(const struct stp_blk_params *br,
 {
     struct asic_plugin_interface *p_asic_interface = NULL;
     bool inform_stp_state = false;
+    bool hw_set = false;
     char *intf_name = NULL;
     struct mstp_instance_port_interfaces *pintf=NULL, *pintf_next=NULL;
 
@@ -622,8 +694,12 @@ mstp_cist_and_instance_set_port_state(const struct stp_blk_params *br,
                                                      msti->hw_stg_id,
                                                      mstp_port->stp_state,
                                                      inform_stp_state);
+                hw_set = true;
             }
         }
+        if (hw_set) {
+            mstp_trace_hw_port_state(msti, mstp_port);
+        }
     }
     else {
         VLOG_ERR("%s: unable to find asic plugin interface",__FUNCTION__);
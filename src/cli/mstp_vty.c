@@ -43,6 +43,7 @@
 #include "vtysh/vtysh_ovsdb_config.h"
 #include "vtysh/utils/ovsdb_vtysh_utils.h"
 #include "mstp_vty.h"
+#include "mstp_status.h"
 #include "vtysh_ovsdb_mstp_context.h"
 #include "ops-utils.h"
 
@@ -149,6 +150,80 @@ mstp_validateStrVlanNumber(const char *vlanStr)
 }
 
 
+/*-----------------------------------------------------------------------------
+ | Function:        mstp_cli_status_snapshot
+ | Responsibility:  Takes a lock-free copy of the operational status snapshot
+ |                  published by mstpd in shared memory.
+ | Return:
+ |      Pointer to the copy, NULL if mstpd has not published a usable one
+ |      (MSTP disabled, daemon stopped or snapshot older than
+ |      MSTP_STATUS_MAX_AGE_SEC), in which case callers fall back to the
+ |      OVSDB status columns.
+ ------------------------------------------------------------------------------
+ */
+static const MSTP_STATUS_SHM_t *
+mstp_cli_status_snapshot(void)
+{
+    static MSTP_STATUS_SHM_t *snap = NULL;
+    const MSTP_STATUS_SHM_t *shm = NULL;
+
+    shm = mstp_status_attach();
+    if (!shm) {
+        return NULL;
+    }
+
+    if (!snap) {
+        snap = xmalloc(sizeof *snap);
+    }
+
+    if (!mstp_status_read(shm, snap) || !mstp_status_is_current(snap)) {
+        return NULL;
+    }
+
+    return snap;
+}
+
+/*-----------------------------------------------------------------------------
+ | Function:        mstp_show_status_port_table
+ | Responsibility:  Displays the port role/state table of an instance from
+ |                  the status snapshot. Ports are listed in lport order.
+ | Parameters:
+ |      snap:       status snapshot copy
+ |      inst_id:    MSTP instance ID (MSTP_CISTID for the CIST)
+ |      name_width: width of the port name column
+ |      cist_ports: CIST port rows by port name, the Type column is taken
+ |                  from their link_type. NULL for MSTIs, which always show
+ |                  the default link type.
+ ------------------------------------------------------------------------------
+ */
+static void
+mstp_show_status_port_table(const MSTP_STATUS_SHM_t *snap, int inst_id,
+                            int name_width, const struct shash *cist_ports) {
+    const struct ovsrec_mstp_common_instance_port *cist_port = NULL;
+    const MSTP_STATUS_PORT_t *sp = NULL;
+    const char *link_type = NULL;
+    int lport = 0;
+
+    for (lport = 1; lport < MSTP_STATUS_MAX_PORTS; lport++) {
+        sp = &snap->ports[inst_id][lport];
+        if (!sp->valid || !snap->lports[lport].valid) {
+            continue;
+        }
+        link_type = DEF_LINK_TYPE;
+        if (cist_ports) {
+            cist_port = shash_find_data(cist_ports, snap->lports[lport].name);
+            if (cist_port && cist_port->link_type) {
+                link_type = cist_port->link_type;
+            }
+        }
+        vty_out(vty, "%-*s %-14s %-10s %-7u %-10d %s%s",
+                name_width, snap->lports[lport].name,
+                mstp_status_role_str(sp->role),
+                mstp_status_state_str(sp->state),
+                sp->pathCost, sp->priority, link_type, VTY_NEWLINE);
+    }
+}
+
 /*-----------------------------------------------------------------------------
  | Function:        mstp_print_port_statistics
  | Responsibility:  Displays port statistics
@@ -159,12 +234,25 @@ mstp_validateStrVlanNumber(const char *vlanStr)
  */
 static void
 mstp_print_port_statistics(const struct ovsrec_mstp_common_instance_port *cist_port) {
+    const MSTP_STATUS_SHM_t *snap = NULL;
+    int lport = 0;
 
     if(!cist_port) {
         VLOG_DBG("Invalid common instance port row %s: %d\n", __FILE__, __LINE__);
         return;
     }
 
+    snap = mstp_cli_status_snapshot();
+    if (snap && cist_port->port) {
+        lport = mstp_status_find_lport(snap, cist_port->port->name);
+    }
+    if (lport) {
+        vty_out(vty, "Bpdus sent %u, received %u%s",
+                snap->lports[lport].bpduTxCnt,
+                snap->lports[lport].bpduRxCnt, VTY_NEWLINE);
+        return;
+    }
+
     vty_out(vty, "Bpdus sent %d, received %d%s",
             smap_get_int(&cist_port->mstp_statistics, MSTP_TX_BPDU, 0),
             smap_get_int(&cist_port->mstp_statistics, MSTP_RX_BPDU, 0),
@@ -377,6 +465,7 @@ cli_show_spanning_tree_detailed_config(const struct ovsrec_mstp_common_instance
  */
 static int
 cli_show_spanning_tree_config(bool detail) {
+    const MSTP_STATUS_SHM_t *snap = NULL;
     const struct ovsrec_mstp_common_instance_port *cist_port;
     const struct ovsrec_mstp_common_instance *cist_row;
     const struct ovsrec_bridge *bridge_row = NULL;
@@ -462,6 +551,18 @@ cli_show_spanning_tree_config(bool detail) {
             return e_vtysh_ok;
         }
     }
+
+    /* Serve roles and states from mstpd's status snapshot when available,
+     * the link type is configuration and stays with the port rows */
+    snap = mstp_cli_status_snapshot();
+    if (snap && snap->trees[MSTP_CISTID].valid) {
+        mstp_show_status_port_table(snap, MSTP_CISTID, 12, &sorted_port_id);
+        shash_destroy(&sorted_port_id);
+        if(detail) {
+            cli_show_spanning_tree_detailed_config(cist_row);
+        }
+        return e_vtysh_ok;
+    }
     cist_port_nodes = sort_interface(&sorted_port_id);
     if (!cist_port_nodes) {
         shash_destroy(&sorted_port_id);
@@ -737,6 +838,7 @@ mstp_show_common_instance_port_info(
  */
 static int
 mstp_show_instance_info(int64_t inst_id, const struct ovsrec_mstp_instance *mstp_row) {
+    const MSTP_STATUS_SHM_t *snap = NULL;
     const struct ovsrec_system *system_row = NULL;
     const struct ovsrec_mstp_instance_port *mstp_port = NULL;
     int j = 0;
@@ -787,6 +889,13 @@ mstp_show_instance_info(int64_t inst_id, const struct ovsrec_mstp_instance *mstp
             "---------- ------- ---------- ----------",
             VTY_NEWLINE);
 
+    /* Serve the port table from mstpd's status snapshot when available */
+    snap = mstp_cli_status_snapshot();
+    if (snap && MSTP_VALID_MSTID(inst_id) && snap->trees[inst_id].valid) {
+        mstp_show_status_port_table(snap, inst_id, 14, NULL);
+        return e_vtysh_ok;
+    }
+
     shash_init(&sorted_port_id);
     for (j=0; j < mstp_row->n_mstp_instance_ports; j++) {
         mstp_port = mstp_row->mstp_instance_ports[j];
@@ -833,12 +942,13 @@ mstp_show_instance_info(int64_t inst_id, const struct ovsrec_mstp_instance *mstp
 static int
 cli_show_mst_interface(int inst_id, const char *if_name, bool detail) {
 
+    const MSTP_STATUS_SHM_t *snap = NULL;
     const struct ovsrec_bridge *bridge_row = NULL;
     const struct ovsrec_mstp_instance *mstp_row = NULL;
     const struct ovsrec_mstp_instance_port *mstp_port_row = NULL;
     const struct ovsrec_mstp_common_instance_port *cist_port = NULL;
     const struct ovsrec_mstp_common_instance *cist_row = NULL;
-    int i = 0;
+    int i = 0, lport = 0;
 
     bridge_row = ovsrec_bridge_first(idl);
     if (!bridge_row) {
@@ -934,7 +1044,17 @@ cli_show_mst_interface(int inst_id, const char *if_name, bool detail) {
                 "Instance", "Role", "State", "Cost", "Priority", "Vlans mapped", VTY_NEWLINE);
         vty_out(vty, "%s %s%s", "-------------- --------------",
                 "---------- ---------- ---------- ----------", VTY_NEWLINE);
-        if(inst_id != MSTP_CISTID) {
+        snap = mstp_cli_status_snapshot();
+        lport = mstp_status_find_lport(snap, if_name);
+        if (lport && snap->trees[inst_id].valid &&
+            snap->ports[inst_id][lport].valid) {
+            vty_out(vty, "%-14d %-14s %-10s %-10u %-11d", inst_id,
+                    mstp_status_role_str(snap->ports[inst_id][lport].role),
+                    mstp_status_state_str(snap->ports[inst_id][lport].state),
+                    snap->ports[inst_id][lport].pathCost,
+                    snap->ports[inst_id][lport].priority);
+        }
+        else if(inst_id != MSTP_CISTID) {
             vty_out(vty, "%-14d %-14s %-10s %-10ld %-11ld", inst_id,
                     mstp_port_row->port_role, mstp_port_row->port_state,
                     (*mstp_port_row->admin_path_cost != DEF_MSTP_COST)?*mstp_port_row->admin_path_cost:get_intf_link_cost(mstp_port_row->port),
@@ -323,7 +323,19 @@ int             key_len;		/* length of authentication key */
 uint8_t *       digest;			/* caller digest to be filled in */
 
 {
-    MD5_CTX context;
+    hmac_md5_ctxt hctx;
+
+    hmac_md5_init(&hctx, key, key_len);
+    hmac_md5_keyed(&hctx, text, text_len, digest);
+}
+
+/*
+ * Absorb the key XORed pads into the inner and outer MD5 states once, for
+ * any number of hmac_md5_keyed() calls with the key
+ */
+void
+hmac_md5_init(hmac_md5_ctxt *hctx, const unsigned char *key, int key_len)
+{
     unsigned char k_ipad[65];    /* inner padding -
 				 * key XORd with ipad
 				 */
@@ -367,20 +379,33 @@ uint8_t *       digest;			/* caller digest to be filled in */
        k_ipad[i] ^= 0x36;
        k_opad[i] ^= 0x5c;
     }
+
+    MD5Init(&hctx->hmac_ictx);
+    MD5Update(&hctx->hmac_ictx, k_ipad, 64);	/* inner pad, one block */
+    MD5Init(&hctx->hmac_octx);
+    MD5Update(&hctx->hmac_octx, k_opad, 64);	/* outer pad, one block */
+}
+
+/*
+ * HMAC-MD5 of 'text' with the key of 'hctx', which is not changed so one
+ * context can be shared by threads
+ */
+void
+hmac_md5_keyed(const hmac_md5_ctxt *hctx, const unsigned char *text,
+               int text_len, uint8_t *digest)
+{
+    MD5_CTX context;
+
     /*
      * perform inner MD5
      */
-    MD5Init(&context);			/* init context for 1st
-					 * pass */
-    MD5Update(&context, k_ipad, 64);	/* start with inner pad */
+    context = hctx->hmac_ictx;		/* pad already absorbed */
     MD5Update(&context, text, text_len); /* then text of datagram */
     MD5Final(digest, &context);	/* finish up 1st pass */
     /*
      * perform outer MD5
      */
-    MD5Init(&context);			/* init context for 2nd
-					 * pass */
-    MD5Update(&context, k_opad, 64);	/* start with outer pad */
+    context = hctx->hmac_octx;		/* pad already absorbed */
     MD5Update(&context, digest, 16);	/* then results of 1st
 					 * hash */
     MD5Final(digest, &context);	/* finish up 2nd pass */
@@ -129,3 +129,30 @@ mqueue_wait(mqueue_t *queue, void **data)
     return 0;
 
 } // mqueue_wait
+
+int
+mqueue_trywait(mqueue_t *queue, void **data)
+{
+    qelem_t *new_elem;
+
+    if ((NULL == queue) || (NULL == data)) {
+        return EINVAL;
+    }
+
+    // Do not block, EAGAIN if the queue is empty.
+    if (sem_trywait(&(queue->q_avail)) != 0) {
+        return errno;
+    }
+
+    pthread_mutex_lock(&(queue->q_mutex));
+    new_elem = queue->q_head.q_forw;
+    remque(queue->q_head.q_forw);
+    pthread_mutex_unlock(&(queue->q_mutex));
+
+    *data = new_elem->q_data;
+
+    free(new_elem);
+
+    return 0;
+
+} // mqueue_trywait
@@ -169,6 +169,18 @@ mstpd_init(const char *db_path, struct unixctl_server *appctl)
     sigfillset(&sigset);
     pthread_sigmask(SIG_BLOCK, &sigset, NULL);
 
+    /* Status snapshot must exist before the protocol thread publishes. */
+    mstp_statusInit();
+
+    /* Checkpoint must be taken before the OVSDB thread cleans the status. */
+    mstp_ckptInit();
+
+    /* DB outbox must exist before the protocol thread stages writes. */
+    mstp_dbOutboxInit();
+
+    /* Trace segment must exist before the RX thread stamps BPDUs. */
+    mstp_traceInit();
+
     /* Spawn off the main MSTP protocol thread. */
     rc = pthread_create(&mstpd_thread,
                         (pthread_attr_t *)NULL,
@@ -192,8 +204,22 @@ mstpd_init(const char *db_path, struct unixctl_server *appctl)
     unixctl_command_register("mstpd/daemon/msti_port", "msti port", 2, 2, mstpd_daemon_msti_port_unixctl_list, NULL);
     unixctl_command_register("mstpd/daemon/comm_port", "port", 1, 1, mstpd_daemon_comm_port_unixctl_list, NULL);
     unixctl_command_register("mstpd/daemon/mstp_debug_sm", "", 2, 2, mstpd_daemon_debug_sm_unixctl_list, NULL);
-    unixctl_command_register("mstpd/daemon/mstp_digest", "", 0, 0, mstpd_daemon_digest_unixctl_list, NULL);
+    unixctl_command_register("mstpd/daemon/mstp_digest", "[count]", 0, 1, mstpd_daemon_digest_unixctl_list, NULL);
     unixctl_command_register("mstpd/daemon/intf_to_mstp_map", "", 0, 1, mstpd_daemon_intf_to_mstp_map_unixctl_list, NULL);
+    unixctl_command_register("mstpd/daemon/status", "[msti]", 0, 1, mstpd_daemon_status_unixctl_list, NULL);
+    unixctl_command_register("mstpd/daemon/stats_interval", "[seconds]", 0, 1, mstpd_daemon_stats_interval_unixctl, NULL);
+    unixctl_command_register("mstpd/daemon/bpdu_fastpath", "[on|off|strict]", 0, 1, mstpd_daemon_bpdu_fastpath_unixctl, NULL);
+    unixctl_command_register("mstpd/daemon/rx_batch", "[max_bpdus max_usec]", 0, 2, mstpd_daemon_rx_batch_unixctl, NULL);
+    unixctl_command_register("mstpd/daemon/ovsdb_lock", "[reset]", 0, 1, mstpd_daemon_ovsdb_lock_unixctl, NULL);
+    unixctl_command_register("mstpd/lock-stats", "[enable|disable|reset]", 0, 1, mstpd_lock_stats_unixctl, NULL);
+    unixctl_command_register("mstpd/trace", "[enable|disable|reset|dump FILE]", 0, 2, mstpd_trace_unixctl, NULL);
+    unixctl_command_register("mstpd/sm-history", "[count]", 0, 1, mstpd_sm_history_unixctl, NULL);
+    unixctl_command_register("mstpd/daemon/bpdu_policer", "[reset]", 0, 1, mstpd_daemon_bpdu_policer_unixctl, NULL);
+    unixctl_command_register("mstpd/daemon/rx_socket", "[reset]", 0, 1, mstpd_daemon_rx_socket_unixctl, NULL);
+    unixctl_command_register("mstpd/daemon/msti_workers", "[count|reset]", 0, 1, mstpd_daemon_msti_workers_unixctl, NULL);
+    unixctl_command_register("mstpd/daemon/memory", "[msti]", 0, 1, mstpd_daemon_memory_unixctl, NULL);
+    unixctl_command_register("mstpd/daemon/warm_restart", "[interval N|grace N]", 0, 2, mstpd_daemon_warm_restart_unixctl, NULL);
+    unixctl_command_register("mstpd/daemon/region_plan", "[name=NAME] [revision=N] [MSTID:VLANS|MSTID:none]...", 0, MSTP_INSTANCES_MAX + 3, mstpd_daemon_region_plan_unixctl, NULL);
 
     INIT_DIAG_DUMP_BASIC(mstpd_diag_dump_basic_cb);
 
@@ -416,5 +442,8 @@ main(int argc, char *argv[])
         }
     }
 
+    /* Don't leave a snapshot behind that looks like a running daemon. */
+    mstp_statusShutdown();
+
     return 0;
 } /* main */
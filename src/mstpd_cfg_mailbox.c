@@ -0,0 +1,421 @@
+/*
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+/**********************************************************************************
+ *    File               : mstpd_cfg_mailbox.c
+ *    Description        : Hand-off of the config changes from the OVSDB thread
+ *                         to the protocol thread. The config updates are put
+ *                         in a batch keyed by (table, MSTI, port), a newer
+ *                         update of a key replacing the pending one in
+ *                         place, and the protocol thread is told once per
+ *                         batch. It applies the whole batch in one pass, in
+ *                         the order the keys were first put. Any other event
+ *                         the OVSDB thread sends closes the batch, so the
+ *                         config never overtakes it.
+ **********************************************************************************/
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <util.h>
+#include <hash.h>
+#include <hmap.h>
+#include <vswitch-idl.h>
+#include "mstp_fsm.h"
+#include "mstp_ovsdb_if.h"
+#include "mstp_cmn.h"
+
+/*---------------------------------------------------------------------------
+ * One pending update: the config struct of a message of type 'type' for
+ * the given tree and port, copied in 'data'.
+ *---------------------------------------------------------------------------*/
+typedef struct mstp_cfg_mbox_ent
+{
+   struct hmap_node           node;
+   struct mstp_cfg_mbox_ent  *next;             /* in put order          */
+   uint32_t                   type;
+   int                        mstid;
+   int                        lport;
+   bool                       dead;             /* dropped by an MSTI
+                                                 * delete put after it   */
+   size_t                     len;
+   uint64_t                   data[];
+
+} MSTP_CFG_MBOX_ENT_t;
+
+typedef struct mstp_cfg_mbox_batch
+{
+   struct mstp_cfg_mbox_batch *next;
+   uint64_t                    seq;
+   struct hmap                 ents;
+   MSTP_CFG_MBOX_ENT_t        *head;
+   MSTP_CFG_MBOX_ENT_t        *tail;
+   uint32_t                    entCnt;          /* live entries          */
+
+} MSTP_CFG_MBOX_BATCH_t;
+
+/* shared, protected by 'mstp_cfgMboxMutex' */
+static pthread_mutex_t         mstp_cfgMboxMutex = PTHREAD_MUTEX_INITIALIZER;
+static MSTP_CFG_MBOX_BATCH_t  *mstp_cfgMboxHead = NULL;
+static MSTP_CFG_MBOX_BATCH_t  *mstp_cfgMboxTail = NULL;
+static bool                    mstp_cfgMboxOpen = FALSE; /* tail takes puts */
+static uint64_t                mstp_cfgMboxSeq = 0;
+static MSTP_CFG_MBOX_STATS_t   mstp_cfgMboxStats;
+
+static void
+mstp_cfgMboxKey(uint32_t type, const void *data, int *mstid, int *lport)
+{
+   *mstid = 0;
+   *lport = 0;
+
+   switch(type)
+   {
+      case e_mstpd_cist_port_config:
+         *lport = ((const mstp_cist_port_config *)data)->port;
+         break;
+      case e_mstpd_msti_config:
+         *mstid = ((const mstp_msti_config *)data)->mstid;
+         break;
+      case e_mstpd_msti_port_config:
+         *mstid = ((const mstp_msti_port_config *)data)->mstid;
+         *lport = ((const mstp_msti_port_config *)data)->port;
+         break;
+      case e_mstpd_msti_config_delete:
+         *mstid = ((const mstp_msti_config_delete *)data)->mstid;
+         break;
+      default:
+         break;
+   }
+}
+
+static uint32_t
+mstp_cfgMboxHash(uint32_t type, int mstid, int lport)
+{
+   return hash_int(lport, hash_int(mstid, hash_int(type, 0)));
+}
+
+static MSTP_CFG_MBOX_ENT_t *
+mstp_cfgMboxFind(MSTP_CFG_MBOX_BATCH_t *batch, uint32_t type, int mstid,
+                 int lport)
+{
+   MSTP_CFG_MBOX_ENT_t *ent;
+
+   HMAP_FOR_EACH_WITH_HASH(ent, node, mstp_cfgMboxHash(type, mstid, lport),
+                           &batch->ents)
+   {
+      if((ent->type == type) && (ent->mstid == mstid) &&
+         (ent->lport == lport))
+         return ent;
+   }
+   return NULL;
+}
+
+static void
+mstp_cfgMboxBatchFree(MSTP_CFG_MBOX_BATCH_t *batch)
+{
+   MSTP_CFG_MBOX_ENT_t *ent;
+
+   while((ent = batch->head) != NULL)
+   {
+      batch->head = ent->next;
+      free(ent);
+   }
+   hmap_destroy(&batch->ents);
+   free(batch);
+}
+
+/*---------------------------------------------------------------------------
+ * An MSTI delete makes the updates of the MSTI and its ports put before
+ * it pointless; drop them so that the delete is all that is left.
+ *---------------------------------------------------------------------------*/
+static uint32_t
+mstp_cfgMboxDropMsti(MSTP_CFG_MBOX_BATCH_t *batch, int mstid)
+{
+   MSTP_CFG_MBOX_ENT_t *ent;
+   uint32_t             n = 0;
+
+   for(ent = batch->head; ent; ent = ent->next)
+   {
+      if(ent->dead || (ent->mstid != mstid) ||
+         ((ent->type != e_mstpd_msti_config) &&
+          (ent->type != e_mstpd_msti_port_config)))
+         continue;
+
+      hmap_remove(&batch->ents, &ent->node);
+      ent->dead = TRUE;
+      batch->entCnt--;
+      n++;
+   }
+   return n;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_cfgMboxPut
+ *
+ * Purpose:   OVSDB thread: hand a config update to the protocol thread. It
+ *            replaces the pending update of the same key in the open
+ *            batch, if any; otherwise it is added to the batch, a new one
+ *            being opened, and the protocol thread told, if there is no
+ *            open batch.
+ *
+ * Params:    type -> e_mstpd_global_config, e_mstpd_cist_config,
+ *                    e_mstpd_cist_port_config, e_mstpd_msti_config,
+ *                    e_mstpd_msti_port_config or e_mstpd_msti_config_delete
+ *            data -> the config struct of the message type
+ *            len  -> its size
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_cfgMboxHead, mstp_cfgMboxTail, mstp_cfgMboxOpen,
+ *            mstp_cfgMboxSeq, mstp_cfgMboxStats
+ **PROC-**********************************************************************/
+void
+mstp_cfgMboxPut(uint32_t type, const void *data, size_t len)
+{
+   MSTP_CFG_MBOX_BATCH_t *batch;
+   MSTP_CFG_MBOX_ENT_t   *ent;
+   mstpd_message         *msg = NULL;
+   mstp_config_batch     *notify;
+   int                    mstid;
+   int                    lport;
+
+   mstp_cfgMboxKey(type, data, &mstid, &lport);
+
+   pthread_mutex_lock(&mstp_cfgMboxMutex);
+   mstp_cfgMboxStats.putCnt++;
+
+   if(!mstp_cfgMboxOpen)
+   {
+      batch = xzalloc(sizeof(*batch));
+      hmap_init(&batch->ents);
+      batch->seq = ++mstp_cfgMboxSeq;
+      if(mstp_cfgMboxTail)
+         mstp_cfgMboxTail->next = batch;
+      else
+         mstp_cfgMboxHead = batch;
+      mstp_cfgMboxTail = batch;
+      mstp_cfgMboxOpen = TRUE;
+      mstp_cfgMboxStats.batchCnt++;
+
+      msg = xmalloc(sizeof(*msg) + sizeof(*notify));
+      msg->msg_type = e_mstpd_config_batch;
+      notify = (mstp_config_batch *)(msg + 1);
+      notify->seq = batch->seq;
+   }
+   batch = mstp_cfgMboxTail;
+
+   if(type == e_mstpd_msti_config_delete)
+      mstp_cfgMboxStats.coalescedCnt += mstp_cfgMboxDropMsti(batch, mstid);
+
+   ent = mstp_cfgMboxFind(batch, type, mstid, lport);
+   if(ent)
+   {
+      STP_ASSERT(ent->len == len);
+      memcpy(ent->data, data, len);
+      mstp_cfgMboxStats.coalescedCnt++;
+   }
+   else
+   {
+      ent = xmalloc(sizeof(*ent) + len);
+      ent->type = type;
+      ent->mstid = mstid;
+      ent->lport = lport;
+      ent->dead = FALSE;
+      ent->len = len;
+      ent->next = NULL;
+      memcpy(ent->data, data, len);
+      hmap_insert(&batch->ents, &ent->node,
+                  mstp_cfgMboxHash(type, mstid, lport));
+      if(batch->tail)
+         batch->tail->next = ent;
+      else
+         batch->head = ent;
+      batch->tail = ent;
+      batch->entCnt++;
+   }
+   pthread_mutex_unlock(&mstp_cfgMboxMutex);
+
+   if(msg)
+      mstpd_send_event(msg);
+}
+
+/*---------------------------------------------------------------------------
+ * OVSDB thread: an event other than a config update is about to be sent,
+ * the updates put after it must not be applied before it.
+ *---------------------------------------------------------------------------*/
+void
+mstp_cfgMboxSeal(void)
+{
+   pthread_mutex_lock(&mstp_cfgMboxMutex);
+   mstp_cfgMboxOpen = FALSE;
+   pthread_mutex_unlock(&mstp_cfgMboxMutex);
+}
+
+static void
+mstp_cfgMboxApply(const MSTP_CFG_MBOX_ENT_t *ent)
+{
+   mstpd_message msg;
+
+   msg.msg_type = ent->type;
+   msg.msg = (void *)ent->data;
+
+   switch(ent->type)
+   {
+      case e_mstpd_global_config:
+         update_mstp_global_config(&msg);
+         break;
+      case e_mstpd_cist_config:
+         update_mstp_cist_config(&msg);
+         break;
+      case e_mstpd_cist_port_config:
+         update_mstp_cist_port_config(&msg);
+         break;
+      case e_mstpd_msti_config:
+         update_mstp_msti_config(&msg);
+         break;
+      case e_mstpd_msti_port_config:
+         update_mstp_msti_port_config(&msg);
+         break;
+      case e_mstpd_msti_config_delete:
+         delete_mstp_msti_config(&msg);
+         break;
+      default:
+         STP_ASSERT(0);
+         break;
+   }
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_cfgMboxDeliver
+ *
+ * Purpose:   Protocol thread: take the batches up to the one of an
+ *            e_mstpd_config_batch message and apply their updates, or
+ *            throw them away while a config reload is pending. Taking the
+ *            batch closes it, later updates go to a new one.
+ *
+ * Params:    seq   -> sequence number carried by the message
+ *            apply -> FALSE to drop the batches
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_cfgMboxHead, mstp_cfgMboxTail, mstp_cfgMboxOpen,
+ *            mstp_cfgMboxStats
+ **PROC-**********************************************************************/
+void
+mstp_cfgMboxDeliver(uint64_t seq, bool apply)
+{
+   MSTP_CFG_MBOX_BATCH_t *taken = NULL;
+   MSTP_CFG_MBOX_BATCH_t *batch;
+   MSTP_CFG_MBOX_ENT_t   *ent;
+   uint64_t               start;
+   uint64_t               usec;
+   uint32_t               n = 0;
+
+   pthread_mutex_lock(&mstp_cfgMboxMutex);
+   if(mstp_cfgMboxHead && (mstp_cfgMboxHead->seq <= seq))
+   {
+      taken = mstp_cfgMboxHead;
+      for(batch = taken; batch->next && (batch->next->seq <= seq);
+          batch = batch->next)
+         ;
+      mstp_cfgMboxHead = batch->next;
+      batch->next = NULL;
+      if(!mstp_cfgMboxHead)
+      {
+         mstp_cfgMboxTail = NULL;
+         mstp_cfgMboxOpen = FALSE;
+      }
+   }
+   pthread_mutex_unlock(&mstp_cfgMboxMutex);
+
+   if(!taken)
+      return;
+
+   start = mstp_utilMonoUsec();
+   while((batch = taken) != NULL)
+   {
+      taken = batch->next;
+      if(apply)
+      {
+         for(ent = batch->head; ent; ent = ent->next)
+         {
+            if(!ent->dead)
+               mstp_cfgMboxApply(ent);
+         }
+         n += batch->entCnt;
+      }
+      mstp_cfgMboxBatchFree(batch);
+   }
+   usec = mstp_utilMonoUsec() - start;
+
+   pthread_mutex_lock(&mstp_cfgMboxMutex);
+   if(apply)
+   {
+      mstp_cfgMboxStats.deliverCnt++;
+      mstp_cfgMboxStats.appliedCnt += n;
+      if(n > mstp_cfgMboxStats.maxBatch)
+         mstp_cfgMboxStats.maxBatch = n;
+      mstp_cfgMboxStats.lastUsec = usec;
+      if(usec > mstp_cfgMboxStats.maxUsec)
+         mstp_cfgMboxStats.maxUsec = usec;
+   }
+   else
+   {
+      mstp_cfgMboxStats.droppedCnt++;
+   }
+   pthread_mutex_unlock(&mstp_cfgMboxMutex);
+}
+
+/*---------------------------------------------------------------------------
+ * Protocol thread, on a config re-init: throw away all the pending
+ * updates, the whole config is sent again.
+ *---------------------------------------------------------------------------*/
+void
+mstp_cfgMboxReset(void)
+{
+   MSTP_CFG_MBOX_BATCH_t *batch;
+   MSTP_CFG_MBOX_BATCH_t *taken;
+
+   pthread_mutex_lock(&mstp_cfgMboxMutex);
+   taken = mstp_cfgMboxHead;
+   mstp_cfgMboxHead = NULL;
+   mstp_cfgMboxTail = NULL;
+   mstp_cfgMboxOpen = FALSE;
+   pthread_mutex_unlock(&mstp_cfgMboxMutex);
+
+   while((batch = taken) != NULL)
+   {
+      taken = batch->next;
+      mstp_cfgMboxBatchFree(batch);
+   }
+}
+
+void
+mstp_cfgMboxStatsGet(MSTP_CFG_MBOX_STATS_t *stats, uint32_t *pending,
+                     bool reset)
+{
+   MSTP_CFG_MBOX_BATCH_t *batch;
+
+   pthread_mutex_lock(&mstp_cfgMboxMutex);
+   *stats = mstp_cfgMboxStats;
+   *pending = 0;
+   for(batch = mstp_cfgMboxHead; batch; batch = batch->next)
+      *pending += batch->entCnt;
+   if(reset)
+      memset(&mstp_cfgMboxStats, 0, sizeof(mstp_cfgMboxStats));
+   pthread_mutex_unlock(&mstp_cfgMboxMutex);
+}
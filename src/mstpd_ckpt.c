@@ -0,0 +1,851 @@
+/*
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+/**********************************************************************************
+ *    File               : mstpd_ckpt.c
+ *    Description        : Warm restart checkpoint. The protocol thread
+ *                         periodically copies the roles, states, priority
+ *                         vectors and timers of every enabled port on every
+ *                         tree into a shared memory segment, which outlives
+ *                         the daemon but not a reboot. A daemon started
+ *                         within the grace window of the last checkpoint
+ *                         leaves the port states in DB as they are, and
+ *                         puts each port back in its checkpointed state when
+ *                         the port is enabled, instead of taking it through
+ *                         the Disabled, Discarding and Learning states again.
+ *                         Ports not enabled within the grace window get the
+ *                         state the daemon has for them by then.
+ **********************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <util.h>
+#include <vswitch-idl.h>
+#include <openvswitch/vlog.h>
+#include "mstp_fsm.h"
+#include "mstp_inlines.h"
+#include "mstp.h"
+
+VLOG_DEFINE_THIS_MODULE(mstpd_ckpt);
+
+#define MSTP_CKPT_SHM_NAME      "/ops-stpd-ckpt"
+#define MSTP_CKPT_MAGIC         0x4d53434bu      /* "MSCK" */
+#define MSTP_CKPT_VERSION       1
+#define MSTP_CKPT_ENTRIES_MAX   (MAX_LPORTS * (MSTP_INSTANCES_MAX + 1))
+
+/* the per-tree bit maps are checkpointed as one word */
+BUILD_ASSERT_DECL(MSTP_CIST_PORT_BIT_MAP_MAX <= 32);
+BUILD_ASSERT_DECL(MSTP_MSTI_PORT_BIT_MAP_MAX <= 32);
+BUILD_ASSERT_DECL(MSTP_PORT_BIT_MAP_MAX <= 32);
+
+/* State of a port on a tree */
+typedef struct mstp_ckpt_entry
+{
+   uint16_t                    mstid;
+   uint16_t                    lport;
+   MSTP_PORT_ID_t              portId;
+   uint8_t                     infoIs;
+   uint8_t                     role;
+   uint8_t                     fdWhile;
+   uint8_t                     rrWhile;
+   uint8_t                     rbWhile;
+   uint32_t                    bitMap;           /* per-tree bit map     */
+   uint32_t                    commBitMap;       /* common bit map       */
+   uint32_t                    intPathCost;
+   uint32_t                    extPathCost;
+   MSTP_BRIDGE_IDENTIFIER_t    bridgeId;         /* of the tree          */
+   union
+   {
+      struct
+      {
+         MSTP_CIST_PORT_PRI_VECTOR_t       portPriority;
+         MSTP_CIST_PORT_TIMES_t            portTimes;
+         MSTP_CIST_DESIGNATED_PRI_VECTOR_t designatedPriority;
+         MSTP_CIST_DESIGNATED_TIMES_t      designatedTimes;
+      } cist;
+      struct
+      {
+         MSTP_MSTI_PORT_PRI_VECTOR_t       portPriority;
+         MSTP_MSTI_PORT_TIMES_t            portTimes;
+         MSTP_MSTI_DESIGNATED_PRI_VECTOR_t designatedPriority;
+         MSTP_MSTI_DESIGNATED_TIMES_t      designatedTimes;
+      } msti;
+   } u;
+
+} MSTP_CKPT_ENTRY_t;
+
+/* Shared memory layout. The entries are in lport order, the CIST entry of
+ * a port first, followed by its MSTI entries in MSTID order. */
+typedef struct mstp_ckpt_shm
+{
+   uint32_t                    magic;
+   uint32_t                    version;
+   uint32_t                    entrySize;
+   uint32_t                    seq;              /* odd while written    */
+   uint64_t                    stampUsec;        /* monotonic, of the
+                                                  * last write           */
+   uint32_t                    grace;            /* in effect when
+                                                  * written              */
+   uint32_t                    entries;
+   MSTP_MST_CONFIGURATION_ID_t mstConfigId;
+   MSTP_CKPT_ENTRY_t           entry[MSTP_CKPT_ENTRIES_MAX];
+
+} MSTP_CKPT_SHM_t;
+
+/* The checkpoint found at start, while ports are being restored from it */
+typedef struct mstp_ckpt_image
+{
+   MSTP_MST_CONFIGURATION_ID_t mstConfigId;
+   MSTP_CKPT_ENTRY_t          *entry;
+   uint32_t                    first[MAX_LPORTS + 1];
+   uint16_t                    count[MAX_LPORTS + 1];
+   PORT_MAP                    held;             /* ports whose DB state
+                                                  * is left as it was    */
+   bool                        reselect[MSTP_INSTANCES_MAX + 1];
+   uint64_t                    startUsec;
+   uint64_t                    releaseUsec;      /* end of the grace     */
+
+} MSTP_CKPT_IMAGE_t;
+
+/* CIST and MSTI port variables taken from the checkpoint, the others start
+ * cleared */
+static const int mstp_ckptCistBits[] =
+{
+   MSTP_CIST_PORT_AGREE, MSTP_CIST_PORT_AGREED, MSTP_CIST_PORT_SYNCED,
+   MSTP_CIST_PORT_FORWARD, MSTP_CIST_PORT_FORWARDING,
+   MSTP_CIST_PORT_LEARN, MSTP_CIST_PORT_LEARNING,
+};
+
+static const int mstp_ckptMstiBits[] =
+{
+   MSTP_MSTI_PORT_AGREE, MSTP_MSTI_PORT_AGREED, MSTP_MSTI_PORT_SYNCED,
+   MSTP_MSTI_PORT_FORWARD, MSTP_MSTI_PORT_FORWARDING,
+   MSTP_MSTI_PORT_LEARN, MSTP_MSTI_PORT_LEARNING,
+   MSTP_MSTI_PORT_MASTER, MSTP_MSTI_PORT_MASTERED,
+};
+
+static const int mstp_ckptCommBits[] =
+{
+   MSTP_PORT_INFO_INTERNAL, MSTP_PORT_RCVD_INTERNAL,
+};
+
+static MSTP_CKPT_SHM_t   *mstp_ckptShm = NULL;
+static MSTP_CKPT_IMAGE_t *mstp_ckptImage = NULL;  /* NULL once all the
+                                                   * ports are restored or
+                                                   * released and the
+                                                   * trees reselected    */
+static uint64_t           mstp_ckptLastUsec = 0;
+
+/* set from unixctl */
+static uint32_t mstp_ckptInterval = MSTP_CKPT_INTERVAL_DEF;
+static uint32_t mstp_ckptGrace = MSTP_CKPT_GRACE_DEF;
+
+/* protocol thread, except for the copy taken by 'mstp_ckptStatsGet' */
+static MSTP_CKPT_STATS_t  mstp_ckptStats;
+static pthread_mutex_t    mstp_ckptLock = PTHREAD_MUTEX_INITIALIZER;
+
+/**PROC+**********************************************************************
+ * Name:      mstp_ckptLoad
+ *
+ * Purpose:   Copy the checkpoint a previous instance of the daemon left in
+ *            the segment, if it is complete and within its grace window,
+ *            and index it by port
+ *
+ * Params:    none
+ *
+ * Returns:   the image, NULL if there is nothing to restore
+ *
+ * Globals:   mstp_ckptShm, mstp_ckptStats
+ **PROC-**********************************************************************/
+static MSTP_CKPT_IMAGE_t *
+mstp_ckptLoad(void)
+{
+   MSTP_CKPT_SHM_t   *shm = mstp_ckptShm;
+   MSTP_CKPT_IMAGE_t *img;
+   MSTP_CKPT_ENTRY_t *e;
+   uint64_t           now;
+   uint64_t           age;
+   uint32_t           entries;
+   uint32_t           i;
+
+   if((shm->magic != MSTP_CKPT_MAGIC) ||
+      (shm->version != MSTP_CKPT_VERSION) ||
+      (shm->entrySize != sizeof(MSTP_CKPT_ENTRY_t)))
+      return NULL;
+
+   /*------------------------------------------------------------------------
+    * a write interrupted by the daemon going down leaves 'seq' odd
+    *------------------------------------------------------------------------*/
+   entries = shm->entries;
+   if((shm->seq & 1) || (entries == 0) || (entries > MSTP_CKPT_ENTRIES_MAX))
+      return NULL;
+
+   now = mstp_utilMonoUsec();
+   age = (now > shm->stampUsec) ? (now - shm->stampUsec) : 0;
+   if(age > (uint64_t)shm->grace * 1000000)
+   {
+      VLOG_INFO("%s: checkpoint is %"PRIu64" msec old, past its %u sec "
+                "grace, starting cold", __FUNCTION__, age / 1000, shm->grace);
+      return NULL;
+   }
+
+   img = xzalloc(sizeof(*img));
+   img->entry = xmalloc(entries * sizeof(MSTP_CKPT_ENTRY_t));
+   memcpy(img->entry, shm->entry, entries * sizeof(MSTP_CKPT_ENTRY_t));
+   img->mstConfigId = shm->mstConfigId;
+   img->startUsec = now;
+   img->releaseUsec = now + (uint64_t)shm->grace * 1000000;
+
+   for(i = 0; i < entries; i++)
+   {
+      e = &img->entry[i];
+      if(!IS_VALID_LPORT(e->lport) || (e->mstid > MSTP_INSTANCES_MAX))
+         continue;
+      if(e->mstid == MSTP_CISTID)
+      {
+         img->first[e->lport] = i;
+         img->count[e->lport] = 1;
+         set_port(&img->held, e->lport);
+      }
+      else if(img->count[e->lport] &&
+              (img->first[e->lport] + img->count[e->lport] == i))
+      {
+         img->count[e->lport]++;
+      }
+   }
+
+   mstp_ckptStats.warm = TRUE;
+   mstp_ckptStats.ckptAgeUsec = age;
+   mstp_ckptStats.heldPorts = get_num_of_ports_set(&img->held);
+   VLOG_INFO("%s: warm start from a %"PRIu64" msec old checkpoint of %u "
+             "ports", __FUNCTION__, age / 1000, mstp_ckptStats.heldPorts);
+
+   return img;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_ckptInit
+ *
+ * Purpose:   Map the checkpoint segment and take the checkpoint a previous
+ *            instance of the daemon left in it. Must be called before the
+ *            protocol and OVSDB threads start.
+ *
+ * Params:    none
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_ckptShm, mstp_ckptImage
+ **PROC-**********************************************************************/
+void
+mstp_ckptInit(void)
+{
+   void *addr;
+   int   fd;
+
+   fd = shm_open(MSTP_CKPT_SHM_NAME, O_CREAT | O_RDWR, 0600);
+   if(fd < 0)
+   {
+      VLOG_ERR("%s: shm_open failed (%s), warm restart disabled",
+               __FUNCTION__, strerror(errno));
+      return;
+   }
+
+   if(ftruncate(fd, sizeof(MSTP_CKPT_SHM_t)) < 0)
+   {
+      VLOG_ERR("%s: ftruncate failed (%s), warm restart disabled",
+               __FUNCTION__, strerror(errno));
+      close(fd);
+      return;
+   }
+
+   addr = mmap(NULL, sizeof(MSTP_CKPT_SHM_t), PROT_READ | PROT_WRITE,
+               MAP_SHARED, fd, 0);
+   close(fd);
+   if(addr == MAP_FAILED)
+   {
+      VLOG_ERR("%s: mmap failed (%s), warm restart disabled",
+               __FUNCTION__, strerror(errno));
+      return;
+   }
+
+   mstp_ckptShm = (MSTP_CKPT_SHM_t *)addr;
+   mstp_ckptImage = mstp_ckptLoad();
+}
+
+/* TRUE if the daemon started from a checkpoint; DB keeps the port states */
+bool
+mstp_ckptWarmStart(void)
+{
+   return mstp_ckptStats.warm;
+}
+
+/* Protocol thread: take the restart-to-stable time once the last held
+ * port is restored or released */
+static void
+mstp_ckptStable(void)
+{
+   uint64_t usec;
+
+   if(are_any_ports_set(&mstp_ckptImage->held) || mstp_ckptStats.stableUsec)
+      return;
+
+   usec = mstp_utilMonoUsec() - mstp_ckptImage->startUsec;
+   VLOG_INFO("%s: warm restart done in %"PRIu64" msec", __FUNCTION__,
+             usec / 1000);
+
+   pthread_mutex_lock(&mstp_ckptLock);
+   mstp_ckptStats.stableUsec = usec ? usec : 1;
+   pthread_mutex_unlock(&mstp_ckptLock);
+}
+
+/* Queue the DB state of 'lport' on 'mstid' from its forwarding state */
+static void
+mstp_ckptQueueState(MSTID_t mstid, LPORT_t lport, bool forwarding,
+                    bool learning)
+{
+   if(forwarding)
+      mstp_updtMstiPortStateChgMsg(mstid, lport, MSTP_ACT_ENABLE_FORWARDING);
+   else if(learning)
+      mstp_updtMstiPortStateChgMsg(mstid, lport, MSTP_ACT_ENABLE_LEARNING);
+   else
+      mstp_updtMstiPortStateChgMsg(mstid, lport, MSTP_ACT_DISABLE_FORWARDING);
+}
+
+static MSTP_PRT_STATE_t
+mstp_ckptPrtState(MSTP_PORT_ROLE_t role)
+{
+   switch(role)
+   {
+      case MSTP_PORT_ROLE_ROOT:
+         return MSTP_PRT_STATE_ROOT_PORT;
+      case MSTP_PORT_ROLE_DESIGNATED:
+         return MSTP_PRT_STATE_DESIGNATED_PORT;
+      case MSTP_PORT_ROLE_MASTER:
+         return MSTP_PRT_STATE_MASTER_PORT;
+      case MSTP_PORT_ROLE_ALTERNATE:
+         return MSTP_PRT_STATE_ALTERNATE_PORT;
+      case MSTP_PORT_ROLE_BACKUP:
+         return MSTP_PRT_STATE_BACKUP_PORT;
+      default:
+         return MSTP_PRT_STATE_DISABLED_PORT;
+   }
+}
+
+/* Port State Transition and Topology Change state from the port's bits */
+static void
+mstp_ckptFollowStates(MSTP_PORT_ROLE_t role, bool forwarding, bool learning,
+                      MSTP_PST_STATE_t *pstState, MSTP_TCM_STATE_t *tcmState)
+{
+   if(forwarding)
+      *pstState = MSTP_PST_STATE_FORWARDING;
+   else if(learning)
+      *pstState = MSTP_PST_STATE_LEARNING;
+   else
+      *pstState = MSTP_PST_STATE_DISCARDING;
+
+   if(forwarding && ((role == MSTP_PORT_ROLE_ROOT) ||
+                     (role == MSTP_PORT_ROLE_DESIGNATED) ||
+                     (role == MSTP_PORT_ROLE_MASTER)))
+      *tcmState = MSTP_TCM_STATE_ACTIVE;
+   else
+      *tcmState = MSTP_TCM_STATE_INACTIVE;
+}
+
+static void
+mstp_ckptRestoreCist(const MSTP_CKPT_ENTRY_t *e, LPORT_t lport)
+{
+   MSTP_CIST_PORT_INFO_t *cistPortPtr = MSTP_CIST_PORT_PTR(lport);
+   bool                   fwd;
+   bool                   lrn;
+   uint32_t               i;
+
+   cistPortPtr->portPriority = e->u.cist.portPriority;
+   cistPortPtr->portTimes = e->u.cist.portTimes;
+   cistPortPtr->designatedPriority = e->u.cist.designatedPriority;
+   cistPortPtr->designatedTimes = e->u.cist.designatedTimes;
+   cistPortPtr->msgPriority = e->u.cist.portPriority;
+   cistPortPtr->msgTimes = e->u.cist.portTimes;
+   cistPortPtr->infoIs = e->infoIs;
+   cistPortPtr->role = e->role;
+   cistPortPtr->selectedRole = e->role;
+   mstp_statusPortChg(MSTP_CISTID, lport);
+
+   memset(cistPortPtr->bitMap, 0, sizeof(cistPortPtr->bitMap));
+   for(i = 0; i < ARRAY_SIZE(mstp_ckptCistBits); i++)
+   {
+      if(MSTP_CIST_PORT_IS_BIT_SET(&e->bitMap, mstp_ckptCistBits[i]))
+         MSTP_CIST_PORT_SET_BIT(cistPortPtr->bitMap, mstp_ckptCistBits[i]);
+   }
+   MSTP_CIST_PORT_SET_BIT(cistPortPtr->bitMap, MSTP_CIST_PORT_RESELECT);
+
+   cistPortPtr->fdWhile = e->fdWhile;
+   cistPortPtr->rrWhile = e->rrWhile;
+   cistPortPtr->rbWhile = e->rbWhile;
+   cistPortPtr->tcWhile = 0;
+   if(e->infoIs == MSTP_INFO_IS_RECEIVED)
+      mstp_updtRcvdInfoWhile(MSTP_CISTID, lport);
+
+   fwd = MSTP_CIST_PORT_IS_BIT_SET(cistPortPtr->bitMap,
+                                   MSTP_CIST_PORT_FORWARDING);
+   lrn = MSTP_CIST_PORT_IS_BIT_SET(cistPortPtr->bitMap,
+                                   MSTP_CIST_PORT_LEARNING);
+   cistPortPtr->pimState = MSTP_PIM_STATE_CURRENT;
+   cistPortPtr->prtState = mstp_ckptPrtState(e->role);
+   mstp_ckptFollowStates(e->role, fwd, lrn, &cistPortPtr->pstState,
+                         &cistPortPtr->tcmState);
+   mstp_ckptQueueState(MSTP_CISTID, lport, fwd, lrn);
+}
+
+static void
+mstp_ckptRestoreMsti(const MSTP_CKPT_ENTRY_t *e, LPORT_t lport)
+{
+   MSTP_MSTI_PORT_INFO_t *mstiPortPtr = MSTP_MSTI_PORT_PTR(e->mstid, lport);
+   bool                   fwd;
+   bool                   lrn;
+   uint32_t               i;
+
+   mstiPortPtr->portPriority = e->u.msti.portPriority;
+   mstiPortPtr->portTimes = e->u.msti.portTimes;
+   mstiPortPtr->designatedPriority = e->u.msti.designatedPriority;
+   mstiPortPtr->designatedTimes = e->u.msti.designatedTimes;
+   mstiPortPtr->msgPriority = e->u.msti.portPriority;
+   mstiPortPtr->msgTimes = e->u.msti.portTimes;
+   mstiPortPtr->infoIs = e->infoIs;
+   mstiPortPtr->role = e->role;
+   mstiPortPtr->selectedRole = e->role;
+   mstp_statusPortChg(e->mstid, lport);
+
+   memset(mstiPortPtr->bitMap, 0, sizeof(mstiPortPtr->bitMap));
+   for(i = 0; i < ARRAY_SIZE(mstp_ckptMstiBits); i++)
+   {
+      if(MSTP_MSTI_PORT_IS_BIT_SET(&e->bitMap, mstp_ckptMstiBits[i]))
+         MSTP_MSTI_PORT_SET_BIT(mstiPortPtr->bitMap, mstp_ckptMstiBits[i]);
+   }
+   MSTP_MSTI_PORT_SET_BIT(mstiPortPtr->bitMap, MSTP_MSTI_PORT_RESELECT);
+
+   mstiPortPtr->fdWhile = e->fdWhile;
+   mstiPortPtr->rrWhile = e->rrWhile;
+   mstiPortPtr->rbWhile = e->rbWhile;
+   mstiPortPtr->tcWhile = 0;
+   if(e->infoIs == MSTP_INFO_IS_RECEIVED)
+      mstp_updtRcvdInfoWhile(e->mstid, lport);
+
+   fwd = MSTP_MSTI_PORT_IS_BIT_SET(mstiPortPtr->bitMap,
+                                   MSTP_MSTI_PORT_FORWARDING);
+   lrn = MSTP_MSTI_PORT_IS_BIT_SET(mstiPortPtr->bitMap,
+                                   MSTP_MSTI_PORT_LEARNING);
+   mstiPortPtr->pimState = MSTP_PIM_STATE_CURRENT;
+   mstiPortPtr->prtState = mstp_ckptPrtState(e->role);
+   mstp_ckptFollowStates(e->role, fwd, lrn, &mstiPortPtr->pstState,
+                         &mstiPortPtr->tcmState);
+   mstp_ckptQueueState(e->mstid, lport, fwd, lrn);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_ckptRestorePort
+ *
+ * Purpose:   Protocol thread, on port enable: if the port is in the
+ *            checkpoint the daemon started from, and its Bridge, Port
+ *            Identifiers and path costs are still the same, put it back in
+ *            its checkpointed role, state, priority vectors and timers on
+ *            the CIST and on every MSTI it was on. The Port Information
+ *            state machines are left Current, role selection of the trees
+ *            is rerun at the next tick from the restored vectors, and the
+ *            port is marked to send a BPDU. A port that no longer matches
+ *            goes through the state machines as on a cold start.
+ *
+ * Params:    lport -> logical port number
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_ckptImage, mstp_ckptStats
+ **PROC-**********************************************************************/
+void
+mstp_ckptRestorePort(LPORT_t lport)
+{
+   MSTP_CKPT_IMAGE_t     *img = mstp_ckptImage;
+   MSTP_COMM_PORT_INFO_t *commPortPtr;
+   MSTP_CIST_PORT_INFO_t *cistPortPtr;
+   MSTP_CKPT_ENTRY_t     *e;
+   uint32_t               cells = 0;
+   uint32_t               i;
+   MSTID_t                mstid;
+
+   if(!img || !is_port_set(&img->held, lport))
+      return;
+   clear_port(&img->held, lport);
+
+   commPortPtr = MSTP_COMM_PORT_PTR(lport);
+   cistPortPtr = MSTP_CIST_PORT_PTR(lport);
+   e = &img->entry[img->first[lport]];
+   if(!commPortPtr || !cistPortPtr ||
+      memcmp(&img->mstConfigId, &mstp_Bridge.MstConfigId,
+             sizeof(img->mstConfigId)) ||
+      memcmp(&e->bridgeId, &MSTP_CIST_BRIDGE_IDENTIFIER,
+             sizeof(e->bridgeId)) ||
+      (e->portId != cistPortPtr->portId) ||
+      (e->intPathCost != cistPortPtr->InternalPortPathCost) ||
+      (e->extPathCost != commPortPtr->ExternalPortPathCost))
+   {
+      pthread_mutex_lock(&mstp_ckptLock);
+      mstp_ckptStats.skippedPorts++;
+      pthread_mutex_unlock(&mstp_ckptLock);
+      mstp_ckptStable();
+      return;
+   }
+
+   for(i = 0; i < ARRAY_SIZE(mstp_ckptCommBits); i++)
+   {
+      if(MSTP_COMM_PORT_IS_BIT_SET(&e->commBitMap, mstp_ckptCommBits[i]))
+         MSTP_COMM_PORT_SET_BIT(commPortPtr->bitMap, mstp_ckptCommBits[i]);
+      else
+         MSTP_COMM_PORT_CLR_BIT(commPortPtr->bitMap, mstp_ckptCommBits[i]);
+   }
+   MSTP_COMM_PORT_CLR_BIT(commPortPtr->bitMap, MSTP_PORT_FDB_FLUSH);
+
+   mstp_ckptRestoreCist(e, lport);
+   img->reselect[MSTP_CISTID] = TRUE;
+   cells++;
+
+   for(i = 1; i < img->count[lport]; i++)
+   {
+      e = &img->entry[img->first[lport] + i];
+      mstid = e->mstid;
+      if(!MSTP_MSTI_VALID(mstid) || !MSTP_MSTI_PORT_PTR(mstid, lport) ||
+         memcmp(&e->bridgeId, &MSTP_MSTI_BRIDGE_IDENTIFIER(mstid),
+                sizeof(e->bridgeId)) ||
+         (e->portId != MSTP_MSTI_PORT_PTR(mstid, lport)->portId) ||
+         (e->intPathCost !=
+          MSTP_MSTI_PORT_PTR(mstid, lport)->InternalPortPathCost))
+         continue;
+
+      mstp_ckptRestoreMsti(e, lport);
+      img->reselect[mstid] = TRUE;
+      cells++;
+   }
+
+   /*------------------------------------------------------------------------
+    * let the neighbours hear from the port right away
+    *------------------------------------------------------------------------*/
+   MSTP_COMM_PORT_SET_BIT(commPortPtr->bitMap, MSTP_PORT_NEW_INFO);
+   MSTP_COMM_PORT_SET_BIT(commPortPtr->bitMap, MSTP_PORT_NEW_INFO_MSTI);
+
+   pthread_mutex_lock(&mstp_ckptLock);
+   mstp_ckptStats.restoredPorts++;
+   mstp_ckptStats.restoredCells += cells;
+   pthread_mutex_unlock(&mstp_ckptLock);
+   mstp_ckptStable();
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_ckptHoldMask
+ *
+ * Purpose:   Protocol thread: drop the DB state changes and MAC flushes
+ *            queued in a tree message for the ports that are still waiting
+ *            to be restored, so DB keeps the state they had before the
+ *            restart
+ *
+ * Params:    m -> tree message about to be written to DB
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_ckptImage
+ **PROC-**********************************************************************/
+void
+mstp_ckptHoldMask(MSTP_TREE_MSG_t *m)
+{
+   PORT_MAP *held;
+
+   if(!mstp_ckptImage || (m->mstid > MSTP_INSTANCES_MAX))
+      return;
+
+   held = &mstp_ckptImage->held;
+   bit_sub_port_maps(held, &m->portsFwd);
+   bit_sub_port_maps(held, &m->portsLrn);
+   bit_sub_port_maps(held, &m->portsBlk);
+   bit_sub_port_maps(held, &m->portsUp);
+   bit_sub_port_maps(held, &m->portsDwn);
+   bit_sub_port_maps(held, &m->portsMacAddrFlush);
+}
+
+/* Protocol thread: give DB the daemon's own state of the ports not enabled
+ * within the grace window */
+static void
+mstp_ckptRelease(void)
+{
+   MSTP_CKPT_IMAGE_t     *img = mstp_ckptImage;
+   MSTP_CIST_PORT_INFO_t *cistPortPtr;
+   MSTP_MSTI_PORT_INFO_t *mstiPortPtr;
+   uint32_t               released = 0;
+   MSTID_t                mstid;
+   int                    lport;
+
+   for(lport = find_first_port_set(&img->held); IS_VALID_LPORT(lport);
+       lport = find_next_port_set(&img->held, lport))
+   {
+      released++;
+      cistPortPtr = MSTP_ENABLED ? MSTP_CIST_PORT_PTR(lport) : NULL;
+      if(!cistPortPtr)
+         continue;
+
+      mstp_ckptQueueState(MSTP_CISTID, lport,
+                          MSTP_CIST_PORT_IS_BIT_SET(cistPortPtr->bitMap,
+                                                    MSTP_CIST_PORT_FORWARDING),
+                          MSTP_CIST_PORT_IS_BIT_SET(cistPortPtr->bitMap,
+                                                    MSTP_CIST_PORT_LEARNING));
+      for(mstid = MSTP_MSTID_MIN; mstid <= MSTP_INSTANCES_MAX; mstid++)
+      {
+         if(!MSTP_MSTI_VALID(mstid))
+            continue;
+         mstiPortPtr = MSTP_MSTI_PORT_PTR(mstid, lport);
+         if(!mstiPortPtr)
+            continue;
+         mstp_ckptQueueState(mstid, lport,
+                             MSTP_MSTI_PORT_IS_BIT_SET(mstiPortPtr->bitMap,
+                                                   MSTP_MSTI_PORT_FORWARDING),
+                             MSTP_MSTI_PORT_IS_BIT_SET(mstiPortPtr->bitMap,
+                                                   MSTP_MSTI_PORT_LEARNING));
+      }
+   }
+   clear_port_map(&img->held);
+
+   VLOG_INFO("%s: %u checkpointed ports not enabled within the grace window",
+             __FUNCTION__, released);
+   pthread_mutex_lock(&mstp_ckptLock);
+   mstp_ckptStats.releasedPorts += released;
+   pthread_mutex_unlock(&mstp_ckptLock);
+   mstp_ckptStable();
+}
+
+/* Protocol thread: copy the state of the enabled ports into the segment */
+static void
+mstp_ckptWrite(void)
+{
+   MSTP_CKPT_SHM_t       *shm = mstp_ckptShm;
+   MSTP_COMM_PORT_INFO_t *commPortPtr;
+   MSTP_CIST_PORT_INFO_t *cistPortPtr;
+   MSTP_MSTI_PORT_INFO_t *mstiPortPtr;
+   MSTP_CKPT_ENTRY_t     *e;
+   uint32_t               n = 0;
+   uint64_t               start;
+   uint64_t               usec;
+   MSTID_t                mstid;
+   LPORT_t                lport;
+
+   start = mstp_utilMonoUsec();
+
+   __atomic_store_n(&shm->seq, shm->seq + 1, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+
+   for(lport = 1; MSTP_ENABLED && (lport <= MAX_LPORTS); lport++)
+   {
+      commPortPtr = MSTP_COMM_PORT_PTR(lport);
+      cistPortPtr = MSTP_CIST_PORT_PTR(lport);
+      if(!commPortPtr || !cistPortPtr ||
+         !MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap,
+                                    MSTP_PORT_PORT_ENABLED) ||
+         ((cistPortPtr->infoIs != MSTP_INFO_IS_RECEIVED) &&
+          (cistPortPtr->infoIs != MSTP_INFO_IS_MINE)))
+         continue;
+
+      e = &shm->entry[n++];
+      e->mstid = MSTP_CISTID;
+      e->lport = lport;
+      e->portId = cistPortPtr->portId;
+      e->infoIs = cistPortPtr->infoIs;
+      e->role = cistPortPtr->role;
+      e->fdWhile = cistPortPtr->fdWhile;
+      e->rrWhile = cistPortPtr->rrWhile;
+      e->rbWhile = cistPortPtr->rbWhile;
+      e->bitMap = cistPortPtr->bitMap[0];
+      e->commBitMap = commPortPtr->bitMap[0];
+      e->intPathCost = cistPortPtr->InternalPortPathCost;
+      e->extPathCost = commPortPtr->ExternalPortPathCost;
+      e->bridgeId = MSTP_CIST_BRIDGE_IDENTIFIER;
+      e->u.cist.portPriority = cistPortPtr->portPriority;
+      e->u.cist.portTimes = cistPortPtr->portTimes;
+      e->u.cist.designatedPriority = cistPortPtr->designatedPriority;
+      e->u.cist.designatedTimes = cistPortPtr->designatedTimes;
+
+      for(mstid = MSTP_MSTID_MIN; mstid <= MSTP_INSTANCES_MAX; mstid++)
+      {
+         if(!MSTP_MSTI_VALID(mstid))
+            continue;
+         mstiPortPtr = MSTP_MSTI_PORT_PTR(mstid, lport);
+         if(!mstiPortPtr ||
+            ((mstiPortPtr->infoIs != MSTP_INFO_IS_RECEIVED) &&
+             (mstiPortPtr->infoIs != MSTP_INFO_IS_MINE)))
+            continue;
+
+         e = &shm->entry[n++];
+         e->mstid = mstid;
+         e->lport = lport;
+         e->portId = mstiPortPtr->portId;
+         e->infoIs = mstiPortPtr->infoIs;
+         e->role = mstiPortPtr->role;
+         e->fdWhile = mstiPortPtr->fdWhile;
+         e->rrWhile = mstiPortPtr->rrWhile;
+         e->rbWhile = mstiPortPtr->rbWhile;
+         e->bitMap = mstiPortPtr->bitMap[0];
+         e->commBitMap = commPortPtr->bitMap[0];
+         e->intPathCost = mstiPortPtr->InternalPortPathCost;
+         e->extPathCost = commPortPtr->ExternalPortPathCost;
+         e->bridgeId = MSTP_MSTI_BRIDGE_IDENTIFIER(mstid);
+         e->u.msti.portPriority = mstiPortPtr->portPriority;
+         e->u.msti.portTimes = mstiPortPtr->portTimes;
+         e->u.msti.designatedPriority = mstiPortPtr->designatedPriority;
+         e->u.msti.designatedTimes = mstiPortPtr->designatedTimes;
+      }
+   }
+
+   shm->magic = MSTP_CKPT_MAGIC;
+   shm->version = MSTP_CKPT_VERSION;
+   shm->entrySize = sizeof(MSTP_CKPT_ENTRY_t);
+   shm->grace = __atomic_load_n(&mstp_ckptGrace, __ATOMIC_RELAXED);
+   shm->entries = n;
+   shm->mstConfigId = mstp_Bridge.MstConfigId;
+   shm->stampUsec = mstp_utilMonoUsec();
+   __atomic_store_n(&shm->seq, shm->seq + 1, __ATOMIC_RELEASE);
+
+   usec = shm->stampUsec - start;
+   pthread_mutex_lock(&mstp_ckptLock);
+   mstp_ckptStats.writeCnt++;
+   mstp_ckptStats.lastEntries = n;
+   mstp_ckptStats.lastWriteUsec = usec;
+   if(usec > mstp_ckptStats.maxWriteUsec)
+      mstp_ckptStats.maxWriteUsec = usec;
+   pthread_mutex_unlock(&mstp_ckptLock);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_ckptTick
+ *
+ * Purpose:   Protocol thread, on every timer tick: rerun role selection on
+ *            the trees ports were restored on since the last tick, release
+ *            the ports not enabled within the grace window, and write the
+ *            checkpoint when it is due. Nothing is written until the
+ *            checkpoint the daemon started from is fully used, so a
+ *            restart in the meantime still finds it.
+ *
+ * Params:    none
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_ckptImage, mstp_ckptLastUsec
+ **PROC-**********************************************************************/
+void
+mstp_ckptTick(void)
+{
+   MSTP_CKPT_IMAGE_t *img = mstp_ckptImage;
+   uint32_t           interval;
+   uint64_t           now;
+   MSTID_t            mstid;
+
+   if(!mstp_ckptShm)
+      return;
+
+   now = mstp_utilMonoUsec();
+   if(img)
+   {
+      for(mstid = MSTP_CISTID; mstid <= MSTP_INSTANCES_MAX; mstid++)
+      {
+         if(img->reselect[mstid] && MSTP_ENABLED &&
+            MSTP_INSTANCE_IS_VALID(mstid))
+            mstp_prsSm(mstid);
+         img->reselect[mstid] = FALSE;
+      }
+      if(now >= img->releaseUsec)
+         mstp_ckptRelease();
+      if(are_any_ports_set(&img->held))
+         return;
+
+      mstp_ckptStable();
+      free(img->entry);
+      free(img);
+      mstp_ckptImage = NULL;
+   }
+
+   interval = __atomic_load_n(&mstp_ckptInterval, __ATOMIC_RELAXED);
+   if((interval == 0) ||
+      (now - mstp_ckptLastUsec < (uint64_t)interval * 1000000))
+      return;
+
+   mstp_ckptLastUsec = now;
+   mstp_ckptWrite();
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_ckptSetInterval
+ *
+ * Purpose:   Set how often the checkpoint is written
+ *
+ * Params:    interval -> seconds, 0 stops checkpointing
+ *
+ * Returns:   FALSE if out of range
+ *
+ * Globals:   mstp_ckptInterval
+ **PROC-**********************************************************************/
+bool
+mstp_ckptSetInterval(uint32_t interval)
+{
+   if(interval > MSTP_CKPT_INTERVAL_MAX)
+      return FALSE;
+
+   __atomic_store_n(&mstp_ckptInterval, interval, __ATOMIC_RELAXED);
+   return TRUE;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_ckptSetGrace
+ *
+ * Purpose:   Set how long after its last write a checkpoint may be restored
+ *            from, and how long the restored daemon waits for the
+ *            checkpointed ports to be enabled. Saved with the checkpoint,
+ *            so the value in effect before a restart applies to it.
+ *
+ * Params:    grace -> seconds
+ *
+ * Returns:   FALSE if out of range
+ *
+ * Globals:   mstp_ckptGrace
+ **PROC-**********************************************************************/
+bool
+mstp_ckptSetGrace(uint32_t grace)
+{
+   if((grace < MSTP_CKPT_GRACE_MIN) || (grace > MSTP_CKPT_GRACE_MAX))
+      return FALSE;
+
+   __atomic_store_n(&mstp_ckptGrace, grace, __ATOMIC_RELAXED);
+   return TRUE;
+}
+
+void
+mstp_ckptStatsGet(MSTP_CKPT_STATS_t *stats)
+{
+   pthread_mutex_lock(&mstp_ckptLock);
+   *stats = mstp_ckptStats;
+   pthread_mutex_unlock(&mstp_ckptLock);
+   stats->interval = __atomic_load_n(&mstp_ckptInterval, __ATOMIC_RELAXED);
+   stats->grace = __atomic_load_n(&mstp_ckptGrace, __ATOMIC_RELAXED);
+}
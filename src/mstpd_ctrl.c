@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <net/if.h>
 #include <arpa/inet.h>
 #include <sys/epoll.h>
@@ -34,6 +35,7 @@
 #include <util.h>
 #include <openvswitch/vlog.h>
 #include <assert.h>
+#include <eventlog.h>
 
 #include <mqueue.h>
 #include "mstp.h"
@@ -68,6 +70,41 @@ bool mstp_enable = false;
 /* Message Queue for MSTPD main protocol thread */
 mqueue_t mstpd_main_rcvq;
 
+/* BPDU batch drain limits, set from unixctl (see mstp_setRxBatchLimits) */
+static uint32_t mstp_rx_batch_max = MSTP_RX_BATCH_MAX_DEF;
+static uint32_t mstp_rx_batch_usec = MSTP_RX_BATCH_USEC_DEF;
+
+/* BPDU ingress policer of a port. 'rate' and 'burst' are set by the OVSDB
+ * thread, the counters are read by the other threads; the rest belongs to
+ * the RX thread. */
+typedef struct mstp_rx_policer {
+    uint32_t rate;              /* BPDUs per second, 0 = not policed */
+    uint32_t burst;             /* bucket depth, BPDUs */
+    uint64_t dropCnt;
+    uint64_t exceedCnt;
+    bool     exceeding;         /* dropping since the last exceed event */
+    uint32_t curRate;           /* RX thread: rate the bucket was filled at */
+    uint32_t curBurst;
+    uint64_t tokens;            /* RX thread: MSTP_RX_POLICER_TOKEN per BPDU */
+    uint64_t lastUsec;          /* RX thread: last refill */
+    uint64_t lastDropUsec;      /* RX thread */
+    uint64_t episodeDropCnt;    /* RX thread: drops since 'exceeding' set */
+} MSTP_RX_POLICER_t;
+
+/* Tokens are kept in millionths of a BPDU so that a refill is exact for
+ * any elapsed time in microseconds. */
+#define MSTP_RX_POLICER_TOKEN         1000000ULL
+/* Longest idle time accounted in one refill, keeps the product in range */
+#define MSTP_RX_POLICER_MAX_IDLE_USEC 10000000ULL
+/* A port is back under its rate after this long without a drop */
+#define MSTP_RX_POLICER_QUIET_USEC    1000000ULL
+
+static MSTP_RX_POLICER_t mstp_rx_policer[MAX_LPORTS + 1];
+
+/* Kernel counters of the BPDU sockets. Reading PACKET_STATISTICS clears
+ * them, so the OVSDB thread, which owns the sockets, adds them up here. */
+static MSTP_RX_SOCK_STATS_t mstp_rx_sock_stats[MAX_LPORTS + 1];
+
 
 /* epoll FD for MSTP PDU RX. */
 int epfd = -1;
@@ -79,35 +116,91 @@ int epfd = -1;
 
 /* MSTP filter
  *
- * Berkeley Packet Filter to receive MSTP BPDU from interfaces.
- *
- * MSTP: "ether dst 01:80:c2:00:00:00"
- *
- *    tcpdump -dd "(ether dst 01:80:c2:00:00:00)"
+ * Berkeley Packet Filter to receive MSTP BPDU from interfaces. Only frames
+ * that can pass 'mstp_validateBpdu' wake the RX thread: 802.3 frames to
+ * 01:80:c2:00:00:00 with LLC 0x42/0x42/0x03 and protocol id 0, holding
+ * all of the BPDU their length field announces, and long enough for the
+ * BPDU type and version they carry (802.1Q-REV/D5.0 14.4). The length
+ * field counts the 3 LLC octets as well as the BPDU.
  *
- * low-level BPF filter code:
- * (000) ld       [2]          ; load 4 bytes from Dst MAC offset 2
- * (001) jeq      #0xc2000000  ; compare 4 bytes, move to next instruction if equal
- * (002) ldh      [0]          ; load 4 bytes from Dst MAC offset 0
- * (003) jeq      #0x0180      ; compare 2 bytes, move to next instruction if equal
- * (004) ret      #65535       ; return 65535 bytes of packet
- * (005) ret      #0           ; return 0
+ * (000) ld       [2]          ; Dst MAC octets 2-5
+ * (001) jeq      #0xc2000000  jf drop
+ * (002) ldh      [0]          ; Dst MAC octets 0-1
+ * (003) jeq      #0x0180      jf drop
+ * (004) ld       [14]         ; DSAP, SSAP, control, protocol id high
+ * (005) jeq      #0x42420300  jf drop
+ * (006) ldb      [18]         ; protocol id low
+ * (007) jeq      #0x00        jf drop
+ * (008) ldh      [12]         ; 802.3 length
+ * (009) jgt      #1500        jt drop      ; an EtherType, not LLC
+ * (010) st       M[0]
+ * (011) add      #14
+ * (012) tax
+ * (013) ld       len
+ * (014) jge      x            jf drop      ; truncated
+ * (015) ldb      [19]         ; protocol version id
+ * (016) jge      #2           jt (024)
+ * (017) ldb      [20]         ; BPDU type
+ * (018) jeq      #0x80        jf (021)
+ * (019) ld       M[0]
+ * (020) jge      #7           jt accept  jf drop  ; TCN, 4 octets
+ * (021) jeq      #0x00        jf drop
+ * (022) ld       M[0]
+ * (023) jge      #38          jt accept  jf drop  ; Config, 35 octets
+ * (024) jeq      #2           jf (029)
+ * (025) ldb      [20]
+ * (026) jeq      #0x02        jf drop
+ * (027) ld       M[0]
+ * (028) jge      #39          jt accept  jf drop  ; RST, 36 octets
+ * (029) ldb      [20]
+ * (030) jeq      #0x02        jf drop
+ * (031) ld       M[0]
+ * (032) jge      #38          jt accept  jf drop  ; MST or later, 35 octets
+ * (033) ret      #65535       ; accept
+ * (034) ret      #0           ; drop
  *
- * { 0x20, 0, 0, 0x00000002 },
- * { 0x15, 0, 3, 0xc2000000 },
- * { 0x28, 0, 0, 0x00000000 },
- * { 0x15, 0, 1, 0x00000180 },
- * { 0x6, 0,  0, 0x0000ffff },
- * { 0x6, 0,  0, 0x00000000 }
+ * Self sent BPDUs are let through on purpose: the protocol thread needs
+ * them to give a looped back port the Backup role.
  */
 
+#define MSTPD_LLC_LEN (SIZEOF_LSAP_HDR - SIZEOF_ENET_HDR)
+
 #define MSTPD_FILTER_F \
-    { 0x20, 0, 0, 0x00000002 }, \
-    { 0x15, 0, 3, 0xc2000000 }, \
-    { 0x28, 0, 0, 0x00000000 }, \
-    { 0x15, 0, 1, 0x00000180 }, \
-    { 0x6, 0, 0, 0x0000ffff }, \
-    { 0x6, 0, 0, 0x00000000 }
+    BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 2), \
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0xc2000000, 0, 32), \
+    BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 0), \
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x0180, 0, 30), \
+    BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 14), \
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x42420300, 0, 28), \
+    BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 18), \
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x00, 0, 26), \
+    BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12), \
+    BPF_JUMP(BPF_JMP | BPF_JGT | BPF_K, 1500, 24, 0), \
+    BPF_STMT(BPF_ST, 0), \
+    BPF_STMT(BPF_ALU | BPF_ADD | BPF_K, SIZEOF_ENET_HDR), \
+    BPF_STMT(BPF_MISC | BPF_TAX, 0), \
+    BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0), \
+    BPF_JUMP(BPF_JMP | BPF_JGE | BPF_X, 0, 0, 19), \
+    BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 19), \
+    BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, MSTP_PROTOCOL_VERSION_ID_RST, 7, 0), \
+    BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 20), \
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, MSTP_BPDU_TYPE_STP_TCN, 0, 2), \
+    BPF_STMT(BPF_LD | BPF_MEM, 0), \
+    BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, MSTP_STP_TCN_BPDU_LEN_MIN + MSTPD_LLC_LEN, 12, 13), \
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, MSTP_BPDU_TYPE_STP_CONFIG, 0, 12), \
+    BPF_STMT(BPF_LD | BPF_MEM, 0), \
+    BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, MSTP_STP_CONFIG_BPDU_LEN_MIN + MSTPD_LLC_LEN, 9, 10), \
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, MSTP_PROTOCOL_VERSION_ID_RST, 0, 4), \
+    BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 20), \
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, MSTP_BPDU_TYPE_RST, 0, 7), \
+    BPF_STMT(BPF_LD | BPF_MEM, 0), \
+    BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, MSTP_RST_BPDU_LEN_MIN + MSTPD_LLC_LEN, 4, 5), \
+    BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 20), \
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, MSTP_BPDU_TYPE_MST, 0, 3), \
+    BPF_STMT(BPF_LD | BPF_MEM, 0), \
+    BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, MSTP_STP_CONFIG_BPDU_LEN_MIN + MSTPD_LLC_LEN, 0, 1), \
+    BPF_STMT(BPF_RET | BPF_K, 0x0000ffff), \
+    BPF_STMT(BPF_RET | BPF_K, 0)
 
 static struct sock_filter mstpd_filter_f[] = { MSTPD_FILTER_F };
 static struct sock_fprog mstpd_fprog = {
@@ -154,11 +247,46 @@ mstp_free_event_queue(void)
     return rc;
 } /* mstp_init_event_rcvr */
 
+/* Set by 'mstp_config_reinit', cleared when the e_mstpd_config_reload
+ * message that starts the fresh config arrives. */
+static bool mstp_configReloadPending = false;
+
+/**PROC+**********************************************************************
+ * Name:      mstp_config_reinit
+ *
+ * Purpose:   Re-initialize the MSTP Config: drop the queued events and
+ *            config updates and have the OVSDB thread send the whole
+ *            config again. Events
+ *            that are still sent before the reload starts are dropped by
+ *            the main loop.
+ *
+ * Params:    none
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_configReloadPending
+ **PROC-**********************************************************************/
+void
+mstp_config_reinit(void)
+{
+    mstp_free_event_queue();
+    mstp_cfgMboxReset();
+    mstp_dbOutboxPostJob(MSTP_DB_JOB_CONFIG_RELOAD, 0, NULL);
+    mstp_configReloadPending = true;
+}
+
 int
 mstpd_send_event(mstpd_message *pmsg)
 {
     int rc;
 
+    /* Config updates the OVSDB thread puts after this event must not be
+     * applied before it */
+    if ((pmsg->msg_type != e_mstpd_config_batch) &&
+        (mstp_getThreadRole() == MSTP_THREAD_OVSDB)) {
+        mstp_cfgMboxSeal();
+    }
+
     rc = mqueue_send(&mstpd_main_rcvq, pmsg);
     if (rc) {
         VLOG_ERR("Failed to send to MSTP main receive queue: %s",
@@ -185,6 +313,20 @@ mstpd_wait_for_next_event(void)
     return pmsg;
 } /* mstpd_wait_for_next_event */
 
+/* Same as above, but returns NULL at once if the queue is empty. */
+static mstpd_message *
+mstpd_poll_next_event(void)
+{
+    mstpd_message *pmsg = NULL;
+
+    if (mqueue_trywait(&mstpd_main_rcvq, (void **)(void *)&pmsg)) {
+        return NULL;
+    }
+    pmsg->msg = (void *)(pmsg+1);
+
+    return pmsg;
+} /* mstpd_poll_next_event */
+
 void
 mstpd_event_free(mstpd_message *pmsg)
 {
@@ -193,15 +335,152 @@ mstpd_event_free(mstpd_message *pmsg)
     }
 } /* mstpd_event_free */
 
+/************************************************************************
+ * BPDU ingress policer
+ *
+ * A token bucket per port, run by the RX thread before a received BPDU is
+ * allocated and queued, so that a neighbour flooding one port cannot keep
+ * the protocol thread from the BPDUs of the others. The rate and depth
+ * come from the port's other_config (see intf_update_bpdu_policer).
+ ************************************************************************/
+void
+mstp_rxPolicerConfig(LPORT_t lport, uint32_t rate, uint32_t burst)
+{
+    if (!IS_VALID_LPORT(lport)) {
+        return;
+    }
+    __atomic_store_n(&mstp_rx_policer[lport].burst, burst, __ATOMIC_RELAXED);
+    __atomic_store_n(&mstp_rx_policer[lport].rate, rate, __ATOMIC_RELAXED);
+}
+
+void
+mstp_rxPolicerStatsGet(LPORT_t lport, MSTP_RX_POLICER_STATS_t *stats)
+{
+    const MSTP_RX_POLICER_t *pol;
+
+    memset(stats, 0, sizeof(*stats));
+    if (!IS_VALID_LPORT(lport)) {
+        return;
+    }
+    pol = &mstp_rx_policer[lport];
+    stats->rate = __atomic_load_n(&pol->rate, __ATOMIC_RELAXED);
+    stats->burst = __atomic_load_n(&pol->burst, __ATOMIC_RELAXED);
+    stats->dropCnt = __atomic_load_n(&pol->dropCnt, __ATOMIC_RELAXED);
+    stats->exceedCnt = __atomic_load_n(&pol->exceedCnt, __ATOMIC_RELAXED);
+    stats->exceeding = __atomic_load_n(&pol->exceeding, __ATOMIC_RELAXED);
+}
+
+void
+mstp_rxPolicerStatsClear(LPORT_t lport)
+{
+    if (!IS_VALID_LPORT(lport)) {
+        return;
+    }
+    __atomic_store_n(&mstp_rx_policer[lport].dropCnt, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&mstp_rx_policer[lport].exceedCnt, 0, __ATOMIC_RELAXED);
+}
+
+uint64_t
+mstp_rxPolicerDropCnt(LPORT_t lport)
+{
+    if (!IS_VALID_LPORT(lport)) {
+        return 0;
+    }
+    return __atomic_load_n(&mstp_rx_policer[lport].dropCnt, __ATOMIC_RELAXED);
+}
+
+/**PROC+****************************************************************
+ * Name:    mstp_rxPolicerAdmit
+ *
+ * Purpose: RX thread: take a token from the bucket of 'lport' for a BPDU
+ *          waiting on its socket. The first drop after the port has been
+ *          quiet for MSTP_RX_POLICER_QUIET_USEC is logged as an exceed
+ *          event.
+ *
+ * Params:  lport -> port the BPDU is waiting on
+ *          name  -> port name for the event log
+ *
+ * Returns: true if the BPDU may be queued, false if it must be dropped
+ *
+ **PROC-*****************************************************************/
+static bool
+mstp_rxPolicerAdmit(LPORT_t lport, const char *name)
+{
+    MSTP_RX_POLICER_t *pol;
+    uint32_t rate;
+    uint32_t burst;
+    uint64_t now;
+    uint64_t elapsed;
+    uint64_t depth;
+
+    if (!IS_VALID_LPORT(lport)) {
+        return true;
+    }
+    pol = &mstp_rx_policer[lport];
+    rate = __atomic_load_n(&pol->rate, __ATOMIC_RELAXED);
+    if (!rate) {
+        return true;
+    }
+    burst = __atomic_load_n(&pol->burst, __ATOMIC_RELAXED);
+    depth = (uint64_t)burst * MSTP_RX_POLICER_TOKEN;
+    now = mstp_utilMonoUsec();
+
+    if ((rate != pol->curRate) || (burst != pol->curBurst)) {
+        /* New or changed configuration: start with a full bucket. */
+        pol->curRate = rate;
+        pol->curBurst = burst;
+        pol->tokens = depth;
+        __atomic_store_n(&pol->exceeding, false, __ATOMIC_RELAXED);
+    } else {
+        elapsed = now - pol->lastUsec;
+        if (elapsed > MSTP_RX_POLICER_MAX_IDLE_USEC) {
+            elapsed = MSTP_RX_POLICER_MAX_IDLE_USEC;
+        }
+        pol->tokens += elapsed * rate;
+        if (pol->tokens > depth) {
+            pol->tokens = depth;
+        }
+    }
+    pol->lastUsec = now;
+
+    if (pol->tokens >= MSTP_RX_POLICER_TOKEN) {
+        pol->tokens -= MSTP_RX_POLICER_TOKEN;
+        if (pol->exceeding &&
+            ((now - pol->lastDropUsec) >= MSTP_RX_POLICER_QUIET_USEC)) {
+            __atomic_store_n(&pol->exceeding, false, __ATOMIC_RELAXED);
+            VLOG_INFO("Port %s is back under its BPDU rate limit, "
+                      "%"PRIu64" BPDUs dropped", name, pol->episodeDropCnt);
+        }
+        return true;
+    }
+
+    pol->lastDropUsec = now;
+    __atomic_add_fetch(&pol->dropCnt, 1, __ATOMIC_RELAXED);
+    if (!pol->exceeding) {
+        __atomic_store_n(&pol->exceeding, true, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&pol->exceedCnt, 1, __ATOMIC_RELAXED);
+        pol->episodeDropCnt = 0;
+        log_event("MSTP_BPDU_RATE_EXCEEDED",
+            EV_KV("port", "%s", name),
+            EV_KV("rate", "%u", rate),
+            EV_KV("burst", "%u", burst));
+    }
+    pol->episodeDropCnt++;
+    return false;
+}
+
 /************************************************************************
  * MSTP PDU Send and Receive Functions
  ************************************************************************/
 void *
 mstpd_rx_pdu_thread(void *data)
 {
+    static struct vlog_rate_limit rx_policer_rl = VLOG_RATE_LIMIT_INIT(5, 20);
+
     VLOG_DBG("MSTP RX thread");
     /* Detach thread to avoid memory leak upon exit. */
     pthread_detach(pthread_self());
+    mstp_setThreadRole(MSTP_THREAD_RX);
 
     epfd = epoll_create1(0);
     if (epfd == -1) {
@@ -248,6 +527,18 @@ mstpd_rx_pdu_thread(void *data)
                 continue;
             }
 
+            if (!mstp_rxPolicerAdmit(idp->lport_id, idp->name)) {
+                char discard;
+
+                /* Take the BPDU off the socket without copying it. */
+                if (recv(idp->pdu_sockfd, &discard, sizeof(discard),
+                         MSG_TRUNC) < 0) {
+                    VLOG_ERR_RL(&rx_policer_rl, "Read failed, fd=%d: errno=%s",
+                                idp->pdu_sockfd, strerror(errno));
+                }
+                continue;
+            }
+
             total_msg_size = sizeof(mstpd_message) + sizeof(MSTP_RX_PDU);
 
             pmsg = xzalloc(total_msg_size);
@@ -276,7 +567,10 @@ mstpd_rx_pdu_thread(void *data)
                 VLOG_DBG("MSTP BPDU Send Event, count = %d ",count);
                 pkt_event->pktLen = count;
                 pkt_event->lport = idp->lport_id;
+                mstp_traceRx(pkt_event);
                 print_payload(pkt_event->data);
+                /* Parse the BPDU here rather than on the protocol thread. */
+                mstp_rxPduClassify(pkt_event);
                 mstpd_send_event(pmsg);
             }
         } /* for nfds */
@@ -286,6 +580,67 @@ mstpd_rx_pdu_thread(void *data)
     return NULL;
 } /* mstpd_rx_pdu_thread */
 
+/************************************************************************
+ * BPDU socket statistics
+ ************************************************************************/
+static void
+mstp_rxSockStatsCollect(LPORT_t lport, int sockfd)
+{
+    struct tpacket_stats st;
+    socklen_t len = sizeof(st);
+
+    if (getsockopt(sockfd, SOL_PACKET, PACKET_STATISTICS, &st, &len) < 0) {
+        VLOG_DBG("PACKET_STATISTICS failed, fd=%d: errno=%s",
+                 sockfd, strerror(errno));
+        return;
+    }
+    mstp_rx_sock_stats[lport].packets += st.tp_packets;
+    mstp_rx_sock_stats[lport].drops += st.tp_drops;
+}
+
+/**PROC+****************************************************************
+ * Name:    mstp_rxSockStatsGet
+ *
+ * Purpose: OVSDB thread: kernel counters of the BPDU socket of 'lport'
+ *          since it was registered. 'packets' counts the frames that
+ *          passed the socket filter, 'drops' those of them lost to a
+ *          full socket buffer; the frames the filter rejects are not
+ *          counted by the kernel.
+ *
+ * Params:  lport -> port
+ *          stats -> counters
+ *
+ * Returns: none
+ *
+ **PROC-*****************************************************************/
+void
+mstp_rxSockStatsGet(LPORT_t lport, MSTP_RX_SOCK_STATS_t *stats)
+{
+    struct iface_data *idp;
+
+    memset(stats, 0, sizeof(*stats));
+    if (!IS_VALID_LPORT(lport)) {
+        return;
+    }
+    idp = find_iface_data_by_index(lport);
+    if (idp && idp->pdu_registered) {
+        mstp_rxSockStatsCollect(lport, idp->pdu_sockfd);
+    }
+    *stats = mstp_rx_sock_stats[lport];
+}
+
+void
+mstp_rxSockStatsClear(LPORT_t lport)
+{
+    MSTP_RX_SOCK_STATS_t stats;
+
+    if (!IS_VALID_LPORT(lport)) {
+        return;
+    }
+    mstp_rxSockStatsGet(lport, &stats);
+    memset(&mstp_rx_sock_stats[lport], 0, sizeof(mstp_rx_sock_stats[lport]));
+}
+
 /*
  * TODO: need to move registering reserved mcast addr with socket to common utils/repo
  */
@@ -341,6 +696,7 @@ register_stp_mcast_addr(int lport)
         return -1;
     }
     /* Save sockfd information in interface data. */
+    memset(&mstp_rx_sock_stats[lport], 0, sizeof(mstp_rx_sock_stats[lport]));
     idp->pdu_sockfd = sockfd;
     idp->pdu_registered = true;
 
@@ -392,6 +748,7 @@ deregister_stp_mcast_addr(int lport)
                  "loop.  err=%s", strerror(errno));
     }
 
+    mstp_rxSockStatsCollect(lport, idp->pdu_sockfd);
     close(idp->pdu_sockfd);
     idp->pdu_sockfd = 0;
     idp->pdu_registered = false;
@@ -399,6 +756,93 @@ deregister_stp_mcast_addr(int lport)
 } /* deregister_stp_mcast_addr */
 
 
+/************************************************************************
+ * BPDU batch drain
+ *
+ * Back to back BPDUs are run through the state machines with BPDU
+ * transmission prevented, and the DB update, the pending TX pass and the
+ * status publish are done once for the whole batch. A batch ends when
+ * the queue is empty, when anything but a BPDU for the protocol is
+ * dequeued, or at the size cap or the time bound.
+ ************************************************************************/
+bool
+mstp_setRxBatchLimits(uint32_t maxBpdus, uint32_t maxUsec)
+{
+    if ((maxBpdus < MSTP_RX_BATCH_MAX_MIN) ||
+        (maxBpdus > MSTP_RX_BATCH_MAX_MAX) ||
+        (maxUsec < MSTP_RX_BATCH_USEC_MIN) ||
+        (maxUsec > MSTP_RX_BATCH_USEC_MAX)) {
+        return false;
+    }
+    __atomic_store_n(&mstp_rx_batch_max, maxBpdus, __ATOMIC_RELAXED);
+    __atomic_store_n(&mstp_rx_batch_usec, maxUsec, __ATOMIC_RELAXED);
+    return true;
+}
+
+void
+mstp_getRxBatchLimits(uint32_t *maxBpdus, uint32_t *maxUsec)
+{
+    *maxBpdus = __atomic_load_n(&mstp_rx_batch_max, __ATOMIC_RELAXED);
+    *maxUsec = __atomic_load_n(&mstp_rx_batch_usec, __ATOMIC_RELAXED);
+}
+
+/* Account a BPDU for the protocol, opening a batch if batching is on. */
+static void
+mstp_rxBatchAdd(void)
+{
+    if (!mstp_CB.rxBatchOpen) {
+        if (__atomic_load_n(&mstp_rx_batch_max, __ATOMIC_RELAXED) <= 1) {
+            return;
+        }
+        mstp_preventTxOnBridge();
+        mstp_CB.rxBatchOpen = TRUE;
+        mstp_CB.rxBatchSize = 0;
+        mstp_CB.rxBatchStartUsec = mstp_utilMonoUsec();
+    }
+    mstp_CB.rxBatchSize++;
+}
+
+/* true if the open batch reached the size cap or the time bound */
+static bool
+mstp_rxBatchIsDue(void)
+{
+    uint32_t maxBpdus, maxUsec;
+
+    mstp_getRxBatchLimits(&maxBpdus, &maxUsec);
+    if (mstp_CB.rxBatchSize >= maxBpdus) {
+        mstp_CB.rxBatchCapCnt++;
+        return true;
+    }
+    if ((mstp_utilMonoUsec() - mstp_CB.rxBatchStartUsec) >= maxUsec) {
+        mstp_CB.rxBatchTimeCnt++;
+        return true;
+    }
+    return false;
+}
+
+/* Do the work deferred by the open batch, if any. */
+static void
+mstp_rxBatchClose(void)
+{
+    if (!mstp_CB.rxBatchOpen) {
+        return;
+    }
+    mstp_CB.rxBatchOpen = FALSE;
+
+    mstp_informDBOnPortStateChange(0);
+    mstp_doPendingTxOnBridge();
+
+    mstp_CB.rxBatchCnt++;
+    mstp_CB.rxBatchBpduCnt += mstp_CB.rxBatchSize;
+    if (mstp_CB.rxBatchSize > mstp_CB.rxBatchWm) {
+        mstp_CB.rxBatchWm = mstp_CB.rxBatchSize;
+    }
+
+    mstp_checkDynReconfigChanges();
+    mstp_statusPublish(e_mstpd_rx_bpdu);
+    mstp_dbOutboxCommit();
+}
+
 /************************************************************************
  * MSTP Protocol Thread
  ************************************************************************/
@@ -413,14 +857,15 @@ mstpd_protocol_thread(void *arg)
     mstp_vlan_add *vlan_add;
     mstp_vlan_delete *vlan_delete;
     mstp_admin_status *status;
+    mstp_lport_info *lport_info;
     MSTP_RX_PDU *pkt;
     bool informDB = TRUE;
-    uint32_t vlan = 0;
     uint32_t lport = 0;
     char port[PORTNAME_LEN] = {0};
 
     /* Detach thread to avoid memory leak upon exit. */
     pthread_detach(pthread_self());
+    mstp_setThreadRole(MSTP_THREAD_PROTOCOL);
     clear_port_map(&ports_up);
     clear_port_map(&l2ports);
     clear_port_map(&temp_l2ports);
@@ -434,7 +879,17 @@ mstpd_protocol_thread(void *arg)
      *******************************************************************/
     while (1) {
 
-        pmsg = mstpd_wait_for_next_event();
+        /* With a batch open only take what is already queued, running
+         * out of BPDUs ends the batch. */
+        if (mstp_CB.rxBatchOpen) {
+            pmsg = mstpd_poll_next_event();
+            if (!pmsg) {
+                mstp_rxBatchClose();
+                continue;
+            }
+        } else {
+            pmsg = mstpd_wait_for_next_event();
+        }
         informDB = TRUE;
 
         if (mstpd_shutdown) {
@@ -446,51 +901,60 @@ mstpd_protocol_thread(void *arg)
             continue;
         }
 
-        switch (pmsg->msg_type)
-        {
-            case e_mstpd_global_config:
-                update_mstp_global_config(pmsg);
-                VLOG_DBG("Received a Global Config Update");
-                break;
-
-            case e_mstpd_cist_config:
-                update_mstp_cist_config(pmsg);
-                VLOG_DBG("Received a CIST config Update");
-                break;
-
-            case e_mstpd_cist_port_config:
-                update_mstp_cist_port_config(pmsg);
-                VLOG_DBG("Received a CIST Port config Update");
-                break;
+        mstp_smRecSetCause(pmsg->msg_type);
+        mstp_traceDequeue(pmsg->msg_type,
+                          (pmsg->msg_type == e_mstpd_rx_bpdu) ?
+                          (MSTP_RX_PDU *)pmsg->msg : NULL);
+
+        /* After a config re-init only timer ticks are taken until the
+         * fresh config starts. */
+        if (mstp_configReloadPending &&
+            (pmsg->msg_type != e_mstpd_config_reload) &&
+            (pmsg->msg_type != e_mstpd_timer)) {
+            if (pmsg->msg_type == e_mstpd_config_batch) {
+                mstp_cfgMboxDeliver(((mstp_config_batch *)pmsg->msg)->seq,
+                                    false);
+            }
+            mstpd_event_free(pmsg);
+            continue;
+        }
 
-            case e_mstpd_msti_config:
-                update_mstp_msti_config(pmsg);
-                VLOG_DBG("Received a MSTI config Update");
-                break;
+        /* Anything but a BPDU or a timer tick may change how a repeated
+         * BPDU has to be processed */
+        if ((pmsg->msg_type != e_mstpd_rx_bpdu) &&
+            (pmsg->msg_type != e_mstpd_timer)) {
+            mstp_rxBpduCacheInvalidate();
+        }
 
-            case e_mstpd_msti_port_config:
-                update_mstp_msti_port_config(pmsg);
-                VLOG_DBG("Received a MSTI Port config Update");
-                break;
+        /* Timer ticks (periodic transmissions) and configuration changes
+         * must see TX allowed and the DB up to date. */
+        if (pmsg->msg_type != e_mstpd_rx_bpdu) {
+            mstp_rxBatchClose();
+        }
 
-            case e_mstpd_msti_config_delete:
-                delete_mstp_msti_config(pmsg);
-                VLOG_DBG("Received a MSTI config Update");
+        switch (pmsg->msg_type)
+        {
+            case e_mstpd_config_batch:
+                /* global, CIST, MSTI and port config updates */
+                mstp_cfgMboxDeliver(((mstp_config_batch *)pmsg->msg)->seq,
+                                    true);
+                VLOG_DBG("Received a config batch");
                 break;
             case e_mstpd_vlan_add:
-                vlan = 0;
                 VLOG_DBG("%s: Received VLAN Add Event", __FUNCTION__);
                 vlan_add = (mstp_vlan_add *)pmsg->msg;
-                vlan = vlan_add->vid;
-                VLOG_DBG("Received an VLAN Add event: %d",vlan);
-                handle_vlan_add_in_mstp_config(vlan);
+                VLOG_DBG("Received an VLAN Add event: %u VLANs",
+                         count_vids(&vlan_add->vids));
+                mstp_dbOutboxPostVlanJob(MSTP_DB_JOB_VLAN_ADD,
+                                         &vlan_add->vids);
                 break;
             case e_mstpd_vlan_delete:
-                vlan = 0;
                 VLOG_DBG("%s: Received VLAN Delete Event", __FUNCTION__);
                 vlan_delete = (mstp_vlan_delete *)pmsg->msg;
-                vlan = vlan_delete->vid;
-                VLOG_DBG("Received an VLAN Delete event: %d",vlan);
+                VLOG_DBG("Received an VLAN Delete event: %u VLANs",
+                         count_vids(&vlan_delete->vids));
+                mstp_dbOutboxPostVlanJob(MSTP_DB_JOB_VLAN_DELETE,
+                                         &vlan_delete->vids);
                 break;
             case e_mstpd_lport_add:
                 VLOG_DBG("%s : Recieved lport add event", __FUNCTION__);
@@ -500,8 +964,8 @@ mstpd_protocol_thread(void *arg)
                 memset(port,0,PORTNAME_LEN);
                 set_port(&l2ports,lport);
                 intf_get_port_name(lport,port);
-                update_port_entry_in_cist_mstp_instances(port,e_mstpd_lport_add);
-                update_port_entry_in_msti_mstp_instances(port,e_mstpd_lport_add);
+                mstp_dbOutboxPostJob(MSTP_DB_JOB_PORT_ADD, lport, port);
+                mstp_invalidateDBPortState(MSTP_NON_STP_BRIDGE, lport);
                 update_mstp_on_lport_add(lport);
                 if (MSTP_ENABLED)
                 {
@@ -534,8 +998,8 @@ mstpd_protocol_thread(void *arg)
                 strncpy(port,l2port_delete->lportname,PORTNAME_LEN);
                 VLOG_DBG("Received an l2port delete event : %d",lport);
                 clear_port(&l2ports,lport);
-                update_port_entry_in_cist_mstp_instances(port,e_mstpd_lport_delete);
-                update_port_entry_in_msti_mstp_instances(port,e_mstpd_lport_delete);
+                mstp_dbOutboxPostJob(MSTP_DB_JOB_PORT_DELETE, lport, port);
+                mstp_invalidateDBPortState(MSTP_NON_STP_BRIDGE, lport);
                 mstp_removeLport(lport);
                 if (MSTP_ENABLED)
                 {
@@ -604,6 +1068,14 @@ mstpd_protocol_thread(void *arg)
 
                 }
                 break;
+            case e_mstpd_lport_info:
+                lport_info = (mstp_lport_info *)pmsg->msg;
+                mstp_lportInfoUpdate(lport_info);
+                break;
+            case e_mstpd_config_reload:
+                VLOG_DBG("%s : Config reload starts", __FUNCTION__);
+                mstp_configReloadPending = false;
+                break;
             case e_mstpd_admin_status:
                 VLOG_DBG("%s : Admin Status Update", __FUNCTION__);
                 status = (mstp_admin_status *)pmsg->msg;
@@ -671,10 +1143,13 @@ mstpd_protocol_thread(void *arg)
                         }
                     }
                 }
+                mstp_ckptTick();
                 if(MSTP_ENABLED)
                 {
+                    mstp_lportCostTick();
                     mstp_processTimerTickEvent();
                 }
+                mstp_util_export_bpdu_stats();
                 VLOG_DBG("%s : Recieved one sec timer tick event", __FUNCTION__);
                 break;
             case e_mstpd_rx_bpdu:
@@ -691,14 +1166,17 @@ mstpd_protocol_thread(void *arg)
                     VLOG_DBG("%d : MSTP BPDU Packet arrived from interface socket", pktType);
                     switch (pktType) {
                         case MSTP_UNAUTHORIZED_BPDU_DATA_PKT:
+                            mstp_rxBatchClose();
                             mstp_processUnauthorizedBpdu(pkt, BPDU_PROTECTION);
                             break;
 
                         case MSTP_ERRANT_PROTOCOL_DATA_PKT:
+                            mstp_rxBatchClose();
                             mstp_errantProtocolData(pkt, BPDU_FILTER);
                             break;
 
                         case MSTP_PROTOCOL_DATA_PKT:
+                            mstp_rxBatchAdd();
                             mstp_protocolData(pkt);
                             informDB = FALSE; /*Call already made in mstp_protocolData*/
                             break;
@@ -717,10 +1195,21 @@ mstpd_protocol_thread(void *arg)
                      __FUNCTION__);
         }
 
+        /* The rest is done when the batch closes. */
+        if (mstp_CB.rxBatchOpen) {
+            if (mstp_rxBatchIsDue()) {
+                mstp_rxBatchClose();
+            }
+            mstpd_event_free(pmsg);
+            continue;
+        }
+
         if (informDB) {
             mstp_informDBOnPortStateChange(pmsg->msg_type);
         }
         mstp_checkDynReconfigChanges();
+        mstp_statusPublish(pmsg->msg_type);
+        mstp_dbOutboxCommit();
 
         mstpd_event_free(pmsg);
 
@@ -773,6 +1262,12 @@ print_payload(unsigned char *payload)
 {
     unsigned char *ethhead;
     char log[200];
+
+    /* Called for every received BPDU, don't format unless it is logged */
+    if (!VLOG_IS_DBG_ENABLED()) {
+        return;
+    }
+
     ethhead = payload;
     if (ethhead != NULL)
     {
@@ -784,8 +1279,8 @@ print_payload(unsigned char *payload)
                 ethhead[3],ethhead[4],ethhead[5],
                 ethhead[6],ethhead[7],ethhead[8],
                 ethhead[9],ethhead[10],ethhead[11]);
+        VLOG_DBG("Packet Format : %s",log);
     }
-    VLOG_DBG("Packet Format : %s",log);
     return;
 }
 
@@ -860,7 +1355,7 @@ mstp_processTimerTickEvent()
             commPortPtr->reEnableTimer--;
             if(commPortPtr->reEnableTimer == 0)
             {
-               enable_or_disable_port(lport, true);
+               enable_logical_port(lport);
                intf_get_port_name(lport,lport_name);
                VLOG_DBG("port %s - BPDU protection auto-reenable timer expired.",lport_name);
             }
@@ -887,11 +1382,19 @@ mstp_processTimerTickEvent()
  *                  c) Port Identifier Priority (CIST | MSTI)
  *                  d) Port Path Cost (CIST | MSTI)
  *                  (P802.1D/D1 17.13)
- *                  In the current MSTP implementation the following dynamic
- *                  reconfiguration changes also cause MSTP re-initialization:
- *                  - MstConfigId (configName, revisionLevel, digest)
- *                  - 'restrictedRole' per-port parameter change
- *
+ *                  In the current MSTP implementation BEGIN is scoped to
+ *                  what the change affects:
+ *                  - Port Identifier Priority, Port Path Cost: the per-Port
+ *                    per-Tree SMs of the port on that tree;
+ *                  - 'restrictedRole' and loop guard per-port parameter
+ *                    changes: the per-Port per-Tree SMs of the port on
+ *                    every tree;
+ *                  - Bridge Identifier Priority: all SMs of that tree;
+ *                  - a change on the CIST also restarts the same scope on
+ *                    the MSTIs (see 'mstp_dynReconfigRestartScoped').
+ *                  Only the region identity changes, MstConfigId
+ *                  (configName, revisionLevel, digest) and MSTI removal,
+ *                  cause MSTP re-initialization from config.
  *
  * Params:    none
  *
@@ -911,6 +1414,12 @@ mstp_checkDynReconfigChanges(void)
 
    if((MSTP_DYN_RECONFIG_CHANGE == false))
    {
+      if(MSTP_DYN_RECONFIG_SCOPED)
+      {
+         mstp_dynReconfigRestartScoped();
+         /* the restarted ports went to 'Discarding' */
+         mstp_informDBOnPortStateChange(0);
+      }
       return;
    }
 
@@ -941,6 +1450,8 @@ mstp_checkDynReconfigChanges(void)
     * clear global boolean flags - used as triggers for MSTP re-initialization
     *------------------------------------------------------------------------*/
    MSTP_DYN_RECONFIG_CHANGE  = false;
+   mstp_dynReconfigClearScope();
+   mstp_CB.dynReconfigFullCnt++;
 
    MSTP_DYN_CFG_PRINTF("!DYN RECONFIG: %s", "end");
 }
@@ -964,6 +1475,8 @@ void update_mstp_global_config(mstpd_message *pmsg)
     struct mstp_global_config *global_config = NULL;
     global_config = (mstp_global_config *)pmsg->msg;
 
+    mstp_systemMacUpdate(global_config->system_mac);
+
     if(memcmp(mstp_Bridge.MstConfigId.configName, global_config->config_name,
                 MSTP_MST_CONFIG_NAME_LEN))
     {
@@ -1020,7 +1533,7 @@ void update_mstp_cist_config(mstpd_message *pmsg)
                 cist_config->priority * PRIORITY_MULTIPLIER);
         if (MSTP_ENABLED)
         {
-            MSTP_DYN_RECONFIG_CHANGE = TRUE;
+            mstp_setDynReconfigTreeFlag(MSTP_CISTID);
         }
     }
 
@@ -1179,20 +1692,10 @@ void update_mstp_cist_config(mstpd_message *pmsg)
 
     /* Copy the operational timers from config as the bridge is the root for thsi CIST */
     if(MSTP_IS_THIS_BRIDGE_CIST_ROOT) {
-        struct ovsdb_idl_txn *txn = NULL;
-        MSTP_OVSDB_LOCK;
-        txn = ovsdb_idl_txn_create(idl);
-        if(txn == NULL) {
-            VLOG_ERR("%s Transaction Failed %s:%d", program_name, __FILE__, __LINE__);
-            return;
-        }
         mstp_util_set_cist_table_value(OPER_HELLO_TIME, mstp_Bridge.HelloTime);
         mstp_util_set_cist_table_value(OPER_FORWARD_DELAY, mstp_Bridge.FwdDelay);
         mstp_util_set_cist_table_value(OPER_MAX_AGE, mstp_Bridge.MaxAge);
         mstp_util_set_cist_table_value(OPER_TX_HOLD_COUNT, mstp_Bridge.TxHoldCount);
-        ovsdb_idl_txn_commit_block(txn);
-        ovsdb_idl_txn_destroy(txn);
-        MSTP_OVSDB_UNLOCK;
     }
 
     VLOG_DBG("Config Change in CIST Data : %d",MSTP_DYN_RECONFIG_CHANGE);
@@ -1230,8 +1733,7 @@ void update_mstp_cist_port_config(mstpd_message *pmsg)
              * Allocate memory to keep port's data
              * (common for the CIST and the MSTIs)
              *------------------------------------------------------------------*/
-            MSTP_COMM_PORT_PTR(lport) = (MSTP_COMM_PORT_INFO_t *)malloc(sizeof(MSTP_COMM_PORT_INFO_t));
-            memset(MSTP_COMM_PORT_PTR(lport), 0,sizeof(MSTP_COMM_PORT_INFO_t));
+            MSTP_COMM_PORT_PTR(lport) = mstp_portArenaCommAlloc();
         }
         commPortPtr = MSTP_COMM_PORT_PTR(lport);
         if(!MSTP_CIST_PORT_PTR(lport))
@@ -1239,7 +1741,7 @@ void update_mstp_cist_port_config(mstpd_message *pmsg)
             /*------------------------------------------------------------------
              * Allocate memory to keep CIST port's data
              *------------------------------------------------------------------*/
-            MSTP_CIST_PORT_PTR(lport) = (MSTP_CIST_PORT_INFO_t *)calloc(1, sizeof(MSTP_CIST_PORT_INFO_t));
+            MSTP_CIST_PORT_PTR(lport) = mstp_portArenaCistAlloc(lport);
         }
         cistPortPtr = MSTP_CIST_PORT_PTR(lport);
         MSTP_SET_PORT_NUM(cistPortPtr->portId,lport);
@@ -1258,8 +1760,8 @@ void update_mstp_cist_port_config(mstpd_message *pmsg)
             if(MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap,
                         MSTP_PORT_PORT_ENABLED) && MSTP_ENABLED)
             {/* Port is 'Enabled' and the path cost value has changed,
-              * indicate that protocol re-initialization is required */
-                MSTP_DYN_RECONFIG_CHANGE = TRUE;
+              * indicate that the port needs to be restarted */
+                mstp_setDynReconfigPortFlag(MSTP_CISTID, lport);
             }
         }
         if (commPortPtr->ExternalPortPathCost != path_cost)
@@ -1268,8 +1770,8 @@ void update_mstp_cist_port_config(mstpd_message *pmsg)
             if(MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap,
                         MSTP_PORT_PORT_ENABLED) && MSTP_ENABLED)
             {/* Port is 'Enabled' and the path cost value has changed,
-              * indicate that protocol re-initialization is required */
-                MSTP_DYN_RECONFIG_CHANGE = TRUE;
+              * indicate that the port needs to be restarted */
+                mstp_setDynReconfigPortFlag(MSTP_CISTID, lport);
             }
         }
         MSTP_COMM_PORT_SET_BIT(commPortPtr->bitMap, MSTP_PORT_MCHECK);
@@ -1316,8 +1818,8 @@ void update_mstp_cist_port_config(mstpd_message *pmsg)
             if(MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap,
                         MSTP_PORT_PORT_ENABLED) && MSTP_ENABLED)
             {/* Port is 'Enabled' and the priority value has changed,
-              * indicate that protocol re-initialization is required */
-                MSTP_DYN_RECONFIG_CHANGE = TRUE;
+              * indicate that the port needs to be restarted */
+                mstp_setDynReconfigPortFlag(MSTP_CISTID, lport);
             }
         }
 
@@ -1369,9 +1871,9 @@ void update_mstp_cist_port_config(mstpd_message *pmsg)
                         mstp_isPortRoleSetOnAnyTree(lport, MSTP_PORT_ROLE_ROOT) &&
                         MSTP_ENABLED)
                 {/* Port is 'Enabled', is the 'Root' and 'restrictedRole' flag
-                  * is set, indicate that protocol re-initialization is
-                  * required */
-                    MSTP_DYN_RECONFIG_CHANGE = TRUE;
+                  * is set, indicate that the port needs to be restarted on
+                  * every tree */
+                    mstp_setDynReconfigPortFlag(MSTP_NO_MSTID, lport);
                 }
             }
             else
@@ -1383,9 +1885,9 @@ void update_mstp_cist_port_config(mstpd_message *pmsg)
                         mstp_isPortRoleSetOnAnyTree(lport, MSTP_PORT_ROLE_ALTERNATE) &&
                         MSTP_ENABLED)
                 {/* Port is 'Enabled', is the 'Alternate' and 'restrictedRole'
-                  * flag is cleared, indicate that protocol re-initialization
-                  * is required */
-                    MSTP_DYN_RECONFIG_CHANGE = TRUE;
+                  * flag is cleared, indicate that the port needs to be
+                  * restarted on every tree */
+                    mstp_setDynReconfigPortFlag(MSTP_NO_MSTID, lport);
                 }
             }
         }
@@ -1412,7 +1914,7 @@ void update_mstp_cist_port_config(mstpd_message *pmsg)
             {/* Changing to ON. */
                 MSTP_COMM_SET_BPDU_FILTER(lport);
                 if(MSTP_CIST_PORT_PTR(lport))
-                    MSTP_CIST_PORT_PTR(lport)->dbgCnts.errantBpduCnt = 0;
+                    MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.errantBpduCnt = 0;
                 if(MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap,
                             MSTP_PORT_PORT_ENABLED) && MSTP_ENABLED)
                 {
@@ -1433,7 +1935,7 @@ void update_mstp_cist_port_config(mstpd_message *pmsg)
             {/* Changing to OFF. */
                 MSTP_COMM_CLR_BPDU_FILTER(lport);
                 if(MSTP_CIST_PORT_PTR(lport))
-                    MSTP_CIST_PORT_PTR(lport)->dbgCnts.errantBpduCnt = 0;
+                    MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.errantBpduCnt = 0;
                 if(MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap,
                             MSTP_PORT_PORT_ENABLED) && MSTP_ENABLED)
                 {
@@ -1462,7 +1964,7 @@ void update_mstp_cist_port_config(mstpd_message *pmsg)
                 /* Changing to ON. */
                 MSTP_COMM_PORT_SET_BPDU_PROTECTION(lport);
                 if(MSTP_CIST_PORT_PTR(lport))
-                    MSTP_CIST_PORT_PTR(lport)->dbgCnts.errantBpduCnt = 0;
+                    MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.errantBpduCnt = 0;
             }
         }
         else
@@ -1474,7 +1976,7 @@ void update_mstp_cist_port_config(mstpd_message *pmsg)
                 /* Changing to OFF. */
                 MSTP_COMM_PORT_CLR_BPDU_PROTECTION(lport);
                 if(MSTP_CIST_PORT_PTR(lport))
-                    MSTP_CIST_PORT_PTR(lport)->dbgCnts.errantBpduCnt = 0;
+                    MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.errantBpduCnt = 0;
 
                 /* Attempt to bring port back up if currently disabled */
                 commPortPtr = MSTP_COMM_PORT_PTR(lport);
@@ -1528,7 +2030,7 @@ void update_mstp_cist_port_config(mstpd_message *pmsg)
                  *---------------------------------------------------------------------*/
                 if(reconfig_needed && MSTP_ENABLED)
                 {
-                    MSTP_DYN_RECONFIG_CHANGE = TRUE;
+                    mstp_setDynReconfigPortFlag(MSTP_NO_MSTID, lport);
                 }
             }
         }
@@ -1586,7 +2088,7 @@ void update_mstp_msti_config(mstpd_message *pmsg)
                 msti_data->priority * PRIORITY_MULTIPLIER);
         if (MSTP_ENABLED)
         {
-            MSTP_DYN_RECONFIG_CHANGE = TRUE;
+            mstp_setDynReconfigTreeFlag(mstid);
         }
     }
     for (lport = 1; lport <= MAX_LPORTS; lport++ )
@@ -1602,7 +2104,7 @@ void update_mstp_msti_config(mstpd_message *pmsg)
             /*------------------------------------------------------------------
              * Allocate memory to keep MSTI port's data
              *------------------------------------------------------------------*/
-            MSTP_MSTI_PORT_PTR(mstid, lport) = (MSTP_MSTI_PORT_INFO_t *)calloc(1, sizeof(MSTP_MSTI_PORT_INFO_t));
+            MSTP_MSTI_PORT_PTR(mstid, lport) = mstp_portArenaMstiAlloc(mstid, lport);
             if(!MSTP_MSTI_PORT_PTR(mstid, lport))
             {
                 VLOG_ERR("Failed to allocate memory for MSTP MSTI Port Info");
@@ -1619,8 +2121,8 @@ void update_mstp_msti_config(mstpd_message *pmsg)
             if(MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap,
                         MSTP_PORT_PORT_ENABLED) && MSTP_ENABLED)
             {/* Port is 'Enabled' and the priority value has changed,
-              * indicate that protocol re-initialization is required */
-                MSTP_DYN_RECONFIG_CHANGE = TRUE;
+              * indicate that the tree needs to be restarted */
+                mstp_setDynReconfigTreeFlag(mstid);
             }
         }
         path_cost = mstp_portAutoPathCostDetect(lport);
@@ -1631,8 +2133,8 @@ void update_mstp_msti_config(mstpd_message *pmsg)
             if(MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap,
                         MSTP_PORT_PORT_ENABLED) && MSTP_ENABLED)
             {/* Port is 'Enabled' and the path cost value has changed,
-              * indicate that protocol re-initialization is required */
-                MSTP_DYN_RECONFIG_CHANGE = TRUE;
+              * indicate that the tree needs to be restarted */
+                mstp_setDynReconfigTreeFlag(mstid);
             }
         }
         mstp_initMstiPortData(mstid,lport,TRUE);
@@ -1643,6 +2145,7 @@ void update_mstp_msti_config(mstpd_message *pmsg)
      *---------------------------------------------------------------------*/
     MSTP_MSTI_INFO(mstid)->valid = TRUE;
     MSTP_NUM_OF_VALID_TREES++;
+    mstp_invalidateDBPortState(mstid, 0);
 
 }
 /**PROC+**********************************************************************
@@ -1675,8 +2178,7 @@ void update_mstp_msti_port_config(mstpd_message *pmsg)
          * Allocate memory to keep port's data
          * (common for the CIST and the MSTIs)
          *------------------------------------------------------------------*/
-        MSTP_COMM_PORT_PTR(lport) = (MSTP_COMM_PORT_INFO_t *)malloc(sizeof(MSTP_COMM_PORT_INFO_t));
-        memset(MSTP_COMM_PORT_PTR(lport), 0,sizeof(MSTP_COMM_PORT_INFO_t));
+        MSTP_COMM_PORT_PTR(lport) = mstp_portArenaCommAlloc();
     }
     commPortPtr = MSTP_COMM_PORT_PTR(lport);
     if(!MSTP_MSTI_PORT_PTR(mstid, lport))
@@ -1684,7 +2186,7 @@ void update_mstp_msti_port_config(mstpd_message *pmsg)
         /*------------------------------------------------------------------
          * Allocate memory to keep MSTI port's data
          *------------------------------------------------------------------*/
-        MSTP_MSTI_PORT_PTR(mstid, lport) = (MSTP_MSTI_PORT_INFO_t *)calloc(1, sizeof(MSTP_MSTI_PORT_INFO_t));
+        MSTP_MSTI_PORT_PTR(mstid, lport) = mstp_portArenaMstiAlloc(mstid, lport);
     }
     mstiPortPtr = MSTP_MSTI_PORT_PTR(mstid, lport);
     MSTP_SET_PORT_NUM(mstiPortPtr->portId,lport);
@@ -1696,8 +2198,8 @@ void update_mstp_msti_port_config(mstpd_message *pmsg)
         if(MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap,
                     MSTP_PORT_PORT_ENABLED) && MSTP_ENABLED)
         {/* Port is 'Enabled' and the priority value has changed,
-          * indicate that protocol re-initialization is required */
-            MSTP_DYN_RECONFIG_CHANGE = TRUE;
+          * indicate that the port needs to be restarted */
+            mstp_setDynReconfigPortFlag(mstid, lport);
         }
     }
     if(msti_port_config->path_cost != 0)
@@ -1711,8 +2213,8 @@ void update_mstp_msti_port_config(mstpd_message *pmsg)
         if(MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap,
                     MSTP_PORT_PORT_ENABLED) && MSTP_ENABLED)
         {/* Port is 'Enabled' and the path cost value has changed,
-          * indicate that protocol re-initialization is required */
-            MSTP_DYN_RECONFIG_CHANGE = TRUE;
+          * indicate that the port needs to be restarted */
+            mstp_setDynReconfigPortFlag(mstid, lport);
         }
     }
 }
@@ -1754,6 +2256,7 @@ void delete_mstp_msti_config(mstpd_message *pmsg)
      * Clear MSTI's VIDs mapping data in the global 'mstp_MstiVidTable'
      *---------------------------------------------------------------------*/
     clear_vid_map(&mstp_MstiVidTable[mstid]);
+    mstp_mstiVidTableChg();
 
     /*---------------------------------------------------------------------
      * Update global MST Configuration Identification 'digest' value.
@@ -1774,9 +2277,9 @@ void delete_mstp_msti_config(mstpd_message *pmsg)
     m = mstp_findMstiPortStateChgMsg(mstid);
     if(m != NULL)
     {
-        remqhere_nodis(&MSTP_TREE_MSGS_QUEUE, &m->link);
-        free(m);
+        mstp_releaseMstiPortStateChgMsg(m);
     }
+    mstp_invalidateDBPortState(mstid, 0);
 
     /*---------------------------------------------------------------------
      * Free memory space allocated for the MSTI
@@ -1786,16 +2289,225 @@ void delete_mstp_msti_config(mstpd_message *pmsg)
 
     MSTP_DYN_RECONFIG_CHANGE = TRUE;
 }
+/*---------------------------------------------------------------------------
+ * Port state cells committed to DB ('published'), last handed to the
+ * OVSDB thread ('staged') and computed from the queued tree messages that
+ * differ from the staged ones ('pending').
+ * A bit in 'mstp_dbStateChg[mstid]' marks a pending cell; 'mstp_dbBlockChg'
+ * does the same for the per-port 'block_all_mstp' hw_config key. Both maps
+ * are empty between two calls of 'mstp_informDBOnPortStateChange'.
+ *---------------------------------------------------------------------------*/
+static MSTP_DB_PORT_STATE_VEC_t    mstp_dbStatePublished;
+static MSTP_DB_PORT_STATE_VEC_t    mstp_dbStateStaged;
+static MSTP_DB_PORT_STATE_VEC_t    mstp_dbStatePending;
+static MSTP_DB_PORT_STATE_RESULT_t mstp_dbStateResult;
+static PORT_MAP                 mstp_dbStateChg[MSTP_INSTANCES_MAX + 1];
+static PORT_MAP                 mstp_dbBlockChg;
+
+static void
+mstp_dbStateSetCell(MSTID_t mstid, LPORT_t lport, uint8_t state)
+{
+   if(mstp_dbStateStaged.state[mstid][lport] == state)
+   {
+      clear_port(&mstp_dbStateChg[mstid], lport);
+      return;
+   }
+   mstp_dbStatePending.state[mstid][lport] = state;
+   set_port(&mstp_dbStateChg[mstid], lport);
+}
+
+static void
+mstp_dbStateSetCells(MSTID_t mstid, const PORT_MAP *pmap, uint8_t state)
+{
+   int     lport;
+   MSTID_t tree;
+
+   for(lport = find_first_port_set(pmap); IS_VALID_LPORT(lport);
+       lport = find_next_port_set(pmap, lport))
+   {
+      if(mstid != MSTP_NON_STP_BRIDGE)
+      {
+         mstp_dbStateSetCell(mstid, lport, state);
+         continue;
+      }
+      /*---------------------------------------------------------------
+       * the port is not controlled by MSTP, apply to all the trees
+       *---------------------------------------------------------------*/
+      mstp_dbStateSetCell(MSTP_CISTID, lport, state);
+      for(tree = 1; tree < MSTP_MSTID_MAX; tree++)
+      {
+         if(MSTP_MSTI_VALID(tree))
+            mstp_dbStateSetCell(tree, lport, state);
+      }
+   }
+}
+
+static void
+mstp_dbBlockSetCells(const PORT_MAP *pmap, uint8_t block)
+{
+   int     lport;
+
+   for(lport = find_first_port_set(pmap); IS_VALID_LPORT(lport);
+       lport = find_next_port_set(pmap, lport))
+   {
+      if(mstp_dbStateStaged.blockAll[lport] == block)
+      {
+         clear_port(&mstp_dbBlockChg, lport);
+         continue;
+      }
+      mstp_dbStatePending.blockAll[lport] = block;
+      set_port(&mstp_dbBlockChg, lport);
+   }
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_invalidateDBPortState
+ *
+ * Purpose:   Forget what has been published to DB about the port state of
+ *            'lport' on tree 'mstid', so the next state change is written
+ *            even if it matches the last published value. Used whenever
+ *            the corresponding DB rows may have been (re)created.
+ *
+ * Params:    mstid -> MST Instance Identifier, MSTP_NON_STP_BRIDGE for all
+ *                     the trees
+ *            lport -> logical port number, 0 for all the ports
+ *
+ * Returns:   none
+ *
+ * Globals:   none
+ *
+ **PROC-**********************************************************************/
+void
+mstp_invalidateDBPortState(MSTID_t mstid, LPORT_t lport)
+{
+   MSTID_t tree;
+
+   for(tree = 0; tree <= MSTP_INSTANCES_MAX; tree++)
+   {
+      if((mstid != MSTP_NON_STP_BRIDGE) && (tree != mstid))
+         continue;
+
+      if(lport == 0)
+      {
+         memset(mstp_dbStatePublished.state[tree], MSTP_DB_PORT_STATE_NONE,
+                sizeof(mstp_dbStatePublished.state[tree]));
+         memset(mstp_dbStateStaged.state[tree], MSTP_DB_PORT_STATE_NONE,
+                sizeof(mstp_dbStateStaged.state[tree]));
+      }
+      else if(IS_VALID_LPORT(lport))
+      {
+         mstp_dbStatePublished.state[tree][lport] = MSTP_DB_PORT_STATE_NONE;
+         mstp_dbStateStaged.state[tree][lport] = MSTP_DB_PORT_STATE_NONE;
+      }
+   }
+
+   if(mstid == MSTP_NON_STP_BRIDGE)
+   {
+      if(lport == 0)
+      {
+         memset(mstp_dbStatePublished.blockAll, MSTP_DB_BLOCK_ALL_NONE,
+                sizeof(mstp_dbStatePublished.blockAll));
+         memset(mstp_dbStateStaged.blockAll, MSTP_DB_BLOCK_ALL_NONE,
+                sizeof(mstp_dbStateStaged.blockAll));
+      }
+      else if(IS_VALID_LPORT(lport))
+      {
+         mstp_dbStatePublished.blockAll[lport] = MSTP_DB_BLOCK_ALL_NONE;
+         mstp_dbStateStaged.blockAll[lport] = MSTP_DB_BLOCK_ALL_NONE;
+      }
+   }
+}
+
+/*---------------------------------------------------------------------------
+ * Take in what the OVSDB thread reported about the cells staged earlier:
+ * committed cells become published, cells of a failed transaction are made
+ * pending again unless a newer value has been staged since, and cells whose
+ * rows were missing are forgotten.
+ *---------------------------------------------------------------------------*/
+static void
+mstp_dbStateResultApply(const MSTP_DB_PORT_STATE_RESULT_t *res)
+{
+   MSTID_t mstid;
+   int     lport;
+   uint8_t val;
+
+   for(mstid = 0; mstid <= MSTP_INSTANCES_MAX; mstid++)
+   {
+      for(lport = find_first_port_set(&res->stateCommitted[mstid]);
+          IS_VALID_LPORT(lport);
+          lport = find_next_port_set(&res->stateCommitted[mstid], lport))
+      {
+         mstp_dbStatePublished.state[mstid][lport] =
+            res->vec.state[mstid][lport];
+      }
+      for(lport = find_first_port_set(&res->stateFailed[mstid]);
+          IS_VALID_LPORT(lport);
+          lport = find_next_port_set(&res->stateFailed[mstid], lport))
+      {
+         val = res->vec.state[mstid][lport];
+         mstp_dbStatePublished.state[mstid][lport] = MSTP_DB_PORT_STATE_NONE;
+         if(mstp_dbStateStaged.state[mstid][lport] != val)
+            continue;
+         mstp_dbStateStaged.state[mstid][lport] = MSTP_DB_PORT_STATE_NONE;
+         mstp_dbStateSetCell(mstid, lport, val);
+      }
+      for(lport = find_first_port_set(&res->stateMissed[mstid]);
+          IS_VALID_LPORT(lport);
+          lport = find_next_port_set(&res->stateMissed[mstid], lport))
+      {
+         mstp_dbStatePublished.state[mstid][lport] = MSTP_DB_PORT_STATE_NONE;
+         mstp_dbStateStaged.state[mstid][lport] = MSTP_DB_PORT_STATE_NONE;
+      }
+   }
+
+   for(lport = find_first_port_set(&res->blockCommitted);
+       IS_VALID_LPORT(lport);
+       lport = find_next_port_set(&res->blockCommitted, lport))
+   {
+      mstp_dbStatePublished.blockAll[lport] = res->vec.blockAll[lport];
+   }
+   for(lport = find_first_port_set(&res->blockFailed); IS_VALID_LPORT(lport);
+       lport = find_next_port_set(&res->blockFailed, lport))
+   {
+      val = res->vec.blockAll[lport];
+      mstp_dbStatePublished.blockAll[lport] = MSTP_DB_BLOCK_ALL_NONE;
+      if(mstp_dbStateStaged.blockAll[lport] != val)
+         continue;
+      mstp_dbStateStaged.blockAll[lport] = MSTP_DB_BLOCK_ALL_NONE;
+      mstp_dbStatePending.blockAll[lport] = val;
+      set_port(&mstp_dbBlockChg, lport);
+   }
+   for(lport = find_first_port_set(&res->blockMissed); IS_VALID_LPORT(lport);
+       lport = find_next_port_set(&res->blockMissed, lport))
+   {
+      mstp_dbStatePublished.blockAll[lport] = MSTP_DB_BLOCK_ALL_NONE;
+      mstp_dbStateStaged.blockAll[lport] = MSTP_DB_BLOCK_ALL_NONE;
+   }
+}
+
 /**PROC+**********************************************************************
  * Name:      mstp_informDBOnPortStateChange
  *
- * Purpose:   Update DB on MSTP port State changes
+ * Purpose:   Update DB on MSTP port State changes. Works in three stages:
+ *            1). fold the queued tree messages into the pending port state
+ *                vector (last request for a (tree, port) cell wins), keeping
+ *                only the cells that differ from what DB already has;
+ *            2). stage the pending cells, the 'block_all_mstp' changes and
+ *                the aggregated MAC flush in the DB outbox, together with
+ *                the decision time of every tree message that carried a
+ *                state change; the OVSDB thread writes them in a single
+ *                transaction;
+ *            3). remember the staged cells in the staged vector.
+ *            Nothing is staged when there is nothing to write. A cell gets
+ *            to the published vector once the OVSDB thread reports its
+ *            transaction committed; a cell whose transaction failed is
+ *            made pending again.
  *
- * Params:    none
+ * Params:    operation -> the event that has been just processed
  *
  * Returns:   none
  *
- * Globals:   mstp_Bridge
+ * Globals:   mstp_CB
  *
  * Constraints:
  **PROC-**********************************************************************/
@@ -1805,200 +2517,137 @@ mstp_informDBOnPortStateChange(uint32_t operation)
 {
    MSTP_TREE_MSG_t *m;
    MSTP_TREE_MSG_t *m_next;
-   bool            remove_msg = FALSE;
-   bool           isblk_msg = FALSE, isfwd_msg = FALSE;
-   struct ovsdb_idl_txn *txn = NULL;
-   const struct ovsrec_port *port_row = NULL;
-   struct smap smap_other_config;
-   MSTP_OVSDB_LOCK;
-   txn = ovsdb_idl_txn_create(idl);
+   PORT_MAP        flushPorts;
+   uint64_t        decisionTime[MSTP_TREE_MSG_SLOTS];
+   int             numDecisions = 0;
+   bool            chgTree[MSTP_INSTANCES_MAX + 1];
+   bool            anyChg = FALSE;
+   MSTID_t         mstid;
+   int             lport;
 
+   clear_port_map(&flushPorts);
+
+   /*------------------------------------------------------------------------
+    * take what became of the cells staged by the previous calls, cells of
+    * a failed transaction are pending again
+    *------------------------------------------------------------------------*/
+   if(mstp_dbOutboxTakeResult(&mstp_dbStateResult))
+      mstp_dbStateResultApply(&mstp_dbStateResult);
+
+   /*------------------------------------------------------------------------
+    * stage 1: collect
+    *------------------------------------------------------------------------*/
    m_next = (MSTP_TREE_MSG_t*) qfirst_nodis (&MSTP_TREE_MSGS_QUEUE);
    while(m_next != (MSTP_TREE_MSG_t*) Q_NULL)
    {
       m = m_next;
       m_next = (MSTP_TREE_MSG_t*)qnext_nodis(&MSTP_TREE_MSGS_QUEUE, &m->link);
-       /*---------------------------------------------------------------------
-      * propagate 'lport down' requests to DB
-       *---------------------------------------------------------------------*/
-      if(are_any_ports_set(&m->portsDwn))
-      {
-         int lport = 0;
-         for(lport = find_first_port_set(&m->portsDwn);IS_VALID_LPORT(lport);
-                  lport = find_next_port_set(&m->portsDwn, lport))
-          {
-             char port[20] = {0};
-              intf_get_port_name(lport,port);
-              OVSREC_PORT_FOR_EACH(port_row,idl)
-                {
-                    if(strcmp(port_row->name,port)==0)
-                    {
-                        smap_clone(&smap_other_config, &port_row->hw_config);
-                        smap_replace(&smap_other_config, BLOCK_ALL_MSTP, "true");
-                        ovsrec_port_set_hw_config(port_row, &smap_other_config);
-                        smap_destroy(&smap_other_config);
-                    }
-                }
-          }
-         clear_port_map(&m->portsDwn);
-      }
-      /*---------------------------------------------------------------------
-       * propagate 'block' request to DB
-       *---------------------------------------------------------------------*/
-      if(are_any_ports_set(&m->portsBlk))
-      {
-          VLOG_DBG("MSTP_DBG blocking ports on informDB");
-          isblk_msg = TRUE;
-          int lport = 0;
-          for(lport = find_first_port_set(&m->portsBlk);IS_VALID_LPORT(lport);
-                  lport = find_next_port_set(&m->portsBlk, lport))
-          {
-              char port[20] = {0};
-              intf_get_port_name(lport,port);
-              if (m->mstid != 0){
-                  mstp_util_set_msti_port_table_string(PORT_STATE,"Blocking",m->mstid,lport);
-              }
-              else
-              {
-                  mstp_util_set_cist_port_table_string(port,PORT_STATE,"Blocking");
-              }
-          }
-      }
 
-      /*---------------------------------------------------------------------
-       * propagate 'learn' requests to DB
-       *---------------------------------------------------------------------*/
-      if(are_any_ports_set(&m->portsLrn))
+      if(m->decisionTime != 0)
       {
-          VLOG_DBG("MSTP_DBG Learning ports on informDB");
-          int lport = 0;
-          for(lport = find_first_port_set(&m->portsLrn);IS_VALID_LPORT(lport);
-                  lport = find_next_port_set(&m->portsLrn, lport))
-          {
-              char port[20] = {0};
-              intf_get_port_name(lport,port);
-              if (m->mstid != 0){
-                  mstp_util_set_msti_port_table_string(PORT_STATE,"Learning",m->mstid,lport);
-              }
-              else
-              {
-                  mstp_util_set_cist_port_table_string(port,PORT_STATE,"Learning");
-              }
-          }
-        clear_port_map(&m->portsLrn);
+         decisionTime[numDecisions++] = m->decisionTime;
+         m->decisionTime = 0;
       }
 
       /*---------------------------------------------------------------------
-       * propagate 'forward' requests to DB
+       * ports still waiting to be restored after a warm restart keep the
+       * state DB has for them
        *---------------------------------------------------------------------*/
-      if(are_any_ports_set(&m->portsFwd))
-      {
-         VLOG_DBG("MSTP_DBG Forwarding ports on informDB");
-         isfwd_msg = TRUE;
-          int lport = 0;
-          for(lport = find_first_port_set(&m->portsFwd);IS_VALID_LPORT(lport);
-                  lport = find_next_port_set(&m->portsFwd, lport))
-          {
-              char port[20] = {0};
-              intf_get_port_name(lport,port);
-              if (m->mstid == MSTP_NON_STP_BRIDGE){
-                  int mstid = 0;
-                  mstp_util_set_cist_port_table_string(port,PORT_STATE,"Forwarding");
-                  for(mstid = 1; mstid < MSTP_MSTID_MAX; mstid++)
-                  {
-                      if (MSTP_MSTI_VALID(mstid))
-                      {
-                          mstp_util_set_msti_port_table_string(PORT_STATE,"Forwarding",mstid,lport);
-                      }
-                  }
-              }
-              else if (m->mstid != 0){
-                  mstp_util_set_msti_port_table_string(PORT_STATE,"Forwarding",m->mstid,lport);
-              }
-              else
-              {
-                  mstp_util_set_cist_port_table_string(port,PORT_STATE,"Forwarding");
-              }
-          }
-      }
-      if(are_any_ports_set(&m->portsUp))
-      {
-          int lport = 0;
-          for(lport = find_first_port_set(&m->portsUp);IS_VALID_LPORT(lport);
-                  lport = find_next_port_set(&m->portsUp, lport))
-          {
-              char port[20] = {0};
-              intf_get_port_name(lport,port);
-              OVSREC_PORT_FOR_EACH(port_row,idl)
-              {
-                  if(strcmp(port_row->name,port)==0)
-                  {
-                      smap_clone(&smap_other_config, &port_row->hw_config);
-                      smap_replace(&smap_other_config, BLOCK_ALL_MSTP, "false");
-                      ovsrec_port_set_hw_config(port_row, &smap_other_config);
-                      smap_destroy(&smap_other_config);
-                  }
-              }
-          }
-          clear_port_map(&m->portsUp);
-      }
+      mstp_ckptHoldMask(m);
 
-#if 0
-      if(are_any_ports_set(&m->portsClearEdge))
+      if((m->mstid <= MSTP_INSTANCES_MAX) ||
+         (m->mstid == MSTP_NON_STP_BRIDGE))
       {
-         mstp_updatePortSecurity(&m->portsClearEdge,FALSE);
-         clear_port_map(&m->portsClearEdge);
-      }
-#endif /*0*/
-      /*Clear the block port map*/
-      if(isblk_msg)
-      {
-         clear_port_map(&m->portsBlk);
-         isblk_msg = FALSE;
-      }
-       /*Clear the forward port map*/
-      if(isfwd_msg)
-      {
-         clear_port_map(&m->portsFwd);
-         isfwd_msg = FALSE;
+         mstp_dbBlockSetCells(&m->portsDwn, MSTP_DB_BLOCK_ALL_ON);
+         mstp_dbStateSetCells(m->mstid, &m->portsBlk,
+                              MSTP_DB_PORT_STATE_BLOCKING);
+         mstp_dbStateSetCells(m->mstid, &m->portsLrn,
+                              MSTP_DB_PORT_STATE_LEARNING);
+         mstp_dbStateSetCells(m->mstid, &m->portsFwd,
+                              MSTP_DB_PORT_STATE_FORWARDING);
+         mstp_dbBlockSetCells(&m->portsUp, MSTP_DB_BLOCK_ALL_OFF);
       }
+      clear_port_map(&m->portsDwn);
+      clear_port_map(&m->portsBlk);
+      clear_port_map(&m->portsLrn);
+      clear_port_map(&m->portsFwd);
+      clear_port_map(&m->portsUp);
 
       if(operation == e_mstpd_timer)
       {
+         /*------------------------------------------------------------------
+          * collect MAC flush requests of all the trees, they are issued
+          * below as one aggregated request
+          *------------------------------------------------------------------*/
          if(are_any_ports_set(&m->portsMacAddrFlush) &&
             (m->mstid <= MSTP_INSTANCES_MAX))
          {
-             int lport = 0;
-             for(lport = find_first_port_set(&m->portsMacAddrFlush);IS_VALID_LPORT(lport);
-                     lport = find_next_port_set(&m->portsMacAddrFlush, lport))
-             {
-                 char port[20] = {0};
-                 intf_get_port_name(lport,port);
-                 if (m->mstid != 0){
-                     mstp_util_msti_flush_mac_address(m->mstid,lport);
-                 }
-                 else
-                 {
-                     mstp_util_cist_flush_mac_address(port);
-                 }
-             }
+             mstp_CB.flushReqCnt += get_num_of_ports_set(&m->portsMacAddrFlush);
+             bit_or_port_maps(&m->portsMacAddrFlush, &flushPorts);
          }
 
-         remove_msg = TRUE;
+         /*------------------------------------------------------------------
+          * take pending message off the queue and give its slot back
+          *------------------------------------------------------------------*/
+         mstp_releaseMstiPortStateChgMsg(m);
       }
+   }
+   /*------------------------------------------------------------------------
+    * account tree message slots used by the burst that is being drained
+    *------------------------------------------------------------------------*/
+   if((operation == e_mstpd_timer) && mstp_CB.treeMsgSlotUseCur)
+   {
+      mstp_CB.treeMsgSlotUseLast = mstp_CB.treeMsgSlotUseCur;
+      if(mstp_CB.treeMsgSlotUseCur > mstp_CB.treeMsgSlotUseWm)
+         mstp_CB.treeMsgSlotUseWm = mstp_CB.treeMsgSlotUseCur;
+      mstp_CB.treeMsgSlotUseCur = 0;
+      mstp_CB.treeMsgDrainCnt++;
+   }
 
-      /*---------------------------------------------------------------------
-       * take pending message off the queue and free it
-       *---------------------------------------------------------------------*/
-      if(remove_msg)
+   for(mstid = 0; mstid <= MSTP_INSTANCES_MAX; mstid++)
+   {
+      chgTree[mstid] = are_any_ports_set(&mstp_dbStateChg[mstid]);
+      anyChg |= chgTree[mstid];
+   }
+   anyChg |= are_any_ports_set(&mstp_dbBlockChg);
+
+   if(!anyChg && !are_any_ports_set(&flushPorts))
+      return;
+
+   /*------------------------------------------------------------------------
+    * stage 2: hand the cells, the 'block_all_mstp' changes and the MAC
+    * flush to the OVSDB thread, it writes them in one transaction and
+    * records the decision to commit latencies
+    *------------------------------------------------------------------------*/
+   mstp_dbOutboxStagePortStates(&mstp_dbStatePending, mstp_dbStateChg,
+                                &mstp_dbBlockChg, &flushPorts,
+                                decisionTime, anyChg ? numDecisions : 0);
+
+   /*------------------------------------------------------------------------
+    * stage 3: remember what DB will have once the transaction commits.
+    * The OVSDB thread reports back what became of every cell, it is taken
+    * at the next call.
+    *------------------------------------------------------------------------*/
+   for(mstid = 0; mstid <= MSTP_INSTANCES_MAX; mstid++)
+   {
+      if(!chgTree[mstid])
+         continue;
+      for(lport = find_first_port_set(&mstp_dbStateChg[mstid]);
+          IS_VALID_LPORT(lport);
+          lport = find_next_port_set(&mstp_dbStateChg[mstid], lport))
       {
-         remqhere_nodis(&MSTP_TREE_MSGS_QUEUE, &m->link);
-         free(m);
+         mstp_dbStateStaged.state[mstid][lport] =
+            mstp_dbStatePending.state[mstid][lport];
       }
+      clear_port_map(&mstp_dbStateChg[mstid]);
    }
-   ovsdb_idl_txn_commit_block(txn);
-   ovsdb_idl_txn_destroy(txn);
-   MSTP_OVSDB_UNLOCK;
+   for(lport = find_first_port_set(&mstp_dbBlockChg); IS_VALID_LPORT(lport);
+       lport = find_next_port_set(&mstp_dbBlockChg, lport))
+   {
+      mstp_dbStateStaged.blockAll[lport] =
+         mstp_dbStatePending.blockAll[lport];
+   }
+   clear_port_map(&mstp_dbBlockChg);
 }
 /**PROC+**********************************************************************
  * Name:      update_mstp_on_lport_add
@@ -2026,8 +2675,7 @@ void update_mstp_on_lport_add(int lport)
          * Allocate memory to keep port's data
          * (common for the CIST and the MSTIs)
          *------------------------------------------------------------------*/
-        MSTP_COMM_PORT_PTR(lport) = (MSTP_COMM_PORT_INFO_t *)malloc(sizeof(MSTP_COMM_PORT_INFO_t));
-        memset(MSTP_COMM_PORT_PTR(lport), 0,sizeof(MSTP_COMM_PORT_INFO_t));
+        MSTP_COMM_PORT_PTR(lport) = mstp_portArenaCommAlloc();
     }
     commPortPtr = MSTP_COMM_PORT_PTR(lport);
     if(!MSTP_CIST_PORT_PTR(lport))
@@ -2035,7 +2683,7 @@ void update_mstp_on_lport_add(int lport)
         /*------------------------------------------------------------------
          * Allocate memory to keep CIST port's data
          *------------------------------------------------------------------*/
-        MSTP_CIST_PORT_PTR(lport) = (MSTP_CIST_PORT_INFO_t *)calloc(1, sizeof(MSTP_CIST_PORT_INFO_t));
+        MSTP_CIST_PORT_PTR(lport) = mstp_portArenaCistAlloc(lport);
     }
     cistPortPtr = MSTP_CIST_PORT_PTR(lport);
     MSTP_SET_PORT_NUM(cistPortPtr->portId,lport);
@@ -2045,8 +2693,8 @@ void update_mstp_on_lport_add(int lport)
     if(MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap,
                 MSTP_PORT_PORT_ENABLED) && MSTP_ENABLED)
     {/* Port is 'Enabled' and the path cost value has changed,
-      * indicate that protocol re-initialization is required */
-        MSTP_DYN_RECONFIG_CHANGE = TRUE;
+      * indicate that the port needs to be restarted */
+        mstp_setDynReconfigPortFlag(MSTP_NO_MSTID, lport);
     }
     MSTP_COMM_PORT_CLR_BIT(commPortPtr->bitMap,
             MSTP_PORT_ADMIN_EDGE_PORT);
@@ -2072,8 +2720,8 @@ void update_mstp_on_lport_add(int lport)
         if(MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap,
                     MSTP_PORT_PORT_ENABLED) && MSTP_ENABLED)
         {/* Port is 'Enabled' and the priority value has changed,
-          * indicate that protocol re-initialization is required */
-            MSTP_DYN_RECONFIG_CHANGE = TRUE;
+          * indicate that the port needs to be restarted */
+            mstp_setDynReconfigPortFlag(MSTP_NO_MSTID, lport);
         }
     }
     MSTP_CIST_PORT_PTR(lport)->portTimes.fwdDelay =
@@ -2116,9 +2764,9 @@ void update_mstp_on_lport_add(int lport)
             mstp_isPortRoleSetOnAnyTree(lport, MSTP_PORT_ROLE_ALTERNATE) &&
             MSTP_ENABLED)
     {/* Port is 'Enabled', is the 'Alternate' and 'restrictedRole'
-      * flag is cleared, indicate that protocol re-initialization
-      * is required */
-        MSTP_DYN_RECONFIG_CHANGE = TRUE;
+      * flag is cleared, indicate that the port needs to be
+      * restarted on every tree */
+        mstp_setDynReconfigPortFlag(MSTP_NO_MSTID, lport);
     }
     MSTP_COMM_PORT_CLR_BIT(commPortPtr->bitMap,
             MSTP_PORT_RESTRICTED_TCN);
@@ -2126,7 +2774,7 @@ void update_mstp_on_lport_add(int lport)
     {/* Changing to OFF. */
         MSTP_COMM_CLR_BPDU_FILTER(lport);
         if(MSTP_CIST_PORT_PTR(lport))
-            MSTP_CIST_PORT_PTR(lport)->dbgCnts.errantBpduCnt = 0;
+            MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.errantBpduCnt = 0;
         if(MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap,
                     MSTP_PORT_PORT_ENABLED))
         {
@@ -2157,7 +2805,7 @@ void update_mstp_on_lport_add(int lport)
         /* Changing to OFF. */
         MSTP_COMM_PORT_CLR_BPDU_PROTECTION(lport);
         if(MSTP_CIST_PORT_PTR(lport))
-            MSTP_CIST_PORT_PTR(lport)->dbgCnts.errantBpduCnt = 0;
+            MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.errantBpduCnt = 0;
 
         /* Attempt to bring port back up if currently disabled */
         commPortPtr = MSTP_COMM_PORT_PTR(lport);
@@ -2202,7 +2850,7 @@ void update_mstp_on_lport_add(int lport)
          *---------------------------------------------------------------------*/
         if(reconfig_needed && MSTP_ENABLED)
         {
-            MSTP_DYN_RECONFIG_CHANGE = TRUE;
+            mstp_setDynReconfigPortFlag(MSTP_NO_MSTID, lport);
         }
     }
     int mstid = 1;
@@ -2218,8 +2866,7 @@ void update_mstp_on_lport_add(int lport)
              * Allocate memory to keep port's data
              * (common for the CIST and the MSTIs)
              *------------------------------------------------------------------*/
-            MSTP_COMM_PORT_PTR(lport) = (MSTP_COMM_PORT_INFO_t *)malloc(sizeof(MSTP_COMM_PORT_INFO_t));
-            memset(MSTP_COMM_PORT_PTR(lport), 0,sizeof(MSTP_COMM_PORT_INFO_t));
+            MSTP_COMM_PORT_PTR(lport) = mstp_portArenaCommAlloc();
         }
         commPortPtr = MSTP_COMM_PORT_PTR(lport);
         if(!MSTP_MSTI_PORT_PTR(mstid, lport))
@@ -2227,7 +2874,7 @@ void update_mstp_on_lport_add(int lport)
             /*------------------------------------------------------------------
              * Allocate memory to keep MSTI port's data
              *------------------------------------------------------------------*/
-            MSTP_MSTI_PORT_PTR(mstid, lport) = (MSTP_MSTI_PORT_INFO_t *)calloc(1, sizeof(MSTP_MSTI_PORT_INFO_t));
+            MSTP_MSTI_PORT_PTR(mstid, lport) = mstp_portArenaMstiAlloc(mstid, lport);
         }
         mstiPortPtr = MSTP_MSTI_PORT_PTR(mstid, lport);
         MSTP_SET_PORT_NUM(mstiPortPtr->portId,lport);
@@ -2236,8 +2883,8 @@ void update_mstp_on_lport_add(int lport)
         if(MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap,
                     MSTP_PORT_PORT_ENABLED) && MSTP_ENABLED)
         {/* Port is 'Enabled' and the priority value has changed,
-          * indicate that protocol re-initialization is required */
-            MSTP_DYN_RECONFIG_CHANGE = TRUE;
+          * indicate that the port needs to be restarted */
+            mstp_setDynReconfigPortFlag(mstid, lport);
         }
         path_cost = mstp_portAutoPathCostDetect(lport);
         mstiPortPtr->useCfgPathCost = path_cost;
@@ -2247,8 +2894,8 @@ void update_mstp_on_lport_add(int lport)
             if(MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap,
                         MSTP_PORT_PORT_ENABLED) && MSTP_ENABLED)
             {/* Port is 'Enabled' and the path cost value has changed,
-              * indicate that protocol re-initialization is required */
-                MSTP_DYN_RECONFIG_CHANGE = TRUE;
+              * indicate that the port needs to be restarted */
+                mstp_setDynReconfigPortFlag(mstid, lport);
             }
         }
     }
@@ -0,0 +1,1042 @@
+/*
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+/**********************************************************************************
+ *    File               : mstpd_db_outbox.c
+ *    Description        : Hand-off of the protocol thread's DB writes to the
+ *                         OVSDB thread. The protocol thread stages its writes
+ *                         in a private batch and commits it at the end of an
+ *                         event; the OVSDB thread applies the queued batches
+ *                         from its main loop, one transaction per batch.
+ **********************************************************************************/
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <util.h>
+#include <hash.h>
+#include <hmap.h>
+#include <seq.h>
+#include <vswitch-idl.h>
+#include <openvswitch/vlog.h>
+#include "mstp_fsm.h"
+#include "mstp_inlines.h"
+#include "mstp_ovsdb_if.h"
+#include "mstp_cmn.h"
+#include "mstp.h"
+
+VLOG_DEFINE_THIS_MODULE(mstpd_db_outbox);
+
+#define MSTP_DB_CELL_COLUMN_LEN   48
+
+typedef enum mstp_db_cell_kind
+{
+   MSTP_DB_CELL_CIST = 0,
+   MSTP_DB_CELL_CIST_PORT,
+   MSTP_DB_CELL_MSTI,
+   MSTP_DB_CELL_MSTI_PORT,
+   MSTP_DB_CELL_BRIDGE_STATUS
+
+} MSTP_DB_CELL_KIND_t;
+
+typedef enum mstp_db_cell_type
+{
+   MSTP_DB_CELL_VALUE = 0,
+   MSTP_DB_CELL_STRING,
+   MSTP_DB_CELL_BOOL
+
+} MSTP_DB_CELL_TYPE_t;
+
+/*---------------------------------------------------------------------------
+ * One column (or map key) of one row. A cell is identified by its kind,
+ * the tree, the port (by name for the CIST port table, by lport for the
+ * MSTI port table) and the column; staging it again replaces the value.
+ *---------------------------------------------------------------------------*/
+typedef struct mstp_db_cell
+{
+   struct hmap_node     node;
+   MSTP_DB_CELL_KIND_t  kind;
+   MSTP_DB_CELL_TYPE_t  type;
+   int                  mstid;
+   int                  lport;
+   char                 portName[PORTNAME_LEN];
+   char                 column[MSTP_DB_CELL_COLUMN_LEN];
+   int64_t              value;
+   char                *string;
+
+} MSTP_DB_CELL_t;
+
+typedef struct mstp_db_job_ent
+{
+   struct mstp_db_job_ent *next;
+   MSTP_DB_JOB_t           job;
+   int                     arg;
+   char                    name[PORTNAME_LEN];
+   VID_MAP                *vids;        /* VLAN_ADD/VLAN_DELETE only */
+
+} MSTP_DB_JOB_ENT_t;
+
+/*---------------------------------------------------------------------------
+ * What the protocol thread hands over in one go. Jobs run first, in
+ * posting order, then everything else is written in one transaction.
+ *---------------------------------------------------------------------------*/
+typedef struct mstp_db_batch
+{
+   struct mstp_db_batch     *next;
+   MSTP_DB_JOB_ENT_t        *jobHead;
+   MSTP_DB_JOB_ENT_t        *jobTail;
+   struct hmap               cells;
+   uint32_t                  cellCnt;          /* cells staged            */
+   uint32_t                  cellCoalescedCnt; /* ... and replaced        */
+   MSTP_DB_PORT_STATE_VEC_t  vec;
+   PORT_MAP                  stateChg[MSTP_INSTANCES_MAX + 1];
+   PORT_MAP                  blockChg;
+   PORT_MAP                  flushPorts;
+   PORT_MAP                  statsChg;
+   MSTP_DB_PORT_STATS_t      stats[MAX_LPORTS + 1];
+   int                       numDecisions;
+   uint64_t                  decisionTime[MSTP_TREE_MSG_SLOTS];
+
+} MSTP_DB_BATCH_t;
+
+/* protocol thread only */
+static MSTP_DB_BATCH_t *mstp_dbStaging = NULL;
+
+/* shared, protected by 'mstp_dbOutboxMutex' */
+static pthread_mutex_t         mstp_dbOutboxMutex = PTHREAD_MUTEX_INITIALIZER;
+static MSTP_DB_BATCH_t        *mstp_dbQueueHead = NULL;
+static MSTP_DB_BATCH_t        *mstp_dbQueueTail = NULL;
+static uint32_t                mstp_dbQueueLen = 0;
+static MSTP_DB_PORT_STATE_RESULT_t mstp_dbResult;
+static bool                    mstp_dbResultPending = FALSE; /* atomic */
+static MSTP_DB_OUTBOX_STATS_t  mstp_dbOutboxStats;
+
+/* changed on every commit, the OVSDB thread wakes up on it */
+static struct seq *mstp_dbOutboxSeq = NULL;
+/* OVSDB thread only */
+static uint64_t    mstp_dbOutboxSeqSeen = 0;
+
+static uint32_t
+mstp_dbCellHash(MSTP_DB_CELL_KIND_t kind, int mstid, int lport,
+                const char *portName, const char *column)
+{
+   uint32_t hash;
+
+   hash = hash_int(kind, 0);
+   hash = hash_int(mstid, hash);
+   hash = hash_int(lport, hash);
+   hash = hash_string(portName, hash);
+   return hash_string(column, hash);
+}
+
+static MSTP_DB_BATCH_t *
+mstp_dbBatchCreate(void)
+{
+   MSTP_DB_BATCH_t *batch = xzalloc(sizeof(*batch));
+
+   hmap_init(&batch->cells);
+   return batch;
+}
+
+static bool
+mstp_dbBatchHasWrites(const MSTP_DB_BATCH_t *batch)
+{
+   int mstid;
+
+   if(!hmap_is_empty(&batch->cells) ||
+      are_any_ports_set(&batch->blockChg) ||
+      are_any_ports_set(&batch->flushPorts) ||
+      are_any_ports_set(&batch->statsChg))
+      return TRUE;
+
+   for(mstid = 0; mstid <= MSTP_INSTANCES_MAX; mstid++)
+   {
+      if(are_any_ports_set(&batch->stateChg[mstid]))
+         return TRUE;
+   }
+   return FALSE;
+}
+
+static void
+mstp_dbCellFree(MSTP_DB_CELL_t *cell)
+{
+   free(cell->string);
+   free(cell);
+}
+
+/* Empties 'batch' so that it can be staged into again */
+static void
+mstp_dbBatchReset(MSTP_DB_BATCH_t *batch)
+{
+   MSTP_DB_JOB_ENT_t *ent;
+   MSTP_DB_CELL_t    *cell;
+   MSTP_DB_CELL_t    *next;
+   int                mstid;
+
+   while((ent = batch->jobHead) != NULL)
+   {
+      batch->jobHead = ent->next;
+      free(ent->vids);
+      free(ent);
+   }
+   batch->jobTail = NULL;
+
+   HMAP_FOR_EACH_SAFE(cell, next, node, &batch->cells)
+   {
+      hmap_remove(&batch->cells, &cell->node);
+      mstp_dbCellFree(cell);
+   }
+   batch->cellCnt = 0;
+   batch->cellCoalescedCnt = 0;
+
+   for(mstid = 0; mstid <= MSTP_INSTANCES_MAX; mstid++)
+      clear_port_map(&batch->stateChg[mstid]);
+   clear_port_map(&batch->blockChg);
+   clear_port_map(&batch->flushPorts);
+   clear_port_map(&batch->statsChg);
+   batch->numDecisions = 0;
+   batch->next = NULL;
+}
+
+static void
+mstp_dbBatchFree(MSTP_DB_BATCH_t *batch)
+{
+   mstp_dbBatchReset(batch);
+   hmap_destroy(&batch->cells);
+   free(batch);
+}
+
+/*---------------------------------------------------------------------------
+ * Puts 'cell' into 'batch', replacing the value of the same cell if there
+ * is one. Returns TRUE if a value has been replaced.
+ *---------------------------------------------------------------------------*/
+static bool
+mstp_dbBatchPutCell(MSTP_DB_BATCH_t *batch, MSTP_DB_CELL_t *cell)
+{
+   MSTP_DB_CELL_t *old;
+
+   HMAP_FOR_EACH_WITH_HASH(old, node, cell->node.hash, &batch->cells)
+   {
+      if((old->kind == cell->kind) && (old->mstid == cell->mstid) &&
+         (old->lport == cell->lport) &&
+         !strcmp(old->portName, cell->portName) &&
+         !strcmp(old->column, cell->column))
+      {
+         hmap_replace(&batch->cells, &old->node, &cell->node);
+         mstp_dbCellFree(old);
+         return TRUE;
+      }
+   }
+   hmap_insert_fast(&batch->cells, &cell->node, cell->node.hash);
+   return FALSE;
+}
+
+/*---------------------------------------------------------------------------
+ * Merges 'src', which has no jobs, into 'dst'. The values of 'src' are
+ * newer and win. The cells are moved, 'src' is left empty.
+ *---------------------------------------------------------------------------*/
+static void
+mstp_dbBatchMerge(MSTP_DB_BATCH_t *dst, MSTP_DB_BATCH_t *src)
+{
+   MSTP_DB_CELL_t *cell;
+   MSTP_DB_CELL_t *next;
+   MSTID_t         mstid;
+   int             lport;
+   int             i;
+
+   STP_ASSERT(src->jobHead == NULL);
+
+   HMAP_FOR_EACH_SAFE(cell, next, node, &src->cells)
+   {
+      hmap_remove(&src->cells, &cell->node);
+      if(mstp_dbBatchPutCell(dst, cell))
+         dst->cellCoalescedCnt++;
+   }
+
+   for(mstid = 0; mstid <= MSTP_INSTANCES_MAX; mstid++)
+   {
+      for(lport = find_first_port_set(&src->stateChg[mstid]);
+          IS_VALID_LPORT(lport);
+          lport = find_next_port_set(&src->stateChg[mstid], lport))
+      {
+         dst->vec.state[mstid][lport] = src->vec.state[mstid][lport];
+      }
+      bit_or_port_maps(&src->stateChg[mstid], &dst->stateChg[mstid]);
+   }
+   for(lport = find_first_port_set(&src->blockChg); IS_VALID_LPORT(lport);
+       lport = find_next_port_set(&src->blockChg, lport))
+   {
+      dst->vec.blockAll[lport] = src->vec.blockAll[lport];
+   }
+   bit_or_port_maps(&src->blockChg, &dst->blockChg);
+   bit_or_port_maps(&src->flushPorts, &dst->flushPorts);
+
+   for(lport = find_first_port_set(&src->statsChg); IS_VALID_LPORT(lport);
+       lport = find_next_port_set(&src->statsChg, lport))
+   {
+      dst->stats[lport] = src->stats[lport];
+   }
+   bit_or_port_maps(&src->statsChg, &dst->statsChg);
+
+   for(i = 0; (i < src->numDecisions) &&
+              (dst->numDecisions < MSTP_TREE_MSG_SLOTS); i++)
+   {
+      dst->decisionTime[dst->numDecisions++] = src->decisionTime[i];
+   }
+}
+
+static MSTP_DB_BATCH_t *
+mstp_dbStagingGet(void)
+{
+   if(!mstp_dbStaging)
+      mstp_dbStaging = mstp_dbBatchCreate();
+   return mstp_dbStaging;
+}
+
+static void
+mstp_dbOutboxStageCell(MSTP_DB_CELL_KIND_t kind, MSTP_DB_CELL_TYPE_t type,
+                       const char *column, const char *portName,
+                       int mstid, int lport, int64_t value,
+                       const char *string)
+{
+   MSTP_DB_BATCH_t *batch = mstp_dbStagingGet();
+   MSTP_DB_CELL_t  *cell;
+
+   STP_ASSERT(column);
+   STP_ASSERT(strlen(column) < MSTP_DB_CELL_COLUMN_LEN);
+
+   cell = xzalloc(sizeof(*cell));
+   cell->kind = kind;
+   cell->type = type;
+   cell->mstid = mstid;
+   cell->lport = lport;
+   if(portName)
+      strncpy(cell->portName, portName, PORTNAME_LEN - 1);
+   strncpy(cell->column, column, MSTP_DB_CELL_COLUMN_LEN - 1);
+   cell->value = value;
+   cell->string = string ? xstrdup(string) : NULL;
+   cell->node.hash = mstp_dbCellHash(kind, mstid, lport, cell->portName,
+                                     cell->column);
+
+   batch->cellCnt++;
+   if(mstp_dbBatchPutCell(batch, cell))
+      batch->cellCoalescedCnt++;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_dbOutboxInit
+ *
+ * Purpose:   Create the outbox wake-up sequence. Called once, before the
+ *            OVSDB and the protocol threads are started.
+ *
+ * Params:    none
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_dbOutboxSeq, mstp_dbOutboxSeqSeen
+ **PROC-**********************************************************************/
+void
+mstp_dbOutboxInit(void)
+{
+   if(mstp_dbOutboxSeq)
+      return;
+   mstp_dbOutboxSeq = seq_create();
+   mstp_dbOutboxSeqSeen = seq_read(mstp_dbOutboxSeq);
+}
+
+/*---------------------------------------------------------------------------
+ * Protocol thread side: the 'mstp_util_set_*' setters only stage the cell.
+ *---------------------------------------------------------------------------*/
+void
+mstp_util_set_cist_port_table_bool(const char *if_name, const char *key,
+                                   const bool value)
+{
+   mstp_dbOutboxStageCell(MSTP_DB_CELL_CIST_PORT, MSTP_DB_CELL_BOOL, key,
+                          if_name, MSTP_CISTID, 0, value, NULL);
+}
+
+void
+mstp_util_set_cist_table_value(const char *key, int64_t value)
+{
+   mstp_dbOutboxStageCell(MSTP_DB_CELL_CIST, MSTP_DB_CELL_VALUE, key,
+                          NULL, MSTP_CISTID, 0, value, NULL);
+}
+
+void
+mstp_util_set_cist_table_string(const char *key, const char *string)
+{
+   mstp_dbOutboxStageCell(MSTP_DB_CELL_CIST, MSTP_DB_CELL_STRING, key,
+                          NULL, MSTP_CISTID, 0, 0, string);
+}
+
+void
+mstp_util_set_cist_port_table_value(const char *if_name, const char *key,
+                                    int64_t value)
+{
+   mstp_dbOutboxStageCell(MSTP_DB_CELL_CIST_PORT, MSTP_DB_CELL_VALUE, key,
+                          if_name, MSTP_CISTID, 0, value, NULL);
+}
+
+void
+mstp_util_set_cist_port_table_string(const char *if_name, const char *key,
+                                     char *string)
+{
+   mstp_dbOutboxStageCell(MSTP_DB_CELL_CIST_PORT, MSTP_DB_CELL_STRING, key,
+                          if_name, MSTP_CISTID, 0, 0, string);
+}
+
+void
+mstp_util_set_msti_table_string(const char *key, const char *string,
+                                int mstid)
+{
+   mstp_dbOutboxStageCell(MSTP_DB_CELL_MSTI, MSTP_DB_CELL_STRING, key,
+                          NULL, mstid, 0, 0, string);
+}
+
+void
+mstp_util_set_msti_table_value(const char *key, int64_t value, int mstid)
+{
+   mstp_dbOutboxStageCell(MSTP_DB_CELL_MSTI, MSTP_DB_CELL_VALUE, key,
+                          NULL, mstid, 0, value, NULL);
+}
+
+void
+mstp_util_set_msti_port_table_value(const char *key, int64_t value,
+                                    int mstid, int lport)
+{
+   mstp_dbOutboxStageCell(MSTP_DB_CELL_MSTI_PORT, MSTP_DB_CELL_VALUE, key,
+                          NULL, mstid, lport, value, NULL);
+}
+
+void
+mstp_util_set_msti_port_table_string(const char *key, char *string,
+                                     int mstid, int lport)
+{
+   mstp_dbOutboxStageCell(MSTP_DB_CELL_MSTI_PORT, MSTP_DB_CELL_STRING, key,
+                          NULL, mstid, lport, 0, string);
+}
+
+void
+mstp_util_set_bridge_status(const char *key, const char *string)
+{
+   mstp_dbOutboxStageCell(MSTP_DB_CELL_BRIDGE_STATUS, MSTP_DB_CELL_STRING,
+                          key, NULL, 0, 0, 0, string);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_dbOutboxStagePortStates
+ *
+ * Purpose:   Stage the port state cells, the 'block_all_mstp' changes and
+ *            the MAC flush decided by 'mstp_informDBOnPortStateChange'.
+ *
+ * Params:    vec          -> cell values
+ *            stateChg     -> per tree maps of the cells to write
+ *            blockChg     -> ports whose 'block_all_mstp' must be written
+ *            flushPorts   -> ports to flush
+ *            decisionTime -> when the decisions behind the cells were taken
+ *            numDecisions -> number of entries in 'decisionTime'
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_dbStaging
+ **PROC-**********************************************************************/
+void
+mstp_dbOutboxStagePortStates(const MSTP_DB_PORT_STATE_VEC_t *vec,
+                             const PORT_MAP *stateChg,
+                             const PORT_MAP *blockChg,
+                             const PORT_MAP *flushPorts,
+                             const uint64_t *decisionTime,
+                             int numDecisions)
+{
+   MSTP_DB_BATCH_t *batch = mstp_dbStagingGet();
+   MSTID_t          mstid;
+   int              lport;
+   int              i;
+
+   for(mstid = 0; mstid <= MSTP_INSTANCES_MAX; mstid++)
+   {
+      for(lport = find_first_port_set(&stateChg[mstid]);
+          IS_VALID_LPORT(lport);
+          lport = find_next_port_set(&stateChg[mstid], lport))
+      {
+         batch->vec.state[mstid][lport] = vec->state[mstid][lport];
+      }
+      bit_or_port_maps(&stateChg[mstid], &batch->stateChg[mstid]);
+   }
+   for(lport = find_first_port_set(blockChg); IS_VALID_LPORT(lport);
+       lport = find_next_port_set(blockChg, lport))
+   {
+      batch->vec.blockAll[lport] = vec->blockAll[lport];
+   }
+   bit_or_port_maps(blockChg, &batch->blockChg);
+   bit_or_port_maps(flushPorts, &batch->flushPorts);
+
+   for(i = 0; (i < numDecisions) &&
+              (batch->numDecisions < MSTP_TREE_MSG_SLOTS); i++)
+   {
+      batch->decisionTime[batch->numDecisions++] = decisionTime[i];
+   }
+}
+
+void
+mstp_dbOutboxStageStats(LPORT_t lport, const MSTP_DB_PORT_STATS_t *stats)
+{
+   MSTP_DB_BATCH_t *batch = mstp_dbStagingGet();
+
+   STP_ASSERT(IS_VALID_LPORT(lport));
+   batch->stats[lport] = *stats;
+   set_port(&batch->statsChg, lport);
+}
+
+static MSTP_DB_JOB_ENT_t *
+mstp_dbOutboxJobAppend(MSTP_DB_JOB_t job)
+{
+   MSTP_DB_BATCH_t   *batch;
+   MSTP_DB_JOB_ENT_t *ent;
+
+   STP_ASSERT(job < MSTP_DB_JOB_MAX);
+
+   if(mstp_dbStaging && mstp_dbBatchHasWrites(mstp_dbStaging))
+      mstp_dbOutboxCommit();
+
+   batch = mstp_dbStagingGet();
+   ent = xzalloc(sizeof(*ent));
+   ent->job = job;
+
+   if(batch->jobTail)
+      batch->jobTail->next = ent;
+   else
+      batch->jobHead = ent;
+   batch->jobTail = ent;
+   return ent;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_dbOutboxPostJob
+ *
+ * Purpose:   Queue an operation for the OVSDB thread. Writes staged before
+ *            the job are committed first, so they are applied before it.
+ *
+ * Params:    job  -> operation
+ *            arg  -> lport or 0, depending on the job
+ *            name -> port name for PORT_ADD/PORT_DELETE, NULL otherwise
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_dbStaging
+ **PROC-**********************************************************************/
+void
+mstp_dbOutboxPostJob(MSTP_DB_JOB_t job, int arg, const char *name)
+{
+   MSTP_DB_JOB_ENT_t *ent;
+
+   STP_ASSERT((job != MSTP_DB_JOB_VLAN_ADD) &&
+              (job != MSTP_DB_JOB_VLAN_DELETE));
+
+   ent = mstp_dbOutboxJobAppend(job);
+   ent->arg = arg;
+   if(name)
+      strncpy(ent->name, name, PORTNAME_LEN - 1);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_dbOutboxPostVlanJob
+ *
+ * Purpose:   Queue a VLAN_ADD or VLAN_DELETE for a set of VLANs. A job of
+ *            the same kind right before it in the staged batch takes the
+ *            VLANs instead, the OVSDB thread writes a set in one
+ *            transaction.
+ *
+ * Params:    job  -> MSTP_DB_JOB_VLAN_ADD or MSTP_DB_JOB_VLAN_DELETE
+ *            vids -> VLANs
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_dbStaging
+ **PROC-**********************************************************************/
+void
+mstp_dbOutboxPostVlanJob(MSTP_DB_JOB_t job, const VID_MAP *vids)
+{
+   MSTP_DB_JOB_ENT_t *ent;
+
+   STP_ASSERT((job == MSTP_DB_JOB_VLAN_ADD) ||
+              (job == MSTP_DB_JOB_VLAN_DELETE));
+
+   if(!are_any_vids_set(vids))
+      return;
+
+   ent = mstp_dbStaging ? mstp_dbStaging->jobTail : NULL;
+   if(ent && (ent->job == job) && !mstp_dbBatchHasWrites(mstp_dbStaging))
+   {
+      bit_or_vid_maps(vids, ent->vids);
+      return;
+   }
+
+   ent = mstp_dbOutboxJobAppend(job);
+   ent->vids = xmalloc(sizeof(*ent->vids));
+   copy_vid_map(vids, ent->vids);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_dbOutboxCommit
+ *
+ * Purpose:   Hand what has been staged to the OVSDB thread. Called by the
+ *            protocol thread at the end of each event. A batch with no
+ *            jobs is merged into the last queued one.
+ *
+ * Params:    none
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_dbStaging, mstp_dbQueueHead, mstp_dbQueueTail
+ **PROC-**********************************************************************/
+void
+mstp_dbOutboxCommit(void)
+{
+   MSTP_DB_BATCH_t   *batch = mstp_dbStaging;
+   MSTP_DB_JOB_ENT_t *ent;
+
+   if(!batch || (!batch->jobHead && !mstp_dbBatchHasWrites(batch)))
+      return;
+
+   pthread_mutex_lock(&mstp_dbOutboxMutex);
+   mstp_dbOutboxStats.handoffCnt++;
+   mstp_dbOutboxStats.cellCnt += batch->cellCnt;
+   mstp_dbOutboxStats.cellCoalescedCnt += batch->cellCoalescedCnt;
+   batch->cellCnt = 0;
+   batch->cellCoalescedCnt = 0;
+   for(ent = batch->jobHead; ent; ent = ent->next)
+   {
+      mstp_dbOutboxStats.jobCnt[ent->job]++;
+      if(ent->vids)
+         mstp_dbOutboxStats.vlanCnt += count_vids(ent->vids);
+   }
+
+   if(!batch->jobHead && mstp_dbQueueTail)
+   {
+      mstp_dbBatchMerge(mstp_dbQueueTail, batch);
+      mstp_dbOutboxStats.cellCoalescedCnt +=
+         mstp_dbQueueTail->cellCoalescedCnt;
+      mstp_dbQueueTail->cellCoalescedCnt = 0;
+      mstp_dbOutboxStats.mergeCnt++;
+      pthread_mutex_unlock(&mstp_dbOutboxMutex);
+      /* keep the emptied batch for the next event */
+      mstp_dbBatchReset(batch);
+   }
+   else
+   {
+      if(mstp_dbQueueTail)
+         mstp_dbQueueTail->next = batch;
+      else
+         mstp_dbQueueHead = batch;
+      mstp_dbQueueTail = batch;
+      mstp_dbQueueLen++;
+      if(mstp_dbQueueLen > mstp_dbOutboxStats.backlogWm)
+         mstp_dbOutboxStats.backlogWm = mstp_dbQueueLen;
+      pthread_mutex_unlock(&mstp_dbOutboxMutex);
+      mstp_dbStaging = NULL;
+   }
+
+   seq_change(mstp_dbOutboxSeq);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_dbOutboxTakeResult
+ *
+ * Purpose:   Protocol thread: take what became of the port state and
+ *            'block_all_mstp' cells the OVSDB thread has written since the
+ *            last call: committed, failed to commit or missing their rows.
+ *
+ * Params:    result -> filled in
+ *
+ * Returns:   TRUE if 'result' has been filled in
+ *
+ * Globals:   mstp_dbResult, mstp_dbResultPending
+ **PROC-**********************************************************************/
+bool
+mstp_dbOutboxTakeResult(MSTP_DB_PORT_STATE_RESULT_t *result)
+{
+   MSTID_t mstid;
+
+   if(!__atomic_load_n(&mstp_dbResultPending, __ATOMIC_ACQUIRE))
+      return FALSE;
+
+   pthread_mutex_lock(&mstp_dbOutboxMutex);
+   *result = mstp_dbResult;
+   for(mstid = 0; mstid <= MSTP_INSTANCES_MAX; mstid++)
+   {
+      clear_port_map(&mstp_dbResult.stateCommitted[mstid]);
+      clear_port_map(&mstp_dbResult.stateFailed[mstid]);
+      clear_port_map(&mstp_dbResult.stateMissed[mstid]);
+   }
+   clear_port_map(&mstp_dbResult.blockCommitted);
+   clear_port_map(&mstp_dbResult.blockFailed);
+   clear_port_map(&mstp_dbResult.blockMissed);
+   __atomic_store_n(&mstp_dbResultPending, FALSE, __ATOMIC_RELEASE);
+   pthread_mutex_unlock(&mstp_dbOutboxMutex);
+   return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * Fold the cells 'done' of a batch into the result the protocol thread
+ * takes, as committed or failed; a cell written by a later batch only
+ * keeps the outcome of that batch. Called with 'mstp_dbOutboxMutex' held.
+ *---------------------------------------------------------------------------*/
+static void
+mstp_dbResultAdd(const MSTP_DB_BATCH_t *batch, const PORT_MAP *stateDone,
+                 const PORT_MAP *blockDone, bool committed)
+{
+   PORT_MAP *stateSet;
+   PORT_MAP *stateClr;
+   int       lport;
+   MSTID_t   mstid;
+
+   for(mstid = 0; mstid <= MSTP_INSTANCES_MAX; mstid++)
+   {
+      stateSet = committed ? &mstp_dbResult.stateCommitted[mstid] :
+                             &mstp_dbResult.stateFailed[mstid];
+      stateClr = committed ? &mstp_dbResult.stateFailed[mstid] :
+                             &mstp_dbResult.stateCommitted[mstid];
+      for(lport = find_first_port_set(&stateDone[mstid]);
+          IS_VALID_LPORT(lport);
+          lport = find_next_port_set(&stateDone[mstid], lport))
+      {
+         mstp_dbResult.vec.state[mstid][lport] =
+            batch->vec.state[mstid][lport];
+      }
+      bit_or_port_maps(&stateDone[mstid], stateSet);
+      bit_sub_port_maps(&stateDone[mstid], stateClr);
+   }
+
+   for(lport = find_first_port_set(blockDone); IS_VALID_LPORT(lport);
+       lport = find_next_port_set(blockDone, lport))
+   {
+      mstp_dbResult.vec.blockAll[lport] = batch->vec.blockAll[lport];
+   }
+   bit_or_port_maps(blockDone, committed ? &mstp_dbResult.blockCommitted :
+                                           &mstp_dbResult.blockFailed);
+   bit_sub_port_maps(blockDone, committed ? &mstp_dbResult.blockFailed :
+                                            &mstp_dbResult.blockCommitted);
+}
+
+/*---------------------------------------------------------------------------
+ * Account one decision to commit time. Called with 'mstp_dbOutboxMutex'
+ * held.
+ *---------------------------------------------------------------------------*/
+static void
+mstp_dbLatencyRecord(uint64_t usec)
+{
+   uint64_t msec = usec / 1000;
+   int      bucket = 0;
+
+   while((msec != 0) && (bucket < (MSTP_DB_LATENCY_BUCKETS - 1)))
+   {
+      msec >>= 1;
+      bucket++;
+   }
+   mstp_dbOutboxStats.latencyHist[bucket]++;
+   if(usec > mstp_dbOutboxStats.latencyMaxUsec)
+      mstp_dbOutboxStats.latencyMaxUsec = usec;
+}
+
+static void
+mstp_dbJobRun(MSTP_DB_JOB_ENT_t *ent)
+{
+   switch(ent->job)
+   {
+      case MSTP_DB_JOB_PORT_ADD:
+         update_port_entry_in_cist_mstp_instances(ent->name,
+                                                  e_mstpd_lport_add);
+         update_port_entry_in_msti_mstp_instances(ent->name,
+                                                  e_mstpd_lport_add);
+         break;
+      case MSTP_DB_JOB_PORT_DELETE:
+         update_port_entry_in_cist_mstp_instances(ent->name,
+                                                  e_mstpd_lport_delete);
+         update_port_entry_in_msti_mstp_instances(ent->name,
+                                                  e_mstpd_lport_delete);
+         break;
+      case MSTP_DB_JOB_VLAN_ADD:
+         handle_vlan_add_in_mstp_config(ent->vids);
+         break;
+      case MSTP_DB_JOB_VLAN_DELETE:
+         handle_vlan_delete_in_mstp_config(ent->vids);
+         break;
+      case MSTP_DB_JOB_PORT_ENABLE:
+         enable_or_disable_port(ent->arg, TRUE);
+         break;
+      case MSTP_DB_JOB_PORT_DISABLE:
+         enable_or_disable_port(ent->arg, FALSE);
+         break;
+      case MSTP_DB_JOB_ALL_FORWARD:
+         mstp_updatePortStateToForward();
+         break;
+      case MSTP_DB_JOB_CONFIG_RELOAD:
+         mstp_config_reload();
+         break;
+      default:
+         STP_ASSERT(FALSE);
+         break;
+   }
+}
+
+static bool
+mstp_dbCellWrite(const MSTP_DB_CELL_t *cell)
+{
+   switch(cell->kind)
+   {
+      case MSTP_DB_CELL_CIST:
+         if(cell->type == MSTP_DB_CELL_STRING)
+            return mstp_util_write_cist_table_string(cell->column,
+                                                     cell->string);
+         return mstp_util_write_cist_table_value(cell->column, cell->value);
+      case MSTP_DB_CELL_CIST_PORT:
+         if(cell->type == MSTP_DB_CELL_BOOL)
+            return mstp_util_write_cist_port_table_bool(cell->portName,
+                                                        cell->column,
+                                                        cell->value != 0);
+         if(cell->type == MSTP_DB_CELL_STRING)
+            return mstp_util_write_cist_port_table_string(cell->portName,
+                                                          cell->column,
+                                                          cell->string);
+         return mstp_util_write_cist_port_table_value(cell->portName,
+                                                      cell->column,
+                                                      cell->value);
+      case MSTP_DB_CELL_MSTI:
+         if(cell->type == MSTP_DB_CELL_STRING)
+            return mstp_util_write_msti_table_string(cell->column,
+                                                     cell->string,
+                                                     cell->mstid);
+         return mstp_util_write_msti_table_value(cell->column, cell->value,
+                                                 cell->mstid);
+      case MSTP_DB_CELL_MSTI_PORT:
+         if(cell->type == MSTP_DB_CELL_STRING)
+            return mstp_util_write_msti_port_table_string(cell->column,
+                                                          cell->string,
+                                                          cell->mstid,
+                                                          cell->lport);
+         return mstp_util_write_msti_port_table_value(cell->column,
+                                                      cell->value,
+                                                      cell->mstid,
+                                                      cell->lport);
+      case MSTP_DB_CELL_BRIDGE_STATUS:
+         return mstp_util_write_bridge_status(cell->column, cell->string);
+      default:
+         STP_ASSERT(FALSE);
+         return FALSE;
+   }
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_dbBatchApply
+ *
+ * Purpose:   OVSDB thread: run the jobs of 'batch', then write its cells,
+ *            port states, MAC flush and statistics in one transaction.
+ *
+ * Params:    batch -> batch taken off the queue
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_dbOutboxStats, mstp_dbResult
+ **PROC-**********************************************************************/
+static void
+mstp_dbBatchApply(MSTP_DB_BATCH_t *batch)
+{
+   struct ovsdb_idl_txn *txn;
+   MSTP_DB_JOB_ENT_t    *ent;
+   MSTP_DB_CELL_t       *cell;
+   PORT_MAP              stateMissed[MSTP_INSTANCES_MAX + 1];
+   PORT_MAP              blockMissed;
+   PORT_MAP              traceStamped[MSTP_INSTANCES_MAX + 1];
+   enum ovsdb_idl_txn_status status;
+   bool                  traced = FALSE;
+   bool                  anyState = FALSE;
+   bool                  anyMissed = FALSE;
+   bool                  txnDone = FALSE;
+   bool                  committed = FALSE;
+   uint32_t              cellsMissed = 0;
+   uint32_t              stateCells = 0;
+   uint32_t              flushedPorts = 0;
+   bool                  flushed = FALSE;
+   uint64_t              start;
+   uint64_t              now;
+   MSTID_t               mstid;
+   int                   i;
+
+   start = mstp_utilMonoUsec();
+
+   for(ent = batch->jobHead; ent; ent = ent->next)
+      mstp_dbJobRun(ent);
+
+   if(mstp_dbBatchHasWrites(batch))
+   {
+      for(mstid = 0; mstid <= MSTP_INSTANCES_MAX; mstid++)
+      {
+         copy_port_map(&batch->stateChg[mstid], &stateMissed[mstid]);
+         anyState |= are_any_ports_set(&batch->stateChg[mstid]);
+      }
+      copy_port_map(&batch->blockChg, &blockMissed);
+      anyState |= are_any_ports_set(&batch->blockChg);
+
+      MSTP_OVSDB_LOCK;
+      txn = ovsdb_idl_txn_create(idl);
+
+      HMAP_FOR_EACH(cell, node, &batch->cells)
+      {
+         if(!mstp_dbCellWrite(cell))
+            cellsMissed++;
+      }
+
+      if(anyState)
+      {
+         /* the writer drops the cells it found no row for */
+         stateCells = mstp_util_set_port_state_vector(&batch->vec,
+                                                      batch->stateChg,
+                                                      &batch->blockChg);
+         for(mstid = 0; mstid <= MSTP_INSTANCES_MAX; mstid++)
+         {
+            bit_sub_port_maps(&batch->stateChg[mstid], &stateMissed[mstid]);
+            anyMissed |= are_any_ports_set(&stateMissed[mstid]);
+         }
+         bit_sub_port_maps(&batch->blockChg, &blockMissed);
+         anyMissed |= are_any_ports_set(&blockMissed);
+      }
+
+      if(are_any_ports_set(&batch->flushPorts))
+      {
+         flushedPorts = mstp_util_flush_mac_address_ports(&batch->flushPorts);
+         flushed = TRUE;
+      }
+
+      if(are_any_ports_set(&batch->statsChg))
+         mstp_util_write_bpdu_stats(&batch->statsChg, batch->stats);
+
+      /* switchd may apply the rows before the commit returns */
+      if(anyState)
+         traced = mstp_traceCommitPublish(batch->stateChg, &batch->vec,
+                                          traceStamped);
+
+      status = ovsdb_idl_txn_commit_block(txn);
+      ovsdb_idl_txn_destroy(txn);
+      MSTP_OVSDB_UNLOCK;
+      txnDone = TRUE;
+      committed = ((status == TXN_SUCCESS) || (status == TXN_UNCHANGED));
+      if(!committed)
+         VLOG_ERR("MSTP DB outbox transaction failed: %s",
+                  ovsdb_idl_txn_status_to_string(status));
+
+      if(traced)
+         mstp_traceCommitDone(traceStamped, &batch->vec);
+   }
+
+   /*------------------------------------------------------------------------
+    * a failed transaction wrote nothing, its port states are not accounted
+    * and are reported back to be written again
+    *------------------------------------------------------------------------*/
+   now = mstp_utilMonoUsec();
+
+   pthread_mutex_lock(&mstp_dbOutboxMutex);
+   if(anyState && committed)
+   {
+      mstp_dbOutboxStats.stateTxnCnt++;
+      mstp_dbOutboxStats.stateCellCnt += stateCells;
+      for(i = 0; i < batch->numDecisions; i++)
+      {
+         mstp_dbLatencyRecord((now > batch->decisionTime[i]) ?
+                              (now - batch->decisionTime[i]) : 0);
+      }
+   }
+   if(anyState)
+   {
+      mstp_dbResultAdd(batch, batch->stateChg, &batch->blockChg, committed);
+      if(anyMissed)
+      {
+         for(mstid = 0; mstid <= MSTP_INSTANCES_MAX; mstid++)
+         {
+            bit_or_port_maps(&stateMissed[mstid],
+                             &mstp_dbResult.stateMissed[mstid]);
+         }
+         bit_or_port_maps(&blockMissed, &mstp_dbResult.blockMissed);
+      }
+      __atomic_store_n(&mstp_dbResultPending, TRUE, __ATOMIC_RELEASE);
+   }
+   mstp_dbOutboxStats.applyCnt++;
+   if(txnDone)
+      mstp_dbOutboxStats.txnCnt++;
+   if(txnDone && !committed)
+      mstp_dbOutboxStats.txnFailedCnt++;
+   mstp_dbOutboxStats.missedCnt += cellsMissed;
+   if(flushed)
+   {
+      mstp_dbOutboxStats.flushTxnCnt++;
+      mstp_dbOutboxStats.flushPortCnt += flushedPorts;
+   }
+   if((now - start) > mstp_dbOutboxStats.applyMaxUsec)
+      mstp_dbOutboxStats.applyMaxUsec = now - start;
+   pthread_mutex_unlock(&mstp_dbOutboxMutex);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_dbOutboxRun
+ *
+ * Purpose:   OVSDB thread: apply the batches queued by the protocol thread,
+ *            oldest first. Called from the OVSDB thread main loop with
+ *            MSTP_OVSDB_LOCK not held.
+ *
+ * Params:    none
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_dbQueueHead, mstp_dbQueueTail, mstp_dbOutboxSeqSeen
+ **PROC-**********************************************************************/
+void
+mstp_dbOutboxRun(void)
+{
+   MSTP_DB_BATCH_t *head;
+   MSTP_DB_BATCH_t *batch;
+
+   mstp_dbOutboxSeqSeen = seq_read(mstp_dbOutboxSeq);
+
+   pthread_mutex_lock(&mstp_dbOutboxMutex);
+   head = mstp_dbQueueHead;
+   mstp_dbQueueHead = NULL;
+   mstp_dbQueueTail = NULL;
+   mstp_dbQueueLen = 0;
+   pthread_mutex_unlock(&mstp_dbOutboxMutex);
+
+   while(head)
+   {
+      batch = head;
+      head = batch->next;
+      mstp_dbBatchApply(batch);
+      mstp_dbBatchFree(batch);
+   }
+}
+
+void
+mstp_dbOutboxWait(void)
+{
+   seq_wait(mstp_dbOutboxSeq, mstp_dbOutboxSeqSeen);
+}
+
+void
+mstp_dbOutboxStatsGet(MSTP_DB_OUTBOX_STATS_t *stats, uint32_t *backlog)
+{
+   pthread_mutex_lock(&mstp_dbOutboxMutex);
+   *stats = mstp_dbOutboxStats;
+   *backlog = mstp_dbQueueLen;
+   pthread_mutex_unlock(&mstp_dbOutboxMutex);
+}
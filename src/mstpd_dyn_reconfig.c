@@ -49,7 +49,6 @@ VLOG_DEFINE_THIS_MODULE(mstpd_dyn_reconfig);
  *     Global Functions (externed)                                           *
  *                                                                           *
  ** ======================================================================= **/
-static void mstp_updatePortStateToForward();
 /**PROC+**********************************************************************
  * Name:      mstp_addLport
  *
@@ -108,9 +107,15 @@ mstp_addLport(LPORT_t lport)
     *       variable MSTP_DYN_RECONFIG_CHANGE can be set TRUE if the values
     *       read from config are different from the MSTP operational data
     *       (at the time of initialization it will be the case). To avoid
-    *       MSTP re-initialization we set MSTP_DYN_RECONFIG_CHANGE to FALSE
+    *       MSTP re-initialization we set MSTP_DYN_RECONFIG_CHANGE to FALSE.
+    *       For the same reason the port does not need a restart of its own
+    *       once its state machines are initialized below.
     *---------------------------------------------------------------------*/
    MSTP_DYN_RECONFIG_CHANGE = FALSE;
+   for(mstid = MSTP_CISTID; mstid <= MSTP_MSTID_MAX; mstid++)
+   {
+      clear_port(&mstp_Bridge.dynReconfigPorts[mstid], lport);
+   }
 
    /*------------------------------------------------------------------------
     * Initialize per-Port State Machines
@@ -279,8 +284,10 @@ mstp_adminStatusUpdate(int status)
        *       read from config are different from the MSTP operational data
        *       (at the time of initialization it will be the case). To avoid
        *       MSTP re-initialization we set MSTP_DYN_RECONFIG_CHANGE to FALSE
+       *       and forget the trees and ports marked for a restart.
        *---------------------------------------------------------------------*/
       MSTP_DYN_RECONFIG_CHANGE = FALSE;
+      mstp_dynReconfigClearScope();
 
       /*----------------------------------------------------------------------
        * clear portmaps used to keep track of lports MSTP has told DB are
@@ -326,7 +333,7 @@ mstp_adminStatusUpdate(int status)
       /*---------------------------------------------------------------------
        * Put the Ports back into the Forward State
        *--------------------------------------------------------------------*/
-      mstp_updatePortStateToForward();
+      mstp_dbOutboxPostJob(MSTP_DB_JOB_ALL_FORWARD, 0, NULL);
       /*----------------------------------------------------------------------
        * clear portmaps used to keep track of lports MSTP has told DB are
        * forwarding or blocked (used to escape message flooding when MSTP
@@ -344,63 +351,232 @@ mstp_adminStatusUpdate(int status)
       log_event("MSTP_DISABLED", NULL);
    }
 }
+
+/*---------------------------------------------------------------------------
+ * Bring the per-Port per-Tree SMs of 'lport' on 'mstid' to their initial
+ * states. The PRS SM of the tree is left running, it picks the port up when
+ * the port's PIM SM leaves the 'DISABLED' state afterwards.
+ *---------------------------------------------------------------------------*/
+static void
+mstp_dynReconfigBeginPort(MSTID_t mstid, LPORT_t lport)
+{
+   MSTP_BEGIN = TRUE;
+   mstp_pimSm(NULL, mstid, lport);
+   mstp_prtSm(mstid, lport);
+   mstp_pstSm(mstid, lport);
+   mstp_tcmSm(mstid, lport);
+   MSTP_BEGIN = FALSE;
+}
+
+/* TRUE if 'lport' is a port of 'mstid' */
+static bool
+mstp_dynReconfigIsTreePort(MSTID_t mstid, LPORT_t lport)
+{
+   if(!MSTP_COMM_PORT_PTR(lport))
+      return FALSE;
+
+   return (mstid == MSTP_CISTID) ? (MSTP_CIST_PORT_PTR(lport) != NULL) :
+                                   (MSTP_MSTI_PORT_PTR(mstid, lport) != NULL);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_dynReconfigRestartPort
+ *
+ * Purpose:   Re-initialize the data of a port on one tree from the current
+ *            configuration and restart the port's per-Port per-Tree state
+ *            machines, e.g. after a change of the Port Identifier Priority
+ *            or the Port Path Cost of the port on that tree.
+ *
+ * Params:    mstid -> the CIST or a valid MSTI
+ *            lport -> logical port number
+ *
+ * Returns:   TRUE if the port has been restarted
+ *
+ * Globals:   mstp_Bridge
+ *
+ * Constraints:
+ **PROC-**********************************************************************/
+static bool
+mstp_dynReconfigRestartPort(MSTID_t mstid, LPORT_t lport)
+{
+   if(!mstp_dynReconfigIsTreePort(mstid, lport))
+      return FALSE;
+
+   if(mstid == MSTP_CISTID)
+      mstp_initCistPortData(lport, FALSE);
+   else
+      mstp_initMstiPortData(mstid, lport, FALSE);
+
+   mstp_dynReconfigBeginPort(mstid, lport);
+
+   /*------------------------------------------------------------------------
+    * kick the port's PIM SM, it leaves the 'DISABLED' state if the port is
+    * enabled and the tree re-selects the port roles
+    *------------------------------------------------------------------------*/
+   mstp_pimSm(NULL, mstid, lport);
+
+   return TRUE;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_dynReconfigRestartTree
+ *
+ * Purpose:   Re-initialize the data of one tree from the current
+ *            configuration and restart all of its state machines, e.g.
+ *            after a change of the Bridge Identifier Priority of the tree.
+ *            The state machines are initialized in the same order as in
+ *            'mstp_initStateMachines'.
+ *
+ * Params:    mstid -> the CIST or a valid MSTI
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_Bridge
+ *
+ * Constraints:
+ **PROC-**********************************************************************/
+static void
+mstp_dynReconfigRestartTree(MSTID_t mstid)
+{
+   LPORT_t lport;
+
+   mstp_reinitTreeData(mstid);
+
+   MSTP_BEGIN = TRUE;
+   for(lport = 1; lport <= MAX_LPORTS; lport++)
+   {
+      if(mstp_dynReconfigIsTreePort(mstid, lport))
+         mstp_pimSm(NULL, mstid, lport);
+   }
+   mstp_prsSm(mstid);
+   for(lport = 1; lport <= MAX_LPORTS; lport++)
+   {
+      if(mstp_dynReconfigIsTreePort(mstid, lport))
+      {
+         mstp_prtSm(mstid, lport);
+         mstp_pstSm(mstid, lport);
+         mstp_tcmSm(mstid, lport);
+      }
+   }
+   MSTP_BEGIN = FALSE;
+
+   for(lport = 1; lport <= MAX_LPORTS; lport++)
+   {
+      if(mstp_dynReconfigIsTreePort(mstid, lport))
+         mstp_pimSm(NULL, mstid, lport);
+   }
+}
+
 /**PROC+**********************************************************************
- * Name:      mstp_updatePortStateToForward
+ * Name:      mstp_dynReconfigRestartScoped
  *
- * Purpose:   To put all the L2 Ports into Forwarding State.
+ * Purpose:   Apply the dynamic reconfiguration changes that do not require
+ *            MSTP re-initialization: restart the trees marked by
+ *            'mstp_setDynReconfigTreeFlag' and the ports marked by
+ *            'mstp_setDynReconfigPortFlag', the rest of the Bridge keeps
+ *            running undisturbed.
+ *            NOTE: a restart on the CIST is extended to the MSTIs (the
+ *                  whole Bridge or the same port), as the MSTI port roles
+ *                  on boundary ports follow the CIST port roles
+ *                  (802.1Q-REV/D5.0 13.26.24).
  *
  * Params:    none
  *
  * Returns:   none
  *
- * Globals:   none
+ * Globals:   mstp_Bridge, mstp_CB
  *
  * Constraints:
  **PROC-**********************************************************************/
-void mstp_updatePortStateToForward()
+void
+mstp_dynReconfigRestartScoped(void)
 {
-    struct ovsdb_idl_txn *txn = NULL;
-    const struct ovsrec_bridge *bridge_row = NULL;
-    const struct ovsrec_mstp_common_instance_port *cist_port_row = NULL;
-    const struct ovsrec_mstp_instance *mstp_row = NULL;
-    const struct ovsrec_mstp_instance_port *mstp_port_row = NULL;
-    int mstid = 0, port_id = 0;
-    bridge_row = ovsrec_bridge_first(idl);
-    MSTP_OVSDB_LOCK;
-    txn = ovsdb_idl_txn_create(idl);
-    OVSREC_MSTP_COMMON_INSTANCE_PORT_FOR_EACH(cist_port_row, idl)
-    {
-        ovsrec_mstp_common_instance_port_set_port_state(cist_port_row,MSTP_STATE_FORWARD);
-    }
-    for (mstid=0; mstid < bridge_row->n_mstp_instances; mstid++) {
-        mstp_row = bridge_row->value_mstp_instances[mstid];
-        if(!mstp_row) {
-            assert(0);
-            ovsdb_idl_txn_destroy(txn);
-            MSTP_OVSDB_UNLOCK;
-
-            return;
-        }
+   MSTID_t  mstid;
+   LPORT_t  lport;
+   PORT_MAP *pmap;
+   uint64_t start;
+   uint64_t usec;
 
-        /* MSTP instance port clean */
-        for (port_id=0; port_id < mstp_row->n_mstp_instance_ports; port_id++) {
-            mstp_port_row = mstp_row->mstp_instance_ports[port_id];
-            if(!mstp_port_row) {
-                assert(0);
-                ovsdb_idl_txn_destroy(txn);
-                MSTP_OVSDB_UNLOCK;
-                return;
-            }
-            ovsrec_mstp_instance_port_set_port_state( mstp_port_row, MSTP_STATE_FORWARD);
-        }
-    }
-    ovsdb_idl_txn_commit_block(txn);
-    ovsdb_idl_txn_destroy(txn);
-    MSTP_OVSDB_UNLOCK;
-    return;
+   if(!MSTP_DYN_RECONFIG_SCOPED)
+      return;
+
+   start = mstp_utilMonoUsec();
+   MSTP_DYN_CFG_PRINTF("!DYN RECONFIG: %s", "scoped start");
+
+   if(mstp_Bridge.dynReconfigTree[MSTP_CISTID])
+   {
+      for(mstid = MSTP_MSTID_MIN; mstid <= MSTP_MSTID_MAX; mstid++)
+         mstp_Bridge.dynReconfigTree[mstid] = TRUE;
+   }
+   pmap = &mstp_Bridge.dynReconfigPorts[MSTP_CISTID];
+   for(lport = find_first_port_set(pmap); IS_VALID_LPORT(lport);
+       lport = find_next_port_set(pmap, lport))
+   {
+      for(mstid = MSTP_MSTID_MIN; mstid <= MSTP_MSTID_MAX; mstid++)
+         set_port(&mstp_Bridge.dynReconfigPorts[mstid], lport);
+   }
+
+   mstp_preventTxOnBridge();
+   for(mstid = MSTP_CISTID; mstid <= MSTP_MSTID_MAX; mstid++)
+   {
+      if(!MSTP_INSTANCE_IS_VALID(mstid))
+         continue;
+
+      if(mstp_Bridge.dynReconfigTree[mstid])
+      {/* the tree restart covers its ports */
+         mstp_dynReconfigRestartTree(mstid);
+         mstp_CB.dynReconfigTreeCnt++;
+         continue;
+      }
+
+      pmap = &mstp_Bridge.dynReconfigPorts[mstid];
+      for(lport = find_first_port_set(pmap); IS_VALID_LPORT(lport);
+          lport = find_next_port_set(pmap, lport))
+      {
+         if(mstp_dynReconfigRestartPort(mstid, lport))
+            mstp_CB.dynReconfigPortCnt++;
+      }
+   }
+   mstp_doPendingTxOnBridge();
+
+   mstp_dynReconfigClearScope();
+
+   usec = mstp_utilMonoUsec() - start;
+   mstp_CB.dynReconfigLastUsec = usec;
+   if(usec > mstp_CB.dynReconfigMaxUsec)
+      mstp_CB.dynReconfigMaxUsec = usec;
+
+   MSTP_DYN_CFG_PRINTF("!DYN RECONFIG: %s", "scoped end");
 }
 
+/**PROC+**********************************************************************
+ * Name:      mstp_dynReconfigClearScope
+ *
+ * Purpose:   Forget the trees and ports marked for a restart
+ *
+ * Params:    none
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_Bridge
+ *
+ * Constraints:
+ **PROC-**********************************************************************/
+void
+mstp_dynReconfigClearScope(void)
+{
+   MSTID_t mstid;
+
+   if(!MSTP_DYN_RECONFIG_SCOPED)
+      return;
 
+   for(mstid = MSTP_CISTID; mstid <= MSTP_MSTID_MAX; mstid++)
+   {
+      mstp_Bridge.dynReconfigTree[mstid] = FALSE;
+      clear_port_map(&mstp_Bridge.dynReconfigPorts[mstid]);
+   }
+   MSTP_DYN_RECONFIG_SCOPED = FALSE;
+}
 /**PROC+**********************************************************************
  * Name:      mstp_updateMstiVidMapping
  *
@@ -487,6 +663,7 @@ mstp_updateMstiVidMapping(MSTID_t mstid, VID_MAP newVidMap)
        * Store new MSTI's VID mapping data in the global 'mstp_MstiVidTable'
        *---------------------------------------------------------------------*/
       copy_vid_map(&newVidMap, curVidMap);
+      mstp_mstiVidTableChg();
 
       /*---------------------------------------------------------------------
        * Indicate that MSTI's VID mapping has changed
@@ -305,6 +305,34 @@ mstp_initStateMachines(void)
    MSTP_MISC_PRINTF("!!!SMs initialization %s", "end");
 }
 
+/**PROC+**********************************************************************
+ * Name:      mstp_reinitTreeData
+ *
+ * Purpose:   Re-initialize the Bridge and the Port data of one tree from
+ *            the current configuration, leaving the other trees as they
+ *            are. Called before the state machines of the tree are
+ *            restarted for a dynamic reconfiguration change that affects
+ *            this tree only.
+ *
+ * Params:    mstid -> the CIST or a valid MSTI
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_Bridge
+ *
+ * Constraints:
+ **PROC-**********************************************************************/
+void
+mstp_reinitTreeData(MSTID_t mstid)
+{
+   STP_ASSERT(MSTP_INSTANCE_IS_VALID(mstid));
+
+   if(mstid == MSTP_CISTID)
+      mstp_initBridgeCistData(FALSE);
+   else
+      mstp_initBridgeMstiData(mstid, FALSE);
+}
+
 /**PROC+**********************************************************************
  * Name:      mstp_initProtocolData
  *
@@ -412,7 +440,7 @@ mstp_initMstiPortData(MSTID_t mstid, LPORT_t lport, bool init)
     /*------------------------------------------------------------------------
     * Initializing Port Uptime
     *------------------------------------------------------------------------*/
-   mstiPortPtr->mstiPort_uptime = time(NULL);
+   mstiPortPtr->cold->mstiPort_uptime = time(NULL);
 
    /*------------------------------------------------------------------------
     * Per-Port State Machines states (802.1Q-REV/D5.0 13.19)
@@ -429,15 +457,15 @@ mstp_initMstiPortData(MSTID_t mstid, LPORT_t lport, bool init)
       /*---------------------------------------------------------------------
        * Clear statistics MIB support (RFC1493 MIB)
        *---------------------------------------------------------------------*/
-      mstiPortPtr->forwardTransitions = 0;
+      mstiPortPtr->cold->forwardTransitions = 0;
 
       /*---------------------------------------------------------------------
        * Clear counters used for debugging/troubleshooting purposes
        *---------------------------------------------------------------------*/
-      memset(&mstiPortPtr->dbgCnts, 0, sizeof(mstiPortPtr->dbgCnts));
+      memset(&mstiPortPtr->cold->dbgCnts, 0, sizeof(mstiPortPtr->cold->dbgCnts));
 
       /* Clear the history table */
-      memset(&mstiPortPtr->portHistory, 0, sizeof(mstiPortPtr->portHistory));
+      memset(&mstiPortPtr->cold->portHistory, 0, sizeof(mstiPortPtr->cold->portHistory));
    }
 
    return mstiPortPtr;
@@ -511,7 +539,7 @@ mstp_initCistPortData(LPORT_t lport, bool init)
     /*------------------------------------------------------------------------
     * Initializing Port Uptime
     *------------------------------------------------------------------------*/
-   cistPortPtr->cistPort_uptime = time(NULL);
+   cistPortPtr->cold->cistPort_uptime = time(NULL);
 
    /*------------------------------------------------------------------------
     * Per-Port State Machines states (802.1Q-REV/D5.0 13.19)
@@ -528,13 +556,13 @@ mstp_initCistPortData(LPORT_t lport, bool init)
       /*---------------------------------------------------------------------
        * Clear statistics MIB support (RFC1493 MIB)
        *---------------------------------------------------------------------*/
-      cistPortPtr->forwardTransitions = 0;
+      cistPortPtr->cold->forwardTransitions = 0;
 
       /*---------------------------------------------------------------------
        * Clear counters used for debugging/troubleshooting purposes
        *---------------------------------------------------------------------*/
-      memset(&cistPortPtr->dbgCnts, 0, sizeof(cistPortPtr->dbgCnts));
-      memset(&cistPortPtr->portHistory, 0, sizeof(cistPortPtr->portHistory));
+      memset(&cistPortPtr->cold->dbgCnts, 0, sizeof(cistPortPtr->cold->dbgCnts));
+      memset(&cistPortPtr->cold->portHistory, 0, sizeof(cistPortPtr->cold->portHistory));
    }
 
    return cistPortPtr;
@@ -676,6 +704,7 @@ mstp_clearBridgeCistData() {
        * Clear CIST's VLAN IDs mapping data in the global 'mstp_MstiVidTable'
        *---------------------------------------------------------------------*/
       clear_vid_map(&mstp_MstiVidTable[MSTP_CISTID]);
+      mstp_mstiVidTableChg();
 
       /*---------------------------------------------------------------------
        * Clear the CIST data
@@ -715,6 +744,7 @@ mstp_clearBridgeMstiData(MSTID_t mstid) {
      * Clear MSTI's VIDs mapping data in the global 'mstp_MstiVidTable'
      *---------------------------------------------------------------------*/
     clear_vid_map(&mstp_MstiVidTable[mstid]);
+    mstp_mstiVidTableChg();
     /*---------------------------------------------------------------------
      * Decrement global counter of valid trees
      *---------------------------------------------------------------------*/
@@ -727,9 +757,9 @@ mstp_clearBridgeMstiData(MSTID_t mstid) {
     m = mstp_findMstiPortStateChgMsg(mstid);
     if(m != NULL)
     {
-        remqhere_nodis(&MSTP_TREE_MSGS_QUEUE, &m->link);
-        free(m);
+        mstp_releaseMstiPortStateChgMsg(m);
     }
+    mstp_invalidateDBPortState(mstid, 0);
 
     /*---------------------------------------------------------------------
      * Free memory space allocated for the MSTI
@@ -792,7 +822,7 @@ mstp_clearMstiPortData(MSTID_t mstid, LPORT_t lport)
    STP_ASSERT(MSTP_COMM_PORT_PTR(lport));
    STP_ASSERT(MSTP_MSTI_PORT_PTR(mstid, lport));
 
-   free(MSTP_MSTI_PORT_PTR(mstid, lport));
+   mstp_portArenaFree(mstid, lport);
    MSTP_MSTI_PORT_PTR(mstid, lport) = NULL;
 
 }
@@ -821,7 +851,7 @@ mstp_clearCistPortData(LPORT_t lport)
    STP_ASSERT(MSTP_COMM_PORT_PTR(lport));
    STP_ASSERT(MSTP_CIST_PORT_PTR(lport));
 
-   free(MSTP_CIST_PORT_PTR(lport));
+   mstp_portArenaFree(MSTP_CISTID, lport);
    MSTP_CIST_PORT_PTR(lport) = NULL;
 }
 
@@ -847,7 +877,7 @@ mstp_clearCommonPortData(LPORT_t lport)
 
    MSTP_COMM_CLR_BPDU_FILTER(lport);
 
-   free(MSTP_COMM_PORT_PTR(lport));
+   mstp_portArenaCommFree(MSTP_COMM_PORT_PTR(lport));
    MSTP_COMM_PORT_PTR(lport) = NULL;
 
 }
@@ -869,9 +899,13 @@ mstp_clearMstpToOthersMessageQueue(void)
 
    while(qempty(&MSTP_TREE_MSGS_QUEUE) == FALSE)
    {
-      m = (MSTP_TREE_MSG_t *) remqhi(&MSTP_TREE_MSGS_QUEUE);
-      free(m);
+      m = (MSTP_TREE_MSG_t *) qfirst_nodis(&MSTP_TREE_MSGS_QUEUE);
+      mstp_releaseMstiPortStateChgMsg(m);
    }
+   /*------------------------------------------------------------------------
+    * the protocol restarts from scratch, write every state it reports
+    *------------------------------------------------------------------------*/
+   mstp_invalidateDBPortState(MSTP_NON_STP_BRIDGE, 0);
 }
 /**PROC+**********************************************************************
  * Name:      mstp_updateMstpCBPortMaps
@@ -1528,4 +1562,5 @@ mstp_initControlData(void)
    memset(mstp_MstiVidTable, 0x00, sizeof(mstp_MstiVidTable));
    /* Map all VIDs to the CIST */
    MSTP_ADD_ALL_VIDS_TO_VIDMAP(&mstp_MstiVidTable[MSTP_CISTID]);
+   mstp_mstiVidTableChg();
 }
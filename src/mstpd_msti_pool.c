@@ -0,0 +1,303 @@
+/*
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+/**********************************************************************************
+ *    File               : mstpd_msti_pool.c
+ *    Description        : MSTI worker pool. When the protocol thread is about
+ *                         to run role selection on many MSTIs back to back,
+ *                         the Root Priority Vector election of each of them
+ *                         ('mstp_mstiRootElect') is run ahead, in parallel,
+ *                         into the MSTI's own result slot. The protocol
+ *                         thread then runs role selection and the state
+ *                         machines of the MSTIs one after the other in
+ *                         MSTID order as before, each taking its election
+ *                         from the slot, so the outcome is the same as with
+ *                         the pool off. Everything past the election writes
+ *                         per-port state shared by all the trees and stays
+ *                         on the protocol thread.
+ **********************************************************************************/
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <util.h>
+#include <vswitch-idl.h>
+#include <openvswitch/vlog.h>
+#include "mstp_fsm.h"
+
+VLOG_DEFINE_THIS_MODULE(mstpd_msti_pool);
+
+typedef struct mstp_msti_pool
+{
+   pthread_mutex_t  lock;
+   pthread_cond_t   workCond;            /* a job was posted or the number
+                                          * of workers changed           */
+   pthread_cond_t   doneCond;            /* a worker left a job          */
+   pthread_t        threads[MSTP_MSTI_WORKERS_MAX];
+   uint32_t         running;             /* protocol thread: started     */
+   uint32_t         keep;                /* workers with an id below this
+                                          * keep running                 */
+   /* current job, changed under 'lock' while no worker is in it */
+   uint64_t         gen;
+   const MSTID_t   *mstids;
+   int              count;
+   int              next;                /* atomic: next index to take   */
+   int              done;                /* MSTIs elected                */
+   int              active;              /* workers inside the job       */
+   uint64_t         workerElectCnt;
+
+} MSTP_MSTI_POOL_t;
+
+static MSTP_MSTI_POOL_t mstp_mstiPool =
+{
+   .lock = PTHREAD_MUTEX_INITIALIZER,
+   .workCond = PTHREAD_COND_INITIALIZER,
+   .doneCond = PTHREAD_COND_INITIALIZER,
+};
+
+/* set from unixctl, applied by the protocol thread at its next run */
+static uint32_t mstp_mstiPoolWorkers = MSTP_MSTI_WORKERS_DEF;
+
+/* protocol thread, except for the copy taken by 'mstp_mstiPoolStatsGet' */
+static MSTP_MSTI_POOL_STATS_t mstp_mstiPoolStats;
+
+/* Elect the MSTIs of the current job until none is left; returns how many */
+static int
+mstp_mstiPoolTake(const MSTID_t *mstids, int count)
+{
+   MSTID_t mstid;
+   int     i;
+   int     n = 0;
+
+   while((i = __atomic_fetch_add(&mstp_mstiPool.next, 1,
+                                 __ATOMIC_RELAXED)) < count)
+   {
+      mstid = mstids[i];
+      mstp_mstiRootElect(mstid, &MSTP_MSTI_INFO(mstid)->elect);
+      n++;
+   }
+   return n;
+}
+
+static void *
+mstp_mstiPoolWorker(void *arg)
+{
+   uint32_t       id = (uint32_t)(uintptr_t)arg;
+   uint64_t       seen = 0;
+   const MSTID_t *mstids;
+   int            count;
+   int            n;
+
+   pthread_mutex_lock(&mstp_mstiPool.lock);
+   seen = mstp_mstiPool.gen;
+   for(;;)
+   {
+      while((id < mstp_mstiPool.keep) && (mstp_mstiPool.gen == seen))
+         pthread_cond_wait(&mstp_mstiPool.workCond, &mstp_mstiPool.lock);
+      if(id >= mstp_mstiPool.keep)
+         break;
+
+      seen = mstp_mstiPool.gen;
+      mstids = mstp_mstiPool.mstids;
+      count = mstp_mstiPool.count;
+      mstp_mstiPool.active++;
+      pthread_mutex_unlock(&mstp_mstiPool.lock);
+
+      n = mstp_mstiPoolTake(mstids, count);
+
+      pthread_mutex_lock(&mstp_mstiPool.lock);
+      mstp_mstiPool.done += n;
+      mstp_mstiPool.workerElectCnt += n;
+      mstp_mstiPool.active--;
+      pthread_cond_signal(&mstp_mstiPool.doneCond);
+   }
+   pthread_mutex_unlock(&mstp_mstiPool.lock);
+
+   return NULL;
+}
+
+/* Protocol thread: start or stop workers to match 'mstp_mstiPoolWorkers' */
+static void
+mstp_mstiPoolResize(void)
+{
+   uint32_t want = __atomic_load_n(&mstp_mstiPoolWorkers, __ATOMIC_RELAXED);
+   uint32_t id;
+   int      rc;
+
+   if(want == mstp_mstiPool.running)
+      return;
+
+   if(want < mstp_mstiPool.running)
+   {
+      pthread_mutex_lock(&mstp_mstiPool.lock);
+      mstp_mstiPool.keep = want;
+      pthread_cond_broadcast(&mstp_mstiPool.workCond);
+      pthread_mutex_unlock(&mstp_mstiPool.lock);
+      for(id = want; id < mstp_mstiPool.running; id++)
+         pthread_join(mstp_mstiPool.threads[id], NULL);
+      mstp_mstiPool.running = want;
+      return;
+   }
+
+   pthread_mutex_lock(&mstp_mstiPool.lock);
+   mstp_mstiPool.keep = want;
+   pthread_mutex_unlock(&mstp_mstiPool.lock);
+   for(id = mstp_mstiPool.running; id < want; id++)
+   {
+      rc = pthread_create(&mstp_mstiPool.threads[id], NULL,
+                          mstp_mstiPoolWorker, (void *)(uintptr_t)id);
+      if(rc != 0)
+      {
+         VLOG_ERR("%s: cannot start MSTI worker %u: %s", __FUNCTION__, id,
+                  strerror(rc));
+         pthread_mutex_lock(&mstp_mstiPool.lock);
+         mstp_mstiPool.keep = id;
+         pthread_mutex_unlock(&mstp_mstiPool.lock);
+         break;
+      }
+   }
+   mstp_mstiPool.running = id;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_mstiPoolSetWorkers
+ *
+ * Purpose:   Set the number of MSTI worker threads. The protocol thread
+ *            starts or stops them before its next parallel election.
+ *
+ * Params:    workers -> number of threads, 0 turns the pool off
+ *
+ * Returns:   FALSE if out of range
+ *
+ * Globals:   mstp_mstiPoolWorkers
+ **PROC-**********************************************************************/
+bool
+mstp_mstiPoolSetWorkers(uint32_t workers)
+{
+   if(workers > MSTP_MSTI_WORKERS_MAX)
+      return FALSE;
+
+   __atomic_store_n(&mstp_mstiPoolWorkers, workers, __ATOMIC_RELAXED);
+   return TRUE;
+}
+
+void
+mstp_mstiPoolStatsGet(MSTP_MSTI_POOL_STATS_t *stats, bool reset)
+{
+   pthread_mutex_lock(&mstp_mstiPool.lock);
+   *stats = mstp_mstiPoolStats;
+   stats->workers = __atomic_load_n(&mstp_mstiPoolWorkers, __ATOMIC_RELAXED);
+   stats->running = mstp_mstiPool.keep;
+   if(reset)
+   {
+      memset(&mstp_mstiPoolStats, 0, sizeof(mstp_mstiPoolStats));
+      mstp_mstiPool.workerElectCnt = 0;
+   }
+   pthread_mutex_unlock(&mstp_mstiPool.lock);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_mstiPoolElect
+ *
+ * Purpose:   Protocol thread: run the Root Priority Vector election of the
+ *            given MSTIs on the worker pool, the protocol thread taking its
+ *            share, and mark the results valid for the next
+ *            'mstp_updtRolesMsti' of each MSTI. Does nothing if the pool is
+ *            off or there is only one MSTI; 'mstp_updtRolesMsti' then runs
+ *            the election itself.
+ *            NOTE: the caller must not change the election inputs of an
+ *                  MSTI in the list (its port priority vectors and the
+ *                  port enabled/restricted role flags) before that MSTI's
+ *                  role selection, and must call 'mstp_mstiPoolElectDone'
+ *                  with the same list afterwards.
+ *
+ * Params:    mstids -> MSTIs, in the order their role selection will run
+ *            count  -> number of entries in 'mstids'
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_mstiPool, mstp_mstiPoolStats
+ **PROC-**********************************************************************/
+void
+mstp_mstiPoolElect(const MSTID_t *mstids, int count)
+{
+   uint64_t start;
+   uint64_t usec;
+   int      n;
+   int      i;
+
+   mstp_mstiPoolResize();
+   if((mstp_mstiPool.running == 0) || (count < 2))
+      return;
+
+   start = mstp_utilMonoUsec();
+
+   pthread_mutex_lock(&mstp_mstiPool.lock);
+   /* a worker may still be on its way out of the previous job */
+   while(mstp_mstiPool.active > 0)
+      pthread_cond_wait(&mstp_mstiPool.doneCond, &mstp_mstiPool.lock);
+   mstp_mstiPool.mstids = mstids;
+   mstp_mstiPool.count = count;
+   mstp_mstiPool.done = 0;
+   __atomic_store_n(&mstp_mstiPool.next, 0, __ATOMIC_RELAXED);
+   mstp_mstiPool.gen++;
+   pthread_cond_broadcast(&mstp_mstiPool.workCond);
+   pthread_mutex_unlock(&mstp_mstiPool.lock);
+
+   n = mstp_mstiPoolTake(mstids, count);
+
+   pthread_mutex_lock(&mstp_mstiPool.lock);
+   mstp_mstiPool.done += n;
+   while(mstp_mstiPool.done < count)
+      pthread_cond_wait(&mstp_mstiPool.doneCond, &mstp_mstiPool.lock);
+
+   usec = mstp_utilMonoUsec() - start;
+   mstp_mstiPoolStats.runCnt++;
+   mstp_mstiPoolStats.electCnt += count;
+   mstp_mstiPoolStats.workerElectCnt = mstp_mstiPool.workerElectCnt;
+   mstp_mstiPoolStats.lastUsec = usec;
+   mstp_mstiPoolStats.totalUsec += usec;
+   if(usec > mstp_mstiPoolStats.maxUsec)
+      mstp_mstiPoolStats.maxUsec = usec;
+   pthread_mutex_unlock(&mstp_mstiPool.lock);
+
+   for(i = 0; i < count; i++)
+      MSTP_MSTI_INFO(mstids[i])->electValid = TRUE;
+}
+
+/* Protocol thread: account a boundary port sync of all the MSTIs, the
+ * election and the role selection that follows it */
+void
+mstp_mstiPoolSyncRecord(uint64_t usec)
+{
+   pthread_mutex_lock(&mstp_mstiPool.lock);
+   mstp_mstiPoolStats.syncCnt++;
+   mstp_mstiPoolStats.syncLastUsec = usec;
+   mstp_mstiPoolStats.syncTotalUsec += usec;
+   if(usec > mstp_mstiPoolStats.syncMaxUsec)
+      mstp_mstiPoolStats.syncMaxUsec = usec;
+   pthread_mutex_unlock(&mstp_mstiPool.lock);
+}
+
+/* Protocol thread: drop the results role selection did not take */
+void
+mstp_mstiPoolElectDone(const MSTID_t *mstids, int count)
+{
+   int i;
+
+   for(i = 0; i < count; i++)
+      MSTP_MSTI_INFO(mstids[i])->electValid = FALSE;
+}
@@ -29,6 +29,8 @@
 #include <string.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <inttypes.h>
+#include <time.h>
 
 #include <config.h>
 #include <command-line.h>
@@ -64,11 +66,31 @@ VLOG_DEFINE_THIS_MODULE(mstpd_ovsdb_if);
  * interface threads calls to update OVSDB states. */
 pthread_mutex_t ovsdb_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/* ovsdb_mutex use per thread role, only updated with the mutex held; the
+ * times only while the lock profiler is enabled */
+static MSTP_OVSDB_LOCK_STATS_t mstp_ovsdb_lock_stats[MSTP_THREAD_MAX];
+static __thread MSTP_THREAD_ROLE_t mstp_thread_role = MSTP_THREAD_OTHER;
+static __thread uint64_t mstp_ovsdb_lock_taken_ns;
+
+/* Lock profiler: registered call sites, linked in with the mutex held */
+static bool mstp_lock_prof_enabled = false;
+static MSTP_LOCK_SITE_t *mstp_lock_sites = NULL;
+static __thread MSTP_LOCK_SITE_t *mstp_lock_site_held;
+
+/* NOTE: this array is indexed by the values defined
+ *       in 'MSTP_THREAD_ROLE_t' enum list */
+static const char *const mstp_thread_role_s[MSTP_THREAD_MAX] =
+{
+    "other",
+    "ovsdb",
+    "protocol",
+    "rx"
+};
+
 /* Scale OVS interface speed number (bps) down to
  *  * that used by MSTP state machine (Mbps). */
 #define MEGA_BITS_PER_SEC  1000000
 #define INTF_TO_MSTP_LINK_SPEED(s)    ((s)/MEGA_BITS_PER_SEC)
-#define VERIFY_LAG_IFNAME(s) strncasecmp(s, "lag", 3)
 
 /* NOTE: These  MSTP LAG IDs are only used for MSTP  state machine.
  *       They are not necessarily the same as h/w LAG ID. */
@@ -88,10 +110,9 @@ struct mstp_cist_data *cist_data;
 VID_MAP cist_vlan_list;
 static int n_cist_vlans = 0;
 bool init_required = true;
-void util_add_default_ports_to_cist();
-void util_add_default_ports_to_mist();
-void util_mstp_set_defaults();
 void util_mstp_init_config();
+static void send_lport_info_msg(struct iface_data *idp,
+                                const struct ovsrec_port *prow);
 
 struct mstp_global_config mstp_global_conf;
 struct mstp_cist_config mstp_cist_conf;
@@ -112,6 +133,9 @@ static struct shash all_interfaces = SHASH_INITIALIZER(&all_interfaces);
 /* Mapping of all the VLANs. */
 static struct shash all_vlans = SHASH_INITIALIZER(&all_vlans);
 
+/* BPDU statistics export interval (seconds), set through unixctl */
+static uint32_t mstp_stats_interval = MSTP_STATS_EXPORT_INTERVAL_DEF;
+
 /*************************************************************************//**
  * @ingroup mstpd_ovsdb_if
  *  * @brief mstpd's internal data structure to store per port data.
@@ -207,6 +231,208 @@ static msti_port_table_string msti_port_string[] = { {PORT_ROLE, ovsrec_mstp_ins
                                              };
 
 
+static uint64_t
+mstp_ovsdb_lock_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int
+mstp_lock_hist_bucket(uint64_t ns)
+{
+    int bucket = ns ? 64 - __builtin_clzll(ns) : 0;
+
+    return MIN(bucket, MSTP_LOCK_HIST_BUCKETS - 1);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_ovsdbLock / mstp_ovsdbUnlock
+ *
+ * Purpose:   Take and release ovsdb_mutex (MSTP_OVSDB_LOCK/UNLOCK),
+ *            counting the acquisitions of the calling thread's role. The
+ *            wait and hold times are only taken, and accounted to the role
+ *            and to the call site, while the lock profiler is enabled.
+ *
+ * Params:    site -> MSTP_OVSDB_LOCK call site
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_ovsdb_lock_stats, mstp_lock_sites
+ **PROC-**********************************************************************/
+void
+mstp_ovsdbLock(MSTP_LOCK_SITE_t *site)
+{
+    MSTP_OVSDB_LOCK_STATS_t *stats;
+    uint64_t start;
+    uint64_t wait;
+
+    if (!__atomic_load_n(&mstp_lock_prof_enabled, __ATOMIC_RELAXED)) {
+        pthread_mutex_lock(&ovsdb_mutex);
+        mstp_ovsdb_lock_stats[mstp_thread_role].acquireCnt++;
+        mstp_lock_site_held = NULL;
+        return;
+    }
+
+    start = mstp_ovsdb_lock_now_ns();
+    pthread_mutex_lock(&ovsdb_mutex);
+    mstp_ovsdb_lock_taken_ns = mstp_ovsdb_lock_now_ns();
+    wait = mstp_ovsdb_lock_taken_ns - start;
+
+    stats = &mstp_ovsdb_lock_stats[mstp_thread_role];
+    stats->acquireCnt++;
+    stats->timedCnt++;
+    stats->waitNsTotal += wait;
+    if (wait > stats->waitNsMax) {
+        stats->waitNsMax = wait;
+    }
+
+    if (!site->registered) {
+        site->next = mstp_lock_sites;
+        mstp_lock_sites = site;
+        site->registered = true;
+    }
+    site->acquireCnt++;
+    site->waitNsTotal += wait;
+    if (wait > site->waitNsMax) {
+        site->waitNsMax = wait;
+    }
+    site->waitHist[mstp_lock_hist_bucket(wait)]++;
+    mstp_lock_site_held = site;
+}
+
+void
+mstp_ovsdbUnlock(void)
+{
+    MSTP_OVSDB_LOCK_STATS_t *stats = &mstp_ovsdb_lock_stats[mstp_thread_role];
+    MSTP_LOCK_SITE_t *site = mstp_lock_site_held;
+    uint64_t hold;
+
+    /* not timed when taken, the profiler was disabled */
+    if (!site) {
+        pthread_mutex_unlock(&ovsdb_mutex);
+        return;
+    }
+
+    hold = mstp_ovsdb_lock_now_ns() - mstp_ovsdb_lock_taken_ns;
+    stats->holdNsTotal += hold;
+    if (hold > stats->holdNsMax) {
+        stats->holdNsMax = hold;
+    }
+    site->holdNsTotal += hold;
+    if (hold > site->holdNsMax) {
+        site->holdNsMax = hold;
+    }
+    site->holdHist[mstp_lock_hist_bucket(hold)]++;
+    mstp_lock_site_held = NULL;
+    pthread_mutex_unlock(&ovsdb_mutex);
+}
+
+void
+mstp_lockProfSetEnabled(bool enable)
+{
+    __atomic_store_n(&mstp_lock_prof_enabled, enable, __ATOMIC_RELAXED);
+}
+
+bool
+mstp_lockProfIsEnabled(void)
+{
+    return __atomic_load_n(&mstp_lock_prof_enabled, __ATOMIC_RELAXED);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_lockProfGet
+ *
+ * Purpose:   Copy the counters of the call sites seen by the lock profiler,
+ *            optionally resetting them.
+ *
+ * Params:    sites -> set to an array of copies, to be freed by the caller
+ *            reset -> clear the counters after the copy
+ *
+ * Returns:   number of entries in 'sites'
+ *
+ * Globals:   mstp_lock_sites
+ **PROC-**********************************************************************/
+int
+mstp_lockProfGet(MSTP_LOCK_SITE_t **sites, bool reset)
+{
+    MSTP_LOCK_SITE_t *site;
+    int n = 0;
+
+    pthread_mutex_lock(&ovsdb_mutex);
+    for (site = mstp_lock_sites; site; site = site->next) {
+        n++;
+    }
+    *sites = xcalloc(MAX(n, 1), sizeof(MSTP_LOCK_SITE_t));
+    n = 0;
+    for (site = mstp_lock_sites; site; site = site->next) {
+        (*sites)[n] = *site;
+        (*sites)[n].next = NULL;
+        n++;
+        if (reset) {
+            site->acquireCnt = 0;
+            site->waitNsTotal = 0;
+            site->waitNsMax = 0;
+            site->holdNsTotal = 0;
+            site->holdNsMax = 0;
+            memset(site->waitHist, 0, sizeof(site->waitHist));
+            memset(site->holdHist, 0, sizeof(site->holdHist));
+        }
+    }
+    pthread_mutex_unlock(&ovsdb_mutex);
+    return n;
+}
+
+/* Tag the calling thread for the ovsdb_mutex accounting. */
+void
+mstp_setThreadRole(MSTP_THREAD_ROLE_t role)
+{
+    if (role < MSTP_THREAD_MAX) {
+        mstp_thread_role = role;
+    }
+}
+
+MSTP_THREAD_ROLE_t
+mstp_getThreadRole(void)
+{
+    return mstp_thread_role;
+}
+
+const char *
+mstp_threadRoleName(MSTP_THREAD_ROLE_t role)
+{
+    return (role < MSTP_THREAD_MAX) ? mstp_thread_role_s[role] :
+                                      mstp_thread_role_s[MSTP_THREAD_OTHER];
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_ovsdbLockStatsGet
+ *
+ * Purpose:   Copy the ovsdb_mutex accounting, optionally resetting it.
+ *            The mutex is taken directly so that reading the report does
+ *            not show up in it.
+ *
+ * Params:    stats -> filled in, indexed by MSTP_THREAD_ROLE_t
+ *            reset -> clear the counters after the copy
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_ovsdb_lock_stats
+ **PROC-**********************************************************************/
+void
+mstp_ovsdbLockStatsGet(MSTP_OVSDB_LOCK_STATS_t stats[MSTP_THREAD_MAX],
+                       bool reset)
+{
+    pthread_mutex_lock(&ovsdb_mutex);
+    memcpy(stats, mstp_ovsdb_lock_stats, sizeof(mstp_ovsdb_lock_stats));
+    if (reset) {
+        memset(mstp_ovsdb_lock_stats, 0, sizeof(mstp_ovsdb_lock_stats));
+    }
+    pthread_mutex_unlock(&ovsdb_mutex);
+}
+
 /**********************************************************************
  * Pool implementation: this is diferrent from the LAG pool manager.
  * This is currently only used for allocating interface indexes.
@@ -493,6 +719,7 @@ mstpd_ovsdb_init(const char *db_path)
     ovsdb_idl_add_column(idl, &ovsrec_port_col_vlan_mode);
     ovsdb_idl_add_column(idl, &ovsrec_port_col_admin);
     ovsdb_idl_add_column(idl, &ovsrec_port_col_hw_config);
+    ovsdb_idl_add_column(idl, &ovsrec_port_col_other_config);
     ovsdb_idl_add_column(idl, &ovsrec_port_col_lacp_status);
     ovsdb_idl_add_column(idl, &ovsrec_port_col_bond_status);
     ovsdb_idl_add_column(idl, &ovsrec_port_col_interfaces);
@@ -648,7 +875,7 @@ mstpd_chk_for_system_configured(void)
 /**PROC+****************************************************************
  * Name:    send_mstp_global_config_update
  *
- * Purpose:  Send MSTP update to daemon.
+ * Purpose:  Send MSTP update to daemon, through the config mailbox.
  *
  * Params:    none
  *
@@ -659,30 +886,17 @@ mstpd_chk_for_system_configured(void)
 
 static void send_mstp_global_config_update(struct mstp_global_config *global_config)
 {
-    int msgSize = 0;
-    mstpd_message *msg;
-    struct mstp_global_config *event = NULL;
     if (global_config == NULL)
     {
         return;
     }
-    msgSize = sizeof(mstp_global_config)+sizeof(mstpd_message);
-    msg = (mstpd_message *)alloc_msg(msgSize);
-    if (NULL == msg){
-        VLOG_ERR("Out of memory for MSTP timer message.");
-        return;
-    }
-    if (msg != NULL) {
-        msg->msg_type = e_mstpd_global_config;
-        event = (mstp_global_config *)(msg+1);
-        memcpy(event,global_config,sizeof(mstp_global_config));
-        mstpd_send_event(msg);
-    }
+    mstp_cfgMboxPut(e_mstpd_global_config, global_config,
+                    sizeof(mstp_global_config));
 }
 /**PROC+****************************************************************
  * Name:    send_mstp_cist_config_update
  *
- * Purpose:  Send MSTP update to daemon.
+ * Purpose:  Send MSTP update to daemon, through the config mailbox.
  *
  * Params:    none
  *
@@ -692,30 +906,17 @@ static void send_mstp_global_config_update(struct mstp_global_config *global_con
 
 static void send_mstp_cist_config_update(struct mstp_cist_config *cist_config)
 {
-    int msgSize = 0;
-    mstpd_message *msg;
-    struct mstp_cist_config *event = NULL;
     if (cist_config == NULL)
     {
         return;
     }
-    msgSize = sizeof(mstp_cist_config)+sizeof(mstpd_message);
-    msg = (mstpd_message *)alloc_msg(msgSize);
-    if (NULL == msg){
-        VLOG_ERR("Out of memory for MSTP timer message.");
-        return;
-    }
-    if (msg != NULL) {
-        msg->msg_type = e_mstpd_cist_config;
-        event = (mstp_cist_config *)(msg+1);
-        memcpy(event,cist_config,sizeof(mstp_cist_config));
-        mstpd_send_event(msg);
-    }
+    mstp_cfgMboxPut(e_mstpd_cist_config, cist_config,
+                    sizeof(mstp_cist_config));
 }
 /**PROC+****************************************************************
  * Name:    send_mstp_cist_port_config_update
  *
- * Purpose:  Send MSTP update to daemon.
+ * Purpose:  Send MSTP update to daemon, through the config mailbox.
  *
  * Params:    none
  *
@@ -725,30 +926,17 @@ static void send_mstp_cist_config_update(struct mstp_cist_config *cist_config)
 
 static void send_mstp_cist_port_config_update(struct mstp_cist_port_config *cist_port_config)
 {
-    int msgSize = 0;
-    mstpd_message *msg;
-    struct mstp_cist_port_config *event = NULL;
     if (cist_port_config == NULL)
     {
         return;
     }
-    msgSize = sizeof(mstp_cist_port_config)+sizeof(mstpd_message);
-    msg = (mstpd_message *)alloc_msg(msgSize);
-    if (NULL == msg){
-        VLOG_ERR("Out of memory for MSTP timer message.");
-        return;
-    }
-    if (msg != NULL) {
-        msg->msg_type = e_mstpd_cist_port_config;
-        event = (mstp_cist_port_config *)(msg+1);
-        memcpy(event,cist_port_config,sizeof(mstp_cist_port_config));
-        mstpd_send_event(msg);
-    }
+    mstp_cfgMboxPut(e_mstpd_cist_port_config, cist_port_config,
+                    sizeof(mstp_cist_port_config));
 }
 /**PROC+****************************************************************
  * Name:    send_mstp_msti_config_update
  *
- * Purpose:  Send MSTP update to daemon.
+ * Purpose:  Send MSTP update to daemon, through the config mailbox.
  *
  * Params:    none
  *
@@ -758,30 +946,17 @@ static void send_mstp_cist_port_config_update(struct mstp_cist_port_config *cist
 
 static void send_mstp_msti_config_update(struct mstp_msti_config *msti_config)
 {
-    int msgSize = 0;
-    mstpd_message *msg;
-    struct mstp_msti_config *event = NULL;
     if (msti_config == NULL)
     {
         return;
     }
-    msgSize = sizeof(mstp_msti_config)+sizeof(mstpd_message);
-    msg = (mstpd_message *)alloc_msg(msgSize);
-    if (NULL == msg){
-        VLOG_ERR("Out of memory for MSTP timer message.");
-        return;
-    }
-    if (msg != NULL) {
-        msg->msg_type = e_mstpd_msti_config;
-        event = (mstp_msti_config *)(msg+1);
-        memcpy(event,msti_config,sizeof(mstp_msti_config));
-        mstpd_send_event(msg);
-    }
+    mstp_cfgMboxPut(e_mstpd_msti_config, msti_config,
+                    sizeof(mstp_msti_config));
 }
 /**PROC+****************************************************************
  * Name:    send_mstp_msti_port_config_update
  *
- * Purpose:  Send MSTP update to daemon.
+ * Purpose:  Send MSTP update to daemon, through the config mailbox.
  *
  * Params:    none
  *
@@ -791,30 +966,17 @@ static void send_mstp_msti_config_update(struct mstp_msti_config *msti_config)
 
 static void send_mstp_msti_port_config_update(struct mstp_msti_port_config *msti_port_config)
 {
-    int msgSize = 0;
-    mstpd_message *msg;
-    struct mstp_msti_port_config *event = NULL;
     if (msti_port_config == NULL)
     {
         return;
     }
-    msgSize = sizeof(mstp_msti_port_config)+sizeof(mstpd_message);
-    msg = (mstpd_message *)alloc_msg(msgSize);
-    if (NULL == msg){
-        VLOG_ERR("Out of memory for MSTP timer message.");
-        return;
-    }
-    if (msg != NULL) {
-        msg->msg_type = e_mstpd_msti_port_config;
-        event = (mstp_msti_port_config *)(msg+1);
-        memcpy(event,msti_port_config,sizeof(mstp_msti_port_config));
-        mstpd_send_event(msg);
-    }
+    mstp_cfgMboxPut(e_mstpd_msti_port_config, msti_port_config,
+                    sizeof(mstp_msti_port_config));
 }
 /**PROC+****************************************************************
  * Name:    send_mstp_msti_config_delete
  *
- * Purpose:  Send MSTP update to daemon.
+ * Purpose:  Send MSTP update to daemon, through the config mailbox.
  *
  * Params:    none
  *
@@ -824,25 +986,12 @@ static void send_mstp_msti_port_config_update(struct mstp_msti_port_config *msti
 
 static void send_mstp_msti_config_delete(struct mstp_msti_config_delete *msti_config_delete)
 {
-    int msgSize = 0;
-    mstpd_message *msg;
-    struct mstp_msti_config_delete *event = NULL;
     if (msti_config_delete == NULL)
     {
         return;
     }
-    msgSize = sizeof(mstp_msti_config_delete)+sizeof(mstpd_message);
-    msg = (mstpd_message *)alloc_msg(msgSize);
-    if (NULL == msg){
-        VLOG_ERR("Out of memory for MSTP timer message.");
-        return;
-    }
-    if (msg != NULL) {
-        msg->msg_type = e_mstpd_msti_config_delete;
-        event = (mstp_msti_config_delete *)(msg+1);
-        memcpy(event,msti_config_delete,sizeof(mstp_msti_config_delete));
-        mstpd_send_event(msg);
-    }
+    mstp_cfgMboxPut(e_mstpd_msti_config_delete, msti_config_delete,
+                    sizeof(mstp_msti_config_delete));
 }
 
 /**PROC+****************************************************************
@@ -879,18 +1028,18 @@ send_interface_add_msg(struct iface_data *info_ptr)
 /**PROC+****************************************************************
  * Name:    send_vlan_add_msg
  *
- * Purpose:  Send VLAN update to daemon.
+ * Purpose:  Send the VLANs created since the last update to daemon.
  *
- * Params:    none
+ * Params:    vids -> VLANs created
  *
  * Returns:   none
  *
  **PROC-*****************************************************************/
 
 static void
-send_vlan_add_msg(uint32_t vid)
+send_vlan_add_msg(const VID_MAP *vids)
 {
-    VLOG_DBG("VLAN add send event : %d", vid);
+    VLOG_DBG("VLAN add send event : %u VLANs", count_vids(vids));
     int msgSize = 0;
     mstpd_message *msg;
     mstp_vlan_add *event;
@@ -903,7 +1052,7 @@ send_vlan_add_msg(uint32_t vid)
     if(msg != NULL) {
         msg->msg_type = e_mstpd_vlan_add;
         event = (mstp_vlan_add *)(msg+1);
-        event->vid = vid;
+        copy_vid_map(vids, &event->vids);
         mstpd_send_event(msg);
     }
 }
@@ -911,18 +1060,18 @@ send_vlan_add_msg(uint32_t vid)
 /**PROC+****************************************************************
  * Name:    send_vlan_delete_msg
  *
- * Purpose:  Send VLAN update to daemon.
+ * Purpose:  Send the VLANs deleted since the last update to daemon.
  *
- * Params:    none
+ * Params:    vids -> VLANs deleted
  *
  * Returns:   none
  *
  **PROC-*****************************************************************/
 
 static void
-send_vlan_delete_msg(uint32_t vid)
+send_vlan_delete_msg(const VID_MAP *vids)
 {
-    VLOG_DBG("VLAN delete send event : %d", vid);
+    VLOG_DBG("VLAN delete send event : %u VLANs", count_vids(vids));
     int msgSize = 0;
     mstpd_message *msg;
     mstp_vlan_delete *event;
@@ -935,7 +1084,7 @@ send_vlan_delete_msg(uint32_t vid)
     if(msg != NULL) {
         msg->msg_type = e_mstpd_vlan_delete;
         event = (mstp_vlan_delete *)(msg+1);
-        event->vid = vid;
+        copy_vid_map(vids, &event->vids);
         mstpd_send_event(msg);
     }
 }
@@ -1057,6 +1206,11 @@ del_old_interface(struct shash_node *sh_node)
                 mstpd_free_lag_id((idp->lport_id - MAX_PPORTS));
             }
             deregister_stp_mcast_addr(idp->lport_id);
+            mstp_rxPolicerConfig(idp->lport_id, 0, 0);
+            mstp_rxPolicerStatsClear(idp->lport_id);
+            /* The protocol thread's copy must not keep the port up. */
+            idp->link_state = INTERFACE_LINK_STATE_DOWN;
+            send_lport_info_msg(idp, NULL);
             free(idp->name);
             idp_lookup[idp->lport_id] = NULL;
             free(idp);
@@ -1191,12 +1345,76 @@ add_new_lag_interface(const struct ovsrec_port *prow)
     }
 } /* add_new_interface */
 
+/**PROC+****************************************************************
+ * Name:    send_lport_info_msg
+ *
+ * Purpose:  Send the interface attributes the protocol thread keeps its
+ *           own copy of (name, MAC, link state, speed and duplex), if they
+ *           changed since they were last sent. The MSTPDU source MAC used
+ *           by the RX thread is refreshed at the same time.
+ *
+ * Params:   idp  -> interface data
+ *           prow -> Port row of the interface
+ *
+ * Returns:   none
+ *
+ **PROC-*****************************************************************/
+
+static void
+send_lport_info_msg(struct iface_data *idp, const struct ovsrec_port *prow)
+{
+    mstpd_message *msg = NULL;
+    mstp_lport_info info;
+    const char *mac_str = NULL;
+
+    if (!IS_VALID_LPORT(idp->lport_id)) {
+        return;
+    }
+
+    /* Zeroed as a whole, it is compared with memcmp below. */
+    memset(&info, 0, sizeof(info));
+    info.lportindex = idp->lport_id;
+    strncpy(info.lportname, idp->name, PORTNAME_LEN - 1);
+    if (prow && (prow->n_interfaces > 0)) {
+        mac_str = smap_get(&prow->interfaces[0]->hw_intf_info, "mac_addr");
+    }
+    if (mac_str &&
+        (sscanf(mac_str, "%02hhx:%02hhx:%02hhx:%02hhx:%02hhx:%02hhx",
+                &info.mac[0], &info.mac[1], &info.mac[2],
+                &info.mac[3], &info.mac[4], &info.mac[5]) == 6)) {
+        info.mac_valid = true;
+    }
+    info.link_up = (idp->link_state == INTERFACE_LINK_STATE_UP);
+    info.link_speed = idp->link_speed;
+    info.duplex = idp->duplex;
+
+    if (idp->info_sent_valid &&
+        (memcmp(&info, &idp->info_sent, sizeof(info)) == 0)) {
+        return;
+    }
+
+    msg = (mstpd_message *)alloc_msg(sizeof(mstp_lport_info) +
+                                     sizeof(mstpd_message));
+    if (msg == NULL) {
+        VLOG_ERR("Out of memory for MSTP lport info message.");
+        return;
+    }
+    msg->msg_type = e_mstpd_lport_info;
+    memcpy(msg+1, &info, sizeof(info));
+    mstpd_send_event(msg);
+
+    memcpy(&idp->info_sent, &info, sizeof(info));
+    idp->info_sent_valid = true;
+} /* send_lport_info_msg */
+
 /**PROC+****************************************************************
  * Name:    send_link_state_change_msg
  *
- * Purpose:  Send link state update to daemon
+ * Purpose:  Send link state update to daemon, preceded by the interface
+ *           attributes so the protocol thread sees the new speed and
+ *           duplex when it handles the link state change.
  *
- * Params: iface_data object
+ * Params: iface_data object, Port row of the interface
  *
  * Returns:   none
  *
@@ -1204,11 +1422,15 @@ add_new_lag_interface(const struct ovsrec_port *prow)
 
 
 static void
-send_link_state_change_msg(struct iface_data *info_ptr)
+send_link_state_change_msg(struct iface_data *info_ptr,
+                           const struct ovsrec_port *prow)
 {
     int msgSize = 0;
     mstpd_message *msg = NULL;
     mstp_lport_state_change *event;
+
+    send_lport_info_msg(info_ptr, prow);
+
     msgSize = sizeof(mstp_lport_state_change)+sizeof(mstpd_message);
     msg = (mstpd_message *)alloc_msg(msgSize);
 
@@ -1274,12 +1496,47 @@ update_lag_interface(const struct ovsrec_port *prow,
                      " new_link=%s ",
                      prow->name,
                      (idp->link_state == INTERFACE_LINK_STATE_UP ? "up" : "down"));
-            send_link_state_change_msg(idp);
+            send_link_state_change_msg(idp, prow);
 
         }
     }
 }
 
+/**PROC+****************************************************************
+ * Name:    intf_update_bpdu_policer
+ *
+ * Purpose: Hand the BPDU ingress policer rate and depth of a port, from
+ *          its other_config, to the RX thread. Missing or out of range
+ *          values get the defaults; a rate of 0 turns policing off.
+ *
+ * Params:    idp  -> interface
+ *            prow -> its Port row
+ *
+ * Returns:   none
+ *
+ **PROC-*****************************************************************/
+static void
+intf_update_bpdu_policer(const struct iface_data *idp,
+                         const struct ovsrec_port *prow)
+{
+    int rate = smap_get_int(&prow->other_config, MSTP_BPDU_RATE_LIMIT,
+                            MSTP_BPDU_RATE_LIMIT_DEF);
+    int burst = smap_get_int(&prow->other_config, MSTP_BPDU_BURST,
+                             MSTP_BPDU_BURST_DEF);
+
+    if ((rate < 0) || (rate > MSTP_BPDU_RATE_LIMIT_MAX)) {
+        VLOG_WARN("Port %s: invalid %s %d, using %d", prow->name,
+                  MSTP_BPDU_RATE_LIMIT, rate, MSTP_BPDU_RATE_LIMIT_DEF);
+        rate = MSTP_BPDU_RATE_LIMIT_DEF;
+    }
+    if ((burst < MSTP_BPDU_BURST_MIN) || (burst > MSTP_BPDU_BURST_MAX)) {
+        VLOG_WARN("Port %s: invalid %s %d, using %d", prow->name,
+                  MSTP_BPDU_BURST, burst, MSTP_BPDU_BURST_DEF);
+        burst = MSTP_BPDU_BURST_DEF;
+    }
+    mstp_rxPolicerConfig(idp->lport_id, rate, burst);
+}
+
 /***********************************************************************
  * Name:    update_interface_cache
  *
@@ -1350,12 +1607,23 @@ update_interface_cache(void)
         const struct ovsrec_interface *ifrow;
         const struct ovsrec_port *prow =
             shash_find_data(&sh_idl_interfaces, sh_node->name);
+        bool row_changed;
         if (!prow)
         {
             VLOG_DBG("Port row %s is not found, will be deleted at the end of reconfigure",sh_node->name);
             continue;
         }
 
+        row_changed = (OVSREC_IDL_IS_ROW_INSERTED(prow, idl_seqno) ||
+                       OVSREC_IDL_IS_ROW_MODIFIED(prow, idl_seqno) ||
+                       ((prow->n_interfaces > 0) &&
+                        (OVSREC_IDL_IS_ROW_INSERTED(prow->interfaces[0], idl_seqno) ||
+                         OVSREC_IDL_IS_ROW_MODIFIED(prow->interfaces[0], idl_seqno))));
+
+        if (row_changed) {
+            intf_update_bpdu_policer(idp, prow);
+        }
+
         if (!VERIFY_LAG_IFNAME(prow->name)) {
             /* update lag interface */
             update_lag_interface(prow, idp);
@@ -1395,11 +1663,17 @@ update_interface_cache(void)
                          " new_link=%s ",
                          ifrow->name,
                          (idp->link_state == INTERFACE_LINK_STATE_UP ? "up" : "down"));
-                send_link_state_change_msg(idp);
+                send_link_state_change_msg(idp, prow);
 
                 }
             }
         }
+
+        /* Speed, duplex or MAC changes that came without a link state
+         * change. */
+        if (row_changed || !idp->info_sent_valid) {
+            send_lport_info_msg(idp, prow);
+        }
     }
     /* Destroy the shash of the IDL interfaces. */
     shash_destroy(&sh_idl_interfaces);
@@ -1515,7 +1789,7 @@ static int update_l2port_cache(void)
  **PROC-*****************************************************************/
 
 static void
-add_new_vlan(struct shash_node *sh_node)
+add_new_vlan(struct shash_node *sh_node, VID_MAP *added)
 {
     VLOG_DBG("Add VLAN Cache");
     struct vlan_data *new_vlan = NULL;
@@ -1532,7 +1806,7 @@ add_new_vlan(struct shash_node *sh_node)
 
         new_vlan->vlan_id = vlan_row->id;
         new_vlan->name = xstrdup(vlan_row->name);
-        send_vlan_add_msg(new_vlan->vlan_id);
+        set_vid(added, new_vlan->vlan_id);
         VLOG_DBG("Created local data for VLAN %d", (int)vlan_row->id);
     }
 } /* add_new_vlan */
@@ -1549,12 +1823,12 @@ add_new_vlan(struct shash_node *sh_node)
 
 
 static void
-del_old_vlan(struct shash_node *sh_node)
+del_old_vlan(struct shash_node *sh_node, VID_MAP *deleted)
 {
     if (sh_node) {
         VLOG_DBG("Delete VLAN Cache should send an update");
         struct vlan_data *vl = sh_node->data;
-        send_vlan_delete_msg(vl->vlan_id);
+        set_vid(deleted, vl->vlan_id);
         free(vl->name);
         free(vl);
         shash_delete(&all_vlans, sh_node);
@@ -1564,7 +1838,8 @@ del_old_vlan(struct shash_node *sh_node)
 /**PROC+****************************************************************
  * Name:    update_vlan_cache
  *
- * Purpose:  Update local cache for VLAN
+ * Purpose:  Update local cache for VLAN. The VLANs deleted and the VLANs
+ *           created are each sent to the daemon as one set.
  *
  * Params:    none
  *
@@ -1582,8 +1857,13 @@ update_vlan_cache(void)
     const struct ovsrec_vlan *row;
     struct shash_node *sh_node, *sh_next;
     struct smap smap = SMAP_INITIALIZER(&smap);
+    VID_MAP added;
+    VID_MAP deleted;
     int rc = 0;
 
+    clear_vid_map(&added);
+    clear_vid_map(&deleted);
+
     /* Collect all the VLANs in the DB. */
     shash_init(&sh_idl_vlans);
     OVSREC_VLAN_FOR_EACH(row, idl) {
@@ -1601,7 +1881,7 @@ update_vlan_cache(void)
         new_vlan = shash_find_data(&sh_idl_vlans, sh_node->name);
         if (!new_vlan) {
             VLOG_DBG("Found a deleted VLAN %s", sh_node->name);
-            del_old_vlan(sh_node);
+            del_old_vlan(sh_node, &deleted);
         }
     }
 
@@ -1610,13 +1890,21 @@ update_vlan_cache(void)
         new_vlan = shash_find_data(&all_vlans, sh_node->name);
         if (!new_vlan) {
             VLOG_DBG("Found an added VLAN %s", sh_node->name);
-            add_new_vlan(sh_node);
+            add_new_vlan(sh_node, &added);
         }
     }
 
     /* Destroy the shash of the IDL vlans */
     shash_destroy(&sh_idl_vlans);
 
+    /* Deletes first: a VLAN renamed in place is in both sets. */
+    if (are_any_vids_set(&deleted)) {
+        send_vlan_delete_msg(&deleted);
+    }
+    if (are_any_vids_set(&added)) {
+        send_vlan_add_msg(&added);
+    }
+
     return rc;
 
 } /* update_vlan_cache */
@@ -1713,12 +2001,9 @@ mstpd_run(void)
 
         if(init_required)
         {
-            /* clean the status parameter for first time even if cist exist */
-            util_mstp_status_statistics_clean();
-
-            util_mstp_set_defaults();
-            util_add_default_ports_to_cist();
-            util_add_default_ports_to_mist();
+            /* clean the status parameter for first time even if cist exist,
+             * and write the default rows */
+            util_mstp_bootstrap();
 
             util_mstp_init_config();
             init_required = false;
@@ -1734,6 +2019,11 @@ mstpd_run(void)
 
     MSTP_OVSDB_UNLOCK;
 
+    /* Write what the protocol thread handed over. */
+    if (system_configured) {
+        mstp_dbOutboxRun();
+    }
+
     return;
 } /* mstpd_run */
 
@@ -1741,6 +2031,7 @@ void
 mstpd_wait(void)
 {
     ovsdb_idl_wait(idl);
+    mstp_dbOutboxWait();
 } /* mstpd_wait */
 
 /**********************************************************************/
@@ -1771,6 +2062,7 @@ mstpd_ovs_main_thread(void *arg)
 
     /* Detach thread to avoid memory leak upon exit. */
     pthread_detach(pthread_self());
+    mstp_setThreadRole(MSTP_THREAD_OVSDB);
 
     appctl = (struct unixctl_server *)arg;
     clear_port_map(&l2ports);
@@ -1780,9 +2072,11 @@ mstpd_ovs_main_thread(void *arg)
     while (!exiting) {
         mstpd_run();
         unixctl_server_run(appctl);
+        mstpd_daemon_digest_bench_run();
 
         mstpd_wait();
         unixctl_server_wait(appctl);
+        mstpd_daemon_digest_bench_wait();
         if (exiting) {
             poll_immediate_wake();
         } else {
@@ -1800,141 +2094,165 @@ mstpd_ovs_main_thread(void *arg)
 } /* mstpd_ovs_main_thread */
 
 /**PROC+***********************************************************
- * Name:    intf_get_mac_addr
+ * Name:    mstp_util_set_stats_interval
  *
- * Purpose: Get MAC address for interface
+ * Purpose: Set the interval of the BPDU statistics export to DB
  *
- * Params:  lport id
+ * Params:    seconds: interval, MSTP_STATS_EXPORT_INTERVAL_MIN to
+ *                     MSTP_STATS_EXPORT_INTERVAL_MAX
  *
- * Returns:   none
+ * Returns:   true if the interval has been changed
  *
  **PROC-*****************************************************************/
-
-const char* intf_get_mac_addr(uint16_t lport)
+bool
+mstp_util_set_stats_interval(uint32_t seconds)
 {
-    const struct ovsrec_interface *ifrow = NULL;
-    const struct ovsrec_port *prow = NULL;
-    struct iface_data *idp = NULL;
-    const char *mac = NULL;
-
-    assert((lport != 0) && (lport <= MAX_LPORTS));
-    MSTP_OVSDB_LOCK;
-    idp = find_iface_data_by_index(lport);
-    if (idp == NULL)
-    {
-        assert(false);
-    }
-    OVSREC_PORT_FOR_EACH(prow, idl)
-    {
-        if(strcmp(prow->name,idp->name)==0)
-        {
-            ifrow = prow->interfaces[0];
-            mac = smap_get(&ifrow->hw_intf_info,"mac_addr");
-            VLOG_DBG("Util name : %s, mac: %s ",ifrow->name,mac);
-            MSTP_OVSDB_UNLOCK;
-            return mac;
-        }
+    if (seconds < MSTP_STATS_EXPORT_INTERVAL_MIN ||
+        seconds > MSTP_STATS_EXPORT_INTERVAL_MAX) {
+        return false;
     }
-    MSTP_OVSDB_UNLOCK;
-    return NULL;
+    __atomic_store_n(&mstp_stats_interval, seconds, __ATOMIC_RELAXED);
+    return true;
 }
 
-/**PROC+***********************************************************
- * Name:    system_get_mac_addr
- *
- * Purpose: Get MAC address for System
- *
- * Params:    mac_buffer : Destination buffer to which mac addres to be copied
- *
- * Returns:   none
- *
- **PROC-*****************************************************************/
-
-void system_get_mac_addr(const char *mac_buffer)
+uint32_t
+mstp_util_get_stats_interval(void)
 {
-    const struct ovsrec_system *system = NULL;
-    MSTP_OVSDB_LOCK;
-    system = ovsrec_system_first(idl);
-    memcpy((void *)mac_buffer, system->system_mac, MSTP_MAC_STR_LEN -1);
-    MSTP_OVSDB_UNLOCK;
-    return;
+    return __atomic_load_n(&mstp_stats_interval, __ATOMIC_RELAXED);
 }
 
 /**PROC+***********************************************************
- * Name:    update_mstp_counters
+ * Name:    mstp_util_export_bpdu_stats
  *
- * Purpose: update Tx counters for MSTP
+ * Purpose: Called by the protocol thread every second. Once per export
+ *          interval computes the per-port BPDU rates and stages the
+ *          counters and rates that changed since the last export in the
+ *          DB outbox; the OVSDB thread writes them to the CIST port
+ *          'mstp_statistics' column, all ports in one transaction.
  *
- * Params:    lport: port number
- *            key  : Statistics key value for setting the counter
+ * Params:    none
  *
  * Returns:   none
  *
  **PROC-*****************************************************************/
-
-void update_mstp_counters(LPORT_t lport, const char *key)
+void
+mstp_util_export_bpdu_stats(void)
 {
-    struct ovsdb_idl_txn *txn = NULL;
-    struct smap smap = SMAP_INITIALIZER(&smap);
-    int value = 0;
-    const char *temp = NULL;
-    char count[5]={0};
-    struct iface_data *idp = NULL;
-    const struct ovsrec_mstp_common_instance_port *cist_port;
-
-    MSTP_OVSDB_LOCK;
-    txn = ovsdb_idl_txn_create(idl);
-    if((!lport) || (!key)) {
-        VLOG_DBG("Invalid Input %s:%d", __FILE__, __LINE__);
-        return;
-    }
+    static uint32_t ticks = 0;
+    MSTP_COMM_PORT_INFO_t *commPortPtr = NULL;
+    MSTP_DB_PORT_STATS_t stats;
+    uint32_t interval = mstp_util_get_stats_interval();
+    LPORT_t lport;
 
-    idp = find_iface_data_by_index(lport);
-    if(!idp) {
-        VLOG_DBG("find_iface_data_by_index failed %s:%d", __FILE__, __LINE__);
+    if (++ticks < interval) {
         return;
     }
+    ticks = 0;
 
-    OVSREC_MSTP_COMMON_INSTANCE_PORT_FOR_EACH(cist_port, idl) {
-        if(!cist_port->port) {
+    for (lport = 1; lport <= MAX_LPORTS; lport++) {
+        commPortPtr = MSTP_COMM_PORT_PTR(lport);
+        if (!commPortPtr) {
             continue;
         }
-        if(strcmp(idp->name, cist_port->port->name) == 0) {
-            break;
+        commPortPtr->dbxTxRate =
+            (uint32_t)((commPortPtr->dbxTxCnt - commPortPtr->dbxTxCntPrev) / interval);
+        commPortPtr->dbxRxRate =
+            (uint32_t)((commPortPtr->dbxRxCnt - commPortPtr->dbxRxCntPrev) / interval);
+        commPortPtr->dbxTxCntPrev = commPortPtr->dbxTxCnt;
+        commPortPtr->dbxRxCntPrev = commPortPtr->dbxRxCnt;
+
+        /* 'mstp_tx_bpdu'/'mstp_rx_bpdu' keep counting MST BPDUs only */
+        stats.txCnt = commPortPtr->bpduTxCnt[MSTP_BPDU_TYPE_MSTP];
+        stats.rxCnt = commPortPtr->bpduRxCnt[MSTP_BPDU_TYPE_MSTP];
+        stats.txRate = commPortPtr->dbxTxRate;
+        stats.rxRate = commPortPtr->dbxRxRate;
+        stats.policedCnt = mstp_rxPolicerDropCnt(lport);
+        if (commPortPtr->statsExported &&
+            commPortPtr->statsTxExported == stats.txCnt &&
+            commPortPtr->statsRxExported == stats.rxCnt &&
+            commPortPtr->statsTxRateExported == stats.txRate &&
+            commPortPtr->statsRxRateExported == stats.rxRate &&
+            commPortPtr->statsPolicedExported == stats.policedCnt) {
+            continue;
         }
-    }
-
-    if(!cist_port) {
-        VLOG_DBG("MSTP CIST port doesnot exist %s:%d", __FILE__, __LINE__);
-        return;
-    }
 
-    temp = smap_get(&cist_port->mstp_statistics, key);
-    value = (temp)?atoi(temp):0;
-    value++;
-    snprintf(count, sizeof(count), "%d", value);
-    smap_clone(&smap, &cist_port->mstp_statistics);
-    smap_replace(&smap, key, count);
+        mstp_dbOutboxStageStats(lport, &stats);
 
-    ovsrec_mstp_common_instance_port_set_mstp_statistics(cist_port, &smap);
-    smap_destroy(&smap);
-    ovsdb_idl_txn_commit_block(txn);
-    ovsdb_idl_txn_destroy(txn);
-    MSTP_OVSDB_UNLOCK;
+        commPortPtr->statsExported = true;
+        commPortPtr->statsTxExported = stats.txCnt;
+        commPortPtr->statsRxExported = stats.rxCnt;
+        commPortPtr->statsTxRateExported = stats.txRate;
+        commPortPtr->statsRxRateExported = stats.rxRate;
+        commPortPtr->statsPolicedExported = stats.policedCnt;
+    }
 }
+
 /**PROC+***********************************************************
- * Name:    mstp_global_config_update
+ * Name:    mstp_util_write_bpdu_stats
  *
- * Purpose: Update MSTP config to protocol thread
+ * Purpose: Write the BPDU counters and rates of 'ports' to the CIST port
+ *          'mstp_statistics' column. Caller holds MSTP_OVSDB_LOCK and
+ *          owns the transaction.
  *
- * Params:    none
+ * Params:    ports -> ports to write
+ *            stats -> counters and rates, indexed by lport
  *
- * Returns:   none
+ * Returns:   number of rows written
  *
  **PROC-*****************************************************************/
+uint32_t
+mstp_util_write_bpdu_stats(const PORT_MAP *ports,
+                           const MSTP_DB_PORT_STATS_t *stats)
+{
+    const struct ovsrec_mstp_common_instance_port *cist_port = NULL;
+    struct iface_data *idp = NULL;
+    const MSTP_DB_PORT_STATS_t *st;
+    struct smap smap;
+    char count[24];
+    uint32_t rows = 0;
 
-int mstp_global_config_update(void) {
-    const struct ovsrec_bridge *bridge_row = NULL;
+    OVSREC_MSTP_COMMON_INSTANCE_PORT_FOR_EACH(cist_port, idl) {
+        if (!cist_port->port) {
+            continue;
+        }
+        idp = shash_find_data(&all_interfaces, cist_port->port->name);
+        if (!idp || !IS_VALID_LPORT(idp->lport_id) ||
+            !is_port_set(ports, idp->lport_id)) {
+            continue;
+        }
+        st = &stats[idp->lport_id];
+
+        smap_clone(&smap, &cist_port->mstp_statistics);
+        snprintf(count, sizeof(count), "%"PRIu64, st->txCnt);
+        smap_replace(&smap, MSTP_TX_BPDU, count);
+        snprintf(count, sizeof(count), "%"PRIu64, st->rxCnt);
+        smap_replace(&smap, MSTP_RX_BPDU, count);
+        snprintf(count, sizeof(count), "%u", st->txRate);
+        smap_replace(&smap, MSTP_TX_BPDU_RATE, count);
+        snprintf(count, sizeof(count), "%u", st->rxRate);
+        smap_replace(&smap, MSTP_RX_BPDU_RATE, count);
+        snprintf(count, sizeof(count), "%"PRIu64, st->policedCnt);
+        smap_replace(&smap, MSTP_RX_BPDU_POLICED, count);
+        ovsrec_mstp_common_instance_port_set_mstp_statistics(cist_port, &smap);
+        smap_destroy(&smap);
+        rows++;
+    }
+    return rows;
+}
+
+/**PROC+***********************************************************
+ * Name:    mstp_global_config_update
+ *
+ * Purpose: Update MSTP config to protocol thread
+ *
+ * Params:    none
+ *
+ * Returns:   none
+ *
+ **PROC-*****************************************************************/
+
+int mstp_global_config_update(void) {
+    const struct ovsrec_bridge *bridge_row = NULL;
     const struct ovsrec_system *system_row = NULL;
     const char *mstp_config_name = NULL;
     const char *mstp_config_revision = NULL;
@@ -1967,6 +2285,14 @@ int mstp_global_config_update(void) {
             config_change = TRUE;
         }
     }
+    if (system_row->system_mac &&
+        strncmp(mstp_global_conf.system_mac, system_row->system_mac,
+                MSTP_MAC_STR_LEN - 1) != 0) {
+        memset(mstp_global_conf.system_mac, 0, MSTP_MAC_STR_LEN);
+        strncpy(mstp_global_conf.system_mac, system_row->system_mac,
+                MSTP_MAC_STR_LEN - 1);
+        config_change = TRUE;
+    }
     if(config_change)
     {
         send_mstp_global_config_update(&mstp_global_conf);
@@ -2101,6 +2427,7 @@ int mstp_cist_port_config_update(void) {
             else {
                 struct mstp_cist_port_config *cist_port = cist_port_lookup[lport];
                 cist_port->port = lport;
+                config_change = FALSE;
                 if (cist_port->port_priority != *cist_port_row->port_priority)
                 {
                     cist_port->port_priority = *cist_port_row->port_priority;
@@ -2239,6 +2566,7 @@ int mstp_msti_update_config(void)
         {
             struct mstp_msti_config *msti_data = NULL;
             msti_data = msti_lookup[mstid];
+            config_change = FALSE;
             if(msti_data->n_vlans != msti_row->n_vlans)
             {
                 clear_vid_map(&msti_data->vlans);
@@ -2356,6 +2684,7 @@ int mstp_msti_port_update_config(void)
                 else
                 {
                     struct mstp_msti_port_config *msti_port = msti_port_lookup[mstid][lport];
+                    config_change = FALSE;
                     if (msti_port->priority != *mstp_inst_port->port_priority)
                     {
                         msti_port->priority = *mstp_inst_port->port_priority;
@@ -2497,9 +2826,13 @@ void clear_interface_cache()
 void clear_vlan_cache()
 {
     struct shash_node *sh_node = NULL, *sh_next = NULL;
- /* Delete VLANS. */
+    VID_MAP deleted;
+
+    /* Delete VLANS. The VLANs are still in the DB, so the set is not sent:
+     * the DB mapping must be left alone. */
+    clear_vid_map(&deleted);
     SHASH_FOR_EACH_SAFE(sh_node, sh_next, &all_vlans) {
-            del_old_vlan(sh_node);
+            del_old_vlan(sh_node, &deleted);
     }
 }
 
@@ -2528,9 +2861,13 @@ void clear_mstp_msti_port_config() {
     }
 }
 /**PROC+***********************************************************
- * Name:    mstp_config_reinit
+ * Name:    mstp_config_reload
  *
- * Purpose: Re-initialize the MSTP Config
+ * Purpose: Clear the config caches and send the whole config to the
+ *          protocol thread again. Runs on the OVSDB thread as the
+ *          MSTP_DB_JOB_CONFIG_RELOAD job posted by 'mstp_config_reinit';
+ *          the e_mstpd_config_reload message sent first tells the
+ *          protocol thread where the fresh config starts.
  *
  * Params:    none
  *
@@ -2539,9 +2876,15 @@ void clear_mstp_msti_port_config() {
  **PROC-*****************************************************************/
 
 void
-mstp_config_reinit() {
+mstp_config_reload(void) {
+    mstpd_message *msg;
+
     MSTP_OVSDB_LOCK;
-    mstp_free_event_queue();
+    msg = (mstpd_message *)alloc_msg(sizeof(mstpd_message));
+    if (msg != NULL) {
+        msg->msg_type = e_mstpd_config_reload;
+        mstpd_send_event(msg);
+    }
     clear_mstp_global_config();
     clear_mstp_cist_config();
     clear_mstp_cist_port_config();
@@ -2655,140 +2998,137 @@ mstpd_is_valid_port_row(const struct ovsrec_port *prow)
     return retval;
 }
 
+/* The L2 ports the default port rows are written for, gathered once */
+struct mstp_bootstrap_ports {
+    struct ovsrec_port **ports;
+    bool *link_up;
+    size_t n;
+};
+
 /**PROC+***********************************************************
- * Name:    util_add_default_ports_to_mist
+ * Name:    util_get_bootstrap_ports
  *
- * Purpose: Add L2ports to the MIST at the time of INIT.
+ * Purpose: Collect the bridge ports MSTP runs on, and their link state
  *
- * Params:    none
+ * Params:    bridge_row -> the bridge
+ *            bp         -> filled in, to be released with
+ *                          'util_free_bootstrap_ports'
  *
  * Returns:   none
  *
  **PROC-*****************************************************************/
-void
-util_add_default_ports_to_mist() {
-    struct ovsrec_mstp_instance_port *mstp_port_row = NULL, **mstp_port_info = NULL;
-    struct ovsrec_mstp_instance *mstp_row = NULL;
-
-    const struct ovsrec_bridge *bridge_row = NULL;
-    int64_t port_priority = DEF_MSTP_PORT_PRIORITY;
-    int64_t admin_path_cost = 0;
-    struct ovsdb_idl_txn *txn = NULL;
-    int i = 0, j = 0,k = 0;
-    uint64_t msti_port_count = 0;
+static void
+util_get_bootstrap_ports(const struct ovsrec_bridge *bridge_row,
+                         struct mstp_bootstrap_ports *bp)
+{
+    size_t i;
 
-    bridge_row = ovsrec_bridge_first(idl);
-    if (!bridge_row) {
-        VLOG_DBG("no bridge record found");
-        return;
-    }
+    bp->ports = xmalloc(sizeof *bp->ports * (bridge_row->n_ports + 1));
+    bp->link_up = xmalloc(sizeof *bp->link_up * (bridge_row->n_ports + 1));
+    bp->n = 0;
 
-    for (k=0; k < bridge_row->n_mstp_instances; k++) {
-        mstp_row = bridge_row->value_mstp_instances[k];
-        if(!mstp_row) {
-            assert(0);
-            return;
+    for (i = 0; i < bridge_row->n_ports; i++) {
+        if (!bridge_row->ports[i]) {
+            /* Invalid port row */
+            continue;
         }
-
-        txn = ovsdb_idl_txn_create(idl);
-
-        /* Get the valid l2 port count*/
-        msti_port_count = mstp_util_get_valid_l2_ports(bridge_row);
-        if(msti_port_count == 0) {
-            VLOG_INFO("No valid L2 port found%s:%d", __FILE__, __LINE__);
-            ovsdb_idl_txn_commit_block(txn);
-            ovsdb_idl_txn_destroy(txn);
-            return;
+        if (strcmp(bridge_row->ports[i]->name, "bridge_normal") == 0) {
+            continue;
         }
-
-        mstp_port_info = xmalloc(sizeof *mstp_row->mstp_instance_ports * msti_port_count);
-        if (!mstp_port_info)
-        {
-            VLOG_ERR("Failed to allocate memory for MSTI Port Info");
-            ovsdb_idl_txn_commit_block(txn);
-            ovsdb_idl_txn_destroy(txn);
-            return;
+        if (!mstpd_is_valid_port_row(bridge_row->ports[i])) {
+            /* port row not interested by mstp */
+            continue;
         }
+        bp->ports[bp->n] = bridge_row->ports[i];
+        bp->link_up[bp->n] = intf_get_link_state(bridge_row->ports[i]);
+        bp->n++;
+    }
+}
 
-        for (j=0,i=0; i<bridge_row->n_ports; i++) {
-            if (!bridge_row->ports[i]) {
-                /* Invalid port row */
-                continue;
-            }
-
-            /* create CIST_port entry */
-            if ((strcmp(bridge_row->ports[i]->name,"bridge_normal") == 0)) {
-                continue;
-            }
-            if (!mstpd_is_valid_port_row(bridge_row->ports[i]))
-            {
-                /* port row not interested by mstp */
-                continue;
-            }
+static void
+util_free_bootstrap_ports(struct mstp_bootstrap_ports *bp)
+{
+    free(bp->ports);
+    free(bp->link_up);
+}
 
-            mstp_port_row = (struct ovsrec_mstp_instance_port *)util_get_mist_port(bridge_row->ports[i]->name, mstp_row);
-            if(mstp_port_row) {
-                mstp_port_info[j++] = mstp_port_row;
-                continue;
-            }
+/**PROC+***********************************************************
+ * Name:    util_add_default_ports_to_mist
+ *
+ * Purpose: Add L2ports to a MIST at the time of INIT.
+ *
+ * Params:    txn      -> transaction to add the rows in
+ *            mstp_row -> the MSTI
+ *            bp       -> the L2 ports
+ *
+ * Returns:   number of rows inserted
+ *
+ **PROC-*****************************************************************/
+static size_t
+util_add_default_ports_to_mist(struct ovsdb_idl_txn *txn,
+                               const struct ovsrec_mstp_instance *mstp_row,
+                               const struct mstp_bootstrap_ports *bp) {
+    struct ovsrec_mstp_instance_port *mstp_port_row = NULL, **mstp_port_info = NULL;
+    struct shash existing = SHASH_INITIALIZER(&existing);
+    int64_t port_priority;
+    int64_t admin_path_cost = 0;
+    size_t i = 0, j = 0, inserted = 0;
 
-            /* Create MSTI port table */
-            mstp_port_row = ovsrec_mstp_instance_port_insert(txn);
-            if (!mstp_port_row)
-            {
-                VLOG_ERR("Failed to create Transaction for MSTI Port Info");
-                ovsdb_idl_txn_commit_block(txn);
-                ovsdb_idl_txn_destroy(txn);
-                if(mstp_port_info)
-                    free(mstp_port_info);
-                return;
-            }
-            if (!bridge_row->ports[i])
-            {
-                VLOG_ERR("Failed to get Port Info for MSTP MSTI PORT");
-                ovsdb_idl_txn_commit_block(txn);
-                ovsdb_idl_txn_destroy(txn);
-                if(mstp_port_info)
-                    free(mstp_port_info);
-                return;
-            }
+    if (bp->n == 0) {
+        VLOG_INFO("No valid L2 port found%s:%d", __FILE__, __LINE__);
+        return 0;
+    }
 
+    /* Index the rows the MSTI already has by port name */
+    for (i = 0; i < mstp_row->n_mstp_instance_ports; i++) {
+        mstp_port_row = mstp_row->mstp_instance_ports[i];
+        if (mstp_port_row && mstp_port_row->port) {
+            shash_add_once(&existing, mstp_port_row->port->name, mstp_port_row);
+        }
+    }
 
-            /* FILL the default values for CIST_port entry */
-            if (intf_get_link_state(bridge_row->ports[i]) == true) {
-                ovsrec_mstp_instance_port_set_port_state( mstp_port_row,
-                        MSTP_STATE_FORWARD);
-            }
-            else {
-                ovsrec_mstp_instance_port_set_port_state(mstp_port_row,
-                        MSTP_STATE_BLOCK);
-            }
-            ovsrec_mstp_instance_port_set_port_role( mstp_port_row,
-                    MSTP_ROLE_DISABLE);
-            if(!VERIFY_LAG_IFNAME(bridge_row->ports[i]->name))
-            {
-                port_priority = DEF_MSTP_LAG_PRIORITY;
-                ovsrec_mstp_instance_port_set_port_priority(mstp_port_row,
-                        &port_priority, 1 );
-            }
-            else
-            {
-                ovsrec_mstp_instance_port_set_port_priority(mstp_port_row,
-                        &port_priority, 1 );
-            }
-            ovsrec_mstp_instance_port_set_admin_path_cost(mstp_port_row,
-                    &admin_path_cost, 1);
-            ovsrec_mstp_instance_port_set_port(mstp_port_row,
-                    bridge_row->ports[i]);
+    mstp_port_info = xmalloc(sizeof *mstp_row->mstp_instance_ports * bp->n);
+    for (i = 0; i < bp->n; i++) {
+        mstp_port_row = shash_find_data(&existing, bp->ports[i]->name);
+        if (mstp_port_row) {
             mstp_port_info[j++] = mstp_port_row;
+            continue;
         }
-        ovsrec_mstp_instance_set_mstp_instance_ports (mstp_row,
-                mstp_port_info, msti_port_count);
-        if(mstp_port_info)
-            free(mstp_port_info);
-        ovsdb_idl_txn_commit_block(txn);
-        ovsdb_idl_txn_destroy(txn);
+
+        /* Create MSTI port table */
+        mstp_port_row = ovsrec_mstp_instance_port_insert(txn);
+        inserted++;
+
+        /* FILL the default values for MSTI_port entry */
+        if (bp->link_up[i]) {
+            ovsrec_mstp_instance_port_set_port_state( mstp_port_row,
+                    MSTP_STATE_FORWARD);
+        }
+        else {
+            ovsrec_mstp_instance_port_set_port_state(mstp_port_row,
+                    MSTP_STATE_BLOCK);
+        }
+        ovsrec_mstp_instance_port_set_port_role( mstp_port_row,
+                MSTP_ROLE_DISABLE);
+        if(!VERIFY_LAG_IFNAME(bp->ports[i]->name)) {
+            port_priority = DEF_MSTP_LAG_PRIORITY;
+        }
+        else {
+            port_priority = DEF_MSTP_PORT_PRIORITY;
+        }
+        ovsrec_mstp_instance_port_set_port_priority(mstp_port_row,
+                &port_priority, 1 );
+        ovsrec_mstp_instance_port_set_admin_path_cost(mstp_port_row,
+                &admin_path_cost, 1);
+        ovsrec_mstp_instance_port_set_port(mstp_port_row, bp->ports[i]);
+        mstp_port_info[j++] = mstp_port_row;
     }
+    ovsrec_mstp_instance_set_mstp_instance_ports(mstp_row,
+            mstp_port_info, j);
+    free(mstp_port_info);
+    shash_destroy(&existing);
+
+    return inserted;
 }
 
 /**PROC+***********************************************************
@@ -2796,22 +3136,25 @@ util_add_default_ports_to_mist() {
  *
  * Purpose: Add L2ports to the CIST at the time of INIT.
  *
- * Params:    none
+ * Params:    txn      -> transaction to add the rows in
+ *            cist_row -> the CIST
+ *            bp       -> the L2 ports
  *
- * Returns:   none
+ * Returns:   number of rows inserted
  *
  **PROC-*****************************************************************/
-void
-util_add_default_ports_to_cist() {
+static size_t
+util_add_default_ports_to_cist(struct ovsdb_idl_txn *txn,
+                               const struct ovsrec_mstp_common_instance *cist_row,
+                               const struct mstp_bootstrap_ports *bp) {
     struct ovsrec_mstp_common_instance_port *cist_port_row = NULL;
     struct ovsrec_mstp_common_instance_port **cist_port_info = NULL;
-    struct ovsdb_idl_txn *txn = NULL;
-    const struct ovsrec_bridge *bridge_row = NULL;
-    const struct ovsrec_mstp_common_instance *cist_row = NULL;
-    int64_t i = 0,j = 0;
+    const struct ovsrec_mstp_common_instance_port *row = NULL;
+    struct shash existing = SHASH_INITIALIZER(&existing);
+    size_t i = 0, j = 0, inserted = 0;
 
     int64_t cist_hello_time = DEF_HELLO_TIME;
-    int64_t cist_port_priority = DEF_MSTP_PORT_PRIORITY;
+    int64_t cist_port_priority;
     int64_t admin_path_cost = 0;
     bool bpdus_rx_enable = false;
     bool bpdus_tx_enable = false;
@@ -2822,91 +3165,35 @@ util_add_default_ports_to_cist() {
     bool root_guard_disable = false;
     bool loop_guard_disable = false;
     bool bpdu_filter_disable = false;
-    uint64_t cist_port_count = 0;
-
-    txn = ovsdb_idl_txn_create(idl);
-
-    bridge_row = ovsrec_bridge_first(idl);
-    if (!bridge_row) {
-        VLOG_DBG("no bridge record found");
-        ovsdb_idl_txn_commit_block(txn);
-        ovsdb_idl_txn_destroy(txn);
-        return;
-    }
-
-    cist_row = ovsrec_mstp_common_instance_first (idl);
-    if (!cist_row) {
-        VLOG_DBG("no MSTP common instance record found");
-        ovsdb_idl_txn_commit_block(txn);
-        ovsdb_idl_txn_destroy(txn);
-        return;
-    }
 
-    /* Get the valid l2 port count*/
-    cist_port_count = mstp_util_get_valid_l2_ports(bridge_row);
-    if(cist_port_count == 0) {
+    if (bp->n == 0) {
         VLOG_INFO("No valid L2 port found%s:%d", __FILE__, __LINE__);
-        ovsdb_idl_txn_commit_block(txn);
-        ovsdb_idl_txn_destroy(txn);
-        return;
+        return 0;
     }
 
-    /* Add CIST port entry for all ports to the CIST table */
-    cist_port_info = xmalloc(sizeof *cist_row->mstp_common_instance_ports * cist_port_count);
-    if (!cist_port_info)
-    {
-        VLOG_ERR("Failed to allocate memory for Cist Port Info");
-        ovsdb_idl_txn_commit_block(txn);
-        ovsdb_idl_txn_destroy(txn);
-        return;
+    /* Index the CIST port rows already in DB by port name */
+    OVSREC_MSTP_COMMON_INSTANCE_PORT_FOR_EACH(row, idl) {
+        if (row->port) {
+            shash_add_once(&existing, row->port->name, row);
+        }
     }
 
-    for (i = 0,j =0 ; i < bridge_row->n_ports; i++) {
-
-        if(!bridge_row->ports[i])
-        {
-            /*Invalid port */
-            continue;
-        }
-        /* create CIST_port entry */
-        if (strcmp(bridge_row->ports[i]->name,"bridge_normal") == 0) {
-            continue;
-        }
-        if (!mstpd_is_valid_port_row(bridge_row->ports[i]))
-        {
-            /* port row not interested by mstp */
-            continue;
-        }
-        cist_port_row = (struct ovsrec_mstp_common_instance_port *)util_get_cist_port(bridge_row->ports[i]->name);
+    /* Add CIST port entry for all ports to the CIST table */
+    cist_port_info = xmalloc(sizeof *cist_row->mstp_common_instance_ports * bp->n);
+    for (i = 0; i < bp->n; i++) {
+        cist_port_row = shash_find_data(&existing, bp->ports[i]->name);
         if(cist_port_row) {
             cist_port_info[j++] = cist_port_row;
             continue;
         }
 
         cist_port_row = ovsrec_mstp_common_instance_port_insert(txn);
-        if (!cist_port_row)
-        {
-            VLOG_ERR("Failed to create Transaction for Cist Port Info");
-            ovsdb_idl_txn_commit_block(txn);
-            ovsdb_idl_txn_destroy(txn);
-            if(cist_port_info)
-                free(cist_port_info);
-            return;
-        }
-        if (!bridge_row->ports[i])
-        {
-            VLOG_ERR("Failed to get Port Info for MSTP CIST Port");
-            ovsdb_idl_txn_commit_block(txn);
-            ovsdb_idl_txn_destroy(txn);
-            if(cist_port_info)
-                free(cist_port_info);
-            return;
-        }
+        inserted++;
 
         /* FILL the default values for CIST_port entry */
         ovsrec_mstp_common_instance_port_set_port( cist_port_row,
-                bridge_row->ports[i]);
-        if (intf_get_link_state(bridge_row->ports[i]) == true) {
+                bp->ports[i]);
+        if (bp->link_up[i]) {
             ovsrec_mstp_common_instance_port_set_port_state( cist_port_row,
                     MSTP_STATE_FORWARD);
         }
@@ -2918,17 +3205,14 @@ util_add_default_ports_to_cist() {
                 MSTP_ROLE_DISABLE);
         ovsrec_mstp_common_instance_port_set_admin_path_cost( cist_port_row,
                 &admin_path_cost, 1);
-        if(!VERIFY_LAG_IFNAME(bridge_row->ports[i]->name))
-        {
+        if(!VERIFY_LAG_IFNAME(bp->ports[i]->name)) {
             cist_port_priority = DEF_MSTP_LAG_PRIORITY;
-            ovsrec_mstp_common_instance_port_set_port_priority( cist_port_row,
-                    &cist_port_priority, 1);
         }
-        else
-        {
-            ovsrec_mstp_common_instance_port_set_port_priority( cist_port_row,
-                    &cist_port_priority, 1);
+        else {
+            cist_port_priority = DEF_MSTP_PORT_PRIORITY;
         }
+        ovsrec_mstp_common_instance_port_set_port_priority( cist_port_row,
+                &cist_port_priority, 1);
         ovsrec_mstp_common_instance_port_set_link_type( cist_port_row,
                 DEF_LINK_TYPE);
         ovsrec_mstp_common_instance_port_set_port_hello_time( cist_port_row,
@@ -2945,41 +3229,36 @@ util_add_default_ports_to_cist() {
         cist_port_info[j++] = cist_port_row;
     }
     ovsrec_mstp_common_instance_set_mstp_common_instance_ports (cist_row,
-                cist_port_info, cist_port_count);
-    if(cist_port_info)
-        free(cist_port_info);
-    ovsdb_idl_txn_commit_block(txn);
-    ovsdb_idl_txn_destroy(txn);
+                cist_port_info, j);
+    free(cist_port_info);
+    shash_destroy(&existing);
+
+    return inserted;
 }
 
 /**PROC+***********************************************************
  * Name:    util_mstp_instance_status_clean
  *
- * Purpose: Reset the status parameters to default for the CIST
+ * Purpose: Reset the status parameters to default for the MSTIs, in
+ *          the transaction open on the IDL
  *
- * Params:    none
+ * Params:    curr_time  -> time of the reset
+ *            system_row -> the system
+ *            bridge_row -> the bridge
  *
  * Returns:   none
  *
  **PROC-*****************************************************************/
-
-void
-util_mstp_instance_status_clean(time_t curr_time, const struct ovsrec_system *system_row) {
+static void
+util_mstp_instance_status_clean(time_t curr_time,
+                                const struct ovsrec_system *system_row,
+                                const struct ovsrec_bridge *bridge_row) {
 
     int i = 0, j = 0;
-    const struct ovsrec_bridge *bridge_row = NULL;
     const int64_t def_zero = 0;
     const struct ovsrec_mstp_instance_port *mstp_port_row = NULL;
     const struct ovsrec_mstp_instance *mstp_row = NULL;
     const bool topology_unstable = false;
-    struct ovsdb_idl_txn *txn = NULL;
-
-    txn = ovsdb_idl_txn_create(idl);
-
-    bridge_row = ovsrec_bridge_first(idl);
-    if (!bridge_row) {
-        return;
-    }
 
     for (i=0; i < bridge_row->n_mstp_instances; i++) {
         mstp_row = bridge_row->value_mstp_instances[i];
@@ -3023,22 +3302,23 @@ util_mstp_instance_status_clean(time_t curr_time, const struct ovsrec_system *sy
             ovsrec_mstp_instance_port_set_designated_port(mstp_port_row, "");
         }
     }
-    ovsdb_idl_txn_commit_block(txn);
-    ovsdb_idl_txn_destroy(txn);
 }
 
 /**PROC+***********************************************************
  * Name:    util_mstp_common_instance_status_clean
  *
- * Purpose: Reset the status parameters to default for the CIST
+ * Purpose: Reset the status parameters to default for the CIST, in
+ *          the transaction open on the IDL
  *
- * Params:    none
+ * Params:    curr_time  -> time of the reset
+ *            system_row -> the system
  *
  * Returns:   none
  *
  **PROC-*****************************************************************/
-void
-util_mstp_common_instance_status_clean(time_t curr_time, const struct ovsrec_system *system_row) {
+static void
+util_mstp_common_instance_status_clean(time_t curr_time,
+                                       const struct ovsrec_system *system_row) {
 
     const struct ovsrec_mstp_common_instance *cist_row = NULL;
     const struct ovsrec_mstp_common_instance_port *cist_port_row = NULL;
@@ -3050,13 +3330,9 @@ util_mstp_common_instance_status_clean(time_t curr_time, const struct ovsrec_sys
     const bool topology_unstable = false;
     const bool bool_false = false;
     const int64_t def_zero = 0;
-    struct ovsdb_idl_txn *txn = NULL;
-
-    txn = ovsdb_idl_txn_create(idl);
 
     cist_row = ovsrec_mstp_common_instance_first (idl);
     if (!cist_row) {
-        ovsdb_idl_txn_destroy(txn);
         return;
     }
 
@@ -3105,56 +3381,34 @@ util_mstp_common_instance_status_clean(time_t curr_time, const struct ovsrec_sys
         smap_clone(&smap, &cist_port_row->mstp_statistics);
         smap_replace(&smap, MSTP_TX_BPDU , "0");
         smap_replace(&smap, MSTP_RX_BPDU , "0");
+        smap_replace(&smap, MSTP_RX_BPDU_POLICED, "0");
         ovsrec_mstp_common_instance_port_set_mstp_statistics(cist_port_row, &smap);
+        smap_destroy(&smap);
     }
-    ovsdb_idl_txn_commit_block(txn);
-    ovsdb_idl_txn_destroy(txn);
 }
-/**PROC+***********************************************************
- * Name:    util_mstp_status_statistics_clean
- *
- * Purpose: Reset the status parameters to default at the init
- *
- * Params:    none
- *
- * Returns:   none
- *
- **PROC-*****************************************************************/
-void
-util_mstp_status_statistics_clean() {
-
-    time_t curr_time;
-    const struct ovsrec_system *system_row = NULL;
-    time(&curr_time);
-
-    system_row = ovsrec_system_first(idl);
-    if (!system_row) {
-        return;
-    }
 
-    util_mstp_instance_status_clean(curr_time, system_row);
-    util_mstp_common_instance_status_clean(curr_time, system_row);
-}
 /**PROC+***********************************************************
  * Name:    util_mstp_set_defaults
  *
- * Purpose: Add Defaults to the CIST at the time of INIT.
+ * Purpose: Add Defaults to the bridge and create the CIST at the time
+ *          of INIT.
  *
- * Params:    none
+ * Params:    txn        -> transaction to write the defaults in
+ *            bridge_row -> the bridge
+ *            system_row -> the system
  *
- * Returns:   none
+ * Returns:   the CIST row, existing or inserted
  *
  **PROC-*****************************************************************/
+static const struct ovsrec_mstp_common_instance *
+util_mstp_set_defaults(struct ovsdb_idl_txn *txn,
+                       const struct ovsrec_bridge *bridge_row,
+                       const struct ovsrec_system *system_row) {
 
-void
-util_mstp_set_defaults() {
-
-    const struct ovsrec_bridge *bridge_row = NULL;
     struct ovsrec_vlan **vlans = NULL;
     struct smap smap = SMAP_INITIALIZER(&smap);
-    struct ovsdb_idl_txn *txn = NULL;
     const struct ovsrec_mstp_common_instance *cist_row = NULL;
-    const struct ovsrec_system *system_row = NULL;
+    struct ovsrec_mstp_common_instance *new_cist_row = NULL;
     const int64_t cist_top_change_count = 0;
     time_t cist_time_since_top_change;
     const int64_t cist_priority = DEF_BRIDGE_PRIORITY;
@@ -3166,16 +3420,6 @@ util_mstp_set_defaults() {
     bool mstp_status = DEF_ADMIN_STATUS;
     int i = 0;
 
-    txn = ovsdb_idl_txn_create(idl);
-
-    bridge_row = ovsrec_bridge_first(idl);
-
-    system_row = ovsrec_system_first(idl);
-    if (!system_row) {
-        VLOG_DBG("no system record found");
-        return;
-    }
-
     time(&cist_time_since_top_change);
     smap_clone(&smap, &bridge_row->other_config);
     /* If config name is NULL, Set the system mac as config-name */
@@ -3195,62 +3439,171 @@ util_mstp_set_defaults() {
     }
     smap_destroy(&smap);
 
-
     cist_row = ovsrec_mstp_common_instance_first (idl);
-    if (!cist_row) {
+    if (cist_row) {
+        return cist_row;
+    }
+
+    /* Crate a CIST instance */
+    new_cist_row = ovsrec_mstp_common_instance_insert(txn);
+    vlans = xcalloc(bridge_row->n_vlans, sizeof *bridge_row->vlans);
+    for (i = 0; i < bridge_row->n_vlans; i++) {
+        vlans[i] = bridge_row->vlans[i];
+    }
+    ovsrec_mstp_common_instance_set_vlans(new_cist_row, vlans, bridge_row->n_vlans);
+    free(vlans);
+
+    /* updating the default values to the CIST table */
+    ovsrec_mstp_common_instance_set_hello_time(new_cist_row, &hello_time, 1);
+    ovsrec_mstp_common_instance_set_priority(new_cist_row, &cist_priority, 1);
+    ovsrec_mstp_common_instance_set_forward_delay(new_cist_row, &fwd_delay,1);
+    ovsrec_mstp_common_instance_set_max_age(new_cist_row, &max_age, 1);
+    ovsrec_mstp_common_instance_set_max_hop_count(new_cist_row, &max_hops, 1);
+    ovsrec_mstp_common_instance_set_tx_hold_count(new_cist_row, &tx_hold_cnt,1);
+    ovsrec_mstp_common_instance_set_regional_root(new_cist_row,
+            system_row->system_mac);
+    ovsrec_mstp_common_instance_set_bridge_identifier(new_cist_row,
+            system_row->system_mac);
+    ovsrec_mstp_common_instance_set_topology_change_count(new_cist_row,
+            &cist_top_change_count, 1);
+    ovsrec_mstp_common_instance_set_time_since_top_change(new_cist_row,
+            (int64_t *)&cist_time_since_top_change, 1);
+
+    /* Add the CIST instance to bridge table */
+    ovsrec_bridge_set_mstp_common_instance(bridge_row, new_cist_row);
+
+    return new_cist_row;
+}
 
-        /* Crate a CIST instance */
-        cist_row = ovsrec_mstp_common_instance_insert(txn);
-        vlans = xcalloc(bridge_row->n_vlans, sizeof *bridge_row->vlans);
-        if (!vlans) {
-            ovsdb_idl_txn_destroy(txn);
-            return;
-        }
-        for (i = 0; i < bridge_row->n_vlans; i++) {
-            vlans[i] = bridge_row->vlans[i];
-        }
-        ovsrec_mstp_common_instance_set_vlans(cist_row, vlans, bridge_row->n_vlans);
-
-        /* updating the default values to the CIST table */
-        ovsrec_mstp_common_instance_set_hello_time(cist_row, &hello_time, 1);
-        ovsrec_mstp_common_instance_set_priority(cist_row, &cist_priority, 1);
-        ovsrec_mstp_common_instance_set_forward_delay(cist_row, &fwd_delay,1);
-        ovsrec_mstp_common_instance_set_max_age(cist_row, &max_age, 1);
-        ovsrec_mstp_common_instance_set_max_hop_count(cist_row, &max_hops, 1);
-        ovsrec_mstp_common_instance_set_tx_hold_count(cist_row, &tx_hold_cnt,1);
-        ovsrec_mstp_common_instance_set_regional_root(cist_row,
-                system_row->system_mac);
-        ovsrec_mstp_common_instance_set_bridge_identifier(cist_row,
-                system_row->system_mac);
-        ovsrec_mstp_common_instance_set_topology_change_count(cist_row,
-                &cist_top_change_count, 1);
-        ovsrec_mstp_common_instance_set_time_since_top_change(cist_row,
-                (int64_t *)&cist_time_since_top_change, 1);
-
-        /* Add the CIST instance to bridge table */
-        ovsrec_bridge_set_mstp_common_instance(bridge_row, cist_row);
+/* Commit 'txn' and time it, counting the transactions of the bootstrap */
+static void
+util_mstp_bootstrap_commit(struct ovsdb_idl_txn *txn, uint64_t *usec,
+                           int *n_txns) {
+    uint64_t start = mstp_utilMonoUsec();
+    enum ovsdb_idl_txn_status status;
+
+    status = ovsdb_idl_txn_commit_block(txn);
+    if (status != TXN_SUCCESS && status != TXN_UNCHANGED) {
+        VLOG_ERR("MSTP bootstrap transaction failed: %s",
+                 ovsdb_idl_txn_status_to_string(status));
     }
-    ovsdb_idl_txn_commit_block(txn);
     ovsdb_idl_txn_destroy(txn);
-    if (vlans)
-    {
-        free(vlans);
+    *usec += mstp_utilMonoUsec() - start;
+    (*n_txns)++;
+}
+
+/**PROC+***********************************************************
+ * Name:    util_mstp_bootstrap
+ *
+ * Purpose: Write the default MSTP state to DB at the time of INIT:
+ *          reset the status left by the previous run (not on a warm
+ *          start), set the bridge defaults, create the CIST and the
+ *          CIST and MSTI rows of every L2 port. The rows are built in
+ *          one transaction, split before an MSTI once
+ *          'MSTP_BOOTSTRAP_TXN_ROWS' rows were inserted. An MSTI is
+ *          never split, as the rows it references must be inserted
+ *          with it. The time of each phase goes to the log.
+ *          NOTE: the caller holds MSTP_OVSDB_LOCK.
+ *
+ * Params:    none
+ *
+ * Returns:   none
+ *
+ **PROC-*****************************************************************/
+void
+util_mstp_bootstrap(void) {
+
+    const struct ovsrec_bridge *bridge_row = NULL;
+    const struct ovsrec_system *system_row = NULL;
+    const struct ovsrec_mstp_common_instance *cist_row = NULL;
+    const struct ovsrec_mstp_instance *mstp_row = NULL;
+    struct mstp_bootstrap_ports bp;
+    struct ovsdb_idl_txn *txn = NULL;
+    uint64_t start, phase, total_usec;
+    uint64_t clean_usec = 0, cist_usec = 0, msti_usec = 0, commit_usec = 0;
+    size_t rows = 0, txn_rows = 0, n;
+    time_t curr_time;
+    int n_txns = 0;
+    int i;
+
+    start = mstp_utilMonoUsec();
+
+    bridge_row = ovsrec_bridge_first(idl);
+    if (!bridge_row) {
+        VLOG_DBG("no bridge record found");
+        return;
     }
-    return;
+    system_row = ovsrec_system_first(idl);
+    if (!system_row) {
+        VLOG_DBG("no system record found");
+        return;
+    }
+
+    util_get_bootstrap_ports(bridge_row, &bp);
+    txn = ovsdb_idl_txn_create(idl);
+
+    if (!mstp_ckptWarmStart()) {
+        phase = mstp_utilMonoUsec();
+        time(&curr_time);
+        util_mstp_instance_status_clean(curr_time, system_row, bridge_row);
+        util_mstp_common_instance_status_clean(curr_time, system_row);
+        clean_usec = mstp_utilMonoUsec() - phase;
+    }
+
+    phase = mstp_utilMonoUsec();
+    cist_row = util_mstp_set_defaults(txn, bridge_row, system_row);
+    txn_rows = util_add_default_ports_to_cist(txn, cist_row, &bp);
+    rows = txn_rows;
+    cist_usec = mstp_utilMonoUsec() - phase;
+
+    for (i = 0; i < bridge_row->n_mstp_instances; i++) {
+        mstp_row = bridge_row->value_mstp_instances[i];
+        if (!mstp_row) {
+            assert(0);
+            continue;
+        }
+        if (txn_rows >= MSTP_BOOTSTRAP_TXN_ROWS) {
+            util_mstp_bootstrap_commit(txn, &commit_usec, &n_txns);
+            txn = ovsdb_idl_txn_create(idl);
+            txn_rows = 0;
+        }
+        phase = mstp_utilMonoUsec();
+        n = util_add_default_ports_to_mist(txn, mstp_row, &bp);
+        msti_usec += mstp_utilMonoUsec() - phase;
+        txn_rows += n;
+        rows += n;
+    }
+    util_mstp_bootstrap_commit(txn, &commit_usec, &n_txns);
+    total_usec = mstp_utilMonoUsec() - start;
+
+    VLOG_INFO("MSTP bootstrap: %"PRIuSIZE" ports, %"PRIuSIZE" MSTIs, "
+              "%"PRIuSIZE" rows inserted in %d transaction(s); "
+              "clean %"PRIu64".%03"PRIu64" ms, cist %"PRIu64".%03"PRIu64" ms, "
+              "msti %"PRIu64".%03"PRIu64" ms, commit %"PRIu64".%03"PRIu64" ms, "
+              "total %"PRIu64".%03"PRIu64" ms",
+              bp.n, bridge_row->n_mstp_instances, rows, n_txns,
+              clean_usec / 1000, clean_usec % 1000,
+              cist_usec / 1000, cist_usec % 1000,
+              msti_usec / 1000, msti_usec % 1000,
+              commit_usec / 1000, commit_usec % 1000,
+              total_usec / 1000, total_usec % 1000);
+
+    util_free_bootstrap_ports(&bp);
 }
 /**PROC+***********************************************************
- * Name:    mstp_util_set_cist_port_table_bool
+ * Name:    mstp_util_write_cist_port_table_bool
  *
  * Purpose: Sets a boolean value into CIST port Table
+ *          Caller holds MSTP_OVSDB_LOCK and owns the transaction.
  *
  * Params:    none
  *
- * Returns:   none
+ * Returns:   false if the row was not found
  *
  **PROC-*****************************************************************/
 
-void
-mstp_util_set_cist_port_table_bool (const char *if_name, const char *field,
+bool
+mstp_util_write_cist_port_table_bool (const char *if_name, const char *field,
         const bool value) {
     const struct ovsrec_mstp_common_instance_port *cist_port_row = NULL;
     char *column = NULL;
@@ -3265,7 +3618,7 @@ mstp_util_set_cist_port_table_bool (const char *if_name, const char *field,
     }
 
     if (!cist_port_row) {
-        return;
+        return false;
     }
 
     column = MSTP_OPER_EDGE;
@@ -3273,27 +3626,29 @@ mstp_util_set_cist_port_table_bool (const char *if_name, const char *field,
         ovsrec_mstp_common_instance_port_set_oper_edge_port(
                 cist_port_row, &value, 1);
     }
+    return true;
 }
 
 /**PROC+***********************************************************
- * Name:    mstp_util_set_cist_table_value
+ * Name:    mstp_util_write_cist_table_value
  *
  * Purpose: Sets a integer value into CIST port Table
+ *          Caller holds MSTP_OVSDB_LOCK and owns the transaction.
  *
  * Params:    none
  *
- * Returns:   none
+ * Returns:   false if the row was not found
  *
  **PROC-*****************************************************************/
 
-void
-mstp_util_set_cist_table_value (const char *key, int64_t value) {
+bool
+mstp_util_write_cist_table_value (const char *key, int64_t value) {
     const struct ovsrec_mstp_common_instance *cist_row = NULL;
     int index ;
 
     cist_row = ovsrec_mstp_common_instance_first (idl);
     if (!cist_row) {
-        return;
+        return false;
     }
 
     for (index = 0; index < sizeof(cist_value)/sizeof(cist_value[0]); index++) {
@@ -3301,26 +3656,28 @@ mstp_util_set_cist_table_value (const char *key, int64_t value) {
            cist_value[index].ovsrec_func(cist_row, &value, 1);
        }
     }
+    return true;
 }
 
 /**PROC+***********************************************************
- * Name:    mstp_util_set_cist_table_string
+ * Name:    mstp_util_write_cist_table_string
  *
  * Purpose: Sets a string into CIST port Table
+ *          Caller holds MSTP_OVSDB_LOCK and owns the transaction.
  *
  * Params:    none
  *
- * Returns:   none
+ * Returns:   false if the row was not found
  *
  **PROC-*****************************************************************/
-void
-mstp_util_set_cist_table_string (const char *key, const char *string) {
+bool
+mstp_util_write_cist_table_string (const char *key, const char *string) {
     const struct ovsrec_mstp_common_instance *cist_row = NULL;
     int index ;
 
     cist_row = ovsrec_mstp_common_instance_first (idl);
     if (!cist_row) {
-        return;
+        return false;
     }
 
     for (index = 0; index < sizeof(cist_string)/sizeof(cist_string[0]); index++) {
@@ -3328,19 +3685,21 @@ mstp_util_set_cist_table_string (const char *key, const char *string) {
            cist_string[index].ovsrec_func(cist_row, string);
        }
     }
+    return true;
 }
 /**PROC+***********************************************************
- * Name:    mstp_util_set_cist_port_table_value
+ * Name:    mstp_util_write_cist_port_table_value
  *
  * Purpose: Sets a integer value into CIST port Table
+ *          Caller holds MSTP_OVSDB_LOCK and owns the transaction.
  *
  * Params:    none
  *
- * Returns:   none
+ * Returns:   false if the row was not found
  *
  **PROC-*****************************************************************/
-void
-mstp_util_set_cist_port_table_value (const char *if_name, const char *key,
+bool
+mstp_util_write_cist_port_table_value (const char *if_name, const char *key,
         int64_t value) {
     const struct ovsrec_mstp_common_instance_port *cist_port_row = NULL;
     int index;
@@ -3355,7 +3714,7 @@ mstp_util_set_cist_port_table_value (const char *if_name, const char *key,
     }
 
     if (!cist_port_row) {
-        return;
+        return false;
     }
 
     for (index = 0; index < sizeof(cist_port_value)/sizeof(cist_port_value[0]); index++) {
@@ -3363,20 +3722,22 @@ mstp_util_set_cist_port_table_value (const char *if_name, const char *key,
            cist_port_value[index].ovsrec_func(cist_port_row, &value, 1);
        }
     }
+    return true;
 }
 /**PROC+***********************************************************
- * Name:    mstp_util_set_cist_port_table_string
+ * Name:    mstp_util_write_cist_port_table_string
  *
  * Purpose: Sets a string into CIST port Table
+ *          Caller holds MSTP_OVSDB_LOCK and owns the transaction.
  *
  * Params:    none
  *
- * Returns:   none
+ * Returns:   false if the row was not found
  *
  **PROC-*****************************************************************/
-void
-mstp_util_set_cist_port_table_string (const char *if_name, const char *key,
-        char *string) {
+bool
+mstp_util_write_cist_port_table_string (const char *if_name, const char *key,
+        const char *string) {
     const struct ovsrec_mstp_common_instance_port *cist_port_row = NULL;
     int index;
 
@@ -3390,7 +3751,7 @@ mstp_util_set_cist_port_table_string (const char *if_name, const char *key,
     }
 
     if (!cist_port_row) {
-         return;
+         return false;
     }
 
     for (index = 0; index < sizeof(cist_port_string)/sizeof(cist_port_string[0]); index++) {
@@ -3398,21 +3759,23 @@ mstp_util_set_cist_port_table_string (const char *if_name, const char *key,
            cist_port_string[index].ovsrec_func(cist_port_row, string);
        }
     }
+    return true;
 }
 
 /**PROC+***********************************************************
- * Name:    mstp_util_set_msti_table_string
+ * Name:    mstp_util_write_msti_table_string
  *
  * Purpose: Sets a string into MSTI Table
+ *          Caller holds MSTP_OVSDB_LOCK and owns the transaction.
  *
  * Params:    none
  *
- * Returns:   none
+ * Returns:   false if the row was not found
  *
  **PROC-*****************************************************************/
 
-void
-mstp_util_set_msti_table_string (const char *key, const char *string, int mstid) {
+bool
+mstp_util_write_msti_table_string (const char *key, const char *string, int mstid) {
     const struct ovsrec_mstp_instance *msti_row = NULL;
     const struct ovsrec_bridge *bridge_row = NULL;
     int  i = 0;
@@ -3428,7 +3791,7 @@ mstp_util_set_msti_table_string (const char *key, const char *string, int mstid)
     }
 
     if (!msti_row) {
-         return;
+         return false;
     }
 
     if (strcmp(key, TOPOLOGY_CHANGE) == 0) {
@@ -3441,20 +3804,22 @@ mstp_util_set_msti_table_string (const char *key, const char *string, int mstid)
            }
        }
     }
+    return true;
 }
 /**PROC+***********************************************************
- * Name:    mstp_util_set_msti_table_value
+ * Name:    mstp_util_write_msti_table_value
  *
  * Purpose: Sets a value into MSTI Table
+ *          Caller holds MSTP_OVSDB_LOCK and owns the transaction.
  *
  * Params:    none
  *
- * Returns:   none
+ * Returns:   false if the row was not found
  *
  **PROC-*****************************************************************/
 
-void
-mstp_util_set_msti_table_value (const char *key, int64_t value, int mstid) {
+bool
+mstp_util_write_msti_table_value (const char *key, int64_t value, int mstid) {
     const struct ovsrec_mstp_instance *msti_row = NULL;
     const struct ovsrec_bridge *bridge_row = NULL;
     int  i = 0;
@@ -3470,7 +3835,7 @@ mstp_util_set_msti_table_value (const char *key, int64_t value, int mstid) {
     }
 
     if (!msti_row) {
-         return;
+         return false;
     }
 
     for (i = 0; i < sizeof(msti_value)/sizeof(msti_value[0]); i++) {
@@ -3478,20 +3843,22 @@ mstp_util_set_msti_table_value (const char *key, int64_t value, int mstid) {
            msti_value[i].ovsrec_func(msti_row, &value, 1);
        }
     }
+    return true;
 }
 
 /**PROC+***********************************************************
- * Name:    mstp_util_set_msti_port_table_value
+ * Name:    mstp_util_write_msti_port_table_value
  *
  * Purpose: Sets a value into MSTI Port Table
+ *          Caller holds MSTP_OVSDB_LOCK and owns the transaction.
  *
  * Params:    none
  *
- * Returns:   none
+ * Returns:   false if the row was not found
  *
  **PROC-*****************************************************************/
-void
-mstp_util_set_msti_port_table_value (const char *key, int64_t value, int mstid, int lport) {
+bool
+mstp_util_write_msti_port_table_value (const char *key, int64_t value, int mstid, int lport) {
     const struct ovsrec_mstp_instance *msti_row = NULL;
     const struct ovsrec_bridge *bridge_row = NULL;
     const struct ovsrec_mstp_instance_port *msti_port_row = NULL;
@@ -3512,7 +3879,7 @@ mstp_util_set_msti_port_table_value (const char *key, int64_t value, int mstid,
                 idp = find_iface_data_by_name(msti_row->mstp_instance_ports[j]->port->name);
                 if(!idp)
                 {
-                    return;
+                    return false;
                 }
                 if(lport == idp->lport_id) {
                     msti_port_row = msti_row->mstp_instance_ports[j];
@@ -3523,7 +3890,7 @@ mstp_util_set_msti_port_table_value (const char *key, int64_t value, int mstid,
     }
 
     if (!msti_port_row) {
-         return;
+         return false;
     }
 
     for (i = 0; i < sizeof(msti_port_value)/sizeof(msti_port_value[0]); i++) {
@@ -3531,19 +3898,21 @@ mstp_util_set_msti_port_table_value (const char *key, int64_t value, int mstid,
            msti_port_value[i].ovsrec_func(msti_port_row, &value, 1);
        }
     }
+    return true;
 }
 /**PROC+***********************************************************
- * Name:    mstp_util_set_msti_port_table_string
+ * Name:    mstp_util_write_msti_port_table_string
  *
  * Purpose: Sets a string into MSTI Port Table
+ *          Caller holds MSTP_OVSDB_LOCK and owns the transaction.
  *
  * Params:    none
  *
- * Returns:   none
+ * Returns:   false if the row was not found
  *
  **PROC-*****************************************************************/
-void
-mstp_util_set_msti_port_table_string (const char *key, char *string, int mstid, int lport) {
+bool
+mstp_util_write_msti_port_table_string (const char *key, const char *string, int mstid, int lport) {
     const struct ovsrec_mstp_instance *msti_row = NULL;
     const struct ovsrec_bridge *bridge_row = NULL;
     const struct ovsrec_mstp_instance_port *msti_port_row = NULL;
@@ -3564,7 +3933,7 @@ mstp_util_set_msti_port_table_string (const char *key, char *string, int mstid,
                 idp = find_iface_data_by_name(msti_row->mstp_instance_ports[j]->port->name);
                 if(!idp)
                 {
-                    return;
+                    return false;
                 }
                 if(lport == idp->lport_id) {
                     msti_port_row = msti_row->mstp_instance_ports[j];
@@ -3575,7 +3944,7 @@ mstp_util_set_msti_port_table_string (const char *key, char *string, int mstid,
     }
 
     if (!msti_port_row) {
-         return;
+         return false;
     }
 
     for (i = 0; i < sizeof(msti_port_string)/sizeof(msti_port_string[0]); i++) {
@@ -3583,6 +3952,34 @@ mstp_util_set_msti_port_table_string (const char *key, char *string, int mstid,
            msti_port_string[i].ovsrec_func(msti_port_row, string);
        }
     }
+    return true;
+}
+/**PROC+***********************************************************
+ * Name:    mstp_util_write_bridge_status
+ *
+ * Purpose: Sets a key of the Bridge 'status' column.
+ *          Caller holds MSTP_OVSDB_LOCK and owns the transaction.
+ *
+ * Params:    key, string : key and its value
+ *
+ * Returns:   false if the row was not found
+ *
+ **PROC-*****************************************************************/
+bool
+mstp_util_write_bridge_status (const char *key, const char *string) {
+    const struct ovsrec_bridge *bridge_row = NULL;
+    struct smap smap;
+
+    bridge_row = ovsrec_bridge_first(idl);
+    if (!bridge_row) {
+        return false;
+    }
+
+    smap_clone(&smap, &bridge_row->status);
+    smap_replace(&smap, key, string);
+    ovsrec_bridge_set_status(bridge_row, &smap);
+    smap_destroy(&smap);
+    return true;
 }
 /**PROC+***********************************************************
  * Name:    mstp_convertPortRoleEnumToString
@@ -3619,159 +4016,131 @@ void mstp_convertPortRoleEnumToString(MSTP_PORT_ROLE_t role,char *string)
 /**PROC+***********************************************************
  * Name:    handle_vlan_add_in_mstp_config
  *
- * Purpose: Update DB on a VLAN ADD to the Bridge
+ * Purpose: Update DB on a VLAN ADD to the Bridge: the VLANs of 'vids'
+ *          that are neither in the CIST nor in an MSTI are added to the
+ *          CIST, all of them in one transaction.
  *
- * Params:    none
+ * Params:    vids -> VLANs created
  *
  * Returns:   none
  *
  **PROC-*****************************************************************/
 
-void handle_vlan_add_in_mstp_config(int vlan)
+void handle_vlan_add_in_mstp_config(const VID_MAP *vids)
 {
     struct ovsdb_idl_txn *txn = NULL;
     const struct ovsrec_mstp_common_instance *cist_row = NULL;
+    const struct ovsrec_mstp_instance *msti_row = NULL;
     const struct ovsrec_vlan *vlan_row = NULL;
     struct ovsrec_vlan **vlans = NULL;
-    int i = 0, vid = 0;
-    const struct ovsrec_mstp_instance *msti_row = NULL;
-    bool vlan_found = FALSE;
-    bool cist_vlan_found = FALSE;
-    bool msti_vlan_found = FALSE;
+    VID_MAP add;
+    size_t n_vlans = 0;
+    int i = 0;
 
     MSTP_OVSDB_LOCK;
-    txn = ovsdb_idl_txn_create(idl);
-    if (vlan) {
-        OVSREC_VLAN_FOR_EACH(vlan_row, idl) {
-            if (vlan == vlan_row->id) {
-                vlan_found = TRUE;
-                break;
-            }
-        }
-        if (!vlan_found) {
-            ovsdb_idl_txn_commit_block(txn);
-            ovsdb_idl_txn_destroy(txn);
-            MSTP_OVSDB_UNLOCK;
-            return;
-        }
+    cist_row = ovsrec_mstp_common_instance_first(idl);
+    if (!cist_row) {
+        MSTP_OVSDB_UNLOCK;
+        return;
     }
 
+    /* A VLAN already mapped to an instance stays where it is. */
+    copy_vid_map(vids, &add);
+    for (i = 0; i < cist_row->n_vlans; i++) {
+        clear_vid(&add, cist_row->vlans[i]->id);
+    }
     OVSREC_MSTP_INSTANCE_FOR_EACH(msti_row, idl) {
-        for(vid = 0; vid < msti_row->n_vlans; vid++)
-        {
-            if (vlan == msti_row->vlans[vid]->id)
-            {
-                msti_vlan_found = TRUE;
-            }
+        for (i = 0; i < msti_row->n_vlans; i++) {
+            clear_vid(&add, msti_row->vlans[i]->id);
         }
     }
-    cist_row = ovsrec_mstp_common_instance_first(idl);
-    if (cist_row)
-    {
-        for(vid = 0; vid < cist_row->n_vlans; vid++)
-        {
-            if (vlan == cist_row->vlans[vid]->id)
-            {
-                cist_vlan_found = TRUE;
-            }
-        }
+    if (!are_any_vids_set(&add)) {
+        MSTP_OVSDB_UNLOCK;
+        return;
     }
-    if (!cist_vlan_found && !msti_vlan_found)
-    {
-        /* MSTP instance not found with the incoming instID */
-        if(cist_row) {
-            /* Push the complete vlan list to MSTP instance table
-             * including the new vlan*/
-            vlans =
-                xcalloc(cist_row->n_vlans + 1, sizeof *cist_row->vlans);
-            if (!vlans) {
-                ovsdb_idl_txn_commit_block(txn);
-                ovsdb_idl_txn_destroy(txn);
-            }
-            for (i = 0; i < cist_row->n_vlans; i++) {
-                vlans[i] = cist_row->vlans[i];
-            }
-            vlans[cist_row->n_vlans] = (struct ovsrec_vlan *)vlan_row;
-            ovsrec_mstp_common_instance_set_vlans(cist_row, vlans,
-                    cist_row->n_vlans + 1);
+
+    /* Push the complete vlan list to MSTP common instance table
+     * including the new vlans */
+    vlans = xcalloc(cist_row->n_vlans + count_vids(&add), sizeof *vlans);
+    for (i = 0; i < cist_row->n_vlans; i++) {
+        vlans[n_vlans++] = cist_row->vlans[i];
+    }
+    OVSREC_VLAN_FOR_EACH(vlan_row, idl) {
+        if (is_vid_set(&add, vlan_row->id)) {
+            clear_vid(&add, vlan_row->id);
+            vlans[n_vlans++] = (struct ovsrec_vlan *)vlan_row;
         }
     }
-    ovsdb_idl_txn_commit_block(txn);
-    ovsdb_idl_txn_destroy(txn);
-    if (vlans)
-    {
-        free(vlans);
+    if (n_vlans != cist_row->n_vlans) {
+        VLOG_DBG("Adding %u VLANs to the CIST",
+                 (unsigned)(n_vlans - cist_row->n_vlans));
+        txn = ovsdb_idl_txn_create(idl);
+        ovsrec_mstp_common_instance_set_vlans(cist_row, vlans, n_vlans);
+        ovsdb_idl_txn_commit_block(txn);
+        ovsdb_idl_txn_destroy(txn);
     }
+    free(vlans);
     MSTP_OVSDB_UNLOCK;
 }
 /**PROC+***********************************************************
  * Name:    handle_vlan_delete_in_mstp_config
  *
- * Purpose: Update DB on a VLAN Delete to the Bridge
+ * Purpose: Update DB on a VLAN Delete to the Bridge: the VLANs of 'vids'
+ *          are removed from the CIST and the MSTIs in one transaction.
  *
- * Params:    none
+ * Params:    vids -> VLANs deleted
  *
  * Returns:   none
  *
  **PROC-*****************************************************************/
 
-void handle_vlan_delete_in_mstp_config(int vlan)
+void handle_vlan_delete_in_mstp_config(const VID_MAP *vids)
 {
     struct ovsdb_idl_txn *txn = NULL;
     const struct ovsrec_mstp_common_instance *cist_row = NULL;
     const struct ovsrec_mstp_instance *msti_row = NULL;
     struct ovsrec_vlan **vlans = NULL;
-    int i = 0,j = 0;
+    size_t n_vlans = 0;
+    int i = 0;
+
     MSTP_OVSDB_LOCK;
     cist_row = ovsrec_mstp_common_instance_first(idl);
-    if(cist_row) {
-        /* Push the complete vlan list to MSTP Common instance table
-         * including the new vlan*/
-        if (cist_row->n_vlans) {
-            txn = ovsdb_idl_txn_create(idl);
-            vlans =
-                xcalloc(cist_row->n_vlans - 1, sizeof *cist_row->vlans);
-            if (!vlans) {
-                ovsdb_idl_txn_commit_block(txn);
-                ovsdb_idl_txn_destroy(txn);
+    if (cist_row && cist_row->n_vlans) {
+        vlans = xcalloc(cist_row->n_vlans, sizeof *vlans);
+        for (n_vlans = 0, i = 0; i < cist_row->n_vlans; i++) {
+            if (!is_vid_set(vids, cist_row->vlans[i]->id)) {
+                vlans[n_vlans++] = cist_row->vlans[i];
             }
-            for (j=0, i = 0; i < cist_row->n_vlans; i++) {
-                if(vlan != cist_row->vlans[i]->id) {
-                    vlans[j++] = cist_row->vlans[i];
-                }
+        }
+        if (n_vlans != cist_row->n_vlans) {
+            if (!txn) {
+                txn = ovsdb_idl_txn_create(idl);
             }
-            ovsrec_mstp_common_instance_set_vlans(cist_row, vlans,
-                    cist_row->n_vlans - 1);
-            ovsdb_idl_txn_commit_block(txn);
-            ovsdb_idl_txn_destroy(txn);
-            free(vlans);
+            ovsrec_mstp_common_instance_set_vlans(cist_row, vlans, n_vlans);
         }
+        free(vlans);
     }
-    OVSREC_MSTP_INSTANCE_FOR_EACH(msti_row,idl) {
-        if(msti_row) {
-            /* Push the complete vlan list to MSTP instance table
-             * including the new vlan*/
-            if (msti_row->n_vlans) {
+    OVSREC_MSTP_INSTANCE_FOR_EACH(msti_row, idl) {
+        if (!msti_row->n_vlans) {
+            continue;
+        }
+        vlans = xcalloc(msti_row->n_vlans, sizeof *vlans);
+        for (n_vlans = 0, i = 0; i < msti_row->n_vlans; i++) {
+            if (!is_vid_set(vids, msti_row->vlans[i]->id)) {
+                vlans[n_vlans++] = msti_row->vlans[i];
+            }
+        }
+        if (n_vlans != msti_row->n_vlans) {
+            if (!txn) {
                 txn = ovsdb_idl_txn_create(idl);
-                vlans =
-                    xcalloc(msti_row->n_vlans - 1, sizeof *msti_row->vlans);
-                if (!vlans) {
-                    ovsdb_idl_txn_commit_block(txn);
-                    ovsdb_idl_txn_destroy(txn);
-                }
-                for (j=0, i = 0; i < msti_row->n_vlans; i++) {
-                    if(vlan != msti_row->vlans[i]->id) {
-                        vlans[j++] = msti_row->vlans[i];
-                    }
-                }
-                ovsrec_mstp_instance_set_vlans(msti_row, vlans,
-                        msti_row->n_vlans - 1);
-                ovsdb_idl_txn_commit_block(txn);
-                ovsdb_idl_txn_destroy(txn);
-                free(vlans);
             }
+            ovsrec_mstp_instance_set_vlans(msti_row, vlans, n_vlans);
         }
-
+        free(vlans);
+    }
+    if (txn) {
+        ovsdb_idl_txn_commit_block(txn);
+        ovsdb_idl_txn_destroy(txn);
     }
     MSTP_OVSDB_UNLOCK;
 }
@@ -4133,57 +4502,11 @@ void update_port_entry_in_msti_mstp_instances(char *name,int operation) {
     ovsdb_idl_txn_destroy(txn);
     MSTP_OVSDB_UNLOCK;
 }
-/**PROC+***********************************************************
- * Name:    is_lport_down
- *
- * Purpose:  to check if a lport link state is down
- *
- * Params:    none
- *
- * Returns:   TRUE/FALSE
- *
- **PROC-*****************************************************************/
-bool is_lport_down(int lport)
-{
-    struct iface_data *idp = NULL;
-    idp = find_iface_data_by_index(lport);
-    if (idp->link_state == INTERFACE_LINK_STATE_UP)
-    {
-        return FALSE;
-    }
-    else
-    {
-        return TRUE;
-    }
-}
-/**PROC+***********************************************************
- * Name:    is_lport_up
- *
- * Purpose:  to check if a lport link state is up
- *
- * Params:    none
- *
- * Returns:   TRUE/FALSE
- *
- **PROC-*****************************************************************/
-
-bool is_lport_up(int lport)
-{
-    struct iface_data *idp = NULL;
-    idp = find_iface_data_by_index(lport);
-    if (idp->link_state == INTERFACE_LINK_STATE_DOWN)
-    {
-        return FALSE;
-    }
-    else
-    {
-        return TRUE;
-    }
-}
 /**PROC+***********************************************************
  * Name:    disable_logical_port
  *
- * Purpose:  to set a port row to admin status to down.
+ * Purpose:  to set a port row to admin status to down. Called by the
+ *           protocol thread, the row is written by the OVSDB thread.
  *
  * Params:    none
  *
@@ -4193,27 +4516,13 @@ bool is_lport_up(int lport)
 
 void disable_logical_port(int lport)
 {
-    struct ovsdb_idl_txn *txn = NULL;
-    struct iface_data *idp = NULL;
-    const struct ovsrec_port *port_row = NULL;
-    txn = ovsdb_idl_txn_create(idl);
-    idp = find_iface_data_by_index(lport);
-    MSTP_OVSDB_LOCK;
-    OVSREC_PORT_FOR_EACH(port_row,idl)
-    {
-        if(strcmp(port_row->name,idp->name)==0)
-        {
-            ovsrec_port_set_admin(port_row,"down");
-        }
-    }
-    ovsdb_idl_txn_commit_block(txn);
-    ovsdb_idl_txn_destroy(txn);
-    MSTP_OVSDB_UNLOCK;
+    mstp_dbOutboxPostJob(MSTP_DB_JOB_PORT_DISABLE, lport, NULL);
 }
 /**PROC+***********************************************************
  * Name:   enable_logical_port
  *
- * Purpose:  to set a port row to admin status to up.
+ * Purpose:  to set a port row to admin status to up. Called by the
+ *           protocol thread, the row is written by the OVSDB thread.
  *
  * Params:    none
  *
@@ -4223,28 +4532,14 @@ void disable_logical_port(int lport)
 
 void enable_logical_port(int lport)
 {
-    struct ovsdb_idl_txn *txn = NULL;
-    struct iface_data *idp = NULL;
-    const struct ovsrec_port *port_row = NULL;
-    txn = ovsdb_idl_txn_create(idl);
-    idp = find_iface_data_by_index(lport);
-    MSTP_OVSDB_LOCK;
-    OVSREC_PORT_FOR_EACH(port_row,idl)
-    {
-        if(strcmp(port_row->name,idp->name)==0)
-        {
-            ovsrec_port_set_admin(port_row,"up");
-        }
-    }
-    ovsdb_idl_txn_commit_block(txn);
-    ovsdb_idl_txn_destroy(txn);
-    MSTP_OVSDB_UNLOCK;
+    mstp_dbOutboxPostJob(MSTP_DB_JOB_PORT_ENABLE, lport, NULL);
 }
 
 /**PROC+***********************************************************
  * Name:    enable_or_disable_port
  *
  * Purpose:  to set a port row to admin status to up or down.
+ *           Runs on the OVSDB thread.
  *
  * Params:    lport - port to be enabled / disabled
  *            enable - operation to be performed
@@ -4257,9 +4552,13 @@ void enable_or_disable_port(int lport,bool enable)
     struct ovsdb_idl_txn *txn = NULL;
     struct iface_data *idp = NULL;
     const struct ovsrec_port *port_row = NULL;
-    txn = ovsdb_idl_txn_create(idl);
-    idp = find_iface_data_by_index(lport);
     MSTP_OVSDB_LOCK;
+    idp = find_iface_data_by_index(lport);
+    if (idp == NULL) {
+        MSTP_OVSDB_UNLOCK;
+        return;
+    }
+    txn = ovsdb_idl_txn_create(idl);
     OVSREC_PORT_FOR_EACH(port_row,idl)
     {
         if(strcmp(port_row->name,idp->name)==0)
@@ -4275,109 +4574,228 @@ void enable_or_disable_port(int lport,bool enable)
     MSTP_OVSDB_UNLOCK;
 }
 
-/**PROC+***********************************************************
- * Name:    mstp_util_msti_flush_mac_address
+/**PROC+**********************************************************************
+ * Name:      mstp_updatePortStateToForward
  *
- * Purpose:  trigger mac address flush on on all the corresponding vlans
- *           for the msti port
+ * Purpose:   To put all the L2 Ports into Forwarding State.
+ *            Runs on the OVSDB thread (MSTP_DB_JOB_ALL_FORWARD).
  *
- * Params:    mstid - instance id
- *            lport - port on which macs have to be flushed
+ * Params:    none
  *
  * Returns:   none
  *
- **PROC-*****************************************************************/
-void mstp_util_msti_flush_mac_address(int mstid, int lport)
+ * Globals:   none
+ *
+ * Constraints:
+ **PROC-**********************************************************************/
+void mstp_updatePortStateToForward(void)
 {
-    const struct ovsrec_mstp_instance *msti_row = NULL;
+    struct ovsdb_idl_txn *txn = NULL;
     const struct ovsrec_bridge *bridge_row = NULL;
-    const struct ovsrec_mstp_instance_port *msti_port_row = NULL;
-    struct iface_data *idp = NULL;
-    bool flush_status = true;
-    int  i = 0, j = 0;
-
+    const struct ovsrec_mstp_common_instance_port *cist_port_row = NULL;
+    const struct ovsrec_mstp_instance *mstp_row = NULL;
+    const struct ovsrec_mstp_instance_port *mstp_port_row = NULL;
+    int mstid = 0, port_id = 0;
+    MSTP_OVSDB_LOCK;
     bridge_row = ovsrec_bridge_first(idl);
-    for (i = 0; i < bridge_row->n_mstp_instances; i++)
+    if (!bridge_row) {
+        MSTP_OVSDB_UNLOCK;
+        return;
+    }
+    txn = ovsdb_idl_txn_create(idl);
+    OVSREC_MSTP_COMMON_INSTANCE_PORT_FOR_EACH(cist_port_row, idl)
     {
-        int id = bridge_row->key_mstp_instances[i];
-        if (id == mstid) {
-            msti_row =  bridge_row->value_mstp_instances[i];
-            if (!msti_row) {
-                break;
-            }
+        ovsrec_mstp_common_instance_port_set_port_state(cist_port_row,MSTP_STATE_FORWARD);
+    }
+    for (mstid=0; mstid < bridge_row->n_mstp_instances; mstid++) {
+        mstp_row = bridge_row->value_mstp_instances[mstid];
+        if(!mstp_row) {
+            assert(0);
+            ovsdb_idl_txn_destroy(txn);
+            MSTP_OVSDB_UNLOCK;
 
-            for (j = 0; j < msti_row->n_mstp_instance_ports; j++)
-            {
-                if(!msti_row->mstp_instance_ports[j]->port)
-                {
-                    continue;
-                }
-                idp = find_iface_data_by_name(msti_row->mstp_instance_ports[j]->port->name);
-                if(!idp)
-                {
-                    return;
-                }
-                if(lport == idp->lport_id) {
-                    msti_port_row = msti_row->mstp_instance_ports[j];
-                    break;
-                }
+            return;
+        }
+
+        /* MSTP instance port clean */
+        for (port_id=0; port_id < mstp_row->n_mstp_instance_ports; port_id++) {
+            mstp_port_row = mstp_row->mstp_instance_ports[port_id];
+            if(!mstp_port_row) {
+                assert(0);
+                ovsdb_idl_txn_destroy(txn);
+                MSTP_OVSDB_UNLOCK;
+                return;
             }
+            ovsrec_mstp_instance_port_set_port_state( mstp_port_row, MSTP_STATE_FORWARD);
         }
     }
+    ovsdb_idl_txn_commit_block(txn);
+    ovsdb_idl_txn_destroy(txn);
+    MSTP_OVSDB_UNLOCK;
+    return;
+}
 
-    if (!msti_row || !msti_port_row)
-    {
-        VLOG_DBG("%s: Finding instance or instance_port failed", __FUNCTION__);
-        return;
+/**PROC+***********************************************************
+ * Name:    mstp_util_flush_mac_address_ports
+ *
+ * Purpose:  trigger mac address flush on the ports of an aggregated
+ *           flush request. Flushes are port-wide ('macs_invalid'), so the
+ *           requests of all the trees are merged into a single port set
+ *           and every port row is written at most once.
+ *           Caller holds MSTP_OVSDB_LOCK and owns the transaction.
+ *
+ * Params:    flushPorts - union of the ports to be flushed
+ *
+ * Returns:   number of port rows marked for flush
+ *
+ **PROC-*****************************************************************/
+uint32_t mstp_util_flush_mac_address_ports(const PORT_MAP *flushPorts)
+{
+    const struct ovsrec_port *port_row = NULL;
+    struct iface_data *idp = NULL;
+    bool flush_status = true;
+    uint32_t count = 0;
+
+    if (!flushPorts || !are_any_ports_set(flushPorts)) {
+        return 0;
     }
 
-    /*flush mac address one (port, vlan_set) */
-    if(msti_port_row->port && !msti_port_row->port->macs_invalid)
-    {
-        ovsrec_port_set_macs_invalid(msti_port_row->port,
-                &flush_status, 1);
+    OVSREC_PORT_FOR_EACH(port_row, idl) {
+        idp = shash_find_data(&all_interfaces, port_row->name);
+        if (!idp || !is_port_set(flushPorts, idp->lport_id)) {
+            continue;
+        }
+        /*flush mac address one (port, vlan_set) */
+        if (!port_row->macs_invalid) {
+            ovsrec_port_set_macs_invalid(port_row, &flush_status, 1);
+            count++;
+        }
     }
+    return count;
 }
 
 /**PROC+***********************************************************
- * Name:    mstp_util_cist_flush_mac_address
+ * Name:    mstp_util_set_port_state_vector
  *
- * Purpose:  trigger mac address flush on on all the corresponding vlans
- *           for the cist port
+ * Purpose:  write the changed cells of the port state vector. Every table
+ *           is walked at most once: the CIST port rows, the port rows of
+ *           each MSTI that has changes and the Port rows for the
+ *           'block_all_mstp' hw_config key.
+ *           Caller holds MSTP_OVSDB_LOCK and owns the transaction.
  *
- * Params:    port_name - port on which macs have to be flushed
+ * Params:    vec      - values of the cells to be written
+ *            stateChg - per tree maps of the port state cells to write,
+ *                       indexed by MSTID; ports with no DB row are cleared
+ *            blockChg - ports whose 'block_all_mstp' must be written;
+ *                       ports with no DB row are cleared
  *
- * Returns:   none
+ * Returns:   number of cells written
  *
  **PROC-*****************************************************************/
-void mstp_util_cist_flush_mac_address(const char *port_name)
+uint32_t mstp_util_set_port_state_vector(const MSTP_DB_PORT_STATE_VEC_t *vec,
+                                         PORT_MAP *stateChg,
+                                         PORT_MAP *blockChg)
 {
+    static const char *state_str[] = { NULL, "Blocking", "Learning",
+                                       "Forwarding" };
     const struct ovsrec_mstp_common_instance_port *cist_port_row = NULL;
-    const struct ovsrec_mstp_common_instance *cist_row = NULL;
-    bool flush_status = true;
-
-    cist_row = ovsrec_mstp_common_instance_first(idl);
+    const struct ovsrec_mstp_instance_port *msti_port_row = NULL;
+    const struct ovsrec_bridge *bridge_row = NULL;
+    const struct ovsrec_port *port_row = NULL;
+    struct iface_data *idp = NULL;
+    struct smap smap_hw_config;
+    PORT_MAP found;
+    bool msti_seen[MSTP_INSTANCES_MAX+1] = {false};
+    uint8_t value;
+    uint32_t count = 0;
+    int i, j, mstid, lport;
+
+    /* CIST */
+    if (are_any_ports_set(&stateChg[MSTP_CISTID])) {
+        clear_port_map(&found);
+        OVSREC_MSTP_COMMON_INSTANCE_PORT_FOR_EACH(cist_port_row, idl) {
+            if (!cist_port_row->port) {
+                continue;
+            }
+            idp = shash_find_data(&all_interfaces, cist_port_row->port->name);
+            if (!idp || !is_port_set(&stateChg[MSTP_CISTID], idp->lport_id)) {
+                continue;
+            }
+            lport = idp->lport_id;
+            value = vec->state[MSTP_CISTID][lport];
+            if (value > MSTP_DB_PORT_STATE_NONE &&
+                value <= MSTP_DB_PORT_STATE_FORWARDING) {
+                ovsrec_mstp_common_instance_port_set_port_state(cist_port_row,
+                                                                state_str[value]);
+                set_port(&found, lport);
+                count++;
+            }
+        }
+        bit_and_port_maps(&found, &stateChg[MSTP_CISTID]);
+    }
 
-    OVSREC_MSTP_COMMON_INSTANCE_PORT_FOR_EACH(cist_port_row, idl) {
-        if(!cist_port_row->port){
+    /* MSTIs */
+    bridge_row = ovsrec_bridge_first(idl);
+    for (i = 0; bridge_row && i < bridge_row->n_mstp_instances; i++) {
+        mstid = bridge_row->key_mstp_instances[i];
+        if (mstid <= MSTP_CISTID || mstid > MSTP_INSTANCES_MAX ||
+            !are_any_ports_set(&stateChg[mstid])) {
             continue;
         }
-        if (strncmp(cist_port_row->port->name, port_name, strlen(port_name)) == 0) {
-            break;
+        clear_port_map(&found);
+        for (j = 0; j < bridge_row->value_mstp_instances[i]->n_mstp_instance_ports; j++) {
+            msti_port_row = bridge_row->value_mstp_instances[i]->mstp_instance_ports[j];
+            if (!msti_port_row->port) {
+                continue;
+            }
+            idp = shash_find_data(&all_interfaces, msti_port_row->port->name);
+            if (!idp || !is_port_set(&stateChg[mstid], idp->lport_id)) {
+                continue;
+            }
+            lport = idp->lport_id;
+            value = vec->state[mstid][lport];
+            if (value > MSTP_DB_PORT_STATE_NONE &&
+                value <= MSTP_DB_PORT_STATE_FORWARDING) {
+                ovsrec_mstp_instance_port_set_port_state(msti_port_row,
+                                                         state_str[value]);
+                set_port(&found, lport);
+                count++;
+            }
         }
+        bit_and_port_maps(&found, &stateChg[mstid]);
+        msti_seen[mstid] = true;
     }
-
-    if (!cist_row || !cist_port_row) {
-         VLOG_DBG("%s: Finding instance or instance_port failed", __FUNCTION__);
-         return;
+    /* trees that are not in DB (anymore) have nothing written */
+    for (mstid = 1; mstid <= MSTP_INSTANCES_MAX; mstid++) {
+        if (!msti_seen[mstid]) {
+            clear_port_map(&stateChg[mstid]);
+        }
     }
 
-    if (cist_port_row->port && !cist_port_row->port->macs_invalid)
-    {
-        /*flush mac address one (port, vlan_set) */
-        ovsrec_port_set_macs_invalid(cist_port_row->port,
-                &flush_status, 1);
+    /* block_all_mstp */
+    if (are_any_ports_set(blockChg)) {
+        clear_port_map(&found);
+        OVSREC_PORT_FOR_EACH(port_row, idl) {
+            idp = shash_find_data(&all_interfaces, port_row->name);
+            if (!idp || !is_port_set(blockChg, idp->lport_id)) {
+                continue;
+            }
+            lport = idp->lport_id;
+            value = vec->blockAll[lport];
+            if (value != MSTP_DB_BLOCK_ALL_ON && value != MSTP_DB_BLOCK_ALL_OFF) {
+                continue;
+            }
+            smap_clone(&smap_hw_config, &port_row->hw_config);
+            smap_replace(&smap_hw_config, BLOCK_ALL_MSTP,
+                         (value == MSTP_DB_BLOCK_ALL_ON) ? "true" : "false");
+            ovsrec_port_set_hw_config(port_row, &smap_hw_config);
+            smap_destroy(&smap_hw_config);
+            set_port(&found, lport);
+            count++;
+        }
+        bit_and_port_maps(&found, blockChg);
     }
+    return count;
 }
 
 bool intf_get_link_state(const struct ovsrec_port *prow)
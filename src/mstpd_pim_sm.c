@@ -600,7 +600,7 @@ mstp_pimSmCurrentCond(MSTP_RX_PDU *pkt, MSTID_t mstid, LPORT_t lport)
    }
    else
    {/* no change in state */
-      MSTP_SM_ST_PRINTF(MSTP_PIM,
+      MSTP_MISC_SM_MSTI_PORT_PRINTF(MSTP_PIM, lport,
                         "PIM: CURRENT state not changed MST=%d,  lport=%d",
                         mstid, lport);
    }
@@ -1162,6 +1162,7 @@ mstp_pimSmUpdateAct(MSTID_t mstid, LPORT_t lport)
       }
 
       cistPortPtr->portPriority = cistPortPtr->designatedPriority;
+      mstp_statusPortChg(MSTP_CISTID, lport);
       cistPortPtr->portTimes.fwdDelay = cistPortPtr->designatedTimes.fwdDelay;
       cistPortPtr->portTimes.maxAge = cistPortPtr->designatedTimes.maxAge;
       cistPortPtr->portTimes.messageAge =
@@ -1180,20 +1181,10 @@ mstp_pimSmUpdateAct(MSTID_t mstid, LPORT_t lport)
       else
          cistPortPtr->portTimes.helloTime = commPortPtr->HelloTime;
 
-      MSTP_OVSDB_LOCK;
-      struct ovsdb_idl_txn *txn = NULL;
-      txn = ovsdb_idl_txn_create(idl);
-      if(txn == NULL) {
-          VLOG_ERR("%s Transaction Failed %s:%d", program_name, __FILE__, __LINE__);
-          return;
-      }
       mstp_util_set_cist_table_value(OPER_HELLO_TIME, cistPortPtr->portTimes.helloTime);
       mstp_util_set_cist_table_value(OPER_FORWARD_DELAY, cistPortPtr->portTimes.fwdDelay);
       mstp_util_set_cist_table_value(OPER_MAX_AGE, cistPortPtr->portTimes.maxAge);
       mstp_util_set_cist_table_value(OPER_TX_HOLD_COUNT, mstp_Bridge.TxHoldCount);
-      ovsdb_idl_txn_commit_block(txn);
-      ovsdb_idl_txn_destroy(txn);
-      MSTP_OVSDB_UNLOCK;
 
       MSTP_CIST_PORT_CLR_BIT(cistPortPtr->bitMap, MSTP_CIST_PORT_UPDT_INFO);
       cistPortPtr->infoIs = MSTP_INFO_IS_MINE;
@@ -1239,6 +1230,7 @@ mstp_pimSmUpdateAct(MSTID_t mstid, LPORT_t lport)
       }
 
       mstiPortPtr->portPriority = mstiPortPtr->designatedPriority;
+      mstp_statusPortChg(mstid, lport);
       mstiPortPtr->portTimes = mstiPortPtr->designatedTimes;
       MSTP_MSTI_PORT_CLR_BIT(mstiPortPtr->bitMap, MSTP_MSTI_PORT_UPDT_INFO);
       mstiPortPtr->infoIs = MSTP_INFO_IS_MINE;
@@ -1806,6 +1798,10 @@ mstp_syncMstiPortsWithCist(LPORT_t lport)
 {
    MSTP_COMM_PORT_INFO_t *commPortPtr;
    MSTID_t                mstid;
+   MSTID_t                mstids[MSTP_INSTANCES_MAX];
+   int                    count = 0;
+   int                    i;
+   uint64_t               start = mstp_utilMonoUsec();
 
    STP_ASSERT(MSTP_BEGIN == FALSE);
    STP_ASSERT(IS_VALID_LPORT(lport));
@@ -1818,13 +1814,30 @@ mstp_syncMstiPortsWithCist(LPORT_t lport)
    for(mstid = MSTP_MSTID_MIN; mstid <= MSTP_MSTID_MAX; mstid++)
    {
       if(MSTP_MSTI_VALID(mstid))
-      {
-         MSTP_MSTI_PORT_INFO_t *mstiPortPtr = MSTP_MSTI_PORT_PTR(mstid,lport);
+         mstids[count++] = mstid;
+   }
 
-         STP_ASSERT(mstiPortPtr);
-         MSTP_MSTI_PORT_SET_BIT(mstiPortPtr->bitMap, MSTP_MSTI_PORT_RESELECT);
-         MSTP_MSTI_PORT_CLR_BIT(mstiPortPtr->bitMap, MSTP_MSTI_PORT_SELECTED);
-         mstp_prsSm(mstid);
-      }
+   /*------------------------------------------------------------------------
+    * Have the MSTI worker pool, if on, elect the Root of every MSTI ahead.
+    * Only the election is run ahead: it reads nothing but the MSTI's own
+    * port priority vectors, which the PRS and SMs of the other MSTIs do
+    * not touch. Role selection and the SMs write the common port data,
+    * the TX schedule and the staged DB cells, so they stay here and run
+    * one MSTI after the other.
+    *------------------------------------------------------------------------*/
+   mstp_mstiPoolElect(mstids, count);
+
+   for(i = 0; i < count; i++)
+   {
+      MSTP_MSTI_PORT_INFO_t *mstiPortPtr = MSTP_MSTI_PORT_PTR(mstids[i],lport);
+
+      STP_ASSERT(mstiPortPtr);
+      MSTP_MSTI_PORT_SET_BIT(mstiPortPtr->bitMap, MSTP_MSTI_PORT_RESELECT);
+      MSTP_MSTI_PORT_CLR_BIT(mstiPortPtr->bitMap, MSTP_MSTI_PORT_SELECTED);
+      mstp_prsSm(mstids[i]);
    }
+
+   mstp_mstiPoolElectDone(mstids, count);
+   if(count > 1)
+      mstp_mstiPoolSyncRecord(mstp_utilMonoUsec() - start);
 }
@@ -0,0 +1,275 @@
+/*
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+/**********************************************************************************
+ *    File               : mstpd_port_arena.c
+ *    Description        : Per-tree port arenas. The per-Port data of a tree
+ *                         (the CIST or an MSTI) lives in chunks of ports laid
+ *                         out in lport order, so role selection walks the
+ *                         ports of a tree through contiguous memory. The
+ *                         debug counters and the port role history, which
+ *                         the state machines do not read, live in a cold
+ *                         arena of their own. A chunk is allocated with the
+ *                         first port in it and freed with the last one.
+ *                         Also allocates the common per-Port data, whose
+ *                         cold part follows the hot one in place.
+ **********************************************************************************/
+
+#include <assert.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <util.h>
+#include <vswitch-idl.h>
+#include <openvswitch/vlog.h>
+#include "mstp_fsm.h"
+#include "mstp_inlines.h"
+
+/*---------------------------------------------------------------------------
+ * Cache line layout of the per-Port structures. The fields a timer tick
+ * tests come first and fit in one line; the asserts keep later additions
+ * from pushing them out or growing the hot parts past the given lines.
+ *---------------------------------------------------------------------------*/
+#define MSTP_COMM_PORT_HOT_LINES 2
+#define MSTP_CIST_PORT_HOT_LINES 4
+#define MSTP_MSTI_PORT_HOT_LINES 3
+
+BUILD_ASSERT_DECL(offsetof(MSTP_COMM_PORT_INFO_t, adminPointToPointMAC)
+                  <= MSTP_CACHE_LINE_SIZE);
+BUILD_ASSERT_DECL(offsetof(MSTP_COMM_PORT_INFO_t, bpduRxCnt)
+                  == MSTP_COMM_PORT_HOT_LINES * MSTP_CACHE_LINE_SIZE);
+BUILD_ASSERT_DECL(offsetof(MSTP_CIST_PORT_INFO_t, portId)
+                  <= MSTP_CACHE_LINE_SIZE);
+BUILD_ASSERT_DECL(sizeof(MSTP_CIST_PORT_INFO_t)
+                  <= MSTP_CIST_PORT_HOT_LINES * MSTP_CACHE_LINE_SIZE);
+BUILD_ASSERT_DECL(offsetof(MSTP_MSTI_PORT_INFO_t, portId)
+                  <= MSTP_CACHE_LINE_SIZE);
+BUILD_ASSERT_DECL(sizeof(MSTP_MSTI_PORT_INFO_t)
+                  <= MSTP_MSTI_PORT_HOT_LINES * MSTP_CACHE_LINE_SIZE);
+
+/* Ports per chunk */
+#define MSTP_PORT_ARENA_CHUNK   32
+#define MSTP_PORT_ARENA_CHUNKS  \
+   ((MAX_LPORTS + MSTP_PORT_ARENA_CHUNK - 1) / MSTP_PORT_ARENA_CHUNK)
+
+typedef struct mstp_port_arena
+{
+   char     *hot[MSTP_PORT_ARENA_CHUNKS];
+   char     *cold[MSTP_PORT_ARENA_CHUNKS];
+   uint16_t  used[MSTP_PORT_ARENA_CHUNKS];   /* ports allocated in a chunk */
+   PORT_MAP  ports;
+
+} MSTP_PORT_ARENA_t;
+
+/* protocol thread, except for the counts read by 'mstp_portArenaStatsGet'
+ * under 'mstp_portArenaLock' */
+static MSTP_PORT_ARENA_t mstp_portArena[MSTP_INSTANCES_MAX + 1];
+static MSTP_PORT_ARENA_STATS_t mstp_portArenaStats[MSTP_INSTANCES_MAX + 1];
+static pthread_mutex_t mstp_portArenaLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Hot slots are padded to whole cache lines so that every port of a chunk,
+ * not only the first one, starts on a line of its own. */
+static void
+mstp_portArenaSizes(MSTID_t mstid, size_t *hotSize, size_t *coldSize)
+{
+   if(mstid == MSTP_CISTID)
+   {
+      *hotSize = ROUND_UP(sizeof(MSTP_CIST_PORT_INFO_t), MSTP_CACHE_LINE_SIZE);
+      *coldSize = sizeof(MSTP_CIST_PORT_COLD_t);
+   }
+   else
+   {
+      *hotSize = ROUND_UP(sizeof(MSTP_MSTI_PORT_INFO_t), MSTP_CACHE_LINE_SIZE);
+      *coldSize = sizeof(MSTP_MSTI_PORT_COLD_t);
+   }
+   STP_ASSERT(*hotSize % MSTP_CACHE_LINE_SIZE == 0);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_portArenaAlloc
+ *
+ * Purpose:   Take the slot of 'lport' in the arenas of 'mstid', allocating
+ *            its chunks if the port is the first one in them. The slot is
+ *            zeroed.
+ *
+ * Params:    mstid -> the CIST or an MSTI
+ *            lport -> logical port number
+ *            cold  -> set to the port's slot in the cold arena
+ *
+ * Returns:   the port's slot in the hot arena
+ *
+ * Globals:   mstp_portArena, mstp_portArenaStats
+ **PROC-**********************************************************************/
+static void *
+mstp_portArenaAlloc(MSTID_t mstid, LPORT_t lport, void **cold)
+{
+   MSTP_PORT_ARENA_t       *arena;
+   MSTP_PORT_ARENA_STATS_t *stats;
+   size_t                   hotSize;
+   size_t                   coldSize;
+   int                      chunk;
+   int                      slot;
+   void                    *hot;
+
+   STP_ASSERT(mstid <= MSTP_MSTID_MAX);
+   STP_ASSERT(IS_VALID_LPORT(lport));
+
+   arena = &mstp_portArena[mstid];
+   stats = &mstp_portArenaStats[mstid];
+   STP_ASSERT(!is_port_set(&arena->ports, lport));
+   mstp_portArenaSizes(mstid, &hotSize, &coldSize);
+   chunk = (lport - 1) / MSTP_PORT_ARENA_CHUNK;
+   slot = (lport - 1) % MSTP_PORT_ARENA_CHUNK;
+
+   pthread_mutex_lock(&mstp_portArenaLock);
+   if(!arena->hot[chunk])
+   {
+      arena->hot[chunk] = xzalloc_cacheline(MSTP_PORT_ARENA_CHUNK * hotSize);
+      arena->cold[chunk] = xzalloc(MSTP_PORT_ARENA_CHUNK * coldSize);
+      stats->chunks++;
+      stats->hotBytes += MSTP_PORT_ARENA_CHUNK * hotSize;
+      stats->coldBytes += MSTP_PORT_ARENA_CHUNK * coldSize;
+   }
+   arena->used[chunk]++;
+   set_port(&arena->ports, lport);
+   stats->ports++;
+   pthread_mutex_unlock(&mstp_portArenaLock);
+
+   hot = arena->hot[chunk] + slot * hotSize;
+   *cold = arena->cold[chunk] + slot * coldSize;
+   memset(hot, 0, hotSize);
+   memset(*cold, 0, coldSize);
+
+   return hot;
+}
+
+MSTP_CIST_PORT_INFO_t *
+mstp_portArenaCistAlloc(LPORT_t lport)
+{
+   MSTP_CIST_PORT_INFO_t *cistPortPtr;
+   void                  *cold;
+
+   cistPortPtr = mstp_portArenaAlloc(MSTP_CISTID, lport, &cold);
+   cistPortPtr->cold = cold;
+   return cistPortPtr;
+}
+
+MSTP_MSTI_PORT_INFO_t *
+mstp_portArenaMstiAlloc(MSTID_t mstid, LPORT_t lport)
+{
+   MSTP_MSTI_PORT_INFO_t *mstiPortPtr;
+   void                  *cold;
+
+   STP_ASSERT(MSTP_VALID_MSTID(mstid));
+
+   mstiPortPtr = mstp_portArenaAlloc(mstid, lport, &cold);
+   mstiPortPtr->cold = cold;
+   return mstiPortPtr;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_portArenaFree
+ *
+ * Purpose:   Give back the slots of 'lport' in the arenas of 'mstid',
+ *            freeing the chunks if the port was the last one in them
+ *
+ * Params:    mstid -> the CIST or an MSTI
+ *            lport -> logical port number
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_portArena, mstp_portArenaStats
+ **PROC-**********************************************************************/
+void
+mstp_portArenaFree(MSTID_t mstid, LPORT_t lport)
+{
+   MSTP_PORT_ARENA_t       *arena;
+   MSTP_PORT_ARENA_STATS_t *stats;
+   size_t                   hotSize;
+   size_t                   coldSize;
+   int                      chunk;
+
+   STP_ASSERT(mstid <= MSTP_MSTID_MAX);
+   STP_ASSERT(IS_VALID_LPORT(lport));
+
+   arena = &mstp_portArena[mstid];
+   stats = &mstp_portArenaStats[mstid];
+   if(!is_port_set(&arena->ports, lport))
+   {
+      STP_ASSERT(0);
+      return;
+   }
+   mstp_portArenaSizes(mstid, &hotSize, &coldSize);
+   chunk = (lport - 1) / MSTP_PORT_ARENA_CHUNK;
+
+   pthread_mutex_lock(&mstp_portArenaLock);
+   clear_port(&arena->ports, lport);
+   stats->ports--;
+   if(--arena->used[chunk] == 0)
+   {
+      free_cacheline(arena->hot[chunk]);
+      free(arena->cold[chunk]);
+      arena->hot[chunk] = NULL;
+      arena->cold[chunk] = NULL;
+      stats->chunks--;
+      stats->hotBytes -= MSTP_PORT_ARENA_CHUNK * hotSize;
+      stats->coldBytes -= MSTP_PORT_ARENA_CHUNK * coldSize;
+   }
+   pthread_mutex_unlock(&mstp_portArenaLock);
+}
+
+/* Copy the arena counts of 'mstid' */
+void
+mstp_portArenaStatsGet(MSTID_t mstid, MSTP_PORT_ARENA_STATS_t *stats)
+{
+   if(mstid > MSTP_MSTID_MAX)
+   {
+      memset(stats, 0, sizeof(*stats));
+      return;
+   }
+
+   pthread_mutex_lock(&mstp_portArenaLock);
+   *stats = mstp_portArenaStats[mstid];
+   pthread_mutex_unlock(&mstp_portArenaLock);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_portArenaCommAlloc
+ *
+ * Purpose:   Allocate the zeroed common per-Port data of a port. It is
+ *            cache line aligned, so its hot part takes exactly
+ *            'MSTP_COMM_PORT_HOT_LINES' lines.
+ *
+ * Params:    none
+ *
+ * Returns:   the port's data, to be released with 'mstp_portArenaCommFree'
+ *
+ * Globals:   none
+ **PROC-**********************************************************************/
+MSTP_COMM_PORT_INFO_t *
+mstp_portArenaCommAlloc(void)
+{
+   return xzalloc_cacheline(sizeof(MSTP_COMM_PORT_INFO_t));
+}
+
+void
+mstp_portArenaCommFree(MSTP_COMM_PORT_INFO_t *commPortPtr)
+{
+   free(commPortPtr->rxCacheBytes);
+   free_cacheline(commPortPtr);
+}
@@ -47,6 +47,8 @@ static bool mstp_prsSmRoleSelectionCond(MSTID_t mstid);
 
 static void mstp_prsSmInitTreeAct(MSTID_t mstid);
 static void mstp_prsSmRoleSelectionAct(MSTID_t mstid);
+static void mstp_prsSmSelectedRolesGet(MSTID_t mstid,
+                                       MSTP_PORT_ROLE_t *roles);
 
 /** ======================================================================= **
  *                                                                           *
@@ -305,11 +307,30 @@ mstp_prsSmRoleSelectionAct(MSTID_t mstid)
    LPORT_t                lport = 0;
    LPORT_t                lportRoot;
    MSTP_COMM_PORT_INFO_t *commPortPtr = NULL;
+   MSTP_PORT_ROLE_t       prevRoles[MAX_LPORTS + 1];
+   MSTP_PORT_ROLE_t       roles[MAX_LPORTS + 1];
+   bool                   traced = mstp_traceIsEnabled();
+
+   if(traced)
+      mstp_prsSmSelectedRolesGet(mstid, prevRoles);
 
    mstp_clearReselectTree(mstid);
    mstp_updtRolesTree(mstid);
    mstp_setSelectedTree(mstid);
 
+   /*------------------------------------------------------------------------
+    * stamp the ports whose role has just changed for the convergence trace
+    *------------------------------------------------------------------------*/
+   if(traced)
+   {
+      mstp_prsSmSelectedRolesGet(mstid, roles);
+      for(lport = 1; lport <= MAX_LPORTS; lport++)
+      {
+         if(roles[lport] != prevRoles[lport])
+            mstp_traceRoleChange(mstid, lport, roles[lport]);
+      }
+   }
+
    lportRoot = (mstid == MSTP_CISTID) ?
                 MSTP_GET_PORT_NUM(MSTP_CIST_ROOT_PORT_ID):
                 MSTP_GET_PORT_NUM(MSTP_MSTI_ROOT_PORT_ID(mstid));
@@ -397,3 +418,37 @@ mstp_prsSmRoleSelectionAct(MSTID_t mstid)
       mstp_prtSm(mstid, lportRoot);
    }
 }
+
+/**PROC+**********************************************************************
+ * Name:      mstp_prsSmSelectedRolesGet
+ *
+ * Purpose:   Copy the selected role of every port on the given tree,
+ *            MSTP_PORT_ROLE_UNKNOWN for ports the tree does not have
+ *
+ * Params:    mstid -> MST Instance Identifier (the CIST or an MSTI)
+ *            roles -> array of MAX_LPORTS + 1 entries, indexed by lport
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_Bridge
+ *
+ * Constraints:
+ **PROC-**********************************************************************/
+static void
+mstp_prsSmSelectedRolesGet(MSTID_t mstid, MSTP_PORT_ROLE_t *roles)
+{
+   LPORT_t lport;
+
+   roles[0] = MSTP_PORT_ROLE_UNKNOWN;
+   for(lport = 1; lport <= MAX_LPORTS; lport++)
+   {
+      if(mstid == MSTP_CISTID)
+         roles[lport] = MSTP_CIST_PORT_PTR(lport) ?
+                        MSTP_CIST_PORT_PTR(lport)->selectedRole :
+                        MSTP_PORT_ROLE_UNKNOWN;
+      else
+         roles[lport] = MSTP_MSTI_PORT_PTR(mstid, lport) ?
+                        MSTP_MSTI_PORT_PTR(mstid, lport)->selectedRole :
+                        MSTP_PORT_ROLE_UNKNOWN;
+   }
+}
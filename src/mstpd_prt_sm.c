@@ -756,6 +756,8 @@ mstp_prtSmInitPortAct(MSTID_t mstid, LPORT_t lport)
       mstiPortPtr->rbWhile = 0;
    }
 
+   mstp_statusPortChg(mstid, lport);
+
    if(MSTP_BEGIN == FALSE)
    {
       /*------------------------------------------------------------------
@@ -812,6 +814,8 @@ mstp_prtSmDisablePortAct(MSTID_t mstid, LPORT_t lport)
       MSTP_MSTI_PORT_CLR_BIT(mstiPortPtr->bitMap, MSTP_MSTI_PORT_FORWARD);
    }
 
+   mstp_statusPortChg(mstid, lport);
+
    if(MSTP_BEGIN == FALSE)
    {
       /*------------------------------------------------------------------
@@ -1415,6 +1419,7 @@ mstp_prtSmMasterPortAct(MSTID_t mstid, LPORT_t lport)
    STP_ASSERT(mstiPortPtr->selectedRole == MSTP_PORT_ROLE_MASTER);
 
    mstiPortPtr->role = mstiPortPtr->selectedRole;
+   mstp_statusPortChg(mstid, lport);
 }
 
 /**PROC+**********************************************************************
@@ -2236,6 +2241,8 @@ mstp_prtSmRootPortAct(MSTID_t mstid, LPORT_t lport)
       mstiPortPtr->role    = mstiPortPtr->selectedRole;
       mstiPortPtr->rrWhile = MSTP_CIST_ROOT_TIMES.fwdDelay;
    }
+
+   mstp_statusPortChg(mstid, lport);
 }
 
 /**PROC+**********************************************************************
@@ -3105,6 +3112,8 @@ mstp_prtSmDesignatedPortAct(MSTID_t mstid, LPORT_t lport)
       STP_ASSERT(mstiPortPtr->selectedRole == MSTP_PORT_ROLE_DESIGNATED);
       mstiPortPtr->role = mstiPortPtr->selectedRole;
    }
+
+   mstp_statusPortChg(mstid, lport);
 }
 
 /**PROC+**********************************************************************
@@ -4002,6 +4011,8 @@ mstp_prtSmBlockPortAct(MSTID_t mstid, LPORT_t lport)
       MSTP_MSTI_PORT_CLR_BIT(mstiPortPtr->bitMap, MSTP_MSTI_PORT_FORWARD);
    }
 
+   mstp_statusPortChg(mstid, lport);
+
    if(MSTP_BEGIN == FALSE)
    {
       /*------------------------------------------------------------------
@@ -433,6 +433,8 @@ mstp_pstSmDiscardingAct(MSTID_t mstid, LPORT_t lport)
       mstp_disableForwarding(mstid, lport);
       MSTP_MSTI_PORT_CLR_BIT(mstiPortPtr->bitMap, MSTP_MSTI_PORT_FORWARDING);
    }
+
+   mstp_statusPortChg(mstid, lport);
 }
 
 /**PROC+**********************************************************************
@@ -476,6 +478,8 @@ mstp_pstSmLearningAct(MSTID_t mstid, LPORT_t lport)
       MSTP_MSTI_PORT_SET_BIT(mstiPortPtr->bitMap, MSTP_MSTI_PORT_LEARNING);
    }
 
+   mstp_statusPortChg(mstid, lport);
+
    /*------------------------------------------------------------------------
     * kick Topology Change state machine  (per-Tree per-Port)
     *------------------------------------------------------------------------*/
@@ -524,6 +528,8 @@ mstp_pstSmForwardingAct(MSTID_t mstid, LPORT_t lport)
       MSTP_MSTI_PORT_SET_BIT(mstiPortPtr->bitMap, MSTP_MSTI_PORT_FORWARDING);
    }
 
+   mstp_statusPortChg(mstid, lport);
+
    /*------------------------------------------------------------------------
     * kick Topology Change state machine  (per-Tree per-Port)
     *------------------------------------------------------------------------*/
@@ -318,17 +318,7 @@ mstp_ptiSmTickAct(LPORT_t lport)
    if(commPortPtr->helloWhen)
    {
       commPortPtr->helloWhen--;
-      struct ovsdb_idl_txn *txn = NULL;
-      MSTP_OVSDB_LOCK;
-      txn = ovsdb_idl_txn_create(idl);
-      if(txn == NULL) {
-          VLOG_ERR("%s Transaction Failed %s:%d", program_name, __FILE__, __LINE__);
-          return;
-      }
       mstp_util_set_cist_table_value(HELLO_EXPIRY_TIME, commPortPtr->helloWhen);
-      ovsdb_idl_txn_commit_block(txn);
-      ovsdb_idl_txn_destroy(txn);
-      MSTP_OVSDB_UNLOCK;
       if(commPortPtr->helloWhen == 0)
       {/* Transmit Timer has expired */
          if(portEnabled)
@@ -373,13 +363,7 @@ mstp_ptiSmTickAct(LPORT_t lport)
        cistPortPtr->tcWhile--;
        if(cistPortPtr->tcWhile == 0)
        {
-           struct ovsdb_idl_txn *txn = NULL;
-           MSTP_OVSDB_LOCK;
-           txn = ovsdb_idl_txn_create(idl);
            mstp_util_set_msti_table_string(TOPOLOGY_CHANGE,"disable",mstid);
-           ovsdb_idl_txn_commit_block(txn);
-           ovsdb_idl_txn_destroy(txn);
-           MSTP_OVSDB_UNLOCK;
        }
    }
 
@@ -387,17 +371,7 @@ mstp_ptiSmTickAct(LPORT_t lport)
       (cistPortPtr->prtState != MSTP_PRT_STATE_DISABLED_PORT))
    {
       cistPortPtr->fdWhile--;
-      struct ovsdb_idl_txn *txn = NULL;
-      MSTP_OVSDB_LOCK;
-      txn = ovsdb_idl_txn_create(idl);
-      if(txn == NULL) {
-          VLOG_ERR("%s Transaction Failed %s:%d", program_name, __FILE__, __LINE__);
-          return;
-      }
       mstp_util_set_cist_table_value(FORWARD_DELAY_EXP_TIME, cistPortPtr->fdWhile);
-      ovsdb_idl_txn_commit_block(txn);
-      ovsdb_idl_txn_destroy(txn);
-      MSTP_OVSDB_UNLOCK;
       if(cistPortPtr->fdWhile == 0)
          call_prtSm = TRUE;
    }
@@ -442,8 +416,8 @@ mstp_ptiSmTickAct(LPORT_t lport)
                                          cistPortPtr->portPriority.dsnBridgeID;
 
             /* Update statistics counter */
-            cistPortPtr->dbgCnts.starvedBpduCnt++;
-            cistPortPtr->dbgCnts.starvedBpduCntLastUpdated =
+            cistPortPtr->cold->dbgCnts.starvedBpduCnt++;
+            cistPortPtr->cold->dbgCnts.starvedBpduCntLastUpdated =
                                                          time(NULL);
             /* log RMON event */
             intf_get_port_name(lport, portName);
@@ -507,13 +481,7 @@ mstp_ptiSmTickAct(LPORT_t lport)
                mstiPortPtr->tcWhile--;
                if(mstiPortPtr->tcWhile == 0)
                {
-                   struct ovsdb_idl_txn *txn = NULL;
-                   MSTP_OVSDB_LOCK;
-                   txn = ovsdb_idl_txn_create(idl);
                    mstp_util_set_msti_table_string(TOPOLOGY_CHANGE,"disable",mstid);
-                   ovsdb_idl_txn_commit_block(txn);
-                   ovsdb_idl_txn_destroy(txn);
-                   MSTP_OVSDB_UNLOCK;
                }
             }
 
@@ -566,8 +534,8 @@ mstp_ptiSmTickAct(LPORT_t lport)
                         mstiPortPtr->portPriority.dsnBridgeID;
 
                      /* Update statistics counter */
-                     mstiPortPtr->dbgCnts.starvedMsgCnt++;
-                     mstiPortPtr->dbgCnts.starvedMsgCntLastUpdated =
+                     mstiPortPtr->cold->dbgCnts.starvedMsgCnt++;
+                     mstiPortPtr->cold->dbgCnts.starvedMsgCntLastUpdated =
                         time(NULL);
                      /* log RMON event */
                      intf_get_port_name(lport, portName);
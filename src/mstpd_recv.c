@@ -42,6 +42,37 @@
 #include "mstp_ovsdb_if.h"
 
 VLOG_DEFINE_THIS_MODULE(mstpd_recv);
+
+/*---------------------------------------------------------------------------
+ * 64-bit FNV-1a parameters used for the received BPDU digests and port
+ * state signatures
+ *---------------------------------------------------------------------------*/
+#define MSTP_FNV64_OFFSET   0xcbf29ce484222325ULL
+#define MSTP_FNV64_PRIME    0x00000100000001b3ULL
+
+/*---------------------------------------------------------------------------
+ * Local functions prototypes (forward declarations)
+ *---------------------------------------------------------------------------*/
+static uint64_t mstp_fnv64(uint64_t hash, const void *buf, size_t len);
+static bool     mstp_rxBpduIsCacheable(MSTP_RX_PDU *pkt, LPORT_t lport);
+static uint64_t mstp_rxPortStateSig(LPORT_t lport);
+static bool     mstp_rxBpduIsRepeat(MSTP_RX_PDU *pkt, LPORT_t lport,
+                                    uint64_t digest, uint64_t *sig);
+static void     mstp_rxBpduFastPath(MSTP_RX_PDU *pkt, LPORT_t lport);
+static void     mstp_rxBpduCacheStore(MSTP_RX_PDU *pkt, LPORT_t lport,
+                                      uint64_t digest);
+
+/* NOTE: this array is indexed by the values defined
+ *       in 'MSTP_RX_FAST_PATH_MODE_e' enum list */
+static const char *const mstp_rxFastPathMode_s[MSTP_RX_FAST_PATH_MAX] =
+{
+   "off",
+   "on",
+   "strict"
+};
+
+/* written by the unixctl thread, read by the protocol thread */
+static MSTP_RX_FAST_PATH_MODE_e mstp_rxFastPathMode = MSTP_RX_FAST_PATH_ON;
 /** ======================================================================= **
  *                                                                           *
  *     Global Functions (externed)                                           *
@@ -131,9 +162,15 @@ MSTP_PKT_TYPE_t mstp_decodeBpdu(MSTP_RX_PDU *pkt)
 void
 mstp_protocolData(MSTP_RX_PDU *pkt)
 {
-   MSTP_COMM_PORT_INFO_t *commPortPtr;
-   LPORT_t                lport;
-   bool                   edgePort;
+   MSTP_COMM_PORT_INFO_t   *commPortPtr;
+   LPORT_t                  lport;
+   bool                     edgePort;
+   MSTP_RX_FAST_PATH_MODE_e mode;
+   bool                     repeat  = FALSE;
+   uint64_t                 digest  = 0;
+   uint64_t                 preSig  = 0;
+   uint64_t                 preCnt  = 0;
+   uint32_t                 fastCnt = 0;
 
    STP_ASSERT(pkt);
 
@@ -175,8 +212,8 @@ mstp_protocolData(MSTP_RX_PDU *pkt)
 
       /* update statistics counter */
       STP_ASSERT(cistPortPtr);
-      cistPortPtr->dbgCnts.invalidBpduCnt++;
-      cistPortPtr->dbgCnts.invalidBpduCntLastUpdated = time(NULL);
+      cistPortPtr->cold->dbgCnts.invalidBpduCnt++;
+      cistPortPtr->cold->dbgCnts.invalidBpduCntLastUpdated = time(NULL);
 
       log_event("MSTP_BAD_BPDU",
           EV_KV("config_parameter", "%s", "wrong Protocol ID and version"),
@@ -188,7 +225,6 @@ mstp_protocolData(MSTP_RX_PDU *pkt)
    mstp_CB.prBpduCnt++;
    mstp_CB.rxBpduCnt++;
    commPortPtr->dbxRxCnt++;
-   MSTP_COMM_PORT_SET_BIT(commPortPtr->bitMap, MSTP_PORT_RCVD_BPDU);
 
    edgePort = MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap,
                                         MSTP_PORT_ADMIN_EDGE_PORT);
@@ -202,6 +238,32 @@ mstp_protocolData(MSTP_RX_PDU *pkt)
           EV_KV("port", "%s", portName));
    }
 
+   /*------------------------------------------------------------------------
+    * In steady state the BPDU is a repeat of the one last processed on this
+    * port. If the port's state is still the one that BPDU left behind, the
+    * state machines would only restart the 'rcvdInfoWhile' and
+    * 'edgeDelayWhile' timers, so do just that.
+    *------------------------------------------------------------------------*/
+   mode = mstp_getRxFastPathMode();
+   if(mode != MSTP_RX_FAST_PATH_OFF)
+   {
+      digest = mstp_fnv64(MSTP_FNV64_OFFSET, pkt->data, pkt->pktLen);
+      repeat = mstp_rxBpduIsRepeat(pkt, lport, digest, &preSig);
+      if(repeat && (mode == MSTP_RX_FAST_PATH_ON))
+      {
+         mstp_rxBpduFastPath(pkt, lport);
+         mstp_CB.rxFastHitCnt++;
+         return;
+      }
+      if(repeat)
+      {/* strict mode: what the fast path would count */
+         preCnt = mstp_rxPortCntSum(lport);
+         fastCnt = mstp_rxBpduCount(pkt, lport, FALSE);
+      }
+   }
+
+   MSTP_COMM_PORT_SET_BIT(commPortPtr->bitMap, MSTP_PORT_RCVD_BPDU);
+
    /*------------------------------------------------------------------------
     * Stop any BPDU transmissions on the Bridge while we are processing
     * BPDU
@@ -215,25 +277,59 @@ mstp_protocolData(MSTP_RX_PDU *pkt)
     *       for correctness and has not therefore been incorporated into
     *       the state machines.
     *       (802.1Q-REV/D5.0 13.31)
+    * NOTE: When the protocol thread drains a batch of BPDUs, transmissions
+    *       are already prevented for the whole batch and the DB update and
+    *       pending TX below are done once when the batch closes.
     *------------------------------------------------------------------------*/
-   mstp_preventTxOnBridge();
+   if(!mstp_CB.rxBatchOpen)
+      mstp_preventTxOnBridge();
 
    /*------------------------------------------------------------------------
     * kick the Port Receive state machine
     *------------------------------------------------------------------------*/
    mstp_prxSm(pkt, lport);
 
-   /*------------------------------------------------------------------------
-    * Inform DB about port state changes, if any
-    *------------------------------------------------------------------------*/
-   mstp_informDBOnPortStateChange(0);
+   if(!mstp_CB.rxBatchOpen)
+   {
+      /*---------------------------------------------------------------------
+       * Inform DB about port state changes, if any
+       *---------------------------------------------------------------------*/
+      mstp_informDBOnPortStateChange(0);
+
+      /*---------------------------------------------------------------------
+       * When we done with processing of the BPDU initiate transmission of
+       * pending information on the Bridge, if any
+       *---------------------------------------------------------------------*/
+      mstp_doPendingTxOnBridge();
+   }
+
+   if(mode == MSTP_RX_FAST_PATH_OFF)
+      return;
 
    /*------------------------------------------------------------------------
-    * When we done with processing of the BPDU initiate transmission of
-    * pending information on the Bridge, if any
+    * strict mode: the fast path would have left the port's state untouched,
+    * the full path must have done the same
     *------------------------------------------------------------------------*/
-   mstp_doPendingTxOnBridge();
+   if(repeat)
+   {
+      mstp_CB.rxFastStrictCnt++;
+      if((mstp_rxPortStateSig(lport) != preSig) ||
+         (mstp_rxPortCntSum(lport) - preCnt != fastCnt))
+      {
+         char portName[PORTNAME_LEN];
 
+         mstp_CB.rxFastMismatchCnt++;
+         intf_get_port_name(lport, portName);
+         VLOG_ERR("BPDU fast path mismatch on port %s", portName);
+         STP_ASSERT(0);
+      }
+   }
+   else
+   {
+      mstp_CB.rxFastMissCnt++;
+   }
+
+   mstp_rxBpduCacheStore(pkt, lport, digest);
 }
 /**PROC+**********************************************************************
  * Name:      mstp_errantProtocolData
@@ -298,8 +394,8 @@ mstp_errantProtocolData(MSTP_RX_PDU *pkt, TRAP_SOURCE_TYPE_e source)
     * Augment Errant Bpdu Count
     *------------------------------------------------------------------------*/
    STP_ASSERT(MSTP_CIST_PORT_PTR(lport));
-   MSTP_CIST_PORT_PTR(lport)->dbgCnts.errantBpduCnt++;
-   MSTP_CIST_PORT_PTR(lport)->dbgCnts.errantBpduCntLastUpdated =
+   MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.errantBpduCnt++;
+   MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.errantBpduCntLastUpdated =
                                                          time(NULL);
    /*------------------------------------------------------------------------
     * Store port state at time of event for sending trap
@@ -407,8 +503,8 @@ mstp_processUnauthorizedBpdu(MSTP_RX_PDU *pkt, TRAP_SOURCE_TYPE_e source)
        * Augment Errant Bpdu Count
        *---------------------------------------------------------------------*/
       STP_ASSERT(MSTP_CIST_PORT_PTR(lport));
-      MSTP_CIST_PORT_PTR(lport)->dbgCnts.errantBpduCnt++;
-      MSTP_CIST_PORT_PTR(lport)->dbgCnts.errantBpduCntLastUpdated =
+      MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.errantBpduCnt++;
+      MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.errantBpduCntLastUpdated =
                                                          time(NULL);
 #ifdef OPS_MSTP_TODO
       /*---------------------------------------------------------------------
@@ -421,3 +517,370 @@ mstp_processUnauthorizedBpdu(MSTP_RX_PDU *pkt, TRAP_SOURCE_TYPE_e source)
    }
 
 }
+
+/**PROC+**********************************************************************
+ * Name:      mstp_rxBpduCacheInvalidate
+ *
+ * Purpose:   Forget the last accepted BPDU on all ports, so that the next
+ *            BPDU on every port goes through the full receive path.
+ *            Called whenever configuration or port membership changes,
+ *            since the same BPDU may then lead to a different result.
+ *
+ * Params:    none
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_CB
+ **PROC-**********************************************************************/
+void
+mstp_rxBpduCacheInvalidate(void)
+{
+   mstp_CB.rxCacheGen++;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_setRxFastPathMode
+ *
+ * Purpose:   Select how repeated BPDUs are processed
+ *
+ * Params:    mode -> MSTP_RX_FAST_PATH_OFF    - always take the full path
+ *                    MSTP_RX_FAST_PATH_ON     - take the fast path for
+ *                                               repeated BPDUs
+ *                    MSTP_RX_FAST_PATH_STRICT - take the full path and
+ *                                               assert that the fast path
+ *                                               would have been equivalent
+ *
+ * Returns:   TRUE if the mode is valid, FALSE otherwise
+ *
+ * Globals:   mstp_rxFastPathMode
+ **PROC-**********************************************************************/
+bool
+mstp_setRxFastPathMode(MSTP_RX_FAST_PATH_MODE_e mode)
+{
+   if(mode >= MSTP_RX_FAST_PATH_MAX)
+      return FALSE;
+
+   __atomic_store_n(&mstp_rxFastPathMode, mode, __ATOMIC_RELAXED);
+   return TRUE;
+}
+
+MSTP_RX_FAST_PATH_MODE_e
+mstp_getRxFastPathMode(void)
+{
+   return __atomic_load_n(&mstp_rxFastPathMode, __ATOMIC_RELAXED);
+}
+
+const char *
+mstp_rxFastPathModeStr(MSTP_RX_FAST_PATH_MODE_e mode)
+{
+   return (mode < MSTP_RX_FAST_PATH_MAX) ? mstp_rxFastPathMode_s[mode] : "";
+}
+
+/** ======================================================================= **
+ *                                                                           *
+ *     Static (local to this file) Functions                                 *
+ *                                                                           *
+ ** ======================================================================= **/
+
+static uint64_t
+mstp_fnv64(uint64_t hash, const void *buf, size_t len)
+{
+   const uint8_t *p = buf;
+
+   while(len--)
+   {
+      hash ^= *p++;
+      hash *= MSTP_FNV64_PRIME;
+   }
+
+   return hash;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_rxBpduIsCacheable
+ *
+ * Purpose:   Check whether a BPDU may be remembered for the fast path.
+ *            Only RST and MST BPDUs without TC, TC Ack and Proposal flags
+ *            qualify: those flags drive the TCM and the sync handshake, so
+ *            every BPDU carrying them has to run the state machines.
+ *            MST BPDUs from another region are excluded as well, their
+ *            processing also feeds the region misconfiguration counters.
+ *
+ * Params:    pkt   -> pointer to the packet buffer with BPDU in, already
+ *                     processed by the full receive path
+ *            lport -> logical port number
+ *
+ * Returns:   TRUE if the BPDU can be cached, FALSE otherwise
+ *
+ * Globals:   mstp_Bridge
+ **PROC-**********************************************************************/
+static bool
+mstp_rxBpduIsCacheable(MSTP_RX_PDU *pkt, LPORT_t lport)
+{
+   MSTP_COMM_PORT_INFO_t  *commPortPtr = MSTP_COMM_PORT_PTR(lport);
+   MSTP_MST_BPDU_t        *bpdu        = (MSTP_MST_BPDU_t *)(pkt->data);
+   MSTP_MSTI_CONFIG_MSG_t *mstiCfgMsgPtr = NULL;
+   MSTP_BPDU_TYPE_t        bpduType;
+
+   if(MSTP_BEGIN || commPortPtr->rcvdSelfSentPkt)
+      return FALSE;
+
+   bpduType = mstp_getBpduType(pkt);
+   if((bpduType != MSTP_BPDU_TYPE_RSTP) && (bpduType != MSTP_BPDU_TYPE_MSTP))
+      return FALSE;
+
+   if(bpdu->cistFlags & (MSTP_CIST_FLAG_TC | MSTP_CIST_FLAG_PROPOSAL |
+                         MSTP_CIST_FLAG_TC_ACK))
+      return FALSE;
+
+   if(bpduType == MSTP_BPDU_TYPE_MSTP)
+   {
+      if(!MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap,
+                                    MSTP_PORT_RCVD_INTERNAL))
+         return FALSE;
+
+      while((mstiCfgMsgPtr = mstp_findNextMstiCfgMsgInBpdu(pkt, mstiCfgMsgPtr)))
+      {
+         if(mstiCfgMsgPtr->mstiFlags & (MSTP_MSTI_FLAG_TC |
+                                        MSTP_MSTI_FLAG_PROPOSAL))
+            return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_rxPortStateSig
+ *
+ * Purpose:   Compute a signature of everything the receive path may change
+ *            on a port apart from timers: the per-port flags and machine
+ *            states, and per tree the flags, roles, 'infoIs', machine states
+ *            and loop guard state. All valid MSTIs are covered, a CIST
+ *            message from another region updates their 'agreed' flags.
+ *
+ * Params:    lport -> logical port number
+ *
+ * Returns:   signature value
+ *
+ * Globals:   mstp_Bridge
+ **PROC-**********************************************************************/
+static uint64_t
+mstp_rxPortStateSig(LPORT_t lport)
+{
+   MSTP_COMM_PORT_INFO_t *commPortPtr = MSTP_COMM_PORT_PTR(lport);
+   MSTP_CIST_PORT_INFO_t *cistPortPtr = MSTP_CIST_PORT_PTR(lport);
+   MSTP_MSTI_PORT_INFO_t *mstiPortPtr;
+   MSTID_t                mstid;
+   uint64_t               sig = MSTP_FNV64_OFFSET;
+
+   STP_ASSERT(commPortPtr && cistPortPtr);
+
+   sig = mstp_fnv64(sig, commPortPtr->bitMap, sizeof(commPortPtr->bitMap));
+   sig = mstp_fnv64(sig, &commPortPtr->ppmState, sizeof(commPortPtr->ppmState));
+   sig = mstp_fnv64(sig, &commPortPtr->prxState, sizeof(commPortPtr->prxState));
+   sig = mstp_fnv64(sig, &commPortPtr->bdmState, sizeof(commPortPtr->bdmState));
+
+   sig = mstp_fnv64(sig, cistPortPtr->bitMap, sizeof(cistPortPtr->bitMap));
+   sig = mstp_fnv64(sig, &cistPortPtr->infoIs, sizeof(cistPortPtr->infoIs));
+   sig = mstp_fnv64(sig, &cistPortPtr->role, sizeof(cistPortPtr->role));
+   sig = mstp_fnv64(sig, &cistPortPtr->selectedRole,
+                    sizeof(cistPortPtr->selectedRole));
+   sig = mstp_fnv64(sig, &cistPortPtr->pimState, sizeof(cistPortPtr->pimState));
+   sig = mstp_fnv64(sig, &cistPortPtr->prtState, sizeof(cistPortPtr->prtState));
+   sig = mstp_fnv64(sig, &cistPortPtr->pstState, sizeof(cistPortPtr->pstState));
+   sig = mstp_fnv64(sig, &cistPortPtr->tcmState, sizeof(cistPortPtr->tcmState));
+   sig = mstp_fnv64(sig, &cistPortPtr->loopInconsistent,
+                    sizeof(cistPortPtr->loopInconsistent));
+
+   for(mstid = MSTP_MSTID_MIN; mstid <= MSTP_MSTID_MAX; mstid++)
+   {
+      if(!MSTP_MSTI_VALID(mstid) ||
+         !(mstiPortPtr = MSTP_MSTI_PORT_PTR(mstid, lport)))
+         continue;
+
+      sig = mstp_fnv64(sig, &mstid, sizeof(mstid));
+      sig = mstp_fnv64(sig, mstiPortPtr->bitMap, sizeof(mstiPortPtr->bitMap));
+      sig = mstp_fnv64(sig, &mstiPortPtr->infoIs, sizeof(mstiPortPtr->infoIs));
+      sig = mstp_fnv64(sig, &mstiPortPtr->role, sizeof(mstiPortPtr->role));
+      sig = mstp_fnv64(sig, &mstiPortPtr->selectedRole,
+                       sizeof(mstiPortPtr->selectedRole));
+      sig = mstp_fnv64(sig, &mstiPortPtr->pimState,
+                       sizeof(mstiPortPtr->pimState));
+      sig = mstp_fnv64(sig, &mstiPortPtr->prtState,
+                       sizeof(mstiPortPtr->prtState));
+      sig = mstp_fnv64(sig, &mstiPortPtr->pstState,
+                       sizeof(mstiPortPtr->pstState));
+      sig = mstp_fnv64(sig, &mstiPortPtr->tcmState,
+                       sizeof(mstiPortPtr->tcmState));
+      sig = mstp_fnv64(sig, &mstiPortPtr->loopInconsistent,
+                       sizeof(mstiPortPtr->loopInconsistent));
+   }
+
+   return sig;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_rxBpduIsRepeat
+ *
+ * Purpose:   Check whether the received BPDU may take the fast path, i.e.
+ *            it is identical to the last BPDU cached on the port, nothing
+ *            was reconfigured since, and the port's state still is the one
+ *            that BPDU left behind. The digest only screens out changed
+ *            BPDUs cheaply, a match is confirmed on the cached octets.
+ *
+ * Params:    pkt    -> pointer to the packet buffer with BPDU in
+ *            lport  -> logical port number
+ *            digest -> digest of the received BPDU
+ *            sig    -> current port state signature, set if the BPDU
+ *                      matches the cached one
+ *
+ * Returns:   TRUE if the BPDU is a repeat, FALSE otherwise
+ *
+ * Globals:   mstp_CB
+ **PROC-**********************************************************************/
+static bool
+mstp_rxBpduIsRepeat(MSTP_RX_PDU *pkt, LPORT_t lport, uint64_t digest,
+                    uint64_t *sig)
+{
+   MSTP_COMM_PORT_INFO_t *commPortPtr = MSTP_COMM_PORT_PTR(lport);
+
+   if(!commPortPtr->rxCacheValid ||
+      (commPortPtr->rxCacheGen != mstp_CB.rxCacheGen) ||
+      (commPortPtr->rxCacheLen != pkt->pktLen) ||
+      (commPortPtr->rxCacheDigest != digest) ||
+      memcmp(commPortPtr->rxCacheBytes, pkt->data, pkt->pktLen))
+      return FALSE;
+
+   if(MSTP_BEGIN || commPortPtr->rcvdSelfSentPkt)
+      return FALSE;
+
+   *sig = mstp_rxPortStateSig(lport);
+   return (*sig == commPortPtr->rxCacheSig);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_rxBpduFastPath
+ *
+ * Purpose:   Process a repeated BPDU. It is counted and checked against the
+ *            MST Region configuration as any other BPDU. Then every tree the
+ *            BPDU conveys a message for gets the actions of the PIM state
+ *            the full path would take: REPEATED_DESIGNATED records proposal
+ *            and agreement and restarts 'rcvdInfoWhile', NOT_DESIGNATED
+ *            (an inferior Root or Alternate message) records agreement. Repeats never carry TC flags, so there are
+ *            no TC flags to set, and the state signature check guarantees
+ *            the recorded flags come out unchanged, so no port state update
+ *            or transmission is due.
+ *
+ * Params:    pkt   -> pointer to the packet buffer with BPDU in
+ *            lport -> logical port number
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_Bridge
+ **PROC-**********************************************************************/
+static void
+mstp_rxBpduFastPath(MSTP_RX_PDU *pkt, LPORT_t lport)
+{
+   MSTP_COMM_PORT_INFO_t  *commPortPtr   = MSTP_COMM_PORT_PTR(lport);
+   MSTP_CIST_PORT_INFO_t  *cistPortPtr   = MSTP_CIST_PORT_PTR(lport);
+   MSTP_MST_BPDU_t        *bpdu          = (MSTP_MST_BPDU_t *)(pkt->data);
+   MSTP_MSTI_CONFIG_MSG_t *mstiCfgMsgPtr = NULL;
+   MSTP_MSTI_PORT_INFO_t  *mstiPortPtr;
+   MSTID_t                 mstid;
+   uint8_t                 role;
+
+   /*------------------------------------------------------------------------
+    * same statistics and per-BPDU checks as the full path (see
+    * 'mstp_setRcvdMsgs' and 'mstp_rcvInfoCist')
+    *------------------------------------------------------------------------*/
+   mstp_rxBpduCount(pkt, lport, TRUE);
+   if(mstp_getBpduType(pkt) == MSTP_BPDU_TYPE_MSTP)
+      mstp_mstRgnCfgConsistencyCheck(bpdu, lport);
+
+   /*------------------------------------------------------------------------
+    * 'edgeDelayWhile' = 'MigrateTime' (see 'mstp_prxSmReceiveAct')
+    *------------------------------------------------------------------------*/
+   commPortPtr->edgeDelayWhile = mstp_Bridge.MigrateTime + 1;
+
+   role = bpdu->cistFlags & MSTP_CIST_FLAG_PORT_ROLE;
+   if((role == MSTP_BPDU_ROLE_DESIGNATED) &&
+      (cistPortPtr->infoIs == MSTP_INFO_IS_RECEIVED))
+   {
+      mstp_recordProposal(pkt, MSTP_CISTID, lport);
+      mstp_recordAgreement(pkt, MSTP_CISTID, lport);
+      mstp_updtRcvdInfoWhile(MSTP_CISTID, lport);
+   }
+   else if(((role == MSTP_BPDU_ROLE_ROOT) ||
+            (role == MSTP_BPDU_ROLE_ALTERNATE_OR_BACKUP)) &&
+           mstp_rcvdMsgIsInferior(MSTP_CISTID, lport))
+      mstp_recordAgreement(pkt, MSTP_CISTID, lport);
+
+   if(!MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap,
+                                 MSTP_PORT_RCVD_INTERNAL))
+      return;
+
+   while((mstiCfgMsgPtr = mstp_findNextMstiCfgMsgInBpdu(pkt, mstiCfgMsgPtr)))
+   {
+      mstid = MSTP_GET_BRIDGE_SYS_ID_FROM_PKT(mstiCfgMsgPtr->mstiRgnRootId);
+      if(!MSTP_VALID_MSTID(mstid) || !MSTP_MSTI_VALID(mstid))
+         continue;
+
+      mstiPortPtr = MSTP_MSTI_PORT_PTR(mstid, lport);
+      if(!mstiPortPtr)
+         continue;
+
+      role = mstiCfgMsgPtr->mstiFlags & MSTP_MSTI_FLAG_PORT_ROLE;
+      if((role == MSTP_BPDU_ROLE_DESIGNATED) &&
+         (mstiPortPtr->infoIs == MSTP_INFO_IS_RECEIVED))
+      {
+         mstp_recordProposal(pkt, mstid, lport);
+         mstp_recordAgreement(pkt, mstid, lport);
+         mstp_updtRcvdInfoWhile(mstid, lport);
+      }
+      else if(((role == MSTP_BPDU_ROLE_ROOT) ||
+               (role == MSTP_BPDU_ROLE_ALTERNATE_OR_BACKUP)) &&
+              mstp_rcvdMsgIsInferior(mstid, lport))
+         mstp_recordAgreement(pkt, mstid, lport);
+   }
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_rxBpduCacheStore
+ *
+ * Purpose:   Remember the BPDU just processed by the full receive path
+ *            together with the port's state it resulted in
+ *
+ * Params:    pkt    -> pointer to the packet buffer with BPDU in
+ *            lport  -> logical port number
+ *            digest -> digest of the BPDU
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_CB
+ **PROC-**********************************************************************/
+static void
+mstp_rxBpduCacheStore(MSTP_RX_PDU *pkt, LPORT_t lport, uint64_t digest)
+{
+   MSTP_COMM_PORT_INFO_t *commPortPtr = MSTP_COMM_PORT_PTR(lport);
+
+   if(commPortPtr == NULL)
+      return;
+
+   commPortPtr->rxCacheValid = mstp_rxBpduIsCacheable(pkt, lport);
+   if(!commPortPtr->rxCacheValid)
+      return;
+
+   if(commPortPtr->rxCacheCap < pkt->pktLen)
+   {
+      commPortPtr->rxCacheBytes = xrealloc(commPortPtr->rxCacheBytes,
+                                           pkt->pktLen);
+      commPortPtr->rxCacheCap = pkt->pktLen;
+   }
+   memcpy(commPortPtr->rxCacheBytes, pkt->data, pkt->pktLen);
+
+   commPortPtr->rxCacheLen    = pkt->pktLen;
+   commPortPtr->rxCacheGen    = mstp_CB.rxCacheGen;
+   commPortPtr->rxCacheDigest = digest;
+   commPortPtr->rxCacheSig    = mstp_rxPortStateSig(lport);
+}
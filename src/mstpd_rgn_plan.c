@@ -0,0 +1,225 @@
+/*
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+/**********************************************************************************
+ *    File               : mstpd_rgn_plan.c
+ *    Description        : Region planning. Keeps the MST Configuration
+ *                         Identifier last received from the neighbour on
+ *                         each port, and evaluates a proposed VLAN to MSTI
+ *                         mapping against them: its Configuration Digest,
+ *                         the VLANs that would move between trees, and the
+ *                         ports that would become or stop being MST Region
+ *                         boundaries. Nothing the protocol runs on is
+ *                         touched, so a plan can be evaluated from any
+ *                         thread.
+ **********************************************************************************/
+
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <util.h>
+#include <vswitch-idl.h>
+#include "mstp_fsm.h"
+#include "mstp_inlines.h"
+
+/* MST Configuration Identifier of a neighbour, revision in host order */
+typedef struct mstp_rgn_peer
+{
+   MSTP_MST_CONFIGURATION_ID_t cfgId;
+   uint64_t                    lastUsec; /* last MST BPDU it came in     */
+
+} MSTP_RGN_PEER_t;
+
+/* written by the protocol thread, read by the planner, under
+ * 'mstp_rgnPeerLock' */
+static MSTP_RGN_PEER_t mstp_rgnPeer[MAX_LPORTS + 1];
+static PORT_MAP        mstp_rgnPeerPorts;
+static pthread_mutex_t mstp_rgnPeerLock = PTHREAD_MUTEX_INITIALIZER;
+
+#define MSTP_RGN_PEER_AGE_MAX_USEC \
+   (MSTP_RGN_PEER_AGE_MAX_SEC * 1000000ULL)
+
+/* TRUE if 'peer' and 'my' name the same MST Region, revisions in host
+ * order (802.1Q-REV/D5.0 13.8) */
+static bool
+mstp_rgnSame(const MSTP_MST_CONFIGURATION_ID_t *my,
+             const MSTP_MST_CONFIGURATION_ID_t *peer)
+{
+   return((my->formatSelector == peer->formatSelector) &&
+          !memcmp(my->configName, peer->configName,
+                  MSTP_MST_CONFIG_NAME_LEN) &&
+          (my->revisionLevel == peer->revisionLevel) &&
+          !memcmp(my->digest, peer->digest, MSTP_DIGEST_SIZE));
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_rgnPeerSave
+ *
+ * Purpose:   Remember the MST Configuration Identifier of the neighbour on
+ *            a port. Called for every MST BPDU received.
+ *
+ * Params:    lport -> logical port the BPDU was received on
+ *            cfgId -> the BPDU's identifier, revision in network order
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_rgnPeer, mstp_rgnPeerPorts
+ **PROC-**********************************************************************/
+void
+mstp_rgnPeerSave(LPORT_t lport, const MSTP_MST_CONFIGURATION_ID_t *cfgId)
+{
+   MSTP_RGN_PEER_t *peer;
+   uint64_t         now;
+
+   if(!IS_VALID_LPORT(lport))
+   {
+      STP_ASSERT(0);
+      return;
+   }
+
+   now = mstp_utilMonoUsec();
+   peer = &mstp_rgnPeer[lport];
+
+   pthread_mutex_lock(&mstp_rgnPeerLock);
+   peer->cfgId = *cfgId;
+   peer->cfgId.revisionLevel = ntohs(cfgId->revisionLevel);
+   peer->lastUsec = now;
+   set_port(&mstp_rgnPeerPorts, lport);
+   pthread_mutex_unlock(&mstp_rgnPeerLock);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_rgnPeerGet
+ *
+ * Purpose:   Get the MST Configuration Identifier last received on a port,
+ *            unless it is older than 'MSTP_RGN_PEER_AGE_MAX_SEC'
+ *
+ * Params:    lport  -> logical port number
+ *            cfgId  -> set to the identifier, revision in host order
+ *            ageSec -> set to the seconds since it was received
+ *
+ * Returns:   TRUE if there is one
+ *
+ * Globals:   mstp_rgnPeer, mstp_rgnPeerPorts
+ **PROC-**********************************************************************/
+bool
+mstp_rgnPeerGet(LPORT_t lport, MSTP_MST_CONFIGURATION_ID_t *cfgId,
+                uint32_t *ageSec)
+{
+   uint64_t now;
+   uint64_t age = 0;
+   bool     found = FALSE;
+
+   if(!IS_VALID_LPORT(lport))
+      return FALSE;
+
+   pthread_mutex_lock(&mstp_rgnPeerLock);
+   now = mstp_utilMonoUsec();
+   if(is_port_set(&mstp_rgnPeerPorts, lport))
+   {
+      age = now - mstp_rgnPeer[lport].lastUsec;
+      if(age <= MSTP_RGN_PEER_AGE_MAX_USEC)
+      {
+         *cfgId = mstp_rgnPeer[lport].cfgId;
+         found = TRUE;
+      }
+   }
+   pthread_mutex_unlock(&mstp_rgnPeerLock);
+
+   *ageSec = age / 1000000;
+   return found;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_rgnPlanEval
+ *
+ * Purpose:   Evaluate a proposed MST Configuration against the running one:
+ *            calculate the Configuration Digest of both tables, count the
+ *            VIDs each tree would gain and lose, and find the ports whose
+ *            neighbour is in the same MST Region now and with the plan.
+ *            Only neighbours heard within 'MSTP_RGN_PEER_AGE_MAX_SEC' are
+ *            considered.
+ *
+ * Params:    plan -> the running and proposed configuration, the digests
+ *                    are filled in
+ *            res  -> set to the impact of the plan
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_rgnPeer, mstp_rgnPeerPorts
+ **PROC-**********************************************************************/
+void
+mstp_rgnPlanEval(MSTP_RGN_PLAN_t *plan, MSTP_RGN_PLAN_RESULT_t *res)
+{
+   const MSTP_MST_CONFIGURATION_ID_t *peerId;
+   uint64_t start;
+   uint64_t now;
+   LPORT_t  lport;
+   VID_t    vid;
+   MSTID_t  curMstid;
+   MSTID_t  planMstid;
+
+   STP_ASSERT(plan && res);
+
+   start = mstp_utilMonoUsec();
+   memset(res, 0, sizeof(*res));
+
+   mstp_mstConfigurationTableDigest(plan->curTable, plan->cur.digest);
+   if(memcmp(plan->curTable, plan->planTable, sizeof(plan->curTable)) == 0)
+      memcpy(plan->plan.digest, plan->cur.digest, MSTP_DIGEST_SIZE);
+   else
+   {
+      mstp_mstConfigurationTableDigest(plan->planTable, plan->plan.digest);
+
+      for(vid = MSTP_MST_CFG_TBL_FIRST_VID_IDX;
+          vid <= MSTP_MST_CFG_TBL_LAST_VID_IDX; vid++)
+      {
+         if(plan->curTable[vid] == plan->planTable[vid])
+            continue;
+
+         curMstid = ntohs(plan->curTable[vid]);
+         planMstid = ntohs(plan->planTable[vid]);
+         STP_ASSERT((curMstid <= MSTP_INSTANCES_MAX) &&
+                    (planMstid <= MSTP_INSTANCES_MAX));
+         res->movedVids++;
+         if(curMstid <= MSTP_INSTANCES_MAX)
+            res->vidsOut[curMstid]++;
+         if(planMstid <= MSTP_INSTANCES_MAX)
+            res->vidsIn[planMstid]++;
+      }
+   }
+
+   pthread_mutex_lock(&mstp_rgnPeerLock);
+   now = mstp_utilMonoUsec();
+   for(lport = find_first_port_set(&mstp_rgnPeerPorts);
+       IS_VALID_LPORT(lport);
+       lport = find_next_port_set(&mstp_rgnPeerPorts, lport))
+   {
+      if(now - mstp_rgnPeer[lport].lastUsec > MSTP_RGN_PEER_AGE_MAX_USEC)
+         continue;
+
+      peerId = &mstp_rgnPeer[lport].cfgId;
+      set_port(&res->peerPorts, lport);
+      if(!mstp_rgnSame(&plan->cur, peerId))
+         set_port(&res->boundaryCur, lport);
+      if(!mstp_rgnSame(&plan->plan, peerId))
+         set_port(&res->boundaryPlan, lport);
+   }
+   pthread_mutex_unlock(&mstp_rgnPeerLock);
+
+   res->evalUsec = mstp_utilMonoUsec() - start;
+}
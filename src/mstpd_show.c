@@ -23,11 +23,16 @@
 #include <string.h>
 #include <pthread.h>
 #include <sys/time.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <util.h>
 #include <daemon.h>
 #include <dirs.h>
 #include <unixctl.h>
+#include <seq.h>
 #include <fatal-signal.h>
 #include <command-line.h>
 #include <vswitch-idl.h>
@@ -725,7 +730,7 @@ void mstpd_daemon_cist_unixctl_list(struct unixctl_conn *conn, int argc,
  *
  * Returns:   none
  *
- * Globals:   mstp_Bridge
+ * Globals:   mstp_Bridge, mstp_CB
  **PROC-**********************************************************************/
 void
 mstpd_daemon_cist_data_dump(struct ds *ds, int argc, const char *argv[])
@@ -734,6 +739,11 @@ mstpd_daemon_cist_data_dump(struct ds *ds, int argc, const char *argv[])
    MSTP_CIST_BRIDGE_PRI_VECTOR_t pri_vec;
    MSTP_BRIDGE_IDENTIFIER_t      bid;
    MSTP_CIST_BRIDGE_TIMES_t      tms;
+   MSTP_DB_OUTBOX_STATS_t        outbox;
+   uint32_t                      backlog;
+   int                           i;
+
+   mstp_dbOutboxStatsGet(&outbox, &backlog);
 
    ds_put_format(ds, "mstpEnabled       : %s\n", MSTP_ENABLED ? "Yes" : "No");
    ds_put_format(ds, "valid             : %s\n", cistPtr->valid ? "Yes" : "No");
@@ -812,6 +822,37 @@ mstpd_daemon_cist_data_dump(struct ds *ds, int argc, const char *argv[])
           MSTP_PRS_STATE_s[cistPtr->prsState]);
    ds_put_format(ds,"TC Trap Control   : %s", ((cistPtr->tcTrapControl) ?
                                      "true" : "false"));
+   ds_put_format(ds,"\nMAC flush         : requests=%"PRIu64" ports=%"PRIu64
+                 " txns=%"PRIu64, mstp_CB.flushReqCnt, outbox.flushPortCnt,
+                 outbox.flushTxnCnt);
+   ds_put_format(ds,"\nTree msg slots    : allocs avoided=%"PRIu64" last burst=%u"
+                 " max burst=%u bursts=%u", mstp_CB.treeMsgSlotUseCnt,
+                 mstp_CB.treeMsgSlotUseLast, mstp_CB.treeMsgSlotUseWm,
+                 mstp_CB.treeMsgDrainCnt);
+   ds_put_format(ds,"\nDB port state     : cells=%"PRIu64" txns=%"PRIu64
+                 " max latency=%"PRIu64"us", outbox.stateCellCnt,
+                 outbox.stateTxnCnt, outbox.latencyMaxUsec);
+   ds_put_format(ds,"\nDB latency (ms)   : <1=%u", outbox.latencyHist[0]);
+   for (i = 1; i < MSTP_DB_LATENCY_BUCKETS - 1; i++)
+   {
+      ds_put_format(ds," <%d=%u", 1 << i, outbox.latencyHist[i]);
+   }
+   ds_put_format(ds," >=%d=%u", 1 << (MSTP_DB_LATENCY_BUCKETS - 2),
+                 outbox.latencyHist[MSTP_DB_LATENCY_BUCKETS - 1]);
+   ds_put_format(ds,"\nBPDU fast path    : %s hits=%"PRIu64" misses=%"PRIu64
+                 " strict=%"PRIu64" mismatches=%"PRIu64,
+                 mstp_rxFastPathModeStr(mstp_getRxFastPathMode()),
+                 mstp_CB.rxFastHitCnt, mstp_CB.rxFastMissCnt,
+                 mstp_CB.rxFastStrictCnt, mstp_CB.rxFastMismatchCnt);
+   ds_put_format(ds,"\nBPDU batches      : batches=%"PRIu64" bpdus=%"PRIu64
+                 " largest=%u at cap=%u at bound=%u", mstp_CB.rxBatchCnt,
+                 mstp_CB.rxBatchBpduCnt, mstp_CB.rxBatchWm,
+                 mstp_CB.rxBatchCapCnt, mstp_CB.rxBatchTimeCnt);
+   ds_put_format(ds,"\nDyn reconfig      : full=%"PRIu64" trees=%"PRIu64
+                 " ports=%"PRIu64" last=%"PRIu64"us max=%"PRIu64"us",
+                 mstp_CB.dynReconfigFullCnt, mstp_CB.dynReconfigTreeCnt,
+                 mstp_CB.dynReconfigPortCnt, mstp_CB.dynReconfigLastUsec,
+                 mstp_CB.dynReconfigMaxUsec);
 
    ds_put_format(ds,"\n");
 
@@ -861,28 +902,1217 @@ mstp_showCommonInfo(void)
 
 }
 
+/**PROC+**********************************************************************
+ * Name:      mstpd_daemon_stats_interval_unixctl
+ *
+ * Purpose:   Show or set the interval of the BPDU statistics export to DB
+ *
+ * Params:    argv[1] -> new interval in seconds (optional)
+ *
+ * Returns:   none
+ *
+ * Globals:   none
+ **PROC-**********************************************************************/
+
+void mstpd_daemon_stats_interval_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+
+    if (argc > 1 && !mstp_util_set_stats_interval(atoi(argv[1]))) {
+        ds_put_format(&ds, "Invalid interval, range is %d-%d seconds",
+                      MSTP_STATS_EXPORT_INTERVAL_MIN,
+                      MSTP_STATS_EXPORT_INTERVAL_MAX);
+        unixctl_command_reply_error(conn, ds_cstr(&ds));
+        ds_destroy(&ds);
+        return;
+    }
+    ds_put_format(&ds, "BPDU statistics export interval : %u sec\n",
+                  mstp_util_get_stats_interval());
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstpd_daemon_bpdu_fastpath_unixctl
+ *
+ * Purpose:   Show or set the mode of the unchanged-BPDU receive fast path
+ *
+ * Params:    argv[1] -> "on", "off" or "strict" (optional)
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_CB
+ **PROC-**********************************************************************/
+
+void mstpd_daemon_bpdu_fastpath_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    MSTP_RX_FAST_PATH_MODE_e mode;
+
+    if (argc > 1) {
+        for (mode = MSTP_RX_FAST_PATH_OFF; mode < MSTP_RX_FAST_PATH_MAX;
+             mode++) {
+            if (strcmp(argv[1], mstp_rxFastPathModeStr(mode)) == 0) {
+                break;
+            }
+        }
+        if (!mstp_setRxFastPathMode(mode)) {
+            unixctl_command_reply_error(conn,
+                                        "Invalid mode, use on, off or strict");
+            return;
+        }
+    }
+    ds_put_format(&ds, "BPDU fast path : %s\n",
+                  mstp_rxFastPathModeStr(mstp_getRxFastPathMode()));
+    ds_put_format(&ds, "Hits           : %"PRIu64"\n", mstp_CB.rxFastHitCnt);
+    ds_put_format(&ds, "Misses         : %"PRIu64"\n", mstp_CB.rxFastMissCnt);
+    ds_put_format(&ds, "Strict checks  : %"PRIu64" (mismatches %"PRIu64")\n",
+                  mstp_CB.rxFastStrictCnt, mstp_CB.rxFastMismatchCnt);
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstpd_daemon_rx_batch_unixctl
+ *
+ * Purpose:   Show or set the BPDU batch drain limits
+ *
+ * Params:    argv[1] -> max BPDUs per batch, 1 disables batching (optional)
+ *            argv[2] -> max time a batch may defer DB and TX updates,
+ *                       in microseconds (optional)
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_CB
+ **PROC-**********************************************************************/
+
+void mstpd_daemon_rx_batch_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    uint32_t maxBpdus, maxUsec;
+
+    mstp_getRxBatchLimits(&maxBpdus, &maxUsec);
+    if (argc > 1) {
+        maxBpdus = atoi(argv[1]);
+        if (argc > 2) {
+            maxUsec = atoi(argv[2]);
+        }
+        if (!mstp_setRxBatchLimits(maxBpdus, maxUsec)) {
+            ds_put_format(&ds, "Invalid limits, ranges are %d-%d BPDUs and "
+                          "%d-%d usec", MSTP_RX_BATCH_MAX_MIN,
+                          MSTP_RX_BATCH_MAX_MAX, MSTP_RX_BATCH_USEC_MIN,
+                          MSTP_RX_BATCH_USEC_MAX);
+            unixctl_command_reply_error(conn, ds_cstr(&ds));
+            ds_destroy(&ds);
+            return;
+        }
+    }
+    ds_put_format(&ds, "BPDU batch limits : %u BPDUs, %u usec\n",
+                  maxBpdus, maxUsec);
+    ds_put_format(&ds, "Batches           : %"PRIu64" (%"PRIu64" BPDUs, "
+                  "largest %u)\n", mstp_CB.rxBatchCnt, mstp_CB.rxBatchBpduCnt,
+                  mstp_CB.rxBatchWm);
+    ds_put_format(&ds, "Closed at cap     : %u\n", mstp_CB.rxBatchCapCnt);
+    ds_put_format(&ds, "Closed at bound   : %u\n", mstp_CB.rxBatchTimeCnt);
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstpd_daemon_ovsdb_lock_unixctl
+ *
+ * Purpose:   Show the OVSDB IDL mutex usage per thread, the state of the
+ *            DB outbox the protocol thread writes through and of the
+ *            config mailbox the OVSDB thread sends the config through
+ *
+ * Params:    argv[1] -> "reset" clears the mutex and mailbox counters
+ *                       (optional)
+ *
+ * Returns:   none
+ *
+ * Globals:   none
+ **PROC-**********************************************************************/
+
+void mstpd_daemon_ovsdb_lock_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    MSTP_OVSDB_LOCK_STATS_t lock[MSTP_THREAD_MAX];
+    MSTP_DB_OUTBOX_STATS_t outbox;
+    MSTP_CFG_MBOX_STATS_t mbox;
+    uint32_t backlog;
+    uint32_t pending;
+    bool reset = FALSE;
+    int role;
+
+    if (argc > 1) {
+        if (strcmp(argv[1], "reset") != 0) {
+            unixctl_command_reply_error(conn, "Invalid argument, use reset");
+            return;
+        }
+        reset = TRUE;
+    }
+    mstp_ovsdbLockStatsGet(lock, reset);
+    mstp_dbOutboxStatsGet(&outbox, &backlog);
+    mstp_cfgMboxStatsGet(&mbox, &pending, reset);
+
+    ds_put_format(&ds, "Times taken while the lock profiler is enabled "
+                  "(mstpd/lock-stats enable)\n");
+    ds_put_format(&ds, "%-10s %12s %12s %10s %10s %10s %10s\n", "Thread",
+                  "Acquired", "Timed", "Wait avg", "Wait max", "Hold avg",
+                  "Hold max");
+    for (role = 0; role < MSTP_THREAD_MAX; role++) {
+        uint64_t cnt = lock[role].timedCnt;
+
+        ds_put_format(&ds, "%-10s %12"PRIu64" %12"PRIu64" %8"PRIu64"us"
+                      " %8"PRIu64"us %8"PRIu64"us %8"PRIu64"us\n",
+                      mstp_threadRoleName(role), lock[role].acquireCnt, cnt,
+                      cnt ? lock[role].waitNsTotal / cnt / 1000 : 0,
+                      lock[role].waitNsMax / 1000,
+                      cnt ? lock[role].holdNsTotal / cnt / 1000 : 0,
+                      lock[role].holdNsMax / 1000);
+    }
+
+    ds_put_format(&ds, "\nDB outbox\n");
+    ds_put_format(&ds, "Hand-offs      : %"PRIu64" (%"PRIu64" merged)\n",
+                  outbox.handoffCnt, outbox.mergeCnt);
+    ds_put_format(&ds, "Cells          : %"PRIu64" (%"PRIu64" coalesced, "
+                  "%"PRIu64" missed)\n", outbox.cellCnt,
+                  outbox.cellCoalescedCnt, outbox.missedCnt);
+    ds_put_format(&ds, "Jobs           : add %"PRIu64", delete %"PRIu64
+                  ", vlan add %"PRIu64", vlan delete %"PRIu64
+                  " (%"PRIu64" VLANs), enable %"PRIu64", disable %"PRIu64
+                  ", forward %"PRIu64", reload %"PRIu64"\n",
+                  outbox.jobCnt[MSTP_DB_JOB_PORT_ADD],
+                  outbox.jobCnt[MSTP_DB_JOB_PORT_DELETE],
+                  outbox.jobCnt[MSTP_DB_JOB_VLAN_ADD],
+                  outbox.jobCnt[MSTP_DB_JOB_VLAN_DELETE], outbox.vlanCnt,
+                  outbox.jobCnt[MSTP_DB_JOB_PORT_ENABLE],
+                  outbox.jobCnt[MSTP_DB_JOB_PORT_DISABLE],
+                  outbox.jobCnt[MSTP_DB_JOB_ALL_FORWARD],
+                  outbox.jobCnt[MSTP_DB_JOB_CONFIG_RELOAD]);
+    ds_put_format(&ds, "Applied        : %"PRIu64" batches, %"PRIu64
+                  " transactions (%"PRIu64" failed), max %"PRIu64"us\n",
+                  outbox.applyCnt, outbox.txnCnt, outbox.txnFailedCnt,
+                  outbox.applyMaxUsec);
+    ds_put_format(&ds, "Backlog        : %u (max %u)\n", backlog,
+                  outbox.backlogWm);
+
+    ds_put_format(&ds, "\nConfig mailbox\n");
+    ds_put_format(&ds, "Updates        : %"PRIu64" (%"PRIu64" coalesced), "
+                  "%u pending\n", mbox.putCnt, mbox.coalescedCnt, pending);
+    ds_put_format(&ds, "Batches        : %"PRIu64" (%"PRIu64" dropped by "
+                  "a config reload)\n", mbox.batchCnt, mbox.droppedCnt);
+    ds_put_format(&ds, "Applied        : %"PRIu64" updates in %"PRIu64
+                  " passes, max %u per pass\n", mbox.appliedCnt,
+                  mbox.deliverCnt, mbox.maxBatch);
+    ds_put_format(&ds, "Pass time usec : last %"PRIu64", max %"PRIu64"\n",
+                  mbox.lastUsec, mbox.maxUsec);
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
+static int
+mstpd_lock_site_cmp(const void *a_, const void *b_)
+{
+    const MSTP_LOCK_SITE_t *a = a_;
+    const MSTP_LOCK_SITE_t *b = b_;
+
+    if (a->waitNsTotal != b->waitNsTotal) {
+        return (a->waitNsTotal < b->waitNsTotal) ? 1 : -1;
+    }
+    return (a->holdNsTotal < b->holdNsTotal) ? 1 :
+           (a->holdNsTotal > b->holdNsTotal) ? -1 : 0;
+}
+
+/* Histogram line, each non-empty bucket as '<upper bound>=count' */
+static void
+mstpd_lock_hist_dump(struct ds *ds, const char *title, const uint32_t *hist)
+{
+    uint64_t bound;
+    int i;
+
+    ds_put_format(ds, "    %s:", title);
+    for (i = 0; i < MSTP_LOCK_HIST_BUCKETS; i++) {
+        if (!hist[i]) {
+            continue;
+        }
+        if (i == MSTP_LOCK_HIST_BUCKETS - 1) {
+            ds_put_format(ds, " >=%"PRIu64"ms=%u",
+                          (1ULL << (i - 1)) / 1000000, hist[i]);
+            continue;
+        }
+        bound = 1ULL << i;
+        if (bound < 1000) {
+            ds_put_format(ds, " <%"PRIu64"ns=%u", bound, hist[i]);
+        } else if (bound < 1000000) {
+            ds_put_format(ds, " <%"PRIu64"us=%u", bound / 1000, hist[i]);
+        } else {
+            ds_put_format(ds, " <%"PRIu64"ms=%u", bound / 1000000, hist[i]);
+        }
+    }
+    ds_put_char(ds, '\n');
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstpd_lock_stats_unixctl
+ *
+ * Purpose:   Show the MSTP_OVSDB_LOCK call sites seen by the lock profiler,
+ *            the ones that made others wait longest first, or control the
+ *            profiler
+ *
+ * Params:    argv[1] -> "enable", "disable" or "reset" (optional)
+ *
+ * Returns:   none
+ *
+ * Globals:   none
+ **PROC-**********************************************************************/
+
+void mstpd_lock_stats_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    MSTP_LOCK_SITE_t *sites = NULL;
+    bool reset = FALSE;
+    char site_name[64];
+    int n, i;
+
+    if (argc > 1) {
+        if (strcmp(argv[1], "enable") == 0) {
+            mstp_lockProfSetEnabled(TRUE);
+        } else if (strcmp(argv[1], "disable") == 0) {
+            mstp_lockProfSetEnabled(FALSE);
+        } else if (strcmp(argv[1], "reset") == 0) {
+            reset = TRUE;
+        } else {
+            unixctl_command_reply_error(conn,
+                               "Invalid argument, use enable, disable or reset");
+            return;
+        }
+    }
+
+    n = mstp_lockProfGet(&sites, reset);
+    qsort(sites, n, sizeof(*sites), mstpd_lock_site_cmp);
+
+    ds_put_format(&ds, "Lock profiler : %s\n\n",
+                  mstp_lockProfIsEnabled() ? "enabled" : "disabled");
+    ds_put_format(&ds, "%-40s %10s %10s %10s %10s %10s\n", "Call site",
+                  "Acquired", "Wait avg", "Wait max", "Hold avg", "Hold max");
+    for (i = 0; i < n; i++) {
+        uint64_t cnt = sites[i].acquireCnt;
+
+        if (!cnt) {
+            continue;
+        }
+        snprintf(site_name, sizeof(site_name), "%s:%d", sites[i].func,
+                 sites[i].line);
+        ds_put_format(&ds, "%-40s %10"PRIu64" %8"PRIu64"ns %8"PRIu64"ns"
+                      " %8"PRIu64"ns %8"PRIu64"ns\n", site_name, cnt,
+                      sites[i].waitNsTotal / cnt, sites[i].waitNsMax,
+                      sites[i].holdNsTotal / cnt, sites[i].holdNsMax);
+        mstpd_lock_hist_dump(&ds, "wait", sites[i].waitHist);
+        mstpd_lock_hist_dump(&ds, "hold", sites[i].holdHist);
+    }
+    free(sites);
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
+/* Histogram line, each non-empty bucket as '<upper bound>=count' */
+static void
+mstpd_trace_hist_dump(struct ds *ds, const MSTP_TRACE_HIST_t *hist)
+{
+    uint64_t bound;
+    int i;
+
+    ds_put_format(ds, "    latency:");
+    for (i = 0; i < MSTP_TRACE_HIST_BUCKETS; i++) {
+        if (!hist->buckets[i]) {
+            continue;
+        }
+        if (i == MSTP_TRACE_HIST_BUCKETS - 1) {
+            ds_put_format(ds, " >=%"PRIu64"ms=%"PRIu64,
+                          (1ULL << (i - 1)) / 1000, hist->buckets[i]);
+            continue;
+        }
+        bound = 1ULL << i;
+        if (bound < 1000) {
+            ds_put_format(ds, " <%"PRIu64"us=%"PRIu64, bound,
+                          hist->buckets[i]);
+        } else {
+            ds_put_format(ds, " <%"PRIu64"ms=%"PRIu64, bound / 1000,
+                          hist->buckets[i]);
+        }
+    }
+    ds_put_char(ds, '\n');
+}
+
+/* Write the whole trace segment to 'path' for offline analysis */
+static int
+mstpd_trace_dump_file(const MSTP_TRACE_SHM_t *shm, const char *path)
+{
+    const char *buf = (const char *)shm;
+    size_t left = sizeof(*shm);
+    ssize_t n;
+    int fd;
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return errno;
+    }
+    while (left) {
+        n = write(fd, buf, left);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            n = errno;
+            close(fd);
+            return n;
+        }
+        buf += n;
+        left -= n;
+    }
+    return close(fd) ? errno : 0;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstpd_trace_unixctl
+ *
+ * Purpose:   Show the convergence trace, per stage latencies from the event
+ *            that caused them (BPDU receive or event dequeue), or control
+ *            the trace. 'dump' writes the raw segment (see 'mstp_trace.h'
+ *            for its layout) to a file.
+ *
+ * Params:    argv[1] -> "enable", "disable", "reset" or "dump" (optional)
+ *            argv[2] -> file to dump to
+ *
+ * Returns:   none
+ *
+ * Globals:   none
+ **PROC-**********************************************************************/
+
+void mstpd_trace_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    MSTP_TRACE_SHM_t *shm = mstp_traceShmGet();
+    const MSTP_TRACE_HIST_t *hist;
+    int err;
+    int i;
+
+    if (!shm) {
+        unixctl_command_reply_error(conn, "Convergence trace not available");
+        return;
+    }
+
+    if (argc > 1) {
+        if ((strcmp(argv[1], "dump") == 0) && (argc == 3)) {
+            err = mstpd_trace_dump_file(shm, argv[2]);
+            if (err) {
+                ds_put_format(&ds, "Failed to write %s (%s)", argv[2],
+                              strerror(err));
+                unixctl_command_reply_error(conn, ds_cstr(&ds));
+            } else {
+                ds_put_format(&ds, "%zu bytes written to %s\n",
+                              sizeof(*shm), argv[2]);
+                unixctl_command_reply(conn, ds_cstr(&ds));
+            }
+            ds_destroy(&ds);
+            return;
+        } else if (argc > 2) {
+            unixctl_command_reply_error(conn, "Too many arguments");
+            return;
+        } else if (strcmp(argv[1], "enable") == 0) {
+            mstp_traceSetEnabled(TRUE);
+        } else if (strcmp(argv[1], "disable") == 0) {
+            mstp_traceSetEnabled(FALSE);
+        } else if (strcmp(argv[1], "reset") == 0) {
+            mstp_trace_reset(shm);
+        } else {
+            unixctl_command_reply_error(conn,
+                     "Invalid argument, use enable, disable, reset or dump");
+            return;
+        }
+    }
+
+    ds_put_format(&ds, "Convergence trace : %s\n",
+                  mstp_trace_enabled(shm) ? "enabled" : "disabled");
+    ds_put_format(&ds, "Events            : %"PRIu64"\n\n",
+                  __atomic_load_n(&shm->nextEventId, __ATOMIC_RELAXED));
+    ds_put_format(&ds, "%-10s %10s %10s %10s %10s\n", "Stage", "Count",
+                  "Avg", "Max", "Lost");
+    for (i = 0; i < MSTP_TRACE_STAGE_MAX; i++) {
+        hist = &shm->stages[i];
+        ds_put_format(&ds, "%-10s %10"PRIu64" %8"PRIu64"us %8"PRIu64"us"
+                      " %10"PRIu64"\n", mstp_trace_stage_str(i), hist->cnt,
+                      hist->cnt ? (hist->sumNs / hist->cnt) / 1000 : 0,
+                      hist->maxNs / 1000, hist->lost);
+        if (hist->cnt) {
+            mstpd_trace_hist_dump(&ds, hist);
+        }
+    }
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstpd_sm_history_unixctl
+ *
+ * Purpose:   Show the last state machine transitions kept by the flight
+ *            recorder, oldest first
+ *
+ * Params:    argv[1] -> number of transitions to show (optional)
+ *
+ * Returns:   none
+ *
+ * Globals:   none
+ **PROC-**********************************************************************/
+
+void mstpd_sm_history_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    int count = 100;
+
+    if (argc > 1) {
+        count = atoi(argv[1]);
+        if (count <= 0) {
+            unixctl_command_reply_error(conn, "Invalid count");
+            return;
+        }
+    }
+
+    mstp_smRecDump(&ds, count);
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstpd_daemon_bpdu_policer_unixctl
+ *
+ * Purpose:   Show the BPDU ingress policer of every port
+ *
+ * Params:    argv[1] -> "reset" clears the drop counters (optional)
+ *
+ * Returns:   none
+ *
+ * Globals:   none
+ **PROC-**********************************************************************/
+
+void mstpd_daemon_bpdu_policer_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    MSTP_RX_POLICER_STATS_t st;
+    struct iface_data *idp;
+    bool reset = false;
+    LPORT_t lport;
+
+    if (argc > 1) {
+        if (strcmp(argv[1], "reset") != 0) {
+            unixctl_command_reply_error(conn, "Usage: [reset]");
+            return;
+        }
+        reset = true;
+    }
+
+    ds_put_format(&ds, "%-12s %8s %8s %12s %8s %s\n", "Port", "Rate",
+                  "Burst", "Dropped", "Exceeded", "State");
+    for (lport = 1; lport <= MAX_LPORTS; lport++) {
+        idp = find_iface_data_by_index(lport);
+        if (!idp) {
+            continue;
+        }
+        if (reset) {
+            mstp_rxPolicerStatsClear(lport);
+        }
+        mstp_rxPolicerStatsGet(lport, &st);
+        if (!st.rate) {
+            ds_put_format(&ds, "%-12s %8s %8s %12"PRIu64" %8"PRIu64" %s\n",
+                          idp->name, "-", "-", st.dropCnt, st.exceedCnt,
+                          "off");
+            continue;
+        }
+        ds_put_format(&ds, "%-12s %8u %8u %12"PRIu64" %8"PRIu64" %s\n",
+                      idp->name, st.rate, st.burst, st.dropCnt,
+                      st.exceedCnt, st.exceeding ? "dropping" : "ok");
+    }
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstpd_daemon_rx_socket_unixctl
+ *
+ * Purpose:   Show the kernel counters of the BPDU socket of every port
+ *
+ * Params:    argv[1] -> "reset" clears the counters (optional)
+ *
+ * Returns:   none
+ *
+ * Globals:   none
+ **PROC-**********************************************************************/
+
+void mstpd_daemon_rx_socket_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    MSTP_RX_SOCK_STATS_t st;
+    struct iface_data *idp;
+    LPORT_t lport;
+
+    if ((argc > 1) && (strcmp(argv[1], "reset") != 0)) {
+        unixctl_command_reply_error(conn, "Usage: [reset]");
+        return;
+    }
+
+    ds_put_format(&ds, "%-12s %12s %12s\n", "Port", "Received",
+                  "Overrun");
+    for (lport = 1; lport <= MAX_LPORTS; lport++) {
+        idp = find_iface_data_by_index(lport);
+        if (!idp) {
+            continue;
+        }
+        if (argc > 1) {
+            mstp_rxSockStatsClear(lport);
+        }
+        mstp_rxSockStatsGet(lport, &st);
+        ds_put_format(&ds, "%-12s %12"PRIu64" %12"PRIu64"\n", idp->name,
+                      st.packets, st.drops);
+    }
+    ds_put_cstr(&ds, "Received counts the frames that passed the BPDU "
+                "filter, Overrun those of them\nlost to a full socket "
+                "buffer.\n");
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstpd_daemon_msti_workers_unixctl
+ *
+ * Purpose:   Show or set the number of MSTI worker threads, and the time
+ *            taken by the parallel MSTI root elections
+ *
+ * Params:    argv[1] -> number of threads, 0 turns the pool off, or
+ *                       "reset" to clear the timings (optional)
+ *
+ * Returns:   none
+ *
+ * Globals:   none
+ **PROC-**********************************************************************/
+
+void mstpd_daemon_msti_workers_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    MSTP_MSTI_POOL_STATS_t st;
+    bool reset = false;
+
+    if (argc > 1) {
+        if (strcmp(argv[1], "reset") == 0) {
+            reset = true;
+        } else if (!isdigit((unsigned char)argv[1][0]) ||
+                   !mstp_mstiPoolSetWorkers(atoi(argv[1]))) {
+            ds_put_format(&ds, "Invalid count, range is 0-%d",
+                          MSTP_MSTI_WORKERS_MAX);
+            unixctl_command_reply_error(conn, ds_cstr(&ds));
+            ds_destroy(&ds);
+            return;
+        }
+    }
+
+    mstp_mstiPoolStatsGet(&st, reset);
+    ds_put_format(&ds, "MSTI workers      : %u (%u running)\n",
+                  st.workers, st.running);
+    ds_put_format(&ds, "Root elections    : %"PRIu64" (%"PRIu64" MSTIs, "
+                  "%"PRIu64" by the workers)\n", st.runCnt, st.electCnt,
+                  st.workerElectCnt);
+    ds_put_format(&ds, "Election usec     : last %"PRIu64", max %"PRIu64
+                  ", avg %"PRIu64"\n", st.lastUsec, st.maxUsec,
+                  st.runCnt ? (st.totalUsec / st.runCnt) : 0);
+    ds_put_format(&ds, "Role selection    : protocol thread, MSTID order\n");
+    ds_put_format(&ds, "Boundary syncs    : %"PRIu64"\n", st.syncCnt);
+    ds_put_format(&ds, "Sync time usec    : last %"PRIu64", max %"PRIu64
+                  ", avg %"PRIu64"\n", st.syncLastUsec, st.syncMaxUsec,
+                  st.syncCnt ? (st.syncTotalUsec / st.syncCnt) : 0);
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstpd_daemon_memory_unixctl
+ *
+ * Purpose:   Show the memory taken by the per-Port data of the trees: the
+ *            state machine data in the hot port arenas, the debug counters
+ *            and the port role history in the cold ones
+ *
+ * Params:    argv[1] -> MSTI, 0 for the CIST (optional, all trees if
+ *                       absent)
+ *
+ * Returns:   none
+ *
+ * Globals:   none
+ **PROC-**********************************************************************/
+
+void mstpd_daemon_memory_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    MSTP_PORT_ARENA_STATS_t st;
+    MSTP_PORT_ARENA_STATS_t total;
+    int first = MSTP_CISTID;
+    int last = MSTP_MSTID_MAX;
+    int mstid;
+    int lport;
+    uint32_t commPorts = 0;
+
+    if (argc > 1) {
+        if (!isdigit((unsigned char)argv[1][0]) ||
+            (atoi(argv[1]) > MSTP_MSTID_MAX)) {
+            ds_put_format(&ds, "Invalid MSTI, range is 0-%d", MSTP_MSTID_MAX);
+            unixctl_command_reply_error(conn, ds_cstr(&ds));
+            ds_destroy(&ds);
+            return;
+        }
+        first = last = atoi(argv[1]);
+    }
+
+    ds_put_format(&ds, "Port data size    : CIST %zu hot + %zu cold, "
+                  "MSTI %zu hot + %zu cold bytes\n",
+                  sizeof(MSTP_CIST_PORT_INFO_t), sizeof(MSTP_CIST_PORT_COLD_t),
+                  sizeof(MSTP_MSTI_PORT_INFO_t), sizeof(MSTP_MSTI_PORT_COLD_t));
+    ds_put_format(&ds, "%-5s %6s %6s %10s %10s %10s\n", "Tree", "Ports",
+                  "Chunks", "Hot", "Cold", "Per port");
+
+    memset(&total, 0, sizeof(total));
+    for (mstid = first; mstid <= last; mstid++) {
+        mstp_portArenaStatsGet(mstid, &st);
+        if (!st.chunks && (first != last)) {
+            continue;
+        }
+        total.ports += st.ports;
+        total.chunks += st.chunks;
+        total.hotBytes += st.hotBytes;
+        total.coldBytes += st.coldBytes;
+        if (mstid == MSTP_CISTID) {
+            ds_put_format(&ds, "%-5s", "CIST");
+        } else {
+            ds_put_format(&ds, "%-5d", mstid);
+        }
+        ds_put_format(&ds, " %6u %6u %10"PRIu64" %10"PRIu64" %10"PRIu64"\n",
+                      st.ports, st.chunks, st.hotBytes, st.coldBytes,
+                      st.ports ? ((st.hotBytes + st.coldBytes) / st.ports) : 0);
+    }
+    if (first != last) {
+        ds_put_format(&ds, "%-5s %6u %6u %10"PRIu64" %10"PRIu64" %10"PRIu64
+                      "\n", "Total", total.ports, total.chunks,
+                      total.hotBytes, total.coldBytes,
+                      total.ports ? ((total.hotBytes + total.coldBytes) /
+                                     total.ports) : 0);
+
+        for (lport = 1; lport <= MAX_LPORTS; lport++) {
+            if (MSTP_COMM_PORT_PTR(lport)) {
+                commPorts++;
+            }
+        }
+        ds_put_format(&ds, "Common port data  : %u ports, %zu bytes\n",
+                      commPorts, commPorts * sizeof(MSTP_COMM_PORT_INFO_t));
+    }
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstpd_daemon_warm_restart_unixctl
+ *
+ * Purpose:   Show the warm restart checkpoint settings, how the daemon
+ *            started, the time it took the checkpointed ports to be
+ *            restored, and the cost of writing the checkpoint; or set how
+ *            often it is written and its grace window
+ *
+ * Params:    argv[1] -> "interval" or "grace" (optional)
+ *            argv[2] -> seconds, an interval of 0 stops checkpointing
+ *
+ * Returns:   none
+ *
+ * Globals:   none
+ **PROC-**********************************************************************/
+
+void mstpd_daemon_warm_restart_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    MSTP_CKPT_STATS_t st;
+
+    if (argc == 2) {
+        unixctl_command_reply_error(conn, "Missing value");
+        return;
+    }
+    if (argc > 2) {
+        if (strcmp(argv[1], "interval") == 0) {
+            if (!isdigit((unsigned char)argv[2][0]) ||
+                !mstp_ckptSetInterval(atoi(argv[2]))) {
+                ds_put_format(&ds, "Invalid interval, range is 0-%d",
+                              MSTP_CKPT_INTERVAL_MAX);
+            }
+        } else if (strcmp(argv[1], "grace") == 0) {
+            if (!isdigit((unsigned char)argv[2][0]) ||
+                !mstp_ckptSetGrace(atoi(argv[2]))) {
+                ds_put_format(&ds, "Invalid grace, range is %d-%d",
+                              MSTP_CKPT_GRACE_MIN, MSTP_CKPT_GRACE_MAX);
+            }
+        } else {
+            ds_put_cstr(&ds, "Usage: [interval N|grace N]");
+        }
+        if (ds.length) {
+            unixctl_command_reply_error(conn, ds_cstr(&ds));
+            ds_destroy(&ds);
+            return;
+        }
+    }
+
+    mstp_ckptStatsGet(&st);
+    if (st.interval) {
+        ds_put_format(&ds, "Checkpoint        : every %u sec, grace %u sec\n",
+                      st.interval, st.grace);
+    } else {
+        ds_put_format(&ds, "Checkpoint        : off, grace %u sec\n",
+                      st.grace);
+    }
+    ds_put_format(&ds, "Written           : %"PRIu64" times, last %u cells "
+                  "in %"PRIu64" usec, max %"PRIu64" usec\n", st.writeCnt,
+                  st.lastEntries, st.lastWriteUsec, st.maxWriteUsec);
+    if (!st.warm) {
+        ds_put_cstr(&ds, "Last start        : cold\n");
+    } else {
+        ds_put_format(&ds, "Last start        : warm, checkpoint %"PRIu64
+                      " msec old, %u ports\n", st.ckptAgeUsec / 1000,
+                      st.heldPorts);
+        ds_put_format(&ds, "Restored          : %u ports (%u cells), "
+                      "%u skipped, %u not enabled in time\n",
+                      st.restoredPorts, st.restoredCells, st.skippedPorts,
+                      st.releasedPorts);
+        if (st.stableUsec) {
+            ds_put_format(&ds, "Restart to stable : %"PRIu64" msec\n",
+                          st.stableUsec / 1000);
+        } else {
+            ds_put_cstr(&ds, "Restart to stable : pending\n");
+        }
+    }
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
+/*---------------------------------------------------------------------------
+ * Parse a VLAN list "V[-V][,V[-V]]..." of a region plan and map its VLANs
+ * to 'mstid' in 'table'. Returns FALSE if the list is malformed.
+ *---------------------------------------------------------------------------*/
+static bool
+mstpd_region_plan_map_vlans(MSTID_t *table, MSTID_t mstid, const char *list)
+{
+    const char *p = list;
+
+    while (*p) {
+        unsigned long first, last;
+        char *end;
+
+        if (!isdigit((unsigned char)*p)) {
+            return false;
+        }
+        first = last = strtoul(p, &end, 10);
+        if (*end == '-') {
+            p = end + 1;
+            if (!isdigit((unsigned char)*p)) {
+                return false;
+            }
+            last = strtoul(p, &end, 10);
+        }
+        if (first < MSTP_MST_CFG_TBL_FIRST_VID_IDX ||
+            last > MSTP_MST_CFG_TBL_LAST_VID_IDX || first > last ||
+            (*end != ',' && *end != '\0')) {
+            return false;
+        }
+        for (; first <= last; first++) {
+            table[first] = htons(mstid);
+        }
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return true;
+}
+
+/*---------------------------------------------------------------------------
+ * Fill in the running MST Configuration from the OVSDB thread's copy of the
+ * config, which the unixctl commands run next to.
+ *---------------------------------------------------------------------------*/
+static void
+mstpd_region_plan_current(MSTP_RGN_PLAN_t *plan)
+{
+    MSTID_t mstid;
+    VID_t vid;
+
+    memset(&plan->cur, 0, sizeof(plan->cur));
+    memcpy(plan->cur.configName, mstp_global_conf.config_name,
+           strnlen(mstp_global_conf.config_name, MSTP_MST_CONFIG_NAME_LEN));
+    plan->cur.revisionLevel = mstp_global_conf.config_revision;
+
+    /* From the highest MSTI, so a VID in two of them gets the lowest one */
+    memset(plan->curTable, 0, sizeof(plan->curTable));
+    for (mstid = MSTP_INSTANCES_MAX; mstid >= MSTP_MSTID_MIN; mstid--) {
+        if (!msti_lookup[mstid]) {
+            continue;
+        }
+        for (vid = find_first_vid_set(&msti_lookup[mstid]->vlans);
+             IS_VALID_VID(vid) && vid <= MSTP_MST_CFG_TBL_LAST_VID_IDX;
+             vid = find_next_vid(&msti_lookup[mstid]->vlans, vid)) {
+            plan->curTable[vid] = htons(mstid);
+        }
+    }
+}
+
+static void
+mstpd_region_plan_put_digest(struct ds *ds, const uint8_t *digest)
+{
+    int i;
+
+    ds_put_cstr(ds, "0x");
+    for (i = 0; i < MSTP_DIGEST_SIZE; i++) {
+        ds_put_format(ds, "%.2X", digest[i]);
+    }
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstpd_daemon_region_plan_unixctl
+ *
+ * Purpose:   Evaluate a proposed MST Configuration without applying it:
+ *            show its Configuration Digest, the VLANs each MSTI would gain
+ *            and lose, and for every port a neighbour's MST BPDU was heard
+ *            on, whether it is a region boundary now and would be with the
+ *            plan. The plan starts from the configured mapping.
+ *
+ * Params:    argv[1..] -> "name=NAME", "revision=N", "MSTID:VLANS" to map
+ *                         VLANS (e.g. "10-20,30") to MSTID, 0 for the
+ *                         CIST, or "MSTID:none" to map the VLANs of MSTID
+ *                         back to the CIST
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_global_conf, msti_lookup, idp_lookup
+ **PROC-**********************************************************************/
+
+void mstpd_daemon_region_plan_unixctl(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    MSTP_RGN_PLAN_t *plan;
+    MSTP_RGN_PLAN_RESULT_t res;
+    MSTP_MST_CONFIGURATION_ID_t peer;
+    uint32_t age;
+    MSTID_t mstid;
+    LPORT_t lport;
+    VID_t vid;
+    int i;
+
+    plan = xzalloc(sizeof(*plan));
+    mstpd_region_plan_current(plan);
+    plan->plan = plan->cur;
+    memcpy(plan->planTable, plan->curTable, sizeof(plan->planTable));
+
+    for (i = 1; i < argc; i++) {
+        const char *colon = strchr(argv[i], ':');
+        char *end;
+
+        if (strncmp(argv[i], "name=", 5) == 0) {
+            if (strlen(argv[i] + 5) > MSTP_MST_CONFIG_NAME_LEN) {
+                ds_put_format(&ds, "Name longer than %d characters",
+                              MSTP_MST_CONFIG_NAME_LEN);
+                break;
+            }
+            memset(plan->plan.configName, 0, MSTP_MST_CONFIG_NAME_LEN);
+            memcpy(plan->plan.configName, argv[i] + 5, strlen(argv[i] + 5));
+        } else if (strncmp(argv[i], "revision=", 9) == 0) {
+            unsigned long rev = strtoul(argv[i] + 9, &end, 10);
+
+            if (!isdigit((unsigned char)argv[i][9]) || *end || rev > 65535) {
+                ds_put_cstr(&ds, "Invalid revision, range is 0-65535");
+                break;
+            }
+            plan->plan.revisionLevel = rev;
+        } else if (colon && isdigit((unsigned char)argv[i][0])) {
+            unsigned long m = strtoul(argv[i], &end, 10);
+
+            if (end != colon || m > MSTP_INSTANCES_MAX) {
+                ds_put_format(&ds, "Invalid MSTID in '%s', range is 0-%d",
+                              argv[i], MSTP_INSTANCES_MAX);
+                break;
+            }
+            mstid = m;
+            if (strcmp(colon + 1, "none") == 0) {
+                if (mstid == MSTP_CISTID) {
+                    ds_put_cstr(&ds, "VLANs of the CIST cannot be unmapped");
+                    break;
+                }
+                for (vid = MSTP_MST_CFG_TBL_FIRST_VID_IDX;
+                     vid <= MSTP_MST_CFG_TBL_LAST_VID_IDX; vid++) {
+                    if (plan->planTable[vid] == htons(mstid)) {
+                        plan->planTable[vid] = 0;
+                    }
+                }
+            } else if (!mstpd_region_plan_map_vlans(plan->planTable, mstid,
+                                                    colon + 1)) {
+                ds_put_format(&ds, "Invalid VLAN list in '%s', VLANs are "
+                              "%d-%d", argv[i], MSTP_MST_CFG_TBL_FIRST_VID_IDX,
+                              MSTP_MST_CFG_TBL_LAST_VID_IDX);
+                break;
+            }
+        } else {
+            ds_put_cstr(&ds, "Usage: [name=NAME] [revision=N] "
+                        "[MSTID:VLANS|MSTID:none]...");
+            break;
+        }
+    }
+    if (ds.length) {
+        unixctl_command_reply_error(conn, ds_cstr(&ds));
+        ds_destroy(&ds);
+        free(plan);
+        return;
+    }
+
+    mstp_rgnPlanEval(plan, &res);
+
+    ds_put_format(&ds, "Name       : %.*s", MSTP_MST_CONFIG_NAME_LEN,
+                  (char *)plan->cur.configName);
+    if (memcmp(plan->cur.configName, plan->plan.configName,
+               MSTP_MST_CONFIG_NAME_LEN)) {
+        ds_put_format(&ds, " -> %.*s", MSTP_MST_CONFIG_NAME_LEN,
+                      (char *)plan->plan.configName);
+    }
+    ds_put_format(&ds, "\nRevision   : %u", plan->cur.revisionLevel);
+    if (plan->cur.revisionLevel != plan->plan.revisionLevel) {
+        ds_put_format(&ds, " -> %u", plan->plan.revisionLevel);
+    }
+    ds_put_cstr(&ds, "\nDigest     : ");
+    mstpd_region_plan_put_digest(&ds, plan->cur.digest);
+    if (memcmp(plan->cur.digest, plan->plan.digest, MSTP_DIGEST_SIZE)) {
+        ds_put_cstr(&ds, " -> ");
+        mstpd_region_plan_put_digest(&ds, plan->plan.digest);
+    }
+    ds_put_format(&ds, "\nVLANs moved: %u\n", res.movedVids);
+    if (res.movedVids) {
+        ds_put_cstr(&ds, "  MSTID  Gains  Loses\n");
+        for (mstid = MSTP_CISTID; mstid <= MSTP_INSTANCES_MAX; mstid++) {
+            if (res.vidsIn[mstid] || res.vidsOut[mstid]) {
+                ds_put_format(&ds, "  %-5u  %-5u  %-5u\n", mstid,
+                              res.vidsIn[mstid], res.vidsOut[mstid]);
+            }
+        }
+    }
+
+    ds_put_format(&ds, "Neighbours : %u heard in the last %d sec, "
+                  "%u boundary now, %u with the plan\n",
+                  PortMap_getNumOfPortsSet(&res.peerPorts),
+                  MSTP_RGN_PEER_AGE_MAX_SEC,
+                  PortMap_getNumOfPortsSet(&res.boundaryCur),
+                  PortMap_getNumOfPortsSet(&res.boundaryPlan));
+    if (are_any_ports_set(&res.peerPorts)) {
+        ds_put_format(&ds, "  %-10s %-32s %-5s %-34s %-8s %-8s\n", "Port",
+                      "Neighbour name", "Rev", "Digest", "Now", "Planned");
+    }
+    for (lport = find_first_port_set(&res.peerPorts);
+         IS_VALID_LPORT(lport);
+         lport = find_next_port_set(&res.peerPorts, lport)) {
+        char name[24];
+
+        if (!mstp_rgnPeerGet(lport, &peer, &age)) {
+            continue;
+        }
+        if (lport <= MAX_ENTRIES_IN_POOL && idp_lookup[lport]) {
+            snprintf(name, sizeof name, "%s", idp_lookup[lport]->name);
+        } else {
+            snprintf(name, sizeof name, "lport %d", lport);
+        }
+        ds_put_format(&ds, "  %-10s %-32.*s %-5u ", name,
+                      MSTP_MST_CONFIG_NAME_LEN, (char *)peer.configName,
+                      peer.revisionLevel);
+        mstpd_region_plan_put_digest(&ds, peer.digest);
+        ds_put_format(&ds, " %-8s %-8s\n",
+                      is_port_set(&res.boundaryCur, lport) ?
+                      "boundary" : "internal",
+                      is_port_set(&res.boundaryPlan, lport) ?
+                      "boundary" : "internal");
+    }
+    ds_put_format(&ds, "Evaluated in %"PRIu64" usec\n", res.evalUsec);
+
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+    free(plan);
+}
+
+/*---------------------------------------------------------------------------
+ * Configuration Digest timing asked for by 'mstpd/daemon/mstp_digest'. The
+ * digests are calculated on a thread of their own so that neither the
+ * OVSDB nor the protocol thread waits for them; the OVSDB thread replies
+ * once they are done, see 'mstpd_daemon_digest_bench_run'. 'conn', 'ds'
+ * and 'seqSeen' are the OVSDB thread's, the results are under 'lock'.
+ *---------------------------------------------------------------------------*/
+static struct {
+    pthread_mutex_t      lock;
+    struct seq          *seq;
+    uint64_t             seqSeen;
+    struct unixctl_conn *conn;           /* request being timed */
+    struct ds            ds;             /* its dump */
+    uint32_t             count;
+    bool                 done;
+    bool                 same;
+    uint64_t             keyedUsec;
+    uint64_t             plainUsec;
+    uint64_t             cachedUsec;
+} mstpd_digestBench = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static void *
+mstpd_digest_bench_thread(void *arg OVS_UNUSED)
+{
+    uint8_t  digest[MSTP_DIGEST_SIZE];
+    uint64_t keyedUsec;
+    uint64_t plainUsec;
+    uint64_t cachedUsec;
+    bool     same;
+
+    same = mstp_mstConfigurationDigestBench(mstpd_digestBench.count,
+                                            &keyedUsec, &plainUsec,
+                                            &cachedUsec, digest);
+
+    pthread_mutex_lock(&mstpd_digestBench.lock);
+    mstpd_digestBench.same = same;
+    mstpd_digestBench.keyedUsec = keyedUsec;
+    mstpd_digestBench.plainUsec = plainUsec;
+    mstpd_digestBench.cachedUsec = cachedUsec;
+    mstpd_digestBench.done = true;
+    pthread_mutex_unlock(&mstpd_digestBench.lock);
+
+    seq_change(mstpd_digestBench.seq);
+    return NULL;
+}
+
 /**PROC+**********************************************************************
  * Name:      mstpd_daemon_digest_unixctl_list
  *
- * Purpose:   Show MSTP config digest
+ * Purpose:   Show MSTP config digest, and time the Configuration Digest of
+ *            the mapping if asked to. A timed request is replied to by
+ *            'mstpd_daemon_digest_bench_run' once the timing is done.
  *
- * Params:    none
+ * Params:    argv[1] -> digests to time (optional)
  *
  * Returns:   none
  *
- * Globals:   mstp_Bridge
+ * Globals:   mstpd_digestBench
  **PROC-**********************************************************************/
 
 void mstpd_daemon_digest_unixctl_list(struct unixctl_conn *conn, int argc,
                    const char *argv[], void *aux OVS_UNUSED)
 {
     struct ds ds = DS_EMPTY_INITIALIZER;
+    pthread_t thread;
+    int rc;
+
+    if (argc > 1) {
+        if (!isdigit((unsigned char)argv[1][0]) ||
+            (atoi(argv[1]) < 1) || (atoi(argv[1]) > MSTP_DIGEST_BENCH_MAX)) {
+            ds_put_format(&ds, "Invalid count, range is 1-%d",
+                          MSTP_DIGEST_BENCH_MAX);
+            unixctl_command_reply_error(conn, ds_cstr(&ds));
+            ds_destroy(&ds);
+            return;
+        }
+        if (mstpd_digestBench.conn) {
+            unixctl_command_reply_error(conn, "Digest timing in progress");
+            ds_destroy(&ds);
+            return;
+        }
+
+        if (!mstpd_digestBench.seq) {
+            mstpd_digestBench.seq = seq_create();
+        }
+        mstpd_digestBench.seqSeen = seq_read(mstpd_digestBench.seq);
+        mstpd_digestBench.count = atoi(argv[1]);
+        mstpd_digestBench.done = false;
+
+        rc = pthread_create(&thread, NULL, mstpd_digest_bench_thread, NULL);
+        if (rc) {
+            ds_put_format(&ds, "Digest timing not started, rc=%d", rc);
+            unixctl_command_reply_error(conn, ds_cstr(&ds));
+            ds_destroy(&ds);
+            return;
+        }
+        pthread_detach(thread);
+
+        mstpd_digestBench.conn = conn;
+        ds_init(&mstpd_digestBench.ds);
+        mstpd_daemon_digest_data_dump(&mstpd_digestBench.ds, argc, argv);
+        return;
+    }
 
     mstpd_daemon_digest_data_dump(&ds, argc, argv);
     unixctl_command_reply(conn, ds_cstr(&ds));
     ds_destroy(&ds);
 }
 
+/**PROC+**********************************************************************
+ * Name:      mstpd_daemon_digest_bench_run
+ *
+ * Purpose:   Reply to the timed 'mstpd/daemon/mstp_digest' request once its
+ *            digests are done. Called from the OVSDB thread's main loop.
+ *
+ * Params:    none
+ *
+ * Returns:   none
+ *
+ * Globals:   mstpd_digestBench
+ **PROC-**********************************************************************/
+void
+mstpd_daemon_digest_bench_run(void)
+{
+    struct ds *ds = &mstpd_digestBench.ds;
+    uint32_t count = mstpd_digestBench.count;
+    bool done;
+
+    if (!mstpd_digestBench.conn) {
+        return;
+    }
+    mstpd_digestBench.seqSeen = seq_read(mstpd_digestBench.seq);
+
+    pthread_mutex_lock(&mstpd_digestBench.lock);
+    done = mstpd_digestBench.done;
+    if (done) {
+        ds_put_format(ds, "Digest time : %u digests, %"PRIu64" nsec each "
+                      "with the key pads derived once, %"PRIu64" nsec "
+                      "deriving them, %"PRIu64" nsec from the cache, %s\n",
+                      count, mstpd_digestBench.keyedUsec * 1000 / count,
+                      mstpd_digestBench.plainUsec * 1000 / count,
+                      mstpd_digestBench.cachedUsec * 1000 / count,
+                      mstpd_digestBench.same ? "same digest"
+                                             : "DIGESTS DIFFER");
+    }
+    pthread_mutex_unlock(&mstpd_digestBench.lock);
+
+    if (done) {
+        unixctl_command_reply(mstpd_digestBench.conn, ds_cstr(ds));
+        ds_destroy(ds);
+        mstpd_digestBench.conn = NULL;
+    }
+}
+
+void
+mstpd_daemon_digest_bench_wait(void)
+{
+    if (mstpd_digestBench.conn) {
+        seq_wait(mstpd_digestBench.seq, mstpd_digestBench.seqSeen);
+    }
+}
+
 /**PROC+**********************************************************************
  * Name:      mstpd_daemon_digest_data_dump
  *
@@ -895,19 +2125,27 @@ void mstpd_daemon_digest_unixctl_list(struct unixctl_conn *conn, int argc,
  * Globals:   mstp_Bridge, mstp_MstiVidTable
  **PROC-**********************************************************************/
 void
-mstpd_daemon_digest_data_dump(struct ds *ds, int argc, const char *argv[])
+mstpd_daemon_digest_data_dump(struct ds *ds, int argc OVS_UNUSED,
+                              const char *argv[] OVS_UNUSED)
 {
-   MSTID_t mstid;
-   int     i;
-   int     indent;
-   int     length;
+   MSTID_t  mstid;
+   int      i;
+   int      indent;
+   int      length;
+   uint64_t calcCnt;
+   uint64_t reuseCnt;
 
    ds_put_format(ds, "\n");
 
    ds_put_format(ds, "Digest Value: 0x");
    for(i=0; i< MSTP_DIGEST_SIZE; i++)
       ds_put_format(ds, "%.2X",mstp_Bridge.MstConfigId.digest[i]);
-   ds_put_format(ds, "\n\n");
+   ds_put_format(ds, "\n");
+
+   mstp_digestCacheStatsGet(&calcCnt, &reuseCnt);
+   ds_put_format(ds, "Digest cache: %"PRIu64" calculated, %"PRIu64
+                 " reused\n", calcCnt, reuseCnt);
+   ds_put_format(ds, "\n");
 
    ds_put_format(ds, "MSTID VGRP# ""MAPPED VIDs\n");
    ds_put_format(ds, "----- ----- %n", &indent);
@@ -1563,6 +2801,16 @@ mstpd_daemon_comm_port_data_dump(struct ds *ds, int argc, const char *argv[])
                 port->useGlobalHelloTime, port->useCfgPathCost ? 'T' : 'F');
       }
 
+      {
+         MSTP_LPORT_COST_t cost;
+
+         mstp_lportCostGet(portNum, &cost);
+         ds_put_format(ds,"Auto PathCost : oper=%u applied=%u held=%c\n"
+                "                speedChanges=%u lagDamped=%u\n",
+                cost.operCost, cost.appliedCost, cost.held ? 'T' : 'F',
+                cost.speedChgCnt, cost.dampedCnt);
+      }
+
       ds_put_format(ds,"Per-Port Vars : txCount=%d, adminPointToPointMAC=%s\n",
              port->txCount,
              MSTP_ADMIN_PPMAC_s[port->adminPointToPointMAC]);
@@ -1619,6 +2867,19 @@ mstpd_daemon_comm_port_data_dump(struct ds *ds, int argc, const char *argv[])
       ds_put_format(ds,"inBpduError     : %s\n", port->inBpduError ? "Yes" : "No");
       ds_put_format(ds,"Errant BPDUs    : %d\n", MSTP_COMM_ERRANT_BPDU_COUNT(portNum));
       ds_put_format(ds,"dropBPDUs       : %s\n", port->dropBpdu ? "Yes" : "No" );
+      {
+         int type;
+
+         ds_put_format(ds,"BPDUs Tx/Rx     :");
+         for(type = MSTP_BPDU_TYPE_MSTP; type < MSTP_BPDU_TYPE_MAX; type++)
+         {
+            ds_put_format(ds," %s=%"PRIu64"/%"PRIu64, MSTP_BPDU_TYPE_s[type],
+                          port->bpduTxCnt[type], port->bpduRxCnt[type]);
+         }
+         ds_put_format(ds,"\n");
+      }
+      ds_put_format(ds,"BPDU rate Tx/Rx : %u/%u per sec (interval %u sec)\n",
+             port->dbxTxRate, port->dbxRxRate, mstp_util_get_stats_interval());
       ds_put_format(ds,"\n");
 
    }
@@ -1701,7 +2962,7 @@ mstp_showBpduFiltering(void)
          printf(" %3d    %4s    %9d   \n",
                        (int) lport,
                        (MSTP_COMM_IS_BPDU_FILTER(lport) ? "Yes" : "No"),
-                cistPortPtr->dbgCnts.errantBpduCnt);
+                cistPortPtr->cold->dbgCnts.errantBpduCnt);
       }
    }
    printf("\n");
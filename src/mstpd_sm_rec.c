@@ -0,0 +1,313 @@
+/*
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+/**********************************************************************************
+ *    File               : mstpd_sm_rec.c
+ *    Description        : MSTP state machine flight recorder. Every state
+ *                         transition is appended as a fixed-size record to a
+ *                         ring of the thread running the state machine; the
+ *                         records are only decoded when dumped.
+ **********************************************************************************/
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <util.h>
+#include <dynamic-string.h>
+#include <vswitch-idl.h>
+#include <openvswitch/vlog.h>
+#include "mstp_fsm.h"
+#include "mstp_cmn.h"
+#include "mstp_ovsdb_if.h"
+
+/* Records kept per thread; power of 2 */
+#define MSTP_SM_REC_RING_SIZE   4096
+
+/*---------------------------------------------------------------------------
+ * One state transition. The state names are the entries of the state
+ * machines' static name tables, so only their addresses are kept.
+ *---------------------------------------------------------------------------*/
+typedef struct mstp_sm_rec
+{
+   uint64_t     tsNs;                    /* CLOCK_MONOTONIC              */
+   const char  *oldState;
+   const char  *newState;
+   uint16_t     lport;                   /* 0 for per-tree machines      */
+   uint8_t      sm;                      /* MSTP_SM_TYPE_e               */
+   uint8_t      mstid;                   /* MSTP_SM_REC_NO_MSTID for
+                                          * per-port machines            */
+   uint8_t      cause;                   /* event being processed,
+                                          * mstpd_message_type           */
+   uint8_t      pad[3];
+
+} MSTP_SM_REC_t;
+
+typedef struct mstp_sm_rec_ring
+{
+   struct mstp_sm_rec_ring *next;
+   MSTP_THREAD_ROLE_t       role;
+   uint64_t                 head;        /* records ever written         */
+   MSTP_SM_REC_t            recs[MSTP_SM_REC_RING_SIZE];
+
+} MSTP_SM_REC_RING_t;
+
+/* a record copied out for the dump, with the thread that wrote it */
+typedef struct mstp_sm_rec_copy
+{
+   MSTP_SM_REC_t       rec;
+   MSTP_THREAD_ROLE_t  role;
+
+} MSTP_SM_REC_COPY_t;
+
+/* NOTE: this array is indexed by the values defined
+ *       in 'MSTP_SM_TYPE_e' enum list */
+static const char *const mstp_smRecSmName_s[MSTP_SM_MAX_BIT + 1] =
+{
+   "?",
+   "PIM",
+   "PRS",
+   "PRT",
+   "PRX",
+   "PST",
+   "TCM",
+   "PPM",
+   "PTX",
+   "PTI",
+   "BDM"
+};
+
+/* NOTE: this array is indexed by the values defined
+ *       in 'mstpd_message_type' enum list */
+static const char *const mstp_smRecCause_s[] =
+{
+   "-",
+   "timer",
+   "lport_up",
+   "lport_down",
+   "rx_bpdu",
+   "lport_add",
+   "lport_delete",
+   "admin_status",
+   "vlan_add",
+   "vlan_delete",
+   "msti_cfg_update",
+   "global_cfg",
+   "cist_cfg",
+   "cist_port_cfg",
+   "msti_cfg",
+   "msti_port_cfg",
+   "msti_cfg_delete",
+   "lport_info",
+   "config_reload",
+   "config_batch"
+};
+
+/* rings of all the threads that ran a state machine, never freed */
+static MSTP_SM_REC_RING_t *mstp_smRecRings = NULL;
+
+static __thread MSTP_SM_REC_RING_t *mstp_smRecRing = NULL;
+static __thread uint8_t             mstp_smRecCause = 0;
+
+static MSTP_SM_REC_RING_t *
+mstp_smRecRingCreate(void)
+{
+   MSTP_SM_REC_RING_t *ring;
+
+   ring = xzalloc(sizeof(*ring));
+   ring->role = mstp_getThreadRole();
+   ring->next = __atomic_load_n(&mstp_smRecRings, __ATOMIC_RELAXED);
+   while(!__atomic_compare_exchange_n(&mstp_smRecRings, &ring->next, ring,
+                                      FALSE, __ATOMIC_RELEASE,
+                                      __ATOMIC_RELAXED))
+      ;
+   mstp_smRecRing = ring;
+   return ring;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_smRecord
+ *
+ * Purpose:   Record a state machine transition in the calling thread's
+ *            ring. Called through the MSTP_SM_ST_PRINTF macros.
+ *
+ * Params:    sm       -> state machine (MSTP_SM_TYPE_e)
+ *            mstid    -> tree, MSTP_SM_REC_NO_MSTID for per-port machines
+ *            lport    -> port, 0 for per-tree machines
+ *            oldState -> name of the state left
+ *            newState -> name of the state entered
+ *
+ * Returns:   none
+ *
+ * Globals:   none
+ **PROC-**********************************************************************/
+void
+mstp_smRecord(int sm, int mstid, int lport, const char *oldState,
+              const char *newState)
+{
+   MSTP_SM_REC_RING_t *ring = mstp_smRecRing;
+   MSTP_SM_REC_t      *rec;
+   struct timespec     ts;
+
+   if(!ring)
+      ring = mstp_smRecRingCreate();
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+
+   rec = &ring->recs[ring->head & (MSTP_SM_REC_RING_SIZE - 1)];
+   rec->tsNs = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+   rec->oldState = oldState;
+   rec->newState = newState;
+   rec->lport = (uint16_t)lport;
+   rec->sm = (uint8_t)sm;
+   rec->mstid = (uint8_t)mstid;
+   rec->cause = mstp_smRecCause;
+   __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+}
+
+/* Tag the following records of the calling thread with the event type */
+void
+mstp_smRecSetCause(uint32_t msgType)
+{
+   mstp_smRecCause = (msgType < ARRAY_SIZE(mstp_smRecCause_s)) ?
+                     (uint8_t)msgType : 0;
+}
+
+static int
+mstp_smRecCmp(const void *a_, const void *b_)
+{
+   const MSTP_SM_REC_COPY_t *a = a_;
+   const MSTP_SM_REC_COPY_t *b = b_;
+
+   return (a->rec.tsNs < b->rec.tsNs) ? -1 :
+          (a->rec.tsNs > b->rec.tsNs) ? 1 : 0;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_smRecDump
+ *
+ * Purpose:   Decode the last 'count' state transitions of all the threads,
+ *            oldest first. Runs concurrently with the writers: the records
+ *            a writer may have overwritten while they were being copied
+ *            are dropped.
+ *
+ * Params:    ds    -> output
+ *            count -> number of transitions to show
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_smRecRings
+ **PROC-**********************************************************************/
+void
+mstp_smRecDump(struct ds *ds, uint32_t count)
+{
+   MSTP_SM_REC_RING_t *ring;
+   MSTP_SM_REC_COPY_t *copies;
+   MSTP_SM_REC_COPY_t *c;
+   struct timespec     mono;
+   struct timespec     real;
+   struct tm           tm;
+   uint64_t            nowMono;
+   uint64_t            head;
+   uint64_t            first;
+   uint64_t            i;
+   int64_t             wallNs;
+   time_t              sec;
+   size_t              n = 0;
+   size_t              max = 0;
+   size_t              start;
+   char                when[16];
+   char                tree[8];
+
+   if(count > MSTP_SM_REC_RING_SIZE)
+      count = MSTP_SM_REC_RING_SIZE;
+
+   for(ring = __atomic_load_n(&mstp_smRecRings, __ATOMIC_ACQUIRE); ring;
+       ring = ring->next)
+      max += count;
+   if(!max)
+   {
+      ds_put_cstr(ds, "No state transitions recorded\n");
+      return;
+   }
+
+   copies = xmalloc(max * sizeof(*copies));
+   for(ring = __atomic_load_n(&mstp_smRecRings, __ATOMIC_ACQUIRE); ring;
+       ring = ring->next)
+   {
+      head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+      first = (head > count) ? (head - count) : 0;
+      start = n;
+      for(i = first; i < head; i++)
+      {
+         copies[n].rec = ring->recs[i & (MSTP_SM_REC_RING_SIZE - 1)];
+         copies[n].role = ring->role;
+         n++;
+      }
+
+      /* drop what the writer got to while we were copying */
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+      if(head >= MSTP_SM_REC_RING_SIZE)
+      {
+         uint64_t oldest = head - MSTP_SM_REC_RING_SIZE + 1;
+         size_t   skip = (oldest > first) ? (size_t)(oldest - first) : 0;
+
+         if(skip > (n - start))
+            skip = n - start;
+         memmove(&copies[start], &copies[start + skip],
+                 (n - start - skip) * sizeof(*copies));
+         n -= skip;
+      }
+   }
+
+   qsort(copies, n, sizeof(*copies), mstp_smRecCmp);
+   start = (n > count) ? (n - count) : 0;
+
+   clock_gettime(CLOCK_MONOTONIC, &mono);
+   clock_gettime(CLOCK_REALTIME, &real);
+   nowMono = (uint64_t)mono.tv_sec * 1000000000ULL + (uint64_t)mono.tv_nsec;
+
+   ds_put_format(ds, "%-15s %-8s %-4s %-4s %-5s %-13s    %-13s %s\n",
+                 "Time", "Thread", "SM", "MST", "Port", "Old state",
+                 "New state", "Cause");
+   for(i = start; i < n; i++)
+   {
+      c = &copies[i];
+
+      wallNs = (int64_t)real.tv_sec * 1000000000LL + real.tv_nsec -
+               (int64_t)(nowMono - c->rec.tsNs);
+      sec = (time_t)(wallNs / 1000000000LL);
+      localtime_r(&sec, &tm);
+      strftime(when, sizeof(when), "%H:%M:%S", &tm);
+
+      if(c->rec.mstid == MSTP_SM_REC_NO_MSTID)
+         snprintf(tree, sizeof(tree), "-");
+      else
+         snprintf(tree, sizeof(tree), "%u", c->rec.mstid);
+
+      ds_put_format(ds, "%s.%06"PRId64" %-8s %-4s %-4s %-5u %-13s -> "
+                    "%-13s %s\n", when, (wallNs % 1000000000LL) / 1000,
+                    mstp_threadRoleName(c->role),
+                    (c->rec.sm <= MSTP_SM_MAX_BIT) ?
+                    mstp_smRecSmName_s[c->rec.sm] : mstp_smRecSmName_s[0],
+                    tree, c->rec.lport,
+                    c->rec.oldState ? c->rec.oldState : "?",
+                    c->rec.newState ? c->rec.newState : "?",
+                    mstp_smRecCause_s[c->rec.cause]);
+   }
+   free(copies);
+}
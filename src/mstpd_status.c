@@ -0,0 +1,524 @@
+/*
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+/**********************************************************************************
+ *    File               : mstpd_status.c
+ *    Description        : Writer side of the MSTP status snapshot. The
+ *                         protocol thread copies the operational state of
+ *                         all trees and ports into shared memory so that show
+ *                         commands don't have to walk the OVSDB status rows.
+ **********************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <util.h>
+#include <unixctl.h>
+#include <dynamic-string.h>
+#include <openvswitch/vlog.h>
+#include "mstp_fsm.h"
+#include "mstp_inlines.h"
+#include "mstp_ovsdb_if.h"
+#include "mstp_cmn.h"
+#include "mstp_status.h"
+#include "mstp.h"
+
+VLOG_DEFINE_THIS_MODULE(mstpd_status);
+
+BUILD_ASSERT_DECL(MSTP_STATUS_MAX_TREES == MSTP_INSTANCES_MAX + 1);
+BUILD_ASSERT_DECL(MSTP_STATUS_MAX_PORTS == MAX_LPORTS + 1);
+BUILD_ASSERT_DECL(MSTP_STATUS_ROLE_MASTER == (int)MSTP_PORT_ROLE_MASTER);
+
+/* Minimum interval between two publishes triggered by received BPDUs.
+ * Every other protocol event (timer tick, config, link change) publishes
+ * unconditionally. */
+#define MSTP_STATUS_BPDU_PUBLISH_INTERVAL_MS  100
+
+static MSTP_STATUS_SHM_t *mstp_status_shm = NULL;
+static uint64_t           mstp_status_last_publish_ms = 0;
+/* a BPDU changed the state but its publish was rate limited. Written by
+ * the protocol thread, read by the status dump on the unixctl thread. */
+static bool               mstp_status_dirty = false;
+static uint64_t           mstp_status_deferred_cnt = 0;
+/* Tree ports whose role, state, cost or port priority vector changed since
+ * they were last copied. Received BPDUs and timer ticks copy only these,
+ * any other event copies every port. Protocol thread only. */
+static PORT_MAP           mstp_status_chgPorts[MSTP_INSTANCES_MAX + 1];
+/* Serializes the protocol thread's publishes with the main thread closing
+ * the snapshot at exit, so the segment keeps a single writer at a time. */
+static pthread_mutex_t    mstp_status_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool               mstp_status_closed = false;
+
+static uint64_t
+mstp_status_now_ms(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ((uint64_t)ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+}
+
+static inline void
+mstp_status_copy_bid(MSTP_STATUS_BID_t *dst, const MSTP_BRIDGE_IDENTIFIER_t *src)
+{
+   dst->priority = src->priority;
+   memcpy(dst->mac, src->mac_address, sizeof(dst->mac));
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_statusInit
+ *
+ * Purpose:   Create (or reuse) the shared memory segment holding the
+ *            operational status snapshot. The segment is never unlinked so
+ *            that CLI sessions keep a valid mapping across mstpd restarts.
+ *
+ * Params:    none
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_status_shm
+ **PROC-**********************************************************************/
+void
+mstp_statusInit(void)
+{
+   void *addr;
+   int   fd;
+
+   fd = shm_open(MSTP_STATUS_SHM_NAME, O_CREAT | O_RDWR, 0644);
+   if (fd < 0)
+   {
+      VLOG_ERR("%s: shm_open failed (%s), status snapshot disabled",
+               __FUNCTION__, strerror(errno));
+      return;
+   }
+
+   if (ftruncate(fd, sizeof(MSTP_STATUS_SHM_t)) < 0)
+   {
+      VLOG_ERR("%s: ftruncate failed (%s), status snapshot disabled",
+               __FUNCTION__, strerror(errno));
+      close(fd);
+      return;
+   }
+
+   addr = mmap(NULL, sizeof(MSTP_STATUS_SHM_t), PROT_READ | PROT_WRITE,
+               MAP_SHARED, fd, 0);
+   close(fd);
+   if (addr == MAP_FAILED)
+   {
+      VLOG_ERR("%s: mmap failed (%s), status snapshot disabled",
+               __FUNCTION__, strerror(errno));
+      return;
+   }
+
+   mstp_status_shm = (MSTP_STATUS_SHM_t *)addr;
+
+   /*------------------------------------------------------------------------
+    * Invalidate whatever a previous instance of the daemon left behind.
+    * 'seq' is preserved so a reader racing with the restart sees a change.
+    *------------------------------------------------------------------------*/
+   mstp_status_write_begin(mstp_status_shm);
+   memset(mstp_status_shm->trees, 0, sizeof(mstp_status_shm->trees));
+   memset(mstp_status_shm->lports, 0, sizeof(mstp_status_shm->lports));
+   memset(mstp_status_shm->ports, 0, sizeof(mstp_status_shm->ports));
+   mstp_status_shm->magic = MSTP_STATUS_MAGIC;
+   mstp_status_shm->version = MSTP_STATUS_VERSION;
+   mstp_status_shm->generation = 0;
+   mstp_status_shm->mstpEnabled = false;
+   mstp_status_write_end(mstp_status_shm);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_statusPortChg
+ *
+ * Purpose:   Note that the status of a port on a tree changed, so the next
+ *            publish copies it even if it only refreshes changed ports.
+ *            Called by the state machines of the protocol thread.
+ *
+ * Params:    mstid -> tree of the port (MSTP_CISTID for the CIST)
+ *            lport -> logical port number
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_status_chgPorts
+ **PROC-**********************************************************************/
+void
+mstp_statusPortChg(uint16_t mstid, LPORT_t lport)
+{
+   if ((mstid <= MSTP_INSTANCES_MAX) && IS_VALID_LPORT(lport))
+      set_port(&mstp_status_chgPorts[mstid], lport);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_statusPublishTree
+ *
+ * Purpose:   Copy bridge and per-port status of one tree into the snapshot
+ *
+ * Params:    mstid -> tree to copy (MSTP_CISTID for the CIST)
+ *            all   -> copy every port of the tree, otherwise only those
+ *                     changed since the last publish
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_Bridge, mstp_status_shm, mstp_status_chgPorts
+ **PROC-**********************************************************************/
+static void
+mstp_statusPublishTree(MSTID_t mstid, bool all)
+{
+   MSTP_STATUS_TREE_t *tree = &mstp_status_shm->trees[mstid];
+   MSTP_STATUS_PORT_t *sp;
+   PORT_MAP           *chgPorts = &mstp_status_chgPorts[mstid];
+   int                 lport;
+
+   if (!MSTP_INSTANCE_IS_VALID(mstid))
+   {
+      if (tree->valid)
+      {
+         memset(tree, 0, sizeof(*tree));
+         memset(mstp_status_shm->ports[mstid], 0,
+                sizeof(mstp_status_shm->ports[mstid]));
+      }
+      clear_port_map(chgPorts);
+      return;
+   }
+
+   /* a tree just created has none of its ports in the snapshot yet */
+   if (!tree->valid)
+      all = true;
+
+   tree->valid = true;
+   if (mstid == MSTP_CISTID)
+   {
+      MSTP_CIST_INFO_t *cistPtr = &MSTP_CIST_INFO;
+
+      tree->rootPortId = cistPtr->rootPortID;
+      tree->isRoot = MSTP_IS_THIS_BRIDGE_CIST_ROOT;
+      tree->remainingHops = cistPtr->rootTimes.hops;
+      mstp_status_copy_bid(&tree->bridgeId, &cistPtr->BridgeIdentifier);
+      mstp_status_copy_bid(&tree->rootId, &cistPtr->rootPriority.rootID);
+      mstp_status_copy_bid(&tree->rgnRootId, &cistPtr->rootPriority.rgnRootID);
+      tree->extRootPathCost = cistPtr->rootPriority.extRootPathCost;
+      tree->intRootPathCost = cistPtr->rootPriority.intRootPathCost;
+      tree->topologyChangeCnt = cistPtr->topologyChangeCnt;
+      tree->timeSinceTopologyChange = cistPtr->timeSinceTopologyChange;
+   }
+   else
+   {
+      MSTP_MSTI_INFO_t *mstiPtr = MSTP_MSTI_INFO(mstid);
+
+      tree->rootPortId = mstiPtr->rootPortID;
+      tree->isRoot = (mstiPtr->rootPortID == 0);
+      tree->remainingHops = mstiPtr->rootTimes.hops;
+      mstp_status_copy_bid(&tree->bridgeId, &mstiPtr->BridgeIdentifier);
+      mstp_status_copy_bid(&tree->rgnRootId, &mstiPtr->rootPriority.rgnRootID);
+      tree->extRootPathCost = 0;
+      tree->intRootPathCost = mstiPtr->rootPriority.intRootPathCost;
+      tree->topologyChangeCnt = mstiPtr->topologyChangeCnt;
+      tree->timeSinceTopologyChange = mstiPtr->timeSinceTopologyChange;
+   }
+
+   for (lport = all ? 1 : find_first_port_set(chgPorts);
+        IS_VALID_LPORT(lport);
+        lport = all ? lport + 1 : find_next_port_set(chgPorts, lport))
+   {
+      sp = &mstp_status_shm->ports[mstid][lport];
+
+      if (mstid == MSTP_CISTID)
+      {
+         MSTP_CIST_PORT_INFO_t *cistPortPtr = MSTP_CIST_PORT_PTR(lport);
+         MSTP_COMM_PORT_INFO_t *commPortPtr = MSTP_COMM_PORT_PTR(lport);
+
+         if (!cistPortPtr || !commPortPtr)
+         {
+            sp->valid = false;
+            continue;
+         }
+         sp->valid = true;
+         sp->role = cistPortPtr->role;
+         if (MSTP_CIST_PORT_IS_BIT_SET(cistPortPtr->bitMap,
+                                       MSTP_CIST_PORT_FORWARDING))
+            sp->state = MSTP_STATUS_STATE_FORWARDING;
+         else if (MSTP_CIST_PORT_IS_BIT_SET(cistPortPtr->bitMap,
+                                            MSTP_CIST_PORT_LEARNING))
+            sp->state = MSTP_STATUS_STATE_LEARNING;
+         else
+            sp->state = MSTP_STATUS_STATE_BLOCKING;
+         sp->priority = MSTP_GET_PORT_PRIORITY(cistPortPtr->portId);
+         sp->pathCost = commPortPtr->ExternalPortPathCost;
+         sp->forwardTransitions = cistPortPtr->cold->forwardTransitions;
+         sp->dsnPortId = cistPortPtr->portPriority.dsnPortID;
+         mstp_status_copy_bid(&sp->dsnBridgeId,
+                              &cistPortPtr->portPriority.dsnBridgeID);
+      }
+      else
+      {
+         MSTP_MSTI_PORT_INFO_t *mstiPortPtr = MSTP_MSTI_PORT_PTR(mstid, lport);
+
+         if (!mstiPortPtr)
+         {
+            sp->valid = false;
+            continue;
+         }
+         sp->valid = true;
+         sp->role = mstiPortPtr->role;
+         if (MSTP_MSTI_PORT_IS_BIT_SET(mstiPortPtr->bitMap,
+                                       MSTP_MSTI_PORT_FORWARDING))
+            sp->state = MSTP_STATUS_STATE_FORWARDING;
+         else if (MSTP_MSTI_PORT_IS_BIT_SET(mstiPortPtr->bitMap,
+                                            MSTP_MSTI_PORT_LEARNING))
+            sp->state = MSTP_STATUS_STATE_LEARNING;
+         else
+            sp->state = MSTP_STATUS_STATE_BLOCKING;
+         sp->priority = MSTP_GET_PORT_PRIORITY(mstiPortPtr->portId);
+         sp->pathCost = mstiPortPtr->InternalPortPathCost;
+         sp->forwardTransitions = mstiPortPtr->cold->forwardTransitions;
+         sp->dsnPortId = mstiPortPtr->portPriority.dsnPortID;
+         mstp_status_copy_bid(&sp->dsnBridgeId,
+                              &mstiPortPtr->portPriority.dsnBridgeID);
+      }
+   }
+
+   clear_port_map(chgPorts);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_statusPublish
+ *
+ * Purpose:   Refresh the shared status snapshot after a protocol event.
+ *            Called by the protocol thread only (single writer).
+ *            Received BPDUs are the only high rate event, publishes caused
+ *            by them are rate limited to one per
+ *            MSTP_STATUS_BPDU_PUBLISH_INTERVAL_MS. A rate limited publish
+ *            marks the snapshot dirty instead, it is then published by the
+ *            first BPDU batch boundary past the interval or by the next
+ *            timer tick, whichever comes first.
+ *            BPDU and timer driven publishes copy only the tree ports the
+ *            state machines reported changed (see 'mstp_statusPortChg'),
+ *            every other event may change any port and copies them all.
+ *
+ * Params:    msg_type -> type of the event just processed
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_Bridge, mstp_status_shm
+ **PROC-**********************************************************************/
+void
+mstp_statusPublish(uint32_t msg_type)
+{
+   MSTP_STATUS_LPORT_t *lp;
+   uint64_t             now = mstp_status_now_ms();
+   LPORT_t              lport;
+   MSTID_t              mstid;
+   bool                 all;
+
+   if (!mstp_status_shm)
+      return;
+
+   if ((msg_type == e_mstpd_rx_bpdu) &&
+       ((now - mstp_status_last_publish_ms) < MSTP_STATUS_BPDU_PUBLISH_INTERVAL_MS))
+   {
+      if (!__atomic_load_n(&mstp_status_dirty, __ATOMIC_RELAXED))
+      {
+         __atomic_add_fetch(&mstp_status_deferred_cnt, 1, __ATOMIC_RELAXED);
+         __atomic_store_n(&mstp_status_dirty, true, __ATOMIC_RELAXED);
+      }
+      return;
+   }
+
+   mstp_status_last_publish_ms = now;
+   __atomic_store_n(&mstp_status_dirty, false, __ATOMIC_RELAXED);
+   all = (msg_type != e_mstpd_rx_bpdu) && (msg_type != e_mstpd_timer);
+
+   pthread_mutex_lock(&mstp_status_mutex);
+   if (mstp_status_closed)
+   {
+      pthread_mutex_unlock(&mstp_status_mutex);
+      return;
+   }
+
+   mstp_status_write_begin(mstp_status_shm);
+
+   mstp_status_shm->mstpEnabled = MSTP_ENABLED;
+   mstp_status_shm->numOfValidTrees = MSTP_NUM_OF_VALID_TREES;
+
+   for (lport = 1; lport <= MAX_LPORTS; lport++)
+   {
+      MSTP_COMM_PORT_INFO_t *commPortPtr = MSTP_COMM_PORT_PTR(lport);
+      MSTP_CIST_PORT_INFO_t *cistPortPtr = MSTP_CIST_PORT_PTR(lport);
+      char                   name[PORTNAME_LEN] = {0};
+
+      lp = &mstp_status_shm->lports[lport];
+      if (commPortPtr && cistPortPtr)
+         intf_get_port_name(lport, name);
+      if (name[0] == '\0')
+      {
+         lp->valid = false;
+         continue;
+      }
+      lp->valid = true;
+      strncpy(lp->name, name, sizeof(lp->name) - 1);
+      lp->portEnabled = MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap,
+                                                  MSTP_PORT_PORT_ENABLED);
+      lp->operEdge = MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap,
+                                               MSTP_PORT_OPER_EDGE);
+      /* MST BPDUs only, as 'mstp_tx_bpdu'/'mstp_rx_bpdu' in OVSDB */
+      lp->bpduRxCnt = commPortPtr->bpduRxCnt[MSTP_BPDU_TYPE_MSTP];
+      lp->bpduTxCnt = commPortPtr->bpduTxCnt[MSTP_BPDU_TYPE_MSTP];
+   }
+
+   for (mstid = MSTP_CISTID; mstid <= MSTP_INSTANCES_MAX; mstid++)
+   {
+      mstp_statusPublishTree(mstid, all);
+   }
+
+   mstp_status_shm->generation++;
+   mstp_status_shm->publishTime = (int64_t)time(NULL);
+
+   mstp_status_write_end(mstp_status_shm);
+   pthread_mutex_unlock(&mstp_status_mutex);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_statusShutdown
+ *
+ * Purpose:   Mark the snapshot as not describing a running daemon, so CLI
+ *            sessions fall back to OVSDB as soon as mstpd exits. The
+ *            segment itself is kept (see 'mstp_statusInit'). Called by the
+ *            main thread on the way out, no publish is done afterwards.
+ *
+ * Params:    none
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_status_shm
+ **PROC-**********************************************************************/
+void
+mstp_statusShutdown(void)
+{
+   if (!mstp_status_shm)
+      return;
+
+   pthread_mutex_lock(&mstp_status_mutex);
+   mstp_status_closed = true;
+   mstp_status_write_begin(mstp_status_shm);
+   mstp_status_shm->mstpEnabled = false;
+   mstp_status_shm->publishTime = 0;
+   mstp_status_write_end(mstp_status_shm);
+   pthread_mutex_unlock(&mstp_status_mutex);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstpd_daemon_status_data_dump
+ *
+ * Purpose:   Dump the shared status snapshot through the same lock-free read
+ *            path used by the CLI.
+ *            argv[1] (optional) -> MSTID, limits the output to one tree
+ *
+ * Params:    ds -> dynamic string receiving the output
+ *
+ * Returns:   none
+ *
+ * Globals:   none
+ **PROC-**********************************************************************/
+void
+mstpd_daemon_status_data_dump(struct ds *ds, int argc, const char *argv[])
+{
+   const MSTP_STATUS_SHM_t *shm = mstp_status_attach();
+   MSTP_STATUS_SHM_t       *snap;
+   int                      mstid, first = 0, last = MSTP_STATUS_MAX_TREES - 1;
+   int                      lport;
+
+   if (!shm)
+   {
+      ds_put_format(ds, "Status snapshot is not available\n");
+      return;
+   }
+
+   if ((argc > 1) && argv[1])
+   {
+      first = last = atoi(argv[1]);
+      if ((first < 0) || (first >= MSTP_STATUS_MAX_TREES))
+      {
+         ds_put_format(ds, "Invalid MSTID %s\n", argv[1]);
+         return;
+      }
+   }
+
+   snap = xmalloc(sizeof(*snap));
+   if (!mstp_status_read(shm, snap))
+   {
+      ds_put_format(ds, "Status snapshot is busy or not published yet\n");
+      free(snap);
+      return;
+   }
+
+   ds_put_format(ds, "generation=%"PRIu64" published=%"PRId64" mstpEnabled=%s "
+                 "validTrees=%d\n", snap->generation, snap->publishTime,
+                 snap->mstpEnabled ? "Yes" : "No", snap->numOfValidTrees);
+   ds_put_format(ds, "dirty=%s deferred=%"PRIu64"\n",
+                 __atomic_load_n(&mstp_status_dirty, __ATOMIC_RELAXED) ?
+                 "Yes" : "No",
+                 __atomic_load_n(&mstp_status_deferred_cnt, __ATOMIC_RELAXED));
+
+   for (mstid = first; mstid <= last; mstid++)
+   {
+      const MSTP_STATUS_TREE_t *tree = &snap->trees[mstid];
+
+      if (!tree->valid)
+         continue;
+
+      ds_put_format(ds, "\nMST%d root=%d.%02x:%02x:%02x:%02x:%02x:%02x "
+                    "rootPort=%d cost=%u hops=%d tcCnt=%u%s\n", mstid,
+                    tree->rgnRootId.priority & 0xF000,
+                    PRINT_MAC_ADDR(tree->rgnRootId.mac),
+                    MSTP_GET_PORT_NUM(tree->rootPortId),
+                    tree->intRootPathCost, tree->remainingHops,
+                    tree->topologyChangeCnt,
+                    tree->isRoot ? " (root)" : "");
+
+      for (lport = 1; lport < MSTP_STATUS_MAX_PORTS; lport++)
+      {
+         const MSTP_STATUS_PORT_t *sp = &snap->ports[mstid][lport];
+
+         if (!sp->valid || !snap->lports[lport].valid)
+            continue;
+
+         ds_put_format(ds, "  %-10s %-11s %-11s cost=%-9u pri=%-3d "
+                       "fwdTrans=%u\n", snap->lports[lport].name,
+                       mstp_status_role_str(sp->role),
+                       mstp_status_state_str(sp->state),
+                       sp->pathCost, sp->priority, sp->forwardTransitions);
+      }
+   }
+
+   free(snap);
+}
+
+void mstpd_daemon_status_unixctl_list(struct unixctl_conn *conn, int argc,
+                   const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+
+    mstpd_daemon_status_data_dump(&ds, argc, argv);
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
@@ -0,0 +1,215 @@
+/*
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+/**********************************************************************************
+ *    File               : mstpd_status_shm.c
+ *    Description        : Reader side of the MSTP status snapshot. This file
+ *                         is built into both mstpd and the vtysh plugin.
+ **********************************************************************************/
+
+#include <fcntl.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mstp_status.h"
+
+/* NOTE: this array is indexed by the values defined
+ *       in 'MSTP_STATUS_ROLE_e' enum list */
+static const char *const mstp_status_role_s[MSTP_STATUS_ROLE_MAX] =
+{
+   "Unknown",
+   "Root",
+   "Alternate",
+   "Designated",
+   "Backup",
+   "Disabled",
+   "Master"
+};
+
+/* NOTE: this array is indexed by the values defined
+ *       in 'MSTP_STATUS_STATE_e' enum list */
+static const char *const mstp_status_state_s[MSTP_STATUS_STATE_MAX] =
+{
+   "Unknown",
+   "Blocking",
+   "Learning",
+   "Forwarding"
+};
+
+static const MSTP_STATUS_SHM_t *mstp_status_map = NULL;
+
+/**PROC+**********************************************************************
+ * Name:      mstp_status_attach
+ *
+ * Purpose:   Map the status snapshot published by mstpd (read-only).
+ *            The mapping is kept for the life of the process; mstpd never
+ *            unlinks the segment, so it stays valid across daemon restarts.
+ *
+ * Params:    none
+ *
+ * Returns:   pointer to the shared snapshot, NULL if it is not available
+ *
+ * Globals:   mstp_status_map
+ **PROC-**********************************************************************/
+const MSTP_STATUS_SHM_t *
+mstp_status_attach(void)
+{
+   struct stat st;
+   void       *addr;
+   int         fd;
+
+   if (mstp_status_map)
+      return mstp_status_map;
+
+   fd = shm_open(MSTP_STATUS_SHM_NAME, O_RDONLY, 0);
+   if (fd < 0)
+      return NULL;
+
+   if ((fstat(fd, &st) < 0) || (st.st_size < (off_t)sizeof(MSTP_STATUS_SHM_t)))
+   {
+      close(fd);
+      return NULL;
+   }
+
+   addr = mmap(NULL, sizeof(MSTP_STATUS_SHM_t), PROT_READ, MAP_SHARED, fd, 0);
+   close(fd);
+   if (addr == MAP_FAILED)
+      return NULL;
+
+   mstp_status_map = (const MSTP_STATUS_SHM_t *)addr;
+   if ((mstp_status_map->magic != MSTP_STATUS_MAGIC) ||
+       (mstp_status_map->version != MSTP_STATUS_VERSION))
+   {
+      munmap(addr, sizeof(MSTP_STATUS_SHM_t));
+      mstp_status_map = NULL;
+   }
+
+   return mstp_status_map;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_status_read
+ *
+ * Purpose:   Take a consistent copy of the shared snapshot without
+ *            blocking the writer (seqlock read side).
+ *
+ * Params:    shm  -> shared snapshot returned by 'mstp_status_attach'
+ *            copy -> caller's buffer receiving the copy
+ *
+ * Returns:   true if a consistent copy was taken, false if the writer kept
+ *            updating the snapshot for MSTP_STATUS_READ_RETRIES attempts
+ *            or no snapshot has been published yet
+ *
+ * Globals:   none
+ **PROC-**********************************************************************/
+bool
+mstp_status_read(const MSTP_STATUS_SHM_t *shm, MSTP_STATUS_SHM_t *copy)
+{
+   uint32_t seq1, seq2;
+   int      retry;
+
+   if (!shm || !copy)
+      return false;
+
+   for (retry = 0; retry < MSTP_STATUS_READ_RETRIES; retry++)
+   {
+      seq1 = __atomic_load_n(&shm->seq, __ATOMIC_ACQUIRE);
+      if (seq1 & 1)
+      {
+         sched_yield();
+         continue;
+      }
+
+      memcpy(copy, (const void *)shm, sizeof(MSTP_STATUS_SHM_t));
+
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      seq2 = __atomic_load_n(&shm->seq, __ATOMIC_RELAXED);
+      if (seq1 == seq2)
+         return (copy->generation != 0);
+   }
+
+   return false;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_status_is_current
+ *
+ * Purpose:   Check that a snapshot copy describes a running mstpd with MSTP
+ *            enabled. mstpd clears 'mstpEnabled' when it exits; a daemon
+ *            that died without doing so is caught by the age of the last
+ *            publish.
+ *
+ * Params:    snap -> snapshot copy taken by 'mstp_status_read'
+ *
+ * Returns:   true if the copy can be shown, false otherwise
+ *
+ * Globals:   none
+ **PROC-**********************************************************************/
+bool
+mstp_status_is_current(const MSTP_STATUS_SHM_t *snap)
+{
+   int64_t age;
+
+   if (!snap || !snap->mstpEnabled)
+      return false;
+
+   age = (int64_t)time(NULL) - snap->publishTime;
+   return ((age >= -MSTP_STATUS_MAX_AGE_SEC) &&
+           (age <= MSTP_STATUS_MAX_AGE_SEC));
+}
+
+const char *
+mstp_status_role_str(uint8_t role)
+{
+   return (role < MSTP_STATUS_ROLE_MAX) ?
+          mstp_status_role_s[role] : mstp_status_role_s[0];
+}
+
+const char *
+mstp_status_state_str(uint8_t state)
+{
+   return (state < MSTP_STATUS_STATE_MAX) ?
+          mstp_status_state_s[state] : mstp_status_state_s[0];
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_status_find_lport
+ *
+ * Purpose:   Find lport of the interface 'name' in a snapshot copy
+ *
+ * Returns:   lport number, 0 if not found
+ **PROC-**********************************************************************/
+int
+mstp_status_find_lport(const MSTP_STATUS_SHM_t *snap, const char *name)
+{
+   int lport;
+
+   if (!snap || !name)
+      return 0;
+
+   for (lport = 1; lport < MSTP_STATUS_MAX_PORTS; lport++)
+   {
+      if (snap->lports[lport].valid &&
+          (strncmp(snap->lports[lport].name, name,
+                   MSTP_STATUS_PORT_NAME_LEN) == 0))
+         return lport;
+   }
+
+   return 0;
+}
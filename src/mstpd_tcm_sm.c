@@ -938,8 +938,8 @@ mstp_tcmSmDetectedAct(MSTID_t mstid, LPORT_t lport)
       STP_ASSERT(cistPortPtr);
       MSTP_COMM_PORT_SET_BIT(commPortPtr->bitMap, MSTP_PORT_NEW_INFO);
       /* increment detected topology changes counter for this port */
-      cistPortPtr->dbgCnts.tcDetectCnt++;
-      cistPortPtr->dbgCnts.tcDetectCntLastUpdated = time(NULL);
+      cistPortPtr->cold->dbgCnts.tcDetectCnt++;
+      cistPortPtr->cold->dbgCnts.tcDetectCntLastUpdated = time(NULL);
    }
    else
    {
@@ -948,8 +948,8 @@ mstp_tcmSmDetectedAct(MSTID_t mstid, LPORT_t lport)
       STP_ASSERT(mstiPortPtr);
       MSTP_COMM_PORT_SET_BIT(commPortPtr->bitMap, MSTP_PORT_NEW_INFO_MSTI);
       /* increment detected topology changes counter for this port */
-      mstiPortPtr->dbgCnts.tcDetectCnt++;
-      mstiPortPtr->dbgCnts.tcDetectCntLastUpdated = time(NULL);
+      mstiPortPtr->cold->dbgCnts.tcDetectCnt++;
+      mstiPortPtr->cold->dbgCnts.tcDetectCntLastUpdated = time(NULL);
    }
 
       /*---------------------------------------------------------------------
@@ -0,0 +1,315 @@
+/*
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+/**********************************************************************************
+ *    File               : mstpd_trace.c
+ *    Description        : mstpd side of the convergence latency trace. Stamps
+ *                         the BPDU receive, the protocol thread dequeue, port
+ *                         role changes, forwarding changes and the OVSDB
+ *                         commit of port states; the switchd plugin stamps
+ *                         the hardware update.
+ **********************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <util.h>
+#include <vswitch-idl.h>
+#include <openvswitch/vlog.h>
+#include "mstp_fsm.h"
+#include "mstp_inlines.h"
+#include "mstp_recv.h"
+#include "mstp_ovsdb_if.h"
+#include "mstp_trace.h"
+
+VLOG_DEFINE_THIS_MODULE(mstpd_trace);
+
+BUILD_ASSERT_DECL(MSTP_TRACE_HW_STATE_BLOCKING ==
+                  (int)MSTP_DB_PORT_STATE_BLOCKING);
+BUILD_ASSERT_DECL(MSTP_TRACE_HW_STATE_FORWARDING ==
+                  (int)MSTP_DB_PORT_STATE_FORWARDING);
+
+static MSTP_TRACE_SHM_t *mstp_traceShm = NULL;
+
+/* protocol thread only: the event being processed. Events other than a
+ * BPDU get an id the first time one of their effects is stamped. */
+static uint64_t mstp_traceCurId = 0;
+static uint64_t mstp_traceCurT0 = 0;
+
+void
+mstp_traceInit(void)
+{
+   mstp_traceShm = mstp_trace_attach(TRUE);
+   if (!mstp_traceShm)
+      VLOG_ERR("%s: cannot create %s, convergence trace disabled",
+               __FUNCTION__, MSTP_TRACE_SHM_NAME);
+}
+
+MSTP_TRACE_SHM_t *
+mstp_traceShmGet(void)
+{
+   return mstp_traceShm;
+}
+
+bool
+mstp_traceIsEnabled(void)
+{
+   return mstp_trace_enabled(mstp_traceShm);
+}
+
+bool
+mstp_traceSetEnabled(bool enable)
+{
+   if (!mstp_traceShm)
+      return FALSE;
+
+   __atomic_store_n(&mstp_traceShm->enabled, enable ? 1 : 0,
+                    __ATOMIC_RELEASE);
+   return TRUE;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_traceRx
+ *
+ * Purpose:   RX thread: start a new event for the BPDU just read off the
+ *            socket
+ *
+ * Params:    pkt -> received BPDU, its 'traceId' is set
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_traceShm
+ **PROC-**********************************************************************/
+void
+mstp_traceRx(MSTP_RX_PDU *pkt)
+{
+   if (!mstp_trace_enabled(mstp_traceShm))
+   {
+      pkt->traceId = 0;
+      return;
+   }
+
+   pkt->traceId = mstp_trace_new_event(mstp_traceShm, mstp_trace_now());
+   mstp_trace_record(mstp_traceShm, MSTP_TRACE_WRITER_RX,
+                     MSTP_TRACE_STAGE_RX, pkt->traceId, 0, pkt->lport,
+                     pkt->pktLen);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_traceDequeue
+ *
+ * Purpose:   Protocol thread: make the event just taken off the queue the
+ *            one the following stamps belong to
+ *
+ * Params:    msgType -> type of the event
+ *            pkt     -> the BPDU if the event is one, NULL otherwise
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_traceShm, mstp_traceCurId, mstp_traceCurT0
+ **PROC-**********************************************************************/
+void
+mstp_traceDequeue(uint32_t msgType, const MSTP_RX_PDU *pkt)
+{
+   mstp_traceCurId = 0;
+   mstp_traceCurT0 = 0;
+
+   if (!mstp_trace_enabled(mstp_traceShm))
+      return;
+
+   if (pkt && pkt->traceId)
+   {
+      mstp_traceCurId = pkt->traceId;
+      mstp_trace_record(mstp_traceShm, MSTP_TRACE_WRITER_PROTOCOL,
+                        MSTP_TRACE_STAGE_DEQUEUE, mstp_traceCurId, 0,
+                        pkt->lport, msgType);
+   }
+   else
+   {
+      mstp_traceCurT0 = mstp_trace_now();
+   }
+}
+
+static uint64_t
+mstp_traceCurrent(void)
+{
+   if (!mstp_traceCurId)
+   {
+      mstp_traceCurId = mstp_trace_new_event(mstp_traceShm,
+                                             mstp_traceCurT0 ?
+                                             mstp_traceCurT0 :
+                                             mstp_trace_now());
+   }
+   return mstp_traceCurId;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_traceRoleChange
+ *
+ * Purpose:   Protocol thread: port role selection gave 'lport' a new role
+ *            on 'mstid'
+ *
+ * Params:    mstid -> tree
+ *            lport -> port
+ *            role  -> the new role
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_traceShm
+ **PROC-**********************************************************************/
+void
+mstp_traceRoleChange(MSTID_t mstid, LPORT_t lport, MSTP_PORT_ROLE_t role)
+{
+   if (!mstp_trace_enabled(mstp_traceShm))
+      return;
+
+   mstp_trace_record(mstp_traceShm, MSTP_TRACE_WRITER_PROTOCOL,
+                     MSTP_TRACE_STAGE_ROLE, mstp_traceCurrent(), mstid, lport,
+                     role);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_traceForwarding
+ *
+ * Purpose:   Protocol thread: forwarding of 'lport' on 'mstid' has been
+ *            enabled or disabled. The event is remembered for the cell so
+ *            the OVSDB commit and the hardware update of the new state are
+ *            attributed to it.
+ *
+ * Params:    mstid  -> tree
+ *            lport  -> port
+ *            enable -> TRUE if forwarding has been enabled
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_traceShm
+ **PROC-**********************************************************************/
+void
+mstp_traceForwarding(MSTID_t mstid, LPORT_t lport, bool enable)
+{
+   char     name[PORTNAME_LEN];
+   uint64_t id;
+
+   if (!mstp_trace_enabled(mstp_traceShm) ||
+       (mstid >= MSTP_TRACE_MAX_TREES) || (lport >= MSTP_TRACE_MAX_PORTS))
+      return;
+
+   id = mstp_traceCurrent();
+   mstp_trace_record(mstp_traceShm, MSTP_TRACE_WRITER_PROTOCOL,
+                     MSTP_TRACE_STAGE_FWD, id, mstid, lport, enable);
+
+   name[0] = '\0';
+   intf_get_port_name(lport, name);
+   if (strncmp(mstp_traceShm->portNames[lport], name,
+               MSTP_TRACE_PORT_NAME_LEN) != 0)
+   {
+      strncpy(mstp_traceShm->portNames[lport], name,
+              MSTP_TRACE_PORT_NAME_LEN - 1);
+      mstp_traceShm->portNames[lport][MSTP_TRACE_PORT_NAME_LEN - 1] = '\0';
+   }
+   __atomic_store_n(&mstp_traceShm->hwPending[mstid][lport], id,
+                    __ATOMIC_RELEASE);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_traceCommitPublish
+ *
+ * Purpose:   OVSDB thread: the port states in 'written' are about to be
+ *            committed. Hand the event that changed each stamped cell to
+ *            the plugin now, together with the state written: switchd may
+ *            apply the rows before the commit returns here.
+ *
+ * Params:    written -> per-tree map of the cells written
+ *            vec     -> the states written
+ *            stamped -> set to the cells whose event was handed over
+ *
+ * Returns:   TRUE if any cell was stamped
+ *
+ * Globals:   mstp_traceShm
+ **PROC-**********************************************************************/
+bool
+mstp_traceCommitPublish(const PORT_MAP written[],
+                        const MSTP_DB_PORT_STATE_VEC_t *vec,
+                        PORT_MAP stamped[])
+{
+   bool     any = FALSE;
+   uint64_t id;
+   MSTID_t  mstid;
+   int      lport;
+
+   if (!mstp_trace_enabled(mstp_traceShm))
+      return FALSE;
+
+   for (mstid = 0; mstid <= MSTP_INSTANCES_MAX; mstid++)
+   {
+      clear_port_map(&stamped[mstid]);
+      for (lport = find_first_port_set(&written[mstid]);
+           IS_VALID_LPORT(lport);
+           lport = find_next_port_set(&written[mstid], lport))
+      {
+         if (!__atomic_load_n(&mstp_traceShm->hwPending[mstid][lport],
+                              __ATOMIC_RELAXED))
+            continue;
+
+         id = __atomic_exchange_n(&mstp_traceShm->hwPending[mstid][lport], 0,
+                                  __ATOMIC_ACQUIRE);
+         if (!id)
+            continue;
+         __atomic_store_n(&mstp_traceShm->hwCommitted[mstid][lport],
+                          mstp_trace_hw_pack(id, vec->state[mstid][lport]),
+                          __ATOMIC_RELEASE);
+         set_port(&stamped[mstid], lport);
+         any = TRUE;
+      }
+   }
+   return any;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_traceCommitDone
+ *
+ * Purpose:   OVSDB thread: the commit of the cells stamped by
+ *            'mstp_traceCommitPublish' has returned, record its stage.
+ *
+ * Params:    stamped -> cells stamped before the commit
+ *            vec     -> the states written
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_traceShm
+ **PROC-**********************************************************************/
+void
+mstp_traceCommitDone(const PORT_MAP stamped[],
+                     const MSTP_DB_PORT_STATE_VEC_t *vec)
+{
+   uint64_t committed;
+   MSTID_t  mstid;
+   int      lport;
+
+   for (mstid = 0; mstid <= MSTP_INSTANCES_MAX; mstid++)
+   {
+      for (lport = find_first_port_set(&stamped[mstid]);
+           IS_VALID_LPORT(lport);
+           lport = find_next_port_set(&stamped[mstid], lport))
+      {
+         committed =
+            __atomic_load_n(&mstp_traceShm->hwCommitted[mstid][lport],
+                            __ATOMIC_RELAXED);
+         mstp_trace_record(mstp_traceShm, MSTP_TRACE_WRITER_OVSDB,
+                           MSTP_TRACE_STAGE_COMMIT, mstp_trace_hw_id(committed),
+                           mstid, lport, vec->state[mstid][lport]);
+      }
+   }
+}
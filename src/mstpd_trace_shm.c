@@ -0,0 +1,300 @@
+/*
+ * (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+/**********************************************************************************
+ *    File               : mstpd_trace_shm.c
+ *    Description        : Convergence latency trace segment. This file is
+ *                         built into both mstpd and the switchd STP plugin.
+ **********************************************************************************/
+
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mstp_trace.h"
+
+/* NOTE: this array is indexed by the values defined
+ *       in 'MSTP_TRACE_STAGE_e' enum list */
+static const char *const mstp_trace_stage_s[MSTP_TRACE_STAGE_MAX] =
+{
+   "rx",
+   "dequeue",
+   "role",
+   "fwd",
+   "commit",
+   "hw"
+};
+
+static MSTP_TRACE_SHM_t *mstp_trace_map = NULL;
+
+/**PROC+**********************************************************************
+ * Name:      mstp_trace_attach
+ *
+ * Purpose:   Map the trace segment. mstpd creates it (and starts it afresh,
+ *            disabled); the plugin only maps what mstpd created and tries
+ *            again on the next call while there is none. The segment is
+ *            never unlinked so mappings stay valid across mstpd restarts.
+ *
+ * Params:    create -> create or reinitialize the segment
+ *
+ * Returns:   pointer to the shared segment, NULL if it is not available
+ *
+ * Globals:   mstp_trace_map
+ **PROC-**********************************************************************/
+MSTP_TRACE_SHM_t *
+mstp_trace_attach(bool create)
+{
+   struct stat st;
+   void       *addr;
+   int         fd;
+
+   if (mstp_trace_map && !create)
+      return mstp_trace_map;
+
+   if (!mstp_trace_map)
+   {
+      fd = shm_open(MSTP_TRACE_SHM_NAME, create ? (O_CREAT | O_RDWR) : O_RDWR,
+                    0644);
+      if (fd < 0)
+         return NULL;
+
+      if (create && (ftruncate(fd, sizeof(MSTP_TRACE_SHM_t)) < 0))
+      {
+         close(fd);
+         return NULL;
+      }
+
+      if ((fstat(fd, &st) < 0) ||
+          (st.st_size < (off_t)sizeof(MSTP_TRACE_SHM_t)))
+      {
+         close(fd);
+         return NULL;
+      }
+
+      addr = mmap(NULL, sizeof(MSTP_TRACE_SHM_t), PROT_READ | PROT_WRITE,
+                  MAP_SHARED, fd, 0);
+      close(fd);
+      if (addr == MAP_FAILED)
+         return NULL;
+
+      mstp_trace_map = (MSTP_TRACE_SHM_t *)addr;
+   }
+
+   if (create)
+   {
+      __atomic_store_n(&mstp_trace_map->enabled, 0, __ATOMIC_RELEASE);
+      memset(mstp_trace_map->events, 0, sizeof(mstp_trace_map->events));
+      memset(mstp_trace_map->hwPending, 0, sizeof(mstp_trace_map->hwPending));
+      memset(mstp_trace_map->hwCommitted, 0,
+             sizeof(mstp_trace_map->hwCommitted));
+      memset(mstp_trace_map->portNames, 0, sizeof(mstp_trace_map->portNames));
+      mstp_trace_reset(mstp_trace_map);
+      mstp_trace_map->magic = MSTP_TRACE_MAGIC;
+      mstp_trace_map->version = MSTP_TRACE_VERSION;
+   }
+   else if ((mstp_trace_map->magic != MSTP_TRACE_MAGIC) ||
+            (mstp_trace_map->version != MSTP_TRACE_VERSION))
+   {
+      munmap(mstp_trace_map, sizeof(MSTP_TRACE_SHM_t));
+      mstp_trace_map = NULL;
+   }
+
+   return mstp_trace_map;
+}
+
+uint64_t
+mstp_trace_now(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_trace_new_event
+ *
+ * Purpose:   Allocate an event id and remember its origin time. Ids are
+ *            never 0, the slot of an id is reused MSTP_TRACE_EVENTS ids
+ *            later.
+ *
+ * Params:    shm  -> trace segment
+ *            t0Ns -> origin of the event
+ *
+ * Returns:   the event id
+ *
+ * Globals:   none
+ **PROC-**********************************************************************/
+uint64_t
+mstp_trace_new_event(MSTP_TRACE_SHM_t *shm, uint64_t t0Ns)
+{
+   MSTP_TRACE_EVENT_t *ev;
+   uint64_t            id;
+
+   id = __atomic_add_fetch(&shm->nextEventId, 1, __ATOMIC_RELAXED);
+   if (id == 0)
+      id = __atomic_add_fetch(&shm->nextEventId, 1, __ATOMIC_RELAXED);
+
+   ev = &shm->events[id & (MSTP_TRACE_EVENTS - 1)];
+   __atomic_store_n(&ev->id, 0, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+   __atomic_store_n(&ev->t0Ns, t0Ns, __ATOMIC_RELAXED);
+   __atomic_store_n(&ev->id, id, __ATOMIC_RELEASE);
+
+   return id;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_trace_record
+ *
+ * Purpose:   Record that event 'eventId' reached 'stage' now: add the time
+ *            since its origin to the stage histogram and append a record
+ *            to the ring of 'writer'. The caller must be the only writer of
+ *            both.
+ *
+ * Params:    shm     -> trace segment
+ *            writer  -> ring of the calling thread
+ *            stage   -> stage reached
+ *            eventId -> event id, 0 if the event has none
+ *            mstid   -> tree, 0 for the CIST or if not tree specific
+ *            lport   -> port, 0 if not port specific
+ *            arg     -> stage specific value
+ *
+ * Returns:   none
+ *
+ * Globals:   none
+ **PROC-**********************************************************************/
+void
+mstp_trace_record(MSTP_TRACE_SHM_t *shm, MSTP_TRACE_WRITER_e writer,
+                  MSTP_TRACE_STAGE_e stage, uint64_t eventId,
+                  int mstid, int lport, uint32_t arg)
+{
+   const MSTP_TRACE_EVENT_t *ev;
+   MSTP_TRACE_HIST_t        *hist;
+   MSTP_TRACE_RING_t        *ring;
+   MSTP_TRACE_REC_t         *rec;
+   uint64_t                  now;
+   uint64_t                  t0 = 0;
+   uint64_t                  lat;
+   uint64_t                  usec;
+   bool                      found = false;
+   int                       bucket;
+
+   if (!shm || (stage >= MSTP_TRACE_STAGE_MAX) ||
+       (writer >= MSTP_TRACE_WRITER_MAX))
+      return;
+
+   now = mstp_trace_now();
+
+   if (eventId)
+   {
+      ev = &shm->events[eventId & (MSTP_TRACE_EVENTS - 1)];
+      if (__atomic_load_n(&ev->id, __ATOMIC_ACQUIRE) == eventId)
+      {
+         t0 = __atomic_load_n(&ev->t0Ns, __ATOMIC_RELAXED);
+         __atomic_thread_fence(__ATOMIC_ACQUIRE);
+         found = (__atomic_load_n(&ev->id, __ATOMIC_RELAXED) == eventId);
+      }
+   }
+
+   hist = &shm->stages[stage];
+   if (found)
+   {
+      lat = (now > t0) ? (now - t0) : 0;
+      usec = lat / 1000;
+      bucket = usec ? (64 - __builtin_clzll(usec)) : 0;
+      if (bucket >= MSTP_TRACE_HIST_BUCKETS)
+         bucket = MSTP_TRACE_HIST_BUCKETS - 1;
+      hist->buckets[bucket]++;
+      hist->cnt++;
+      hist->sumNs += lat;
+      if (lat > hist->maxNs)
+         hist->maxNs = lat;
+   }
+   else if (eventId)
+   {
+      hist->lost++;
+   }
+
+   ring = &shm->rings[writer];
+   rec = &ring->recs[ring->head & (MSTP_TRACE_RING_SIZE - 1)];
+   rec->tsNs = now;
+   rec->eventId = eventId;
+   rec->lport = (uint16_t)lport;
+   rec->mstid = (uint8_t)mstid;
+   rec->stage = (uint8_t)stage;
+   rec->arg = arg;
+   __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_trace_reset
+ *
+ * Purpose:   Clear the stage histograms and the rings. Counts added by a
+ *            writer racing with the reset may survive it.
+ *
+ * Params:    shm -> trace segment
+ *
+ * Returns:   none
+ *
+ * Globals:   none
+ **PROC-**********************************************************************/
+void
+mstp_trace_reset(MSTP_TRACE_SHM_t *shm)
+{
+   int i;
+
+   if (!shm)
+      return;
+
+   memset(shm->stages, 0, sizeof(shm->stages));
+   for (i = 0; i < MSTP_TRACE_WRITER_MAX; i++)
+      __atomic_store_n(&shm->rings[i].head, 0, __ATOMIC_RELEASE);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_trace_find_lport
+ *
+ * Purpose:   Find lport of the interface 'name'
+ *
+ * Returns:   lport number, 0 if not found
+ **PROC-**********************************************************************/
+int
+mstp_trace_find_lport(const MSTP_TRACE_SHM_t *shm, const char *name)
+{
+   int lport;
+
+   if (!shm || !name || !name[0])
+      return 0;
+
+   for (lport = 1; lport < MSTP_TRACE_MAX_PORTS; lport++)
+   {
+      if (strncmp(shm->portNames[lport], name,
+                  MSTP_TRACE_PORT_NAME_LEN) == 0)
+         return lport;
+   }
+
+   return 0;
+}
+
+const char *
+mstp_trace_stage_str(int stage)
+{
+   return ((stage >= 0) && (stage < MSTP_TRACE_STAGE_MAX)) ?
+          mstp_trace_stage_s[stage] : "unknown";
+}
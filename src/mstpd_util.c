@@ -23,6 +23,7 @@
 #include <string.h>
 #include <pthread.h>
 #include <sys/time.h>
+#include <time.h>
 
 #include <errno.h>
 #include <util.h>
@@ -43,13 +44,12 @@
 #include "md5.h"
 
 VLOG_DEFINE_THIS_MODULE(mstpd_util);
+
 /*---------------------------------------------------------------------------
  * Local functions prototypes (forward declarations)
  *---------------------------------------------------------------------------*/
 static bool    mstp_isMstBpdu(MSTP_RX_PDU *pkt);
 static void    mstp_updtMstiRootInfoChg(MSTID_t mstid);
-static void    mstp_updtMstiPortStateChgMsg(MSTID_t mstid, LPORT_t lport,
-                                            MSTP_ACT_TYPE_t state);
 static bool    mstp_isNeighboreBridgeInMyRegion(MSTP_RX_PDU *pkt);
 static int     mstp_cistPriorityVectorsCompare
                                            (MSTP_CIST_BRIDGE_PRI_VECTOR_t *v1,
@@ -70,12 +70,14 @@ static MSTP_RCVD_INFO_t
                mstp_rcvInfoCist(MSTP_RX_PDU *pkt, LPORT_t lport);
 static MSTP_RCVD_INFO_t
                mstp_rcvInfoMsti(MSTP_RX_PDU *pkt, MSTID_t mstid, LPORT_t lport);
-static void    mstp_mstRgnCfgConsistencyCheck(MSTP_MST_BPDU_t *bpdu,
-                                              LPORT_t lport);
 static bool    mstp_isOldRootPropagation(MSTID_t mstid, LPORT_t lport,
                                          MSTP_MST_BPDU_t *bpdu,
                                          MSTP_MSTI_CONFIG_MSG_t *cfgMsgPtr,
                                          bool bpduSameRgn);
+static int     mstp_treeMsgSlot(MSTID_t mstid);
+static void    mstp_portPathCostSet(LPORT_t lport, uint32_t pathCost,
+                                    bool restart);
+static void    mstp_lportCostApply(LPORT_t lport);
 /** ====================================================================== **
  *                                                                          *
  *     Global Functions (externed)                                          *
@@ -145,6 +147,88 @@ void mstp_setDynReconfigChangeFlag (void)
    return;
 }
 
+/**PROC+**********************************************************************
+ * Name:      mstp_setDynReconfigTreeFlag
+ *
+ * Purpose:   Indicate that a dynamic reconfiguration change occurred that
+ *            requires the state machines of one tree to be restarted, e.g.
+ *            the Bridge Identifier Priority of the tree has been changed.
+ *
+ * Params:    mstid -> the CIST or an MSTI
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_Bridge
+ **PROC-**********************************************************************/
+void mstp_setDynReconfigTreeFlag(uint16_t mstid)
+{
+   if ((MSTP_ENABLED == TRUE) && (mstid <= MSTP_MSTID_MAX))
+   {
+      mstp_Bridge.dynReconfigTree[mstid] = TRUE;
+      MSTP_DYN_RECONFIG_SCOPED = TRUE;
+   }
+   return;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_setDynReconfigPortFlag
+ *
+ * Purpose:   Indicate that a dynamic reconfiguration change occurred that
+ *            requires the per-Port per-Tree state machines of a port to be
+ *            restarted, e.g. the Port Identifier Priority or the Port Path
+ *            Cost of the port has been changed.
+ *
+ * Params:    mstid -> the CIST or an MSTI, MSTP_NO_MSTID for every tree
+ *            lport -> logical port number
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_Bridge
+ **PROC-**********************************************************************/
+void mstp_setDynReconfigPortFlag(uint16_t mstid, LPORT_t lport)
+{
+   if ((MSTP_ENABLED == FALSE) || !IS_VALID_LPORT(lport))
+   {
+      return;
+   }
+
+   if (mstid == MSTP_NO_MSTID)
+   {
+      for (mstid = MSTP_CISTID; mstid <= MSTP_MSTID_MAX; mstid++)
+      {
+         set_port(&mstp_Bridge.dynReconfigPorts[mstid], lport);
+      }
+   }
+   else if (mstid <= MSTP_MSTID_MAX)
+   {
+      set_port(&mstp_Bridge.dynReconfigPorts[mstid], lport);
+   }
+   else
+   {
+      return;
+   }
+   MSTP_DYN_RECONFIG_SCOPED = TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * Path cost of every logical port, computed when its speed or duplex
+ * changes rather than each time a tree asks for it, and the LAGs whose
+ * change is held. Changed by the protocol thread only, which also reads
+ * it without a lock. The 'cost' part is written under 'mstp_lportCostLock'
+ * so that 'mstp_lportCostGet' can copy it from the OVSDB thread.
+ *---------------------------------------------------------------------------*/
+typedef struct mstp_lport_cost_ent
+{
+   MSTP_LPORT_COST_t cost;
+   uint64_t          holdStart;          /* first change held, usec      */
+   uint64_t          holdUntil;          /* apply at, usec               */
+
+} MSTP_LPORT_COST_ENT_t;
+
+static MSTP_LPORT_COST_ENT_t mstp_lportCost[MAX_LPORTS + 1];
+static PORT_MAP              mstp_lportCostHeld;
+static pthread_mutex_t       mstp_lportCostLock = PTHREAD_MUTEX_INITIALIZER;
+
 /**PROC+**********************************************************************
  * Name:      mstp_portAutoDetectParamsSet
  *
@@ -167,7 +251,6 @@ void mstp_setDynReconfigChangeFlag (void)
 void
 mstp_portAutoDetectParamsSet(LPORT_t lport, SPEED_DPLX* speedDplx)
 {
-   MSTID_t                mstid;
    MSTP_COMM_PORT_INFO_t *commPortPtr;
 
    STP_ASSERT(MSTP_ENABLED);
@@ -177,32 +260,13 @@ mstp_portAutoDetectParamsSet(LPORT_t lport, SPEED_DPLX* speedDplx)
    STP_ASSERT(commPortPtr);
 
    /*------------------------------------------------------------------------
-    * Set path cost value for the port
+    * Set path cost value for the port. The port is not enabled yet, so
+    * there is nothing to restart. A LAG speed change held by
+    * 'mstp_lportCostUpdate' is taken over by this one.
     * NOTE: MESH port is being enforced always have the lowest path cost
     *------------------------------------------------------------------------*/
-      {
-         uint32_t autoPathCost = mstp_convertLportSpeedToPathCost(speedDplx);
-
-         if(commPortPtr->useCfgPathCost == FALSE)
-            commPortPtr->ExternalPortPathCost = autoPathCost;
-
-         STP_ASSERT(MSTP_CIST_PORT_PTR(lport));
-         if(MSTP_CIST_PORT_PTR(lport)->useCfgPathCost == FALSE)
-            MSTP_CIST_PORT_PTR(lport)->InternalPortPathCost = autoPathCost;
-
-         for(mstid = MSTP_MSTID_MIN; mstid <= MSTP_INSTANCES_MAX; mstid++)
-         {
-            if(MSTP_MSTI_VALID(mstid))
-            {
-               STP_ASSERT(MSTP_MSTI_PORT_PTR(mstid, lport));
-               if(MSTP_MSTI_PORT_PTR(mstid, lport)->useCfgPathCost == FALSE)
-               {
-                  MSTP_MSTI_PORT_PTR(mstid, lport)->InternalPortPathCost =
-                                                                  autoPathCost;
-               }
-            }
-         }
-      }
+   mstp_portPathCostSet(lport, mstp_convertLportSpeedToPathCost(speedDplx),
+                        FALSE);
    /*------------------------------------------------------------------------
     * Set operational value of the port's Point to Point MAC parameter
     *------------------------------------------------------------------------*/
@@ -220,41 +284,277 @@ mstp_portAutoDetectParamsSet(LPORT_t lport, SPEED_DPLX* speedDplx)
 /**PROC+**********************************************************************
  * Name:      mstp_portAutoPathCostDetect
  *
- * Purpose:   Calculate Path Cost information to be set for the MSTP port
+ * Purpose:   Get Path Cost information to be set for the MSTP port
  *            based on the connection speed and duplex mode this port
- *            currently operates with.
+ *            currently operates with, as cached by 'mstp_lportCostUpdate'.
  *
  * Params:    lport    -> logical port in question
  *
  * Returns:   Path Cost value that corresponds to the current value of the
- *            port's physical link characteristics.
+ *            port's physical link characteristics, or the one applied last
+ *            while a LAG's change is held.
  *
- * Globals:   none
+ * Globals:   mstp_lportCost
  *
  * Constraints:
  **PROC-**********************************************************************/
 uint32_t
 mstp_portAutoPathCostDetect(LPORT_t lport)
 {
-   uint32_t    pathCost;
-   SPEED_DPLX speedDplx;
-
    STP_ASSERT(IS_VALID_LPORT(lport));
    /*------------------------------------------------------------------------
-    * NOTE: 'intf_get_lport_speed_duplex' function returns FALSE only if
-    *       'lport' is not connected.
+    * NOTE: the cost is known only once the speed/duplex of 'lport' has
+    *       been reported, see 'mstp_lportCostUpdate'.
     *       For not connected port we return '0' path cost value indicating
     *       that auto speed detection failed. Zero path cost value also
     *       indicates that the logical port is configured to
     *       'auto speed detection mode', i.e. port should calculate the path
     *       cost from the link connection speed rather then use config info.
     *------------------------------------------------------------------------*/
-   if(intf_get_lport_speed_duplex(lport, &speedDplx))
-      pathCost = mstp_convertLportSpeedToPathCost(&speedDplx);
+   if(!IS_VALID_LPORT(lport) || !mstp_lportCost[lport].cost.valid)
+      return 0;
+
+   /*------------------------------------------------------------------------
+    * A LAG change still held has not been set on the trees yet, the trees
+    * keep the cost applied last until 'mstp_lportCostTick' applies it.
+    *------------------------------------------------------------------------*/
+   if(mstp_lportCost[lport].cost.held)
+      return mstp_lportCost[lport].cost.appliedCost;
+
+   return mstp_lportCost[lport].cost.operCost;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_portPathCostSet
+ *
+ * Purpose:   Set the automatically detected path cost of a port on the CIST
+ *            (External and Internal) and on every MSTI, except where a path
+ *            cost is configured, and record it as the applied one.
+ *
+ * Params:    lport    -> logical port number
+ *            pathCost -> path cost to set
+ *            restart  -> mark the trees whose cost changed for a dynamic
+ *                        reconfiguration of the port
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_Bridge, mstp_lportCost
+ **PROC-**********************************************************************/
+static void
+mstp_portPathCostSet(LPORT_t lport, uint32_t pathCost, bool restart)
+{
+   MSTID_t                mstid;
+   MSTP_COMM_PORT_INFO_t *commPortPtr;
+   MSTP_CIST_PORT_INFO_t *cistPortPtr;
+   MSTP_MSTI_PORT_INFO_t *mstiPortPtr;
+
+   commPortPtr = MSTP_COMM_PORT_PTR(lport);
+   cistPortPtr = MSTP_CIST_PORT_PTR(lport);
+   STP_ASSERT(commPortPtr && cistPortPtr);
+
+   if((commPortPtr->useCfgPathCost == FALSE) &&
+      (commPortPtr->ExternalPortPathCost != pathCost))
+   {
+      commPortPtr->ExternalPortPathCost = pathCost;
+      mstp_statusPortChg(MSTP_CISTID, lport);
+      if(restart)
+         mstp_setDynReconfigPortFlag(MSTP_CISTID, lport);
+   }
+
+   if((cistPortPtr->useCfgPathCost == FALSE) &&
+      (cistPortPtr->InternalPortPathCost != pathCost))
+   {
+      cistPortPtr->InternalPortPathCost = pathCost;
+      if(restart)
+         mstp_setDynReconfigPortFlag(MSTP_CISTID, lport);
+   }
+
+   for(mstid = MSTP_MSTID_MIN; mstid <= MSTP_INSTANCES_MAX; mstid++)
+   {
+      if(!MSTP_MSTI_VALID(mstid))
+         continue;
+
+      mstiPortPtr = MSTP_MSTI_PORT_PTR(mstid, lport);
+      STP_ASSERT(mstiPortPtr);
+      if((mstiPortPtr->useCfgPathCost == FALSE) &&
+         (mstiPortPtr->InternalPortPathCost != pathCost))
+      {
+         mstiPortPtr->InternalPortPathCost = pathCost;
+         mstp_statusPortChg(mstid, lport);
+         if(restart)
+            mstp_setDynReconfigPortFlag(mstid, lport);
+      }
+   }
+
+   pthread_mutex_lock(&mstp_lportCostLock);
+   mstp_lportCost[lport].cost.appliedCost = pathCost;
+   if(mstp_lportCost[lport].cost.held)
+   {
+      mstp_lportCost[lport].cost.held = FALSE;
+      clear_port(&mstp_lportCostHeld, lport);
+   }
+   pthread_mutex_unlock(&mstp_lportCostLock);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_lportCostUpdate
+ *
+ * Purpose:   Recompute the cached path cost of a logical port whose speed or
+ *            duplex changed. If the port is enabled the new cost replaces
+ *            the automatically set ones and only the trees whose cost
+ *            changed restart the port. A LAG's change is held until its
+ *            speed settles, so the trees are not restarted once for every
+ *            member that flaps.
+ *
+ * Params:    lport     -> logical port number
+ *            speedDplx -> new speed/duplex of the port
+ *            isLag     -> the port is a LAG
+ *            linkUp    -> the link of the port is up
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_Bridge, mstp_lportCost
+ **PROC-**********************************************************************/
+void
+mstp_lportCostUpdate(LPORT_t lport, SPEED_DPLX *speedDplx, bool isLag,
+                     bool linkUp)
+{
+   MSTP_LPORT_COST_ENT_t *ent;
+   MSTP_COMM_PORT_INFO_t *commPortPtr = NULL;
+   uint64_t               now;
+
+   STP_ASSERT(IS_VALID_LPORT(lport));
+
+   ent = &mstp_lportCost[lport];
+   pthread_mutex_lock(&mstp_lportCostLock);
+   ent->cost.operCost = mstp_convertLportSpeedToPathCost(speedDplx);
+   ent->cost.valid = TRUE;
+   ent->cost.speedChgCnt++;
+   pthread_mutex_unlock(&mstp_lportCostLock);
+
+   if(MSTP_ENABLED)
+      commPortPtr = MSTP_COMM_PORT_PTR(lport);
+
+   if(!linkUp || !commPortPtr ||
+      !MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap, MSTP_PORT_PORT_ENABLED))
+   {/* Applied by 'mstp_portAutoDetectParamsSet' when the port is enabled */
+      if(ent->cost.held)
+      {
+         pthread_mutex_lock(&mstp_lportCostLock);
+         ent->cost.held = FALSE;
+         pthread_mutex_unlock(&mstp_lportCostLock);
+         clear_port(&mstp_lportCostHeld, lport);
+      }
+      return;
+   }
+
+   if(!isLag)
+   {
+      mstp_lportCostApply(lport);
+      return;
+   }
+
+   now = mstp_utilMonoUsec();
+   pthread_mutex_lock(&mstp_lportCostLock);
+   if(ent->cost.held)
+      ent->cost.dampedCnt++;
    else
-      pathCost = 0;
+   {
+      ent->cost.held = TRUE;
+      ent->holdStart = now;
+      set_port(&mstp_lportCostHeld, lport);
+   }
+   pthread_mutex_unlock(&mstp_lportCostLock);
+   ent->holdUntil = MIN(now + MSTP_LAG_COST_HOLD_SEC * 1000000ULL,
+                        ent->holdStart + MSTP_LAG_COST_HOLD_MAX_SEC * 1000000ULL);
+}
 
-   return pathCost;
+/**PROC+**********************************************************************
+ * Name:      mstp_lportCostApply
+ *
+ * Purpose:   Set the cached path cost of an enabled port on the trees if it
+ *            differs from the one applied last, e.g. a LAG whose speed went
+ *            back to where it was while held changes nothing.
+ *
+ * Params:    lport -> logical port number
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_lportCost
+ **PROC-**********************************************************************/
+static void
+mstp_lportCostApply(LPORT_t lport)
+{
+   MSTP_LPORT_COST_ENT_t *ent = &mstp_lportCost[lport];
+
+   if(ent->cost.operCost != ent->cost.appliedCost)
+   {
+      VLOG_DBG("%s: lport %d path cost %u -> %u", __FUNCTION__, lport,
+               ent->cost.appliedCost, ent->cost.operCost);
+   }
+   mstp_portPathCostSet(lport, ent->cost.operCost, TRUE);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_lportCostTick
+ *
+ * Purpose:   Apply the held LAG path costs whose hold time expired. Called
+ *            on every timer tick, ahead of the dynamic reconfiguration
+ *            check that restarts the ports.
+ *
+ * Params:    none
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_Bridge, mstp_lportCost
+ **PROC-**********************************************************************/
+void
+mstp_lportCostTick(void)
+{
+   MSTP_COMM_PORT_INFO_t *commPortPtr;
+   LPORT_t                lport;
+   uint64_t               now;
+
+   if(!are_any_ports_set(&mstp_lportCostHeld))
+      return;
+
+   now = mstp_utilMonoUsec();
+   for(lport = find_first_port_set(&mstp_lportCostHeld);
+       IS_VALID_LPORT(lport);
+       lport = find_next_port_set(&mstp_lportCostHeld, lport))
+   {
+      if(now < mstp_lportCost[lport].holdUntil)
+         continue;
+
+      commPortPtr = MSTP_ENABLED ? MSTP_COMM_PORT_PTR(lport) : NULL;
+      if(commPortPtr &&
+         MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap,
+                                   MSTP_PORT_PORT_ENABLED))
+      {
+         mstp_lportCostApply(lport);
+      }
+      else
+      {
+         pthread_mutex_lock(&mstp_lportCostLock);
+         mstp_lportCost[lport].cost.held = FALSE;
+         pthread_mutex_unlock(&mstp_lportCostLock);
+         clear_port(&mstp_lportCostHeld, lport);
+      }
+   }
+}
+
+/* Copy the cached path cost of 'lport', from any thread */
+void
+mstp_lportCostGet(LPORT_t lport, MSTP_LPORT_COST_t *cost)
+{
+   if(!IS_VALID_LPORT(lport))
+   {
+      memset(cost, 0, sizeof(*cost));
+      return;
+   }
+   pthread_mutex_lock(&mstp_lportCostLock);
+   *cost = mstp_lportCost[lport].cost;
+   pthread_mutex_unlock(&mstp_lportCostLock);
 }
 
 /**PROC+**********************************************************************
@@ -647,6 +947,13 @@ mstp_portEnable(LPORT_t lport)
        *---------------------------------------------------------------------*/
       mstp_ppmSm(lport);
 
+      /*---------------------------------------------------------------------
+       * if the daemon has just been restarted, take the port's roles, states
+       * and priority vectors back from the checkpoint; the Port Information
+       * state machines kicked below then find them current
+       *---------------------------------------------------------------------*/
+      mstp_ckptRestorePort(lport);
+
       /*---------------------------------------------------------------------
        * kick CIST's Port Information state machine (per-Tree per-Port)
        *---------------------------------------------------------------------*/
@@ -1046,20 +1353,21 @@ mstp_enableForwarding(MSTID_t mstid, LPORT_t lport)
    STP_ASSERT(IS_VALID_LPORT(lport));
 
    mstp_updtMstiPortStateChgMsg(mstid, lport, MSTP_ACT_ENABLE_FORWARDING);
+   mstp_traceForwarding(mstid, lport, TRUE);
    MSTP_MSTI_PORT_STATUS_PRINTF(mstid, lport, MSTP_PORT_STATE_ON_TREE_FMT,
                                 "<ENABLE FWD>", MSTP_FWD_SYM, mstid, lport);
    if(mstid == MSTP_CISTID)
    {
       STP_ASSERT(MSTP_CIST_PORT_PTR(lport));
-      MSTP_CIST_PORT_PTR(lport)->forwardTransitions++;
-      MSTP_CIST_PORT_PTR(lport)->forwardTransitionsLastUpdated =
+      MSTP_CIST_PORT_PTR(lport)->cold->forwardTransitions++;
+      MSTP_CIST_PORT_PTR(lport)->cold->forwardTransitionsLastUpdated =
                                                          time(NULL);
    }
    else
    {
       STP_ASSERT(MSTP_MSTI_PORT_PTR(mstid, lport));
-      MSTP_MSTI_PORT_PTR(mstid, lport)->forwardTransitions++;
-      MSTP_MSTI_PORT_PTR(mstid, lport)->forwardTransitionsLastUpdated =
+      MSTP_MSTI_PORT_PTR(mstid, lport)->cold->forwardTransitions++;
+      MSTP_MSTI_PORT_PTR(mstid, lport)->cold->forwardTransitionsLastUpdated =
                                                          time(NULL);
    }
 }
@@ -1087,6 +1395,7 @@ mstp_disableForwarding(MSTID_t mstid, LPORT_t lport)
    STP_ASSERT(IS_VALID_LPORT(lport));
 
    mstp_updtMstiPortStateChgMsg(mstid, lport, MSTP_ACT_DISABLE_FORWARDING);
+   mstp_traceForwarding(mstid, lport, FALSE);
    MSTP_MSTI_PORT_STATUS_PRINTF(mstid, lport, MSTP_PORT_STATE_ON_TREE_FMT,
                                 "<DISABLE FWD>", MSTP_NO_FWD_SYM, mstid, lport);
 }
@@ -1114,19 +1423,11 @@ mstp_flush(MSTID_t mstid, LPORT_t lport)
    STP_ASSERT((mstid == MSTP_CISTID) || MSTP_VALID_MSTID(mstid));
    STP_ASSERT(IS_VALID_LPORT(lport));
 
-   m = mstp_findMstiPortStateChgMsg(mstid);
-   if(m == NULL)
+   m = mstp_getMstiPortStateChgMsg(mstid);
+   if (!m)
    {
-       m = calloc(1, sizeof(MSTP_TREE_MSG_t));
-       if (!m)
-       {
-           STP_ASSERT(0);
-           return;
-       }
-      m->mstid        = mstid;
-      m->link.q_flink = NULL;
-      m->link.q_blink = NULL;
-      insqti_nodis(&MSTP_TREE_MSGS_QUEUE, &m->link);
+       STP_ASSERT(0);
+       return;
    }
 
    set_port(&m->portsMacAddrFlush, lport);
@@ -1426,6 +1727,39 @@ mstp_doPendingTxOnBridge(void)
    }
 }
 
+/*---------------------------------------------------------------------------
+ * HMAC-MD5 context of 'mstp_DigestSignatureKey', set up on first use, and
+ * the MST Configuration Table digested last together with its digest.
+ * 'mstp_MstiVidTable' is only changed by the protocol thread, which bumps
+ * 'mstp_mstiVidTableGen' (atomic) every time; the digest is reused while
+ * the generation is the one it was calculated at. The protocol thread
+ * updates the cache under 'lock' and reads it without, the digest dump
+ * and its timing copy the table and the counts under 'lock'.
+ *---------------------------------------------------------------------------*/
+static hmac_md5_ctxt  mstp_digestHmac;
+static pthread_once_t mstp_digestHmacOnce = PTHREAD_ONCE_INIT;
+
+static uint32_t       mstp_mstiVidTableGen;
+
+static struct
+{
+   pthread_mutex_t lock;
+   MSTID_t         table[MSTP_MST_CFG_TBL_SIZE];
+   uint8_t         digest[MSTP_DIGEST_SIZE];
+   bool            valid;
+   uint32_t        gen;                  /* of 'mstp_MstiVidTable'       */
+   uint64_t        calcCnt;              /* digests calculated           */
+   uint64_t        reuseCnt;             /* table unchanged, reused      */
+
+} mstp_digestCache = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static void
+mstp_digestHmacInit(void)
+{
+   hmac_md5_init(&mstp_digestHmac, mstp_DigestSignatureKey,
+                 MSTP_DIGEST_KEY_LEN);
+}
+
 /**PROC+**********************************************************************
  * Name:      mstp_buildMstConfigurationDigest
  *
@@ -1465,90 +1799,224 @@ mstp_doPendingTxOnBridge(void)
  *
  * Returns:   none
  *
- * Globals:   mstp_DigestSignatureKey
+ * Globals:   mstp_digestCache, mstp_mstiVidTableGen
  *
  **PROC-**********************************************************************/
 void
 mstp_buildMstConfigurationDigest(uint8_t *resDigest)
 {
-   uint8_t   digest[MSTP_DIGEST_SIZE]; /* 16 bytes */
+   static MSTID_t mstCfgTable[MSTP_MST_CFG_TBL_SIZE];
+   uint8_t  digest[MSTP_DIGEST_SIZE];
+   uint32_t gen;
    char     digest_str[200] = {0};
    char temp[10]= {0};
-   MSTID_t *mstCfgTable;
-   VID_t    vid;
-   MSTID_t  mstid;
-   int      mstCfgTableSize;
    uint32_t i = 0;
-   const struct ovsrec_bridge *bridge_row = NULL;
-   struct ovsdb_idl_txn *txn = NULL;
-   struct smap smap = SMAP_INITIALIZER(&smap);
    STP_ASSERT(resDigest);
    STP_ASSERT(MSTP_DIGEST_SIZE == 16);
-   MSTP_OVSDB_LOCK;
-   txn = ovsdb_idl_txn_create(idl);
-   bridge_row = ovsrec_bridge_first(idl);
-
-   /*------------------------------------------------------------------------
-    * allocate buffer big enough to accomodate MST Configuration Table.
-    *------------------------------------------------------------------------*/
    STP_ASSERT(sizeof(MSTID_t) == MSTP_MST_CFG_ELEM_SIZE);
-   mstCfgTableSize = MSTP_MST_CFG_TBL_SIZE * MSTP_MST_CFG_ELEM_SIZE;
-   mstCfgTable = (MSTID_t *) calloc(1, mstCfgTableSize);
-   if (!mstCfgTable)
-   {
-       ovsdb_idl_txn_destroy(txn);
-       MSTP_OVSDB_UNLOCK;
-       STP_ASSERT(0);
-       return;
-   }
-
 
    /*------------------------------------------------------------------------
-    * build contents of the MST Configuration Table
+    * build contents of the MST Configuration Table and calculate the
+    * digest only if the VID mapping changed since the one digested last
+    * NOTE: 'hmac_md5_keyed' always returns 16 bytes digest value
     *------------------------------------------------------------------------*/
-   for(vid = MSTP_MST_CFG_TBL_FIRST_VID_IDX;
-       vid <= MSTP_MST_CFG_TBL_LAST_VID_IDX; vid++)
+   gen = __atomic_load_n(&mstp_mstiVidTableGen, __ATOMIC_RELAXED);
+   if(!mstp_digestCache.valid || (mstp_digestCache.gen != gen))
    {
-          if((mstid = mstp_getMstIdForVid(vid)) != MSTP_NO_MSTID)
-          {
-               {
-		   /* MSTP digest is calculated only on Primary/Normal VLAN*/
-                   mstCfgTable[vid] = htons(mstid);
-	       }
+      mstp_buildMstConfigurationTable(mstCfgTable);
+      mstp_mstConfigurationTableDigest(mstCfgTable, digest);
 
-          }
+      pthread_mutex_lock(&mstp_digestCache.lock);
+      memcpy(mstp_digestCache.table, mstCfgTable, sizeof(mstCfgTable));
+      memcpy(mstp_digestCache.digest, digest, MSTP_DIGEST_SIZE);
+      mstp_digestCache.gen = gen;
+      mstp_digestCache.valid = TRUE;
+      mstp_digestCache.calcCnt++;
+      pthread_mutex_unlock(&mstp_digestCache.lock);
+   }
+   else
+   {
+      pthread_mutex_lock(&mstp_digestCache.lock);
+      mstp_digestCache.reuseCnt++;
+      pthread_mutex_unlock(&mstp_digestCache.lock);
    }
 
-   /*------------------------------------------------------------------------
-    * calculate the digest value
-    * NOTE: 'hmac_md5_calc' always returns 16 bytes digest value
-    *------------------------------------------------------------------------*/
-   memset(digest, 0, sizeof(digest));
-   hmac_md5((unsigned char*) mstCfgTable, mstCfgTableSize,
-                 (uint8_t*)mstp_DigestSignatureKey, MSTP_DIGEST_KEY_LEN, digest);
    for(i=0; i< MSTP_DIGEST_SIZE; i++)
    {
-      snprintf(temp,10,"%.2X",digest[i]);
+      snprintf(temp,10,"%.2X",mstp_digestCache.digest[i]);
       strncat(digest_str,temp,10);
    }
-   smap_clone(&smap, &bridge_row->status);
-   smap_replace(&smap, "mstp_config_digest" , digest_str);
-   ovsrec_bridge_set_status(bridge_row, &smap);
+   mstp_util_set_bridge_status("mstp_config_digest", digest_str);
    VLOG_DBG("Config Digest : %s",digest_str);
 
    /*------------------------------------------------------------------------
     * copy result
     *------------------------------------------------------------------------*/
-   memcpy(resDigest, digest, sizeof(digest));
+   memcpy(resDigest, mstp_digestCache.digest, MSTP_DIGEST_SIZE);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_buildMstConfigurationTable
+ *
+ * Purpose:   Build the MST Configuration Table the Configuration Digest is
+ *            calculated over (see 'mstp_buildMstConfigurationDigest') from
+ *            the VID maps of the CIST and the MSTIs. VIDs of the CIST or of
+ *            no MSTI are left 0.
+ *
+ * Params:    mstCfgTable -> 'MSTP_MST_CFG_TBL_SIZE' elements to fill in
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_MstiVidTable
+ **PROC-**********************************************************************/
+void
+mstp_buildMstConfigurationTable(MSTID_t *mstCfgTable)
+{
+   const VID_MAP *vidMap;
+   MSTID_t        mstid;
+   VID_t          vid;
+
+   STP_ASSERT(mstCfgTable);
+   memset(mstCfgTable, 0, MSTP_MST_CFG_TBL_SIZE * MSTP_MST_CFG_ELEM_SIZE);
 
    /*------------------------------------------------------------------------
-    * free memory used
+    * walk the MSTIs from the highest, so a VID found in two of them ends
+    * up with the lowest MSTID, then give the CIST back its own VIDs: the
+    * same precedence as 'mstp_getMstIdForVid', which looks at the CIST
+    * first
     *------------------------------------------------------------------------*/
+   for(mstid = MSTP_INSTANCES_MAX; mstid >= MSTP_MSTID_MIN; mstid--)
+   {
+      vidMap = &mstp_MstiVidTable[mstid];
+      for(vid = find_first_vid_set(vidMap);
+          IS_VALID_VID(vid) && (vid <= MSTP_MST_CFG_TBL_LAST_VID_IDX);
+          vid = find_next_vid(vidMap, vid))
+      {
+         mstCfgTable[vid] = htons(mstid);
+      }
+   }
+   vidMap = &mstp_MstiVidTable[MSTP_CISTID];
+   for(vid = find_first_vid_set(vidMap);
+       IS_VALID_VID(vid) && (vid <= MSTP_MST_CFG_TBL_LAST_VID_IDX);
+       vid = find_next_vid(vidMap, vid))
+   {
+      mstCfgTable[vid] = 0;
+   }
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_mstConfigurationTableDigest
+ *
+ * Purpose:   Calculate the HMAC-MD5 Configuration Digest of a MST
+ *            Configuration Table. The HMAC pads of 'mstp_DigestSignatureKey'
+ *            are derived once, after that the call only touches its
+ *            arguments and may be made from any thread.
+ *
+ * Params:    mstCfgTable -> 'MSTP_MST_CFG_TBL_SIZE' elements, MSTIDs in
+ *                           network order
+ *            digest      -> 'MSTP_DIGEST_SIZE' bytes to store the result
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_digestHmac
+ **PROC-**********************************************************************/
+void
+mstp_mstConfigurationTableDigest(const MSTID_t *mstCfgTable, uint8_t *digest)
+{
+   pthread_once(&mstp_digestHmacOnce, mstp_digestHmacInit);
+   hmac_md5_keyed(&mstp_digestHmac, (const unsigned char *)mstCfgTable,
+                  MSTP_MST_CFG_TBL_SIZE * MSTP_MST_CFG_ELEM_SIZE, digest);
+}
+
+/* Note a change of 'mstp_MstiVidTable', protocol thread only */
+void
+mstp_mstiVidTableChg(void)
+{
+   __atomic_add_fetch(&mstp_mstiVidTableGen, 1, __ATOMIC_RELAXED);
+}
+
+/* Copy the digest cache counts */
+void
+mstp_digestCacheStatsGet(uint64_t *calcCnt, uint64_t *reuseCnt)
+{
+   pthread_mutex_lock(&mstp_digestCache.lock);
+   *calcCnt = mstp_digestCache.calcCnt;
+   *reuseCnt = mstp_digestCache.reuseCnt;
+   pthread_mutex_unlock(&mstp_digestCache.lock);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_mstConfigurationDigestBench
+ *
+ * Purpose:   Time 'count' Configuration Digests of the MST Configuration
+ *            Table digested last, once with the HMAC states derived from
+ *            'mstp_DigestSignatureKey' at first use and once deriving the
+ *            pads from the key on every digest, as 'hmac_md5' does, and
+ *            time as many lookups of the cached digest at the current
+ *            'mstp_MstiVidTable' generation, which is what a reuse costs.
+ *            Works on a copy of the cached table and may be called from
+ *            any thread.
+ *
+ * Params:    count      -> digests to calculate or look up each way
+ *            keyedUsec  -> set to the time taken with the derived states
+ *            plainUsec  -> set to the time taken deriving the pads
+ *            cachedUsec -> set to the time taken by the lookups
+ *            digest     -> set to the digest, 'MSTP_DIGEST_SIZE' bytes
+ *
+ * Returns:   FALSE if the ways gave different digests
+ *
+ * Globals:   mstp_digestHmac, mstp_digestCache, mstp_mstiVidTableGen
+ **PROC-**********************************************************************/
+bool
+mstp_mstConfigurationDigestBench(uint32_t count, uint64_t *keyedUsec,
+                                 uint64_t *plainUsec, uint64_t *cachedUsec,
+                                 uint8_t *digest)
+{
+   MSTID_t  *mstCfgTable;
+   uint8_t   plain[MSTP_DIGEST_SIZE];
+   uint8_t   cached[MSTP_DIGEST_SIZE];
+   uint64_t  start;
+   uint32_t  gen;
+   uint32_t  i;
+   bool      hit = FALSE;
+
+   STP_ASSERT(keyedUsec && plainUsec && cachedUsec && digest);
+
+   mstCfgTable = xmalloc(MSTP_MST_CFG_TBL_SIZE * MSTP_MST_CFG_ELEM_SIZE);
+   pthread_mutex_lock(&mstp_digestCache.lock);
+   memcpy(mstCfgTable, mstp_digestCache.table,
+          MSTP_MST_CFG_TBL_SIZE * MSTP_MST_CFG_ELEM_SIZE);
+   pthread_mutex_unlock(&mstp_digestCache.lock);
+
+   start = mstp_utilMonoUsec();
+   for(i = 0; i < count; i++)
+      mstp_mstConfigurationTableDigest(mstCfgTable, digest);
+   *keyedUsec = mstp_utilMonoUsec() - start;
+
+   start = mstp_utilMonoUsec();
+   for(i = 0; i < count; i++)
+      hmac_md5((unsigned char *)mstCfgTable,
+               MSTP_MST_CFG_TBL_SIZE * MSTP_MST_CFG_ELEM_SIZE,
+               (unsigned char *)mstp_DigestSignatureKey,
+               MSTP_DIGEST_KEY_LEN, plain);
+   *plainUsec = mstp_utilMonoUsec() - start;
+
+   start = mstp_utilMonoUsec();
+   for(i = 0; i < count; i++)
+   {
+      gen = __atomic_load_n(&mstp_mstiVidTableGen, __ATOMIC_RELAXED);
+      pthread_mutex_lock(&mstp_digestCache.lock);
+      hit = mstp_digestCache.valid && (mstp_digestCache.gen == gen);
+      if(hit)
+         memcpy(cached, mstp_digestCache.digest, MSTP_DIGEST_SIZE);
+      pthread_mutex_unlock(&mstp_digestCache.lock);
+   }
+   *cachedUsec = mstp_utilMonoUsec() - start;
+
    free(mstCfgTable);
-   ovsdb_idl_txn_commit_block(txn);
-   ovsdb_idl_txn_destroy(txn);
-   smap_destroy(&smap);
-   MSTP_OVSDB_UNLOCK;
+   return (count == 0) ||
+          ((memcmp(digest, plain, MSTP_DIGEST_SIZE) == 0) &&
+           (!hit || (memcmp(digest, cached, MSTP_DIGEST_SIZE) == 0)));
 }
 
 /**PROC+**********************************************************************
@@ -1661,6 +2129,9 @@ mstp_validateBpdu(MSTP_RX_PDU *pkt)
 
    STP_ASSERT(pkt);
 
+   if(pkt->desc.valid)
+      return (pkt->desc.bpduType != MSTP_BPDU_TYPE_UNKNOWN);
+
    /*------------------------------------------------------------------------
     * perform test 14.4 e)
     *------------------------------------------------------------------------*/
@@ -2036,9 +2507,6 @@ void
 mstp_newTcWhile(MSTID_t mstid, LPORT_t lport)
 {
    uint16_t tcWhileVal = 0;
-   struct ovsdb_idl_txn *txn = NULL;
-   MSTP_OVSDB_LOCK;
-   txn = ovsdb_idl_txn_create(idl);
    STP_ASSERT(MSTP_ENABLED);
    STP_ASSERT(IS_VALID_LPORT(lport));
    STP_ASSERT((mstid == MSTP_CISTID) || MSTP_VALID_MSTID(mstid));
@@ -2120,9 +2588,6 @@ mstp_newTcWhile(MSTID_t mstid, LPORT_t lport)
          mstp_util_set_msti_table_value(TIME_SINCE_TOP_CHANGE,MSTP_MSTI_INFO(mstid)->timeSinceTopologyChange,mstid);
       }
    }
-   ovsdb_idl_txn_commit_block(txn);
-   ovsdb_idl_txn_destroy(txn);
-   MSTP_OVSDB_UNLOCK;
 }
 
 /**PROC+**********************************************************************
@@ -2532,8 +2997,8 @@ mstp_rcvInfoCist(MSTP_RX_PDU *pkt, LPORT_t lport)
    {/* Self sent (loop-backed) BPDU, i.e. received message was transmitted
      * by this Bridge on this Port */
       /* Update statistics counter */
-      cistPortPtr->dbgCnts.loopBackBpduCnt++;
-      cistPortPtr->dbgCnts.loopBackBpduCntLastUpdated = time(NULL);
+      cistPortPtr->cold->dbgCnts.loopBackBpduCnt++;
+      cistPortPtr->cold->dbgCnts.loopBackBpduCntLastUpdated = time(NULL);
 
       return MSTP_RCVD_INFO_SUPERIOR_DESIGNATED;
    }
@@ -2558,8 +3023,8 @@ mstp_rcvInfoCist(MSTP_RX_PDU *pkt, LPORT_t lport)
         *           ignore received BPDUs in order to keep both split parts
         *           of the Region stable */
          /* Update statistics info */
-         cistPortPtr->dbgCnts.exceededHopsBpduCnt++;
-         cistPortPtr->dbgCnts.exceededHopsBpduCntLastUpdated =
+         cistPortPtr->cold->dbgCnts.exceededHopsBpduCnt++;
+         cistPortPtr->cold->dbgCnts.exceededHopsBpduCntLastUpdated =
                                                          time(NULL);
          return MSTP_RCVD_INFO_OTHER;
       }
@@ -2890,8 +3355,8 @@ mstp_rcvInfoMsti(MSTP_RX_PDU *pkt, MSTID_t mstid, LPORT_t lport)
         *           ignore received BPDUs in order to keep both split parts
         *           of the Region stable */
          /* Update statistics info */
-         mstiPortPtr->dbgCnts.exceededHopsMsgCnt++;
-         mstiPortPtr->dbgCnts.exceededHopsMsgCntLastUpdated =
+         mstiPortPtr->cold->dbgCnts.exceededHopsMsgCnt++;
+         mstiPortPtr->cold->dbgCnts.exceededHopsMsgCntLastUpdated =
                                                          time(NULL);
          return MSTP_RCVD_INFO_OTHER;
       }
@@ -3468,6 +3933,8 @@ mstp_recordPriority(MSTID_t mstid,  LPORT_t lport)
       STP_ASSERT(mstiPortPtr);
       mstiPortPtr->portPriority = mstiPortPtr->msgPriority;
    }
+
+   mstp_statusPortChg(mstid, lport);
 }
 
 /**PROC+**********************************************************************
@@ -3495,9 +3962,6 @@ mstp_recordPriority(MSTID_t mstid,  LPORT_t lport)
 void
 mstp_recordTimes(MSTID_t mstid,  LPORT_t lport)
 {
-    struct ovsdb_idl_txn *txn = NULL;
-    MSTP_OVSDB_LOCK;
-    txn = ovsdb_idl_txn_create(idl);
     STP_ASSERT(IS_VALID_LPORT(lport));
    STP_ASSERT(mstid == MSTP_CISTID || MSTP_VALID_MSTID(mstid));
 
@@ -3547,9 +4011,6 @@ mstp_recordTimes(MSTID_t mstid,  LPORT_t lport)
       STP_ASSERT(mstiPortPtr);
       mstiPortPtr->portTimes.hops = mstiPortPtr->msgTimes.hops;
    }
-   ovsdb_idl_txn_commit_block(txn);
-   ovsdb_idl_txn_destroy(txn);
-   MSTP_OVSDB_UNLOCK;
 }
 
 /**PROC+**********************************************************************
@@ -3603,32 +4064,10 @@ mstp_setRcvdMsgs(MSTP_RX_PDU *pkt, LPORT_t lport)
     *------------------------------------------------------------------------*/
    bpduType = mstp_getBpduType(pkt);
 
-   MSTP_RX_BPDU_CNT++;
-
    /*------------------------------------------------------------------------
     * update internal statistics counters
     *------------------------------------------------------------------------*/
-   if(bpduType == MSTP_BPDU_TYPE_MSTP)
-   {
-      cistPortPtr->dbgCnts.mstBpduRxCnt++;
-      update_mstp_counters(lport, MSTP_RX_BPDU);
-      cistPortPtr->dbgCnts.mstBpduRxCntLastUpdated = time(NULL);
-   }
-   else if(bpduType == MSTP_BPDU_TYPE_RSTP)
-   {
-      cistPortPtr->dbgCnts.rstBpduRxCnt++;
-      cistPortPtr->dbgCnts.rstBpduRxCntLastUpdated = time(NULL);
-   }
-   else if(bpduType == MSTP_BPDU_TYPE_STP)
-   {
-      cistPortPtr->dbgCnts.cfgBpduRxCnt++;
-      cistPortPtr->dbgCnts.cfgBpduRxCntLastUpdated = time(NULL);
-   }
-   else if(bpduType == MSTP_BPDU_TYPE_TCN)
-   {
-      cistPortPtr->dbgCnts.tcnBpduRxCnt++;
-      cistPortPtr->dbgCnts.tcnBpduRxCntLastUpdated = time(NULL);
-   }
+   mstp_rxBpduCount(pkt, lport, TRUE);
 
    if(MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap, MSTP_PORT_RCVD_INTERNAL))
    {/* 'rcvdInternal' is set, then set 'rcvdMsg' for each and every MSTI
@@ -3665,14 +4104,6 @@ mstp_setRcvdMsgs(MSTP_RX_PDU *pkt, LPORT_t lport)
                 *------------------------------------------------------------*/
                MSTP_MSTI_PORT_SET_BIT(mstiPortPtr->bitMap,
                                       MSTP_MSTI_PORT_RCVD_MSG);
-
-               /*------------------------------------------------------------
-                * update statistics counters
-                *------------------------------------------------------------*/
-               mstiPortPtr->dbgCnts.mstiMsgRxCnt++;
-               mstiPortPtr->dbgCnts.mstiMsgRxCntLastUpdated =
-                                                         time(NULL);
-
             }
 
             mstiMsg++;
@@ -3681,6 +4112,155 @@ mstp_setRcvdMsgs(MSTP_RX_PDU *pkt, LPORT_t lport)
    }
 }
 
+/**PROC+**********************************************************************
+ * Name:      mstp_rxBpduCount
+ *
+ * Purpose:   Update the per-port receive statistics for a BPDU: the count
+ *            per BPDU type, the CIST debug counter of the type and, if
+ *            'rcvdInternal' is set, the debug counter of every MSTI with a
+ *            message in the BPDU. Used by 'mstp_setRcvdMsgs' and by the
+ *            receive fast path, so both count a BPDU the same way.
+ *
+ * Params:    pkt   -> pointer to the packet buffer with BPDU in
+ *            lport -> logical port number
+ *            apply -> FALSE to only return how many counters would be
+ *                     incremented
+ *
+ * Returns:   the number of counters incremented, see 'mstp_rxPortCntSum'
+ *
+ * Globals:   mstp_Bridge
+ **PROC-**********************************************************************/
+uint32_t
+mstp_rxBpduCount(MSTP_RX_PDU *pkt, LPORT_t lport, bool apply)
+{
+   MSTP_COMM_PORT_INFO_t     *commPortPtr = MSTP_COMM_PORT_PTR(lport);
+   MSTP_CIST_PORT_INFO_t     *cistPortPtr = MSTP_CIST_PORT_PTR(lport);
+   MSTP_MSTI_CONFIG_MSG_t    *mstiMsg     = NULL;
+   MSTP_MSTI_PORT_INFO_t     *mstiPortPtr;
+   MSTP_CIST_PORT_DBG_CNTS_t *cnts;
+   MSTP_BPDU_TYPE_t           bpduType;
+   MSTID_t                    mstid;
+   uint32_t                   cnt         = 0;
+   time_t                     now;
+
+   STP_ASSERT(commPortPtr && cistPortPtr);
+
+   bpduType = mstp_getBpduType(pkt);
+   cnts = &cistPortPtr->cold->dbgCnts;
+   now = apply ? time(NULL) : 0;
+
+   if(apply)
+      MSTP_RX_BPDU_CNT++;
+
+   if(bpduType < MSTP_BPDU_TYPE_MAX)
+   {
+      cnt++;
+      if(apply)
+         commPortPtr->bpduRxCnt[bpduType]++;
+   }
+
+   if(bpduType == MSTP_BPDU_TYPE_MSTP)
+   {
+      cnt++;
+      if(apply)
+      {
+         cnts->mstBpduRxCnt++;
+         cnts->mstBpduRxCntLastUpdated = now;
+      }
+   }
+   else if(bpduType == MSTP_BPDU_TYPE_RSTP)
+   {
+      cnt++;
+      if(apply)
+      {
+         cnts->rstBpduRxCnt++;
+         cnts->rstBpduRxCntLastUpdated = now;
+      }
+   }
+   else if(bpduType == MSTP_BPDU_TYPE_STP)
+   {
+      cnt++;
+      if(apply)
+      {
+         cnts->cfgBpduRxCnt++;
+         cnts->cfgBpduRxCntLastUpdated = now;
+      }
+   }
+   else if(bpduType == MSTP_BPDU_TYPE_TCN)
+   {
+      cnt++;
+      if(apply)
+      {
+         cnts->tcnBpduRxCnt++;
+         cnts->tcnBpduRxCntLastUpdated = now;
+      }
+   }
+
+   if((bpduType != MSTP_BPDU_TYPE_MSTP) ||
+      !MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap, MSTP_PORT_RCVD_INTERNAL))
+      return cnt;
+
+   while((mstiMsg = mstp_findNextMstiCfgMsgInBpdu(pkt, mstiMsg)))
+   {
+      mstid = MSTP_GET_BRIDGE_SYS_ID_FROM_PKT(mstiMsg->mstiRgnRootId);
+      if(!MSTP_VALID_MSTID(mstid) || !MSTP_MSTI_VALID(mstid) ||
+         !(mstiPortPtr = MSTP_MSTI_PORT_PTR(mstid, lport)))
+         continue;
+
+      cnt++;
+      if(apply)
+      {
+         mstiPortPtr->cold->dbgCnts.mstiMsgRxCnt++;
+         mstiPortPtr->cold->dbgCnts.mstiMsgRxCntLastUpdated = now;
+      }
+   }
+
+   return cnt;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_rxPortCntSum
+ *
+ * Purpose:   Sum of the receive counters 'mstp_rxBpduCount' updates on a
+ *            port, for the fast path's strict mode to check that the full
+ *            receive path counted a BPDU as the fast path would have.
+ *
+ * Params:    lport -> logical port number
+ *
+ * Returns:   the sum
+ *
+ * Globals:   mstp_Bridge
+ **PROC-**********************************************************************/
+uint64_t
+mstp_rxPortCntSum(LPORT_t lport)
+{
+   MSTP_COMM_PORT_INFO_t     *commPortPtr = MSTP_COMM_PORT_PTR(lport);
+   MSTP_CIST_PORT_INFO_t     *cistPortPtr = MSTP_CIST_PORT_PTR(lport);
+   MSTP_MSTI_PORT_INFO_t     *mstiPortPtr;
+   MSTP_CIST_PORT_DBG_CNTS_t *cnts;
+   MSTID_t                    mstid;
+   uint64_t                   sum         = 0;
+   int                        type;
+
+   STP_ASSERT(commPortPtr && cistPortPtr);
+
+   for(type = 0; type < MSTP_BPDU_TYPE_MAX; type++)
+      sum += commPortPtr->bpduRxCnt[type];
+
+   cnts = &cistPortPtr->cold->dbgCnts;
+   sum += cnts->mstBpduRxCnt + cnts->rstBpduRxCnt + cnts->cfgBpduRxCnt +
+          cnts->tcnBpduRxCnt;
+
+   for(mstid = MSTP_MSTID_MIN; mstid <= MSTP_MSTID_MAX; mstid++)
+   {
+      if(MSTP_MSTI_VALID(mstid) &&
+         (mstiPortPtr = MSTP_MSTI_PORT_PTR(mstid, lport)))
+         sum += mstiPortPtr->cold->dbgCnts.mstiMsgRxCnt;
+   }
+
+   return sum;
+}
+
 /**PROC+**********************************************************************
  * Name:      mstp_setReRootTree
  *
@@ -3930,8 +4510,8 @@ mstp_setTcFlags(MSTP_RX_PDU *pkt, MSTID_t mstid, LPORT_t lport)
           * statistics counter
           *------------------------------------------------------------------*/
          MSTP_COMM_PORT_SET_BIT(commPortPtr->bitMap, MSTP_PORT_RCVD_TC_ACK);
-         cistPortPtr->dbgCnts.tcAckFlagRxCnt++;
-         cistPortPtr->dbgCnts.tcAckFlagRxCntLastUpdated = time(NULL);
+         cistPortPtr->cold->dbgCnts.tcAckFlagRxCnt++;
+         cistPortPtr->cold->dbgCnts.tcAckFlagRxCntLastUpdated = time(NULL);
       }
 
       if(rcvdInternal)
@@ -3945,8 +4525,8 @@ mstp_setTcFlags(MSTP_RX_PDU *pkt, MSTID_t mstid, LPORT_t lport)
              *---------------------------------------------------------------*/
 
             MSTP_CIST_PORT_SET_BIT(cistPortPtr->bitMap, MSTP_CIST_PORT_RCVD_TC);
-            cistPortPtr->dbgCnts.tcFlagRxCnt++;
-            cistPortPtr->dbgCnts.tcFlagRxCntLastUpdated = time(NULL);
+            cistPortPtr->cold->dbgCnts.tcFlagRxCnt++;
+            cistPortPtr->cold->dbgCnts.tcFlagRxCntLastUpdated = time(NULL);
             mstpUpdateTcHistory(mstid, lport, FALSE);
             intf_get_port_name(lport, portName);
             VLOG_DBG("Topology Change received on port %s for %s from Source MAC %02x%02x%02x-%02x%02x%02x",portName,"CIST",PRINT_MAC_ADDR(commPortPtr->bpduSrcMac));
@@ -3967,8 +4547,8 @@ mstp_setTcFlags(MSTP_RX_PDU *pkt, MSTID_t mstid, LPORT_t lport)
           * statistics counter
           *------------------------------------------------------------------*/
          MSTP_CIST_PORT_SET_BIT(cistPortPtr->bitMap,MSTP_CIST_PORT_RCVD_TC);
-         cistPortPtr->dbgCnts.tcFlagRxCnt++;
-         cistPortPtr->dbgCnts.tcFlagRxCntLastUpdated = time(NULL);
+         cistPortPtr->cold->dbgCnts.tcFlagRxCnt++;
+         cistPortPtr->cold->dbgCnts.tcFlagRxCntLastUpdated = time(NULL);
 
          mstpUpdateTcHistory(mstid, lport, FALSE);
          intf_get_port_name(lport, portName);
@@ -3990,8 +4570,8 @@ mstp_setTcFlags(MSTP_RX_PDU *pkt, MSTID_t mstid, LPORT_t lport)
                STP_ASSERT(mstiPortPtr);
                MSTP_MSTI_PORT_SET_BIT(mstiPortPtr->bitMap,
                                       MSTP_MSTI_PORT_RCVD_TC);
-               mstiPortPtr->dbgCnts.tcFlagRxCnt++;
-               mstiPortPtr->dbgCnts.tcFlagRxCntLastUpdated =
+               mstiPortPtr->cold->dbgCnts.tcFlagRxCnt++;
+               mstiPortPtr->cold->dbgCnts.tcFlagRxCntLastUpdated =
                                                          time(NULL);
                mstpUpdateTcHistory(tmpId, lport, FALSE);
                intf_get_port_name(lport, portName);
@@ -4032,8 +4612,8 @@ mstp_setTcFlags(MSTP_RX_PDU *pkt, MSTID_t mstid, LPORT_t lport)
           * statistics counter
           *------------------------------------------------------------------*/
          MSTP_MSTI_PORT_SET_BIT(mstiPortPtr->bitMap, MSTP_MSTI_PORT_RCVD_TC);
-         mstiPortPtr->dbgCnts.tcFlagRxCnt++;
-         mstiPortPtr->dbgCnts.tcFlagRxCntLastUpdated = time(NULL);
+         mstiPortPtr->cold->dbgCnts.tcFlagRxCnt++;
+         mstiPortPtr->cold->dbgCnts.tcFlagRxCntLastUpdated = time(NULL);
          mstpUpdateTcHistory(mstid, lport, FALSE);
          intf_get_port_name(lport, portName);
          snprintf(mst_str, sizeof(mst_str), "MSTI %d", mstid);
@@ -4213,7 +4793,6 @@ mstp_txTcn(LPORT_t lport)
    MSTP_COMM_PORT_INFO_t *commPortPtr;
    MSTP_CIST_PORT_INFO_t *cistPortPtr;
    struct iface_data *idp = NULL;
-   const char *my_mac = NULL;
    MAC_ADDRESS mac;
    int rc;
 
@@ -4260,8 +4839,7 @@ mstp_txTcn(LPORT_t lport)
    MAC_ADDR_COPY(stp_multicast, bpdu->lsapHdr.dst);
 
    /* get the mac address for the port */
-   my_mac = intf_get_mac_addr(lport);
-   sscanf(my_mac,"%02hhx:%02hhx:%02hhx:%02hhx:%02hhx:%02hhx",&mac[0],&mac[1],&mac[2],&mac[3],&mac[4],&mac[5]);
+   intf_get_lport_mac(lport, mac);
    MAC_ADDR_COPY(&mac, bpdu->lsapHdr.src);
 
    storeShortInPacket(&bpdu->lsapHdr.len, (SNAP + MSTP_STP_TCN_BPDU_LEN_MIN));
@@ -4281,8 +4859,10 @@ mstp_txTcn(LPORT_t lport)
     *------------------------------------------------------------------------*/
    MSTP_TX_BPDU_CNT++;
    /* update statistics counter */
-   cistPortPtr->dbgCnts.tcnBpduTxCnt++;
-   cistPortPtr->dbgCnts.tcnBpduTxCntLastUpdated = time(NULL);
+   cistPortPtr->cold->dbgCnts.tcnBpduTxCnt++;
+   commPortPtr->bpduTxCnt[MSTP_BPDU_TYPE_TCN]++;
+   commPortPtr->dbxTxCnt++;
+   cistPortPtr->cold->dbgCnts.tcnBpduTxCntLastUpdated = time(NULL);
    idp = find_iface_data_by_index(lport);
 
    if (idp == NULL) {
@@ -4344,7 +4924,6 @@ mstp_txConfig(LPORT_t lport)
    MSTP_CIST_PORT_INFO_t             *cistPortPtr  = NULL;
    MSTP_CIST_DESIGNATED_PRI_VECTOR_t *dsnPriVecPtr = NULL;
    MSTP_CIST_DESIGNATED_TIMES_t      *dsnTimesPtr  = NULL;
-   const char *my_mac = NULL;
    int rc;
    struct iface_data *idp = NULL;
    MAC_ADDRESS mac;
@@ -4383,9 +4962,7 @@ mstp_txConfig(LPORT_t lport)
    MAC_ADDR_COPY(stp_multicast, bpdu->lsapHdr.dst);
 
    /* get the mac address for the port */
-   my_mac = intf_get_mac_addr(lport);
-   VLOG_DBG("MSTP Util : 5 : mac : %s", my_mac);
-   sscanf(my_mac,"%02hhx:%02hhx:%02hhx:%02hhx:%02hhx:%02hhx",&mac[0],&mac[1],&mac[2],&mac[3],&mac[4],&mac[5]);
+   intf_get_lport_mac(lport, mac);
    MAC_ADDR_COPY(&mac, bpdu->lsapHdr.src);
 
    storeShortInPacket(&bpdu->lsapHdr.len,
@@ -4426,16 +5003,16 @@ mstp_txConfig(LPORT_t lport)
    {/* (tcWhile != 0), set topology change flag for the Port */
       bpdu->flags |= MSTP_CIST_FLAG_TC;
       /* increment propagated TC flags statistics counter */
-      cistPortPtr->dbgCnts.tcFlagTxCnt++;
-      cistPortPtr->dbgCnts.tcFlagTxCntLastUpdated = time(NULL);
+      cistPortPtr->cold->dbgCnts.tcFlagTxCnt++;
+      cistPortPtr->cold->dbgCnts.tcFlagTxCntLastUpdated = time(NULL);
    }
 
    if(MSTP_COMM_PORT_IS_BIT_SET(commPortPtr->bitMap, MSTP_PORT_TC_ACK))
    {/* 'TcAck' is set, set topology change acknowledgement flag for the Port */
       bpdu->flags |= MSTP_CIST_FLAG_TC_ACK;
       /* increment transmitted TC ACK flags statistics counter */
-      cistPortPtr->dbgCnts.tcAckFlagTxCnt++;
-      cistPortPtr->dbgCnts.tcAckFlagTxCntLastUpdated = time(NULL);
+      cistPortPtr->cold->dbgCnts.tcAckFlagTxCnt++;
+      cistPortPtr->cold->dbgCnts.tcAckFlagTxCntLastUpdated = time(NULL);
    }
    /*------------------------------------------------------------------------
     * set message times parameters
@@ -4451,6 +5028,8 @@ mstp_txConfig(LPORT_t lport)
 
 
    MSTP_TX_BPDU_CNT++;
+   commPortPtr->bpduTxCnt[MSTP_BPDU_TYPE_STP]++;
+   commPortPtr->dbxTxCnt++;
    idp = find_iface_data_by_index(lport);
 
    if (idp == NULL) {
@@ -4532,7 +5111,6 @@ mstp_txMstp(LPORT_t lport)
    MSTP_CIST_DESIGNATED_TIMES_t      *cistDsnTimesPtr  = NULL;
    int                                bpduLen          = 0;
    MSTID_t                            mstid            = MSTP_CISTID;
-   const char *my_mac = NULL;
    MAC_ADDRESS mac;
    struct iface_data *idp = NULL;
    int rc= 0;
@@ -4590,9 +5168,7 @@ mstp_txMstp(LPORT_t lport)
    MAC_ADDR_COPY(stp_multicast, bpdu->lsapHdr.dst);
 
    /* get the mac address for the port */
-   my_mac = intf_get_mac_addr(lport);
-   VLOG_DBG("MSTP Util : 5 : mac : %s", my_mac);
-   sscanf(my_mac,"%02hhx:%02hhx:%02hhx:%02hhx:%02hhx:%02hhx",&mac[0],&mac[1],&mac[2],&mac[3],&mac[4],&mac[5]);
+   intf_get_lport_mac(lport, mac);
    MAC_ADDR_COPY(&mac, bpdu->lsapHdr.src);
 
    bpduLen            = SNAP + MSTP_RST_BPDU_LEN_MIN;
@@ -4687,8 +5263,8 @@ mstp_txMstp(LPORT_t lport)
       VLOG_DBG("MSTP tcWhile : %d port : %d", cistPortPtr->tcWhile, lport);
       bpdu->cistFlags |= MSTP_CIST_FLAG_TC;
       /* increment propagated TC flags statistics counter */
-      cistPortPtr->dbgCnts.tcFlagTxCnt++;
-      cistPortPtr->dbgCnts.tcFlagTxCntLastUpdated = time(NULL);
+      cistPortPtr->cold->dbgCnts.tcFlagTxCnt++;
+      cistPortPtr->cold->dbgCnts.tcFlagTxCntLastUpdated = time(NULL);
    }
 
    if(MSTP_CIST_PORT_IS_BIT_SET(cistPortPtr->bitMap, MSTP_CIST_PORT_LEARNING))
@@ -4727,8 +5303,9 @@ mstp_txMstp(LPORT_t lport)
      * parameter is set to 2 (denoting an RST BPDU) */
      bpdu->protocolVersionId = MSTP_PROTOCOL_VERSION_ID_RST;
      /* Update RST BPDUs TX statistics */
-     cistPortPtr->dbgCnts.rstBpduTxCnt++;
-     cistPortPtr->dbgCnts.rstBpduTxCntLastUpdated = time(NULL);
+     cistPortPtr->cold->dbgCnts.rstBpduTxCnt++;
+     commPortPtr->bpduTxCnt[MSTP_BPDU_TYPE_RSTP]++;
+     cistPortPtr->cold->dbgCnts.rstBpduTxCntLastUpdated = time(NULL);
    }
    else
    {/* Otherwise, the protocol version parameter is set to 3 (denoting an
@@ -4906,8 +5483,8 @@ mstp_txMstp(LPORT_t lport)
                {/* (tcWhile != 0), set MSTI topology change flag */
                   mstiMsgPtr->mstiFlags |= MSTP_MSTI_FLAG_TC;
                   /* increment propagated TC flags statistics counter */
-                  mstiPortPtr->dbgCnts.tcFlagTxCnt++;
-                  mstiPortPtr->dbgCnts.tcFlagTxCntLastUpdated =
+                  mstiPortPtr->cold->dbgCnts.tcFlagTxCnt++;
+                  mstiPortPtr->cold->dbgCnts.tcFlagTxCntLastUpdated =
                                                          time(NULL);
                }
 
@@ -4932,8 +5509,8 @@ mstp_txMstp(LPORT_t lport)
                version3Len += sizeof(MSTP_MSTI_CONFIG_MSG_t);
 
                /* update MSTI CFG MSGs TX statistics */
-               mstiPortPtr->dbgCnts.mstiMsgTxCnt++;
-               mstiPortPtr->dbgCnts.mstiMsgTxCntLastUpdated =
+               mstiPortPtr->cold->dbgCnts.mstiMsgTxCnt++;
+               mstiPortPtr->cold->dbgCnts.mstiMsgTxCntLastUpdated =
                                                          time(NULL);
 
                /*------------------------------------------------------------
@@ -4956,9 +5533,9 @@ mstp_txMstp(LPORT_t lport)
       bpduLen += version3Len;
 
       /* Update MST BPDUs TX statistics */
-      cistPortPtr->dbgCnts.mstBpduTxCnt++;
-      update_mstp_counters(lport, MSTP_TX_BPDU);
-      cistPortPtr->dbgCnts.mstBpduTxCntLastUpdated = time(NULL);
+      cistPortPtr->cold->dbgCnts.mstBpduTxCnt++;
+      commPortPtr->bpduTxCnt[MSTP_BPDU_TYPE_MSTP]++;
+      cistPortPtr->cold->dbgCnts.mstBpduTxCntLastUpdated = time(NULL);
    }
 
    /*------------------------------------------------------------------------
@@ -4978,6 +5555,7 @@ mstp_txMstp(LPORT_t lport)
     * transmit the packet
     *------------------------------------------------------------------------*/
    MSTP_TX_BPDU_CNT++;
+   commPortPtr->dbxTxCnt++;
    idp = find_iface_data_by_index(lport);
 
    if (idp == NULL) {
@@ -5133,14 +5711,14 @@ mstp_updtRcvdInfoWhile(MSTID_t mstid, LPORT_t lport)
 
       if(!rcvdInternal && (messageAge > maxAge))
       {/* Message Age exceeds Max Age */
-         cistPortPtr->dbgCnts.agedBpduCnt++;
-         cistPortPtr->dbgCnts.agedBpduCntLastUpdated = time(NULL);
+         cistPortPtr->cold->dbgCnts.agedBpduCnt++;
+         cistPortPtr->cold->dbgCnts.agedBpduCntLastUpdated = time(NULL);
       }
 
       if(rcvdInternal && (remainingHops <= 0) )
       {/* 'remainingHops' is less than or equal to zero */
-         cistPortPtr->dbgCnts.exceededHopsBpduCnt++;
-         cistPortPtr->dbgCnts.exceededHopsBpduCntLastUpdated =
+         cistPortPtr->cold->dbgCnts.exceededHopsBpduCnt++;
+         cistPortPtr->cold->dbgCnts.exceededHopsBpduCntLastUpdated =
                                                          time(NULL);
       }
    }
@@ -5149,8 +5727,8 @@ mstp_updtRcvdInfoWhile(MSTID_t mstid, LPORT_t lport)
       mstiPortPtr->rcvdInfoWhile = rcvdInfoWhile;
       if(remainingHops <= 0)
       {/* 'remainingHops' is less than or equal to zero */
-         mstiPortPtr->dbgCnts.exceededHopsMsgCnt++;
-         mstiPortPtr->dbgCnts.exceededHopsMsgCntLastUpdated =
+         mstiPortPtr->cold->dbgCnts.exceededHopsMsgCnt++;
+         mstiPortPtr->cold->dbgCnts.exceededHopsMsgCntLastUpdated =
                                                          time(NULL);
       }
    }
@@ -5177,18 +5755,12 @@ mstp_updtRcvdInfoWhile(MSTID_t mstid, LPORT_t lport)
 void
 mstp_updtRolesTree(MSTID_t mstid)
 {
-   struct ovsdb_idl_txn *txn = NULL;
    STP_ASSERT(MSTP_ENABLED);
    STP_ASSERT(mstid == MSTP_CISTID || MSTP_VALID_MSTID(mstid));
-   MSTP_OVSDB_LOCK;
-   txn = ovsdb_idl_txn_create(idl);
    if(mstid == MSTP_CISTID)
       mstp_updtRolesCist();
    else
       mstp_updtRolesMsti(mstid);
-   ovsdb_idl_txn_commit_block(txn);
-   ovsdb_idl_txn_destroy(txn);
-   MSTP_OVSDB_UNLOCK;
 }
 
 /**PROC+**********************************************************************
@@ -5815,37 +6387,33 @@ mstp_updtRolesCist(void)
 }
 
 /**PROC+**********************************************************************
- * Name:      mstp_updtRolesMsti
+ * Name:      mstp_mstiRootElect
  *
- * Purpose:   Helper function called by the 'updtRolesTree' function to
- *            calculate the MSTI Priority Vectors (13.9, 13.11) and Timer
- *            Values. It also assignes the MSTI Port Role for each
- *            Port and updates Port's Port Priority Vector and Spanning
- *            Tree Timer Information.
+ * Purpose:   First step of 'mstp_updtRolesMsti': find the MSTI Root Priority
+ *            Vector and the Root Port, the best of the Bridge's own Bridge
+ *            Priority Vector and of the Root Path Priority Vectors of the
+ *            ports.
+ *            NOTE: only reads the Bridge and the MSTI's own port data, so
+ *                  the MSTI worker pool runs it for several MSTIs at once.
+ *                  It must stay free of side effects.
  *            (802.1Q-REV/D5.0 13.26.23)
  *
  * Params:    mstid -> MST Instance Identifier
+ *            elect -> result
  *
  * Returns:   none
  *
- * Globals:   mstp_CB, mstp_Bridge
+ * Globals:   mstp_Bridge
  *
  **PROC-**********************************************************************/
-static void
-mstp_updtRolesMsti(MSTID_t mstid)
+void
+mstp_mstiRootElect(MSTID_t mstid, MSTP_MSTI_ELECT_t *elect)
 {
    MSTP_COMM_PORT_INFO_t         *commPortPtr;
    MSTP_MSTI_PORT_INFO_t         *mstiPortPtr;
    MSTP_MSTI_BRIDGE_PRI_VECTOR_t  mstiRootPriVec;
-   MSTP_PORT_ID_t                 mstiRootPortId;
-   LPORT_t                        lport;
-   MSTP_PORT_ROLE_t               selectedRole = MSTP_PORT_ROLE_UNKNOWN;
-   MSTP_MSTI_ROOT_TIMES_t         mstiRootTimes;
-   bool                           rootTimeChange = FALSE;
-   char                           oldRootPortName[PORTNAME_LEN];
-   char                           newRootPortName[PORTNAME_LEN];
-   char                           msti_str[10];
-   char                           designatedRoot[MSTP_ROOT_ID] = {0};
+   MSTP_PORT_ID_t                 mstiRootPortId;
+   LPORT_t                        lport;
 
    /*------------------------------------------------------------------------
     * Assume that the Bridge's own Bridge Priority Vector is the best, i.e.
@@ -5921,7 +6489,6 @@ mstp_updtRolesMsti(MSTID_t mstid)
             * current Root Path Cost value
             *----------------------------------------------------------------*/
            rootPathPriVec.intRootPathCost += mstiPortPtr->InternalPortPathCost;
-           mstp_util_set_msti_table_value(ROOT_PATH_COST,rootPathPriVec.intRootPathCost,mstid);
 
             /*----------------------------------------------------------------
              * Compare newly calculated Port's Root Path Priority Vector
@@ -5949,6 +6516,63 @@ mstp_updtRolesMsti(MSTID_t mstid)
       }/* end of '(commPortPtr && mstiPortPtr)' statement */
    }/* end of 'for(lport = 1; lport <= MAX_LPORTS; lport++)' */
 
+   elect->rootPriority = mstiRootPriVec;
+   elect->rootPortID = mstiRootPortId;
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_updtRolesMsti
+ *
+ * Purpose:   Helper function called by the 'updtRolesTree' function to
+ *            calculate the MSTI Priority Vectors (13.9, 13.11) and Timer
+ *            Values. It also assignes the MSTI Port Role for each
+ *            Port and updates Port's Port Priority Vector and Spanning
+ *            Tree Timer Information.
+ *            (802.1Q-REV/D5.0 13.26.23)
+ *
+ * Params:    mstid -> MST Instance Identifier
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_CB, mstp_Bridge
+ *
+ **PROC-**********************************************************************/
+static void
+mstp_updtRolesMsti(MSTID_t mstid)
+{
+   MSTP_COMM_PORT_INFO_t         *commPortPtr;
+   MSTP_MSTI_PORT_INFO_t         *mstiPortPtr;
+   MSTP_MSTI_BRIDGE_PRI_VECTOR_t  mstiRootPriVec;
+   MSTP_PORT_ID_t                 mstiRootPortId;
+   MSTP_MSTI_ELECT_t              elect;
+   LPORT_t                        lport;
+   MSTP_PORT_ROLE_t               selectedRole = MSTP_PORT_ROLE_UNKNOWN;
+   MSTP_MSTI_ROOT_TIMES_t         mstiRootTimes;
+   bool                           rootTimeChange = FALSE;
+   char                           oldRootPortName[PORTNAME_LEN];
+   char                           newRootPortName[PORTNAME_LEN];
+   char                           msti_str[10];
+   char                           designatedRoot[MSTP_ROOT_ID] = {0};
+
+   /*------------------------------------------------------------------------
+    * Find the Root Priority Vector and the Root Port, unless the MSTI
+    * worker pool has just done it
+    *------------------------------------------------------------------------*/
+   if(MSTP_MSTI_INFO(mstid)->electValid)
+   {
+      MSTP_MSTI_INFO(mstid)->electValid = FALSE;
+      elect = MSTP_MSTI_INFO(mstid)->elect;
+   }
+   else
+   {
+      mstp_mstiRootElect(mstid, &elect);
+   }
+   mstiRootPriVec = elect.rootPriority;
+   mstiRootPortId = elect.rootPortID;
+   if(mstiRootPortId != 0)
+      mstp_util_set_msti_table_value(ROOT_PATH_COST,
+                                     mstiRootPriVec.intRootPathCost, mstid);
+
    /*-------------------------------------------------------------------------
     * Check if the MSTI Regional Root has been changed, if so then update
     * the MSTI Reginal Root change history.
@@ -7018,6 +7642,51 @@ mstp_logNewRootId(MSTP_BRIDGE_IDENTIFIER_t oldRootId,
    }
 }
 
+/**PROC+**********************************************************************
+ * Name:      mstp_utilMonoUsec
+ *
+ * Purpose:   Read the monotonic clock.
+ *
+ * Params:    none
+ *
+ * Returns:   current CLOCK_MONOTONIC time in microseconds.
+ *
+ * Globals:   none
+ *
+ **PROC-**********************************************************************/
+uint64_t
+mstp_utilMonoUsec(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_treeMsgSlot
+ *
+ * Purpose:   Map MST Instance Identifier to its tree message slot.
+ *
+ * Params:    mstid -> MST Instance Identifier in question.
+ *
+ * Returns:   slot index, -1 if the 'mstid' is out of range.
+ *
+ * Globals:   none
+ *
+ **PROC-**********************************************************************/
+static int
+mstp_treeMsgSlot(MSTID_t mstid)
+{
+   if(mstid <= MSTP_INSTANCES_MAX)
+      return (int)mstid;
+
+   if(mstid == MSTP_NON_STP_BRIDGE)
+      return MSTP_TREE_MSG_NON_STP_SLOT;
+
+   return -1;
+}
+
 /**PROC+**********************************************************************
  * Name:      mstp_findMstiPortStateChgMsg
  *
@@ -7029,24 +7698,90 @@ mstp_logNewRootId(MSTP_BRIDGE_IDENTIFIER_t oldRootId,
  * Returns:   pointer to the tree change information block corresponding to
  *            the given 'mstid' if found, NULL otherwise.
  *
- * Globals:   none
+ * Globals:   mstp_CB
  *
  **PROC-**********************************************************************/
 MSTP_TREE_MSG_t *
 mstp_findMstiPortStateChgMsg(MSTID_t mstid)
 {
-   MSTP_TREE_MSG_t *m = (MSTP_TREE_MSG_t *)qfirst_nodis(&MSTP_TREE_MSGS_QUEUE);
+   int slot = mstp_treeMsgSlot(mstid);
+
+   if((slot < 0) || !MSTP_TREE_MSG_SLOT_IS_DIRTY(slot))
+      return NULL;
+
+   return &mstp_CB.msgs.treeMsgSlot[slot];
+}
+
+/**PROC+**********************************************************************
+ * Name:      mstp_getMstiPortStateChgMsg
+ *
+ * Purpose:   Get ports state change information block of the given MST
+ *            Instance. If the tree has no pending information yet its
+ *            preallocated slot is cleared and linked to the tail of the
+ *            global queue.
+ *
+ * Params:    mstid -> MST Instance Identifier in question.
+ *
+ * Returns:   pointer to the tree change information block, NULL if 'mstid'
+ *            has no slot.
+ *
+ * Globals:   mstp_CB
+ *
+ **PROC-**********************************************************************/
+MSTP_TREE_MSG_t *
+mstp_getMstiPortStateChgMsg(MSTID_t mstid)
+{
+   MSTP_TREE_MSG_t *m;
+   int              slot = mstp_treeMsgSlot(mstid);
 
-   for(; m != (MSTP_TREE_MSG_t *) Q_NULL;
-         m  = (MSTP_TREE_MSG_t *) qnext_nodis(&MSTP_TREE_MSGS_QUEUE, &m->link))
+   if(slot < 0)
    {
-      if (m->mstid == mstid)
-         break;
+      STP_ASSERT(0);
+      return NULL;
+   }
+
+   m = &mstp_CB.msgs.treeMsgSlot[slot];
+   if(!MSTP_TREE_MSG_SLOT_IS_DIRTY(slot))
+   {
+      memset(m, 0, sizeof(MSTP_TREE_MSG_t));
+      m->mstid = mstid;
+      insqti_nodis(&MSTP_TREE_MSGS_QUEUE, &m->link);
+      MSTP_TREE_MSG_SLOT_SET_DIRTY(slot);
+
+      mstp_CB.treeMsgSlotUseCnt++;
+      mstp_CB.treeMsgSlotUseCur++;
    }
 
    return m;
 }
 
+/**PROC+**********************************************************************
+ * Name:      mstp_releaseMstiPortStateChgMsg
+ *
+ * Purpose:   Take the tree change information block off the global queue
+ *            and give its slot back. Replaces 'free' of the block.
+ *
+ * Params:    m -> pointer to the queued tree change information block
+ *
+ * Returns:   none
+ *
+ * Globals:   mstp_CB
+ *
+ **PROC-**********************************************************************/
+void
+mstp_releaseMstiPortStateChgMsg(MSTP_TREE_MSG_t *m)
+{
+   int slot;
+
+   STP_ASSERT(m);
+   slot = (int)(m - mstp_CB.msgs.treeMsgSlot);
+   STP_ASSERT((slot >= 0) && (slot < MSTP_TREE_MSG_SLOTS));
+   STP_ASSERT(MSTP_TREE_MSG_SLOT_IS_DIRTY(slot));
+
+   remqhere_nodis(&MSTP_TREE_MSGS_QUEUE, &m->link);
+   MSTP_TREE_MSG_SLOT_CLR_DIRTY(slot);
+}
+
 /**PROC+*********************************************************************
  * Name:      mstp_getMstiVidMap
  *
@@ -7164,7 +7899,7 @@ mstp_getMstiUptime(MSTID_t mstid, LPORT_t lport)
 
  mstiPortPtr = MSTP_MSTI_PORT_PTR(mstid, lport);
 
- mstiPort_uptime = time(NULL) - mstiPortPtr->mstiPort_uptime;
+ mstiPort_uptime = time(NULL) - mstiPortPtr->cold->mstiPort_uptime;
  return (mstiPort_uptime);
 }
 
@@ -7191,7 +7926,7 @@ mstp_getCistUptime(LPORT_t lport)
 
  cistPortPtr = MSTP_CIST_PORT_PTR(lport);
 
- cistPort_uptime = time(NULL) - cistPortPtr->cistPort_uptime;
+ cistPort_uptime = time(NULL) - cistPortPtr->cold->cistPort_uptime;
  return (cistPort_uptime);
 }
 /**PROC+**********************************************************************
@@ -7490,17 +8225,10 @@ mstp_vidMapToVidStr(VID_MAP *srcVidMap, char *buf, uint16_t bufLen)
 static void
 mstp_updtMstiRootInfoChg(MSTID_t mstid)
 {
-   MSTP_TREE_MSG_t *m = mstp_findMstiPortStateChgMsg(mstid);
-
+   MSTP_TREE_MSG_t *m = mstp_getMstiPortStateChgMsg(mstid);
 
    if(m == NULL)
-   {
-      m = calloc(1, sizeof(MSTP_TREE_MSG_t));
-      m->mstid        = mstid;
-      m->link.q_flink = NULL;
-      m->link.q_blink = NULL;
-      insqti_nodis(&MSTP_TREE_MSGS_QUEUE, &m->link);
-   }
+      return;
 
    m->rootInfoChanged = TRUE;
 }
@@ -7522,20 +8250,17 @@ mstp_updtMstiRootInfoChg(MSTID_t mstid)
  * Globals:   none
  *
  **PROC-**********************************************************************/
-static void
+void
 mstp_updtMstiPortStateChgMsg(MSTID_t mstid, LPORT_t lport,
                              MSTP_ACT_TYPE_t state)
 {
-   MSTP_TREE_MSG_t *m = mstp_findMstiPortStateChgMsg(mstid);
+   MSTP_TREE_MSG_t *m = mstp_getMstiPortStateChgMsg(mstid);
 
    if(m == NULL)
-   {
-      m = calloc(1, sizeof(MSTP_TREE_MSG_t));
-      m->mstid        = mstid;
-      m->link.q_flink = NULL;
-      m->link.q_blink = NULL;
-      insqti_nodis(&MSTP_TREE_MSGS_QUEUE, &m->link);
-   }
+      return;
+
+   if(m->decisionTime == 0)
+      m->decisionTime = mstp_utilMonoUsec();
 
    switch(state)
    {
@@ -7910,7 +8635,8 @@ mstp_isNeighboreBridgeInMyRegion(MSTP_RX_PDU *pkt)
  *            VLANs->MSTIs mapping, which is very likely indicates the
  *            misconfiguration error).
  *            Update statistics counter if inconsistency error has been
- *            detected.
+ *            detected. The transmitting Bridge's identifier is kept for
+ *            region plans, see 'mstp_rgnPeerSave'.
  *
  * Params:    bpdu  -> pointer to the received MST BPDU
  *            lport -> logical port number MST BPDU was received on
@@ -7920,7 +8646,7 @@ mstp_isNeighboreBridgeInMyRegion(MSTP_RX_PDU *pkt)
  * Globals:   mstp_Bridge
  *
  **PROC-**********************************************************************/
-static void
+void
 mstp_mstRgnCfgConsistencyCheck(MSTP_MST_BPDU_t *bpdu, LPORT_t lport)
 {
    MSTP_CIST_PORT_INFO_t       *cistPortPtr   = NULL;
@@ -7943,6 +8669,7 @@ mstp_mstRgnCfgConsistencyCheck(MSTP_MST_BPDU_t *bpdu, LPORT_t lport)
     * get transmitting Bridge MST Config Id
     *------------------------------------------------------------------------*/
    bpdu_mstCfgId = bpdu->mstConfigurationId;
+   mstp_rgnPeerSave(lport, &bpdu_mstCfgId);
 
    /*------------------------------------------------------------------------
     * get this Bridge MST Config Id
@@ -7966,12 +8693,50 @@ mstp_mstRgnCfgConsistencyCheck(MSTP_MST_BPDU_t *bpdu, LPORT_t lport)
      (sameDigest && !(sameFormat && sameName && sameRevision)))
 #endif /* 0 */
    {/* update statistics info */
-      cistPortPtr->dbgCnts.mstCfgErrorBpduCnt++;
-      cistPortPtr->dbgCnts.mstCfgErrorBpduCntLastUpdated =
+      cistPortPtr->cold->dbgCnts.mstCfgErrorBpduCnt++;
+      cistPortPtr->cold->dbgCnts.mstCfgErrorBpduCntLastUpdated =
                                                          time(NULL);
    }
 }
 
+/**PROC+**********************************************************************
+ * Name:      mstp_rcvdMsgIsInferior
+ *
+ * Purpose:   Check if the message priority vector recorded for the tree on
+ *            the port is the same as or worse than its port priority
+ *            vector, the priority part of 'InferiorRootAlternateInfo'
+ *            (see 'mstp_rcvInfoCist' and 'mstp_rcvInfoMsti'). Used by the
+ *            receive fast path for a repeated BPDU, whose message priority
+ *            is the one already recorded.
+ *
+ * Params:    mstid -> MST instance identifier (the CIST or an MSTI)
+ *            lport -> logical port number
+ *
+ * Returns:   TRUE if the message priority is not better, FALSE otherwise
+ *
+ * Globals:   mstp_Bridge
+ **PROC-**********************************************************************/
+bool
+mstp_rcvdMsgIsInferior(MSTID_t mstid, LPORT_t lport)
+{
+   if(mstid == MSTP_CISTID)
+   {
+      MSTP_CIST_PORT_INFO_t *cistPortPtr = MSTP_CIST_PORT_PTR(lport);
+
+      STP_ASSERT(cistPortPtr);
+      return !(mstp_cistPriorityVectorsCompare(&cistPortPtr->msgPriority,
+                                               &cistPortPtr->portPriority) < 0);
+   }
+   else
+   {
+      MSTP_MSTI_PORT_INFO_t *mstiPortPtr = MSTP_MSTI_PORT_PTR(mstid, lport);
+
+      STP_ASSERT(mstiPortPtr);
+      return !(mstp_mstiPriorityVectorsCompare(&mstiPortPtr->msgPriority,
+                                               &mstiPortPtr->portPriority) < 0);
+   }
+}
+
 /**PROC+**********************************************************************
  * Name:      mstp_cistPriorityVectorsCompare
  *
@@ -8166,6 +8931,16 @@ mstp_findMstiCfgMsgInBpdu(MSTP_RX_PDU *pkt, MSTID_t mstid)
    mstiCfgMsgPtr = (MSTP_MSTI_CONFIG_MSG_t *) bpdu->mstiConfigMsgs;
    end           = (char*)mstiCfgMsgPtr + len;
 
+   /*------------------------------------------------------------------------
+    * the RX thread has already indexed the messages by MSTID
+    *------------------------------------------------------------------------*/
+   if(pkt->desc.valid)
+   {
+      uint8_t idx = pkt->desc.mstiMsgIdx[mstid];
+
+      return idx ? (mstiCfgMsgPtr + (idx - 1)) : NULL;
+   }
+
    /*------------------------------------------------------------------------
     * do search
     *------------------------------------------------------------------------*/
@@ -8361,6 +9136,10 @@ mstp_isMstBpdu(MSTP_RX_PDU *pkt)
    bool             res = FALSE;
 
    STP_ASSERT(pkt);
+
+   if(pkt->desc.valid)
+      return (pkt->desc.bpduType == MSTP_BPDU_TYPE_MSTP);
+
    bpdu   = (MSTP_MST_BPDU_t *)(pkt->data);
    length = MSTP_BPDU_LENGTH(bpdu);
 
@@ -8402,15 +9181,14 @@ mstp_isSelfSentPkt(MSTP_RX_PDU *pkt)
     bool res = FALSE;
    ENET_HDR    *enetHdr;  /* pointer to start of ethernet header */
    LPORT_t      lport;    /* logical port pkt arrived on */
-   const char *my_mac = NULL;
    MAC_ADDRESS  portSrc;  /* port's own source MAC address */
    MAC_ADDRESS *src_mac = NULL;
 
    STP_ASSERT(pkt);
+
    lport = GET_PKT_LOGICAL_PORT(pkt);
    /* Get the logical port's source MAC address */
-   my_mac = intf_get_mac_addr(lport);
-   sscanf(my_mac,"%02hhx:%02hhx:%02hhx:%02hhx:%02hhx:%02hhx",&portSrc[0],&portSrc[1],&portSrc[2],&portSrc[3],&portSrc[4],&portSrc[5]);
+   intf_get_lport_mac(lport, portSrc);
    src_mac = (MAC_ADDRESS *)pkt->data + ENET_ADDR_SIZE;
    res = MAC_ADDRS_EQUAL(src_mac,portSrc);
 
@@ -8454,6 +9232,9 @@ mstp_getBpduType(MSTP_RX_PDU *pkt)
 
    STP_ASSERT(pkt);
 
+   if(pkt->desc.valid)
+      return pkt->desc.bpduType;
+
    if(mstp_isMstBpdu(pkt))
       bpduType = MSTP_BPDU_TYPE_MSTP;
    else if(mstp_isRstBpdu(pkt))
@@ -8468,6 +9249,56 @@ mstp_getBpduType(MSTP_RX_PDU *pkt)
    return bpduType;
 }
 
+/**PROC+**********************************************************************
+ * Name:      mstp_rxPduClassify
+ *
+ * Purpose:   Parse a received BPDU once, on the RX thread, and record the
+ *            results in the PDU's descriptor: validity and type, and the
+ *            position of each MSTI Configuration Message by MSTID. The
+ *            protocol thread then answers 'mstp_validateBpdu',
+ *            'mstp_getBpduType' and 'mstp_findMstiCfgMsgInBpdu' from the
+ *            descriptor.
+ *            NOTE: only the packet is looked at here, checks against the
+ *                  Bridge's or the port's state (e.g. the MST Region, the
+ *                  port's own MAC address for 'mstp_isSelfSentPkt') stay on
+ *                  the protocol thread.
+ *
+ * Params:    pkt -> pointer to the packet buffer with BPDU in
+ *
+ * Returns:   none
+ *
+ * Globals:   none
+ *
+ * Constraints:
+ **PROC-**********************************************************************/
+void
+mstp_rxPduClassify(MSTP_RX_PDU *pkt)
+{
+   MSTP_RX_PDU_DESC       *desc = &pkt->desc;
+   MSTP_MSTI_CONFIG_MSG_t *mstiCfgMsgPtr = NULL;
+   MSTID_t                 mstid;
+
+   STP_ASSERT(pkt);
+
+   memset(desc, 0, sizeof(*desc));
+   desc->bpduType = mstp_getBpduType(pkt);
+
+   if(desc->bpduType == MSTP_BPDU_TYPE_MSTP)
+   {
+      while((mstiCfgMsgPtr = mstp_findNextMstiCfgMsgInBpdu(pkt, mstiCfgMsgPtr)))
+      {
+         desc->mstiMsgCnt++;
+         mstid = MSTP_GET_BRIDGE_SYS_ID_FROM_PKT(mstiCfgMsgPtr->mstiRgnRootId);
+         /* keep the first message if an MSTID is repeated, as the linear
+          * search did */
+         if(MSTP_VALID_MSTID(mstid) && (desc->mstiMsgIdx[mstid] == 0))
+            desc->mstiMsgIdx[mstid] = desc->mstiMsgCnt;
+      }
+   }
+
+   desc->valid = TRUE;
+}
+
 /*===========================================================================
  * Miscellaneous functions used to provide detail information about MSTP
  * ports dynamic variables (these functions currently called from 'browse.cc'
@@ -8676,14 +9507,14 @@ mstp_clrMstiPortDbgCntInfo(MSTID_t mstid, LPORT_t lport)
       MSTP_CIST_PORT_INFO_t *cistPortPtr = MSTP_CIST_PORT_PTR(lport);
 
       if(cistPortPtr)
-         memset(&cistPortPtr->dbgCnts, 0, sizeof(cistPortPtr->dbgCnts));
+         memset(&cistPortPtr->cold->dbgCnts, 0, sizeof(cistPortPtr->cold->dbgCnts));
    }
    else
    {
       MSTP_MSTI_PORT_INFO_t *mstiPortPtr = MSTP_MSTI_PORT_PTR(mstid, lport);
 
       if(mstiPortPtr)
-         memset(&mstiPortPtr->dbgCnts, 0, sizeof(mstiPortPtr->dbgCnts));
+         memset(&mstiPortPtr->cold->dbgCnts, 0, sizeof(mstiPortPtr->cold->dbgCnts));
    }
 
 }
@@ -8802,104 +9633,104 @@ mstp_getMstiPortDbgCntInfo(MSTID_t mstid, LPORT_t lport,
          switch(cntId)
          {
             case MSTP_CIST_DBG_CNT_INVALID_BPDUS:
-               value = cistPortPtr->dbgCnts.invalidBpduCnt;
+               value = cistPortPtr->cold->dbgCnts.invalidBpduCnt;
                if(timeStamp)
-                  *timeStamp = cistPortPtr->dbgCnts.invalidBpduCntLastUpdated;
+                  *timeStamp = cistPortPtr->cold->dbgCnts.invalidBpduCntLastUpdated;
                break;
             case MSTP_CIST_DBG_CNT_ERRANT_BPDUS:
-               value = cistPortPtr->dbgCnts.errantBpduCnt;
+               value = cistPortPtr->cold->dbgCnts.errantBpduCnt;
                if(timeStamp)
-                  *timeStamp = cistPortPtr->dbgCnts.errantBpduCntLastUpdated;
+                  *timeStamp = cistPortPtr->cold->dbgCnts.errantBpduCntLastUpdated;
                break;
             case MSTP_CIST_DBG_CNT_MST_CFG_ERROR_BPDUS:
-               value = cistPortPtr->dbgCnts.mstCfgErrorBpduCnt;
+               value = cistPortPtr->cold->dbgCnts.mstCfgErrorBpduCnt;
                if(timeStamp)
-                  *timeStamp = cistPortPtr->dbgCnts.mstCfgErrorBpduCntLastUpdated;
+                  *timeStamp = cistPortPtr->cold->dbgCnts.mstCfgErrorBpduCntLastUpdated;
                break;
             case MSTP_CIST_DBG_CNT_LOOPED_BACK_BPDUS:
-               value = cistPortPtr->dbgCnts.loopBackBpduCnt;
+               value = cistPortPtr->cold->dbgCnts.loopBackBpduCnt;
                if(timeStamp)
-                  *timeStamp = cistPortPtr->dbgCnts.loopBackBpduCntLastUpdated;
+                  *timeStamp = cistPortPtr->cold->dbgCnts.loopBackBpduCntLastUpdated;
                break;
             case MSTP_CIST_DBG_CNT_STARVED_BPDUS:
-               value = cistPortPtr->dbgCnts.starvedBpduCnt;
+               value = cistPortPtr->cold->dbgCnts.starvedBpduCnt;
                if(timeStamp)
-                  *timeStamp = cistPortPtr->dbgCnts.starvedBpduCntLastUpdated;
+                  *timeStamp = cistPortPtr->cold->dbgCnts.starvedBpduCntLastUpdated;
                break;
             case MSTP_CIST_DBG_CNT_EXCEEDED_MAX_AGE_BPDUS:
-               value = cistPortPtr->dbgCnts.agedBpduCnt;
+               value = cistPortPtr->cold->dbgCnts.agedBpduCnt;
                if(timeStamp)
-                  *timeStamp = cistPortPtr->dbgCnts.agedBpduCntLastUpdated;
+                  *timeStamp = cistPortPtr->cold->dbgCnts.agedBpduCntLastUpdated;
                break;
             case MSTP_CIST_DBG_CNT_EXCEEDED_MAX_HOPS_BPDUS:
-               value = cistPortPtr->dbgCnts.exceededHopsBpduCnt;
+               value = cistPortPtr->cold->dbgCnts.exceededHopsBpduCnt;
                if(timeStamp)
-                  *timeStamp = cistPortPtr->dbgCnts.exceededHopsBpduCntLastUpdated;
+                  *timeStamp = cistPortPtr->cold->dbgCnts.exceededHopsBpduCntLastUpdated;
                break;
             case MSTP_CIST_DBG_CNT_TC_DETECTED:
-               value = cistPortPtr->dbgCnts.tcDetectCnt;
+               value = cistPortPtr->cold->dbgCnts.tcDetectCnt;
                if(timeStamp)
-                  *timeStamp = cistPortPtr->dbgCnts.tcDetectCntLastUpdated;
+                  *timeStamp = cistPortPtr->cold->dbgCnts.tcDetectCntLastUpdated;
                break;
             case MSTP_CIST_DBG_CNT_TC_FLAGS_TX:
-               value = cistPortPtr->dbgCnts.tcFlagTxCnt;
+               value = cistPortPtr->cold->dbgCnts.tcFlagTxCnt;
                if(timeStamp)
-                  *timeStamp = cistPortPtr->dbgCnts.tcFlagTxCntLastUpdated;
+                  *timeStamp = cistPortPtr->cold->dbgCnts.tcFlagTxCntLastUpdated;
                break;
             case MSTP_CIST_DBG_CNT_TC_FLAGS_RX:
-               value = cistPortPtr->dbgCnts.tcFlagRxCnt;
+               value = cistPortPtr->cold->dbgCnts.tcFlagRxCnt;
                if(timeStamp)
-                  *timeStamp = cistPortPtr->dbgCnts.tcFlagRxCntLastUpdated;
+                  *timeStamp = cistPortPtr->cold->dbgCnts.tcFlagRxCntLastUpdated;
                break;
             case MSTP_CIST_DBG_CNT_TC_ACK_FLAGS_TX:
-               value = cistPortPtr->dbgCnts.tcAckFlagTxCnt;
+               value = cistPortPtr->cold->dbgCnts.tcAckFlagTxCnt;
                if(timeStamp)
-                  *timeStamp = cistPortPtr->dbgCnts.tcAckFlagTxCntLastUpdated;
+                  *timeStamp = cistPortPtr->cold->dbgCnts.tcAckFlagTxCntLastUpdated;
                break;
             case MSTP_CIST_DBG_CNT_TC_ACK_FLAGS_RX:
-               value = cistPortPtr->dbgCnts.tcAckFlagRxCnt;
+               value = cistPortPtr->cold->dbgCnts.tcAckFlagRxCnt;
                if(timeStamp)
-                  *timeStamp = cistPortPtr->dbgCnts.tcAckFlagRxCntLastUpdated;
+                  *timeStamp = cistPortPtr->cold->dbgCnts.tcAckFlagRxCntLastUpdated;
                break;
             case MSTP_CIST_DBG_CNT_MST_BPDUS_TX:
-               value = cistPortPtr->dbgCnts.mstBpduTxCnt;
+               value = cistPortPtr->cold->dbgCnts.mstBpduTxCnt;
                if(timeStamp)
-                  *timeStamp = cistPortPtr->dbgCnts.mstBpduTxCntLastUpdated;
+                  *timeStamp = cistPortPtr->cold->dbgCnts.mstBpduTxCntLastUpdated;
                break;
             case MSTP_CIST_DBG_CNT_MST_BPDUS_RX:
-               value = cistPortPtr->dbgCnts.mstBpduRxCnt;
+               value = cistPortPtr->cold->dbgCnts.mstBpduRxCnt;
                if(timeStamp)
-                  *timeStamp = cistPortPtr->dbgCnts.mstBpduRxCntLastUpdated;
+                  *timeStamp = cistPortPtr->cold->dbgCnts.mstBpduRxCntLastUpdated;
                break;
             case MSTP_CIST_DBG_CNT_RST_BPDUS_TX:
-               value = cistPortPtr->dbgCnts.rstBpduTxCnt;
+               value = cistPortPtr->cold->dbgCnts.rstBpduTxCnt;
                if(timeStamp)
-                  *timeStamp = cistPortPtr->dbgCnts.rstBpduTxCntLastUpdated;
+                  *timeStamp = cistPortPtr->cold->dbgCnts.rstBpduTxCntLastUpdated;
                break;
             case MSTP_CIST_DBG_CNT_RST_BPDUS_RX:
-               value = cistPortPtr->dbgCnts.rstBpduRxCnt;
+               value = cistPortPtr->cold->dbgCnts.rstBpduRxCnt;
                if(timeStamp)
-                  *timeStamp = cistPortPtr->dbgCnts.rstBpduRxCntLastUpdated;
+                  *timeStamp = cistPortPtr->cold->dbgCnts.rstBpduRxCntLastUpdated;
                break;
             case MSTP_CIST_DBG_CNT_CFG_BPDUS_TX:
-               value = cistPortPtr->dbgCnts.cfgBpduTxCnt;
+               value = cistPortPtr->cold->dbgCnts.cfgBpduTxCnt;
                if(timeStamp)
-                  *timeStamp = cistPortPtr->dbgCnts.cfgBpduTxCntLastUpdated;
+                  *timeStamp = cistPortPtr->cold->dbgCnts.cfgBpduTxCntLastUpdated;
                break;
             case MSTP_CIST_DBG_CNT_CFG_BPDUS_RX:
-               value = cistPortPtr->dbgCnts.cfgBpduRxCnt;
+               value = cistPortPtr->cold->dbgCnts.cfgBpduRxCnt;
                if(timeStamp)
-                  *timeStamp = cistPortPtr->dbgCnts.cfgBpduRxCntLastUpdated;
+                  *timeStamp = cistPortPtr->cold->dbgCnts.cfgBpduRxCntLastUpdated;
                break;
             case MSTP_CIST_DBG_CNT_TCN_BPDUS_TX:
-               value = cistPortPtr->dbgCnts.tcnBpduTxCnt;
+               value = cistPortPtr->cold->dbgCnts.tcnBpduTxCnt;
                if(timeStamp)
-                  *timeStamp = cistPortPtr->dbgCnts.tcnBpduTxCntLastUpdated;
+                  *timeStamp = cistPortPtr->cold->dbgCnts.tcnBpduTxCntLastUpdated;
                break;
             case MSTP_CIST_DBG_CNT_TCN_BPDUS_RX:
-               value = cistPortPtr->dbgCnts.tcnBpduRxCnt;
+               value = cistPortPtr->cold->dbgCnts.tcnBpduRxCnt;
                if(timeStamp)
-                  *timeStamp = cistPortPtr->dbgCnts.tcnBpduRxCntLastUpdated;
+                  *timeStamp = cistPortPtr->cold->dbgCnts.tcnBpduRxCntLastUpdated;
                break;
             default:
                STP_ASSERT(0);
@@ -8916,42 +9747,42 @@ mstp_getMstiPortDbgCntInfo(MSTID_t mstid, LPORT_t lport,
          switch(cntId)
          {
             case MSTP_MSTI_DBG_CNT_STARVED_MSTI_MSGS:
-               value = mstiPortPtr->dbgCnts.starvedMsgCnt;
+               value = mstiPortPtr->cold->dbgCnts.starvedMsgCnt;
                if(timeStamp)
-                  *timeStamp = mstiPortPtr->dbgCnts.starvedMsgCntLastUpdated;
+                  *timeStamp = mstiPortPtr->cold->dbgCnts.starvedMsgCntLastUpdated;
                break;
             case MSTP_MSTI_DBG_CNT_EXCEEDED_MAX_HOPS_MSTI_MSGS:
-               value = mstiPortPtr->dbgCnts.exceededHopsMsgCnt;
+               value = mstiPortPtr->cold->dbgCnts.exceededHopsMsgCnt;
                if(timeStamp)
                {
                   *timeStamp =
-                     mstiPortPtr->dbgCnts.exceededHopsMsgCntLastUpdated;
+                     mstiPortPtr->cold->dbgCnts.exceededHopsMsgCntLastUpdated;
                }
                break;
             case MSTP_MSTI_DBG_CNT_TC_DETECTED:
-               value = mstiPortPtr->dbgCnts.tcDetectCnt;
+               value = mstiPortPtr->cold->dbgCnts.tcDetectCnt;
                if(timeStamp)
-                  *timeStamp = mstiPortPtr->dbgCnts.tcDetectCntLastUpdated;
+                  *timeStamp = mstiPortPtr->cold->dbgCnts.tcDetectCntLastUpdated;
                break;
             case MSTP_MSTI_DBG_CNT_TC_FLAGS_TX:
-               value = mstiPortPtr->dbgCnts.tcFlagTxCnt;
+               value = mstiPortPtr->cold->dbgCnts.tcFlagTxCnt;
                if(timeStamp)
-                  *timeStamp = mstiPortPtr->dbgCnts.tcFlagTxCntLastUpdated;
+                  *timeStamp = mstiPortPtr->cold->dbgCnts.tcFlagTxCntLastUpdated;
                break;
             case MSTP_MSTI_DBG_CNT_TC_FLAGS_RX:
-               value = mstiPortPtr->dbgCnts.tcFlagRxCnt;
+               value = mstiPortPtr->cold->dbgCnts.tcFlagRxCnt;
                if(timeStamp)
-                  *timeStamp = mstiPortPtr->dbgCnts.tcFlagRxCntLastUpdated;
+                  *timeStamp = mstiPortPtr->cold->dbgCnts.tcFlagRxCntLastUpdated;
                break;
             case MSTP_MSTI_DBG_CNT_MSTI_MSGS_TX:
-               value = mstiPortPtr->dbgCnts.mstiMsgTxCnt;
+               value = mstiPortPtr->cold->dbgCnts.mstiMsgTxCnt;
                if(timeStamp)
-                  *timeStamp = mstiPortPtr->dbgCnts.mstiMsgTxCntLastUpdated;
+                  *timeStamp = mstiPortPtr->cold->dbgCnts.mstiMsgTxCntLastUpdated;
                break;
             case MSTP_MSTI_DBG_CNT_MSTI_MSGS_RX:
-               value = mstiPortPtr->dbgCnts.mstiMsgRxCnt;
+               value = mstiPortPtr->cold->dbgCnts.mstiMsgRxCnt;
                if(timeStamp)
-                  *timeStamp = mstiPortPtr->dbgCnts.mstiMsgRxCntLastUpdated;
+                  *timeStamp = mstiPortPtr->cold->dbgCnts.mstiMsgRxCntLastUpdated;
                break;
             default:
                STP_ASSERT(0);
@@ -9432,7 +10263,7 @@ mstp_portMstBpduTxCnt(LPORT_t lport)
 
 
    if(MSTP_CIST_PORT_PTR(lport))
-      cnt = MSTP_CIST_PORT_PTR(lport)->dbgCnts.mstBpduTxCnt;
+      cnt = MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.mstBpduTxCnt;
 
 
    return cnt;
@@ -9460,7 +10291,7 @@ mstp_portMstBpduRxCnt(LPORT_t lport)
 
 
    if(MSTP_CIST_PORT_PTR(lport))
-      cnt = MSTP_CIST_PORT_PTR(lport)->dbgCnts.mstBpduRxCnt;
+      cnt = MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.mstBpduRxCnt;
 
 
    return cnt;
@@ -9488,7 +10319,7 @@ mstp_portCfgBpduTxCnt(LPORT_t lport)
 
 
    if(MSTP_CIST_PORT_PTR(lport))
-      cnt = MSTP_CIST_PORT_PTR(lport)->dbgCnts.cfgBpduTxCnt;
+      cnt = MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.cfgBpduTxCnt;
 
 
    return cnt;
@@ -9515,7 +10346,7 @@ mstp_portCfgBpduRxCnt(LPORT_t lport)
    STP_ASSERT(IS_VALID_LPORT(lport));
 
    if(MSTP_CIST_PORT_PTR(lport))
-      cnt = MSTP_CIST_PORT_PTR(lport)->dbgCnts.cfgBpduRxCnt;
+      cnt = MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.cfgBpduRxCnt;
 
 
    return cnt;
@@ -9543,7 +10374,7 @@ mstp_portTcnBpduTxCnt(LPORT_t lport)
 
 
    if(MSTP_CIST_PORT_PTR(lport))
-      cnt = MSTP_CIST_PORT_PTR(lport)->dbgCnts.tcnBpduTxCnt;
+      cnt = MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.tcnBpduTxCnt;
 
 
    return cnt;
@@ -9571,7 +10402,7 @@ mstp_portTcnBpduRxCnt(LPORT_t lport)
 
 
    if(MSTP_CIST_PORT_PTR(lport))
-      cnt = MSTP_CIST_PORT_PTR(lport)->dbgCnts.tcnBpduRxCnt;
+      cnt = MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.tcnBpduRxCnt;
 
 
    return cnt;
@@ -9601,7 +10432,7 @@ mstp_portTcAckFlagTxCnt(LPORT_t lport)
 
 
    if(MSTP_CIST_PORT_PTR(lport))
-      cnt = MSTP_CIST_PORT_PTR(lport)->dbgCnts.tcAckFlagTxCnt;
+      cnt = MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.tcAckFlagTxCnt;
 
 
    return cnt;
@@ -9631,7 +10462,7 @@ mstp_portTcAckFlagRxCnt(LPORT_t lport)
 
 
    if(MSTP_CIST_PORT_PTR(lport))
-      cnt = MSTP_CIST_PORT_PTR(lport)->dbgCnts.tcAckFlagRxCnt;
+      cnt = MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.tcAckFlagRxCnt;
 
 
    return cnt;
@@ -9662,7 +10493,7 @@ mstp_portLoopBackBpduCnt(LPORT_t lport)
 
 
    if(MSTP_CIST_PORT_PTR(lport))
-      cnt = MSTP_CIST_PORT_PTR(lport)->dbgCnts.loopBackBpduCnt;
+      cnt = MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.loopBackBpduCnt;
 
 
    return cnt;
@@ -9692,7 +10523,7 @@ mstp_portAgedBpduCnt(LPORT_t lport)
    STP_ASSERT(IS_VALID_LPORT(lport));
 
    if(MSTP_CIST_PORT_PTR(lport))
-      cnt = MSTP_CIST_PORT_PTR(lport)->dbgCnts.agedBpduCnt;
+      cnt = MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.agedBpduCnt;
 
    return cnt;
 }
@@ -9926,12 +10757,12 @@ mstp_mstiPortTcDetectCnt(MSTID_t mstid, LPORT_t lport)
       if(mstid == MSTP_CISTID)
       {
          if(MSTP_CIST_PORT_PTR(lport))
-            cnt = MSTP_CIST_PORT_PTR(lport)->dbgCnts.tcDetectCnt;
+            cnt = MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.tcDetectCnt;
       }
       else
       {
          if(MSTP_MSTI_PORT_PTR(mstid, lport))
-            cnt = MSTP_MSTI_PORT_PTR(mstid, lport)->dbgCnts.tcDetectCnt;
+            cnt = MSTP_MSTI_PORT_PTR(mstid, lport)->cold->dbgCnts.tcDetectCnt;
       }
    }
 
@@ -9968,12 +10799,12 @@ mstp_mstiPortTcFlagTxCnt(MSTID_t mstid, LPORT_t lport)
       if(mstid == MSTP_CISTID)
       {
          if(MSTP_CIST_PORT_PTR(lport))
-            cnt = MSTP_CIST_PORT_PTR(lport)->dbgCnts.tcFlagTxCnt;
+            cnt = MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.tcFlagTxCnt;
       }
       else
       {
          if(MSTP_MSTI_PORT_PTR(mstid, lport))
-            cnt = MSTP_MSTI_PORT_PTR(mstid, lport)->dbgCnts.tcFlagTxCnt;
+            cnt = MSTP_MSTI_PORT_PTR(mstid, lport)->cold->dbgCnts.tcFlagTxCnt;
       }
    }
 
@@ -10009,12 +10840,12 @@ mstp_mstiPortTcFlagRxCnt(MSTID_t mstid, LPORT_t lport)
       if(mstid == MSTP_CISTID)
       {
          if(MSTP_CIST_PORT_PTR(lport))
-            cnt = MSTP_CIST_PORT_PTR(lport)->dbgCnts.tcFlagRxCnt;
+            cnt = MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.tcFlagRxCnt;
       }
       else
       {
          if(MSTP_MSTI_PORT_PTR(mstid, lport))
-            cnt = MSTP_MSTI_PORT_PTR(mstid, lport)->dbgCnts.tcFlagRxCnt;
+            cnt = MSTP_MSTI_PORT_PTR(mstid, lport)->cold->dbgCnts.tcFlagRxCnt;
       }
    }
 
@@ -10051,12 +10882,12 @@ mstp_mstiPortExceededHopsBpduCnt(MSTID_t mstid, LPORT_t lport)
       if(mstid == MSTP_CISTID)
       {
          if(MSTP_CIST_PORT_PTR(lport))
-            cnt = MSTP_CIST_PORT_PTR(lport)->dbgCnts.exceededHopsBpduCnt;
+            cnt = MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.exceededHopsBpduCnt;
       }
       else
       {
          if(MSTP_MSTI_PORT_PTR(mstid, lport))
-            cnt = MSTP_MSTI_PORT_PTR(mstid, lport)->dbgCnts.exceededHopsMsgCnt;
+            cnt = MSTP_MSTI_PORT_PTR(mstid, lport)->cold->dbgCnts.exceededHopsMsgCnt;
       }
    }
 
@@ -10208,7 +11039,7 @@ mstp_errantBpduCounter_get(LPORT_t lport)
 
 
    if(MSTP_CIST_PORT_PTR(lport))
-      result = MSTP_CIST_PORT_PTR(lport)->dbgCnts.errantBpduCnt;
+      result = MSTP_CIST_PORT_PTR(lport)->cold->dbgCnts.errantBpduCnt;
 
 
    return (result);
@@ -10326,88 +11157,88 @@ mstp_getMstiPortDbgAllCntInfo(uint16_t mstid, LPORT_t lport,
 
    if((cistPortPtr = MSTP_CIST_PORT_PTR(lport)))
    {
-       mCnt->invalidBpduCnt = cistPortPtr->dbgCnts.invalidBpduCnt;
+       mCnt->invalidBpduCnt = cistPortPtr->cold->dbgCnts.invalidBpduCnt;
        mCnt->invalidBpduCntLastUpdated =
-          cistPortPtr->dbgCnts.invalidBpduCntLastUpdated;
-       mCnt->errantBpduCnt = cistPortPtr->dbgCnts.errantBpduCnt;
+          cistPortPtr->cold->dbgCnts.invalidBpduCntLastUpdated;
+       mCnt->errantBpduCnt = cistPortPtr->cold->dbgCnts.errantBpduCnt;
        mCnt->errantBpduCntLastUpdated =
-          cistPortPtr->dbgCnts.errantBpduCntLastUpdated;
-       mCnt->mstCfgErrorBpduCnt = cistPortPtr->dbgCnts.mstCfgErrorBpduCnt;
+          cistPortPtr->cold->dbgCnts.errantBpduCntLastUpdated;
+       mCnt->mstCfgErrorBpduCnt = cistPortPtr->cold->dbgCnts.mstCfgErrorBpduCnt;
        mCnt->mstCfgErrorBpduCntLastUpdated =
-          cistPortPtr->dbgCnts.mstCfgErrorBpduCntLastUpdated;
-       mCnt->loopBackBpduCnt = cistPortPtr->dbgCnts.loopBackBpduCnt;
+          cistPortPtr->cold->dbgCnts.mstCfgErrorBpduCntLastUpdated;
+       mCnt->loopBackBpduCnt = cistPortPtr->cold->dbgCnts.loopBackBpduCnt;
        mCnt->loopBackBpduCntLastUpdated =
-           cistPortPtr->dbgCnts.loopBackBpduCntLastUpdated;
-       mCnt->starvedBpduCnt = cistPortPtr->dbgCnts.starvedBpduCnt;
+           cistPortPtr->cold->dbgCnts.loopBackBpduCntLastUpdated;
+       mCnt->starvedBpduCnt = cistPortPtr->cold->dbgCnts.starvedBpduCnt;
        mCnt->starvedBpduCntLastUpdated =
-          cistPortPtr->dbgCnts.starvedBpduCntLastUpdated;
-       mCnt->agedBpduCnt = cistPortPtr->dbgCnts.agedBpduCnt;
+          cistPortPtr->cold->dbgCnts.starvedBpduCntLastUpdated;
+       mCnt->agedBpduCnt = cistPortPtr->cold->dbgCnts.agedBpduCnt;
        mCnt->agedBpduCntLastUpdated =
-          cistPortPtr->dbgCnts.agedBpduCntLastUpdated;
-       mCnt->exceededHopsBpduCnt = cistPortPtr->dbgCnts.exceededHopsBpduCnt;
+          cistPortPtr->cold->dbgCnts.agedBpduCntLastUpdated;
+       mCnt->exceededHopsBpduCnt = cistPortPtr->cold->dbgCnts.exceededHopsBpduCnt;
        mCnt->exceededHopsBpduCntLastUpdated =
-          cistPortPtr->dbgCnts.exceededHopsBpduCntLastUpdated;
-       mCnt->tcDetectCnt = cistPortPtr->dbgCnts.tcDetectCnt;
+          cistPortPtr->cold->dbgCnts.exceededHopsBpduCntLastUpdated;
+       mCnt->tcDetectCnt = cistPortPtr->cold->dbgCnts.tcDetectCnt;
        mCnt->tcDetectCntLastUpdated =
-          cistPortPtr->dbgCnts.tcDetectCntLastUpdated;
-       mCnt->tcFlagTxCnt = cistPortPtr->dbgCnts.tcFlagTxCnt;
+          cistPortPtr->cold->dbgCnts.tcDetectCntLastUpdated;
+       mCnt->tcFlagTxCnt = cistPortPtr->cold->dbgCnts.tcFlagTxCnt;
        mCnt->tcFlagTxCntLastUpdated =
-          cistPortPtr->dbgCnts.tcFlagTxCntLastUpdated;
-       mCnt->tcFlagRxCnt = cistPortPtr->dbgCnts.tcFlagRxCnt;
-       mCnt->tcFlagRxCntLastUpdated = cistPortPtr->dbgCnts.tcFlagRxCntLastUpdated;
-       mCnt->tcAckFlagTxCnt = cistPortPtr->dbgCnts.tcAckFlagTxCnt;
+          cistPortPtr->cold->dbgCnts.tcFlagTxCntLastUpdated;
+       mCnt->tcFlagRxCnt = cistPortPtr->cold->dbgCnts.tcFlagRxCnt;
+       mCnt->tcFlagRxCntLastUpdated = cistPortPtr->cold->dbgCnts.tcFlagRxCntLastUpdated;
+       mCnt->tcAckFlagTxCnt = cistPortPtr->cold->dbgCnts.tcAckFlagTxCnt;
        mCnt->tcAckFlagTxCntLastUpdated =
-          cistPortPtr->dbgCnts.tcAckFlagTxCntLastUpdated;
-       mCnt->tcAckFlagRxCnt = cistPortPtr->dbgCnts.tcAckFlagRxCnt;
+          cistPortPtr->cold->dbgCnts.tcAckFlagTxCntLastUpdated;
+       mCnt->tcAckFlagRxCnt = cistPortPtr->cold->dbgCnts.tcAckFlagRxCnt;
        mCnt->tcAckFlagRxCntLastUpdated =
-          cistPortPtr->dbgCnts.tcAckFlagRxCntLastUpdated;
-       mCnt->mstBpduTxCnt = cistPortPtr->dbgCnts.mstBpduTxCnt;
+          cistPortPtr->cold->dbgCnts.tcAckFlagRxCntLastUpdated;
+       mCnt->mstBpduTxCnt = cistPortPtr->cold->dbgCnts.mstBpduTxCnt;
        mCnt->mstBpduTxCntLastUpdated =
-          cistPortPtr->dbgCnts.mstBpduTxCntLastUpdated;
-       mCnt->mstBpduRxCnt = cistPortPtr->dbgCnts.mstBpduRxCnt;
+          cistPortPtr->cold->dbgCnts.mstBpduTxCntLastUpdated;
+       mCnt->mstBpduRxCnt = cistPortPtr->cold->dbgCnts.mstBpduRxCnt;
        mCnt->mstBpduRxCntLastUpdated =
-          cistPortPtr->dbgCnts.mstBpduRxCntLastUpdated;
-       mCnt->rstBpduTxCnt = cistPortPtr->dbgCnts.rstBpduTxCnt;
+          cistPortPtr->cold->dbgCnts.mstBpduRxCntLastUpdated;
+       mCnt->rstBpduTxCnt = cistPortPtr->cold->dbgCnts.rstBpduTxCnt;
        mCnt->rstBpduTxCntLastUpdated =
-         cistPortPtr->dbgCnts.rstBpduTxCntLastUpdated;
-       mCnt->rstBpduRxCnt = cistPortPtr->dbgCnts.rstBpduRxCnt;
+         cistPortPtr->cold->dbgCnts.rstBpduTxCntLastUpdated;
+       mCnt->rstBpduRxCnt = cistPortPtr->cold->dbgCnts.rstBpduRxCnt;
        mCnt->rstBpduRxCntLastUpdated =
-          cistPortPtr->dbgCnts.rstBpduRxCntLastUpdated;
-       mCnt->cfgBpduTxCnt = cistPortPtr->dbgCnts.cfgBpduTxCnt;
+          cistPortPtr->cold->dbgCnts.rstBpduRxCntLastUpdated;
+       mCnt->cfgBpduTxCnt = cistPortPtr->cold->dbgCnts.cfgBpduTxCnt;
        mCnt->cfgBpduTxCntLastUpdated =
-          cistPortPtr->dbgCnts.cfgBpduTxCntLastUpdated;
-       mCnt->cfgBpduRxCnt = cistPortPtr->dbgCnts.cfgBpduRxCnt;
+          cistPortPtr->cold->dbgCnts.cfgBpduTxCntLastUpdated;
+       mCnt->cfgBpduRxCnt = cistPortPtr->cold->dbgCnts.cfgBpduRxCnt;
        mCnt->cfgBpduRxCntLastUpdated =
-          cistPortPtr->dbgCnts.cfgBpduRxCntLastUpdated;
-       mCnt->tcnBpduTxCnt = cistPortPtr->dbgCnts.tcnBpduTxCnt;
+          cistPortPtr->cold->dbgCnts.cfgBpduRxCntLastUpdated;
+       mCnt->tcnBpduTxCnt = cistPortPtr->cold->dbgCnts.tcnBpduTxCnt;
        mCnt->tcnBpduTxCntLastUpdated =
-         cistPortPtr->dbgCnts.tcnBpduTxCntLastUpdated;
-       mCnt->tcnBpduRxCnt = cistPortPtr->dbgCnts.tcnBpduRxCnt;
+         cistPortPtr->cold->dbgCnts.tcnBpduTxCntLastUpdated;
+       mCnt->tcnBpduRxCnt = cistPortPtr->cold->dbgCnts.tcnBpduRxCnt;
        mCnt->tcnBpduRxCntLastUpdated =
-         cistPortPtr->dbgCnts.tcnBpduRxCntLastUpdated;
+         cistPortPtr->cold->dbgCnts.tcnBpduRxCntLastUpdated;
    }
 
    if((mstid != MSTP_CISTID) &&
                             (mstiPortPtr = MSTP_MSTI_PORT_PTR(mstid, lport)))
    {
-      mInstCnt->starvedMsgCnt = mstiPortPtr->dbgCnts.starvedMsgCnt;
+      mInstCnt->starvedMsgCnt = mstiPortPtr->cold->dbgCnts.starvedMsgCnt;
       mInstCnt->starvedMsgCntLastUpdated =
-            mstiPortPtr->dbgCnts.starvedMsgCntLastUpdated;
-      mInstCnt->exceededHopsMsgCnt = mstiPortPtr->dbgCnts.exceededHopsMsgCnt;
+            mstiPortPtr->cold->dbgCnts.starvedMsgCntLastUpdated;
+      mInstCnt->exceededHopsMsgCnt = mstiPortPtr->cold->dbgCnts.exceededHopsMsgCnt;
       mInstCnt->exceededHopsMsgCntLastUpdated =
-                      mstiPortPtr->dbgCnts.exceededHopsMsgCntLastUpdated;
-      mInstCnt->tcDetectCnt = mstiPortPtr->dbgCnts.tcDetectCnt;
-      mInstCnt->tcDetectCntLastUpdated = mstiPortPtr->dbgCnts.tcDetectCntLastUpdated;
-      mInstCnt->tcFlagTxCnt = mstiPortPtr->dbgCnts.tcFlagTxCnt;
-      mInstCnt->tcFlagTxCntLastUpdated = mstiPortPtr->dbgCnts.tcFlagTxCntLastUpdated;
-      mInstCnt->tcFlagRxCnt = mstiPortPtr->dbgCnts.tcFlagRxCnt;
-      mInstCnt->tcFlagRxCntLastUpdated = mstiPortPtr->dbgCnts.tcFlagRxCntLastUpdated;
-      mInstCnt->mstiMsgTxCnt = mstiPortPtr->dbgCnts.mstiMsgTxCnt;
+                      mstiPortPtr->cold->dbgCnts.exceededHopsMsgCntLastUpdated;
+      mInstCnt->tcDetectCnt = mstiPortPtr->cold->dbgCnts.tcDetectCnt;
+      mInstCnt->tcDetectCntLastUpdated = mstiPortPtr->cold->dbgCnts.tcDetectCntLastUpdated;
+      mInstCnt->tcFlagTxCnt = mstiPortPtr->cold->dbgCnts.tcFlagTxCnt;
+      mInstCnt->tcFlagTxCntLastUpdated = mstiPortPtr->cold->dbgCnts.tcFlagTxCntLastUpdated;
+      mInstCnt->tcFlagRxCnt = mstiPortPtr->cold->dbgCnts.tcFlagRxCnt;
+      mInstCnt->tcFlagRxCntLastUpdated = mstiPortPtr->cold->dbgCnts.tcFlagRxCntLastUpdated;
+      mInstCnt->mstiMsgTxCnt = mstiPortPtr->cold->dbgCnts.mstiMsgTxCnt;
       mInstCnt->mstiMsgTxCntLastUpdated =
-            mstiPortPtr->dbgCnts.mstiMsgTxCntLastUpdated;
-      mInstCnt->mstiMsgRxCnt = mstiPortPtr->dbgCnts.mstiMsgRxCnt;
+            mstiPortPtr->cold->dbgCnts.mstiMsgTxCntLastUpdated;
+      mInstCnt->mstiMsgRxCnt = mstiPortPtr->cold->dbgCnts.mstiMsgRxCnt;
       mInstCnt->mstiMsgRxCntLastUpdated =
-            mstiPortPtr->dbgCnts.mstiMsgRxCntLastUpdated;
+            mstiPortPtr->cold->dbgCnts.mstiMsgRxCntLastUpdated;
    }
 
 
@@ -10470,43 +11301,43 @@ mstp_updatePortHistory(MSTID_t mstid, LPORT_t lport,
       /* shift all entries one step down to the bottom of the history array */
       for(idx = MSTP_PORT_HISTORY_MAX-1; idx > 0; idx--)
       {
-         cistPortPtr->portHistory[idx] = cistPortPtr->portHistory[idx-1];
+         cistPortPtr->cold->portHistory[idx] = cistPortPtr->cold->portHistory[idx-1];
       }
       /* store new info in the first entry of the history array */
       idx = 0;
-      cistPortPtr->portHistory[idx].newState = newState;
-      cistPortPtr->portHistory[idx].oldState = cistPortPtr->selectedRole;
+      cistPortPtr->cold->portHistory[idx].newState = newState;
+      cistPortPtr->cold->portHistory[idx].oldState = cistPortPtr->selectedRole;
 
       if(cistPortPtr->infoIs == MSTP_INFO_IS_AGED)
       {
-         cistPortPtr->portHistory[idx].aged = 2;
+         cistPortPtr->cold->portHistory[idx].aged = 2;
       }
       else
-         cistPortPtr->portHistory[idx].aged = 1;
+         cistPortPtr->cold->portHistory[idx].aged = 1;
 
-      cistPortPtr->portHistory[idx].timeStamp = time(NULL);
-      cistPortPtr->portHistory[idx].portPriority.rootID =
+      cistPortPtr->cold->portHistory[idx].timeStamp = time(NULL);
+      cistPortPtr->cold->portHistory[idx].portPriority.rootID =
          cistPortPtr->portPriority.rootID;
-      cistPortPtr->portHistory[idx].portPriority.extRootPathCost =
+      cistPortPtr->cold->portHistory[idx].portPriority.extRootPathCost =
          cistPortPtr->portPriority.extRootPathCost;
-      cistPortPtr->portHistory[idx].portPriority.rgnRootID =
+      cistPortPtr->cold->portHistory[idx].portPriority.rgnRootID =
          cistPortPtr->portPriority.rgnRootID;
-      cistPortPtr->portHistory[idx].portPriority.intRootPathCost =
+      cistPortPtr->cold->portHistory[idx].portPriority.intRootPathCost =
          cistPortPtr->portPriority.intRootPathCost;
-      cistPortPtr->portHistory[idx].portPriority.dsnBridgeID =
+      cistPortPtr->cold->portHistory[idx].portPriority.dsnBridgeID =
          cistPortPtr->portPriority.dsnBridgeID;
-      cistPortPtr->portHistory[idx].portPriority.dsnPortID =
+      cistPortPtr->cold->portHistory[idx].portPriority.dsnPortID =
          cistPortPtr->portPriority.dsnPortID;
-      cistPortPtr->portHistory[idx].valid = TRUE;
+      cistPortPtr->cold->portHistory[idx].valid = TRUE;
       if(MSTP_CIST_PORT_STATE_CHANGE)
       {
-         if(((cistPortPtr->portHistory[idx].oldState ==
+         if(((cistPortPtr->cold->portHistory[idx].oldState ==
               (int)MSTP_PORT_ROLE_ALTERNATE) ||
-             (cistPortPtr->portHistory[idx].oldState ==
+             (cistPortPtr->cold->portHistory[idx].oldState ==
               (int)MSTP_PORT_ROLE_BACKUP)) &&
-            ((cistPortPtr->portHistory[idx].newState ==
+            ((cistPortPtr->cold->portHistory[idx].newState ==
               (int)MSTP_PORT_ROLE_ROOT) ||
-             (cistPortPtr->portHistory[idx].newState ==
+             (cistPortPtr->cold->portHistory[idx].newState ==
               (int)MSTP_PORT_ROLE_DESIGNATED)))
          {
             char portName[PORTNAME_LEN];
@@ -10519,13 +11350,13 @@ mstp_updatePortHistory(MSTID_t mstid, LPORT_t lport,
                 EV_KV("port", "%s", portName));
          }
          else
-            if(((cistPortPtr->portHistory[idx].newState ==
+            if(((cistPortPtr->cold->portHistory[idx].newState ==
                  (int)MSTP_PORT_ROLE_ALTERNATE) ||
-                (cistPortPtr->portHistory[idx].newState ==
+                (cistPortPtr->cold->portHistory[idx].newState ==
                  (int)MSTP_PORT_ROLE_BACKUP)) &&
-               ((cistPortPtr->portHistory[idx].oldState ==
+               ((cistPortPtr->cold->portHistory[idx].oldState ==
                  (int)MSTP_PORT_ROLE_ROOT) ||
-                (cistPortPtr->portHistory[idx].oldState ==
+                (cistPortPtr->cold->portHistory[idx].oldState ==
                  (int)MSTP_PORT_ROLE_DESIGNATED)))
             {
                char portName[PORTNAME_LEN];
@@ -10550,38 +11381,38 @@ mstp_updatePortHistory(MSTID_t mstid, LPORT_t lport,
       /* shift all entries one step down to the bottom of the history array */
       for(idx = MSTP_PORT_HISTORY_MAX-1; idx > 0; idx--)
       {
-         mstiPortPtr->portHistory[idx] = mstiPortPtr->portHistory[idx-1];
+         mstiPortPtr->cold->portHistory[idx] = mstiPortPtr->cold->portHistory[idx-1];
       }
       /* store new info in the first entry of the history array */
       idx = 0;
-      mstiPortPtr->portHistory[idx].newState = newState;
-      mstiPortPtr->portHistory[idx].oldState = mstiPortPtr->selectedRole;
+      mstiPortPtr->cold->portHistory[idx].newState = newState;
+      mstiPortPtr->cold->portHistory[idx].oldState = mstiPortPtr->selectedRole;
       if(mstiPortPtr->infoIs == MSTP_INFO_IS_AGED)
       {
-         mstiPortPtr->portHistory[idx].aged = 2;
+         mstiPortPtr->cold->portHistory[idx].aged = 2;
       }
       else
-         mstiPortPtr->portHistory[idx].aged = 1;
-      mstiPortPtr->portHistory[idx].timeStamp = time(NULL);
-      mstiPortPtr->portHistory[idx].portPriority.rgnRootID =
+         mstiPortPtr->cold->portHistory[idx].aged = 1;
+      mstiPortPtr->cold->portHistory[idx].timeStamp = time(NULL);
+      mstiPortPtr->cold->portHistory[idx].portPriority.rgnRootID =
          mstiPortPtr->portPriority.rgnRootID;
-      mstiPortPtr->portHistory[idx].portPriority.intRootPathCost =
+      mstiPortPtr->cold->portHistory[idx].portPriority.intRootPathCost =
          mstiPortPtr->portPriority.intRootPathCost;
-      mstiPortPtr->portHistory[idx].portPriority.dsnBridgeID =
+      mstiPortPtr->cold->portHistory[idx].portPriority.dsnBridgeID =
          mstiPortPtr->portPriority.dsnBridgeID;
-      mstiPortPtr->portHistory[idx].portPriority.dsnPortID =
+      mstiPortPtr->cold->portHistory[idx].portPriority.dsnPortID =
          mstiPortPtr->portPriority.dsnPortID;
-      mstiPortPtr->portHistory[idx].valid = TRUE;
+      mstiPortPtr->cold->portHistory[idx].valid = TRUE;
 
       if(MSTP_MSTI_PORT_STATE_CHANGE(mstid))
       {
-         if(((mstiPortPtr->portHistory[idx].oldState ==
+         if(((mstiPortPtr->cold->portHistory[idx].oldState ==
               (int)MSTP_PORT_ROLE_ALTERNATE) ||
-             (mstiPortPtr->portHistory[idx].oldState ==
+             (mstiPortPtr->cold->portHistory[idx].oldState ==
               (int)MSTP_PORT_ROLE_BACKUP)) &&
-            ((mstiPortPtr->portHistory[idx].newState ==
+            ((mstiPortPtr->cold->portHistory[idx].newState ==
               (int)MSTP_PORT_ROLE_ROOT) ||
-             (mstiPortPtr->portHistory[idx].newState ==
+             (mstiPortPtr->cold->portHistory[idx].newState ==
               (int)MSTP_PORT_ROLE_DESIGNATED)))
          {
             char portName[PORTNAME_LEN];
@@ -10595,13 +11426,13 @@ mstp_updatePortHistory(MSTID_t mstid, LPORT_t lport,
                 EV_KV("instance", "%d", mstid));
          }
          else
-            if(((mstiPortPtr->portHistory[idx].newState ==
+            if(((mstiPortPtr->cold->portHistory[idx].newState ==
                  (int)MSTP_PORT_ROLE_ALTERNATE) ||
-                (mstiPortPtr->portHistory[idx].newState ==
+                (mstiPortPtr->cold->portHistory[idx].newState ==
                  (int)MSTP_PORT_ROLE_BACKUP)) &&
-               ((mstiPortPtr->portHistory[idx].oldState ==
+               ((mstiPortPtr->cold->portHistory[idx].oldState ==
                  (int)MSTP_PORT_ROLE_ROOT) ||
-                (mstiPortPtr->portHistory[idx].oldState ==
+                (mstiPortPtr->cold->portHistory[idx].oldState ==
                  (int)MSTP_PORT_ROLE_DESIGNATED)))
             {
                char portName[PORTNAME_LEN];
@@ -10644,14 +11475,14 @@ mstpGetPortHistory(MSTID_t mstid, LPORT_t lport, uint8_t histIndex,
          return 0;
       }
 
-      portHistory->oldState = cistPortPtr->portHistory[histIndex].oldState;
-      portHistory->newState = cistPortPtr->portHistory[histIndex].newState;
-      portHistory->aged = cistPortPtr->portHistory[histIndex].aged;
-      portHistory->timeStamp = cistPortPtr->portHistory[histIndex].timeStamp;
+      portHistory->oldState = cistPortPtr->cold->portHistory[histIndex].oldState;
+      portHistory->newState = cistPortPtr->cold->portHistory[histIndex].newState;
+      portHistory->aged = cistPortPtr->cold->portHistory[histIndex].aged;
+      portHistory->timeStamp = cistPortPtr->cold->portHistory[histIndex].timeStamp;
       memcpy(&portHistory->portPriority ,
-             &cistPortPtr->portHistory[histIndex].portPriority,
+             &cistPortPtr->cold->portHistory[histIndex].portPriority,
              sizeof(MSTP_CIST_BRIDGE_PRI_VECTOR_t));
-      portHistory->valid = cistPortPtr->portHistory[histIndex].valid;
+      portHistory->valid = cistPortPtr->cold->portHistory[histIndex].valid;
    }
    else
    {
@@ -10669,14 +11500,14 @@ mstpGetPortHistory(MSTID_t mstid, LPORT_t lport, uint8_t histIndex,
          return 0;
       }
 
-      portHistory->oldState = mstiPortPtr->portHistory[histIndex].oldState;
-      portHistory->newState = mstiPortPtr->portHistory[histIndex].newState;
-      portHistory->aged = mstiPortPtr->portHistory[histIndex].aged;
-      portHistory->timeStamp = mstiPortPtr->portHistory[histIndex].timeStamp;
+      portHistory->oldState = mstiPortPtr->cold->portHistory[histIndex].oldState;
+      portHistory->newState = mstiPortPtr->cold->portHistory[histIndex].newState;
+      portHistory->aged = mstiPortPtr->cold->portHistory[histIndex].aged;
+      portHistory->timeStamp = mstiPortPtr->cold->portHistory[histIndex].timeStamp;
       memcpy(&portHistory->portPriority,
-             &mstiPortPtr->portHistory[histIndex].portPriority,
+             &mstiPortPtr->cold->portHistory[histIndex].portPriority,
              sizeof(MSTP_CIST_BRIDGE_PRI_VECTOR_t));
-      portHistory->valid = mstiPortPtr->portHistory[histIndex].valid;
+      portHistory->valid = mstiPortPtr->cold->portHistory[histIndex].valid;
    }
    return 0;
 }
@@ -10702,7 +11533,7 @@ mstpValidPortHistory(MSTID_t mstid, LPORT_t lport, uint8_t histIndex)
       {
          return valid;
       }
-      valid = cistPortPtr->portHistory[histIndex].valid;
+      valid = cistPortPtr->cold->portHistory[histIndex].valid;
    }
    else
    {
@@ -10711,7 +11542,7 @@ mstpValidPortHistory(MSTID_t mstid, LPORT_t lport, uint8_t histIndex)
       {
          return valid;
       }
-      valid = mstiPortPtr->portHistory[histIndex].valid;
+      valid = mstiPortPtr->cold->portHistory[histIndex].valid;
    }
    return valid;
 }
@@ -10969,15 +11800,15 @@ mstpUpdateTcHistory(MSTID_t mstid, LPORT_t lport, bool originated)
       {
          /* The last Port history change is a cause for this TC
           * which is stored in zeroth entry */
-         tcHistory[idx].prevState = cistPortPtr->portHistory[0].oldState;
-         tcHistory[idx].newState = cistPortPtr->portHistory[0].newState;
+         tcHistory[idx].prevState = cistPortPtr->cold->portHistory[0].oldState;
+         tcHistory[idx].newState = cistPortPtr->cold->portHistory[0].newState;
       }
       else
       {
          /* The last Port history change is a cause for this TC
           * which is stored in zeroth entry */
-         tcHistory[idx].prevState = mstiPortPtr->portHistory[0].oldState;
-         tcHistory[idx].newState = mstiPortPtr->portHistory[0].newState;
+         tcHistory[idx].prevState = mstiPortPtr->cold->portHistory[0].oldState;
+         tcHistory[idx].newState = mstiPortPtr->cold->portHistory[0].newState;
       }
 
       MAC_ADDR_COPY(commPortPtr->bpduSrcMac, tcHistory[idx].mac);
@@ -11077,16 +11908,10 @@ mstpGetTcHistoryEntry(bool                   originated,
  **PROC-*****************************************************************/
 void mstp_updatePortOperEdgeState(MSTID_t mstid, LPORT_t lport, bool state)
 {
-   MSTP_TREE_MSG_t *m = mstp_findMstiPortStateChgMsg(mstid);
+   MSTP_TREE_MSG_t *m = mstp_getMstiPortStateChgMsg(mstid);
 
    if(m == NULL)
-   {
-      m = calloc(1, sizeof(MSTP_TREE_MSG_t));
-      m->mstid        = mstid;
-      m->link.q_flink = NULL;
-      m->link.q_blink = NULL;
-      insqti_nodis(&MSTP_TREE_MSGS_QUEUE, &m->link);
-   }
+      return;
    if (state == TRUE)
    {
       set_port(&m->portsSetEdge, lport);
@@ -11418,17 +12243,74 @@ date()
     return date;
 }
 
+/*---------------------------------------------------------------------------
+ * Protocol thread's own copy of the interface attributes and of the system
+ * MAC address, fed by the e_mstpd_lport_info and e_mstpd_global_config
+ * messages of the OVSDB thread. Only the protocol thread uses them.
+ *---------------------------------------------------------------------------*/
+static mstp_lport_info mstp_lportInfo[MAX_LPORTS + 1];
+static char            mstp_systemMac[MSTP_MAC_STR_LEN];
+
+void mstp_lportInfoUpdate(const mstp_lport_info *info)
+{
+    mstp_lport_info *prev;
+    bool speed_chg;
+
+    STP_ASSERT(info);
+    if (!IS_VALID_LPORT(info->lportindex))
+    {
+        STP_ASSERT(FALSE);
+        return;
+    }
+    prev = &mstp_lportInfo[info->lportindex];
+    speed_chg = (prev->lportindex != info->lportindex) ||
+                (prev->link_speed != info->link_speed) ||
+                (prev->duplex != info->duplex);
+    memcpy(prev, info, sizeof(*info));
+    prev->lportname[PORTNAME_LEN - 1] = '\0';
+
+    if (speed_chg) {
+        SPEED_DPLX speed_dplx = {info->link_speed, info->duplex};
+
+        mstp_lportCostUpdate(info->lportindex, &speed_dplx,
+                             VERIFY_LAG_IFNAME(prev->lportname) == 0,
+                             info->link_up);
+    }
+}
+
+void mstp_systemMacUpdate(const char *mac)
+{
+    STP_ASSERT(mac);
+    memset(mstp_systemMac, 0, sizeof(mstp_systemMac));
+    strncpy(mstp_systemMac, mac, MSTP_MAC_STR_LEN - 1);
+}
+
+/**PROC+***********************************************************
+ * Name:    system_get_mac_addr
+ *
+ * Purpose: Get MAC address for System
+ *
+ * Params:    mac_buffer : Destination buffer to which mac addres to be copied
+ *
+ * Returns:   none
+ *
+ **PROC-*****************************************************************/
+
+void system_get_mac_addr(const char *mac_buffer)
+{
+    memcpy((void *)mac_buffer, mstp_systemMac, MSTP_MAC_STR_LEN -1);
+    return;
+}
+
 void intf_get_port_name(LPORT_t lport, char *port_name)
 {
-    struct iface_data *idp = NULL;
     if ((lport > 0) && (lport <= MAX_LPORTS))
     {
-        idp = find_iface_data_by_index(lport);
-        if(idp == NULL)
+        if(mstp_lportInfo[lport].lportindex != lport)
         {
             return;
         }
-        strncpy(port_name,idp->name,10);
+        strncpy(port_name,mstp_lportInfo[lport].lportname,10);
     }
     else
     {
@@ -11439,23 +12321,84 @@ void intf_get_port_name(LPORT_t lport, char *port_name)
 
 bool intf_get_lport_speed_duplex(LPORT_t lport, SPEED_DPLX *sd)
 {
-    struct iface_data *idp = NULL;
     STP_ASSERT(sd);
     STP_ASSERT((lport != 0) && (lport <= MAX_LPORTS));
 
     if ((lport <= MAX_LPORTS))
     {
-        idp = find_iface_data_by_index(lport);
-        if(idp == NULL)
+        if(mstp_lportInfo[lport].lportindex != lport)
         {
             return FALSE;
         }
-        sd->speed = idp->link_speed;
-        sd->duplex = idp->duplex;
+        sd->speed = mstp_lportInfo[lport].link_speed;
+        sd->duplex = mstp_lportInfo[lport].duplex;
+        return(TRUE);
+    }
+    return(FALSE);
+}
+
+/**PROC+***********************************************************
+ * Name:    intf_get_lport_mac
+ *
+ * Purpose: Get the MAC address MSTPDUs are sent from on the port
+ *
+ * Params:  lport -> logical port
+ *          mac   -> filled in, all zeros if the address is not known
+ *
+ * Returns: TRUE if the address is known
+ *
+ **PROC-*****************************************************************/
+bool intf_get_lport_mac(LPORT_t lport, MAC_ADDRESS mac)
+{
+    STP_ASSERT((lport != 0) && (lport <= MAX_LPORTS));
+
+    if ((lport <= MAX_LPORTS) && (mstp_lportInfo[lport].lportindex == lport) &&
+        mstp_lportInfo[lport].mac_valid)
+    {
+        memcpy(mac, mstp_lportInfo[lport].mac, sizeof(MAC_ADDRESS));
         return(TRUE);
     }
+    memset(mac, 0, sizeof(MAC_ADDRESS));
     return(FALSE);
 }
+
+/**PROC+***********************************************************
+ * Name:    is_lport_down
+ *
+ * Purpose:  to check if a lport link state is down
+ *
+ * Params:    none
+ *
+ * Returns:   TRUE/FALSE
+ *
+ **PROC-*****************************************************************/
+bool is_lport_down(int lport)
+{
+    if (IS_VALID_LPORT(lport) && mstp_lportInfo[lport].link_up)
+    {
+        return FALSE;
+    }
+    else
+    {
+        return TRUE;
+    }
+}
+/**PROC+***********************************************************
+ * Name:    is_lport_up
+ *
+ * Purpose:  to check if a lport link state is up
+ *
+ * Params:    none
+ *
+ * Returns:   TRUE/FALSE
+ *
+ **PROC-*****************************************************************/
+
+bool is_lport_up(int lport)
+{
+    return !is_lport_down(lport);
+}
+
 int mstp_util_get_valid_l2_ports(const struct ovsrec_bridge *bridge_row) {
     int i = 0, port_count = 0;
 